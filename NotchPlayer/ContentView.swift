@@ -3,7 +3,9 @@ import AppKit
 
 // MARK: - Bridge: reads values from PlayerView via KVC and sends commands back
 final class PlayerBridge: ObservableObject {
-    weak var player: PlayerView?
+    weak var player: PlayerView? {
+        didSet { observePlayer() }
+    }
 
     // UI state
     @Published var isPaused: Bool = true
@@ -46,6 +48,46 @@ final class PlayerBridge: ObservableObject {
     func applyLooping() {
         player?.isLooping = isLooping
     }
+
+    // UI refresh is driven by the player's KVO changes: nothing ticks while
+    // paused or stopped. During playback redraws are coalesced to ~30 Hz.
+    private var observations: [NSKeyValueObservation] = []
+    private var lastRefresh: CFTimeInterval = 0
+    private var refreshPending = false
+    private let refreshInterval: CFTimeInterval = 1.0 / 30.0
+
+    private func observePlayer() {
+        observations = []
+        guard let p = player else { return }
+        let changed: (PlayerView) -> Void = { [weak self] _ in
+            DispatchQueue.main.async { self?.scheduleRefresh() }
+        }
+        observations = [
+            p.observe(\.currentPTS) { v, _ in changed(v) },
+            p.observe(\.duration)   { v, _ in changed(v) },
+            p.observe(\.fps)        { v, _ in changed(v) },
+        ]
+    }
+
+    private func scheduleRefresh() {
+        if refreshPending { return }
+        let wait = lastRefresh + refreshInterval - CACurrentMediaTime()
+        if wait <= 0 {
+            refresh()
+            return
+        }
+        // Trailing refresh so the last value before a pause is shown
+        refreshPending = true
+        DispatchQueue.main.asyncAfter(deadline: .now() + wait) { [weak self] in
+            self?.refreshPending = false
+            self?.refresh()
+        }
+    }
+
+    private func refresh() {
+        lastRefresh = CACurrentMediaTime()
+        objectWillChange.send()
+    }
 }
 
 // MARK: - Timecode formatting (mm:ss.ff frames)
@@ -105,9 +147,6 @@ struct CheckerboardView: View {
 // MARK: - Main view
 struct ContentView: View {
     @StateObject private var bridge = PlayerBridge()
-    // 30 Hz UI tick (instead of timelineSchedule)
-    @State private var tick = 0
-    private let timer = Timer.publish(every: 1.0/30.0, on: .main, in: .common).autoconnect()
 
     var body: some View {
         VStack(spacing: 0) {
@@ -124,8 +163,6 @@ struct ContentView: View {
                 .padding(.vertical, 8)
                 .background(Color(nsColor: .windowBackgroundColor))
         }
-        // UI refresh
-        .onReceive(timer) { _ in tick &+= 1 }
     }
 
     private var controlsBar: some View {
@@ -1,4 +1,9 @@
+#include "ffcue.h"
 #include "ffdecode.h"
+#include "ffplaylist.h"
+#include "ffsched.h"
+#include "ffsync.h"
+#include "fftransition.h"
 double ff_probe_duration(const char *path);
 double ff_get_avg_fps(const char *path);
 int ff_is_notchlc(const char *path);
@@ -6,7 +6,20 @@ import CoreVideo
 final class PlayerView: NSView {
     
     // MARK: Public flags
-    public var isLooping: Bool = true
+    public var isLooping: Bool {
+        get { settingsLock.lock(); defer { settingsLock.unlock() }; return loopEnabled }
+        set {
+            settingsLock.lock()
+            // SwiftUI assigns this on every refresh; only a change reaches the player
+            let changed = newValue != loopEnabled
+            loopEnabled = newValue
+            if changed { loopDirty = true }
+            settingsLock.unlock()
+            guard changed else { return }
+            // The playback thread owns the player: let it apply the change
+            decodeQueue.async { if let s = self.sched { ff_sched_wake(s) } }
+        }
+    }
     public private(set) var isPaused: Bool = false
     public var isStopped: Bool { hPlayer == nil }
     
@@ -18,11 +31,14 @@ final class PlayerView: NSView {
     // MARK: Internals
     private let displayLayer = AVSampleBufferDisplayLayer()
     
-    // One dedicated queue for all decode/stop work to avoid races
+    // Serialises open/stop and media clock changes
     private let decodeQueue = DispatchQueue(label: "notchplayer.decode.queue")
     
-    private var timer: DispatchSourceTimer?
-    private var isShuttingDown: Bool = false
+    // Playback thread: pulls frames and hands them over when ffsched says so.
+    // It is the only caller into hPlayer while it runs.
+    private var playbackThread: Thread?
+    private var playbackDone: DispatchSemaphore?
+    private var sched: OpaquePointer?
     
     private var hPlayer: OpaquePointer?
     private var currentURL: URL?
@@ -31,8 +47,12 @@ final class PlayerView: NSView {
     // Exact duration once we’ve completed one pass
     private var measuredDuration: Double?
     
-    private var pendingImage: CVImageBuffer?
-    private var pendingPTS: Double = .nan
+    // Guards the loop settings and `timebase`, which the control queue and the
+    // playback thread both sync
+    private let settingsLock = NSLock()
+    private var loopEnabled: Bool = true
+    private var loopDirty: Bool = false
+    
     private let displayQueue = DispatchQueue(label: "notchplayer.display.queue")
     private var videoW: Int32 = 0
     private var videoH: Int32 = 0
@@ -108,8 +128,6 @@ final class PlayerView: NSView {
         // Reset all per-file state so duration is recalculated on each open
         decodeQueue.sync {
             self.measuredDuration = nil
-            self.pendingImage = nil
-            self.pendingPTS = .nan
             self.videoW = 0
             self.videoH = 0
         }
@@ -129,36 +147,47 @@ final class PlayerView: NSView {
 
     
     func play() {
-        guard let tb = ensureTimebase() else { return }
-        CMTimebaseSetTime(tb, time: .zero)
-        CMTimebaseSetRate(tb, rate: 1.0)
         isPaused = false
+        decodeQueue.async {
+            guard let s = self.sched else { return }
+            ff_sched_seek(s, 0)
+            ff_sched_play(s)
+            self.syncTimebase(s)
+        }
     }
     
     func pause() {
-        guard let tb = timebase else { return }
-        CMTimebaseSetRate(tb, rate: 0.0)
         isPaused = true
+        decodeQueue.async {
+            guard let s = self.sched else { return }
+            ff_sched_pause(s)
+            self.syncTimebase(s)
+        }
     }
     
     func resume() {
-        guard let tb = timebase else { return }
-        CMTimebaseSetRate(tb, rate: 1.0)
         isPaused = false
+        decodeQueue.async {
+            guard let s = self.sched else { return }
+            ff_sched_play(s)
+            self.syncTimebase(s)
+        }
     }
     
     func stopPlayback() {
-        // Graceful shutdown of decode on the decode queue (no races)
+        // Graceful shutdown of the playback thread (no races)
         stop()
         
         // Clear the layer and reset the clock to 0 on main
         DispatchQueue.main.async {
             self.displayLayer.flushAndRemoveImage()
         }
+        settingsLock.lock()
         if let tb = timebase {
             CMTimebaseSetRate(tb, rate: 0.0)
             CMTimebaseSetTime(tb, time: .zero)
         }
+        settingsLock.unlock()
         currentPTS = 0
         // Keep 'duration' as-is so UI can still show known length after first pass
         isPaused = false // next Play starts from 0
@@ -168,25 +197,26 @@ final class PlayerView: NSView {
     
     private func stop() {
         decodeQueue.sync {
-            isShuttingDown = true
-            
-            // Safely stop timer
-            if let t = timer {
-                t.setEventHandler {} // prevent firing into freed state
-                t.cancel()
-                timer = nil
-            }
+            // Wake the playback thread out of any wait and let it finish its
+            // current frame before the player goes away
+            if let s = sched { ff_sched_stop(s) }
+            playbackDone?.wait()
+            playbackDone = nil
+            playbackThread = nil
             
             // Close decoder if open
             if let hp = hPlayer {
                 hPlayer = nil
                 ff_close(hp)
             }
-            
-            isShuttingDown = false
+            if let s = sched {
+                sched = nil
+                ff_sched_destroy(s)
+            }
         }
     }
     
+    // Caller holds settingsLock.
     private func ensureTimebase() -> CMTimebase? {
         if let tb = timebase { return tb }
         var tb: CMTimebase?
@@ -202,8 +232,17 @@ final class PlayerView: NSView {
         return timebase
     }
     
+    // The layer shows enqueued frames by the timebase; keep it on the scheduler's clock.
+    private func syncTimebase(_ s: OpaquePointer) {
+        settingsLock.lock()
+        defer { settingsLock.unlock() }
+        guard let tb = ensureTimebase() else { return }
+        CMTimebaseSetTime(tb, time: CMTime(seconds: ff_sched_time(s), preferredTimescale: 600))
+        CMTimebaseSetRate(tb, rate: ff_sched_is_playing(s) != 0 ? 1.0 : 0.0)
+    }
+    
     private func startDecodeLoop(path: String, resumeFrom: Double) {
-        // All decode work runs on the dedicated queue
+        // Open and set-up run on the control queue; playback on its own thread
         decodeQueue.async {
             // Clear any old visuals up front
             DispatchQueue.main.async {
@@ -222,6 +261,13 @@ final class PlayerView: NSView {
             self.hPlayer = handle
             self.videoW = w
             self.videoH = h
+            // Seamless looping: the decoder keeps the first frames and wraps
+            // to them at EOF while it restarts in the background.
+            self.settingsLock.lock()
+            self.loopDirty = false
+            let looping = self.loopEnabled
+            self.settingsLock.unlock()
+            if looping { _ = ff_set_loop(handle, 1, 0) }
 
             // ---- Duration selection (match ffprobe by default) ----
             @inline(__always) func isValidDuration(_ v: Double) -> Bool { v.isFinite && v > 0 }
@@ -249,13 +295,6 @@ final class PlayerView: NSView {
             }
             // -------------------------------------------------------
 
-            // Prepare playback clock/timebase
-            _ = self.ensureTimebase()
-            if let tb = self.timebase {
-                CMTimebaseSetTime(tb, time: CMTime(seconds: resumeFrom, preferredTimescale: 600))
-                // Rate is controlled by play()/pause()/resume()
-            }
-
             // Resize window to match clip aspect (do this on main)
             DispatchQueue.main.async { [weak self] in
                 self?.resizeWindowToVideoAspect(videoWidth: w, videoHeight: h)
@@ -268,162 +307,143 @@ final class PlayerView: NSView {
             self.videoFPS = fps
             DispatchQueue.main.async { self.fps = fps }
 
+            // Presentation clock: frames are handed to the layer ~½ frame
+            // ahead of their time and the layer shows them on the timebase
+            var cfg = FFSchedConfig()
+            cfg.frame_interval = frameInterval
+            guard let s = ff_sched_create(&cfg) else {
+                self.hPlayer = nil
+                ff_close(handle)
+                return
+            }
+            self.sched = s
+            ff_sched_seek(s, resumeFrom)
+            if !self.isPaused { ff_sched_play(s) }
+            self.syncTimebase(s)
+
+            let done = DispatchSemaphore(value: 0)
+            let thread = Thread { [unowned self] in
+                self.playbackLoop(handle: handle, sched: s)
+                done.signal()
+            }
+            thread.name = "notchplayer.playback"
+            thread.qualityOfService = .userInteractive
+            self.playbackDone = done
+            self.playbackThread = thread
+            thread.start()
+        }
+    }
 
-            // Pacing: don’t decode more than a small lead ahead of the clock
-            let presentLead: Double = max(0.5 * frameInterval, 0.003) // ~½ frame
-            let epsilon: Double = 0.001
-
-            // Reset pending frame state
-            self.pendingImage = nil
-            self.pendingPTS = .nan
-
-            // Timer at frame cadence with tiny leeway to reduce jitter
-            let t = DispatchSource.makeTimerSource(queue: self.decodeQueue)
-            let tickNs = max(1_000_000, Int((frameInterval * 1_000_000_000).rounded())) // ≥1ms
-            t.schedule(deadline: .now(), repeating: .nanoseconds(tickNs), leeway: .milliseconds(1))
-
-            t.setEventHandler { [weak self] in
-                guard let self = self else { return }
-                if self.isShuttingDown { return }
-                guard self.hPlayer != nil else { return }
-
-                // If paused, keep UI clock updated but don’t decode/enqueue
-                if let tb = self.timebase, CMTimebaseGetRate(tb) == 0 {
-                    self.currentPTS = CMTimeGetSeconds(CMTimebaseGetTime(tb))
-                    return
-                }
-
-                // Authoritative playhead = timebase time
-                let nowSec: Double = {
-                    if let tb = self.timebase { return CMTimeGetSeconds(CMTimebaseGetTime(tb)) }
-                    return 0
-                }()
-                self.currentPTS = nowSec
-
-                // 1) Present pending frame when due; otherwise don't drain
-                if let ib = self.pendingImage, self.pendingPTS.isFinite {
-                    if self.pendingPTS <= nowSec + epsilon {
-                        var timing = CMSampleTimingInfo()
-                        timing.presentationTimeStamp = CMTime(seconds: self.pendingPTS, preferredTimescale: 600)
-                        timing.duration = .invalid
-                        timing.decodeTimeStamp = .invalid
-
-                        var vfmt: CMVideoFormatDescription?
-                        CMVideoFormatDescriptionCreateForImageBuffer(
-                            allocator: kCFAllocatorDefault,
-                            imageBuffer: ib,
-                            formatDescriptionOut: &vfmt
-                        )
-                        if let vfmt = vfmt {
-                            var sbuf: CMSampleBuffer?
-                            CMSampleBufferCreateReadyWithImageBuffer(
-                                allocator: kCFAllocatorDefault,
-                                imageBuffer: ib,
-                                formatDescription: vfmt,
-                                sampleTiming: &timing,
-                                sampleBufferOut: &sbuf
-                            )
-                            if let sbuf = sbuf {
-                                self.displayQueue.async { self.displayLayer.enqueue(sbuf) }
-                            }
-                        }
-
-                        self.pendingImage = nil
-                        self.pendingPTS = .nan
-                    } else {
-                        return // not time yet → don’t fetch more
-                    }
-                }
-
-                // 2) No pending frame: fetch exactly one
+    // Decode one frame, wait for its hand-over time, enqueue it; repeat until
+    // the scheduler is stopped or the clip ends.
+    private func playbackLoop(handle: OpaquePointer, sched s: OpaquePointer) {
+        var lastPTS: Double = -.infinity
+        var held: CVImageBuffer?
+        var heldPTS: Double = .nan
+
+        while true {
+            settingsLock.lock()
+            let loopChanged = loopDirty
+            let looping = loopEnabled
+            loopDirty = false
+            settingsLock.unlock()
+            if loopChanged { _ = ff_set_loop(handle, looping ? 1 : 0, 0) }
+
+            if held == nil {
                 var umib: Unmanaged<CVImageBuffer>?
                 var pts: Double = .nan
-                let rc = ff_next_frame(self.hPlayer, &umib, &pts)
+                let rc = ff_next_frame(handle, &umib, &pts)
 
                 if rc == 1, let umib = umib {
                     let ib: CVImageBuffer = umib.takeRetainedValue()
-                    let ptsForPresentation: Double = pts.isFinite ? pts : nowSec
-
-                    // If frame is ahead of clock, hold it to avoid racing to EOF
-                    if ptsForPresentation > nowSec + presentLead {
-                        self.pendingImage = ib
-                        self.pendingPTS = ptsForPresentation
-                        return
-                    }
-
-                    var timing = CMSampleTimingInfo()
-                    timing.presentationTimeStamp = CMTime(seconds: ptsForPresentation, preferredTimescale: 600)
-                    timing.duration = .invalid
-                    timing.decodeTimeStamp = .invalid
-
-                    var vfmt: CMVideoFormatDescription?
-                    CMVideoFormatDescriptionCreateForImageBuffer(
-                        allocator: kCFAllocatorDefault,
-                        imageBuffer: ib,
-                        formatDescriptionOut: &vfmt
-                    )
-                    if let vfmt = vfmt {
-                        var sbuf: CMSampleBuffer?
-                        CMSampleBufferCreateReadyWithImageBuffer(
-                            allocator: kCFAllocatorDefault,
-                            imageBuffer: ib,
-                            formatDescription: vfmt,
-                            sampleTiming: &timing,
-                            sampleBufferOut: &sbuf
-                        )
-                        if let sbuf = sbuf {
-                            self.displayQueue.async { self.displayLayer.enqueue(sbuf) }
+                    if pts.isFinite && pts < lastPTS {
+                        // Looped back to the start: the first pass gives the exact
+                        // runtime. Move the clock back by one pass so the first
+                        // frame is due one interval after the last, as if the
+                        // clip went on; a seek would make it due at once.
+                        let interval = ff_sched_frame_interval(s)
+                        if measuredDuration == nil {
+                            let measured = lastPTS + interval
+                            measuredDuration = measured
+                            DispatchQueue.main.async { self.duration = measured }
                         }
+                        ff_sched_slew(s, pts - (lastPTS + interval))
+                        syncTimebase(s)
                     }
-
+                    if !pts.isFinite { pts = ff_sched_time(s) }
+                    lastPTS = pts
+                    held = ib
+                    heldPTS = pts
                 } else if rc == 0 {
                     // EOF: promote measured runtime
-                    if let tb = self.timebase {
-                        let measured = CMTimeGetSeconds(CMTimebaseGetTime(tb))
-                        self.measuredDuration = measured
-                        DispatchQueue.main.async { self.duration = measured }
-                    }
-
-                    // Stop cleanly
-                    self.timer?.setEventHandler {}
-                    self.timer?.cancel()
-                    self.timer = nil
-                    if let hp = self.hPlayer {
-                        self.hPlayer = nil
-                        ff_close(hp)
-                    }
+                    let measured = ff_sched_time(s)
+                    measuredDuration = measured
+                    DispatchQueue.main.async { self.duration = measured }
 
-                    // Loop if enabled
-                    if self.isLooping, let url = self.currentURL {
+                    // Loop by reopening if seamless looping was not on
+                    if looping, let url = currentURL {
                         DispatchQueue.main.async {
                             self.displayLayer.flushAndRemoveImage()
+                            self.stop()
+                            self.startDecodeLoop(path: url.path, resumeFrom: 0)
                         }
-                        if let tb = self.timebase {
-                            let wasPlaying = (CMTimebaseGetRate(tb) > 0)
-                            CMTimebaseSetTime(tb, time: .zero)
-                            CMTimebaseSetRate(tb, rate: wasPlaying ? 1.0 : 0.0)
-                        }
-                        self.startDecodeLoop(path: url.path, resumeFrom: 0)
                     }
-
-                } else if rc < 0 {
+                    return
+                } else if rc == -3 {
+                    // Output pool full (display still holds its buffers): the
+                    // decoded frame is kept in C; give the layer a frame to let go
+                    if ff_sched_wait(s, ff_sched_time(s) + 2.0 / videoFPS) == FF_SCHED_STOPPED { return }
+                    continue
+                } else {
                     // Decode error
                     print("ff_next_frame error: \(rc)")
-                    self.timer?.setEventHandler {}
-                    self.timer?.cancel()
-                    self.timer = nil
-                    if let hp = self.hPlayer {
-                        self.hPlayer = nil
-                        ff_close(hp)
-                    }
                     DispatchQueue.main.async {
                         self.displayLayer.flushAndRemoveImage()
                     }
+                    return
                 }
             }
 
-            t.resume()
-            self.timer = t
+            guard let ib = held else { continue }
+            let r = ff_sched_wait(s, heldPTS)
+            if r == FF_SCHED_PRESENT {
+                enqueue(ib, pts: heldPTS)
+                ff_sched_presented(s, heldPTS)
+                let shown = heldPTS
+                DispatchQueue.main.async { self.currentPTS = shown }
+                held = nil
+            } else if r == FF_SCHED_DROP {
+                held = nil
+            } else if r == FF_SCHED_STOPPED {
+                return
+            }
+            // FF_SCHED_WOKEN: clock or settings changed, decide again
+        }
+    }
+
+    private func enqueue(_ ib: CVImageBuffer, pts: Double) {
+        var timing = CMSampleTimingInfo()
+        timing.presentationTimeStamp = CMTime(seconds: pts, preferredTimescale: 600)
+        timing.duration = .invalid
+        timing.decodeTimeStamp = .invalid
+
+        var vfmt: CMVideoFormatDescription?
+        CMVideoFormatDescriptionCreateForImageBuffer(
+            allocator: kCFAllocatorDefault,
+            imageBuffer: ib,
+            formatDescriptionOut: &vfmt
+        )
+        guard let vfmt = vfmt else { return }
+        var sbuf: CMSampleBuffer?
+        CMSampleBufferCreateReadyWithImageBuffer(
+            allocator: kCFAllocatorDefault,
+            imageBuffer: ib,
+            formatDescription: vfmt,
+            sampleTiming: &timing,
+            sampleBufferOut: &sbuf
+        )
+        if let sbuf = sbuf {
+            displayQueue.async { self.displayLayer.enqueue(sbuf) }
         }
     }
 
@@ -0,0 +1,315 @@
+#include "ffcache.h"
+#include "ffgovernor.h"
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct CacheEntry CacheEntry;
+struct CacheEntry {
+    int64_t     index;
+    FFFrameRef* f;
+    size_t      bytes;
+    CacheEntry* hnext;        // hash chain
+    CacheEntry* newer;        // recency list: head = most recent
+    CacheEntry* older;
+};
+
+struct FFFrameCache {
+    pthread_mutex_t lock;
+    FFFrameCacheConfig cfg;
+
+    CacheEntry**    buckets;  // power-of-two table
+    int             nbuckets;
+    CacheEntry*     newest;
+    CacheEntry*     oldest;
+
+    int64_t         pin_lo, pin_hi;   // inclusive; empty until a playhead is set
+    FFFrameCacheStats stats;
+    size_t          cap;              // from the memory governor; SIZE_MAX = none
+    FFGovClient*    gov;
+};
+
+// What the cache may hold: its budget, or less under the governor's cap.
+static size_t limit(const FFFrameCache* c) {
+    return c->cap < c->cfg.budget_bytes ? c->cap : c->cfg.budget_bytes;
+}
+
+static unsigned bucket_of(const FFFrameCache* c, int64_t index) {
+    uint64_t h = (uint64_t)index * 0x9e3779b97f4a7c15ULL;
+    return (unsigned)(h >> 32) & (unsigned)(c->nbuckets - 1);
+}
+
+static CacheEntry* find(const FFFrameCache* c, int64_t index) {
+    for (CacheEntry* e = c->buckets[bucket_of(c, index)]; e; e = e->hnext)
+        if (e->index == index) return e;
+    return NULL;
+}
+
+static int pinned(const FFFrameCache* c, int64_t index) {
+    return index >= c->pin_lo && index <= c->pin_hi;
+}
+
+static void list_unlink(FFFrameCache* c, CacheEntry* e) {
+    if (e->newer) e->newer->older = e->older; else c->newest = e->older;
+    if (e->older) e->older->newer = e->newer; else c->oldest = e->newer;
+    e->newer = e->older = NULL;
+}
+
+static void list_push_newest(FFFrameCache* c, CacheEntry* e) {
+    e->older = c->newest;
+    e->newer = NULL;
+    if (c->newest) c->newest->newer = e; else c->oldest = e;
+    c->newest = e;
+}
+
+static void grow(FFFrameCache* c) {
+    int n = c->nbuckets * 2;
+    CacheEntry** b = calloc((size_t)n, sizeof(*b));
+    if (!b) return;   // keep the longer chains
+    CacheEntry** old = c->buckets;
+    int oldn = c->nbuckets;
+    c->buckets  = b;
+    c->nbuckets = n;
+    for (int i = 0; i < oldn; ++i) {
+        for (CacheEntry* e = old[i], *next; e; e = next) {
+            next = e->hnext;
+            unsigned k = bucket_of(c, e->index);
+            e->hnext = b[k];
+            b[k] = e;
+        }
+    }
+    free(old);
+}
+
+static void remove_entry(FFFrameCache* c, CacheEntry* e) {
+    CacheEntry** pp = &c->buckets[bucket_of(c, e->index)];
+    while (*pp != e) pp = &(*pp)->hnext;
+    *pp = e->hnext;
+    list_unlink(c, e);
+    c->stats.bytes -= e->bytes;
+    c->stats.entries--;
+    if (pinned(c, e->index)) c->stats.pinned--;
+    ff_frame_release(e->f);
+    free(e);
+}
+
+// Evicts unpinned entries, oldest first, until at most `target` bytes are held.
+static size_t evict_to(FFFrameCache* c, size_t target) {
+    size_t freed = 0;
+    CacheEntry* e = c->oldest;
+    while (e && c->stats.bytes > target) {
+        CacheEntry* newer = e->newer;
+        if (!pinned(c, e->index)) {
+            freed += e->bytes;
+            remove_entry(c, e);
+            c->stats.evictions++;
+        }
+        e = newer;
+    }
+    return freed;
+}
+
+static size_t gov_usage(void* opaque, size_t* wanted) {
+    FFFrameCache* c = opaque;
+    pthread_mutex_lock(&c->lock);
+    size_t n = c->stats.bytes;
+    *wanted  = c->cfg.budget_bytes;
+    pthread_mutex_unlock(&c->lock);
+    return n;
+}
+
+static void gov_set_cap(void* opaque, size_t cap) {
+    FFFrameCache* c = opaque;
+    pthread_mutex_lock(&c->lock);
+    c->cap = cap;
+    c->stats.cap_bytes = cap;
+    evict_to(c, limit(c));
+    pthread_mutex_unlock(&c->lock);
+}
+
+FFFrameCache* ff_cache_create(const FFFrameCacheConfig* cfg) {
+    FFFrameCache* c = calloc(1, sizeof(*c));
+    if (!c) return NULL;
+    if (cfg) c->cfg = *cfg;
+    if (c->cfg.budget_bytes == 0) c->cfg.budget_bytes = FF_CACHE_DEFAULT_BUDGET;
+    if (c->cfg.pin_before < 0) c->cfg.pin_before = 0;
+    if (c->cfg.pin_after < 0) c->cfg.pin_after = 0;
+    c->nbuckets = 64;
+    c->buckets  = calloc((size_t)c->nbuckets, sizeof(*c->buckets));
+    if (!c->buckets) {
+        free(c);
+        return NULL;
+    }
+    c->pin_lo = 1;
+    c->pin_hi = 0;
+    c->stats.budget_bytes = c->cfg.budget_bytes;
+    c->cap = c->stats.cap_bytes = SIZE_MAX;
+    pthread_mutex_init(&c->lock, NULL);
+    // Cached frames live in the player's pool buffers: shrinking the cache
+    // hands them back to the pool, which the governor then trims.
+    FFGovClientConfig gc = { .name = "frame cache", .kind = FF_GOV_CACHE,
+                             .priority = FF_GOV_PRIORITY_FRAME_CACHE, .borrowed = 1, .opaque = c,
+                             .usage = gov_usage, .set_cap = gov_set_cap };
+    c->gov = ff_governor_register(&gc);
+    return c;
+}
+
+void ff_cache_destroy(FFFrameCache* c) {
+    if (!c) return;
+    ff_governor_unregister(c->gov);
+    ff_cache_clear(c);
+    pthread_mutex_destroy(&c->lock);
+    free(c->buckets);
+    free(c);
+}
+
+FFFrameRef* ff_cache_get(FFFrameCache* c, int64_t index) {
+    if (!c) return NULL;
+    pthread_mutex_lock(&c->lock);
+    CacheEntry* e = find(c, index);
+    FFFrameRef* f = NULL;
+    if (e) {
+        list_unlink(c, e);
+        list_push_newest(c, e);
+        f = ff_frame_retain(e->f);
+        c->stats.hits++;
+    } else {
+        c->stats.misses++;
+    }
+    pthread_mutex_unlock(&c->lock);
+    return f;
+}
+
+FFFrameRef* ff_cache_get_nearest(FFFrameCache* c, int64_t index) {
+    if (!c) return NULL;
+    pthread_mutex_lock(&c->lock);
+    CacheEntry* best = find(c, index);
+    if (!best) {
+        uint64_t best_d = UINT64_MAX;
+        for (CacheEntry* e = c->newest; e; e = e->older) {
+            uint64_t d = e->index > index ? (uint64_t)(e->index - index) : (uint64_t)(index - e->index);
+            if (d < best_d || (d == best_d && e->index < best->index)) {
+                best = e;
+                best_d = d;
+            }
+        }
+    }
+    FFFrameRef* f = best ? ff_frame_retain(best->f) : NULL;
+    pthread_mutex_unlock(&c->lock);
+    return f;
+}
+
+int ff_cache_contains(FFFrameCache* c, int64_t index) {
+    if (!c) return 0;
+    pthread_mutex_lock(&c->lock);
+    int r = find(c, index) != NULL;
+    pthread_mutex_unlock(&c->lock);
+    return r;
+}
+
+int ff_cache_put(FFFrameCache* c, FFFrameRef* f) {
+    if (!c || !f) return -1;
+    int64_t index = ff_frame_index(f);
+    if (index < 0) return -1;
+    size_t bytes = ff_frame_bytes(f);
+
+    pthread_mutex_lock(&c->lock);
+    int r = 1;
+    CacheEntry* e = find(c, index);
+    if (e) {
+        list_unlink(c, e);
+        list_push_newest(c, e);
+        goto done;
+    }
+    int pin = pinned(c, index);
+    size_t lim = limit(c);
+    if (!pin && bytes > lim) {
+        c->stats.rejected++;
+        r = 0;
+        goto done;
+    }
+    size_t target = lim >= bytes ? lim - bytes : 0;
+    evict_to(c, target);
+    if (!pin && c->stats.bytes > target) {   // the rest is pinned
+        c->stats.rejected++;
+        r = 0;
+        goto done;
+    }
+
+    e = calloc(1, sizeof(*e));
+    if (!e) {
+        r = -1;
+        goto done;
+    }
+    e->index = index;
+    e->f     = ff_frame_retain(f);
+    e->bytes = bytes;
+    unsigned k = bucket_of(c, index);
+    e->hnext = c->buckets[k];
+    c->buckets[k] = e;
+    list_push_newest(c, e);
+
+    c->stats.insertions++;
+    c->stats.entries++;
+    if (pin) c->stats.pinned++;
+    c->stats.bytes += bytes;
+    if (c->stats.bytes > c->stats.high_water_bytes) c->stats.high_water_bytes = c->stats.bytes;
+    if (c->stats.entries > c->nbuckets) grow(c);
+    pthread_mutex_unlock(&c->lock);
+    ff_governor_notify();
+    return r;
+
+done:
+    pthread_mutex_unlock(&c->lock);
+    return r;
+}
+
+void ff_cache_set_playhead(FFFrameCache* c, int64_t index) {
+    if (!c) return;
+    pthread_mutex_lock(&c->lock);
+    c->pin_lo = index - c->cfg.pin_before;
+    c->pin_hi = index + c->cfg.pin_after;
+    // Recount: the window is small, walking it beats walking the cache.
+    int n = 0;
+    if (c->cfg.pin_before + c->cfg.pin_after < c->stats.entries) {
+        for (int64_t i = c->pin_lo; i <= c->pin_hi; ++i) n += find(c, i) != NULL;
+    } else {
+        for (CacheEntry* e = c->newest; e; e = e->older) n += pinned(c, e->index);
+    }
+    c->stats.pinned = n;
+    // Frames that just left the window may be over budget now.
+    evict_to(c, limit(c));
+    pthread_mutex_unlock(&c->lock);
+}
+
+void ff_cache_set_budget(FFFrameCache* c, size_t budget_bytes) {
+    if (!c || budget_bytes == 0) return;
+    pthread_mutex_lock(&c->lock);
+    c->cfg.budget_bytes = budget_bytes;
+    c->stats.budget_bytes = budget_bytes;
+    evict_to(c, limit(c));
+    pthread_mutex_unlock(&c->lock);
+}
+
+size_t ff_cache_shrink(FFFrameCache* c, size_t target_bytes) {
+    if (!c) return 0;
+    pthread_mutex_lock(&c->lock);
+    size_t freed = evict_to(c, target_bytes);
+    pthread_mutex_unlock(&c->lock);
+    return freed;
+}
+
+void ff_cache_clear(FFFrameCache* c) {
+    if (!c) return;
+    pthread_mutex_lock(&c->lock);
+    while (c->oldest) remove_entry(c, c->oldest);
+    pthread_mutex_unlock(&c->lock);
+}
+
+void ff_cache_get_stats(FFFrameCache* c, FFFrameCacheStats* out) {
+    if (!c || !out) return;
+    pthread_mutex_lock(&c->lock);
+    *out = c->stats;
+    pthread_mutex_unlock(&c->lock);
+}
@@ -0,0 +1,72 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include "ffframe.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Decoded-frame cache for one clip, keyed by frame index. Frames are held by
+// reference (no copies) against a byte budget; the least recently used frame
+// is evicted first, except frames in a window around the playhead, which are
+// pinned. The cache registers with the memory governor (ffgovernor.h), which
+// may hold it below its budget. Thread-safe.
+typedef struct FFFrameCache FFFrameCache;
+
+typedef struct FFFrameCacheConfig {
+    size_t budget_bytes;   // bytes of frames held; 0 = FF_CACHE_DEFAULT_BUDGET
+    // Frames in [playhead - pin_before, playhead + pin_after] are never evicted
+    // (they may push the cache over budget).
+    int    pin_before;
+    int    pin_after;
+} FFFrameCacheConfig;
+
+#define FF_CACHE_DEFAULT_BUDGET ((size_t)512 * 1024 * 1024)
+
+typedef struct FFFrameCacheStats {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t insertions;
+    uint64_t evictions;
+    uint64_t rejected;           // puts that did not fit even after eviction
+    size_t   bytes;              // held now
+    size_t   high_water_bytes;
+    size_t   budget_bytes;
+    size_t   cap_bytes;          // lower limit set by the memory governor (ffgovernor.h); SIZE_MAX = none
+    int      entries;
+    int      pinned;             // entries inside the pin window
+} FFFrameCacheStats;
+
+FFFrameCache* ff_cache_create(const FFFrameCacheConfig* cfg);   // NULL cfg = defaults
+// Releases every cached frame.
+void          ff_cache_destroy(FFFrameCache* c);
+
+// Frame `index` with one new reference, or NULL (counted as hit / miss).
+FFFrameRef*   ff_cache_get(FFFrameCache* c, int64_t index);
+// The cached frame closest to `index` (the earlier one on a tie) with one new
+// reference, or NULL if the cache is empty. Does not touch stats or recency.
+FFFrameRef*   ff_cache_get_nearest(FFFrameCache* c, int64_t index);
+// Whether `index` is cached, without touching stats or recency.
+int           ff_cache_contains(FFFrameCache* c, int64_t index);
+
+// Caches `f` (retained) under ff_frame_index(f), evicting least recently used
+// unpinned frames to stay within budget. Returns 1 if cached (or already
+// present), 0 if it does not fit, -1 on error.
+int           ff_cache_put(FFFrameCache* c, FFFrameRef* f);
+
+// Moves the pin window to `index`.
+void          ff_cache_set_playhead(FFFrameCache* c, int64_t index);
+
+// Changes the budget, evicting down to it.
+void          ff_cache_set_budget(FFFrameCache* c, size_t budget_bytes);
+// Evicts unpinned frames, oldest first, until at most `target_bytes` are held
+// (e.g. to hand buffers back to an exhausted pool). Returns bytes released.
+size_t        ff_cache_shrink(FFFrameCache* c, size_t target_bytes);
+void          ff_cache_clear(FFFrameCache* c);
+
+void          ff_cache_get_stats(FFFrameCache* c, FFFrameCacheStats* out);
+
+#ifdef __cplusplus
+}
+#endif
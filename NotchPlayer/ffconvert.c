@@ -0,0 +1,484 @@
+#include "ffconvert.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Fixed-point (16.16) YUV -> 8-bit RGB coefficients for one matrix/range/depth.
+typedef struct YuvCoeffs {
+    int32_t y_off, c_off;
+    int32_t cy, crv, cgu, cgv, cbu;
+    int     a_shift;
+} YuvCoeffs;
+
+static void yuv_coeffs(const FFSourceImage* s, YuvCoeffs* k) {
+    double kr, kgu, kgv, kbu;
+    if (s->matrix == FF_MATRIX_BT601) {
+        kr = 1.402;  kgu = 0.344136; kgv = 0.714136; kbu = 1.772;
+    } else {
+        kr = 1.5748; kgu = 0.1873;   kgv = 0.4681;   kbu = 1.8556;
+    }
+    int bits = s->bits;
+    double up = (double)(1 << (bits - 8));
+    double ys, cs;
+    if (s->full_range) {
+        ys = cs = 255.0 / ((1 << bits) - 1);
+        k->y_off = 0;
+    } else {
+        ys = 255.0 / (219.0 * up);
+        cs = 255.0 / (224.0 * up);
+        k->y_off = 16 << (bits - 8);
+    }
+    k->c_off = 1 << (bits - 1);
+    k->cy  = (int32_t)lrint(ys * 65536.0);
+    k->crv = (int32_t)lrint(kr  * cs * 65536.0);
+    k->cgu = (int32_t)lrint(kgu * cs * 65536.0);
+    k->cgv = (int32_t)lrint(kgv * cs * 65536.0);
+    k->cbu = (int32_t)lrint(kbu * cs * 65536.0);
+    k->a_shift = bits - 8;
+}
+
+static inline uint8_t clamp8(int32_t v) {
+    return (uint8_t)(v < 0 ? 0 : v > 255 ? 255 : v);
+}
+
+static inline void put_bgra(uint8_t* d, const YuvCoeffs* k, int32_t y, int32_t u, int32_t v, uint8_t a) {
+    int32_t yy = (y - k->y_off) * k->cy + (1 << 15);
+    u -= k->c_off;
+    v -= k->c_off;
+    d[0] = clamp8((yy + k->cbu * u) >> 16);
+    d[1] = clamp8((yy - k->cgu * u - k->cgv * v) >> 16);
+    d[2] = clamp8((yy + k->crv * v) >> 16);
+    d[3] = a;
+}
+
+int ff_region_resolve(const FFRegion* r, int src_w, int src_h, FFRegion* out) {
+    if (!r || !out) return -1;
+    if (r->src_w <= 0 || r->src_h <= 0 || r->src_x < 0 || r->src_y < 0 ||
+        r->src_x + r->src_w > src_w || r->src_y + r->src_h > src_h) return -1;
+    if ((unsigned)r->transform > FF_XFORM_FLIP_V) return -1;
+    *out = *r;
+    int rotated = r->transform == FF_XFORM_ROT90 || r->transform == FF_XFORM_ROT270;
+    if (out->dst_w <= 0) out->dst_w = rotated ? r->src_h : r->src_w;
+    if (out->dst_h <= 0) out->dst_h = rotated ? r->src_w : r->src_h;
+    return 0;
+}
+
+void ff_convert_region_rows(const FFSourceImage* src, const FFRegion* r,
+                            uint8_t* dst, int dst_stride, int y0, int y1) {
+    int rotated = r->transform == FF_XFORM_ROT90 || r->transform == FF_XFORM_ROT270;
+    int ow = rotated ? r->src_h : r->src_w;   // region size after orientation
+    int oh = rotated ? r->src_w : r->src_h;
+    // Output -> oriented coordinate steps in 32.32, nearest sample at or left of the centre.
+    uint64_t xstep = ((uint64_t)ow << 32) / (uint64_t)r->dst_w;
+    uint64_t ystep = ((uint64_t)oh << 32) / (uint64_t)r->dst_h;
+    int w1 = r->src_w - 1, h1 = r->src_h - 1;
+
+    YuvCoeffs k = { 0 };
+    if (src->layout == FF_SRC_YUV) yuv_coeffs(src, &k);
+
+    for (int oy = y0; oy < y1; ++oy) {
+        int v = (int)(((uint64_t)oy * ystep) >> 32);
+        // Source position of output column u: (sx0 + u*dxu, sy0 + u*dyu)
+        int sx0, sy0, dxu, dyu;
+        switch (r->transform) {
+        case FF_XFORM_ROT90:  sx0 = v;      dxu = 0;  sy0 = h1;     dyu = -1; break;
+        case FF_XFORM_ROT180: sx0 = w1;     dxu = -1; sy0 = h1 - v; dyu = 0;  break;
+        case FF_XFORM_ROT270: sx0 = w1 - v; dxu = 0;  sy0 = 0;      dyu = 1;  break;
+        case FF_XFORM_FLIP_H: sx0 = w1;     dxu = -1; sy0 = v;      dyu = 0;  break;
+        case FF_XFORM_FLIP_V: sx0 = 0;      dxu = 1;  sy0 = h1 - v; dyu = 0;  break;
+        default:              sx0 = 0;      dxu = 1;  sy0 = v;      dyu = 0;  break;
+        }
+        sx0 += r->src_x;
+        sy0 += r->src_y;
+
+        uint8_t* d = dst + (size_t)oy * dst_stride;
+        uint64_t acc = 0;
+
+        if (src->layout == FF_SRC_BGRA) {
+            for (int ox = 0; ox < r->dst_w; ++ox, acc += xstep, d += 4) {
+                int u = (int)(acc >> 32);
+                int sx = sx0 + u * dxu, sy = sy0 + u * dyu;
+                memcpy(d, src->data[0] + (size_t)sy * src->linesize[0] + (size_t)sx * 4, 4);
+            }
+            continue;
+        }
+
+        int cw = src->log2_chroma_w, ch = src->log2_chroma_h;
+        if (src->bits == 8) {
+            for (int ox = 0; ox < r->dst_w; ++ox, acc += xstep, d += 4) {
+                int u = (int)(acc >> 32);
+                int sx = sx0 + u * dxu, sy = sy0 + u * dyu;
+                int cx = sx >> cw, cy = sy >> ch;
+                int32_t Y = src->data[0][(size_t)sy * src->linesize[0] + sx];
+                int32_t U = src->data[1][(size_t)cy * src->linesize[1] + cx];
+                int32_t V = src->data[2][(size_t)cy * src->linesize[2] + cx];
+                uint8_t A = src->data[3] ? src->data[3][(size_t)sy * src->linesize[3] + sx] : 255;
+                put_bgra(d, &k, Y, U, V, A);
+            }
+        } else {
+            for (int ox = 0; ox < r->dst_w; ++ox, acc += xstep, d += 4) {
+                int u = (int)(acc >> 32);
+                int sx = sx0 + u * dxu, sy = sy0 + u * dyu;
+                int cx = sx >> cw, cy = sy >> ch;
+                int32_t Y = ((const uint16_t*)(src->data[0] + (size_t)sy * src->linesize[0]))[sx];
+                int32_t U = ((const uint16_t*)(src->data[1] + (size_t)cy * src->linesize[1]))[cx];
+                int32_t V = ((const uint16_t*)(src->data[2] + (size_t)cy * src->linesize[2]))[cx];
+                uint8_t A = 255;
+                if (src->data[3]) A = clamp8(((const uint16_t*)(src->data[3] + (size_t)sy * src->linesize[3]))[sx] >> k.a_shift);
+                put_bgra(d, &k, Y, U, V, A);
+            }
+        }
+    }
+}
+
+// ---- Parallel driver ----
+
+typedef struct ConvTask {
+    int region, y0, y1;
+} ConvTask;
+
+typedef struct ConvJob {
+    const FFSourceImage* src;
+    const FFRegion*      regions;
+    const FFSinkImage*   dst;
+    const ConvTask*      tasks;
+} ConvJob;
+
+static void conv_task(void* ctx, int i) {
+    const ConvJob* j = ctx;
+    const ConvTask* t = &j->tasks[i];
+    ff_convert_region_rows(j->src, &j->regions[t->region], j->dst[t->region].data[0],
+                           j->dst[t->region].linesize[0], t->y0, t->y1);
+}
+
+void ff_convert_regions(FFWorkers* w, const FFSourceImage* src,
+                        const FFRegion* regions, int count, const FFSinkImage* dst) {
+    if (count <= 0) return;
+
+    // Bands of roughly equal pixel counts, about four per thread, so big and
+    // small regions balance across cores.
+    uint64_t total = 0;
+    for (int i = 0; i < count; ++i) total += (uint64_t)regions[i].dst_w * regions[i].dst_h;
+    int threads = ff_workers_count(w);
+    uint64_t band_px = total / ((uint64_t)threads * 4) + 1;
+    if (band_px < 16384) band_px = 16384;
+
+    int ntasks = 0;
+    for (int i = 0; i < count; ++i) {
+        int rows = (int)(band_px / (uint64_t)regions[i].dst_w);
+        if (rows < 1) rows = 1;
+        ntasks += (regions[i].dst_h + rows - 1) / rows;
+    }
+    ConvTask* tasks = malloc((size_t)ntasks * sizeof(*tasks));
+    if (!tasks) {
+        for (int i = 0; i < count; ++i)
+            ff_convert_region_rows(src, &regions[i], dst[i].data[0], dst[i].linesize[0], 0, regions[i].dst_h);
+        return;
+    }
+    int n = 0;
+    for (int i = 0; i < count; ++i) {
+        int rows = (int)(band_px / (uint64_t)regions[i].dst_w);
+        if (rows < 1) rows = 1;
+        for (int y = 0; y < regions[i].dst_h; y += rows) {
+            tasks[n].region = i;
+            tasks[n].y0 = y;
+            tasks[n].y1 = y + rows < regions[i].dst_h ? y + rows : regions[i].dst_h;
+            ++n;
+        }
+    }
+
+    ConvJob job = { src, regions, dst, tasks };
+    ff_workers_run(w, n, conv_task, &job);
+    free(tasks);
+}
+
+// ---- Blending ----
+
+static size_t blend_row_bytes(int dst_w) {
+    return ((size_t)dst_w * 4 + 63) & ~(size_t)63;
+}
+
+size_t ff_convert_blend_scratch(int dst_w) {
+    return 2 * blend_row_bytes(dst_w);
+}
+
+// Four 32-bit lanes, and the narrower vectors they are loaded from: GCC and
+// Clang vector extensions, one SSE2 or NEON register each. The compilers do
+// not vectorize the per-pixel loops below on their own.
+typedef int32_t  i32x4 __attribute__((vector_size(16)));
+typedef uint32_t u32x4 __attribute__((vector_size(16)));
+typedef float    f32x4 __attribute__((vector_size(16)));
+typedef uint16_t u16x8 __attribute__((vector_size(16)));
+typedef uint16_t u16x4 __attribute__((vector_size(8)));
+typedef uint8_t  u8x8  __attribute__((vector_size(8)));
+typedef uint8_t  u8x4  __attribute__((vector_size(4)));
+
+static inline i32x4 clamp8v(i32x4 v) {
+    v &= (i32x4)(v > 0);
+    i32x4 hi = (i32x4)(v > 255);
+    return (v & ~hi) | (hi & 255);
+}
+
+// Samples x .. x+3 of a row, or for subsampled chroma those under them.
+static inline i32x4 load4(const uint8_t* row, int bits, int x, int shift) {
+    if (shift == 0 && bits == 8) {
+        u8x4 t;
+        memcpy(&t, row + x, sizeof(t));
+        return __builtin_convertvector(t, i32x4);
+    }
+    if (shift == 0) {
+        u16x4 t;
+        memcpy(&t, row + (size_t)x * 2, sizeof(t));
+        return __builtin_convertvector(t, i32x4);
+    }
+    i32x4 v;
+    for (int i = 0; i < 4; ++i) v[i] = bits == 8 ? row[(x + i) >> shift] : ((const uint16_t*)row)[(x + i) >> shift];
+    return v;
+}
+
+// Row `y` of an unscaled YUV picture, four pixels at a time. The vector part
+// works in float (SSE2 has no 32-bit integer multiply) with put_bgra's
+// coefficients, so results may differ from it by one in rounding.
+static void yuv_row(const FFSourceImage* s, const YuvCoeffs* k, int y, uint8_t* d, int w) {
+    int bits = s->bits, cw = s->log2_chroma_w, cy = y >> s->log2_chroma_h;
+    const uint8_t* Y = s->data[0] + (size_t)y * s->linesize[0];
+    const uint8_t* U = s->data[1] + (size_t)cy * s->linesize[1];
+    const uint8_t* V = s->data[2] + (size_t)cy * s->linesize[2];
+    const uint8_t* A = s->data[3] ? s->data[3] + (size_t)y * s->linesize[3] : NULL;
+    const float q = 1.0f / 65536;
+    float ky = k->cy * q, cbu = k->cbu * q, cgu = k->cgu * q, cgv = k->cgv * q, crv = k->crv * q;
+    float y_off = (float)k->y_off, c_off = (float)k->c_off;
+    int x = 0;
+    for (; x + 4 <= w; x += 4) {
+        f32x4 yy = (__builtin_convertvector(load4(Y, bits, x, 0), f32x4) - y_off) * ky + 0.5f;
+        f32x4 u = __builtin_convertvector(load4(U, bits, x, cw), f32x4) - c_off;
+        f32x4 v = __builtin_convertvector(load4(V, bits, x, cw), f32x4) - c_off;
+        u32x4 px = (u32x4)clamp8v(__builtin_convertvector(yy + cbu * u, i32x4)) |
+                   (u32x4)clamp8v(__builtin_convertvector(yy - cgu * u - cgv * v, i32x4)) << 8 |
+                   (u32x4)clamp8v(__builtin_convertvector(yy + crv * v, i32x4)) << 16;
+        if (A) px |= (u32x4)clamp8v(load4(A, bits, x, 0) >> k->a_shift) << 24;
+        else   px |= 0xff000000u;
+        memcpy(d + (size_t)x * 4, &px, sizeof(px));
+    }
+    for (; x < w; ++x) {
+        int cx = x >> cw;
+        if (bits == 8) {
+            put_bgra(d + (size_t)x * 4, k, Y[x], U[cx], V[cx], A ? A[x] : 255);
+        } else {
+            uint8_t a = A ? clamp8(((const uint16_t*)A)[x] >> k->a_shift) : 255;
+            put_bgra(d + (size_t)x * 4, k, ((const uint16_t*)Y)[x], ((const uint16_t*)U)[cx],
+                     ((const uint16_t*)V)[cx], a);
+        }
+    }
+}
+
+// Output row `oy` of `src` scaled to dst_w x dst_h: in place if the source is
+// BGRA at that size, else converted into `buf`.
+static const uint8_t* blend_source_row(const FFSourceImage* src, const YuvCoeffs* k,
+                                       int dst_w, int dst_h, int oy, uint8_t* buf) {
+    int same = src->width == dst_w && src->height == dst_h;
+    if (same && src->layout == FF_SRC_BGRA) return src->data[0] + (size_t)oy * src->linesize[0];
+    if (same) {
+        yuv_row(src, k, oy, buf, dst_w);
+        return buf;
+    }
+    FFRegion r = { 0, 0, src->width, src->height, dst_w, dst_h, FF_XFORM_NONE };
+    ff_convert_region_rows(src, &r, buf, 0, oy, oy + 1);
+    return buf;
+}
+
+// Both rows fully opaque: alpha-aware mixing then reduces to the plain one.
+static int rows_opaque(const uint8_t* a, const uint8_t* b, int w) {
+    u32x4 acc = (u32x4){ 0 } + 0xff000000u;
+    int x = 0;
+    for (; x + 4 <= w; x += 4) {
+        u32x4 pa, pb;
+        memcpy(&pa, a + (size_t)x * 4, sizeof(pa));
+        memcpy(&pb, b + (size_t)x * 4, sizeof(pb));
+        acc &= pa & pb;
+    }
+    uint32_t all = acc[0] & acc[1] & acc[2] & acc[3];
+    for (; x < w; ++x) all &= (uint32_t)(a[x * 4 + 3] & b[x * 4 + 3]) << 24;
+    return all == 0xff000000u;
+}
+
+// d = a + (b - a) * m / 256 for every byte, eight at a time in 16-bit lanes.
+static void mix_bytes(uint8_t* d, const uint8_t* a, const uint8_t* b, int n, int m) {
+    uint16_t im = (uint16_t)(256 - m), mm = (uint16_t)m;
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        u8x8 va, vb;
+        memcpy(&va, a + i, sizeof(va));
+        memcpy(&vb, b + i, sizeof(vb));
+        u16x8 r = (__builtin_convertvector(va, u16x8) * im + __builtin_convertvector(vb, u16x8) * mm + 128) >> 8;
+        u8x8 o = __builtin_convertvector(r, u8x8);
+        memcpy(d + i, &o, sizeof(o));
+    }
+    for (; i < n; ++i) d[i] = (uint8_t)((a[i] * im + b[i] * mm + 128) >> 8);
+}
+
+// Colour weighted by alpha x mix, four pixels at a time. The products stay
+// below 2^24, so the float path is exact up to the final rounding.
+static void mix_alpha(uint8_t* d, const uint8_t* a, const uint8_t* b, int w, int m) {
+    int im = 256 - m, x = 0;
+    float fim = (float)im, fm = (float)m;
+    for (; x + 4 <= w; x += 4) {
+        u32x4 pa, pb;
+        memcpy(&pa, a + (size_t)x * 4, sizeof(pa));
+        memcpy(&pb, b + (size_t)x * 4, sizeof(pb));
+        f32x4 wa = __builtin_convertvector((i32x4)(pa >> 24), f32x4) * fim;
+        f32x4 wb = __builtin_convertvector((i32x4)(pb >> 24), f32x4) * fm;
+        f32x4 sum = wa + wb;
+        f32x4 r = 1.0f / (sum + (f32x4)((i32x4)(sum == 0) & (i32x4)(f32x4){ 1, 1, 1, 1 }));   // 0/0 -> 0
+        u32x4 px = (u32x4)((__builtin_convertvector(sum, i32x4) + 128) >> 8) << 24;
+        for (int c = 0; c < 24; c += 8) {
+            f32x4 num = __builtin_convertvector((i32x4)(pa >> c & 255), f32x4) * wa +
+                         __builtin_convertvector((i32x4)(pb >> c & 255), f32x4) * wb;
+            px |= (u32x4)__builtin_convertvector(num * r + 0.5f, i32x4) << c;
+        }
+        memcpy(d + (size_t)x * 4, &px, sizeof(px));
+    }
+    for (; x < w; ++x) {
+        const uint8_t* pa = a + (size_t)x * 4;
+        const uint8_t* pb = b + (size_t)x * 4;
+        int32_t wa = pa[3] * im, wb = pb[3] * m, sum = wa + wb;
+        float r = 1.0f / (float)(sum ? sum : 1);
+        for (int c = 0; c < 3; ++c) d[x * 4 + c] = (uint8_t)((float)(pa[c] * wa + pb[c] * wb) * r + 0.5f);
+        d[x * 4 + 3] = (uint8_t)((sum + 128) >> 8);
+    }
+}
+
+void ff_convert_blend_rows(const FFSourceImage* a, const FFSourceImage* b, const FFBlend* blend,
+                           uint8_t* dst, int dst_stride, int dst_w, int dst_h, int y0, int y1,
+                           uint8_t* scratch) {
+    int m = blend->mix < 0 ? 0 : blend->mix > 256 ? 256 : blend->mix;
+    uint8_t* buf_a = scratch;
+    uint8_t* buf_b = scratch + blend_row_bytes(dst_w);
+    YuvCoeffs ka = { 0 }, kb = { 0 };
+    if (a->layout == FF_SRC_YUV) yuv_coeffs(a, &ka);
+    if (b->layout == FF_SRC_YUV) yuv_coeffs(b, &kb);
+    for (int oy = y0; oy < y1; ++oy) {
+        uint8_t* d = dst + (size_t)oy * dst_stride;
+        // A picture with no weight is not even converted; the other one is
+        // converted straight into the output.
+        if (m == 0 || m == 256) {
+            const FFSourceImage* only = m == 0 ? a : b;
+            const uint8_t* r = blend_source_row(only, m == 0 ? &ka : &kb, dst_w, dst_h, oy, d);
+            if (r != d) memcpy(d, r, (size_t)dst_w * 4);
+            continue;
+        }
+        const uint8_t* ra = blend_source_row(a, &ka, dst_w, dst_h, oy, buf_a);
+        const uint8_t* rb = blend_source_row(b, &kb, dst_w, dst_h, oy, buf_b);
+        if (blend->alpha_aware && !rows_opaque(ra, rb, dst_w)) {
+            mix_alpha(d, ra, rb, dst_w, m);
+        } else {
+            mix_bytes(d, ra, rb, dst_w * 4, m);
+        }
+    }
+}
+
+typedef struct BlendJob {
+    const FFSourceImage* a;
+    const FFSourceImage* b;
+    const FFBlend*       blend;
+    const FFSinkImage*   dst;
+    int                  rows;      // per task
+    uint8_t*             scratch;   // one slice per task
+    size_t               scratch_bytes;
+} BlendJob;
+
+static void blend_task(void* ctx, int i) {
+    const BlendJob* j = ctx;
+    int y0 = i * j->rows;
+    int y1 = y0 + j->rows < j->dst->height ? y0 + j->rows : j->dst->height;
+    ff_convert_blend_rows(j->a, j->b, j->blend, j->dst->data[0], j->dst->linesize[0],
+                          j->dst->width, j->dst->height, y0, y1, j->scratch + (size_t)i * j->scratch_bytes);
+}
+
+// Bands as for ff_convert_regions: about four per thread. Returns the band
+// count and the rows per band in *rows.
+static int blend_bands(FFWorkers* w, int dst_w, int dst_h, int* rows) {
+    uint64_t total = (uint64_t)dst_w * dst_h;
+    uint64_t band_px = total / ((uint64_t)ff_workers_count(w) * 4) + 1;
+    if (band_px < 16384) band_px = 16384;
+    *rows = (int)(band_px / (uint64_t)dst_w);
+    if (*rows < 1) *rows = 1;
+    return (dst_h + *rows - 1) / *rows;
+}
+
+size_t ff_convert_blend_frame_scratch(FFWorkers* w, int dst_w, int dst_h) {
+    if (dst_w <= 0 || dst_h <= 0) return 0;
+    int rows;
+    return (size_t)blend_bands(w, dst_w, dst_h, &rows) * ff_convert_blend_scratch(dst_w);
+}
+
+int ff_convert_blend(FFWorkers* w, const FFSourceImage* a, const FFSourceImage* b,
+                     const FFBlend* blend, const FFSinkImage* dst, uint8_t* scratch) {
+    if (dst->width <= 0 || dst->height <= 0) return 0;
+    int rows;
+    int ntasks = blend_bands(w, dst->width, dst->height, &rows);
+
+    BlendJob job = { a, b, blend, dst, rows, scratch, ff_convert_blend_scratch(dst->width) };
+    if (!scratch) {
+        job.scratch = malloc((size_t)ntasks * job.scratch_bytes);
+        if (!job.scratch) return -1;
+    }
+    ff_workers_run(w, ntasks, blend_task, &job);
+    if (!scratch) free(job.scratch);
+    return 0;
+}
+
+// ---- Point sampling ----
+
+#define POINT_BLOCK 256
+
+void ff_convert_points(const FFSourceImage* src, const int32_t* xs, const int32_t* ys,
+                       int count, uint8_t* rgb) {
+    if (src->layout == FF_SRC_BGRA) {
+        for (int i = 0; i < count; ++i) {
+            const uint8_t* s = src->data[0] + (size_t)ys[i] * src->linesize[0] + (size_t)xs[i] * 4;
+            rgb[i * 3 + 0] = s[2];
+            rgb[i * 3 + 1] = s[1];
+            rgb[i * 3 + 2] = s[0];
+        }
+        return;
+    }
+
+    YuvCoeffs k = { 0 };
+    yuv_coeffs(src, &k);
+    int cw = src->log2_chroma_w, ch = src->log2_chroma_h;
+    int32_t Y[POINT_BLOCK], U[POINT_BLOCK], V[POINT_BLOCK];
+
+    for (int b = 0; b < count; b += POINT_BLOCK) {
+        int n = count - b < POINT_BLOCK ? count - b : POINT_BLOCK;
+        const int32_t* bx = xs + b;
+        const int32_t* by = ys + b;
+
+        // Gather into structure-of-arrays blocks...
+        if (src->bits == 8) {
+            for (int i = 0; i < n; ++i) {
+                int cx = bx[i] >> cw, cy = by[i] >> ch;
+                Y[i] = src->data[0][(size_t)by[i] * src->linesize[0] + bx[i]];
+                U[i] = src->data[1][(size_t)cy * src->linesize[1] + cx];
+                V[i] = src->data[2][(size_t)cy * src->linesize[2] + cx];
+            }
+        } else {
+            for (int i = 0; i < n; ++i) {
+                int cx = bx[i] >> cw, cy = by[i] >> ch;
+                Y[i] = ((const uint16_t*)(src->data[0] + (size_t)by[i] * src->linesize[0]))[bx[i]];
+                U[i] = ((const uint16_t*)(src->data[1] + (size_t)cy * src->linesize[1]))[cx];
+                V[i] = ((const uint16_t*)(src->data[2] + (size_t)cy * src->linesize[2]))[cx];
+            }
+        }
+
+        // ...then convert with a branch-free loop the compiler vectorizes.
+        uint8_t* d = rgb + (size_t)b * 3;
+        for (int i = 0; i < n; ++i) {
+            int32_t yy = (Y[i] - k.y_off) * k.cy + (1 << 15);
+            int32_t u = U[i] - k.c_off, v = V[i] - k.c_off;
+            d[i * 3 + 0] = clamp8((yy + k.crv * v) >> 16);
+            d[i * 3 + 1] = clamp8((yy - k.cgu * u - k.cgv * v) >> 16);
+            d[i * 3 + 2] = clamp8((yy + k.cbu * u) >> 16);
+        }
+    }
+}
@@ -0,0 +1,110 @@
+#pragma once
+#include <stdint.h>
+#include "ffframe.h"
+#include "ffsink.h"
+#include "ffworkers.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Conversion of decoded pictures to BGRA output, optionally cut into regions.
+// Each output pixel is computed straight from the decoded planes (point
+// sampling), so every region is produced in a single pass without an
+// intermediate full-frame BGRA copy.
+
+typedef enum FFColorMatrix {
+    FF_MATRIX_BT709 = 0,
+    FF_MATRIX_BT601,
+} FFColorMatrix;
+
+typedef enum FFSourceLayout {
+    FF_SRC_YUV = 0,   // planar Y, U, V (+ optional A), 8..16 bits per sample
+    FF_SRC_BGRA,      // one packed 8-bit BGRA plane
+} FFSourceLayout;
+
+// A decoded picture as the converter reads it.
+typedef struct FFSourceImage {
+    FFSourceLayout layout;
+    const uint8_t* data[4];       // Y, U, V, A (A may be NULL) / BGRA in data[0]
+    int            linesize[4];
+    int            width, height;
+    int            bits;          // YUV: 8, or 9..16 with native-endian uint16 samples
+    int            log2_chroma_w; // YUV: 0 = 4:4:4, 1 = 4:2:2 / 4:2:0
+    int            log2_chroma_h;
+    FFColorMatrix  matrix;
+    int            full_range;    // 0 = limited (16..235 at 8 bits)
+} FFSourceImage;
+
+typedef enum FFRegionTransform {
+    FF_XFORM_NONE = 0,
+    FF_XFORM_ROT90,     // clockwise
+    FF_XFORM_ROT180,
+    FF_XFORM_ROT270,
+    FF_XFORM_FLIP_H,    // mirror left/right
+    FF_XFORM_FLIP_V,    // mirror top/bottom
+} FFRegionTransform;
+
+// One output region: a source rectangle, how to orient it and the size to
+// deliver it at. dst_w / dst_h of 0 mean "oriented source size".
+typedef struct FFRegion {
+    int               src_x, src_y, src_w, src_h;
+    int               dst_w, dst_h;
+    FFRegionTransform transform;
+} FFRegion;
+
+// Checks `r` against a src_w x src_h picture and fills in default destination
+// sizes. Returns 0, or -1 if the rectangle is empty or out of bounds.
+int  ff_region_resolve(const FFRegion* r, int src_w, int src_h, FFRegion* out);
+
+// Converts output rows [y0, y1) of region `r` (already resolved) into `dst`.
+void ff_convert_region_rows(const FFSourceImage* src, const FFRegion* r,
+                            uint8_t* dst, int dst_stride, int y0, int y1);
+
+// Converts every region into its destination image (dst[i] for regions[i],
+// sized dst_w x dst_h), splitting the work in row bands across `w` (NULL = caller only).
+void ff_convert_regions(FFWorkers* w, const FFSourceImage* src,
+                        const FFRegion* regions, int count, const FFSinkImage* dst);
+
+// Two pictures mixed into one output while they are converted. Each output row
+// is converted from both sources into small row buffers and mixed from there
+// while still in cache, so the frame is written once and neither source is
+// converted to a full-frame copy first. Sources already at the output size
+// take a vectorized path: BGRA is read in place, YUV converted four pixels at
+// a time (rounding may differ by one from the region path).
+typedef struct FFBlend {
+    int mix;           // weight of b in 1/256: 0 = all a, 256 = all b
+    // Nonzero: colour is weighted by each source's alpha (straight alpha in
+    // and out), so transparent pixels of one picture do not darken the other.
+    // Zero: every channel, alpha included, is mixed independently.
+    int alpha_aware;
+} FFBlend;
+
+// Bytes of scratch ff_convert_blend_rows needs for a dst_w wide output.
+size_t ff_convert_blend_scratch(int dst_w);
+
+// Converts output rows [y0, y1) of `a` and `b` (either layout, any size; both
+// are point-sampled to dst_w x dst_h) and mixes them into `dst`.
+void ff_convert_blend_rows(const FFSourceImage* a, const FFSourceImage* b, const FFBlend* blend,
+                           uint8_t* dst, int dst_stride, int dst_w, int dst_h, int y0, int y1,
+                           uint8_t* scratch);
+
+// Bytes of scratch ff_convert_blend needs for a dst_w x dst_h output on `w`.
+size_t ff_convert_blend_frame_scratch(FFWorkers* w, int dst_w, int dst_h);
+
+// The whole of `dst` (BGRA), split in row bands across `w` (NULL = caller only).
+// `scratch` holds ff_convert_blend_frame_scratch bytes, kept by callers that
+// mix every frame; NULL allocates it for this call. Returns 0, or -1 if that
+// allocation fails.
+int  ff_convert_blend(FFWorkers* w, const FFSourceImage* a, const FFSourceImage* b,
+                      const FFBlend* blend, const FFSinkImage* dst, uint8_t* scratch);
+
+// Samples `count` individual pixels (xs[i], ys[i], inside the picture) into
+// packed RGB triples, with the same colour conversion as the region path.
+// Used by pixel mapping, where only a few thousand points of a frame are needed.
+void ff_convert_points(const FFSourceImage* src, const int32_t* xs, const int32_t* ys,
+                       int count, uint8_t* rgb);
+
+#ifdef __cplusplus
+}
+#endif
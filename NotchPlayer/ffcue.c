@@ -0,0 +1,351 @@
+#include "ffcue.h"
+#include "ffutil.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+enum { CUE_IDLE = 0, CUE_ARMING, CUE_ARMED, CUE_FAILED };
+
+typedef struct Cue {
+    char*      path;
+    FFPreroll* pr;             // while CUE_ARMED
+    int        state;
+} Cue;
+
+struct FFCueStack {
+    FFCueConfig     cfg;
+    int             depth;         // cues armed ahead of the standby one, 0 = none
+    pthread_mutex_t lock;
+    pthread_cond_t  cv;            // cues, GO, arming done or retired clip
+    pthread_t       thread;
+    int             stopping;
+
+    Cue*            cues;
+    int             ncues, cap;
+    int             standby;       // fired by the next GO
+    int             pending;       // fired, not yet live; -1 if none
+    int64_t         go_ns;         // when it was fired
+    int             go_armed;      // it was armed then
+    atomic_int      go_req;        // pending is set: checked by every ff_cue_next
+    int             live;
+    FFPrerollQueue  retired;       // finished cues for the arming thread to close
+
+    // Output thread only.
+    FFPreroll*      cur;
+    FFFrameRef*     last;          // held when the live cue ends
+    int             cur_cue;
+    int64_t         frame;
+
+    FFCueStats      stats;
+    uint64_t        triggers;      // samples in trigger_ns_avg
+};
+
+static int wanted(const FFCueStack* cs, int i) {
+    return i == cs->pending || (i >= cs->standby && i < cs->standby + cs->depth);
+}
+
+// Next job for the arming thread, with the lock held: a cue to arm (the
+// fired one first, then in order) or, as *disarm, one no longer wanted.
+// Returns the cue, or -1 if there is nothing to do.
+static int pick_work(const FFCueStack* cs, int* disarm) {
+    *disarm = 0;
+    if (cs->pending >= 0 && cs->cues[cs->pending].state == CUE_IDLE) return cs->pending;
+    for (int i = cs->standby; i < cs->standby + cs->depth && i < cs->ncues; ++i)
+        if (cs->cues[i].state == CUE_IDLE) return i;
+    for (int i = 0; i < cs->ncues; ++i) {
+        if (cs->cues[i].state == CUE_ARMED && !wanted(cs, i)) {
+            *disarm = 1;
+            return i;
+        }
+    }
+    return -1;
+}
+
+static void* arm_main(void* arg) {
+    FFCueStack* cs = arg;
+    pthread_mutex_lock(&cs->lock);
+    for (;;) {
+        int cue = -1, disarm = 0;
+        while (!cs->stopping && !cs->retired.count && (cue = pick_work(cs, &disarm)) < 0)
+            ff_cond_wait_ns(&cs->cv, &cs->lock, -1);
+        if (cs->stopping) break;
+        if (cs->retired.count) {
+            FFPreroll* r = ff_preroll_queue_pop(&cs->retired);
+            pthread_mutex_unlock(&cs->lock);
+            ff_preroll_close(r);
+            pthread_mutex_lock(&cs->lock);
+            continue;
+        }
+        Cue* c = &cs->cues[cue];
+        if (disarm) {
+            FFPreroll* pr = c->pr;
+            c->pr    = NULL;
+            c->state = CUE_IDLE;
+            pthread_mutex_unlock(&cs->lock);
+            ff_preroll_close(pr);
+            pthread_mutex_lock(&cs->lock);
+            continue;
+        }
+
+        const char* path = c->path;   // strings live until destroy
+        c->state = CUE_ARMING;
+        pthread_mutex_unlock(&cs->lock);
+        FFPreroll* pr = ff_preroll_open(path, &cs->cfg.preroll);
+        pthread_mutex_lock(&cs->lock);
+        c = &cs->cues[cue];           // the array may have grown
+        c->pr    = pr;
+        c->state = pr ? CUE_ARMED : CUE_FAILED;
+        if (pr) cs->stats.arm_ns_last = ff_preroll_open_ns(pr);
+        pthread_cond_broadcast(&cs->cv);
+    }
+    pthread_mutex_unlock(&cs->lock);
+    return NULL;
+}
+
+FFCueStack* ff_cue_create(const FFCueConfig* cfg) {
+    FFCueStack* cs = calloc(1, sizeof(*cs));
+    if (!cs) return NULL;
+    if (cfg) cs->cfg = *cfg;
+    cs->depth   = cs->cfg.armed == 0 ? FF_CUE_DEFAULT_ARMED : cs->cfg.armed < 0 ? 0 : cs->cfg.armed;
+    cs->pending = -1;
+    cs->live    = -1;
+    cs->cur_cue = -1;
+    atomic_init(&cs->go_req, 0);
+    pthread_mutex_init(&cs->lock, NULL);
+    ff_cond_init(&cs->cv);
+    if (pthread_create(&cs->thread, NULL, arm_main, cs) != 0) {
+        pthread_mutex_destroy(&cs->lock);
+        pthread_cond_destroy(&cs->cv);
+        free(cs);
+        return NULL;
+    }
+    return cs;
+}
+
+void ff_cue_destroy(FFCueStack* cs) {
+    if (!cs) return;
+    pthread_mutex_lock(&cs->lock);
+    cs->stopping = 1;
+    pthread_cond_broadcast(&cs->cv);
+    pthread_mutex_unlock(&cs->lock);
+    pthread_join(cs->thread, NULL);
+
+    ff_frame_release(cs->last);
+    ff_preroll_close(cs->cur);
+    ff_preroll_queue_clear(&cs->retired);
+    for (int i = 0; i < cs->ncues; ++i) {
+        ff_preroll_close(cs->cues[i].pr);
+        free(cs->cues[i].path);
+    }
+    free(cs->cues);
+    pthread_mutex_destroy(&cs->lock);
+    pthread_cond_destroy(&cs->cv);
+    free(cs);
+}
+
+int ff_cue_add(FFCueStack* cs, const char* path) {
+    if (!cs || !path) return -1;
+    char* copy = strdup(path);
+    if (!copy) return -1;
+    pthread_mutex_lock(&cs->lock);
+    if (cs->ncues == cs->cap) {
+        int ncap = cs->cap ? cs->cap * 2 : 16;
+        Cue* nc = realloc(cs->cues, (size_t)ncap * sizeof(*nc));
+        if (!nc) {
+            pthread_mutex_unlock(&cs->lock);
+            free(copy);
+            return -1;
+        }
+        cs->cues = nc;
+        cs->cap  = ncap;
+    }
+    int cue = cs->ncues++;
+    cs->cues[cue] = (Cue){ copy, NULL, CUE_IDLE };
+    pthread_cond_broadcast(&cs->cv);   // may be one to arm
+    pthread_mutex_unlock(&cs->lock);
+    return cue;
+}
+
+int ff_cue_count(FFCueStack* cs) {
+    if (!cs) return 0;
+    pthread_mutex_lock(&cs->lock);
+    int n = cs->ncues;
+    pthread_mutex_unlock(&cs->lock);
+    return n;
+}
+
+// Called with the lock held.
+static void fire(FFCueStack* cs, int cue, int64_t now) {
+    if (cs->pending >= 0) cs->stats.superseded++;
+    // A cue that failed to arm gets another try: the clip may be there now.
+    if (cs->cues[cue].state == CUE_FAILED) cs->cues[cue].state = CUE_IDLE;
+    cs->pending  = cue;
+    cs->go_ns    = now;
+    cs->go_armed = cs->cues[cue].state == CUE_ARMED;
+    cs->standby  = cue + 1;
+    atomic_store(&cs->go_req, 1);
+    pthread_cond_broadcast(&cs->cv);
+}
+
+int ff_cue_go(FFCueStack* cs) {
+    if (!cs) return -1;
+    int64_t now = ff_now_ns();
+    pthread_mutex_lock(&cs->lock);
+    int cue = cs->standby < cs->ncues ? cs->standby : -1;
+    if (cue >= 0) fire(cs, cue, now);
+    pthread_mutex_unlock(&cs->lock);
+    return cue;
+}
+
+int ff_cue_go_to(FFCueStack* cs, int cue) {
+    if (!cs) return -1;
+    int64_t now = ff_now_ns();
+    pthread_mutex_lock(&cs->lock);
+    int ok = cue >= 0 && cue < cs->ncues;
+    if (ok) fire(cs, cue, now);
+    pthread_mutex_unlock(&cs->lock);
+    return ok ? 0 : -1;
+}
+
+// Hands a finished cue to the arming thread to close. Cues retired while it
+// is busy arming queue up, so closing never blocks the output thread.
+static void retire(FFCueStack* cs, FFPreroll* pr) {
+    if (!pr) return;
+    pthread_mutex_lock(&cs->lock);
+    int r = ff_preroll_queue_push(&cs->retired, pr);
+    if (r == 0) pthread_cond_broadcast(&cs->cv);
+    pthread_mutex_unlock(&cs->lock);
+    if (r < 0) ff_preroll_close(pr);   // out of memory: close it here after all
+}
+
+// Takes the fired cue if it is armed. Returns 1 if it went live.
+static int swap(FFCueStack* cs, int64_t* go_ns) {
+    pthread_mutex_lock(&cs->lock);
+    int cue = cs->pending;
+    Cue* c  = cue >= 0 ? &cs->cues[cue] : NULL;
+    if (c && c->state != CUE_ARMED && c->state != CUE_FAILED) {
+        pthread_mutex_unlock(&cs->lock);
+        return 0;   // still being armed: the live cue plays on
+    }
+    cs->pending = -1;
+    atomic_store(&cs->go_req, 0);
+    if (!c || c->state == CUE_FAILED) {
+        if (c) cs->stats.failed++;
+        pthread_mutex_unlock(&cs->lock);
+        return 0;
+    }
+    FFPreroll* pr = c->pr;
+    c->pr    = NULL;
+    c->state = CUE_IDLE;
+    cs->live = cue;
+    *go_ns   = cs->go_ns;
+    cs->stats.gos++;
+    if (cs->go_armed) cs->stats.armed++;
+    else cs->stats.unarmed++;
+    pthread_cond_broadcast(&cs->cv);   // it may be wanted armed again
+    pthread_mutex_unlock(&cs->lock);
+
+    retire(cs, cs->cur);
+    cs->cur     = pr;
+    cs->cur_cue = cue;
+    cs->frame   = 0;
+    ff_frame_release(cs->last);
+    cs->last = NULL;
+    return 1;
+}
+
+int ff_cue_next(FFCueStack* cs, FFFrameRef** out, FFCuePos* pos) {
+    if (out) *out = NULL;
+    if (!cs || !out) return -1;
+    int64_t t0 = 0, go_ns = 0;
+    int swapped = 0;
+    if (atomic_load(&cs->go_req)) {
+        t0 = ff_now_ns();
+        swapped = swap(cs, &go_ns);
+    }
+    if (!cs->cur) return 0;
+
+    FFFrameRef* f = NULL;
+    int r = ff_preroll_next(cs->cur, &f);
+    if (r == 0 && cs->cfg.loop && ff_preroll_seek(cs->cur, 0) >= 0) r = ff_preroll_next(cs->cur, &f);
+    if (r < 0) return r;
+    if (r == 0) {
+        if (!cs->last) return 0;
+        *out = ff_frame_retain(cs->last);
+        if (pos) *pos = (FFCuePos){ cs->cur_cue, cs->frame++, 1 };
+        return 1;
+    }
+    ff_frame_release(cs->last);
+    cs->last = ff_frame_retain(f);
+    if (pos) *pos = (FFCuePos){ cs->cur_cue, cs->frame, 0 };
+    cs->frame++;
+
+    if (swapped) {
+        int64_t now = ff_now_ns();
+        int64_t dt  = now - go_ns;
+        pthread_mutex_lock(&cs->lock);
+        cs->stats.trigger_ns_last = dt;
+        if (dt > cs->stats.trigger_ns_max) cs->stats.trigger_ns_max = dt;
+        cs->triggers++;
+        cs->stats.trigger_ns_avg += (dt - cs->stats.trigger_ns_avg) / (double)cs->triggers;
+        if (now - t0 > cs->stats.swap_ns_max) cs->stats.swap_ns_max = now - t0;
+        pthread_mutex_unlock(&cs->lock);
+    }
+    *out = f;
+    return 1;
+}
+
+int ff_cue_live(FFCueStack* cs) {
+    if (!cs) return -1;
+    pthread_mutex_lock(&cs->lock);
+    int cue = cs->live;
+    pthread_mutex_unlock(&cs->lock);
+    return cue;
+}
+
+int ff_cue_standby(FFCueStack* cs) {
+    if (!cs) return -1;
+    pthread_mutex_lock(&cs->lock);
+    int cue = cs->standby < cs->ncues ? cs->standby : -1;
+    pthread_mutex_unlock(&cs->lock);
+    return cue;
+}
+
+int ff_cue_is_armed(FFCueStack* cs, int cue) {
+    if (!cs) return 0;
+    pthread_mutex_lock(&cs->lock);
+    int armed = cue >= 0 && cue < cs->ncues && cs->cues[cue].state == CUE_ARMED;
+    pthread_mutex_unlock(&cs->lock);
+    return armed;
+}
+
+// Called with the lock held.
+static int all_armed(const FFCueStack* cs) {
+    for (int i = 0; i < cs->ncues; ++i) {
+        int s = cs->cues[i].state;
+        if (wanted(cs, i) && (s == CUE_IDLE || s == CUE_ARMING)) return 0;
+    }
+    return 1;
+}
+
+int ff_cue_wait_armed(FFCueStack* cs, int timeout_ms) {
+    if (!cs) return 0;
+    int64_t deadline = ff_now_ns() + (int64_t)timeout_ms * 1000000;
+    pthread_mutex_lock(&cs->lock);
+    int ok;
+    while (!(ok = all_armed(cs)) && timeout_ms != 0) {
+        int64_t left = timeout_ms < 0 ? -1 : deadline - ff_now_ns();
+        if (timeout_ms > 0 && left <= 0) break;
+        ff_cond_wait_ns(&cs->cv, &cs->lock, left);
+    }
+    pthread_mutex_unlock(&cs->lock);
+    return ok;
+}
+
+void ff_cue_get_stats(FFCueStack* cs, FFCueStats* out) {
+    if (!cs || !out) return;
+    pthread_mutex_lock(&cs->lock);
+    *out = cs->stats;
+    pthread_mutex_unlock(&cs->lock);
+}
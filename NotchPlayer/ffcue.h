@@ -0,0 +1,83 @@
+#pragma once
+#include <stdint.h>
+#include "ffframe.h"
+#include "ffpreroll.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Cue stack for live playback. Cues are clips fired in order by GO (or out of
+// order by ff_cue_go_to). An arming thread keeps the next few cues armed:
+// opened, probed, prepared (the prepare hook is where pack-cache readahead or
+// a shared sink goes) and their first frames decoded into the player's pooled
+// buffers. GO only marks the cue; the output thread swaps to it at its next
+// ff_cue_next, so output changes whole frames at once and the new cue's first
+// frame is out on the next output frame. A cue fired before it is armed is
+// armed first, while the previous cue stays on screen. A cue that failed to
+// arm is tried again each time it is fired.
+typedef struct FFCueStack FFCueStack;
+
+#define FF_CUE_DEFAULT_ARMED 2
+
+typedef struct FFCueConfig {
+    FFPrerollConfig preroll;   // how cues are armed
+    // Upcoming cues kept armed; 0 = FF_CUE_DEFAULT_ARMED, <0 = none: cues are
+    // opened only when fired (for comparison).
+    int             armed;
+    // A cue that reaches its end starts over; otherwise its last frame holds.
+    int             loop;
+} FFCueConfig;
+
+// Where a frame comes from.
+typedef struct FFCuePos {
+    int     cue;
+    int64_t frame;             // frames since the cue went live
+    int     held;              // the cue has ended and this is its last frame again
+} FFCuePos;
+
+typedef struct FFCueStats {
+    uint64_t gos;              // GOs that went live
+    uint64_t armed;            // ...with the cue armed at the trigger
+    uint64_t unarmed;          // ...that had to wait for the cue to be armed
+    uint64_t failed;           // fired cues that could not be armed; their GO is dropped
+    uint64_t superseded;       // GOs replaced by a newer one before going live
+    // Trigger to first frame: from the GO call to ff_cue_next handing out the
+    // cue's first frame. Includes the wait for the output thread's next frame.
+    int64_t  trigger_ns_last;
+    int64_t  trigger_ns_max;
+    double   trigger_ns_avg;
+    int64_t  swap_ns_max;      // time ff_cue_next spent on a swap
+    int64_t  arm_ns_last;      // time arming the last cue took
+} FFCueStats;
+
+FFCueStack* ff_cue_create(const FFCueConfig* cfg);
+void        ff_cue_destroy(FFCueStack* cs);
+
+// Adds a cue at the end. Returns its number, or -1.
+int         ff_cue_add(FFCueStack* cs, const char* path);
+int         ff_cue_count(FFCueStack* cs);
+
+// Fires the standby cue (the one after the last fired). Safe from any thread.
+// Returns the cue number, or -1 if there is none.
+int         ff_cue_go(FFCueStack* cs);
+// Fires cue `cue`; the standby cue becomes the one after it. Returns 0 or -1.
+int         ff_cue_go_to(FFCueStack* cs, int cue);
+
+// The frame to output now, one reference: the live cue's next frame. Call from
+// the output thread once per output frame. Returns 1, 0 while no cue has gone
+// live, or <0 on error.
+int         ff_cue_next(FFCueStack* cs, FFFrameRef** out, FFCuePos* pos);
+
+int         ff_cue_live(FFCueStack* cs);      // -1 before the first GO goes live
+int         ff_cue_standby(FFCueStack* cs);   // -1 after the last cue
+int         ff_cue_is_armed(FFCueStack* cs, int cue);
+// Waits until the cues that should be armed are, up to timeout_ms (<0 =
+// forever). Returns 1 if they are, 0 on timeout.
+int         ff_cue_wait_armed(FFCueStack* cs, int timeout_ms);
+
+void        ff_cue_get_stats(FFCueStack* cs, FFCueStats* out);
+
+#ifdef __cplusplus
+}
+#endif
@@ -1,11 +1,31 @@
 #include "ffdecode.h"
+#include "ffsink.h"
+#include "ffframe.h"
+#include "ffpool.h"
+#include "ffmem.h"
+#include "ffshm.h"
+#include "ffcache.h"
+#include "ffdiskcache.h"
+#include "ffgovernor.h"
+#include "ffpackcache.h"
+#include "ffloop.h"
+#include "ffproxy.h"
+#include "ffconvert.h"
+#include "ffpixmap.h"
+#include "ffworkers.h"
+#include <pthread.h>
+#include <stdatomic.h>
 #include <stdlib.h>
-#include <limits.h>
+#ifdef __APPLE__
 #include <CoreVideo/CoreVideo.h>
+#endif
+#include <limits.h>
 #include <libavformat/avformat.h>
 #include <libavcodec/avcodec.h>
 #include <libswscale/swscale.h>
 #include <libavutil/imgutils.h>
+#include <libavutil/buffer.h>
+#include <libavutil/pixdesc.h>
 
 
 
@@ -273,6 +293,7 @@ double ff_precise_duration(const char* path) {
 
 struct FFPlayer {
     AVFormatContext* fmt;
+    size_t           demux_bytes;   // counted in g_io_bytes
     AVCodecContext*  vdec;
     int              vstream;
     AVFrame*         frame;
@@ -280,8 +301,198 @@ struct FFPlayer {
     struct SwsContext* sws;
     int out_w, out_h;
     int at_eof;   // track EOF state
+    FFFrameSink* sink;   // owned; where converted frames are written
+    int64_t next_index;  // index stamped on the next output frame
+    int frame_pending;   // p->frame holds a decoded frame not yet converted
+
+    // Decoder plane memory, allocated per FF_MEM_* flags when given
+    unsigned      mem_flags;
+    AVBufferPool* dec_pool[4];
+    int           dec_w, dec_h, dec_fmt;
+
+    FFFaultStats  faults;
+    FFShmRing*    shm_ring;   // set by ff_set_shm_output
+
+    // Frame numbering / random access
+    AVRational    frame_rate;   // avg_frame_rate, else r_frame_rate
+    int64_t       start_ts;     // stream start_time in time_base (0 if unknown)
+    int64_t       skip_until;   // frames below this index are dropped after a seek
+
+    // Region output (ff_set_regions)
+    int           sink_is_default;   // sink was created by the player, not the caller
+    FFRegion*     regions;           // resolved against out_w x out_h
+    int           nregions;
+    FFWorkers*    workers;
+    uint8_t*      scratch;           // full-frame BGRA for sources ffconvert can't read
+    int           scratch_stride;
+
+    // Decoded-frame cache (ff_set_frame_cache). Cache hits advance next_index
+    // without touching the decoder; dec_pos is then where the decoder stands.
+    FFFrameCache* cache;
+    int           dec_behind;
+    int64_t       dec_pos;
+    int           cache_buffers;   // output buffers the default sink grew by for it
+
+    // Compressed tier (ff_set_pack_cache), after the frame cache
+    FFPackCache*  pack;
+    int           pack_buffers;
+
+    // Seamless looping (ff_set_loop): ff_next_frame_ref goes through it
+    FFLoop*       loop;
+    int           loop_buffers;
+    int           loop_range;       // p->loop covers a ff_set_loop_range region
+
+    // Loop region too large to keep decoded (ff_set_loop_range): its
+    // compressed packets stay in memory and the decoder reads them instead of
+    // the file while it is inside the region.
+    AVPacket**    region_pkts;
+    int           region_npkts;
+    int           region_pos;       // next packet to decode
+    int           region_reading;
+    int64_t       region_in, region_out;
+    size_t        region_bytes;
+
+    // Cancellation (ff_set_interrupt): polled between decoded frames and by
+    // blocking demuxer I/O
+    int         (*interrupt)(void* opaque);
+    void*         interrupt_opaque;
+
+    // Persistent cache (ff_set_disk_cache), after the frame cache
+    char*         path;
+    FFDiskCache*  disk;
+    FFDiskCacheKey disk_key;
+
+    // Low-resolution proxy (ff_set_proxy), ahead of the caches while in use
+    FFProxy*      proxy;
+    int           use_proxy;
 };
 
+// ---- Memory governor ----
+
+// Decoder planes, and demuxer buffers plus resident packets, of every player,
+// as two governor clients (ffgovernor.h) registered by the first ff_open.
+static atomic_size_t g_dec_bytes, g_io_bytes;
+static pthread_once_t g_gov_once = PTHREAD_ONCE_INIT;
+
+static size_t gov_counter(void* opaque, size_t* wanted) {
+    return atomic_load((atomic_size_t*)opaque);
+}
+
+static void gov_register(void) {
+    FFGovClientConfig dec = { .name = "decoder planes", .kind = FF_GOV_DECODER,
+                              .opaque = &g_dec_bytes, .usage = gov_counter };
+    FFGovClientConfig io = { .name = "demuxer and packets", .kind = FF_GOV_IO,
+                             .opaque = &g_io_bytes, .usage = gov_counter };
+    ff_governor_register(&dec);
+    ff_governor_register(&io);
+}
+
+// ---- Decoder plane allocation (huge pages / pre-faulted / locked) ----
+
+static void mem_block_free(void* opaque, uint8_t* data) {
+    FFMemBlock* blk = opaque;
+    atomic_fetch_sub(&g_dec_bytes, blk->size);
+    ff_mem_free(blk);
+    av_free(blk);
+}
+
+static AVBufferRef* mem_pool_alloc(void* opaque, size_t size) {
+    unsigned flags = (unsigned)(uintptr_t)opaque;
+    FFMemBlock* blk = av_malloc(sizeof(*blk));
+    if (!blk) return NULL;
+    if (ff_mem_alloc(blk, size, flags) < 0) {
+        av_free(blk);
+        return NULL;
+    }
+    atomic_fetch_add(&g_dec_bytes, blk->size);
+    AVBufferRef* ref = av_buffer_create(blk->ptr, size, mem_block_free, blk, 0);
+    if (!ref) mem_block_free(blk, NULL);
+    else ff_governor_notify();
+    return ref;
+}
+
+static void dec_pools_free(FFPlayer* p) {
+    for (int i = 0; i < 4; ++i) {
+        if (p->dec_pool[i]) av_buffer_pool_uninit(&p->dec_pool[i]);
+    }
+}
+
+// Plane layout for a decoder frame of the given geometry, padded per libavcodec's rules.
+static int dec_layout(AVCodecContext* c, int width, int height, int fmt,
+                      int linesizes[4], size_t sizes[4]) {
+    int w = width, h = height;
+    int align[AV_NUM_DATA_POINTERS];
+    avcodec_align_dimensions2(c, &w, &h, align);
+
+    if (av_image_fill_linesizes(linesizes, fmt, w) < 0) return -1;
+    ptrdiff_t ls[4];
+    for (int i = 0; i < 4; ++i) {
+        linesizes[i] = FFALIGN(linesizes[i], 64);
+        ls[i] = linesizes[i];
+    }
+    if (av_image_fill_plane_sizes(sizes, fmt, h, ls) < 0) return -1;
+    for (int i = 0; i < 4; ++i) {
+        if (sizes[i]) sizes[i] += 16 + 64;   // decoders may over-read the last row
+    }
+    return 0;
+}
+
+static int dec_pools_setup(FFPlayer* p, AVCodecContext* c, int width, int height, int fmt) {
+    if (p->dec_pool[0] && p->dec_w == width && p->dec_h == height && p->dec_fmt == fmt) return 0;
+    dec_pools_free(p);
+
+    int linesizes[4];
+    size_t sizes[4];
+    if (dec_layout(c, width, height, fmt, linesizes, sizes) < 0) return -1;
+    for (int i = 0; i < 4 && sizes[i]; ++i) {
+        p->dec_pool[i] = av_buffer_pool_init2(sizes[i], (void*)(uintptr_t)p->mem_flags,
+                                              mem_pool_alloc, NULL);
+        if (!p->dec_pool[i]) { dec_pools_free(p); return -1; }
+    }
+    p->dec_w = width;
+    p->dec_h = height;
+    p->dec_fmt = fmt;
+    return 0;
+}
+
+static int mem_get_buffer2(AVCodecContext* c, AVFrame* f, int flags) {
+    FFPlayer* p = c->opaque;
+    int linesizes[4];
+    size_t sizes[4];
+
+    if (dec_pools_setup(p, c, f->width, f->height, f->format) < 0 ||
+        dec_layout(c, f->width, f->height, f->format, linesizes, sizes) < 0) {
+        return avcodec_default_get_buffer2(c, f, flags);
+    }
+
+    for (int i = 0; i < 4 && p->dec_pool[i]; ++i) {
+        f->buf[i] = av_buffer_pool_get(p->dec_pool[i]);
+        if (!f->buf[i]) {
+            for (int j = 0; j < i; ++j) av_buffer_unref(&f->buf[j]);
+            return AVERROR(ENOMEM);
+        }
+        f->data[i]     = f->buf[i]->data;
+        f->linesize[i] = linesizes[i];
+    }
+    f->extended_data = f->data;
+    return 0;
+}
+
+// Sets up the decoder pools at open and touches `count` frames' worth of their
+// memory so the first frames do not pay for it.
+static void dec_pools_prewarm(FFPlayer* p, int count) {
+    AVCodecContext* c = p->vdec;
+    if (c->pix_fmt == AV_PIX_FMT_NONE || c->width <= 0 || c->height <= 0) return;
+    if (dec_pools_setup(p, c, c->width, c->height, c->pix_fmt) < 0) return;
+
+    AVBufferRef* held[4][8] = {{0}};
+    if (count > 8) count = 8;
+    for (int i = 0; i < 4 && p->dec_pool[i]; ++i)
+        for (int k = 0; k < count; ++k) held[i][k] = av_buffer_pool_get(p->dec_pool[i]);
+    for (int i = 0; i < 4; ++i)
+        for (int k = 0; k < count; ++k) av_buffer_unref(&held[i][k]);
+}
+
 static int setup_sws(FFPlayer* p) {
     if (p->sws) return 0;
     p->sws = sws_getContext(p->vdec->width, p->vdec->height, p->vdec->pix_fmt,
@@ -291,13 +502,25 @@ static int setup_sws(FFPlayer* p) {
 }
 
 FFPlayer* ff_open(const char* path, int* width, int* height, double* time_base, double* duration_s) {
+    return ff_open_with_options(path, NULL, width, height, time_base, duration_s);
+}
+
+FFPlayer* ff_open_with_options(const char* path, const FFOpenOptions* opts,
+                               int* width, int* height, double* time_base, double* duration_s) {
+    if (!path) return NULL;
     av_log_set_level(AV_LOG_ERROR);
+    pthread_once(&g_gov_once, gov_register);
 
     FFPlayer* p = calloc(1, sizeof(*p));
     if (!p) return NULL;
+    if (opts) p->mem_flags = opts->mem_flags;
+    if (!(p->path = strdup(path))) goto fail;
 
     if (avformat_open_input(&p->fmt, path, NULL, NULL) < 0) goto fail;
     if (avformat_find_stream_info(p->fmt, NULL) < 0) goto fail;
+    // The read buffer; the demuxer's own packet queue is not visible from here.
+    p->demux_bytes = p->fmt->pb ? (size_t)p->fmt->pb->buffer_size : 0;
+    atomic_fetch_add(&g_io_bytes, p->demux_bytes);
 
     p->vstream = av_find_best_stream(p->fmt, AVMEDIA_TYPE_VIDEO, -1, -1, NULL, 0);
     if (p->vstream < 0) goto fail;
@@ -309,6 +532,12 @@ FFPlayer* ff_open(const char* path, int* width, int* height, double* time_base,
     p->vdec = avcodec_alloc_context3(dec);
     if (!p->vdec) goto fail;
     if (avcodec_parameters_to_context(p->vdec, vs->codecpar) < 0) goto fail;
+    // Planes come from the player's pools whenever the decoder allows it, so
+    // the governor sees them in every mode.
+    if (dec->capabilities & AV_CODEC_CAP_DR1) {
+        p->vdec->opaque      = p;
+        p->vdec->get_buffer2 = mem_get_buffer2;
+    }
     if (avcodec_open2(p->vdec, dec, NULL) < 0) goto fail;
 
     p->frame = av_frame_alloc();
@@ -318,10 +547,38 @@ FFPlayer* ff_open(const char* path, int* width, int* height, double* time_base,
     p->out_w = p->vdec->width;
     p->out_h = p->vdec->height;
     p->at_eof = 0;
+    // Pools set up before the decoder's threads ask for buffers; with
+    // mem_flags, a couple of frames' worth are touched now too.
+    if (p->vdec->get_buffer2 == mem_get_buffer2) dec_pools_prewarm(p, p->mem_flags ? 2 : 0);
+
+    if (p->mem_flags) {
+        int prealloc = (opts && opts->prealloc_frames > 0) ? opts->prealloc_frames : FF_POOL_DEFAULT_BUFFERS;
+#ifdef __APPLE__
+        // CoreVideo allocates output buffers itself; only decoder planes use mem_flags.
+        p->sink = ff_sink_default_create();
+#else
+        FFFramePoolConfig cfg = { .max_buffers = prealloc,
+                                  .wait_timeout_ms = FF_POOL_DEFAULT_TIMEOUT_MS,
+                                  .mem_flags = p->mem_flags };
+        FFFramePool* pool = ff_pool_create(&cfg);
+        if (pool) {
+            ff_pool_preallocate(pool, p->out_w, p->out_h, FF_PIXFMT_BGRA, prealloc);
+            p->sink = ff_sink_pool_create(pool);
+            ff_pool_destroy(pool);
+        }
+#endif
+    } else {
+        p->sink = ff_sink_default_create();
+    }
+    if (!p->sink) goto fail;
+    p->sink_is_default = 1;
 
     if (width)  *width  = p->out_w;
     if (height) *height = p->out_h;
 
+    p->frame_rate = vs->avg_frame_rate.num > 0 ? vs->avg_frame_rate : vs->r_frame_rate;
+    p->start_ts   = (vs->start_time != AV_NOPTS_VALUE) ? vs->start_time : 0;
+
     if (time_base) *time_base = av_q2d(vs->time_base);
 
     if (duration_s) {
@@ -337,35 +594,93 @@ FFPlayer* ff_open(const char* path, int* width, int* height, double* time_base,
     return p;
 fail:
     if (p) {
+        if (p->sink) ff_sink_destroy(p->sink);
         if (p->frame) av_frame_free(&p->frame);
         if (p->pkt) av_packet_free(&p->pkt);
         if (p->vdec) avcodec_free_context(&p->vdec);
+        dec_pools_free(p);
+        atomic_fetch_sub(&g_io_bytes, p->demux_bytes);
         if (p->fmt) avformat_close_input(&p->fmt);
+        free(p->path);
         free(p);
     }
     return NULL;
 }
 
 
+static void region_free(FFPlayer* p);
+
 void ff_close(FFPlayer* p) {
     if (!p) return;
+    ff_loop_destroy(p->loop);   // first: its thread may be restarting the decoder
+    region_free(p);
     if (p->sws) sws_freeContext(p->sws);
+    if (p->sink) ff_sink_destroy(p->sink);
+    ff_workers_destroy(p->workers);
+    ff_cache_destroy(p->cache);
+    ff_packcache_destroy(p->pack);
+    free(p->regions);
+    free(p->scratch);
+    if (p->shm_ring) ff_shm_ring_destroy(p->shm_ring);
     if (p->frame) av_frame_free(&p->frame);
     if (p->pkt) av_packet_free(&p->pkt);
     if (p->vdec) avcodec_free_context(&p->vdec);
+    dec_pools_free(p);
+    atomic_fetch_sub(&g_io_bytes, p->demux_bytes);
     if (p->fmt) avformat_close_input(&p->fmt);
+    free(p->path);
     free(p);
 }
 
-int ff_next_frame(FFPlayer* p, CVImageBufferRef* out_ib, double* out_pts_s) {
-    *out_ib = NULL;
-    if (!p->sws && setup_sws(p) < 0) return -2;
+int ff_set_sink(FFPlayer* p, FFFrameSink* sink) {
+    if (!p) return -1;
+    int is_default = !sink;
+    if (!sink) sink = ff_sink_default_create();
+    if (!sink) return -1;
+    if (p->sink && p->sink != sink) ff_sink_destroy(p->sink);
+    p->sink = sink;
+    p->sink_is_default = is_default;
+    if (p->shm_ring) {
+        ff_shm_ring_destroy(p->shm_ring);
+        p->shm_ring = NULL;
+    }
+    return 0;
+}
+
+int ff_set_shm_output(FFPlayer* p, const char* name, int slots) {
+    if (!p || !name) return -1;
+    // Cache and loop hits bypass the sink and would hold ring slots.
+    if (p->cache || p->pack || p->loop) return -1;
+    FFShmRing* ring = ff_shm_ring_create(name, slots > 0 ? slots : 4, p->out_w, p->out_h, FF_PIXFMT_BGRA);
+    if (!ring) return -1;
+    FFFrameSink* sink = ff_sink_shm_create(ring);
+    if (!sink) {
+        ff_shm_ring_destroy(ring);
+        return -1;
+    }
+    ff_set_sink(p, sink);
+    p->shm_ring = ring;
+    return 0;
+}
 
+FFFrameSink* ff_get_sink(FFPlayer* p) {
+    return p ? p->sink : NULL;
+}
+
+// Next packet from the resident loop region, or else from the file.
+static int read_packet(FFPlayer* p) {
+    if (!p->region_reading) return av_read_frame(p->fmt, p->pkt);
+    if (p->region_pos >= p->region_npkts) return AVERROR_EOF;
+    return av_packet_ref(p->pkt, p->region_pkts[p->region_pos++]);
+}
+
+// Decodes the next video frame into p->frame. Returns 1 on frame, 0 on EOF, <0 on error.
+static int decode_next(FFPlayer* p) {
     for (;;) {
         int r;
 
         if (!p->at_eof) {
-            r = av_read_frame(p->fmt, p->pkt);
+            r = read_packet(p);
             if (r == AVERROR_EOF) {
                 // No more packets → start draining
                 p->at_eof = 1;
@@ -404,42 +719,786 @@ int ff_next_frame(FFPlayer* p, CVImageBufferRef* out_ib, double* out_pts_s) {
         if (r < 0) {
             return r; // real decode error
         }
+        return 1;
+    }
+}
+
+static int next_frame_ref(FFPlayer* p, FFFrameRef** out);
+
+int ff_next_frame_ref(FFPlayer* p, FFFrameRef** out) {
+    uint64_t minor0, major0, minor1, major1;
+    ff_mem_page_faults(&minor0, &major0);
+
+    int r = p->loop ? ff_loop_next(p->loop, out) : next_frame_ref(p, out);
+
+    if (r == 1) {
+        ff_mem_page_faults(&minor1, &major1);
+        uint64_t n = (minor1 - minor0) + (major1 - major0);
+        p->faults.frames++;
+        p->faults.faults_total += n;
+        p->faults.faults_last = n;
+        if (n > p->faults.faults_max) p->faults.faults_max = n;
+    }
+    return r;
+}
 
-        // Convert to CVPixelBuffer
-        CVPixelBufferRef pb = NULL;
-        if (CVPixelBufferCreate(kCFAllocatorDefault,
-                                p->out_w, p->out_h,
-                                kCVPixelFormatType_32BGRA,
-                                NULL, &pb) != kCVReturnSuccess) {
-            return -3;
+static int player_source_next(void* opaque, FFFrameRef** out) {
+    return ff_next_frame_ref(opaque, out);
+}
+
+FFFrameSource ff_player_source(FFPlayer* p) {
+    FFFrameSource src = { player_source_next, p };
+    return src;
+}
+
+int ff_get_fault_stats(FFPlayer* p, FFFaultStats* out) {
+    if (!p || !out) return -1;
+    *out = p->faults;
+    return 0;
+}
+
+// Frame number of a decoded frame, derived from its timestamp when possible so
+// it stays correct across seeks.
+static int64_t frame_index_of(FFPlayer* p, const AVFrame* f) {
+    if (f->best_effort_timestamp == AV_NOPTS_VALUE || p->frame_rate.num <= 0 || p->frame_rate.den <= 0)
+        return p->next_index;
+    AVRational tb = p->fmt->streams[p->vstream]->time_base;
+    double t = (f->best_effort_timestamp - p->start_ts) * av_q2d(tb);
+    return llround(t * av_q2d(p->frame_rate));
+}
+
+static int seek_decoder(FFPlayer* p, int64_t index);
+static int seek_frame(FFPlayer* p, int64_t index);
+static int seek_file(FFPlayer* p, int64_t ts);
+
+// Decoding up to this many frames forward is cheaper than a seek.
+#define CACHE_SKIP_FORWARD 32
+
+// Cache hits moved next_index past the decoder: decode forward to it if it is
+// close ahead, otherwise seek.
+static int resync_decoder(FFPlayer* p) {
+    p->dec_behind = 0;
+    int64_t gap = p->next_index - p->dec_pos;
+    if (gap == 0) return 0;
+    if (gap < 0 || gap > CACHE_SKIP_FORWARD) return seek_decoder(p, p->next_index);
+    if (p->frame_pending && frame_index_of(p, p->frame) < p->next_index) {
+        av_frame_unref(p->frame);
+        p->frame_pending = 0;
+    }
+    p->skip_until = p->next_index;
+    return 0;
+}
+
+// Decodes until p->frame holds the next frame to output (at or after any seek
+// target). A frame left over from a back-pressured call is kept.
+static int decode_pending(FFPlayer* p) {
+    if (p->dec_behind) {
+        int r = resync_decoder(p);
+        if (r < 0) return r;
+    }
+    while (!p->frame_pending) {
+        if (p->interrupt && p->interrupt(p->interrupt_opaque)) return -4;
+        int r = decode_next(p);
+        if (r == AVERROR_EXIT) return -4;   // interrupted during I/O
+        if (r != 1) return r;
+        int64_t idx = frame_index_of(p, p->frame);
+        if (idx < p->skip_until) {
+            av_frame_unref(p->frame);   // before the seek target: never converted
+            continue;
         }
+        p->next_index = idx;
+        p->frame_pending = 1;
+    }
+    return 1;
+}
+
+static double pending_pts(FFPlayer* p) {
+    if (p->frame->best_effort_timestamp == AV_NOPTS_VALUE) return NAN;
+    AVRational tb = p->fmt->streams[p->vstream]->time_base;
+    return p->frame->best_effort_timestamp * av_q2d(tb);
+}
 
-        CVPixelBufferLockBaseAddress(pb, 0);
-        uint8_t* dst = (uint8_t*)CVPixelBufferGetBaseAddress(pb);
-        size_t dst_stride = CVPixelBufferGetBytesPerRow(pb);
+// Marks the decoder as left behind at its current position (see resync_decoder).
+static void leave_decoder(FFPlayer* p) {
+    if (p->dec_behind) return;
+    p->dec_behind = 1;
+    p->dec_pos    = p->next_index;
+}
+
+static int acquire_output(FFPlayer* p, FFSinkImage* img) {
+    if (p->sink->acquire(p->sink, p->out_w, p->out_h, FF_PIXFMT_BGRA, img) == 0) return 0;
+    // Cached frames may be holding the pool's buffers: hand half back and retry.
+    FFFrameCacheStats cs;
+    ff_cache_get_stats(p->cache, &cs);
+    if (!p->cache || ff_cache_shrink(p->cache, cs.bytes / 2) == 0) return -1;
+    return p->sink->acquire(p->sink, p->out_w, p->out_h, FF_PIXFMT_BGRA, img);
+}
 
-        uint8_t* planes[4] = { dst, NULL, NULL, NULL };
-        int      strides[4]= { (int)dst_stride, 0, 0, 0 };
+// Presentation time of frame `index`, on the same clock as pending_pts().
+static double index_pts(FFPlayer* p, int64_t index) {
+    if (p->frame_rate.num <= 0 || p->frame_rate.den <= 0) return NAN;
+    return p->start_ts * av_q2d(p->fmt->streams[p->vstream]->time_base) + index / av_q2d(p->frame_rate);
+}
 
-        sws_scale(p->sws,
-                  (const uint8_t* const*)p->frame->data,
-                  p->frame->linesize,
-                  0, p->vdec->height,
-                  planes, strides);
+// Reads frame next_index from the disk cache into a sink image, leaving the
+// decoder behind. Returns like next_frame_ref; 0 means it was not on disk.
+static int next_disk_frame(FFPlayer* p, FFFrameRef** out) {
+    FFSinkImage img;
+    if (acquire_output(p, &img) < 0) return -3;
+    int r = ff_diskcache_read_into(p->disk, &p->disk_key, p->next_index, &img);
+    if (r != 1) {
+        p->sink->discard(p->sink, &img);
+        return r;
+    }
+    *out = p->sink->commit(p->sink, &img, index_pts(p, p->next_index), p->next_index);
+    if (!*out) return -3;
+    leave_decoder(p);
+    if (p->cache) ff_cache_put(p->cache, *out);
+    p->next_index++;
+    return 1;
+}
 
-        CVPixelBufferUnlockBaseAddress(pb, 0);
+// Reads frame next_index from the proxy at proxy size. Proxy frames stay out of
+// the full-size caches. Returns like next_disk_frame.
+static int next_proxy_frame(FFPlayer* p, FFFrameRef** out) {
+    const FFDiskCacheKey* key = ff_proxy_key(p->proxy);
+    FFSinkImage img;
+    if (p->sink->acquire(p->sink, key->width, key->height, FF_PIXFMT_BGRA, &img) < 0) return -3;
+    int r = ff_proxy_read_into(p->proxy, p->next_index, &img);
+    if (r != 1) {
+        p->sink->discard(p->sink, &img);
+        return r;
+    }
+    *out = p->sink->commit(p->sink, &img, index_pts(p, p->next_index), p->next_index);
+    if (!*out) return -3;
+    leave_decoder(p);
+    p->next_index++;
+    return 1;
+}
 
-        double pts = NAN;
-        if (p->frame->best_effort_timestamp != AV_NOPTS_VALUE) {
-            AVRational tb = p->fmt->streams[p->vstream]->time_base;
-            pts = p->frame->best_effort_timestamp * av_q2d(tb);
+static int next_frame_ref(FFPlayer* p, FFFrameRef** out) {
+    *out = NULL;
+    if (p->use_proxy && ff_proxy_contains(p->proxy, p->next_index)) {
+        int r = next_proxy_frame(p, out);
+        if (r != 0) return r;
+    }
+    if (p->cache) {
+        ff_cache_set_playhead(p->cache, p->next_index);
+        FFFrameRef* f = ff_cache_get(p->cache, p->next_index);
+        if (f) {
+            leave_decoder(p);
+            *out = f;
+            p->next_index++;
+            return 1;
+        }
+    }
+    if (p->pack) {
+        ff_packcache_set_playhead(p->pack, p->next_index);
+        FFFrameRef* f = ff_packcache_get(p->pack, p->next_index);
+        if (f) {
+            leave_decoder(p);
+            *out = f;
+            p->next_index++;
+            return 1;
         }
+    }
+    if (p->disk && ff_diskcache_contains(p->disk, &p->disk_key, p->next_index)) {
+        int r = next_disk_frame(p, out);
+        if (r != 0) return r;   // 0: lost to eviction, decode it instead
+    }
+    if (!p->sws && setup_sws(p) < 0) return -2;
 
-        *out_ib = (CVImageBufferRef)pb;   // retained buffer
-        if (out_pts_s) *out_pts_s = pts;
+    int r = decode_pending(p);
+    if (r != 1) return r;
+
+    // Convert straight into the sink's destination
+    FFSinkImage img;
+    if (acquire_output(p, &img) < 0) return -3;   // keep the decoded frame for the next call
+
+    sws_scale(p->sws,
+              (const uint8_t* const*)p->frame->data,
+              p->frame->linesize,
+              0, p->vdec->height,
+              img.data, img.linesize);
+
+    *out = p->sink->commit(p->sink, &img, pending_pts(p), p->next_index);
+    av_frame_unref(p->frame);
+    p->frame_pending = 0;
+    if (!*out) return -3;
+
+    if (p->cache) ff_cache_put(p->cache, *out);
+    if (p->pack) ff_packcache_put(p->pack, *out);
+    if (p->disk) ff_diskcache_put(p->disk, &p->disk_key, *out);
+    p->next_index++;
+    return 1;
+}
+
+// ---- Frame cache ----
+
+// Frames waiting to be compressed hold player output buffers.
+#define FF_PACK_QUEUE 4
+
+// Recreates a player-created sink with FF_POOL_DEFAULT_BUFFERS per output
+// (every region takes a buffer per frame) plus the buffers that cached, queued
+// and loop-head frames keep. Returns 0 or -1.
+static int resize_default_sink(FFPlayer* p) {
+    if (!p->sink_is_default) return 0;
+    int outputs = p->nregions > 0 ? p->nregions : 1;
+    int extra = p->cache_buffers + p->pack_buffers + p->loop_buffers;
+    FFFramePoolConfig cfg = { .max_buffers = FF_POOL_DEFAULT_BUFFERS * outputs + extra,
+                              .wait_timeout_ms = FF_POOL_DEFAULT_TIMEOUT_MS,
+                              .mem_flags = p->mem_flags };
+#ifdef __APPLE__
+    // A CVPixelBufferPool holds buffers of one size, so several regions get
+    // plain CoreVideo buffers instead.
+    FFFrameSink* sink = p->nregions > 1 ? ff_sink_corevideo_create() : ff_sink_corevideo_pool_create(&cfg);
+#else
+    FFFramePool* pool = ff_pool_create(&cfg);
+    FFFrameSink* sink = pool ? ff_sink_pool_create(pool) : NULL;
+    ff_pool_destroy(pool);
+#endif
+    if (!sink) return -1;
+    ff_set_sink(p, sink);
+    p->sink_is_default = 1;
+    return 0;
+}
+
+int ff_set_frame_cache(FFPlayer* p, size_t budget_bytes, int pin_before, int pin_after) {
+    if (!p || (budget_bytes && p->shm_ring)) return -1;
+    if (budget_bytes == 0) {
+        if (p->dec_behind) resync_decoder(p);
+        ff_cache_destroy(p->cache);
+        p->cache = NULL;
+        p->cache_buffers = 0;
+        return 0;
+    }
+    FFFrameCacheConfig cc = { budget_bytes, pin_before, pin_after };
+    FFFrameCache* cache = ff_cache_create(&cc);
+    if (!cache) return -1;
+
+    // Cached frames keep their output buffers, so a player-created sink grows
+    // by the budget's worth of frames.
+    size_t frame_bytes = (size_t)FFALIGN(p->out_w * 4, 64) * (size_t)p->out_h;
+    int old_buffers = p->cache_buffers;
+    p->cache_buffers = frame_bytes ? (int)(budget_bytes / frame_bytes) : 0;
+    if (resize_default_sink(p) < 0) {
+        p->cache_buffers = old_buffers;
+        ff_cache_destroy(cache);
+        return -1;
+    }
+
+    if (p->dec_behind) resync_decoder(p);
+    ff_cache_destroy(p->cache);
+    p->cache = cache;
+    return 0;
+}
+
+FFFrameCache* ff_get_frame_cache(FFPlayer* p) {
+    return p ? p->cache : NULL;
+}
+
+int ff_set_pack_cache(FFPlayer* p, size_t budget_bytes, int readahead) {
+    if (!p || (budget_bytes && p->shm_ring)) return -1;
+    FFPackCache* pack = NULL;
+    if (budget_bytes > 0) {
+        // Decompressed frames get their own pool, of the player's kind.
+        FFFramePoolConfig cfg = { .max_buffers = (readahead > 0 ? readahead : 4) + FF_POOL_DEFAULT_BUFFERS,
+                                  .wait_timeout_ms = FF_POOL_DEFAULT_TIMEOUT_MS,
+                                  .mem_flags = p->mem_flags };
+#ifdef __APPLE__
+        FFFrameSink* sink = ff_sink_corevideo_pool_create(&cfg);
+#else
+        FFFramePool* pool = ff_pool_create(&cfg);
+        FFFrameSink* sink = pool ? ff_sink_pool_create(pool) : NULL;
+        ff_pool_destroy(pool);
+#endif
+        if (!sink) return -1;
+        FFPackCacheConfig pcfg = { .budget_bytes = budget_bytes, .readahead = readahead,
+                                   .queue_depth = FF_PACK_QUEUE, .sink = sink };
+        pack = ff_packcache_create(&pcfg);
+        if (!pack) return -1;
+        if (!p->pack) {
+            p->pack_buffers = FF_PACK_QUEUE;
+            if (resize_default_sink(p) < 0) {
+                p->pack_buffers = 0;
+                ff_packcache_destroy(pack);
+                return -1;
+            }
+        }
+    } else if (p->pack) {
+        p->pack_buffers = 0;
+        resize_default_sink(p);
+    }
+    if (p->dec_behind) resync_decoder(p);
+    ff_packcache_destroy(p->pack);
+    p->pack = pack;
+    return 0;
+}
 
+FFPackCache* ff_get_pack_cache(FFPlayer* p) {
+    return p ? p->pack : NULL;
+}
+
+// ---- Looping ----
+
+static int loop_source_next(void* opaque, FFFrameRef** out) {
+    return next_frame_ref(opaque, out);
+}
+
+static int loop_restart(void* opaque, int64_t index) {
+    return seek_frame(opaque, index);
+}
+
+static void region_free(FFPlayer* p) {
+    for (int i = 0; i < p->region_npkts; ++i) av_packet_free(&p->region_pkts[i]);
+    atomic_fetch_sub(&g_io_bytes, p->region_bytes);
+    free(p->region_pkts);
+    p->region_pkts    = NULL;
+    p->region_npkts   = 0;
+    p->region_bytes   = 0;
+    p->region_reading = 0;
+}
+
+// Drops the resident region; a decoder reading it goes back to the file.
+static int region_clear(FFPlayer* p) {
+    int reading = p->region_reading;
+    region_free(p);
+    return reading ? seek_decoder(p, p->next_index) : 0;
+}
+
+// Reads the packets of frames [in, out] from the file: from the keyframe
+// before `in` up to the next keyframe presented after `out`. They replace the
+// resident region only once all are in; on failure the region stays as it
+// was. Either way the demuxer is left anywhere: the caller seeks the decoder.
+static int region_collect(FFPlayer* p, int64_t in, int64_t out) {
+    if (p->frame_rate.num <= 0 || p->frame_rate.den <= 0) return -1;
+    AVStream* vs = p->fmt->streams[p->vstream];
+    int64_t in_ts  = p->start_ts + av_rescale_q(in, av_inv_q(p->frame_rate), vs->time_base);
+    int64_t out_ts = p->start_ts + av_rescale_q(out, av_inv_q(p->frame_rate), vs->time_base);
+    int r = seek_file(p, in_ts);
+    if (r < 0) return r;
+    AVPacket** pkts = NULL;
+    int npkts = 0, cap = 0;
+    size_t bytes = 0;
+    for (;;) {
+        r = av_read_frame(p->fmt, p->pkt);
+        if (r == AVERROR_EOF) break;
+        if (r < 0) goto fail;
+        if (p->pkt->stream_index != p->vstream) {
+            av_packet_unref(p->pkt);
+            continue;
+        }
+        if (npkts > 0 && (p->pkt->flags & AV_PKT_FLAG_KEY) &&
+            p->pkt->pts != AV_NOPTS_VALUE && p->pkt->pts > out_ts) {
+            av_packet_unref(p->pkt);
+            break;
+        }
+        if (npkts == cap) {
+            int ncap = cap ? cap * 2 : 256;
+            AVPacket** grown = realloc(pkts, (size_t)ncap * sizeof(*grown));
+            if (!grown) {
+                r = AVERROR(ENOMEM);
+                goto fail;
+            }
+            pkts = grown;
+            cap  = ncap;
+        }
+        AVPacket* k = av_packet_alloc();
+        if (!k) {
+            r = AVERROR(ENOMEM);
+            goto fail;
+        }
+        av_packet_move_ref(k, p->pkt);
+        bytes += (size_t)k->size;
+        atomic_fetch_add(&g_io_bytes, (size_t)k->size);
+        pkts[npkts++] = k;
+    }
+    region_free(p);
+    p->region_pkts  = pkts;
+    p->region_npkts = npkts;
+    p->region_bytes = bytes;
+    p->region_in    = in;
+    p->region_out   = out;
+    ff_governor_notify();
+    return 0;
+fail:
+    av_packet_unref(p->pkt);
+    for (int i = 0; i < npkts; ++i) av_packet_free(&pkts[i]);
+    atomic_fetch_sub(&g_io_bytes, bytes);
+    free(pkts);
+    return r;
+}
+
+int ff_set_loop(FFPlayer* p, int enabled, int head_frames) {
+    if (!p || (enabled && p->shm_ring)) return -1;
+    // Already so: keep the loop and its head frames.
+    int buffers = enabled ? (head_frames > 0 ? head_frames : FF_LOOP_HEAD_DEFAULT) : 0;
+    if (enabled ? p->loop && !p->loop_range && p->loop_buffers == buffers : !p->loop) return 0;
+    FFLoop* loop = NULL;
+    if (enabled) {
+        FFLoopConfig cfg = { .source = { loop_source_next, p }, .restart = loop_restart,
+                             .restart_opaque = p, .head_frames = head_frames };
+        loop = ff_loop_create(&cfg);
+        if (!loop) return -1;
+    }
+    ff_loop_destroy(p->loop);
+    p->loop = loop;
+    p->loop_range = 0;
+    region_clear(p);
+    // Head frames keep their output buffers.
+    p->loop_buffers = buffers;
+    resize_default_sink(p);
+    return 0;
+}
+
+int ff_set_loop_range(FFPlayer* p, int64_t in, int64_t out, size_t budget_bytes) {
+    if (!p || p->shm_ring || in < 0 || out < in) return -1;
+    int64_t frames = ff_get_frame_count(p);
+    if (frames > 0 && out >= frames) return -1;
+
+    // Resident when every decoded frame of the region fits the budget.
+    int64_t n = out - in + 1;
+    size_t frame_bytes = (size_t)FFALIGN(p->out_w * 4, 64) * (size_t)p->out_h;
+    int resident = frame_bytes > 0 && n <= INT_MAX && (size_t)n <= budget_bytes / frame_bytes;
+
+    // The new loop and region are built first; if either fails the player
+    // keeps its loop, region and position.
+    if (p->loop) ff_loop_reset(p->loop);   // no restart may use the decoder meanwhile
+    int64_t resume = p->next_index;
+    FFLoopConfig cfg = { .source = { loop_source_next, p }, .restart = loop_restart,
+                         .restart_opaque = p, .head_frames = resident ? (int)n : 0,
+                         .first = in, .count = n };
+    FFLoop* loop = ff_loop_create(&cfg);
+    if (!loop) return -1;
+    int r = resident ? 0 : region_collect(p, in, out);
+    if (r < 0) {
+        ff_loop_destroy(loop);
+        seek_decoder(p, resume);   // the read moved the demuxer
+        return r;
+    }
+
+    ff_loop_destroy(p->loop);
+    p->loop = loop;
+    p->loop_buffers = resident ? (int)n : FF_LOOP_HEAD_DEFAULT;
+    p->loop_range = 1;
+    resize_default_sink(p);
+    if (resident) {
+        region_clear(p);
+        r = seek_frame(p, in);
+    } else {
+        r = seek_decoder(p, in);
+    }
+    if (r < 0) return r;
+    return resident ? FF_LOOP_RESIDENT_FRAMES : FF_LOOP_RESIDENT_PACKETS;
+}
+
+int ff_get_loop_stats(FFPlayer* p, FFLoopStats* out) {
+    if (!p || !p->loop || !out) return -1;
+    ff_loop_get_stats(p->loop, out);
+    return 0;
+}
+
+int ff_set_interrupt(FFPlayer* p, int (*cb)(void* opaque), void* opaque) {
+    if (!p) return -1;
+    p->interrupt        = cb;
+    p->interrupt_opaque = opaque;
+    p->fmt->interrupt_callback.callback = cb;
+    p->fmt->interrupt_callback.opaque   = opaque;
+    return 0;
+}
+
+int ff_set_disk_cache(FFPlayer* p, FFDiskCache* dc) {
+    if (!p) return -1;
+    if (dc) {
+        FFDiskCacheKey key = { .width = p->out_w, .height = p->out_h, .format = FF_PIXFMT_BGRA };
+        if (ff_diskcache_clip_id(p->path, &key.clip_id) < 0) return -1;
+        p->disk_key = key;
+    }
+    if (p->disk && !dc && p->dec_behind) resync_decoder(p);
+    p->disk = dc;
+    return 0;
+}
+
+int ff_set_proxy(FFPlayer* p, FFProxy* px, int use) {
+    if (!p) return -1;
+    if (p->use_proxy && !(px && use) && p->dec_behind) resync_decoder(p);
+    p->proxy     = px;
+    p->use_proxy = px && use;
+    return 0;
+}
+
+// ---- Region output ----
+
+int ff_set_regions(FFPlayer* p, const FFRegion* regions, int count) {
+    if (!p || count < 0 || (count > 0 && !regions)) return -1;
+
+    FFRegion* resolved = NULL;
+    if (count > 0) {
+        resolved = calloc((size_t)count, sizeof(*resolved));
+        if (!resolved) return -1;
+        for (int i = 0; i < count; ++i) {
+            if (ff_region_resolve(&regions[i], p->out_w, p->out_h, &resolved[i]) < 0) {
+                free(resolved);
+                return -1;
+            }
+        }
+        if (!p->workers) p->workers = ff_workers_create(0);
+    }
+
+    // A player-created sink is resized for the new region count, and back
+    // when the regions are cleared.
+    FFRegion* old = p->regions;
+    int old_count = p->nregions;
+    p->regions  = resolved;
+    p->nregions = count;
+    if (count != old_count && resize_default_sink(p) < 0) {
+        p->regions  = old;
+        p->nregions = old_count;
+        free(resolved);
+        return -1;
+    }
+    free(old);
+    return 0;
+}
+
+int ff_get_region_count(FFPlayer* p) {
+    return p ? p->nregions : 0;
+}
+
+// Describes p->frame for ffconvert if it is planar YUV it can read directly.
+static int source_image_of(const AVFrame* f, FFSourceImage* s) {
+    const AVPixFmtDescriptor* d = av_pix_fmt_desc_get(f->format);
+    if (!d || !(d->flags & AV_PIX_FMT_FLAG_PLANAR) || d->nb_components < 3 ||
+        (d->flags & (AV_PIX_FMT_FLAG_RGB | AV_PIX_FMT_FLAG_FLOAT | AV_PIX_FMT_FLAG_BE))) return -1;
+    int bits = d->comp[0].depth;
+    if (bits < 8 || bits > 16) return -1;
+    for (int c = 0; c < d->nb_components; ++c) {
+        if (d->comp[c].plane != c || d->comp[c].shift != 0 || d->comp[c].offset != 0 ||
+            d->comp[c].depth != bits || d->comp[c].step != (bits > 8 ? 2 : 1)) return -1;
+    }
+
+    memset(s, 0, sizeof(*s));
+    s->layout = FF_SRC_YUV;
+    for (int c = 0; c < d->nb_components && c < 4; ++c) {
+        s->data[c]     = f->data[c];
+        s->linesize[c] = f->linesize[c];
+    }
+    s->width         = f->width;
+    s->height        = f->height;
+    s->bits          = bits;
+    s->log2_chroma_w = d->log2_chroma_w;
+    s->log2_chroma_h = d->log2_chroma_h;
+    s->matrix        = (f->colorspace == AVCOL_SPC_BT470BG || f->colorspace == AVCOL_SPC_SMPTE170M)
+                       ? FF_MATRIX_BT601 : FF_MATRIX_BT709;
+    s->full_range    = f->color_range == AVCOL_RANGE_JPEG;
+    return 0;
+}
+
+// Fallback for pixel formats ffconvert does not read: one full-frame BGRA
+// conversion into scratch memory, then regions are cut from that.
+static int source_image_scratch(FFPlayer* p, FFSourceImage* s) {
+    if (!p->sws && setup_sws(p) < 0) return -1;
+    if (!p->scratch) {
+        p->scratch_stride = FFALIGN(p->out_w * 4, 64);
+        p->scratch = malloc((size_t)p->scratch_stride * p->out_h);
+        if (!p->scratch) return -1;
+    }
+    uint8_t* data[4] = { p->scratch, NULL, NULL, NULL };
+    int linesize[4] = { p->scratch_stride, 0, 0, 0 };
+    sws_scale(p->sws, (const uint8_t* const*)p->frame->data, p->frame->linesize,
+              0, p->vdec->height, data, linesize);
+
+    memset(s, 0, sizeof(*s));
+    s->layout      = FF_SRC_BGRA;
+    s->data[0]     = p->scratch;
+    s->linesize[0] = p->scratch_stride;
+    s->width       = p->out_w;
+    s->height      = p->out_h;
+    return 0;
+}
+
+int ff_next_region_frames(FFPlayer* p, FFFrameRef** out, int max_out) {
+    if (!p || !out || p->nregions == 0 || max_out < p->nregions) return -1;
+    for (int i = 0; i < p->nregions; ++i) out[i] = NULL;
+
+    int r = decode_pending(p);
+    if (r != 1) return r;
+
+    FFSinkImage* img = calloc((size_t)p->nregions, sizeof(*img));
+    if (!img) return -1;
+    int n = 0;
+    for (; n < p->nregions; ++n) {
+        if (p->sink->acquire(p->sink, p->regions[n].dst_w, p->regions[n].dst_h, FF_PIXFMT_BGRA, &img[n]) < 0) break;
+    }
+    if (n < p->nregions) {
+        while (n-- > 0) p->sink->discard(p->sink, &img[n]);
+        free(img);
+        return -3;   // keep the decoded frame for the next call
+    }
+
+    FFSourceImage src;
+    if (source_image_of(p->frame, &src) < 0 && source_image_scratch(p, &src) < 0) {
+        for (int i = 0; i < p->nregions; ++i) p->sink->discard(p->sink, &img[i]);
+        free(img);
+        return -2;
+    }
+    ff_convert_regions(p->workers, &src, p->regions, p->nregions, img);
+
+    double pts = pending_pts(p);
+    int ok = 1;
+    for (int i = 0; i < p->nregions; ++i) {
+        out[i] = p->sink->commit(p->sink, &img[i], pts, p->next_index);
+        if (!out[i]) ok = 0;
+    }
+    free(img);
+    av_frame_unref(p->frame);
+    p->frame_pending = 0;
+    if (!ok) {
+        for (int i = 0; i < p->nregions; ++i) {
+            ff_frame_release(out[i]);
+            out[i] = NULL;
+        }
+        return -3;
+    }
+    p->next_index++;
+    return 1;
+}
+
+int ff_next_pixmap(FFPlayer* p, FFPixelMap* m, int64_t* index, double* pts_s) {
+    if (!p || !m) return -1;
+    int r = decode_pending(p);
+    if (r != 1) return r;
+
+    FFSourceImage src;
+    if (source_image_of(p->frame, &src) < 0 && source_image_scratch(p, &src) < 0) return -2;
+    ff_pixmap_sample(m, &src);
+
+    if (index) *index = p->next_index;
+    if (pts_s) *pts_s = pending_pts(p);
+    av_frame_unref(p->frame);
+    p->frame_pending = 0;
+    p->next_index++;
+    return 1;
+}
+
+int ff_next_source(FFPlayer* p, FFSourceImage* src, int64_t* index, double* pts_s) {
+    if (!p || !src) return -1;
+    int r = decode_pending(p);
+    if (r != 1) return r;
+    if (source_image_of(p->frame, src) < 0 && source_image_scratch(p, src) < 0) return -2;
+
+    if (index) *index = p->next_index;
+    if (pts_s) *pts_s = pending_pts(p);
+    // p->frame keeps the planes until the next decode replaces it.
+    p->frame_pending = 0;
+    p->next_index++;
+    return 1;
+}
+
+int ff_seek_frame(FFPlayer* p, int64_t index) {
+    if (!p || index < 0) return -1;
+    ff_loop_reset(p->loop);   // abandon a wrap in progress
+    return seek_frame(p, index);
+}
+
+static int seek_frame(FFPlayer* p, int64_t index) {
+    if ((p->cache && ff_cache_contains(p->cache, index)) ||
+        (p->pack && ff_packcache_contains(p->pack, index)) ||
+        (p->disk && ff_diskcache_contains(p->disk, &p->disk_key, index)) ||
+        (p->use_proxy && ff_proxy_contains(p->proxy, index))) {
+        // Served from a cache; the decoder catches up only on a miss.
+        leave_decoder(p);
+        p->next_index = index;
+        return 0;
+    }
+    return seek_decoder(p, index);
+}
+
+// Moves the demuxer to the keyframe at or before `ts` (stream time base).
+static int seek_file(FFPlayer* p, int64_t ts) {
+    int r = avformat_seek_file(p->fmt, p->vstream, INT64_MIN, ts, ts, 0);
+    if (r < 0) r = av_seek_frame(p->fmt, p->vstream, ts, AVSEEK_FLAG_BACKWARD);
+    return r;
+}
+
+// Last keyframe packet of the resident region at or before `ts`.
+static int region_seek_pos(FFPlayer* p, int64_t ts) {
+    int pos = 0;
+    for (int i = 0; i < p->region_npkts; ++i) {
+        const AVPacket* k = p->region_pkts[i];
+        if ((k->flags & AV_PKT_FLAG_KEY) && k->pts != AV_NOPTS_VALUE && k->pts <= ts) pos = i;
+    }
+    return pos;
+}
+
+static int seek_decoder(FFPlayer* p, int64_t index) {
+    AVStream* vs = p->fmt->streams[p->vstream];
+    if (p->frame_rate.num <= 0 || p->frame_rate.den <= 0) return -1;
+
+    int64_t ts = p->start_ts + av_rescale_q(index, av_inv_q(p->frame_rate), vs->time_base);
+    if (p->region_npkts > 0 && index >= p->region_in && index <= p->region_out) {
+        p->region_pos     = region_seek_pos(p, ts);
+        p->region_reading = 1;
+    } else {
+        int r = seek_file(p, ts);
+        if (r < 0) return r;
+        p->region_reading = 0;
+    }
+
+    avcodec_flush_buffers(p->vdec);
+    if (p->frame_pending) {
         av_frame_unref(p->frame);
-        return 1;
+        p->frame_pending = 0;
     }
+    p->at_eof     = 0;
+    p->skip_until = index;
+    p->next_index = index;
+    p->dec_behind = 0;
+    return 0;
 }
 
+int64_t ff_next_frame_index(FFPlayer* p) {
+    return p ? p->next_index : -1;
+}
+
+double ff_get_fps(FFPlayer* p) {
+    if (!p || p->frame_rate.num <= 0 || p->frame_rate.den <= 0) return NAN;
+    return av_q2d(p->frame_rate);
+}
+
+int64_t ff_get_frame_count(FFPlayer* p) {
+    if (!p) return -1;
+    AVStream* vs = p->fmt->streams[p->vstream];
+    if (vs->nb_frames > 0) return vs->nb_frames;
+    double fps = ff_get_fps(p);
+    if (!(fps > 0)) return -1;
+    double dur = NAN;
+    if (vs->duration != AV_NOPTS_VALUE) dur = vs->duration * av_q2d(vs->time_base);
+    else if (p->fmt->duration != AV_NOPTS_VALUE) dur = (double)p->fmt->duration / AV_TIME_BASE;
+    return (dur > 0) ? llround(dur * fps) : -1;
+}
+
+int ff_get_pool_stats(FFPlayer* p, FFFramePoolStats* out) {
+    return p ? ff_sink_get_pool_stats(p->sink, out) : -1;
+}
+
+#ifdef __APPLE__
+int ff_next_frame(FFPlayer* p, CVImageBufferRef* out_ib, double* out_pts_s) {
+    *out_ib = NULL;
+    if (!ff_sink_is_corevideo(p->sink)) return -2;
+
+    FFFrameRef* f = NULL;
+    int r = ff_next_frame_ref(p, &f);
+    if (r != 1) return r;
+
+    // Hand out our own retain on the backing buffer; dropping the frame ref
+    // releases the sink's read lock.
+    CVPixelBufferRef pb = (CVPixelBufferRef)ff_frame_native(f);
+    CVPixelBufferRetain(pb);
+    if (out_pts_s) *out_pts_s = ff_frame_pts(f);
+    ff_frame_release(f);
+
+    *out_ib = (CVImageBufferRef)pb;   // retained buffer
+    return 1;
+}
+#endif
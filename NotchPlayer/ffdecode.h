@@ -1,4 +1,7 @@
 #pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include "ffframe.h"
 typedef struct __CVBuffer *CVImageBufferRef;
 
 #ifdef __cplusplus
@@ -6,6 +9,17 @@ extern "C" {
 #endif
 
 typedef struct FFPlayer FFPlayer;
+typedef struct FFFrameSink FFFrameSink;
+typedef struct FFRegion FFRegion;
+typedef struct FFPixelMap FFPixelMap;
+typedef struct FFSourceImage FFSourceImage;
+typedef struct FFFrameCache FFFrameCache;
+typedef struct FFDiskCache FFDiskCache;
+typedef struct FFPackCache FFPackCache;
+typedef struct FFProxy FFProxy;
+struct FFLoopStats;
+struct FFFramePoolStats;
+struct FFFaultStats;
 
 // Returns average frame rate (fps), or NaN if unknown.
 double ff_get_avg_fps(const char* path);
@@ -28,7 +42,158 @@ double ff_format_duration(const char* path);
 // NOTE the 5th parameter: duration_s
 FFPlayer* ff_open(const char* path, int* width, int* height, double* time_base, double* duration_s);
 void      ff_close(FFPlayer* p);
+
+typedef struct FFOpenOptions {
+    // FF_MEM_* (ffmem.h) for decoder planes and output buffers: huge pages,
+    // pre-faulting, mlock, NUMA-local placement. 0 = ordinary allocations.
+    unsigned mem_flags;
+    // Output buffers allocated (and pre-faulted) at open; 0 = FF_POOL_DEFAULT_BUFFERS.
+    int      prealloc_frames;
+} FFOpenOptions;
+
+// ff_open with options; opts may be NULL.
+FFPlayer* ff_open_with_options(const char* path, const FFOpenOptions* opts,
+                               int* width, int* height, double* time_base, double* duration_s);
+
+// Route converted frames to `sink`. The player takes ownership and destroys the
+// previous sink; NULL restores the platform default (CoreVideo on Apple, memory elsewhere).
+int          ff_set_sink(FFPlayer* p, FFFrameSink* sink);
+FFFrameSink* ff_get_sink(FFPlayer* p);
+
+// Publish every frame into a named shared-memory ring of `slots` slots (see
+// ffshm.h / ffshm_client.h). Frames are converted directly into the ring. The
+// name is unlinked when the player closes or its sink is replaced. Not
+// together with the frame cache, pack cache or looping: their frames are served
+// without passing through the sink, so readers would miss them, and held frames
+// would pin ring slots. Returns 0, or -1 (also if one of those is on).
+int          ff_set_shm_output(FFPlayer* p, const char* name, int slots);
+
+// Decodes the next frame straight into the player's sink. *out receives a frame
+// with one reference (see ffframe.h); release it with ff_frame_release.
+// Returns 1 on frame, 0 on EOF, <0 on error. -3 means the sink's pool stayed full
+// for its whole wait timeout; the decoded frame is kept and converted on the next call.
+int       ff_next_frame_ref(FFPlayer* p, FFFrameRef** out);
+
+// Region output for LED processors: `count` regions (source rect, rotation /
+// flip, destination size; see ffconvert.h) are each written straight from the
+// decoded planes into their own output frame, in one pass split across threads.
+// count = 0 clears. If the player is still on its own default sink, the sink
+// is resized to hold count buffers per frame (and back when cleared); on Apple
+// it stays CoreVideo, so ff_next_frame keeps working. Returns 0, or -1 if a
+// region lies outside the picture.
+int       ff_set_regions(FFPlayer* p, const FFRegion* regions, int count);
+int       ff_get_region_count(FFPlayer* p);
+
+// Decodes the next frame and delivers one frame per region: out[i] (one
+// reference each) for regions[i], all with the same pts and index. max_out must
+// be at least the region count. Returns like ff_next_frame_ref.
+int       ff_next_region_frames(FFPlayer* p, FFFrameRef** out, int max_out);
+
+// Pixel-map output (ffpixmap.h): decodes the next frame and samples only the
+// mapped points from its planes into the map's DMX buffers. Nothing is written
+// to the sink. *index / *pts_s (optional) receive the frame's number and time.
+// Returns like ff_next_frame_ref.
+int       ff_next_pixmap(FFPlayer* p, FFPixelMap* m, int64_t* index, double* pts_s);
+
+// Decodes the next frame without converting it and describes its planes in
+// *src (see ffconvert.h), for stages that convert the picture themselves, such
+// as a transition mixing two clips (fftransition.h). Formats ffconvert cannot
+// read are first converted to BGRA in scratch memory. The planes stay valid
+// until the next call on the player. Like ff_next_pixmap, this reads past the
+// caches and the sink. *index / *pts_s (optional) receive the frame's number and
+// time. Returns like ff_next_frame_ref.
+int       ff_next_source(FFPlayer* p, FFSourceImage* src, int64_t* index, double* pts_s);
+
+// Decoded-frame cache (ffcache.h) of up to budget_bytes, consulted before any
+// read or decode: ff_next_frame_ref and ff_seek_frame serve cached frames
+// without touching the decoder, which catches up on the next miss. Frames within
+// pin_before / pin_after of the playhead are never evicted. If the player is
+// still on its own default sink, the sink grows by the budget's worth of
+// buffers. budget_bytes = 0 removes the cache. -1 with shm output on.
+int           ff_set_frame_cache(FFPlayer* p, size_t budget_bytes, int pin_before, int pin_after);
+// The player's cache (for ff_cache_get_stats), or NULL.
+FFFrameCache* ff_get_frame_cache(FFPlayer* p);
+
+// Compressed frame cache (ffpackcache.h) holding up to budget_bytes of
+// LZ4-compressed frames, consulted after the frame cache. Converted frames are
+// compressed in the background, and the next `readahead` frames (0 = 4) are
+// decompressed ahead of the playhead on worker threads. Decompressed frames come
+// from a pool of the same kind as the player's sink. budget_bytes = 0 removes it.
+// -1 with shm output on.
+int           ff_set_pack_cache(FFPlayer* p, size_t budget_bytes, int readahead);
+// The player's compressed cache (for ff_packcache_get_stats), or NULL.
+FFPackCache*  ff_get_pack_cache(FFPlayer* p);
+
+// Seamless looping (ffloop.h): at the end of the clip ff_next_frame_ref goes on
+// with frame 0 instead of returning 0. The first head_frames frames (0 =
+// FF_LOOP_HEAD_DEFAULT) stay referenced after they first play and are served
+// at the wrap while the decoder seeks back on a background thread. Size the head
+// to cover that restart (see FFLoopStats.restart_ns_max). Applies to
+// ff_next_frame_ref / ff_next_frame only. If the player is still on its own
+// default sink, the sink grows by head_frames buffers. Enabling returns -1 with
+// shm output on.
+// A call that changes nothing keeps the loop and its head frames.
+int           ff_set_loop(FFPlayer* p, int enabled, int head_frames);
+// Loops frames [in, out] (inclusive frame numbers, as for ff_seek_frame) and
+// seeks to `in`. If the decoded region fits budget_bytes, its frames are kept
+// after their first pass and it then plays entirely from memory, with no
+// further reads or decoding; the default sink grows by a buffer per frame.
+// Otherwise the region's compressed packets are read into memory once and the
+// decoder loops over them without touching the file. ff_set_loop turns the
+// region off. Returns FF_LOOP_RESIDENT_FRAMES / FF_LOOP_RESIDENT_PACKETS, or <0
+// (-1 with shm output on).
+#define FF_LOOP_RESIDENT_FRAMES  1
+#define FF_LOOP_RESIDENT_PACKETS 2
+int           ff_set_loop_range(FFPlayer* p, int64_t in, int64_t out, size_t budget_bytes);
+// Wrap statistics; -1 if looping is off.
+int           ff_get_loop_stats(FFPlayer* p, struct FFLoopStats* out);
+
+// Cancellation: while cb(opaque) returns nonzero, ff_next_frame_ref and the
+// other decoding calls stop between decoded frames (and blocking reads give up)
+// and return -4. The position is then undefined until the next ff_seek_frame.
+// cb is called on the decoding thread. NULL removes it.
+int           ff_set_interrupt(FFPlayer* p, int (*cb)(void* opaque), void* opaque);
+
+// Persistent disk cache (ffdiskcache.h) shared by any number of players; not
+// owned. Consulted after the frame cache and before decoding, and filled with
+// every frame the player converts. Keyed by the clip file's identity, so it only
+// works for players opened from a file path. NULL detaches. Returns 0 or -1.
+int           ff_set_disk_cache(FFPlayer* p, FFDiskCache* dc);
+
+// Proxy playback (ffproxy.h), not owned. While `use` is nonzero, frames the
+// proxy already has are read from it at proxy size ahead of every cache and the
+// decoder; the rest are decoded at full size as usual. Switch with `use` (see
+// ff_proxy_choose); NULL detaches. Returns 0 or -1.
+int           ff_set_proxy(FFPlayer* p, FFProxy* px, int use);
+
+// The player as a generic frame source (ffframe.h) for pipeline stages such as
+// fffanout.h. The source pulls with ff_next_frame_ref.
+FFFrameSource ff_player_source(FFPlayer* p);
+
+// Positions the player so the next ff_next_frame_ref returns frame `index`
+// (0-based, in frame-rate units). Frames between the preceding keyframe and the
+// target are decoded but never converted. Returns 0 or <0 on error.
+int       ff_seek_frame(FFPlayer* p, int64_t index);
+
+// Index the next returned frame is expected to have.
+int64_t   ff_next_frame_index(FFPlayer* p);
+
+// Frame rate used for frame numbering (NaN if unknown) and the clip's frame
+// count (nb_frames, else duration * fps; -1 if unknown).
+double    ff_get_fps(FFPlayer* p);
+int64_t   ff_get_frame_count(FFPlayer* p);
+
+// Output pool usage (high-water mark, bytes in use, wait time). -1 if the sink is unpooled.
+int       ff_get_pool_stats(FFPlayer* p, struct FFFramePoolStats* out);
+
+// Page faults taken per ff_next_frame_ref call (process-wide counters, so decoder
+// worker threads are included).
+int       ff_get_fault_stats(FFPlayer* p, struct FFFaultStats* out);
+
+#ifdef __APPLE__
+// CoreVideo sink only (the default on Apple); returns -2 if another sink is set.
 int       ff_next_frame(FFPlayer* p, CVImageBufferRef* out_ib, double* out_pts_s);
+#endif
 
 #ifdef __cplusplus
 }
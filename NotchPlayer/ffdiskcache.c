@@ -0,0 +1,704 @@
+#include "ffdiskcache.h"
+#include "fflz4.h"
+#include "ffutil.h"
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define DC_MAGIC       "NPFCHNK1"
+#define DC_PAGE        4096          // payload alignment, so raw frames map page-aligned
+#define DC_EXT         ".nfc"
+
+// On-disk chunk header, followed by `slots` ChunkSlot entries.
+typedef struct ChunkHeader {
+    char     magic[8];
+    uint32_t slots;
+    uint32_t reserved;
+    uint64_t clip_id;
+    int32_t  width, height, format;
+    int32_t  row_bytes;              // payload rows are packed
+    int64_t  first_index;
+} ChunkHeader;
+
+typedef struct ChunkSlot {
+    uint64_t offset;                 // 0 = frame not stored
+    uint32_t size;                   // stored bytes
+    uint32_t codec;                  // FFDiskCodec
+} ChunkSlot;
+
+// A read-only mapping of a chunk file, shared by the frames handed out from it.
+typedef struct Mapping {
+    atomic_int refs;
+    uint8_t*   base;
+    size_t     len;
+} Mapping;
+
+typedef struct Chunk Chunk;
+struct Chunk {
+    FFDiskCacheKey key;
+    int64_t        chunk;            // first frame = chunk * frames_per_chunk
+    char*          path;
+    uint64_t       bytes;
+    int64_t        last_used;        // realtime ns (file mtime for chunks from earlier runs)
+    int            touched;          // mtime refreshed this session
+    int            writing;          // the writer has it open
+    Mapping*       map;
+    Chunk*         hnext;
+};
+
+typedef struct WriteJob {
+    FFDiskCacheKey key;
+    FFFrameRef*    f;
+} WriteJob;
+
+struct FFDiskCache {
+    FFDiskCacheConfig cfg;
+    char*           root;
+
+    pthread_mutex_t lock;            // chunk table, stats
+    Chunk**         buckets;
+    int             nbuckets;
+    int             nchunks;
+    FFDiskCacheStats stats;
+
+    // Writer
+    pthread_t       writer;
+    pthread_cond_t  job_cv;          // job queued / stopping
+    pthread_cond_t  idle_cv;         // queue drained
+    WriteJob*       jobs;
+    int             head, count;
+    int             busy, stopping;
+    uint8_t*        pack;            // writer scratch: packed rows
+    uint8_t*        packed_lz4;
+    size_t          scratch_size;
+};
+
+static size_t header_bytes(int slots) {
+    return sizeof(ChunkHeader) + (size_t)slots * sizeof(ChunkSlot);
+}
+
+static int64_t realtime_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static uint64_t fnv1a(uint64_t h, const void* data, size_t n) {
+    const uint8_t* p = data;
+    for (size_t i = 0; i < n; ++i) {
+        h ^= p[i];
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+static const char* format_name(FFPixelFormat f) {
+    switch (f) {
+    case FF_PIXFMT_BGRA: return "bgra";
+    }
+    return "unknown";
+}
+
+static int format_from_name(const char* s, FFPixelFormat* out) {
+    if (strcmp(s, "bgra") == 0) {
+        *out = FF_PIXFMT_BGRA;
+        return 0;
+    }
+    return -1;
+}
+
+static int mkdir_p(const char* path) {
+    char buf[PATH_MAX];
+    if (snprintf(buf, sizeof(buf), "%s", path) >= (int)sizeof(buf)) return -1;
+    for (char* p = buf + 1; *p; ++p) {
+        if (*p != '/') continue;
+        *p = '\0';
+        if (mkdir(buf, 0755) < 0 && errno != EEXIST) return -1;
+        *p = '/';
+    }
+    return mkdir(buf, 0755) < 0 && errno != EEXIST ? -1 : 0;
+}
+
+int ff_diskcache_clip_id(const char* path, uint64_t* out) {
+    struct stat st;
+    if (!path || !out || stat(path, &st) < 0) return -1;
+    char* real = realpath(path, NULL);
+    const char* name = real ? real : path;
+    uint64_t h = fnv1a(0xcbf29ce484222325ULL, name, strlen(name));
+    int64_t size = (int64_t)st.st_size;
+#ifdef __APPLE__
+    int64_t mtime[2] = { (int64_t)st.st_mtimespec.tv_sec, (int64_t)st.st_mtimespec.tv_nsec };
+#else
+    int64_t mtime[2] = { (int64_t)st.st_mtim.tv_sec, (int64_t)st.st_mtim.tv_nsec };
+#endif
+    h = fnv1a(h, &size, sizeof(size));
+    h = fnv1a(h, mtime, sizeof(mtime));
+    free(real);
+    *out = h;
+    return 0;
+}
+
+// ---- Chunk table (dc->lock held) ----
+
+static int key_eq(const FFDiskCacheKey* a, const FFDiskCacheKey* b) {
+    return a->clip_id == b->clip_id && a->width == b->width && a->height == b->height && a->format == b->format;
+}
+
+static unsigned chunk_bucket(const FFDiskCache* dc, const FFDiskCacheKey* k, int64_t chunk) {
+    uint64_t h = k->clip_id ^ ((uint64_t)k->width << 32) ^ (uint64_t)k->height ^ ((uint64_t)k->format << 48);
+    h = (h ^ (uint64_t)chunk) * 0x9e3779b97f4a7c15ULL;
+    return (unsigned)(h >> 32) & (unsigned)(dc->nbuckets - 1);
+}
+
+static Chunk* chunk_find(const FFDiskCache* dc, const FFDiskCacheKey* k, int64_t chunk) {
+    for (Chunk* c = dc->buckets[chunk_bucket(dc, k, chunk)]; c; c = c->hnext)
+        if (c->chunk == chunk && key_eq(&c->key, k)) return c;
+    return NULL;
+}
+
+static void chunk_table_grow(FFDiskCache* dc) {
+    int n = dc->nbuckets * 2;
+    Chunk** b = calloc((size_t)n, sizeof(*b));
+    if (!b) return;
+    Chunk** old = dc->buckets;
+    int oldn = dc->nbuckets;
+    dc->buckets  = b;
+    dc->nbuckets = n;
+    for (int i = 0; i < oldn; ++i) {
+        for (Chunk* c = old[i], *next; c; c = next) {
+            next = c->hnext;
+            unsigned k = chunk_bucket(dc, &c->key, c->chunk);
+            c->hnext = b[k];
+            b[k] = c;
+        }
+    }
+    free(old);
+}
+
+static void key_dir(const FFDiskCache* dc, const FFDiskCacheKey* k, char* out, size_t n) {
+    snprintf(out, n, "%s/%016" PRIx64 "-%dx%d-%s", dc->root, k->clip_id, k->width, k->height, format_name(k->format));
+}
+
+static Chunk* chunk_add(FFDiskCache* dc, const FFDiskCacheKey* k, int64_t chunk, uint64_t bytes, int64_t last_used) {
+    char dir[PATH_MAX], path[PATH_MAX];
+    key_dir(dc, k, dir, sizeof(dir));
+    if (snprintf(path, sizeof(path), "%s/%" PRId64 DC_EXT, dir, chunk) >= (int)sizeof(path)) return NULL;
+    Chunk* c = calloc(1, sizeof(*c));
+    if (!c || !(c->path = strdup(path))) {
+        free(c);
+        return NULL;
+    }
+    c->key       = *k;
+    c->chunk     = chunk;
+    c->bytes     = bytes;
+    c->last_used = last_used;
+    unsigned b = chunk_bucket(dc, k, chunk);
+    c->hnext = dc->buckets[b];
+    dc->buckets[b] = c;
+    dc->nchunks++;
+    dc->stats.bytes_on_disk += bytes;
+    if (dc->nchunks > dc->nbuckets) chunk_table_grow(dc);
+    return c;
+}
+
+static void mapping_release(Mapping* m) {
+    if (!m || atomic_fetch_sub(&m->refs, 1) != 1) return;
+    munmap(m->base, m->len);
+    free(m);
+}
+
+static void chunk_remove(FFDiskCache* dc, Chunk* c) {
+    Chunk** pp = &dc->buckets[chunk_bucket(dc, &c->key, c->chunk)];
+    while (*pp != c) pp = &(*pp)->hnext;
+    *pp = c->hnext;
+    dc->nchunks--;
+    dc->stats.bytes_on_disk -= c->bytes;
+    mapping_release(c->map);   // frames still using it keep it alive
+    free(c->path);
+    free(c);
+}
+
+// Deletes least recently used chunks until the cache fits its quota.
+static void enforce_quota(FFDiskCache* dc) {
+    while (dc->stats.bytes_on_disk > dc->cfg.quota_bytes) {
+        Chunk* victim = NULL;
+        for (int i = 0; i < dc->nbuckets; ++i)
+            for (Chunk* c = dc->buckets[i]; c; c = c->hnext)
+                if (!c->writing && (!victim || c->last_used < victim->last_used)) victim = c;
+        if (!victim) return;
+        unlink(victim->path);
+        chunk_remove(dc, victim);
+        dc->stats.evicted_chunks++;
+    }
+}
+
+// Indexes the chunk files left by earlier runs.
+static void scan_root(FFDiskCache* dc) {
+    DIR* d = opendir(dc->root);
+    if (!d) return;
+    struct dirent* e;
+    while ((e = readdir(d))) {
+        FFDiskCacheKey k;
+        unsigned long long id;
+        char fmt[16];
+        if (sscanf(e->d_name, "%16llx-%dx%d-%15s", &id, &k.width, &k.height, fmt) != 4) continue;
+        if (format_from_name(fmt, &k.format) < 0) continue;
+        k.clip_id = id;
+
+        char dir[PATH_MAX];
+        key_dir(dc, &k, dir, sizeof(dir));
+        DIR* sub = opendir(dir);
+        if (!sub) continue;
+        struct dirent* f;
+        while ((f = readdir(sub))) {
+            long long chunk;
+            char tail[8];
+            if (sscanf(f->d_name, "%lld%7s", &chunk, tail) != 2 || strcmp(tail, DC_EXT) != 0) continue;
+            char path[PATH_MAX];
+            struct stat st;
+            if (snprintf(path, sizeof(path), "%s/%s", dir, f->d_name) >= (int)sizeof(path) || stat(path, &st) < 0) continue;
+#ifdef __APPLE__
+            int64_t mtime = (int64_t)st.st_mtimespec.tv_sec * 1000000000LL + st.st_mtimespec.tv_nsec;
+#else
+            int64_t mtime = (int64_t)st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec;
+#endif
+            chunk_add(dc, &k, chunk, (uint64_t)st.st_size, mtime);
+        }
+        closedir(sub);
+    }
+    closedir(d);
+}
+
+// ---- Reads ----
+
+// Maps the chunk's file as it is now (dc->lock held). Returns 0 or -1.
+static int chunk_map(FFDiskCache* dc, Chunk* c) {
+    int fd = open(c->path, O_RDONLY);
+    if (fd < 0) return -1;
+    struct stat st;
+    if (fstat(fd, &st) < 0 || (size_t)st.st_size < header_bytes(dc->cfg.frames_per_chunk)) {
+        close(fd);
+        return -1;
+    }
+    void* base = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) return -1;
+    Mapping* m = malloc(sizeof(*m));
+    if (!m) {
+        munmap(base, (size_t)st.st_size);
+        return -1;
+    }
+    atomic_init(&m->refs, 1);   // the chunk's reference
+    m->base = base;
+    m->len  = (size_t)st.st_size;
+    mapping_release(c->map);
+    c->map = m;
+    return 0;
+}
+
+static int header_matches(const ChunkHeader* h, const FFDiskCacheKey* k, int64_t first, int slots) {
+    return memcmp(h->magic, DC_MAGIC, 8) == 0 && (int)h->slots == slots && h->clip_id == k->clip_id &&
+           h->width == k->width && h->height == k->height && h->format == (int32_t)k->format &&
+           h->first_index == first;
+}
+
+// Finds frame `index`. On success returns 1 with a retained mapping, the slot and
+// its payload; 0 if not cached.
+static int locate(FFDiskCache* dc, const FFDiskCacheKey* k, int64_t index,
+                  Mapping** out_map, ChunkSlot* out_slot, const uint8_t** payload) {
+    if (index < 0) return 0;
+    int fpc = dc->cfg.frames_per_chunk;
+    int64_t chunk = index / fpc;
+    int slot = (int)(index % fpc);
+
+    pthread_mutex_lock(&dc->lock);
+    Chunk* c = chunk_find(dc, k, chunk);
+    int found = 0;
+    for (int attempt = 0; c && attempt < 2 && !found; ++attempt) {
+        if ((!c->map || attempt == 1) && chunk_map(dc, c) < 0) break;
+        const ChunkHeader* h = (const ChunkHeader*)c->map->base;
+        if (!header_matches(h, k, chunk * fpc, fpc)) break;
+        ChunkSlot s;
+        memcpy(&s, c->map->base + sizeof(ChunkHeader) + (size_t)slot * sizeof(ChunkSlot), sizeof(s));
+        if (s.offset == 0) break;
+        if (s.offset + s.size > c->map->len) continue;   // written after we mapped: remap
+        atomic_fetch_add(&c->map->refs, 1);
+        *out_map  = c->map;
+        *out_slot = s;
+        *payload  = c->map->base + s.offset;
+        found = 1;
+
+        c->last_used = realtime_ns();
+        if (!c->touched) {   // persist recency for the next session's eviction order
+            c->touched = 1;
+            utimensat(AT_FDCWD, c->path, NULL, 0);
+        }
+    }
+    if (found) dc->stats.hits++;
+    else dc->stats.misses++;
+    pthread_mutex_unlock(&dc->lock);
+    return found;
+}
+
+// Unpacks a stored frame into rows of `stride` bytes.
+static int unpack(const ChunkSlot* s, const uint8_t* payload, int row_bytes, int height,
+                  uint8_t* dst, int stride) {
+    size_t packed = (size_t)row_bytes * (size_t)height;
+    if (s->codec == FF_DISK_RAW) {
+        if (s->size != packed) return -1;
+        if (stride == row_bytes) {
+            memcpy(dst, payload, packed);
+        } else {
+            for (int y = 0; y < height; ++y)
+                memcpy(dst + (size_t)y * stride, payload + (size_t)y * row_bytes, (size_t)row_bytes);
+        }
+        return 0;
+    }
+    if (s->codec != FF_DISK_LZ4) return -1;
+    if (stride == row_bytes)
+        return ff_lz4_decompress(payload, s->size, dst, packed) == (long)packed ? 0 : -1;
+    uint8_t* tmp = malloc(packed);
+    if (!tmp) return -1;
+    int r = ff_lz4_decompress(payload, s->size, tmp, packed) == (long)packed ? 0 : -1;
+    for (int y = 0; r == 0 && y < height; ++y)
+        memcpy(dst + (size_t)y * stride, tmp + (size_t)y * row_bytes, (size_t)row_bytes);
+    free(tmp);
+    return r;
+}
+
+static void add_read_time(FFDiskCache* dc, int64_t t0) {
+    pthread_mutex_lock(&dc->lock);
+    dc->stats.read_ns += (uint64_t)(ff_now_ns() - t0);
+    pthread_mutex_unlock(&dc->lock);
+}
+
+static void mapping_frame_free(void* opaque) {
+    mapping_release(opaque);
+}
+
+FFFrameRef* ff_diskcache_get(FFDiskCache* dc, const FFDiskCacheKey* key, int64_t index) {
+    if (!dc || !key) return NULL;
+    int64_t t0 = ff_now_ns();
+    Mapping* m;
+    ChunkSlot s;
+    const uint8_t* payload;
+    if (!locate(dc, key, index, &m, &s, &payload)) return NULL;
+
+    int row_bytes = key->width * ff_pixfmt_bytes_per_pixel(key->format);
+    FFFrameRef* f = NULL;
+    if (s.codec == FF_DISK_RAW && s.size == (size_t)row_bytes * (size_t)key->height) {
+        FFFrameDesc d = { .data = { (uint8_t*)payload }, .linesize = { row_bytes },
+                          .width = key->width, .height = key->height, .format = key->format,
+                          .pts = NAN, .index = index, .free = mapping_frame_free, .opaque = m };
+        f = ff_frame_wrap(&d);
+        if (f) m = NULL;   // the frame owns the mapping reference now
+    } else {
+        f = ff_frame_alloc(key->width, key->height, key->format);
+        if (f && unpack(&s, payload, row_bytes, key->height, ff_frame_plane(f, 0), ff_frame_stride(f, 0)) < 0) {
+            ff_frame_release(f);
+            f = NULL;
+        }
+        if (f) ff_frame_set_timing(f, NAN, index);
+    }
+    mapping_release(m);
+    add_read_time(dc, t0);
+    return f;
+}
+
+int ff_diskcache_read_into(FFDiskCache* dc, const FFDiskCacheKey* key, int64_t index, FFSinkImage* img) {
+    if (!dc || !key || !img || img->width != key->width || img->height != key->height ||
+        img->format != key->format) return -1;
+    int64_t t0 = ff_now_ns();
+    Mapping* m;
+    ChunkSlot s;
+    const uint8_t* payload;
+    if (!locate(dc, key, index, &m, &s, &payload)) return 0;
+    int row_bytes = key->width * ff_pixfmt_bytes_per_pixel(key->format);
+    int r = unpack(&s, payload, row_bytes, key->height, img->data[0], img->linesize[0]) < 0 ? -1 : 1;
+    mapping_release(m);
+    add_read_time(dc, t0);
+    return r;
+}
+
+int ff_diskcache_contains(FFDiskCache* dc, const FFDiskCacheKey* key, int64_t index) {
+    if (!dc || !key || index < 0) return 0;
+    int fpc = dc->cfg.frames_per_chunk;
+    pthread_mutex_lock(&dc->lock);
+    Chunk* c = chunk_find(dc, key, index / fpc);
+    int r = 0;
+    if (c && (c->map || chunk_map(dc, c) == 0)) {
+        ChunkSlot s;
+        memcpy(&s, c->map->base + sizeof(ChunkHeader) + (size_t)(index % fpc) * sizeof(ChunkSlot), sizeof(s));
+        r = s.offset != 0;
+    }
+    pthread_mutex_unlock(&dc->lock);
+    return r;
+}
+
+// ---- Writes (writer thread) ----
+
+static int write_full_at(int fd, const void* buf, size_t n, off_t off) {
+    const uint8_t* p = buf;
+    while (n > 0) {
+        ssize_t w = pwrite(fd, p, n, off);
+        if (w < 0 && errno == EINTR) continue;
+        if (w <= 0) return -1;
+        p += w;
+        n -= (size_t)w;
+        off += w;
+    }
+    return 0;
+}
+
+static int sync_data(int fd) {
+#ifdef __APPLE__
+    return fsync(fd);
+#else
+    return fdatasync(fd);
+#endif
+}
+
+// Opens the chunk file for appending, writing a fresh header if it is new or
+// does not match. Returns the fd or -1.
+static int open_chunk_for_write(FFDiskCache* dc, Chunk* c, off_t* size) {
+    char dir[PATH_MAX];
+    key_dir(dc, &c->key, dir, sizeof(dir));
+    if (mkdir_p(dir) < 0) return -1;
+    int fd = open(c->path, O_RDWR | O_CREAT, 0644);
+    if (fd < 0) return -1;
+    int fpc = dc->cfg.frames_per_chunk;
+    size_t hb = header_bytes(fpc);
+    struct stat st;
+    ChunkHeader h;
+    if (fstat(fd, &st) == 0 && (size_t)st.st_size >= hb && pread(fd, &h, sizeof(h), 0) == (ssize_t)sizeof(h) &&
+        header_matches(&h, &c->key, c->chunk * fpc, fpc)) {
+        *size = st.st_size;
+        return fd;
+    }
+    // New (or foreign) file: start over with an empty slot table.
+    uint8_t* buf = calloc(1, hb);
+    if (!buf || ftruncate(fd, 0) < 0) goto fail;
+    ChunkHeader* nh = (ChunkHeader*)buf;
+    memcpy(nh->magic, DC_MAGIC, 8);
+    nh->slots       = (uint32_t)fpc;
+    nh->clip_id     = c->key.clip_id;
+    nh->width       = c->key.width;
+    nh->height      = c->key.height;
+    nh->format      = (int32_t)c->key.format;
+    nh->row_bytes   = c->key.width * ff_pixfmt_bytes_per_pixel(c->key.format);
+    nh->first_index = c->chunk * fpc;
+    if (write_full_at(fd, buf, hb, 0) < 0) goto fail;
+    free(buf);
+    *size = (off_t)hb;
+    return fd;
+fail:
+    free(buf);
+    close(fd);
+    return -1;
+}
+
+static void write_frame(FFDiskCache* dc, const FFDiskCacheKey* k, FFFrameRef* f) {
+    int fpc = dc->cfg.frames_per_chunk;
+    int64_t index = ff_frame_index(f);
+    int64_t chunk = index / fpc;
+    int slot = (int)(index % fpc);
+    int row_bytes = k->width * ff_pixfmt_bytes_per_pixel(k->format);
+    size_t packed = (size_t)row_bytes * (size_t)k->height;
+
+    pthread_mutex_lock(&dc->lock);
+    Chunk* c = chunk_find(dc, k, chunk);
+    if (!c) c = chunk_add(dc, k, chunk, 0, realtime_ns());
+    if (c) c->writing = 1;
+    pthread_mutex_unlock(&dc->lock);
+    if (!c) return;
+
+    off_t size = 0;
+    int fd = open_chunk_for_write(dc, c, &size);
+    ChunkSlot s = { 0 };
+    off_t slot_off = (off_t)(sizeof(ChunkHeader) + (size_t)slot * sizeof(ChunkSlot));
+    if (fd < 0 || pread(fd, &s, sizeof(s), slot_off) != (ssize_t)sizeof(s) || s.offset != 0) goto done;
+
+    // Pack the rows, then compress if that pays.
+    if (dc->scratch_size < packed) {
+        free(dc->pack);
+        free(dc->packed_lz4);
+        dc->pack       = malloc(packed);
+        dc->packed_lz4 = dc->cfg.codec == FF_DISK_LZ4 ? malloc(ff_lz4_bound(packed)) : NULL;
+        dc->scratch_size = dc->pack ? packed : 0;
+        if (!dc->pack) goto done;
+    }
+    const uint8_t* src = ff_frame_plane(f, 0);
+    int stride = ff_frame_stride(f, 0);
+    const uint8_t* payload = src;
+    if (stride != row_bytes) {
+        for (int y = 0; y < k->height; ++y)
+            memcpy(dc->pack + (size_t)y * row_bytes, src + (size_t)y * stride, (size_t)row_bytes);
+        payload = dc->pack;
+    }
+    s.codec = FF_DISK_RAW;
+    s.size  = (uint32_t)packed;
+    if (dc->cfg.codec == FF_DISK_LZ4 && dc->packed_lz4) {
+        size_t n = ff_lz4_compress(payload, packed, dc->packed_lz4, ff_lz4_bound(packed));
+        if (n > 0 && n < packed) {
+            payload = dc->packed_lz4;
+            s.codec = FF_DISK_LZ4;
+            s.size  = (uint32_t)n;
+        }
+    }
+    s.offset = ((uint64_t)size + DC_PAGE - 1) / DC_PAGE * DC_PAGE;
+
+    // Payload first and on disk, then the slot that points at it.
+    if (write_full_at(fd, payload, s.size, (off_t)s.offset) < 0 || sync_data(fd) < 0 ||
+        write_full_at(fd, &s, sizeof(s), slot_off) < 0) goto done;
+
+    pthread_mutex_lock(&dc->lock);
+    uint64_t new_bytes = s.offset + s.size;
+    dc->stats.bytes_on_disk += new_bytes - c->bytes;
+    c->bytes     = new_bytes;
+    c->last_used = realtime_ns();
+    dc->stats.writes++;
+    dc->stats.raw_bytes_written    += packed;
+    dc->stats.stored_bytes_written += s.size;
+    pthread_mutex_unlock(&dc->lock);
+
+done:
+    if (fd >= 0) close(fd);
+    pthread_mutex_lock(&dc->lock);
+    c->writing = 0;
+    enforce_quota(dc);
+    pthread_mutex_unlock(&dc->lock);
+}
+
+static void* writer_main(void* arg) {
+    FFDiskCache* dc = arg;
+    pthread_mutex_lock(&dc->lock);
+    for (;;) {
+        while (dc->count == 0 && !dc->stopping) ff_cond_wait_ns(&dc->job_cv, &dc->lock, -1);
+        if (dc->count == 0) break;   // stopping and drained
+        WriteJob job = dc->jobs[dc->head];
+        dc->head = (dc->head + 1) % dc->cfg.queue_depth;
+        dc->count--;
+        dc->busy = 1;
+        pthread_mutex_unlock(&dc->lock);
+
+        write_frame(dc, &job.key, job.f);
+        ff_frame_release(job.f);
+
+        pthread_mutex_lock(&dc->lock);
+        dc->busy = 0;
+        if (dc->count == 0) pthread_cond_broadcast(&dc->idle_cv);
+    }
+    pthread_mutex_unlock(&dc->lock);
+    return NULL;
+}
+
+int ff_diskcache_put(FFDiskCache* dc, const FFDiskCacheKey* key, FFFrameRef* f) {
+    if (!dc || !key || !f || ff_frame_index(f) < 0 || ff_frame_width(f) != key->width ||
+        ff_frame_height(f) != key->height || ff_frame_format(f) != key->format) return -1;
+    if (ff_diskcache_contains(dc, key, ff_frame_index(f))) return 0;
+    pthread_mutex_lock(&dc->lock);
+    int r = 0;
+    if (dc->count == dc->cfg.queue_depth) {
+        dc->stats.write_drops++;
+    } else {
+        WriteJob* j = &dc->jobs[(dc->head + dc->count) % dc->cfg.queue_depth];
+        j->key = *key;
+        j->f   = ff_frame_retain(f);
+        dc->count++;
+        pthread_cond_signal(&dc->job_cv);
+        r = 1;
+    }
+    pthread_mutex_unlock(&dc->lock);
+    return r;
+}
+
+void ff_diskcache_flush(FFDiskCache* dc) {
+    if (!dc) return;
+    pthread_mutex_lock(&dc->lock);
+    while (dc->count > 0 || dc->busy) ff_cond_wait_ns(&dc->idle_cv, &dc->lock, -1);
+    pthread_mutex_unlock(&dc->lock);
+}
+
+// ---- Lifetime ----
+
+FFDiskCache* ff_diskcache_open(const FFDiskCacheConfig* cfg) {
+    if (!cfg || !cfg->root || (cfg->codec != FF_DISK_RAW && cfg->codec != FF_DISK_LZ4)) return NULL;
+    FFDiskCache* dc = calloc(1, sizeof(*dc));
+    if (!dc) return NULL;
+    dc->cfg = *cfg;
+    if (dc->cfg.quota_bytes == 0) dc->cfg.quota_bytes = 16ULL << 30;
+    if (dc->cfg.frames_per_chunk <= 0) dc->cfg.frames_per_chunk = 32;
+    if (dc->cfg.queue_depth <= 0) dc->cfg.queue_depth = 8;
+    dc->root     = strdup(cfg->root);
+    dc->cfg.root = dc->root;
+    dc->nbuckets = 64;
+    dc->buckets  = calloc((size_t)dc->nbuckets, sizeof(*dc->buckets));
+    dc->jobs     = calloc((size_t)dc->cfg.queue_depth, sizeof(*dc->jobs));
+    if (!dc->root || !dc->buckets || !dc->jobs || mkdir_p(dc->root) < 0) {
+        free(dc->root);
+        free(dc->buckets);
+        free(dc->jobs);
+        free(dc);
+        return NULL;
+    }
+    pthread_mutex_init(&dc->lock, NULL);
+    ff_cond_init(&dc->job_cv);
+    ff_cond_init(&dc->idle_cv);
+
+    scan_root(dc);
+    enforce_quota(dc);   // the quota may have shrunk since the last run
+
+    if (pthread_create(&dc->writer, NULL, writer_main, dc) != 0) {
+        dc->stopping = 1;   // no writer: close skips the join
+        ff_diskcache_close(dc);
+        return NULL;
+    }
+    return dc;
+}
+
+void ff_diskcache_close(FFDiskCache* dc) {
+    if (!dc) return;
+    pthread_mutex_lock(&dc->lock);
+    int had_writer = !dc->stopping;
+    dc->stopping = 1;
+    pthread_cond_broadcast(&dc->job_cv);
+    pthread_mutex_unlock(&dc->lock);
+    if (had_writer) pthread_join(dc->writer, NULL);
+
+    for (int i = 0; i < dc->nbuckets; ++i) {
+        while (dc->buckets[i]) {
+            Chunk* c = dc->buckets[i];
+            dc->buckets[i] = c->hnext;
+            mapping_release(c->map);
+            free(c->path);
+            free(c);
+        }
+    }
+    pthread_mutex_destroy(&dc->lock);
+    pthread_cond_destroy(&dc->job_cv);
+    pthread_cond_destroy(&dc->idle_cv);
+    free(dc->buckets);
+    free(dc->jobs);
+    free(dc->pack);
+    free(dc->packed_lz4);
+    free(dc->root);
+    free(dc);
+}
+
+void ff_diskcache_get_stats(FFDiskCache* dc, FFDiskCacheStats* out) {
+    if (!dc || !out) return;
+    pthread_mutex_lock(&dc->lock);
+    *out = dc->stats;
+    pthread_mutex_unlock(&dc->lock);
+}
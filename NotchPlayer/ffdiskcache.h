@@ -0,0 +1,85 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include "ffframe.h"
+#include "ffsink.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Persistent cache of converted frames under a directory, for clips that are
+// played again and again. Frames are grouped in chunk files of consecutive
+// frames per (clip identity, output format, size); each frame is stored raw or
+// LZ4-compressed. Chunk files are memory-mapped for reads: raw frames are
+// handed out straight from the mapping, compressed ones decode with no video
+// decode at all. Writes happen on a background thread (a full queue drops
+// frames rather than stalling playback). Whole chunks are evicted, least
+// recently used first, to stay within a disk quota.
+//
+// Layout: <root>/<clip id>-<w>x<h>-<format>/<chunk>.nfc. A chunk file is a
+// header with one slot per frame (offset, size, codec) followed by the frame
+// payloads. A slot is filled only after its payload is on disk, so a crash
+// leaves at worst a missing frame.
+typedef struct FFDiskCache FFDiskCache;
+
+typedef enum FFDiskCodec {
+    FF_DISK_RAW = 0,
+    FF_DISK_LZ4,           // falls back to raw for frames that do not compress
+} FFDiskCodec;
+
+typedef struct FFDiskCacheConfig {
+    const char* root;               // created if missing
+    uint64_t    quota_bytes;        // 0 = 16 GiB
+    FFDiskCodec codec;
+    int         frames_per_chunk;   // 0 = 32
+    int         queue_depth;        // frames waiting to be written; 0 = 8
+} FFDiskCacheConfig;
+
+// What a cached frame belongs to.
+typedef struct FFDiskCacheKey {
+    uint64_t      clip_id;          // see ff_diskcache_clip_id
+    int           width, height;
+    FFPixelFormat format;
+} FFDiskCacheKey;
+
+typedef struct FFDiskCacheStats {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t writes;                // frames stored
+    uint64_t write_drops;           // frames not queued (queue full)
+    uint64_t raw_bytes_written;     // frame bytes before compression
+    uint64_t stored_bytes_written;  // bytes actually written
+    uint64_t evicted_chunks;
+    uint64_t bytes_on_disk;
+    uint64_t read_ns;               // time spent in reads (mapping + decompression)
+} FFDiskCacheStats;
+
+// Identity of a clip file: its path, size and modification time, hashed, so an
+// edited or replaced file gets a fresh cache. Returns 0 or -1 if it cannot be stat'ed.
+int          ff_diskcache_clip_id(const char* path, uint64_t* out);
+
+// Opens (or creates) the cache directory and indexes existing chunks. NULL on failure.
+FFDiskCache* ff_diskcache_open(const FFDiskCacheConfig* cfg);
+// Writes out queued frames, then closes. Frames handed out stay valid.
+void         ff_diskcache_close(FFDiskCache* dc);
+
+// Frame `index` with one reference, or NULL. Raw frames reference the mapped
+// file directly (zero copy); LZ4 frames are decompressed into fresh memory.
+FFFrameRef*  ff_diskcache_get(FFDiskCache* dc, const FFDiskCacheKey* key, int64_t index);
+// Decodes frame `index` into `img` (key's size and format). Returns 1 if found,
+// 0 if not cached, -1 on error.
+int          ff_diskcache_read_into(FFDiskCache* dc, const FFDiskCacheKey* key, int64_t index, FFSinkImage* img);
+int          ff_diskcache_contains(FFDiskCache* dc, const FFDiskCacheKey* key, int64_t index);
+
+// Queues `f` (retained) to be stored under ff_frame_index(f). Returns 1 if
+// queued, 0 if already cached or the queue is full, -1 on error.
+int          ff_diskcache_put(FFDiskCache* dc, const FFDiskCacheKey* key, FFFrameRef* f);
+// Waits until every queued frame is written.
+void         ff_diskcache_flush(FFDiskCache* dc);
+
+void         ff_diskcache_get_stats(FFDiskCache* dc, FFDiskCacheStats* out);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,314 @@
+#ifdef __linux__
+#define _GNU_SOURCE   // sendmmsg
+#endif
+#include "ffdmx.h"
+#include "ffutil.h"
+#include <math.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#define ARTNET_HEADER 18
+#define ARTSYNC_SIZE  14
+#define SACN_HEADER   126
+#define PACKET_MAX    (SACN_HEADER + FF_DMX_SLOTS)
+
+struct FFDmxSender {
+    FFDmxSenderConfig  cfg;
+    int                fd;
+    struct sockaddr_in dest;          // unicast / broadcast destination
+    int                multicast;     // sACN without a host: per-universe groups
+    uint8_t            cid[16];       // sACN component identifier
+    char               source_name[64];
+
+    // Per-universe sequence numbers, indexed by universe number.
+    uint8_t*           seq;
+    int                seq_count;
+
+    uint8_t*           buf;           // packets of the current burst
+    struct sockaddr_in* to;
+    size_t*            len;
+    int                cap;           // packets buf has room for
+
+    pthread_mutex_t    stats_lock;
+    FFDmxSendStats     stats;
+    int64_t            last_start_ns;
+    double             interval_m2;   // Welford accumulator for the jitter
+    uint64_t           late_count;
+};
+
+static void put_be16(uint8_t* p, unsigned v) {
+    p[0] = (uint8_t)(v >> 8);
+    p[1] = (uint8_t)v;
+}
+
+static void put_be32(uint8_t* p, uint32_t v) {
+    put_be16(p, v >> 16);
+    put_be16(p + 2, v & 0xffff);
+}
+
+static size_t build_artdmx(uint8_t* p, int universe, uint8_t seq, const uint8_t* data, int length) {
+    memcpy(p, "Art-Net", 8);
+    p[8]  = 0x00; p[9] = 0x50;               // OpDmx, little-endian
+    p[10] = 0;    p[11] = 14;                // protocol version
+    p[12] = seq;
+    p[13] = 0;                               // physical port
+    p[14] = (uint8_t)(universe & 0xff);      // SubUni
+    p[15] = (uint8_t)((universe >> 8) & 0x7f);   // Net
+    put_be16(p + 16, (unsigned)length);
+    memcpy(p + ARTNET_HEADER, data, (size_t)length);
+    return ARTNET_HEADER + (size_t)length;
+}
+
+static size_t build_artsync(uint8_t* p) {
+    memcpy(p, "Art-Net", 8);
+    p[8]  = 0x00; p[9] = 0x52;               // OpSync
+    p[10] = 0;    p[11] = 14;
+    p[12] = 0;    p[13] = 0;
+    return ARTSYNC_SIZE;
+}
+
+// E1.31 data packet: root layer, framing layer, DMP layer, start code + slots.
+static size_t build_sacn(const FFDmxSender* s, uint8_t* p, int universe, uint8_t seq,
+                         const uint8_t* data, int length) {
+    size_t total = SACN_HEADER + (size_t)length;
+    memset(p, 0, SACN_HEADER);
+    put_be16(p + 0, 0x0010);                 // preamble size
+    memcpy(p + 4, "ASC-E1.17\0\0\0", 12);
+    put_be16(p + 16, 0x7000 | (unsigned)(total - 16));
+    put_be32(p + 18, 0x00000004);            // VECTOR_ROOT_E131_DATA
+    memcpy(p + 22, s->cid, 16);
+
+    put_be16(p + 38, 0x7000 | (unsigned)(total - 38));
+    put_be32(p + 40, 0x00000002);            // VECTOR_E131_DATA_PACKET
+    memcpy(p + 44, s->source_name, 64);
+    p[108] = (uint8_t)(s->cfg.priority);
+    p[111] = seq;
+    put_be16(p + 113, (unsigned)universe);
+
+    put_be16(p + 115, 0x7000 | (unsigned)(total - 115));
+    p[117] = 0x02;                           // VECTOR_DMP_SET_PROPERTY
+    p[118] = 0xa1;
+    put_be16(p + 121, 1);                    // address increment
+    put_be16(p + 123, (unsigned)length + 1);
+    p[125] = 0;                              // DMX start code
+    memcpy(p + SACN_HEADER, data, (size_t)length);
+    return total;
+}
+
+static void make_cid(uint8_t cid[16]) {
+    FILE* f = fopen("/dev/urandom", "rb");
+    size_t got = f ? fread(cid, 1, 16, f) : 0;
+    if (f) fclose(f);
+    if (got == 16) return;
+    uint64_t a = (uint64_t)ff_now_ns() ^ ((uint64_t)getpid() << 32);
+    for (int i = 0; i < 16; ++i) {
+        a = a * 6364136223846793005ULL + 1442695040888963407ULL;
+        cid[i] = (uint8_t)(a >> 56);
+    }
+}
+
+FFDmxSender* ff_dmx_sender_create(const FFDmxSenderConfig* cfg) {
+    if (!cfg || (cfg->protocol != FF_DMX_ARTNET && cfg->protocol != FF_DMX_SACN)) return NULL;
+    if (cfg->priority < 0 || cfg->priority > 200) return NULL;
+    FFDmxSender* s = calloc(1, sizeof(*s));
+    if (!s) return NULL;
+    s->fd  = -1;
+    s->cfg = *cfg;
+    s->cfg.host = NULL;   // not owned
+    if (s->cfg.priority == 0) s->cfg.priority = 100;
+    if (s->cfg.port == 0) s->cfg.port = cfg->protocol == FF_DMX_SACN ? FF_SACN_PORT : FF_ARTNET_PORT;
+    snprintf(s->source_name, sizeof(s->source_name), "%s", cfg->source_name ? cfg->source_name : "NotchPlayer");
+    make_cid(s->cid);
+    pthread_mutex_init(&s->stats_lock, NULL);
+
+    s->fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (s->fd < 0) goto fail;
+    int on = 1;
+    setsockopt(s->fd, SOL_SOCKET, SO_BROADCAST, &on, sizeof(on));
+
+    s->dest.sin_family = AF_INET;
+    s->dest.sin_port   = htons((uint16_t)s->cfg.port);
+    if (cfg->host) {
+        struct addrinfo hints, *res = NULL;
+        memset(&hints, 0, sizeof(hints));
+        hints.ai_family   = AF_INET;
+        hints.ai_socktype = SOCK_DGRAM;
+        if (getaddrinfo(cfg->host, NULL, &hints, &res) != 0 || !res) goto fail;
+        s->dest.sin_addr = ((struct sockaddr_in*)res->ai_addr)->sin_addr;
+        freeaddrinfo(res);
+    } else if (cfg->protocol == FF_DMX_SACN) {
+        s->multicast = 1;
+    } else {
+        s->dest.sin_addr.s_addr = htonl(INADDR_BROADCAST);
+    }
+    return s;
+
+fail:
+    ff_dmx_sender_destroy(s);
+    return NULL;
+}
+
+void ff_dmx_sender_destroy(FFDmxSender* s) {
+    if (!s) return;
+    if (s->fd >= 0) close(s->fd);
+    pthread_mutex_destroy(&s->stats_lock);
+    free(s->seq);
+    free(s->buf);
+    free(s->to);
+    free(s->len);
+    free(s);
+}
+
+static int reserve(FFDmxSender* s, int packets, int max_universe) {
+    if (max_universe >= s->seq_count) {
+        uint8_t* seq = realloc(s->seq, (size_t)max_universe + 1);
+        if (!seq) return -1;
+        memset(seq + s->seq_count, 0, (size_t)(max_universe + 1 - s->seq_count));
+        s->seq = seq;
+        s->seq_count = max_universe + 1;
+    }
+    if (packets > s->cap) {
+        uint8_t* buf = realloc(s->buf, (size_t)packets * PACKET_MAX);
+        if (buf) s->buf = buf;
+        struct sockaddr_in* to = realloc(s->to, (size_t)packets * sizeof(*to));
+        if (to) s->to = to;
+        size_t* len = realloc(s->len, (size_t)packets * sizeof(*len));
+        if (len) s->len = len;
+        if (!buf || !to || !len) return -1;
+        s->cap = packets;
+    }
+    return 0;
+}
+
+// Sends packets [0, n) of the current burst, counting them in the stats.
+static void send_burst(FFDmxSender* s, int n) {
+#ifdef __linux__
+    struct mmsghdr msgs[64];
+    struct iovec   iov[64];
+    int sent = 0;
+    while (sent < n) {
+        int batch = n - sent < 64 ? n - sent : 64;
+        for (int i = 0; i < batch; ++i) {
+            iov[i].iov_base = s->buf + (size_t)(sent + i) * PACKET_MAX;
+            iov[i].iov_len  = s->len[sent + i];
+            memset(&msgs[i], 0, sizeof(msgs[i]));
+            msgs[i].msg_hdr.msg_name    = &s->to[sent + i];
+            msgs[i].msg_hdr.msg_namelen = sizeof(s->to[sent + i]);
+            msgs[i].msg_hdr.msg_iov     = &iov[i];
+            msgs[i].msg_hdr.msg_iovlen  = 1;
+        }
+        int r = sendmmsg(s->fd, msgs, (unsigned)batch, 0);
+        if (r <= 0) {
+            ++sent;   // skip the packet that failed and carry on
+            s->stats.errors++;
+            continue;
+        }
+        for (int i = 0; i < r; ++i) s->stats.bytes += msgs[i].msg_len;
+        sent += r;
+        s->stats.packets += (uint64_t)r;
+    }
+#else
+    for (int i = 0; i < n; ++i) {
+        ssize_t r = sendto(s->fd, s->buf + (size_t)i * PACKET_MAX, s->len[i], 0,
+                           (const struct sockaddr*)&s->to[i], sizeof(s->to[i]));
+        if (r < 0) {
+            s->stats.errors++;
+        } else {
+            s->stats.packets++;
+            s->stats.bytes += (uint64_t)r;
+        }
+    }
+#endif
+}
+
+int ff_dmx_send_frame(FFDmxSender* s, const FFPixelMap* m, int64_t deadline_ns) {
+    if (!s || !m) return -1;
+    int nuniv = ff_pixmap_universe_count(m);
+    int max_universe = 0;
+    for (int i = 0; i < nuniv; ++i) {
+        int u;
+        ff_pixmap_universe(m, i, &u, NULL);
+        if (s->cfg.protocol == FF_DMX_SACN ? (u < 1 || u > 63999) : u > 0x7fff) return -1;
+        if (u > max_universe) max_universe = u;
+    }
+    int npackets = nuniv + (s->cfg.protocol == FF_DMX_ARTNET && s->cfg.artsync ? 1 : 0);
+    if (reserve(s, npackets, max_universe) < 0) return -1;
+
+    // Build the whole burst before the deadline...
+    for (int i = 0; i < nuniv; ++i) {
+        int u, length;
+        const uint8_t* data = ff_pixmap_universe(m, i, &u, &length);
+        uint8_t* p = s->buf + (size_t)i * PACKET_MAX;
+        if (s->cfg.protocol == FF_DMX_SACN) {
+            uint8_t seq = s->seq[u]++;
+            s->len[i] = build_sacn(s, p, u, seq, data, length);
+        } else {
+            uint8_t seq = (uint8_t)(s->seq[u] % 255 + 1);   // 0 disables sequencing
+            s->seq[u] = seq;
+            s->len[i] = build_artdmx(p, u, seq, data, length);
+        }
+        s->to[i] = s->dest;
+        if (s->multicast)
+            s->to[i].sin_addr.s_addr = htonl(0xefff0000u | (uint32_t)u);   // 239.255.hi.lo
+    }
+    if (npackets > nuniv) {
+        s->len[nuniv] = build_artsync(s->buf + (size_t)nuniv * PACKET_MAX);
+        s->to[nuniv]  = s->dest;
+    }
+
+    // ...then send it back to back at the deadline.
+    if (deadline_ns > 0) ff_sleep_until_ns(deadline_ns);
+
+    pthread_mutex_lock(&s->stats_lock);
+    int64_t start = ff_now_ns();
+    uint64_t before = s->stats.packets;
+    send_burst(s, npackets);
+    int sent = (int)(s->stats.packets - before);
+    int64_t end = ff_now_ns();
+
+    FFDmxSendStats* st = &s->stats;
+    if (st->frames > 0) {
+        int64_t iv = start - s->last_start_ns;
+        uint64_t k = st->frames;   // intervals so far, including this one
+        if (k == 1 || iv < st->interval_min_ns) st->interval_min_ns = iv;
+        if (k == 1 || iv > st->interval_max_ns) st->interval_max_ns = iv;
+        double d = (double)iv - st->interval_mean_ns;
+        st->interval_mean_ns += d / (double)k;
+        s->interval_m2 += d * ((double)iv - st->interval_mean_ns);
+        st->jitter_ns = k > 1 ? sqrt(s->interval_m2 / (double)(k - 1)) : 0.0;
+    }
+    if (deadline_ns > 0) {
+        int64_t late = start - deadline_ns;
+        s->late_count++;
+        st->late_mean_ns += ((double)late - st->late_mean_ns) / (double)s->late_count;
+        if (late > st->late_max_ns) st->late_max_ns = late;
+    }
+    if (end - start > st->burst_max_ns) st->burst_max_ns = end - start;
+    st->frames++;
+    s->last_start_ns = start;
+    pthread_mutex_unlock(&s->stats_lock);
+
+    return sent > 0 || npackets == 0 ? sent : -1;
+}
+
+void ff_dmx_sender_stats(FFDmxSender* s, FFDmxSendStats* out) {
+    if (!s || !out) return;
+    pthread_mutex_lock(&s->stats_lock);
+    *out = s->stats;
+    pthread_mutex_unlock(&s->stats_lock);
+}
+
+void ff_dmx_sender_reset_stats(FFDmxSender* s) {
+    if (!s) return;
+    pthread_mutex_lock(&s->stats_lock);
+    memset(&s->stats, 0, sizeof(s->stats));
+    s->interval_m2 = 0;
+    s->late_count  = 0;
+    pthread_mutex_unlock(&s->stats_lock);
+}
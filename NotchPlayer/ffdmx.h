@@ -0,0 +1,61 @@
+#pragma once
+#include <stdint.h>
+#include "ffpixmap.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Sends a pixel map's DMX universes over UDP as Art-Net (ArtDmx) or sACN
+// (E1.31). Each frame goes out as one burst: every packet is built first, then
+// the sender waits for the frame's deadline and sends them back to back, so
+// fixtures update in step with the video.
+typedef struct FFDmxSender FFDmxSender;
+
+typedef enum FFDmxProtocol {
+    FF_DMX_ARTNET = 0,
+    FF_DMX_SACN,          // universes 1..63999
+} FFDmxProtocol;
+
+#define FF_ARTNET_PORT 6454
+#define FF_SACN_PORT   5568
+
+typedef struct FFDmxSenderConfig {
+    FFDmxProtocol protocol;
+    // Destination IPv4 address or host name. NULL = broadcast (Art-Net) or the
+    // standard per-universe multicast group 239.255.hi.lo (sACN).
+    const char*   host;
+    int           port;          // 0 = protocol default
+    int           artsync;       // Art-Net: follow each burst with ArtSync so nodes latch together
+    const char*   source_name;   // sACN; NULL = "NotchPlayer"
+    int           priority;      // sACN 0..200; 0 = 100
+} FFDmxSenderConfig;
+
+typedef struct FFDmxSendStats {
+    uint64_t frames;             // bursts sent
+    uint64_t packets;
+    uint64_t bytes;
+    uint64_t errors;             // failed sends
+    // Interval between consecutive burst starts; jitter is its standard deviation.
+    int64_t  interval_min_ns, interval_max_ns;
+    double   interval_mean_ns, jitter_ns;
+    // Burst start relative to the requested deadline (bursts that had one).
+    int64_t  late_max_ns;
+    double   late_mean_ns;
+    int64_t  burst_max_ns;       // time to send one frame's packets
+} FFDmxSendStats;
+
+FFDmxSender* ff_dmx_sender_create(const FFDmxSenderConfig* cfg);
+void         ff_dmx_sender_destroy(FFDmxSender* s);
+
+// Sends every universe of `m`. If deadline_ns (ff_now_ns clock) is > 0 the
+// burst starts no earlier than that. Returns the number of packets sent, or <0
+// if a universe cannot be sent with this protocol or every send failed.
+int          ff_dmx_send_frame(FFDmxSender* s, const FFPixelMap* m, int64_t deadline_ns);
+
+void         ff_dmx_sender_stats(FFDmxSender* s, FFDmxSendStats* out);
+void         ff_dmx_sender_reset_stats(FFDmxSender* s);
+
+#ifdef __cplusplus
+}
+#endif
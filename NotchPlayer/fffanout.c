@@ -0,0 +1,363 @@
+#include "fffanout.h"
+#include "ffutil.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define FF_FANOUT_DEFAULT_DEPTH 4
+
+struct FFFanoutOutput {
+    FFFanoutOutputConfig cfg;
+    char                 name[64];
+
+    pthread_mutex_t      lock;
+    pthread_cond_t       cv;          // frame queued, room freed, ended or closed
+    FFFrameRef**         q;
+    int                  head, len;
+    int                  ended;       // no more frames will be pushed
+    int                  closed;      // removed: stop delivering now
+    atomic_int           refs;        // registration + pushes in flight
+
+    pthread_t            thread;      // push-mode delivery thread
+    int                  has_thread;
+    FFFanoutOutputStats  st;
+};
+
+struct FFFanout {
+    pthread_mutex_t  lock;
+    FFFanoutOutput*  outs[FF_FANOUT_MAX_OUTPUTS];
+    int              nout;
+    int              ended;
+
+    FFFrameSource    src;
+    pthread_t        pump;
+    int              pump_running;
+    atomic_int       stop;
+    int              pump_rc;
+};
+
+// ---- Outputs ----
+
+static void out_unref(FFFanoutOutput* o) {
+    if (atomic_fetch_sub(&o->refs, 1) > 1) return;
+    for (int i = 0; i < o->len; ++i) ff_frame_release(o->q[(o->head + i) % o->cfg.queue_depth]);
+    pthread_mutex_destroy(&o->lock);
+    pthread_cond_destroy(&o->cv);
+    free(o->q);
+    free(o);
+}
+
+// Takes the oldest queued frame. Caller holds o->lock and checked len > 0.
+static FFFrameRef* out_take_locked(FFFanoutOutput* o) {
+    FFFrameRef* f = o->q[o->head];
+    o->head = (o->head + 1) % o->cfg.queue_depth;
+    o->len--;
+    return f;
+}
+
+// Queues a reference to `f` following the output's drop policy. Returns 1 if queued.
+static int out_offer(FFFanout* fo, FFFanoutOutput* o, FFFrameRef* f) {
+    pthread_mutex_lock(&o->lock);
+    o->st.pushed++;
+    if (o->closed) {
+        pthread_mutex_unlock(&o->lock);
+        return 0;
+    }
+
+    if (o->len == o->cfg.queue_depth) {
+        switch (o->cfg.policy) {
+        case FF_DROP_OLDEST:
+            ff_frame_release(out_take_locked(o));
+            o->st.dropped++;
+            break;
+        case FF_DROP_NEWEST:
+            o->st.dropped++;
+            pthread_mutex_unlock(&o->lock);
+            return 0;
+        case FF_DROP_BLOCK: {
+            int64_t t0 = ff_now_ns();
+            int64_t limit = o->cfg.block_timeout_ms < 0 ? -1 : (int64_t)o->cfg.block_timeout_ms * 1000000;
+            while (o->len == o->cfg.queue_depth && !o->closed && !atomic_load(&fo->stop)) {
+                int64_t left = limit < 0 ? -1 : limit - (ff_now_ns() - t0);
+                if (limit >= 0 && left <= 0) break;
+                ff_cond_wait_ns(&o->cv, &o->lock, left);
+            }
+            o->st.block_ns += (uint64_t)(ff_now_ns() - t0);
+            if (o->len == o->cfg.queue_depth || o->closed) {
+                o->st.dropped++;
+                pthread_mutex_unlock(&o->lock);
+                return 0;
+            }
+            break;
+        }
+        }
+    }
+
+    o->q[(o->head + o->len) % o->cfg.queue_depth] = ff_frame_retain(f);
+    o->len++;
+    if (o->len > o->st.high_water) o->st.high_water = o->len;
+    pthread_cond_broadcast(&o->cv);
+    pthread_mutex_unlock(&o->lock);
+    return 1;
+}
+
+int ff_fanout_pop(FFFanoutOutput* o, int timeout_ms, FFFrameRef** f) {
+    if (!o || !f) return -1;
+    *f = NULL;
+    int64_t deadline = timeout_ms < 0 ? -1 : ff_now_ns() + (int64_t)timeout_ms * 1000000;
+
+    pthread_mutex_lock(&o->lock);
+    while (o->len == 0 && !o->ended && !o->closed) {
+        int64_t left = deadline < 0 ? -1 : deadline - ff_now_ns();
+        if (deadline >= 0 && left <= 0) break;
+        ff_cond_wait_ns(&o->cv, &o->lock, left);
+    }
+    int r;
+    if (o->closed) {
+        r = -1;
+    } else if (o->len > 0) {
+        *f = out_take_locked(o);
+        o->st.delivered++;
+        pthread_cond_broadcast(&o->cv);   // room for a blocked pusher
+        r = 1;
+    } else {
+        r = o->ended ? -1 : 0;
+    }
+    pthread_mutex_unlock(&o->lock);
+    return r;
+}
+
+static void* deliver_main(void* arg) {
+    FFFanoutOutput* o = arg;
+    FFFrameRef* f = NULL;
+    while (ff_fanout_pop(o, -1, &f) == 1) {
+        o->cfg.deliver(o->cfg.opaque, f);
+        ff_frame_release(f);
+    }
+    return NULL;
+}
+
+static void out_set_ended(FFFanoutOutput* o, int ended) {
+    pthread_mutex_lock(&o->lock);
+    o->ended = ended;
+    pthread_cond_broadcast(&o->cv);
+    pthread_mutex_unlock(&o->lock);
+}
+
+// ---- Fan-out ----
+
+FFFanout* ff_fanout_create(void) {
+    FFFanout* fo = calloc(1, sizeof(*fo));
+    if (!fo) return NULL;
+    pthread_mutex_init(&fo->lock, NULL);
+    return fo;
+}
+
+void ff_fanout_destroy(FFFanout* fo) {
+    if (!fo) return;
+    ff_fanout_stop(fo);
+    for (;;) {
+        pthread_mutex_lock(&fo->lock);
+        FFFanoutOutput* o = fo->nout > 0 ? fo->outs[fo->nout - 1] : NULL;
+        pthread_mutex_unlock(&fo->lock);
+        if (!o) break;
+        ff_fanout_remove_output(fo, o);
+    }
+    pthread_mutex_destroy(&fo->lock);
+    free(fo);
+}
+
+FFFanoutOutput* ff_fanout_add_output(FFFanout* fo, const FFFanoutOutputConfig* cfg) {
+    if (!fo || !cfg) return NULL;
+    FFFanoutOutput* o = calloc(1, sizeof(*o));
+    if (!o) return NULL;
+    o->cfg = *cfg;
+    if (o->cfg.queue_depth <= 0) o->cfg.queue_depth = FF_FANOUT_DEFAULT_DEPTH;
+    snprintf(o->name, sizeof(o->name), "%s", cfg->name ? cfg->name : "output");
+    o->cfg.name = o->name;
+    o->q = calloc((size_t)o->cfg.queue_depth, sizeof(*o->q));
+    if (!o->q) {
+        free(o);
+        return NULL;
+    }
+    pthread_mutex_init(&o->lock, NULL);
+    ff_cond_init(&o->cv);
+    atomic_init(&o->refs, 1);
+
+    if (o->cfg.deliver) {
+        if (pthread_create(&o->thread, NULL, deliver_main, o) != 0) goto fail;
+        o->has_thread = 1;
+    }
+
+    pthread_mutex_lock(&fo->lock);
+    if (fo->nout == FF_FANOUT_MAX_OUTPUTS) {
+        pthread_mutex_unlock(&fo->lock);
+        goto fail;
+    }
+    o->ended = fo->ended;
+    fo->outs[fo->nout++] = o;
+    pthread_mutex_unlock(&fo->lock);
+    return o;
+
+fail:
+    if (o->has_thread) {
+        pthread_mutex_lock(&o->lock);
+        o->closed = 1;
+        pthread_cond_broadcast(&o->cv);
+        pthread_mutex_unlock(&o->lock);
+        pthread_join(o->thread, NULL);
+    }
+    out_unref(o);
+    return NULL;
+}
+
+void ff_fanout_remove_output(FFFanout* fo, FFFanoutOutput* o) {
+    if (!fo || !o) return;
+    pthread_mutex_lock(&fo->lock);
+    int found = 0;
+    for (int i = 0; i < fo->nout; ++i) {
+        if (fo->outs[i] == o) {
+            fo->outs[i] = fo->outs[--fo->nout];
+            found = 1;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&fo->lock);
+    if (!found) return;
+
+    pthread_mutex_lock(&o->lock);
+    o->closed = 1;
+    pthread_cond_broadcast(&o->cv);
+    pthread_mutex_unlock(&o->lock);
+    if (o->has_thread) pthread_join(o->thread, NULL);
+    out_unref(o);
+}
+
+int ff_fanout_push(FFFanout* fo, FFFrameRef* f) {
+    if (!fo || !f) return 0;
+
+    // Snapshot the outputs so a blocking one never holds the table lock.
+    FFFanoutOutput* outs[FF_FANOUT_MAX_OUTPUTS];
+    int n = 0;
+    pthread_mutex_lock(&fo->lock);
+    for (int i = 0; i < fo->nout; ++i) {
+        atomic_fetch_add(&fo->outs[i]->refs, 1);
+        outs[n++] = fo->outs[i];
+    }
+    pthread_mutex_unlock(&fo->lock);
+
+    // Non-blocking outputs first, so they get the frame even if a blocking one stalls.
+    int queued = 0;
+    for (int pass = 0; pass < 2; ++pass) {
+        for (int i = 0; i < n; ++i) {
+            if ((outs[i]->cfg.policy == FF_DROP_BLOCK) != pass) continue;
+            queued += out_offer(fo, outs[i], f);
+        }
+    }
+    for (int i = 0; i < n; ++i) out_unref(outs[i]);
+    return queued;
+}
+
+static void set_ended(FFFanout* fo, int ended) {
+    pthread_mutex_lock(&fo->lock);
+    fo->ended = ended;
+    for (int i = 0; i < fo->nout; ++i) out_set_ended(fo->outs[i], ended);
+    pthread_mutex_unlock(&fo->lock);
+}
+
+void ff_fanout_end(FFFanout* fo) {
+    if (fo) set_ended(fo, 1);
+}
+
+// Drops the oldest queued frame of every non-blocking output. Returns how many went.
+static int shed(FFFanout* fo) {
+    int n = 0;
+    pthread_mutex_lock(&fo->lock);
+    for (int i = 0; i < fo->nout; ++i) {
+        FFFanoutOutput* o = fo->outs[i];
+        if (o->cfg.policy == FF_DROP_BLOCK) continue;
+        pthread_mutex_lock(&o->lock);
+        if (o->len > 0) {
+            ff_frame_release(out_take_locked(o));
+            o->st.dropped++;
+            ++n;
+        }
+        pthread_mutex_unlock(&o->lock);
+    }
+    pthread_mutex_unlock(&fo->lock);
+    return n;
+}
+
+static void* pump_main(void* arg) {
+    FFFanout* fo = arg;
+    int rc = 0;
+    while (!atomic_load(&fo->stop)) {
+        FFFrameRef* f = NULL;
+        rc = fo->src.next(fo->src.opaque, &f);
+        if (rc == 1) {
+            ff_fanout_push(fo, f);
+            ff_frame_release(f);
+            continue;
+        }
+        // Buffers are all sitting in queues: free some and retry. If only blocking
+        // outputs hold them, the source's own wait covers the retry pacing.
+        if (rc == -3) {
+            if (shed(fo) == 0) {
+                struct timespec nap = { 0, 1000000 };
+                nanosleep(&nap, NULL);
+            }
+            continue;
+        }
+        break;
+    }
+    fo->pump_rc = rc == 1 || rc == -3 ? 0 : rc;
+    ff_fanout_end(fo);
+    return NULL;
+}
+
+int ff_fanout_start(FFFanout* fo, FFFrameSource src) {
+    if (!fo || !src.next || fo->pump_running) return -1;
+    fo->src = src;
+    fo->pump_rc = 0;
+    atomic_store(&fo->stop, 0);
+    set_ended(fo, 0);
+    if (pthread_create(&fo->pump, NULL, pump_main, fo) != 0) return -1;
+    fo->pump_running = 1;
+    return 0;
+}
+
+int ff_fanout_wait(FFFanout* fo) {
+    if (!fo || !fo->pump_running) return fo ? fo->pump_rc : -1;
+    pthread_join(fo->pump, NULL);
+    fo->pump_running = 0;
+    return fo->pump_rc;
+}
+
+int ff_fanout_stop(FFFanout* fo) {
+    if (!fo) return -1;
+    atomic_store(&fo->stop, 1);
+    // Wake a pump blocked on a full FF_DROP_BLOCK queue.
+    pthread_mutex_lock(&fo->lock);
+    for (int i = 0; i < fo->nout; ++i) {
+        pthread_mutex_lock(&fo->outs[i]->lock);
+        pthread_cond_broadcast(&fo->outs[i]->cv);
+        pthread_mutex_unlock(&fo->outs[i]->lock);
+    }
+    pthread_mutex_unlock(&fo->lock);
+    return ff_fanout_wait(fo);
+}
+
+void ff_fanout_output_stats(FFFanoutOutput* o, FFFanoutOutputStats* st) {
+    if (!o || !st) return;
+    pthread_mutex_lock(&o->lock);
+    *st = o->st;
+    st->queued = o->len;
+    pthread_mutex_unlock(&o->lock);
+}
+
+const char* ff_fanout_output_name(const FFFanoutOutput* o) {
+    return o ? o->name : NULL;
+}
@@ -0,0 +1,85 @@
+#pragma once
+#include <stdint.h>
+#include "ffframe.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// One decode pipeline feeding any number of outputs (preview, recorder, LED
+// output, ...). Every output receives the same FFFrameRef (a retain, never a
+// copy) through its own bounded queue, so a slow output only fills its own
+// queue and loses frames according to its own drop policy.
+typedef struct FFFanout       FFFanout;
+typedef struct FFFanoutOutput FFFanoutOutput;
+
+#define FF_FANOUT_MAX_OUTPUTS 16
+
+typedef enum FFDropPolicy {
+    FF_DROP_OLDEST = 0,   // queue full: discard the oldest queued frame (live outputs)
+    FF_DROP_NEWEST,       // queue full: discard the incoming frame
+    FF_DROP_BLOCK,        // queue full: wait for room (back-pressure on the whole
+                          // pipeline), up to block_timeout_ms, then discard the incoming frame
+} FFDropPolicy;
+
+typedef struct FFFanoutOutputConfig {
+    const char*  name;
+    int          queue_depth;        // 0 = 4
+    FFDropPolicy policy;
+    int          block_timeout_ms;   // FF_DROP_BLOCK only; <0 waits forever
+
+    // Optional push delivery: called on a thread owned by this output for every
+    // frame, in order. The callback borrows `f` (retain it to keep it). Without
+    // it, the consumer pulls with ff_fanout_pop.
+    void       (*deliver)(void* opaque, FFFrameRef* f);
+    void*        opaque;
+} FFFanoutOutputConfig;
+
+typedef struct FFFanoutOutputStats {
+    uint64_t pushed;        // frames offered to this output
+    uint64_t delivered;     // frames popped or handed to deliver()
+    uint64_t dropped;       // frames discarded by the drop policy or to free buffers
+    uint64_t block_ns;      // time the pipeline spent waiting on this output (FF_DROP_BLOCK)
+    int      queued;
+    int      high_water;    // peak queue length
+} FFFanoutOutputStats;
+
+FFFanout*       ff_fanout_create(void);
+// Stops the pump, removes every output and releases queued frames.
+void            ff_fanout_destroy(FFFanout* fo);
+
+// Registers an output. Can be called while frames are flowing; the output sees
+// frames pushed after it was added. NULL on failure or if the output table is full.
+FFFanoutOutput* ff_fanout_add_output(FFFanout* fo, const FFFanoutOutputConfig* cfg);
+// Unregisters and frees an output; its queued frames are released.
+void            ff_fanout_remove_output(FFFanout* fo, FFFanoutOutput* out);
+
+// Offers `f` to every output (the caller keeps its own reference). Returns how
+// many outputs queued it.
+int             ff_fanout_push(FFFanout* fo, FFFrameRef* f);
+// Marks the end of the stream: outputs drain their queues, then pop returns -1.
+void            ff_fanout_end(FFFanout* fo);
+
+// Pull-mode consumers: next queued frame, waiting up to timeout_ms (<0 forever).
+// Returns 1 with *f owning one reference, 0 on timeout, -1 once the stream has
+// ended and the queue is empty.
+int             ff_fanout_pop(FFFanoutOutput* out, int timeout_ms, FFFrameRef** f);
+
+// Runs a pump thread pulling `src` and pushing every frame until the source
+// ends or fails, then calls ff_fanout_end. When the source reports exhausted
+// output buffers (-3), the pump sheds the oldest frame of every non-blocking
+// output's queue so the shared pool can refill. Returns 0, or <0 if a pump is
+// already running.
+int             ff_fanout_start(FFFanout* fo, FFFrameSource src);
+// Stops the pump (if running) after its current frame and joins it. Returns
+// the source's last result (0 = end of stream).
+int             ff_fanout_stop(FFFanout* fo);
+// Waits for the pump to reach the end of the source. Returns like ff_fanout_stop.
+int             ff_fanout_wait(FFFanout* fo);
+
+void            ff_fanout_output_stats(FFFanoutOutput* out, FFFanoutOutputStats* st);
+const char*     ff_fanout_output_name(const FFFanoutOutput* out);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,218 @@
+#include "ffframe.h"
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct FFFrameRef {
+    atomic_int  refs;
+    FFFrameDesc d;
+
+    // Debug tracking (only linked while leak detection is on)
+    FFFrameRef* dbg_prev;
+    FFFrameRef* dbg_next;
+    int         dbg_tracked;
+};
+
+int ff_pixfmt_bytes_per_pixel(FFPixelFormat fmt) {
+    switch (fmt) {
+    case FF_PIXFMT_BGRA: return 4;
+    }
+    return 0;
+}
+
+// ---- Leak tracking ----
+
+static pthread_mutex_t g_dbg_lock = PTHREAD_MUTEX_INITIALIZER;
+static FFFrameRef*     g_dbg_head;
+static long            g_dbg_live;
+static atomic_int      g_dbg_state = -1;   // -1 = not decided yet, 0 off, 1 on
+
+// In debug mode the last DBG_QUARANTINE released refs are kept (payload freed,
+// count at 0) rather than freed, so an extra release of one of them finds a
+// valid ref and is reported instead of reading freed memory.
+#define DBG_QUARANTINE 1024
+static FFFrameRef*     g_dbg_dead[DBG_QUARANTINE];
+static int             g_dbg_dead_next;
+
+static void dbg_atexit(void) {
+    long n = ff_frame_debug_report(stderr);
+    if (n > 0) fprintf(stderr, "ffframe: %ld frame reference(s) leaked\n", n);
+}
+
+static int dbg_on(void) {
+    int st = atomic_load_explicit(&g_dbg_state, memory_order_relaxed);
+    if (st >= 0) return st;
+
+    const char* env = getenv("NOTCH_FRAME_DEBUG");
+    int want = (env && env[0] == '1');
+    int expected = -1;
+    if (atomic_compare_exchange_strong(&g_dbg_state, &expected, want) && want) {
+        atexit(dbg_atexit);
+    }
+    return atomic_load(&g_dbg_state);
+}
+
+void ff_frame_debug_enable(int on) {
+    int prev = atomic_exchange(&g_dbg_state, on ? 1 : 0);
+    if (on && prev != 1) atexit(dbg_atexit);
+}
+
+static void dbg_track(FFFrameRef* f) {
+    pthread_mutex_lock(&g_dbg_lock);
+    f->dbg_prev = NULL;
+    f->dbg_next = g_dbg_head;
+    if (g_dbg_head) g_dbg_head->dbg_prev = f;
+    g_dbg_head = f;
+    f->dbg_tracked = 1;
+    g_dbg_live++;
+    pthread_mutex_unlock(&g_dbg_lock);
+}
+
+static void dbg_untrack(FFFrameRef* f) {
+    pthread_mutex_lock(&g_dbg_lock);
+    if (f->dbg_tracked) {
+        if (f->dbg_prev) f->dbg_prev->dbg_next = f->dbg_next;
+        else g_dbg_head = f->dbg_next;
+        if (f->dbg_next) f->dbg_next->dbg_prev = f->dbg_prev;
+        f->dbg_tracked = 0;
+        g_dbg_live--;
+    }
+    pthread_mutex_unlock(&g_dbg_lock);
+}
+
+static void dbg_quarantine(FFFrameRef* f) {
+    memset(&f->d, 0, sizeof(f->d));
+    f->d.index = -1;
+    pthread_mutex_lock(&g_dbg_lock);
+    FFFrameRef* old = g_dbg_dead[g_dbg_dead_next];
+    g_dbg_dead[g_dbg_dead_next] = f;
+    g_dbg_dead_next = (g_dbg_dead_next + 1) % DBG_QUARANTINE;
+    pthread_mutex_unlock(&g_dbg_lock);
+    free(old);
+}
+
+long ff_frame_debug_live_count(void) {
+    pthread_mutex_lock(&g_dbg_lock);
+    long n = g_dbg_live;
+    pthread_mutex_unlock(&g_dbg_lock);
+    return n;
+}
+
+long ff_frame_debug_report(FILE* out) {
+    long n = 0;
+    pthread_mutex_lock(&g_dbg_lock);
+    for (FFFrameRef* f = g_dbg_head; f; f = f->dbg_next) {
+        if (out) {
+            fprintf(out, "ffframe: live frame %p index=%lld pts=%.6f %dx%d refs=%d\n",
+                    (void*)f, (long long)f->d.index, f->d.pts, f->d.width, f->d.height,
+                    atomic_load(&f->refs));
+        }
+        ++n;
+    }
+    pthread_mutex_unlock(&g_dbg_lock);
+    return n;
+}
+
+// ---- Frames ----
+
+FFFrameRef* ff_frame_wrap(const FFFrameDesc* d) {
+    if (!d || !d->data[0]) return NULL;
+    FFFrameRef* f = calloc(1, sizeof(*f));
+    if (!f) return NULL;
+    f->d = *d;
+    atomic_init(&f->refs, 1);
+    if (dbg_on()) dbg_track(f);
+    return f;
+}
+
+static void heap_free(void* opaque) {
+    free(opaque);
+}
+
+FFFrameRef* ff_frame_alloc(int width, int height, FFPixelFormat fmt) {
+    int bpp = ff_pixfmt_bytes_per_pixel(fmt);
+    if (width <= 0 || height <= 0 || bpp == 0) return NULL;
+
+    size_t stride = ((size_t)width * bpp + 63) & ~(size_t)63;
+    void* mem = NULL;
+    if (posix_memalign(&mem, 64, stride * (size_t)height) != 0) return NULL;
+
+    FFFrameDesc d;
+    memset(&d, 0, sizeof(d));
+    d.data[0]     = mem;
+    d.linesize[0] = (int)stride;
+    d.width       = width;
+    d.height      = height;
+    d.format      = fmt;
+    d.pts         = NAN;
+    d.index       = -1;
+    d.free        = heap_free;
+    d.opaque      = mem;
+
+    FFFrameRef* f = ff_frame_wrap(&d);
+    if (!f) free(mem);
+    return f;
+}
+
+FFFrameRef* ff_frame_retain(FFFrameRef* f) {
+    if (f) atomic_fetch_add_explicit(&f->refs, 1, memory_order_relaxed);
+    return f;
+}
+
+void ff_frame_release(FFFrameRef* f) {
+    if (!f) return;
+    int prev = atomic_fetch_sub_explicit(&f->refs, 1, memory_order_acq_rel);
+    if (prev > 1) return;
+    if (prev < 1) {
+        // Over-release: always a caller bug. Loud in debug mode, where the ref
+        // is still quarantined; ignored otherwise.
+        if (dbg_on()) {
+            fprintf(stderr, "ffframe: over-release of frame %p\n", (void*)f);
+            abort();
+        }
+        return;
+    }
+
+    if (f->dbg_tracked) dbg_untrack(f);
+    if (f->d.free) f->d.free(f->d.opaque);
+    if (dbg_on()) dbg_quarantine(f);
+    else free(f);
+}
+
+int ff_frame_refcount(const FFFrameRef* f) {
+    return f ? atomic_load_explicit(&((FFFrameRef*)f)->refs, memory_order_relaxed) : 0;
+}
+
+uint8_t* ff_frame_plane(const FFFrameRef* f, int plane) {
+    return (f && plane >= 0 && plane < 4) ? f->d.data[plane] : NULL;
+}
+
+int ff_frame_stride(const FFFrameRef* f, int plane) {
+    return (f && plane >= 0 && plane < 4) ? f->d.linesize[plane] : 0;
+}
+
+int           ff_frame_width(const FFFrameRef* f)  { return f ? f->d.width : 0; }
+int           ff_frame_height(const FFFrameRef* f) { return f ? f->d.height : 0; }
+FFPixelFormat ff_frame_format(const FFFrameRef* f) { return f ? f->d.format : FF_PIXFMT_BGRA; }
+double        ff_frame_pts(const FFFrameRef* f)    { return f ? f->d.pts : NAN; }
+int64_t       ff_frame_index(const FFFrameRef* f)  { return f ? f->d.index : -1; }
+void*         ff_frame_native(const FFFrameRef* f) { return f ? f->d.native : NULL; }
+
+size_t ff_frame_bytes(const FFFrameRef* f) {
+    if (!f) return 0;
+    size_t n = 0;
+    for (int i = 0; i < 4; ++i) {
+        if (!f->d.data[i]) continue;
+        int stride = f->d.linesize[i] < 0 ? -f->d.linesize[i] : f->d.linesize[i];
+        n += (size_t)stride * (size_t)f->d.height;
+    }
+    return n;
+}
+
+void ff_frame_set_timing(FFFrameRef* f, double pts, int64_t index) {
+    if (!f) return;
+    f->d.pts   = pts;
+    f->d.index = index;
+}
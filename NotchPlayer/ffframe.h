@@ -0,0 +1,82 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Output pixel formats produced by sinks and carried by frames.
+typedef enum FFPixelFormat {
+    FF_PIXFMT_BGRA = 0,   // 8-bit B,G,R,A, one packed plane
+} FFPixelFormat;
+
+// Bytes per pixel of a packed format.
+int ff_pixfmt_bytes_per_pixel(FFPixelFormat fmt);
+
+// Refcounted handle to one converted frame. The pixels live in memory owned by
+// whoever created the frame (a sink, a pool); they go back to that owner when
+// the last reference is released. Sharing a frame is a retain, never a copy.
+// Pixels must be treated as read-only once a frame has more than one reference.
+typedef struct FFFrameRef FFFrameRef;
+
+// Everything needed to wrap existing memory in a frame.
+typedef struct FFFrameDesc {
+    uint8_t*      data[4];
+    int           linesize[4];
+    int           width, height;
+    FFPixelFormat format;
+    double        pts;        // seconds, NaN if unknown
+    int64_t       index;      // frame number within the clip, -1 if unknown
+    void*         native;     // platform object backing the pixels (CVPixelBufferRef), or NULL
+
+    // Called once when the last reference is released.
+    void        (*free)(void* opaque);
+    void*         opaque;
+} FFFrameDesc;
+
+// Wraps memory described by `d`; the frame starts with one reference.
+FFFrameRef* ff_frame_wrap(const FFFrameDesc* d);
+
+// Convenience: heap-backed frame with 64-byte aligned rows.
+FFFrameRef* ff_frame_alloc(int width, int height, FFPixelFormat fmt);
+
+FFFrameRef* ff_frame_retain(FFFrameRef* f);
+void        ff_frame_release(FFFrameRef* f);   // NULL is a no-op
+int         ff_frame_refcount(const FFFrameRef* f);
+
+uint8_t*      ff_frame_plane(const FFFrameRef* f, int plane);
+int           ff_frame_stride(const FFFrameRef* f, int plane);
+int           ff_frame_width(const FFFrameRef* f);
+int           ff_frame_height(const FFFrameRef* f);
+FFPixelFormat ff_frame_format(const FFFrameRef* f);
+double        ff_frame_pts(const FFFrameRef* f);
+int64_t       ff_frame_index(const FFFrameRef* f);
+void*         ff_frame_native(const FFFrameRef* f);
+// Memory the pixels occupy: |stride| x height summed over the frame's planes.
+size_t        ff_frame_bytes(const FFFrameRef* f);
+
+// Producers stamp timing after filling the pixels, before sharing the frame.
+void ff_frame_set_timing(FFFrameRef* f, double pts, int64_t index);
+
+// Anything that produces frames one at a time (a player, a generator, a test
+// double). next() follows ff_next_frame_ref: 1 = frame (*out owns one
+// reference), 0 = end of stream, <0 = error, -3 = output buffers exhausted
+// for now (retry later; nothing is lost).
+typedef struct FFFrameSource {
+    int  (*next)(void* opaque, FFFrameRef** out);
+    void* opaque;
+} FFFrameSource;
+
+// Leak detection. When enabled (or when NOTCH_FRAME_DEBUG=1 is set in the
+// environment at first use) every live frame is tracked, over-release aborts,
+// and frames still alive at exit are reported on stderr.
+void ff_frame_debug_enable(int on);
+long ff_frame_debug_live_count(void);
+// Prints one line per live frame; returns how many were printed.
+long ff_frame_debug_report(FILE* out);
+
+#ifdef __cplusplus
+}
+#endif
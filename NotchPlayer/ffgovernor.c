@@ -0,0 +1,217 @@
+#include "ffgovernor.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct FFGovClient {
+    FFGovClientConfig cfg;
+    char         name[32];
+    size_t       cap;              // SIZE_MAX = not capped
+    size_t       used, wanted;     // last poll
+    FFGovClient* prev;
+    FFGovClient* next;
+};
+
+static pthread_mutex_t g_lock = PTHREAD_MUTEX_INITIALIZER;
+static FFGovClient*    g_first;
+static FFGovClient*    g_last;
+static int             g_count;
+static atomic_size_t   g_limit;
+static FFGovUsage      g_stats;    // counters only
+// Set while this thread enforces, so memory moved by a callback cannot re-enter.
+static _Thread_local int t_enforcing;
+
+// ---- Bookkeeping (g_lock held) ----
+
+static size_t add_sat(size_t a, size_t b) {
+    return a > SIZE_MAX - b ? SIZE_MAX : a + b;
+}
+
+// Polls every client. Returns the total held (borrowed memory excluded).
+static size_t poll_locked(void) {
+    size_t total = 0;
+    for (FFGovClient* c = g_first; c; c = c->next) {
+        c->wanted = SIZE_MAX;   // unless the client says otherwise
+        c->used   = c->cfg.usage(c->cfg.opaque, &c->wanted);
+        if (!c->cfg.borrowed) total = add_sat(total, c->used);
+    }
+    return total;
+}
+
+static size_t trim_locked(void) {
+    size_t freed = 0;
+    for (FFGovClient* c = g_first; c; c = c->next)
+        if (c->cfg.trim) freed += c->cfg.trim(c->cfg.opaque);
+    g_stats.trimmed_bytes += freed;
+    return freed;
+}
+
+static void set_cap_locked(FFGovClient* c, size_t cap) {
+    c->cap = cap;
+    c->cfg.set_cap(c->cfg.opaque, cap);
+}
+
+// Clients that can be capped, lowest priority first (registration order on ties).
+static int cappable_locked(FFGovClient** out) {
+    int n = 0;
+    for (FFGovClient* c = g_first; c; c = c->next) {
+        if (!c->cfg.set_cap) continue;
+        int i = n++;
+        while (i > 0 && out[i - 1]->cfg.priority > c->cfg.priority) {
+            out[i] = out[i - 1];
+            --i;
+        }
+        out[i] = c;
+    }
+    return n;
+}
+
+static void enforce_locked(void) {
+    size_t limit = atomic_load(&g_limit);
+    if (!limit || g_count == 0) return;
+    size_t total = poll_locked();
+    FFGovClient* order[g_count];
+    int n = cappable_locked(order);
+
+    if (total > limit) {
+        g_stats.enforcements++;
+        // Unused buffers cost nothing to give back; then cap, cheapest loss first.
+        if (trim_locked()) total = poll_locked();
+        for (int i = 0; i < n && total > limit; ++i) {
+            FFGovClient* c = order[i];
+            size_t excess = total - limit;
+            size_t target = c->used > excess ? c->used - excess : 0;
+            if (target >= c->cap) continue;
+            set_cap_locked(c, target);
+            g_stats.caps_lowered++;
+            trim_locked();
+            total = poll_locked();
+        }
+        if (total > limit) g_stats.over_limit++;
+        return;
+    }
+
+    // Room again: raise caps, most important client first. A client's unused
+    // allowance counts against the room.
+    size_t room = limit - total;
+    for (int i = n - 1; i >= 0 && room > 0; --i) {
+        FFGovClient* c = order[i];
+        if (c->cap == SIZE_MAX) continue;
+        size_t unused = c->cap > c->used ? c->cap - c->used : 0;
+        if (unused >= room) break;
+        size_t cap = add_sat(c->used, room);
+        if (cap >= c->wanted) {
+            cap = SIZE_MAX;
+            room -= c->wanted > c->used ? c->wanted - c->used : 0;
+        } else {
+            room = 0;
+        }
+        set_cap_locked(c, cap);
+        g_stats.caps_raised++;
+    }
+}
+
+// ---- API ----
+
+FFGovClient* ff_governor_register(const FFGovClientConfig* cfg) {
+    if (!cfg || !cfg->usage || cfg->kind < 0 || cfg->kind >= FF_GOV_CLASSES) return NULL;
+    FFGovClient* c = calloc(1, sizeof(*c));
+    if (!c) return NULL;
+    c->cfg = *cfg;
+    if (cfg->name) strncpy(c->name, cfg->name, sizeof(c->name) - 1);
+    c->cfg.name = c->name;
+    c->cap = SIZE_MAX;
+
+    pthread_mutex_lock(&g_lock);
+    c->prev = g_last;
+    if (g_last) g_last->next = c; else g_first = c;
+    g_last = c;
+    g_count++;
+    pthread_mutex_unlock(&g_lock);
+    return c;
+}
+
+void ff_governor_unregister(FFGovClient* c) {
+    if (!c) return;
+    pthread_mutex_lock(&g_lock);
+    if (c->prev) c->prev->next = c->next; else g_first = c->next;
+    if (c->next) c->next->prev = c->prev; else g_last = c->prev;
+    g_count--;
+    pthread_mutex_unlock(&g_lock);
+    free(c);
+}
+
+void ff_governor_notify(void) {
+    if (!atomic_load_explicit(&g_limit, memory_order_relaxed) || t_enforcing) return;
+    pthread_mutex_lock(&g_lock);
+    t_enforcing = 1;
+    enforce_locked();
+    t_enforcing = 0;
+    pthread_mutex_unlock(&g_lock);
+}
+
+void ff_governor_set_limit(size_t bytes) {
+    pthread_mutex_lock(&g_lock);
+    atomic_store(&g_limit, bytes);
+    t_enforcing = 1;
+    if (bytes) {
+        enforce_locked();
+    } else {
+        for (FFGovClient* c = g_first; c; c = c->next)
+            if (c->cfg.set_cap && c->cap != SIZE_MAX) set_cap_locked(c, SIZE_MAX);
+    }
+    t_enforcing = 0;
+    pthread_mutex_unlock(&g_lock);
+}
+
+size_t ff_governor_get_limit(void) {
+    return atomic_load(&g_limit);
+}
+
+void ff_governor_get_usage(FFGovUsage* out) {
+    if (!out) return;
+    pthread_mutex_lock(&g_lock);
+    t_enforcing = 1;
+    *out = g_stats;
+    out->limit_bytes = atomic_load(&g_limit);
+    out->total_bytes = poll_locked();
+    out->clients     = g_count;
+    for (FFGovClient* c = g_first; c; c = c->next)
+        out->class_bytes[c->cfg.kind] = add_sat(out->class_bytes[c->cfg.kind], c->used);
+    t_enforcing = 0;
+    pthread_mutex_unlock(&g_lock);
+}
+
+int ff_governor_list(FFGovClientInfo* out, int max) {
+    pthread_mutex_lock(&g_lock);
+    t_enforcing = 1;
+    poll_locked();
+    int i = 0;
+    for (FFGovClient* c = g_first; c && out && i < max; c = c->next, ++i) {
+        FFGovClientInfo* e = &out[i];
+        memcpy(e->name, c->name, sizeof(e->name));
+        e->kind         = c->cfg.kind;
+        e->priority     = c->cfg.priority;
+        e->borrowed     = c->cfg.borrowed;
+        e->used_bytes   = c->used;
+        e->wanted_bytes = c->wanted;
+        e->cap_bytes    = c->cap;
+    }
+    int n = g_count;
+    t_enforcing = 0;
+    pthread_mutex_unlock(&g_lock);
+    return n;
+}
+
+const char* ff_governor_class_name(FFGovClass kind) {
+    switch (kind) {
+    case FF_GOV_IO:       return "io";
+    case FF_GOV_DECODER:  return "decoder";
+    case FF_GOV_OUTPUT:   return "output";
+    case FF_GOV_CACHE:    return "cache";
+    case FF_GOV_PREFETCH: return "prefetch";
+    default:              return "?";
+    }
+}
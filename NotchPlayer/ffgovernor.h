@@ -0,0 +1,97 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Process-wide memory governor. Every subsystem that holds sizeable memory
+// (frame pools, decoder planes, demuxer buffers, caches, readahead) registers a
+// client that reports its usage; pools, caches and players register their own.
+// With a limit set, growth past it is answered at once on the thread that
+// grew: unused pool buffers are trimmed first, then shrinkable clients are
+// capped in priority order (lowest first) until the total fits. Caps are
+// raised again, highest priority first, as memory frees up. Without a limit
+// the governor only keeps the books. Thread-safe.
+typedef struct FFGovClient FFGovClient;
+
+typedef enum FFGovClass {
+    FF_GOV_IO = 0,        // demuxer and resident packet buffers
+    FF_GOV_DECODER,       // decoder frame planes
+    FF_GOV_OUTPUT,        // output frame pools
+    FF_GOV_CACHE,         // frame, compressed and loop caches
+    FF_GOV_PREFETCH,      // frames prepared ahead of the playhead
+    FF_GOV_CLASSES
+} FFGovClass;
+
+// Shrink order of the built-in clients: full-size frames are the most
+// expensive to keep, compressed ones next, readahead only when nothing else is left.
+#define FF_GOV_PRIORITY_FRAME_CACHE 10
+#define FF_GOV_PRIORITY_PACK_CACHE  20
+#define FF_GOV_PRIORITY_READAHEAD   30
+
+typedef struct FFGovClientConfig {
+    const char* name;
+    FFGovClass  kind;
+    int         priority;   // clients with set_cap: lower is capped first
+    // The memory is another client's (e.g. cached frames living in a pool's
+    // buffers): shown in the breakdown but not added to the total.
+    int         borrowed;
+    void*       opaque;
+    // Bytes held now; *wanted (may be left alone) is what the client would
+    // hold uncapped, e.g. its configured budget. Required.
+    size_t    (*usage)(void* opaque, size_t* wanted);
+    // Optional. Holds the client to `cap` bytes (SIZE_MAX = no cap): it lets go
+    // of memory down to the cap now and grows no further until it is raised.
+    void      (*set_cap)(void* opaque, size_t cap);
+    // Optional. Frees memory that is held but unused. Returns bytes released.
+    size_t    (*trim)(void* opaque);
+} FFGovClientConfig;
+
+// Returns the client, or NULL. Call without holding locks the callbacks take;
+// callbacks run under the governor's lock and must not call back into it.
+FFGovClient* ff_governor_register(const FFGovClientConfig* cfg);
+// After this returns no callback of the client is running or will run.
+void         ff_governor_unregister(FFGovClient* c);
+
+// A client grew: enforces the limit if there is one. Cheap without a limit.
+// Must not be called while holding a lock one of the callbacks takes.
+void         ff_governor_notify(void);
+
+// Process-wide limit in bytes, enforced now; 0 removes it and lifts every cap.
+void         ff_governor_set_limit(size_t bytes);
+size_t       ff_governor_get_limit(void);
+
+typedef struct FFGovUsage {
+    size_t   limit_bytes;
+    size_t   total_bytes;                     // memory held (borrowed bytes excluded)
+    size_t   class_bytes[FF_GOV_CLASSES];     // per class, borrowed included
+    int      clients;
+    uint64_t enforcements;                    // times the total was over the limit
+    uint64_t caps_lowered;
+    uint64_t caps_raised;
+    uint64_t trimmed_bytes;
+    uint64_t over_limit;                      // enforcements that could not get under it
+} FFGovUsage;
+
+typedef struct FFGovClientInfo {
+    char       name[32];
+    FFGovClass kind;
+    int        priority;
+    int        borrowed;
+    size_t     used_bytes;
+    size_t     wanted_bytes;
+    size_t     cap_bytes;                     // SIZE_MAX = not capped
+} FFGovClientInfo;
+
+// Live totals, polled from every client now.
+void         ff_governor_get_usage(FFGovUsage* out);
+// Fills up to `max` entries in registration order. Returns the number of clients.
+int          ff_governor_list(FFGovClientInfo* out, int max);
+
+const char*  ff_governor_class_name(FFGovClass kind);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,209 @@
+#include "ffloop.h"
+#include "ffutil.h"
+#include <pthread.h>
+#include <stdlib.h>
+
+// How long the loop thread keeps retrying a source whose output pool is full.
+#define PREFETCH_RETRY_MS 1000
+
+struct FFLoop {
+    FFLoopConfig    cfg;
+    FFFrameRef**    head;          // frames first .. first + head_n - 1
+    int             head_n;
+    int64_t         last_index;    // of the last frame the source produced
+
+    pthread_mutex_t lock;
+    pthread_cond_t  cv;            // restart requested / finished, or stopping
+    pthread_t       thread;
+    int             stopping;
+
+    // Wrap in progress: the consumer plays head[pos..] while the loop thread
+    // restarts the source at restart_at and pulls its first frame into prefetch.
+    int             serving;
+    int             pos;
+    int             restarting;
+    int64_t         restart_at;
+    int             prefetch_r;
+    FFFrameRef*     prefetch;
+
+    FFLoopStats     stats;
+};
+
+static int source_next(FFLoop* lp, FFFrameRef** out);
+
+static void* loop_main(void* arg) {
+    FFLoop* lp = arg;
+    pthread_mutex_lock(&lp->lock);
+    for (;;) {
+        while (!lp->stopping && !lp->restarting) ff_cond_wait_ns(&lp->cv, &lp->lock, -1);
+        if (lp->stopping) break;
+        int64_t at = lp->restart_at;
+        pthread_mutex_unlock(&lp->lock);
+
+        int64_t t0 = ff_now_ns();
+        FFFrameRef* f = NULL;
+        int r = lp->cfg.restart(lp->cfg.restart_opaque, at);
+        if (r >= 0) {
+            int64_t give_up = t0 + (int64_t)PREFETCH_RETRY_MS * 1000000;
+            while ((r = source_next(lp, &f)) == -3 && ff_now_ns() < give_up)
+                ff_sleep_until_ns(ff_now_ns() + 1000000);   // consumer still holds the pool's buffers
+        }
+        int64_t dt = ff_now_ns() - t0;
+
+        pthread_mutex_lock(&lp->lock);
+        lp->prefetch   = r == 1 ? f : NULL;
+        lp->prefetch_r = r;
+        lp->restarting = 0;
+        lp->stats.restart_ns_last = dt;
+        if (dt > lp->stats.restart_ns_max) lp->stats.restart_ns_max = dt;
+        pthread_cond_broadcast(&lp->cv);
+    }
+    pthread_mutex_unlock(&lp->lock);
+    return NULL;
+}
+
+FFLoop* ff_loop_create(const FFLoopConfig* cfg) {
+    if (!cfg || !cfg->source.next || !cfg->restart || cfg->first < 0 || cfg->count < 0) return NULL;
+    FFLoop* lp = calloc(1, sizeof(*lp));
+    if (!lp) return NULL;
+    lp->cfg = *cfg;
+    if (lp->cfg.head_frames <= 0) lp->cfg.head_frames = FF_LOOP_HEAD_DEFAULT;
+    lp->last_index = -1;
+    lp->head = calloc((size_t)lp->cfg.head_frames, sizeof(*lp->head));
+    if (!lp->head) {
+        free(lp);
+        return NULL;
+    }
+    pthread_mutex_init(&lp->lock, NULL);
+    ff_cond_init(&lp->cv);
+    if (pthread_create(&lp->thread, NULL, loop_main, lp) != 0) {
+        pthread_mutex_destroy(&lp->lock);
+        pthread_cond_destroy(&lp->cv);
+        free(lp->head);
+        free(lp);
+        return NULL;
+    }
+    return lp;
+}
+
+void ff_loop_destroy(FFLoop* lp) {
+    if (!lp) return;
+    pthread_mutex_lock(&lp->lock);
+    lp->stopping = 1;
+    pthread_cond_broadcast(&lp->cv);
+    pthread_mutex_unlock(&lp->lock);
+    pthread_join(lp->thread, NULL);   // lets a running restart finish
+
+    for (int i = 0; i < lp->head_n; ++i) ff_frame_release(lp->head[i]);
+    ff_frame_release(lp->prefetch);
+    pthread_mutex_destroy(&lp->lock);
+    pthread_cond_destroy(&lp->cv);
+    free(lp->head);
+    free(lp);
+}
+
+// Keeps `f` if it is the next frame of the head.
+static void capture(FFLoop* lp, FFFrameRef* f) {
+    pthread_mutex_lock(&lp->lock);
+    lp->last_index = ff_frame_index(f);
+    if (lp->head_n < lp->cfg.head_frames && ff_frame_index(f) == lp->cfg.first + lp->head_n)
+        lp->head[lp->head_n++] = ff_frame_retain(f);
+    pthread_mutex_unlock(&lp->lock);
+}
+
+// Next frame of the source; a frame past the region counts as the end.
+static int source_next(FFLoop* lp, FFFrameRef** out) {
+    int r = lp->cfg.source.next(lp->cfg.source.opaque, out);
+    if (r == 1 && lp->cfg.count > 0 && ff_frame_index(*out) >= lp->cfg.first + lp->cfg.count) {
+        ff_frame_release(*out);
+        *out = NULL;
+        return 0;
+    }
+    if (r == 1) capture(lp, *out);
+    return r;
+}
+
+// End of clip: start playing the head and restart the source behind it.
+static int wrap(FFLoop* lp, FFFrameRef** out) {
+    pthread_mutex_lock(&lp->lock);
+    lp->stats.wraps++;
+    if (lp->head_n == 0) {
+        // Nothing captured (playback started past the first frame): restart inline.
+        pthread_mutex_unlock(&lp->lock);
+        int r = lp->cfg.restart(lp->cfg.restart_opaque, lp->cfg.first);
+        if (r < 0) return r;
+        return source_next(lp, out);
+    }
+    lp->serving = 1;
+    lp->pos     = 1;
+    if (lp->last_index == lp->cfg.first + lp->head_n - 1) {
+        lp->prefetch_r = 0;   // the head is the whole loop: nothing to restart
+        lp->stats.resident = 1;
+    } else {
+        lp->restarting = 1;
+        lp->restart_at = lp->cfg.first + lp->head_n;
+        pthread_cond_broadcast(&lp->cv);
+    }
+    *out = ff_frame_retain(lp->head[0]);
+    pthread_mutex_unlock(&lp->lock);
+    return 1;
+}
+
+int ff_loop_next(FFLoop* lp, FFFrameRef** out) {
+    *out = NULL;
+    pthread_mutex_lock(&lp->lock);
+    if (lp->serving) {
+        if (lp->pos < lp->head_n) {
+            *out = ff_frame_retain(lp->head[lp->pos++]);
+            pthread_mutex_unlock(&lp->lock);
+            return 1;
+        }
+        // End of the head: continue with the restarted source.
+        if (lp->restarting) {
+            int64_t t0 = ff_now_ns();
+            while (lp->restarting) ff_cond_wait_ns(&lp->cv, &lp->lock, -1);
+            int64_t waited = ff_now_ns() - t0;
+            lp->stats.stalls++;
+            if (waited > lp->stats.stall_ns_max) lp->stats.stall_ns_max = waited;
+        }
+        lp->serving = 0;
+        int r = lp->prefetch_r;
+        *out = lp->prefetch;
+        lp->prefetch = NULL;
+        pthread_mutex_unlock(&lp->lock);
+        if (r == 0) return wrap(lp, out);   // the whole loop fits in the head
+        return r;
+    }
+    pthread_mutex_unlock(&lp->lock);
+
+    int r = source_next(lp, out);
+    if (r != 0) return r;
+    return wrap(lp, out);
+}
+
+static int loop_source_next(void* opaque, FFFrameRef** out) {
+    return ff_loop_next(opaque, out);
+}
+
+FFFrameSource ff_loop_source(FFLoop* lp) {
+    FFFrameSource src = { loop_source_next, lp };
+    return src;
+}
+
+void ff_loop_reset(FFLoop* lp) {
+    if (!lp) return;
+    pthread_mutex_lock(&lp->lock);
+    while (lp->restarting) ff_cond_wait_ns(&lp->cv, &lp->lock, -1);
+    lp->serving = 0;
+    ff_frame_release(lp->prefetch);
+    lp->prefetch = NULL;
+    pthread_mutex_unlock(&lp->lock);
+}
+
+void ff_loop_get_stats(FFLoop* lp, FFLoopStats* out) {
+    if (!lp || !out) return;
+    pthread_mutex_lock(&lp->lock);
+    *out = lp->stats;
+    out->head_frames = lp->head_n;
+    pthread_mutex_unlock(&lp->lock);
+}
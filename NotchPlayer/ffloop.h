@@ -0,0 +1,62 @@
+#pragma once
+#include <stdint.h>
+#include "ffframe.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Seamless looping over any frame source. The first K frames of the clip (or
+// of the loop region) are kept (by reference) as they play. At the end the
+// loop goes on serving them straight away while its own thread repositions the
+// source to frame first + K and pre-fetches that frame, so the wrap costs the
+// consumer nothing as long as restarting takes less than K frame periods.
+// restart_ns in the stats shows how long it actually takes, for sizing K. With
+// K at least the region length, the region plays from memory after its first
+// pass and the source is never touched again.
+typedef struct FFLoop FFLoop;
+
+#define FF_LOOP_HEAD_DEFAULT 8
+
+typedef struct FFLoopConfig {
+    FFFrameSource source;   // plays the clip from frame 0
+    // Repositions the source so its next frame is `index`. Called on the loop's
+    // thread while the consumer plays the head, or inline on the first wrap if
+    // no head was captured. Returns 0 or <0.
+    int         (*restart)(void* opaque, int64_t index);
+    void*         restart_opaque;
+    int           head_frames;   // K; 0 = FF_LOOP_HEAD_DEFAULT
+    // Loop region: frames [first, first + count). count = 0 runs to the end of
+    // the clip. Frames past the region are dropped and count as its end.
+    int64_t       first;
+    int64_t       count;
+} FFLoopConfig;
+
+typedef struct FFLoopStats {
+    uint64_t wraps;
+    int      head_frames;        // frames captured so far (<= K)
+    int64_t  restart_ns_last;    // restart + first frame after the head
+    int64_t  restart_ns_max;
+    uint64_t stalls;             // the head ran out before the restart finished
+    int64_t  stall_ns_max;       // longest wait at the end of the head
+    int      resident;           // the whole loop is in the head: no more decoding
+} FFLoopStats;
+
+FFLoop*       ff_loop_create(const FFLoopConfig* cfg);
+// Releases the head. Does not touch the source.
+void          ff_loop_destroy(FFLoop* lp);
+
+// Next frame, like ff_next_frame_ref, except that the end of the clip (or
+// region) wraps to its first frame. Returns 0 only for a clip with no frames.
+int           ff_loop_next(FFLoop* lp, FFFrameRef** out);
+FFFrameSource ff_loop_source(FFLoop* lp);
+
+// Abandons a wrap in progress (waits for the restart to finish) so the caller
+// can reposition the source itself, e.g. for a seek. The head is kept.
+void          ff_loop_reset(FFLoop* lp);
+
+void          ff_loop_get_stats(FFLoop* lp, FFLoopStats* out);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,161 @@
+#include "fflz4.h"
+#include <string.h>
+
+#define HASH_BITS   14
+#define MIN_MATCH   4
+#define LAST_LITS   5    // the block always ends with at least this many literals
+#define MF_LIMIT    12   // no match may start closer than this to the end
+#define MAX_OFFSET  65535
+
+static inline uint32_t read32(const uint8_t* p) {
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return v;
+}
+
+static inline uint64_t read64(const uint8_t* p) {
+    uint64_t v;
+    memcpy(&v, p, 8);
+    return v;
+}
+
+static inline uint32_t hash4(uint32_t v) {
+    return (v * 2654435761u) >> (32 - HASH_BITS);
+}
+
+// Length of the common prefix of a and b, not running past `limit` (on a).
+static inline size_t match_len(const uint8_t* a, const uint8_t* b, const uint8_t* limit) {
+    const uint8_t* start = a;
+    while (a + 8 <= limit) {
+        uint64_t x = read64(a) ^ read64(b);
+        if (x) return (size_t)(a - start) + (size_t)(__builtin_ctzll(x) >> 3);   // little-endian
+        a += 8;
+        b += 8;
+    }
+    while (a < limit && *a == *b) {
+        ++a;
+        ++b;
+    }
+    return (size_t)(a - start);
+}
+
+static inline uint8_t* put_length(uint8_t* op, size_t len) {
+    while (len >= 255) {
+        *op++ = 255;
+        len -= 255;
+    }
+    *op++ = (uint8_t)len;
+    return op;
+}
+
+size_t ff_lz4_compress(const uint8_t* src, size_t n, uint8_t* dst, size_t cap) {
+    uint32_t table[1 << HASH_BITS];
+    const uint8_t* ip     = src;
+    const uint8_t* anchor = src;
+    const uint8_t* end    = src + n;
+    uint8_t*       op     = dst;
+    uint8_t*       oend   = dst + cap;
+
+    if (n > MF_LIMIT) {
+        memset(table, 0, sizeof(table));
+        const uint8_t* mflimit    = end - MF_LIMIT;
+        const uint8_t* matchlimit = end - LAST_LITS;
+        unsigned misses = 0;
+        while (ip < mflimit) {
+            uint32_t seq = read32(ip);
+            uint32_t h = hash4(seq);
+            const uint8_t* cand = src + table[h];
+            table[h] = (uint32_t)(ip - src);
+            if (cand >= ip || ip - cand > MAX_OFFSET || read32(cand) != seq) {
+                ip += 1 + (misses++ >> 6);   // skip faster through incompressible data
+                continue;
+            }
+            misses = 0;
+            while (ip > anchor && cand > src && ip[-1] == cand[-1]) {
+                --ip;
+                --cand;
+            }
+            size_t lit = (size_t)(ip - anchor);
+            size_t ml  = MIN_MATCH + match_len(ip + MIN_MATCH, cand + MIN_MATCH, matchlimit);
+
+            if ((size_t)(oend - op) < 1 + lit / 255 + 1 + lit + 2 + (ml - MIN_MATCH) / 255 + 1) return 0;
+            uint8_t* token = op++;
+            *token = (uint8_t)((lit >= 15 ? 15 : lit) << 4);
+            if (lit >= 15) op = put_length(op, lit - 15);
+            memcpy(op, anchor, lit);
+            op += lit;
+            size_t off = (size_t)(ip - cand);
+            *op++ = (uint8_t)off;
+            *op++ = (uint8_t)(off >> 8);
+            size_t mcode = ml - MIN_MATCH;
+            *token |= (uint8_t)(mcode >= 15 ? 15 : mcode);
+            if (mcode >= 15) op = put_length(op, mcode - 15);
+
+            ip += ml;
+            anchor = ip;
+            if (ip < mflimit) table[hash4(read32(ip - 2))] = (uint32_t)(ip - 2 - src);
+        }
+    }
+
+    size_t lit = (size_t)(end - anchor);
+    if ((size_t)(oend - op) < 1 + lit / 255 + 1 + lit) return 0;
+    uint8_t* token = op++;
+    *token = (uint8_t)((lit >= 15 ? 15 : lit) << 4);
+    if (lit >= 15) op = put_length(op, lit - 15);
+    memcpy(op, anchor, lit);
+    op += lit;
+    return (size_t)(op - dst);
+}
+
+// Reads an extended length (after a nibble of 15). Returns 0 on truncated input.
+static inline int get_length(const uint8_t** ip, const uint8_t* iend, size_t* len) {
+    unsigned b;
+    do {
+        if (*ip >= iend) return 0;
+        b = *(*ip)++;
+        *len += b;
+    } while (b == 255);
+    return 1;
+}
+
+long ff_lz4_decompress(const uint8_t* src, size_t n, uint8_t* dst, size_t cap) {
+    const uint8_t* ip   = src;
+    const uint8_t* iend = src + n;
+    uint8_t*       op   = dst;
+    uint8_t*       oend = dst + cap;
+
+    for (;;) {
+        if (ip >= iend) return -1;
+        unsigned token = *ip++;
+
+        size_t lit = token >> 4;
+        if (lit == 15 && !get_length(&ip, iend, &lit)) return -1;
+        if (lit > (size_t)(iend - ip) || lit > (size_t)(oend - op)) return -1;
+        memcpy(op, ip, lit);
+        op += lit;
+        ip += lit;
+        if (ip == iend) return (long)(op - dst);   // the last sequence has no match
+
+        if (iend - ip < 2) return -1;
+        size_t off = (size_t)ip[0] | (size_t)ip[1] << 8;
+        ip += 2;
+        if (off == 0 || off > (size_t)(op - dst)) return -1;
+
+        size_t ml = token & 15;
+        if (ml == 15 && !get_length(&ip, iend, &ml)) return -1;
+        ml += MIN_MATCH;
+        if (ml > (size_t)(oend - op)) return -1;
+
+        // Overlapping copies repeat the last `off` bytes. Copy in non-overlapping
+        // steps whose distance doubles (it stays a multiple of the period).
+        const uint8_t* from = op - off;
+        size_t dist = off;
+        while (ml > 0) {
+            size_t k = ml < dist ? ml : dist;
+            memcpy(op, from, k);
+            op += k;
+            ml -= k;
+            dist += k;
+        }
+    }
+}
@@ -0,0 +1,28 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Self-contained LZ4 block codec (the standard LZ4 block format, so data is
+// interchangeable with liblz4's LZ4_compress_default / LZ4_decompress_safe).
+// Used by the frame caches; fast enough to decode well above playback rate.
+
+// Worst-case compressed size of `n` bytes.
+static inline size_t ff_lz4_bound(size_t n) {
+    return n + n / 255 + 16;
+}
+
+// Compresses src[0..n) into dst (capacity `cap`). Returns the compressed size,
+// or 0 if it does not fit.
+size_t ff_lz4_compress(const uint8_t* src, size_t n, uint8_t* dst, size_t cap);
+
+// Decompresses a block into dst (capacity `cap`). Returns the decompressed size,
+// or -1 if the block is malformed or does not fit. Never reads or writes out of bounds.
+long   ff_lz4_decompress(const uint8_t* src, size_t n, uint8_t* dst, size_t cap);
+
+#ifdef __cplusplus
+}
+#endif
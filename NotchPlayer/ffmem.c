@@ -0,0 +1,120 @@
+#include "ffmem.h"
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+
+#define FF_HUGE_PAGE (2u * 1024 * 1024)
+
+#ifndef MAP_ANONYMOUS
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+
+static size_t round_up(size_t v, size_t a) {
+    return (v + a - 1) / a * a;
+}
+
+#ifdef __linux__
+// Prefer (not require) the node of the CPU this thread runs on. Uses the raw
+// syscalls so there is no libnuma dependency.
+static int bind_local_node(void* ptr, size_t size) {
+#if defined(SYS_getcpu) && defined(SYS_mbind)
+    unsigned cpu = 0, node = 0;
+    if (syscall(SYS_getcpu, &cpu, &node, NULL) != 0) return -1;
+    if (node >= 64) return -1;
+    unsigned long mask = 1UL << node;
+    const int MPOL_PREFERRED_ = 1;
+    return (int)syscall(SYS_mbind, ptr, size, MPOL_PREFERRED_, &mask, 64UL, 0U);
+#else
+    (void)ptr; (void)size;
+    return -1;
+#endif
+}
+#endif
+
+static void prefault(void* ptr, size_t size, size_t page) {
+    volatile uint8_t* b = ptr;
+    for (size_t off = 0; off < size; off += page) b[off] = 0;
+}
+
+int ff_mem_alloc(FFMemBlock* blk, size_t size, unsigned flags) {
+    memset(blk, 0, sizeof(*blk));
+    if (size == 0) return -1;
+    blk->flags = flags;
+
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    void* ptr = MAP_FAILED;
+    size_t len = round_up(size, page);
+
+#ifdef __linux__
+    if (flags & FF_MEM_HUGEPAGES) {
+        len = round_up(size, FF_HUGE_PAGE);
+#ifdef MAP_HUGETLB
+        // Reserved hugetlbfs pages: guaranteed 2 MB, but only if the admin set some aside.
+        ptr = mmap(NULL, len, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (ptr != MAP_FAILED) blk->granted |= FF_MEM_HUGEPAGES | FF_MEM_GRANTED_HUGETLB;
+#endif
+        if (ptr == MAP_FAILED) {
+            // Transparent huge pages: over-map so the block starts on a 2 MB boundary.
+            size_t over = len + FF_HUGE_PAGE;
+            uint8_t* raw = mmap(NULL, over, PROT_READ | PROT_WRITE,
+                                MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (raw != MAP_FAILED) {
+                uintptr_t a = ((uintptr_t)raw + FF_HUGE_PAGE - 1) & ~(uintptr_t)(FF_HUGE_PAGE - 1);
+                size_t head = a - (uintptr_t)raw;
+                if (head) munmap(raw, head);
+                size_t tail = over - head - len;
+                if (tail) munmap((uint8_t*)a + len, tail);
+                ptr = (void*)a;
+#ifdef MADV_HUGEPAGE
+                if (madvise(ptr, len, MADV_HUGEPAGE) == 0) blk->granted |= FF_MEM_HUGEPAGES;
+#endif
+            }
+        }
+        if (blk->granted & FF_MEM_HUGEPAGES) page = FF_HUGE_PAGE;
+    }
+#endif
+
+    if (ptr == MAP_FAILED) {
+        len = round_up(size, page);
+        ptr = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (ptr == MAP_FAILED) return -1;
+    }
+
+#ifdef __linux__
+    // Placement must be set before the first touch decides where pages land.
+    if ((flags & FF_MEM_NUMA_LOCAL) && bind_local_node(ptr, len) == 0) blk->granted |= FF_MEM_NUMA_LOCAL;
+#endif
+
+    if (flags & FF_MEM_PREFAULT) {
+        prefault(ptr, len, page);
+        blk->granted |= FF_MEM_PREFAULT;
+    }
+    if ((flags & FF_MEM_LOCK) && mlock(ptr, len) == 0) blk->granted |= FF_MEM_LOCK;
+
+    blk->ptr  = ptr;
+    blk->size = len;
+    return 0;
+}
+
+void ff_mem_free(FFMemBlock* blk) {
+    if (!blk || !blk->ptr) return;
+    if (blk->granted & FF_MEM_LOCK) munlock(blk->ptr, blk->size);
+    munmap(blk->ptr, blk->size);
+    blk->ptr = NULL;
+    blk->size = 0;
+}
+
+void ff_mem_page_faults(uint64_t* minor, uint64_t* major) {
+    struct rusage ru;
+    memset(&ru, 0, sizeof(ru));
+    getrusage(RUSAGE_SELF, &ru);
+    if (minor) *minor = (uint64_t)ru.ru_minflt;
+    if (major) *major = (uint64_t)ru.ru_majflt;
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Allocation modes for large, long-lived frame memory (decoder planes, output
+// pools). Everything is best effort: what was actually granted is reported back
+// in FFMemBlock.granted, and the allocation still succeeds with plain pages.
+enum {
+    FF_MEM_HUGEPAGES  = 1u << 0,  // 2 MB pages: hugetlbfs first, then THP madvise (Linux)
+    FF_MEM_PREFAULT   = 1u << 1,  // touch every page now instead of on first use
+    FF_MEM_LOCK       = 1u << 2,  // mlock so the pages are never reclaimed
+    FF_MEM_NUMA_LOCAL = 1u << 3,  // place on the NUMA node of the allocating thread (Linux)
+};
+
+// Extra bit reported in FFMemBlock.granted when hugetlbfs pages were used
+// (FF_MEM_HUGEPAGES alone then means transparent huge pages).
+#define FF_MEM_GRANTED_HUGETLB (1u << 8)
+
+typedef struct FFMemBlock {
+    void*    ptr;
+    size_t   size;      // mapped size (rounded up to the page size in use)
+    unsigned flags;     // requested
+    unsigned granted;   // obtained
+} FFMemBlock;
+
+// Allocates at least `size` bytes, 64-byte aligned. Returns 0, or -1 on failure.
+int  ff_mem_alloc(FFMemBlock* blk, size_t size, unsigned flags);
+void ff_mem_free(FFMemBlock* blk);
+
+// Page faults taken by this process so far (minor = no I/O, major = I/O).
+void ff_mem_page_faults(uint64_t* minor, uint64_t* major);
+
+// Per-frame page-fault accounting kept by players (ff_get_fault_stats).
+typedef struct FFFaultStats {
+    uint64_t frames;
+    uint64_t faults_total;     // minor + major across all measured frames
+    uint64_t faults_max;       // worst single frame
+    uint64_t faults_last;
+} FFFaultStats;
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,197 @@
+#include "ffpacesim.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct SimClock {
+    int64_t now;
+} SimClock;
+
+static int64_t sim_now(void* opaque) {
+    return ((SimClock*)opaque)->now;
+}
+
+static void sim_sleep_until(void* opaque, int64_t deadline_ns) {
+    SimClock* c = opaque;
+    if (deadline_ns > c->now) c->now = deadline_ns;
+}
+
+// splitmix64: small, fast and the same everywhere.
+static uint64_t next_rand(uint64_t* state) {
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+static double cost_us(const FFPaceCost* c, int64_t frame, uint64_t* rng) {
+    double us = c->mean_us;
+    switch (c->kind) {
+    case FF_PACE_BURSTY:
+        if (c->burst_every > 0 && frame % c->burst_every < c->burst_len) us = c->burst_us;
+        break;
+    case FF_PACE_TRACE:
+        us = c->trace_len > 0 ? c->trace_us[frame % c->trace_len] : 0;
+        break;
+    default:
+        break;
+    }
+    // Always draw, so one stage's jitter setting does not shift another's sequence.
+    double u = (next_rand(rng) >> 11) * (1.0 / 9007199254740992.0);
+    us += (2 * u - 1) * c->jitter_us;
+    return us > 0 ? us : 0;
+}
+
+static int cmp_i64(const void* a, const void* b) {
+    int64_t x = *(const int64_t*)a, y = *(const int64_t*)b;
+    return x < y ? -1 : x > y;
+}
+
+int ff_pacesim_run(const FFPaceSimConfig* cfg, FFPaceSimResult* out) {
+    if (!cfg || !out || !(cfg->fps > 0) || cfg->frames <= 0 || cfg->queue_depth < 0 || cfg->display_hz < 0)
+        return -1;
+    for (int k = 0; k < FF_PACE_STAGES; ++k)
+        if (cfg->cost[k].kind == FF_PACE_TRACE && (!cfg->cost[k].trace_us || cfg->cost[k].trace_len <= 0))
+            return -1;
+    memset(out, 0, sizeof(*out));
+
+    SimClock clk = { 0 };
+    FFSchedConfig sc = {
+        .clock = { sim_now, sim_sleep_until, &clk },
+        .frame_interval = 1.0 / cfg->fps,
+        .lead = cfg->lead, .drop_late = cfg->drop_late, .max_drops = cfg->max_drops,
+    };
+    double  hz      = cfg->display_hz > 0 ? cfg->display_hz : cfg->fps;
+    int64_t vsync   = llround(1e9 / hz);
+    int64_t frame   = llround(1e9 / cfg->fps);
+    int     cadence = (int)ceil(hz / cfg->fps - 1e-9);
+    int     depth   = cfg->queue_depth;
+
+    int rc = -1;
+    FFSched* s   = ff_sched_create(&sc);
+    int64_t* shown_at = malloc((size_t)cfg->frames * sizeof(*shown_at));
+    int64_t* taken    = calloc((size_t)(depth > 0 ? depth : 1), sizeof(*taken));   // ring: dequeue times
+    if (!s || !shown_at || !taken) goto fail;
+
+    uint64_t rng = cfg->seed;
+    double   cost_sum[FF_PACE_STAGES] = { 0 };
+    int64_t  decoded_at = 0;     // decode thread: when the previous frame was done
+    int64_t  origin = 0;         // vsync grid, anchored where playback starts
+    int      shown = 0;
+
+    for (int64_t n = 0; n < cfg->frames; ++n) {
+        double us = 0;
+        for (int k = 0; k < FF_PACE_STAGES; ++k) {
+            double c = cost_us(&cfg->cost[k], n, &rng);
+            cost_sum[k] += c;
+            us += c;
+        }
+        int64_t cost = llround(us * 1000);
+        if (depth == 0) {
+            clk.now += cost;
+        } else {
+            // The decode thread starts a frame once the previous one is done and
+            // the queue has room, i.e. frame n - depth has been taken.
+            int64_t start = decoded_at;
+            if (n >= depth && taken[n % depth] > start) start = taken[n % depth];
+            decoded_at = start + cost;
+            if (decoded_at > clk.now) clk.now = decoded_at;
+            taken[n % depth] = clk.now;
+        }
+
+        double pts = n / cfg->fps;
+        if (n == 0) {
+            // Playback starts with the first frame in hand.
+            ff_sched_play(s);
+            origin = clk.now;
+        }
+        int r = ff_sched_wait(s, pts);
+        if (r != FF_SCHED_PRESENT) continue;   // dropped
+        int64_t handed = clk.now;
+        ff_sched_presented(s, pts);
+        clk.now += llround(cfg->present_us * 1000);
+
+        // Shown at the first vsync at or after both due time and hand-over.
+        int64_t due = ff_sched_due_ns(s, pts);
+        int64_t at  = handed > due ? handed : due;
+        int64_t v   = (at - origin - 1000 + vsync - 1) / vsync;   // 1 us of rounding slack
+        int64_t on  = origin + (v > 0 ? v : 0) * vsync;
+        if (shown > 0 && on <= shown_at[shown - 1]) {
+            out->superseded++;   // the previous image never made it to the screen
+            continue;
+        }
+        shown_at[shown++] = on;
+    }
+
+    ff_sched_get_stats(s, &out->sched);
+    out->shown = (uint64_t)shown;
+    out->sim_seconds = clk.now / 1e9;
+    for (int k = 0; k < FF_PACE_STAGES; ++k) out->cost_mean_us[k] = cost_sum[k] / cfg->frames;
+
+    // Display intervals. shown_at is reused for the sorted intervals.
+    int nint = shown - 1;
+    double sum = 0, sum2 = 0;
+    for (int i = 0; i < nint; ++i) {
+        int64_t d = shown_at[i + 1] - shown_at[i];
+        int64_t k = d / vsync;
+        out->interval_hist[k < FF_PACE_HIST_BUCKETS ? k : FF_PACE_HIST_BUCKETS - 1]++;
+        if (k > cadence) out->repeated += (uint64_t)(k - cadence);
+        if (2 * d > 3 * frame) out->stalls++;
+        sum  += d;
+        sum2 += (double)d * d;
+        shown_at[i] = d;
+    }
+    if (nint > 0) {
+        double mean = sum / nint;
+        out->interval_mean_ms   = mean / 1e6;
+        out->interval_stddev_ms = sqrt(fmax(sum2 / nint - mean * mean, 0)) / 1e6;
+        qsort(shown_at, (size_t)nint, sizeof(*shown_at), cmp_i64);
+        out->interval_p99_ms = shown_at[(int)ceil(0.99 * nint) - 1] / 1e6;
+        out->interval_max_ms = shown_at[nint - 1] / 1e6;
+    }
+    rc = 0;
+
+fail:
+    ff_sched_destroy(s);
+    free(shown_at);
+    free(taken);
+    return rc;
+}
+
+double* ff_pacesim_load_trace(const char* path, int* count) {
+    if (count) *count = 0;
+    FILE* f = path ? fopen(path, "r") : NULL;
+    if (!f) return NULL;
+    double* v = NULL;
+    int n = 0, cap = 0;
+    char line[256];
+    while (fgets(line, sizeof(line), f)) {
+        char* p = line;
+        while (*p == ' ' || *p == '\t') ++p;
+        if (*p == '#' || *p == '\n' || *p == '\r' || *p == 0) continue;
+        char* end;
+        double us = strtod(p, &end);
+        if (end == p || !(us >= 0)) goto fail;
+        if (n == cap) {
+            int ncap = cap ? cap * 2 : 256;
+            double* nv = realloc(v, (size_t)ncap * sizeof(*v));
+            if (!nv) goto fail;
+            v = nv;
+            cap = ncap;
+        }
+        v[n++] = us;
+    }
+    fclose(f);
+    if (n == 0) {
+        free(v);
+        return NULL;
+    }
+    if (count) *count = n;
+    return v;
+
+fail:
+    fclose(f);
+    free(v);
+    return NULL;
+}
@@ -0,0 +1,82 @@
+#pragma once
+#include <stdint.h>
+#include "ffsched.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Pacing simulator: plays a clip through the presentation scheduler (ffsched.h)
+// on a simulated clock, with per-frame read, decode and convert costs drawn
+// from synthetic distributions or replayed from a trace. No media, threads or
+// display are involved, so a run is exact and repeatable: the same config
+// always gives the same result. Used to reproduce stutter, compare pacing
+// policies and guard them in tests.
+//
+// The model follows the app: frames are decoded on the presenting thread, or
+// by a decode thread up to `queue_depth` frames ahead; each one waits for the
+// scheduler, is handed to the display, and appears at the first vsync at or
+// after both its due time and its hand-over.
+
+typedef enum FFPaceCostKind {
+    FF_PACE_CONSTANT = 0,   // mean_us, +- jitter_us
+    FF_PACE_BURSTY,         // mean_us, with burst_len frames of burst_us every burst_every frames
+    FF_PACE_TRACE           // trace_us[i % trace_len], +- jitter_us
+} FFPaceCostKind;
+
+typedef struct FFPaceCost {
+    FFPaceCostKind kind;
+    double         mean_us;
+    double         jitter_us;     // uniform, from the config's seed
+    double         burst_us;
+    int            burst_every;
+    int            burst_len;
+    const double*  trace_us;      // not copied; must outlive the run
+    int            trace_len;
+} FFPaceCost;
+
+enum { FF_PACE_READ = 0, FF_PACE_DECODE, FF_PACE_CONVERT, FF_PACE_STAGES };
+
+typedef struct FFPaceSimConfig {
+    double     fps;               // content frame rate; required
+    double     display_hz;        // vsync rate; 0 = fps
+    int        frames;            // frames to play; required
+    int        queue_depth;       // frames decoded ahead on another thread; 0 = decode inline
+    FFPaceCost cost[FF_PACE_STAGES];
+    double     present_us;        // cost of handing a frame over
+    uint64_t   seed;
+    // Scheduler policy, as in FFSchedConfig (0 = its defaults).
+    double     lead;
+    double     drop_late;
+    int        max_drops;
+} FFPaceSimConfig;
+
+// Display intervals (between consecutive new images on screen) in vsyncs:
+// [k] counts intervals of k vsyncs, the last bucket everything longer.
+#define FF_PACE_HIST_BUCKETS 8
+
+typedef struct FFPaceSimResult {
+    FFSchedStats sched;           // as reported by the scheduler
+    uint64_t     shown;           // frames that reached the screen
+    uint64_t     superseded;      // presented, but replaced before their vsync
+    uint64_t     repeated;        // vsyncs an image stayed up past its cadence
+    uint64_t     stalls;          // display intervals over 1.5 frame times: visible hitches
+    uint64_t     interval_hist[FF_PACE_HIST_BUCKETS];
+    double       interval_mean_ms;
+    double       interval_stddev_ms;
+    double       interval_p99_ms;
+    double       interval_max_ms;
+    double       cost_mean_us[FF_PACE_STAGES];
+    double       sim_seconds;     // simulated playback time
+} FFPaceSimResult;
+
+// Runs the simulation. Returns 0, or -1 on a bad config or out of memory.
+int     ff_pacesim_run(const FFPaceSimConfig* cfg, FFPaceSimResult* out);
+
+// Reads a cost trace: one value in microseconds per line ('#' comments and
+// blank lines skipped). Returns a malloc'd array and its length, or NULL.
+double* ff_pacesim_load_trace(const char* path, int* count);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,639 @@
+#include "ffpackcache.h"
+#include "fflz4.h"
+#include "ffgovernor.h"
+#include "ffpool.h"
+#include "ffutil.h"
+#include "ffworkers.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define RAW_BAND       0x80000000u   // band stored uncompressed (did not shrink)
+#define MIN_BAND_BYTES (64 * 1024)   // below this, splitting costs more than it gains
+
+typedef struct Packed Packed;
+struct Packed {
+    int64_t       index;
+    double        pts;
+    int           width, height;
+    FFPixelFormat format;
+    int           row_bytes;
+    int           bands, band_rows;
+    uint32_t*     sizes;     // per band, RAW_BAND if stored raw
+    size_t*       offsets;   // per band, into data
+    uint8_t*      data;
+    size_t        bytes;     // compressed
+    size_t        raw_bytes;
+    int           users;     // being decompressed: not evictable
+    Packed*       hnext;     // hash chain
+    Packed*       newer;     // recency list: head = most recent
+    Packed*       older;
+};
+
+struct FFPackCache {
+    FFPackCacheConfig cfg;
+    FFFrameSink*    sink;
+    FFWorkers*      workers;
+
+    pthread_mutex_t lock;
+    pthread_cond_t  work_cv;       // something to compress / decompress, or stopping
+    pthread_cond_t  idle_cv;       // compression queue drained
+    Packed**        buckets;       // power-of-two table
+    int             nbuckets;
+    Packed*         newest;
+    Packed*         oldest;
+    FFPackCacheStats stats;
+
+    // Readahead: ready[] (cfg.readahead slots) holds decompressed frames of
+    // [ahead_lo, ahead_lo + ahead); ahead is lowered by the memory governor.
+    int64_t         ahead_lo;      // -1 until a playhead is set
+    int             ahead;
+    int             ahead_stalled; // the sink ran dry; retried on the next playhead move
+    FFFrameRef**    ready;
+
+    // Memory governor (ffgovernor.h): compressed frames and readahead are
+    // capped separately.
+    size_t          cap;           // compressed bytes; SIZE_MAX = none
+    size_t          frame_bytes;   // raw size of the last packed frame
+    FFGovClient*    gov;
+    FFGovClient*    gov_ahead;
+
+    // Compression queue
+    FFFrameRef**    queue;
+    int             head, count, busy, stopping;
+    pthread_t       thread;
+    uint8_t*        scratch;       // per band: packed rows + compressed output
+    size_t          scratch_size;
+};
+
+// ---- Index (pc->lock held) ----
+
+static unsigned bucket_of(const FFPackCache* pc, int64_t index) {
+    uint64_t h = (uint64_t)index * 0x9e3779b97f4a7c15ULL;
+    return (unsigned)(h >> 32) & (unsigned)(pc->nbuckets - 1);
+}
+
+static Packed* find(const FFPackCache* pc, int64_t index) {
+    for (Packed* e = pc->buckets[bucket_of(pc, index)]; e; e = e->hnext)
+        if (e->index == index) return e;
+    return NULL;
+}
+
+static void list_unlink(FFPackCache* pc, Packed* e) {
+    if (e->newer) e->newer->older = e->older; else pc->newest = e->older;
+    if (e->older) e->older->newer = e->newer; else pc->oldest = e->newer;
+    e->newer = e->older = NULL;
+}
+
+static void list_push_newest(FFPackCache* pc, Packed* e) {
+    e->older = pc->newest;
+    e->newer = NULL;
+    if (pc->newest) pc->newest->newer = e; else pc->oldest = e;
+    pc->newest = e;
+}
+
+static void grow(FFPackCache* pc) {
+    int n = pc->nbuckets * 2;
+    Packed** b = calloc((size_t)n, sizeof(*b));
+    if (!b) return;   // keep the longer chains
+    Packed** old = pc->buckets;
+    int oldn = pc->nbuckets;
+    pc->buckets  = b;
+    pc->nbuckets = n;
+    for (int i = 0; i < oldn; ++i) {
+        for (Packed* e = old[i], *next; e; e = next) {
+            next = e->hnext;
+            unsigned k = bucket_of(pc, e->index);
+            e->hnext = b[k];
+            b[k] = e;
+        }
+    }
+    free(old);
+}
+
+static void packed_free(Packed* e) {
+    if (!e) return;
+    free(e->sizes);
+    free(e->offsets);
+    free(e->data);
+    free(e);
+}
+
+static void remove_entry(FFPackCache* pc, Packed* e) {
+    Packed** pp = &pc->buckets[bucket_of(pc, e->index)];
+    while (*pp != e) pp = &(*pp)->hnext;
+    *pp = e->hnext;
+    list_unlink(pc, e);
+    pc->stats.bytes     -= e->bytes;
+    pc->stats.raw_bytes -= e->raw_bytes;
+    pc->stats.entries--;
+    packed_free(e);
+}
+
+// Evicts idle entries, oldest first, until at most `target` bytes are held.
+static void evict_to(FFPackCache* pc, size_t target) {
+    Packed* e = pc->oldest;
+    while (e && pc->stats.bytes > target) {
+        Packed* newer = e->newer;
+        if (e->users == 0) {
+            remove_entry(pc, e);
+            pc->stats.evictions++;
+        }
+        e = newer;
+    }
+}
+
+static size_t limit(const FFPackCache* pc) {
+    return pc->cap < pc->cfg.budget_bytes ? pc->cap : pc->cfg.budget_bytes;
+}
+
+// Drops ready frames outside [ahead_lo, ahead_lo + ahead).
+static void drop_ready_outside(FFPackCache* pc) {
+    for (int i = 0; i < pc->cfg.readahead; ++i) {
+        FFFrameRef* f = pc->ready[i];
+        if (f && (ff_frame_index(f) < pc->ahead_lo || ff_frame_index(f) >= pc->ahead_lo + pc->ahead)) {
+            ff_frame_release(f);
+            pc->ready[i] = NULL;
+            pc->stats.ready--;
+        }
+    }
+}
+
+static int ready_slot(const FFPackCache* pc, int64_t index) {
+    for (int i = 0; i < pc->cfg.readahead; ++i)
+        if (pc->ready[i] && ff_frame_index(pc->ready[i]) == index) return i;
+    return -1;
+}
+
+// ---- Band codec ----
+
+typedef struct PackJob {
+    const uint8_t* src;
+    int            stride;
+    const Packed*  e;
+    uint8_t*       scratch;
+    size_t         band_cap;        // scratch bytes per band
+    uint32_t*      sizes;
+} PackJob;
+
+static void pack_band(void* ctx, int b) {
+    PackJob* j = ctx;
+    const Packed* e = j->e;
+    int y0 = b * e->band_rows;
+    int rows = e->height - y0 < e->band_rows ? e->height - y0 : e->band_rows;
+    size_t raw = (size_t)rows * (size_t)e->row_bytes;
+    uint8_t* rows_buf = j->scratch + (size_t)b * j->band_cap;
+    uint8_t* out = rows_buf + (size_t)e->band_rows * (size_t)e->row_bytes;
+
+    const uint8_t* src = j->src + (size_t)y0 * j->stride;
+    if (j->stride != e->row_bytes) {
+        for (int y = 0; y < rows; ++y)
+            memcpy(rows_buf + (size_t)y * e->row_bytes, src + (size_t)y * j->stride, (size_t)e->row_bytes);
+        src = rows_buf;
+    }
+    size_t n = ff_lz4_compress(src, raw, out, ff_lz4_bound(raw));
+    if (n > 0 && n < raw) {
+        j->sizes[b] = (uint32_t)n;
+    } else {
+        memcpy(out, src, raw);
+        j->sizes[b] = (uint32_t)raw | RAW_BAND;
+    }
+}
+
+typedef struct UnpackJob {
+    const Packed*      e;
+    const FFSinkImage* img;
+    atomic_int         failed;
+} UnpackJob;
+
+static void unpack_band(void* ctx, int b) {
+    UnpackJob* j = ctx;
+    const Packed* e = j->e;
+    int y0 = b * e->band_rows;
+    int rows = e->height - y0 < e->band_rows ? e->height - y0 : e->band_rows;
+    size_t raw = (size_t)rows * (size_t)e->row_bytes;
+    const uint8_t* src = e->data + e->offsets[b];
+    uint32_t size = e->sizes[b] & ~RAW_BAND;
+    int stride = j->img->linesize[0];
+    uint8_t* dst = j->img->data[0] + (size_t)y0 * stride;
+
+    if (stride == e->row_bytes) {
+        if (e->sizes[b] & RAW_BAND) memcpy(dst, src, raw);
+        else if (ff_lz4_decompress(src, size, dst, raw) != (long)raw) atomic_store(&j->failed, 1);
+        return;
+    }
+    uint8_t* tmp = NULL;
+    if (!(e->sizes[b] & RAW_BAND)) {
+        tmp = malloc(raw);
+        if (!tmp || ff_lz4_decompress(src, size, tmp, raw) != (long)raw) {
+            atomic_store(&j->failed, 1);
+            free(tmp);
+            return;
+        }
+        src = tmp;
+    }
+    for (int y = 0; y < rows; ++y)
+        memcpy(dst + (size_t)y * stride, src + (size_t)y * e->row_bytes, (size_t)e->row_bytes);
+    free(tmp);
+}
+
+// Compresses `f` into a new entry (cache thread only: uses pc->scratch).
+static Packed* pack_frame(FFPackCache* pc, FFFrameRef* f) {
+    Packed* e = calloc(1, sizeof(*e));
+    if (!e) return NULL;
+    e->index     = ff_frame_index(f);
+    e->pts       = ff_frame_pts(f);
+    e->width     = ff_frame_width(f);
+    e->height    = ff_frame_height(f);
+    e->format    = ff_frame_format(f);
+    e->row_bytes = e->width * ff_pixfmt_bytes_per_pixel(e->format);
+    e->raw_bytes = (size_t)e->row_bytes * (size_t)e->height;
+
+    // About four bands per thread, none smaller than MIN_BAND_BYTES.
+    int bands = ff_workers_count(pc->workers) * 4;
+    int max_bands = (int)(e->raw_bytes / MIN_BAND_BYTES);
+    if (bands > max_bands) bands = max_bands;
+    if (bands > e->height) bands = e->height;
+    if (bands < 1) bands = 1;
+    e->band_rows = (e->height + bands - 1) / bands;
+    e->bands     = (e->height + e->band_rows - 1) / e->band_rows;
+
+    size_t band_raw = (size_t)e->band_rows * (size_t)e->row_bytes;
+    size_t band_cap = band_raw + ff_lz4_bound(band_raw);
+    if (pc->scratch_size < band_cap * (size_t)e->bands) {
+        free(pc->scratch);
+        pc->scratch_size = band_cap * (size_t)e->bands;
+        pc->scratch = malloc(pc->scratch_size);
+        if (!pc->scratch) pc->scratch_size = 0;
+    }
+    e->sizes   = calloc((size_t)e->bands, sizeof(*e->sizes));
+    e->offsets = calloc((size_t)e->bands, sizeof(*e->offsets));
+    if (!pc->scratch || !e->sizes || !e->offsets) goto fail;
+
+    PackJob j = { ff_frame_plane(f, 0), ff_frame_stride(f, 0), e, pc->scratch, band_cap, e->sizes };
+    ff_workers_run(pc->workers, e->bands, pack_band, &j);
+
+    for (int b = 0; b < e->bands; ++b) {
+        e->offsets[b] = e->bytes;
+        e->bytes += e->sizes[b] & ~RAW_BAND;
+    }
+    e->data = malloc(e->bytes ? e->bytes : 1);
+    if (!e->data) goto fail;
+    for (int b = 0; b < e->bands; ++b)
+        memcpy(e->data + e->offsets[b], pc->scratch + (size_t)b * band_cap + band_raw, e->sizes[b] & ~RAW_BAND);
+    return e;
+fail:
+    packed_free(e);
+    return NULL;
+}
+
+// Decompresses `e` into a sink image (any thread; e->users keeps it alive).
+static FFFrameRef* unpack_frame(FFPackCache* pc, const Packed* e) {
+    FFSinkImage img;
+    if (pc->sink->acquire(pc->sink, e->width, e->height, e->format, &img) < 0) return NULL;
+    int64_t t0 = ff_now_ns();
+    UnpackJob j = { .e = e, .img = &img };
+    atomic_init(&j.failed, 0);
+    ff_workers_run(pc->workers, e->bands, unpack_band, &j);
+    if (atomic_load(&j.failed)) {
+        pc->sink->discard(pc->sink, &img);
+        return NULL;
+    }
+    int64_t dt = ff_now_ns() - t0;
+    FFFrameRef* f = pc->sink->commit(pc->sink, &img, e->pts, e->index);
+    if (f) {
+        pthread_mutex_lock(&pc->lock);
+        pc->stats.decompressed++;
+        pc->stats.decompressed_raw_bytes += e->raw_bytes;
+        pc->stats.decompress_ns += (uint64_t)dt;
+        pthread_mutex_unlock(&pc->lock);
+    }
+    return f;
+}
+
+// ---- Cache thread ----
+
+// Next frame of the readahead window that is held but not yet decompressed.
+static Packed* next_ahead(FFPackCache* pc) {
+    if (pc->ahead_lo < 0 || pc->ahead_stalled) return NULL;
+    for (int i = 0; i < pc->ahead; ++i) {
+        int64_t index = pc->ahead_lo + i;
+        Packed* e = find(pc, index);
+        if (e && e->users == 0 && ready_slot(pc, index) < 0) return e;
+    }
+    return NULL;
+}
+
+static void* cache_main(void* arg) {
+    FFPackCache* pc = arg;
+    pthread_mutex_lock(&pc->lock);
+    for (;;) {
+        Packed* e = NULL;
+        while (!pc->stopping && pc->count == 0 && !(e = next_ahead(pc)))
+            ff_cond_wait_ns(&pc->work_cv, &pc->lock, -1);
+        if (pc->stopping) break;
+
+        // The frame playback needs next beats filling the cache.
+        if ((e = next_ahead(pc))) {
+            e->users++;
+            pthread_mutex_unlock(&pc->lock);
+            FFFrameRef* f = unpack_frame(pc, e);
+            pthread_mutex_lock(&pc->lock);
+            e->users--;
+            if (!f) {
+                pc->ahead_stalled = 1;
+                continue;
+            }
+            int64_t index = ff_frame_index(f);
+            int slot = -1;
+            if (index >= pc->ahead_lo && index < pc->ahead_lo + pc->ahead && ready_slot(pc, index) < 0)
+                for (int i = 0; i < pc->cfg.readahead && slot < 0; ++i)
+                    if (!pc->ready[i]) slot = i;
+            if (slot >= 0) {
+                pc->ready[slot] = f;
+                pc->stats.ready++;
+            } else {
+                ff_frame_release(f);   // the playhead moved on meanwhile
+            }
+            continue;
+        }
+
+        FFFrameRef* f = pc->queue[pc->head];
+        pc->head = (pc->head + 1) % pc->cfg.queue_depth;
+        pc->count--;
+        pc->busy = 1;
+        pthread_mutex_unlock(&pc->lock);
+
+        int64_t t0 = ff_now_ns();
+        e = pack_frame(pc, f);
+        int64_t dt = ff_now_ns() - t0;
+        ff_frame_release(f);
+
+        pthread_mutex_lock(&pc->lock);
+        pc->busy = 0;
+        if (e && !find(pc, e->index)) {
+            unsigned k = bucket_of(pc, e->index);
+            e->hnext = pc->buckets[k];
+            pc->buckets[k] = e;
+            list_push_newest(pc, e);
+            pc->stats.entries++;
+            pc->stats.bytes     += e->bytes;
+            pc->stats.raw_bytes += e->raw_bytes;
+            pc->stats.packed++;
+            pc->stats.compressed_raw_bytes += e->raw_bytes;
+            pc->stats.compress_ns += (uint64_t)dt;
+            if (pc->stats.entries > pc->nbuckets) grow(pc);
+            pc->frame_bytes = e->raw_bytes;
+            evict_to(pc, limit(pc));
+            pthread_mutex_unlock(&pc->lock);
+            ff_governor_notify();
+            pthread_mutex_lock(&pc->lock);
+        } else {
+            packed_free(e);
+        }
+        if (pc->count == 0) pthread_cond_broadcast(&pc->idle_cv);
+    }
+    pthread_mutex_unlock(&pc->lock);
+    return NULL;
+}
+
+// ---- Memory governor ----
+
+static size_t gov_usage(void* opaque, size_t* wanted) {
+    FFPackCache* pc = opaque;
+    pthread_mutex_lock(&pc->lock);
+    size_t n = pc->stats.bytes;
+    *wanted  = pc->cfg.budget_bytes;
+    pthread_mutex_unlock(&pc->lock);
+    return n;
+}
+
+static void gov_set_cap(void* opaque, size_t cap) {
+    FFPackCache* pc = opaque;
+    pthread_mutex_lock(&pc->lock);
+    pc->cap = cap;
+    pc->stats.cap_bytes = cap;
+    evict_to(pc, limit(pc));
+    pthread_mutex_unlock(&pc->lock);
+}
+
+static size_t gov_ahead_usage(void* opaque, size_t* wanted) {
+    FFPackCache* pc = opaque;
+    size_t n = 0;
+    pthread_mutex_lock(&pc->lock);
+    for (int i = 0; i < pc->cfg.readahead; ++i)
+        if (pc->ready[i]) n += ff_frame_bytes(pc->ready[i]);
+    *wanted = (size_t)pc->cfg.readahead * pc->frame_bytes;
+    pthread_mutex_unlock(&pc->lock);
+    return n;
+}
+
+// Readahead depth that fits `cap` bytes of decompressed frames.
+static void gov_ahead_set_cap(void* opaque, size_t cap) {
+    FFPackCache* pc = opaque;
+    pthread_mutex_lock(&pc->lock);
+    size_t n = cap == SIZE_MAX ? (size_t)pc->cfg.readahead :
+               pc->frame_bytes ? cap / pc->frame_bytes : 0;
+    pc->ahead = n < (size_t)pc->cfg.readahead ? (int)n : pc->cfg.readahead;
+    pc->stats.readahead = pc->ahead;
+    drop_ready_outside(pc);
+    pthread_cond_signal(&pc->work_cv);
+    pthread_mutex_unlock(&pc->lock);
+}
+
+// ---- API ----
+
+FFPackCache* ff_packcache_create(const FFPackCacheConfig* cfg) {
+    FFPackCache* pc = calloc(1, sizeof(*pc));
+    if (!pc) {
+        if (cfg) ff_sink_destroy(cfg->sink);
+        return NULL;
+    }
+    if (cfg) pc->cfg = *cfg;
+    if (pc->cfg.budget_bytes == 0) pc->cfg.budget_bytes = FF_PACKCACHE_DEFAULT_BUDGET;
+    if (pc->cfg.readahead <= 0) pc->cfg.readahead = 4;
+    if (pc->cfg.queue_depth <= 0) pc->cfg.queue_depth = 4;
+    pc->sink = pc->cfg.sink;
+    pc->cfg.sink = NULL;
+    if (!pc->sink) {
+        FFFramePoolConfig pcfg = { .max_buffers = pc->cfg.readahead + FF_POOL_DEFAULT_BUFFERS,
+                                   .wait_timeout_ms = FF_POOL_DEFAULT_TIMEOUT_MS };
+        FFFramePool* pool = ff_pool_create(&pcfg);
+        pc->sink = pool ? ff_sink_pool_create(pool) : NULL;
+        ff_pool_destroy(pool);
+    }
+    pc->workers  = ff_workers_create(pc->cfg.threads);
+    pc->nbuckets = 64;
+    pc->buckets  = calloc((size_t)pc->nbuckets, sizeof(*pc->buckets));
+    pc->ready    = calloc((size_t)pc->cfg.readahead, sizeof(*pc->ready));
+    pc->queue    = calloc((size_t)pc->cfg.queue_depth, sizeof(*pc->queue));
+    pc->ahead_lo = -1;
+    pc->ahead    = pc->cfg.readahead;
+    pc->cap      = SIZE_MAX;
+    pc->stats.budget_bytes = pc->cfg.budget_bytes;
+    pc->stats.cap_bytes    = SIZE_MAX;
+    pc->stats.readahead    = pc->ahead;
+    pthread_mutex_init(&pc->lock, NULL);
+    ff_cond_init(&pc->work_cv);
+    ff_cond_init(&pc->idle_cv);
+    if (!pc->sink || !pc->workers || !pc->buckets || !pc->ready || !pc->queue ||
+        pthread_create(&pc->thread, NULL, cache_main, pc) != 0) {
+        pc->stopping = 1;   // no thread to join
+        ff_packcache_destroy(pc);
+        return NULL;
+    }
+    FFGovClientConfig gc = { .name = "pack cache", .kind = FF_GOV_CACHE,
+                             .priority = FF_GOV_PRIORITY_PACK_CACHE, .opaque = pc,
+                             .usage = gov_usage, .set_cap = gov_set_cap };
+    pc->gov = ff_governor_register(&gc);
+    // Readahead frames live in the sink's pool buffers.
+    FFGovClientConfig ga = { .name = "pack readahead", .kind = FF_GOV_PREFETCH,
+                             .priority = FF_GOV_PRIORITY_READAHEAD, .borrowed = 1, .opaque = pc,
+                             .usage = gov_ahead_usage, .set_cap = gov_ahead_set_cap };
+    pc->gov_ahead = ff_governor_register(&ga);
+    return pc;
+}
+
+void ff_packcache_destroy(FFPackCache* pc) {
+    if (!pc) return;
+    ff_governor_unregister(pc->gov);
+    ff_governor_unregister(pc->gov_ahead);
+    pthread_mutex_lock(&pc->lock);
+    int had_thread = !pc->stopping;
+    pc->stopping = 1;
+    pthread_cond_broadcast(&pc->work_cv);
+    pthread_mutex_unlock(&pc->lock);
+    if (had_thread) pthread_join(pc->thread, NULL);
+
+    for (; pc->count > 0; --pc->count) {
+        ff_frame_release(pc->queue[pc->head]);
+        pc->head = (pc->head + 1) % pc->cfg.queue_depth;
+    }
+    if (pc->buckets) ff_packcache_clear(pc);
+    pthread_mutex_destroy(&pc->lock);
+    pthread_cond_destroy(&pc->work_cv);
+    pthread_cond_destroy(&pc->idle_cv);
+    if (pc->sink) ff_sink_destroy(pc->sink);
+    ff_workers_destroy(pc->workers);
+    free(pc->buckets);
+    free(pc->ready);
+    free(pc->queue);
+    free(pc->scratch);
+    free(pc);
+}
+
+int ff_packcache_put(FFPackCache* pc, FFFrameRef* f) {
+    if (!pc || !f || ff_frame_index(f) < 0) return -1;
+    pthread_mutex_lock(&pc->lock);
+    int r = 0;
+    if (find(pc, ff_frame_index(f))) {
+        r = 0;
+    } else if (pc->count == pc->cfg.queue_depth) {
+        pc->stats.dropped++;
+    } else {
+        pc->queue[(pc->head + pc->count) % pc->cfg.queue_depth] = ff_frame_retain(f);
+        pc->count++;
+        pthread_cond_signal(&pc->work_cv);
+        r = 1;
+    }
+    pthread_mutex_unlock(&pc->lock);
+    return r;
+}
+
+void ff_packcache_flush(FFPackCache* pc) {
+    if (!pc) return;
+    pthread_mutex_lock(&pc->lock);
+    while (pc->count > 0 || pc->busy) ff_cond_wait_ns(&pc->idle_cv, &pc->lock, -1);
+    pthread_mutex_unlock(&pc->lock);
+}
+
+FFFrameRef* ff_packcache_get(FFPackCache* pc, int64_t index) {
+    if (!pc) return NULL;
+    pthread_mutex_lock(&pc->lock);
+    int slot = ready_slot(pc, index);
+    if (slot >= 0) {
+        FFFrameRef* f = pc->ready[slot];
+        pc->ready[slot] = NULL;
+        pc->stats.ready--;
+        pc->stats.ready_hits++;
+        Packed* e = find(pc, index);
+        if (e) {
+            list_unlink(pc, e);
+            list_push_newest(pc, e);
+        }
+        pthread_cond_signal(&pc->work_cv);   // room to read further ahead
+        pthread_mutex_unlock(&pc->lock);
+        return f;
+    }
+    Packed* e = find(pc, index);
+    if (!e) {
+        pc->stats.misses++;
+        pthread_mutex_unlock(&pc->lock);
+        return NULL;
+    }
+    list_unlink(pc, e);
+    list_push_newest(pc, e);
+    e->users++;
+    pthread_mutex_unlock(&pc->lock);
+
+    FFFrameRef* f = unpack_frame(pc, e);
+
+    pthread_mutex_lock(&pc->lock);
+    e->users--;
+    if (f) pc->stats.sync_hits++;
+    else pc->stats.misses++;
+    pthread_mutex_unlock(&pc->lock);
+    return f;
+}
+
+int ff_packcache_contains(FFPackCache* pc, int64_t index) {
+    if (!pc) return 0;
+    pthread_mutex_lock(&pc->lock);
+    int r = find(pc, index) != NULL;
+    pthread_mutex_unlock(&pc->lock);
+    return r;
+}
+
+void ff_packcache_set_playhead(FFPackCache* pc, int64_t index) {
+    if (!pc) return;
+    pthread_mutex_lock(&pc->lock);
+    int moved = index != pc->ahead_lo;
+    pc->ahead_lo = index;
+    drop_ready_outside(pc);
+    if (moved) pc->ahead_stalled = 0;
+    pthread_cond_signal(&pc->work_cv);
+    pthread_mutex_unlock(&pc->lock);
+}
+
+void ff_packcache_set_budget(FFPackCache* pc, size_t budget_bytes) {
+    if (!pc || budget_bytes == 0) return;
+    pthread_mutex_lock(&pc->lock);
+    pc->cfg.budget_bytes = budget_bytes;
+    pc->stats.budget_bytes = budget_bytes;
+    evict_to(pc, limit(pc));
+    pthread_mutex_unlock(&pc->lock);
+}
+
+void ff_packcache_clear(FFPackCache* pc) {
+    if (!pc) return;
+    pthread_mutex_lock(&pc->lock);
+    for (int i = 0; i < pc->cfg.readahead; ++i) {
+        ff_frame_release(pc->ready[i]);
+        pc->ready[i] = NULL;
+    }
+    pc->stats.ready = 0;
+    evict_to(pc, 0);   // entries being decompressed right now stay
+    pthread_mutex_unlock(&pc->lock);
+}
+
+void ff_packcache_get_stats(FFPackCache* pc, FFPackCacheStats* out) {
+    if (!pc || !out) return;
+    pthread_mutex_lock(&pc->lock);
+    *out = pc->stats;
+    pthread_mutex_unlock(&pc->lock);
+    double s = out->decompress_ns / 1e9;
+    out->decompress_fps  = s > 0 ? out->decompressed / s : 0;
+    out->decompress_mb_s = s > 0 ? out->decompressed_raw_bytes / s / 1e6 : 0;
+}
@@ -0,0 +1,90 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include "ffframe.h"
+#include "ffsink.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Compressed in-memory frame cache for one clip: converted frames are held
+// LZ4-compressed (fflz4.h) against a byte budget, so the same memory covers
+// several times more frames than FFFrameCache for content that compresses
+// (graphics, large flat or transparent areas; camera footage gains little).
+//
+// Both directions run off the caller's thread. Frames handed to put() are
+// compressed by a background thread; after set_playhead() the same thread
+// decompresses the next `readahead` frames into sink images, so get() on the
+// playback thread normally just takes a finished frame. Each frame is split
+// into horizontal bands compressed independently, which lets one frame
+// compress or decompress on all cores (FFWorkers). Least recently used frames
+// are evicted first. Compressed frames and readahead register separately with
+// the memory governor (ffgovernor.h), which may cap either. Thread-safe.
+typedef struct FFPackCache FFPackCache;
+
+typedef struct FFPackCacheConfig {
+    size_t       budget_bytes;   // compressed bytes held; 0 = FF_PACKCACHE_DEFAULT_BUDGET
+    int          readahead;      // frames kept decompressed ahead of the playhead; 0 = 4
+    int          threads;        // parallelism per frame; 0 = online CPUs
+    int          queue_depth;    // frames waiting to be compressed (a full queue drops); 0 = 4
+    // Where decompressed frames are written; the cache takes ownership and uses
+    // it from its own thread (pooled sinks are safe). NULL = a heap pool sink
+    // of readahead + FF_POOL_DEFAULT_BUFFERS buffers.
+    FFFrameSink* sink;
+} FFPackCacheConfig;
+
+#define FF_PACKCACHE_DEFAULT_BUDGET ((size_t)512 * 1024 * 1024)
+
+typedef struct FFPackCacheStats {
+    uint64_t ready_hits;         // get() served by readahead
+    uint64_t sync_hits;          // get() that had to decompress on the spot
+    uint64_t misses;
+    uint64_t packed;             // frames compressed
+    uint64_t dropped;            // frames not queued (queue full)
+    uint64_t evictions;
+    size_t   bytes;              // compressed bytes held
+    size_t   raw_bytes;          // the same frames uncompressed
+    size_t   budget_bytes;
+    size_t   cap_bytes;          // lower limit set by the memory governor (ffgovernor.h); SIZE_MAX = none
+    int      entries;
+    int      ready;              // frames decompressed and waiting now
+    int      readahead;          // window in use; the memory governor may lower it
+    uint64_t compressed_raw_bytes;
+    uint64_t compress_ns;        // wall time compressing
+    uint64_t decompressed;       // frames decompressed (readahead or on demand)
+    uint64_t decompressed_raw_bytes;
+    uint64_t decompress_ns;      // wall time decompressing
+    // Derived: decompression throughput; compare with the clip's frame rate.
+    double   decompress_fps;
+    double   decompress_mb_s;
+} FFPackCacheStats;
+
+FFPackCache* ff_packcache_create(const FFPackCacheConfig* cfg);   // NULL cfg = defaults
+// Stops the background thread and frees every compressed frame. Frames handed
+// out stay valid.
+void         ff_packcache_destroy(FFPackCache* pc);
+
+// Queues `f` (retained) to be compressed under ff_frame_index(f). Returns 1 if
+// queued, 0 if already held or the queue is full, -1 on error.
+int          ff_packcache_put(FFPackCache* pc, FFFrameRef* f);
+// Waits until every queued frame is compressed.
+void         ff_packcache_flush(FFPackCache* pc);
+
+// Frame `index` with one reference: the readahead copy if ready, otherwise
+// decompressed now. NULL if the frame is not held (or no sink image is free).
+FFFrameRef*  ff_packcache_get(FFPackCache* pc, int64_t index);
+int          ff_packcache_contains(FFPackCache* pc, int64_t index);
+
+// Frames [index, index + readahead) are decompressed ahead; ready frames
+// outside that window are dropped.
+void         ff_packcache_set_playhead(FFPackCache* pc, int64_t index);
+
+void         ff_packcache_set_budget(FFPackCache* pc, size_t budget_bytes);
+void         ff_packcache_clear(FFPackCache* pc);
+
+void         ff_packcache_get_stats(FFPackCache* pc, FFPackCacheStats* out);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,294 @@
+#include "ffpixmap.h"
+#include "ffutil.h"
+#include <ctype.h>
+#include <math.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct MapPoint {
+    double x, y;          // position in map space
+    double space_w;       // map space size at the time of the point (0 = frame pixels)
+    double space_h;
+    int    universe;
+    int    slot;          // 0-based first DMX slot
+    int    order[3];      // slot offset of R, G, B
+} MapPoint;
+
+struct FFPixelMap {
+    MapPoint* pts;
+    int       npoints, cap;
+
+    int       nuniv;
+    int*      univ;       // ascending universe numbers
+    int*      univ_len;
+    uint8_t*  dmx;        // nuniv * FF_DMX_SLOTS
+
+    // Per-frame sampling tables, rebuilt when the picture size changes.
+    int       bound_w, bound_h;
+    int32_t*  xs;
+    int32_t*  ys;
+    uint32_t* offs;       // DMX byte for each of a point's R, G, B
+    uint8_t*  rgb;
+
+    FFPixelMapStats stats;
+};
+
+static void set_err(char* err, size_t err_size, const char* fmt, ...) {
+    if (!err || err_size == 0) return;
+    va_list ap;
+    va_start(ap, fmt);
+    vsnprintf(err, err_size, fmt, ap);
+    va_end(ap);
+}
+
+static int parse_order(const char* s, int order[3]) {
+    static const char names[3] = { 'r', 'g', 'b' };
+    if (strlen(s) != 3) return -1;
+    int seen = 0;
+    for (int k = 0; k < 3; ++k) {
+        int c = tolower((unsigned char)s[k]);
+        int comp = -1;
+        for (int j = 0; j < 3; ++j) if (names[j] == c) comp = j;
+        if (comp < 0 || (seen & (1 << comp))) return -1;
+        seen |= 1 << comp;
+        order[comp] = k;
+    }
+    return 0;
+}
+
+static int add_point(FFPixelMap* m, const MapPoint* p) {
+    if (m->npoints == m->cap) {
+        int cap = m->cap ? m->cap * 2 : 256;
+        MapPoint* n = realloc(m->pts, (size_t)cap * sizeof(*n));
+        if (!n) return -1;
+        m->pts = n;
+        m->cap = cap;
+    }
+    m->pts[m->npoints++] = *p;
+    return 0;
+}
+
+static int cmp_int(const void* a, const void* b) {
+    int x = *(const int*)a, y = *(const int*)b;
+    return (x > y) - (x < y);
+}
+
+static int universe_index(const FFPixelMap* m, int universe) {
+    const int* u = bsearch(&universe, m->univ, (size_t)m->nuniv, sizeof(int), cmp_int);
+    return u ? (int)(u - m->univ) : -1;
+}
+
+// Builds the universe table and DMX buffers once every point is known.
+static int finish(FFPixelMap* m) {
+    int* all = malloc((size_t)m->npoints * sizeof(int));
+    if (!all) return -1;
+    for (int i = 0; i < m->npoints; ++i) all[i] = m->pts[i].universe;
+    qsort(all, (size_t)m->npoints, sizeof(int), cmp_int);
+    int n = 0;
+    for (int i = 0; i < m->npoints; ++i)
+        if (n == 0 || all[n - 1] != all[i]) all[n++] = all[i];
+
+    m->univ     = all;
+    m->nuniv    = n;
+    m->univ_len = calloc((size_t)n, sizeof(int));
+    m->dmx      = calloc((size_t)n, FF_DMX_SLOTS);
+    m->xs       = malloc((size_t)m->npoints * sizeof(int32_t));
+    m->ys       = malloc((size_t)m->npoints * sizeof(int32_t));
+    m->offs     = malloc((size_t)m->npoints * 3 * sizeof(uint32_t));
+    m->rgb      = malloc((size_t)m->npoints * 3);
+    if (!m->univ_len || !m->dmx || !m->xs || !m->ys || !m->offs || !m->rgb) return -1;
+
+    for (int i = 0; i < m->npoints; ++i) {
+        const MapPoint* p = &m->pts[i];
+        int u = universe_index(m, p->universe);
+        for (int c = 0; c < 3; ++c)
+            m->offs[i * 3 + c] = (uint32_t)(u * FF_DMX_SLOTS + p->slot + p->order[c]);
+        int end = p->slot + 3;
+        if (end > m->univ_len[u]) m->univ_len[u] = end;
+    }
+    for (int u = 0; u < n; ++u) m->univ_len[u] = (m->univ_len[u] + 1) & ~1;   // Art-Net wants even lengths
+    return 0;
+}
+
+FFPixelMap* ff_pixmap_parse(const char* text, char* err, size_t err_size) {
+    if (!text) return NULL;
+    FFPixelMap* m = calloc(1, sizeof(*m));
+    if (!m) return NULL;
+
+    double space_w = 0, space_h = 0;
+    int order[3] = { 0, 1, 2 };
+    int lineno = 0;
+    const char* s = text;
+    while (*s) {
+        const char* e = strchr(s, '\n');
+        size_t len = e ? (size_t)(e - s) : strlen(s);
+        char line[512];
+        ++lineno;
+        if (len >= sizeof(line)) {
+            set_err(err, err_size, "line %d: too long", lineno);
+            goto fail;
+        }
+        memcpy(line, s, len);
+        line[len] = '\0';
+        s += len + (e ? 1 : 0);
+
+        char* hash = strchr(line, '#');
+        if (hash) *hash = '\0';
+        char word[16], arg[16];
+        int consumed = 0;
+        if (sscanf(line, " %15s%n", word, &consumed) != 1) continue;   // blank line
+        const char* rest = line + consumed;
+
+        if (strcmp(word, "size") == 0) {
+            if (sscanf(rest, "%lf %lf", &space_w, &space_h) != 2 || space_w <= 0 || space_h <= 0) {
+                set_err(err, err_size, "line %d: expected 'size <width> <height>'", lineno);
+                goto fail;
+            }
+        } else if (strcmp(word, "order") == 0) {
+            if (sscanf(rest, "%15s", arg) != 1 || parse_order(arg, order) < 0) {
+                set_err(err, err_size, "line %d: order must be a permutation of rgb", lineno);
+                goto fail;
+            }
+        } else if (strcmp(word, "point") == 0 || strcmp(word, "strip") == 0) {
+            int strip = word[0] == 's';
+            int universe, channel, count = 1;
+            double x0, y0, x1 = 0, y1 = 0;
+            int ok = strip
+                ? sscanf(rest, "%d %d %d %lf %lf %lf %lf", &universe, &channel, &count, &x0, &y0, &x1, &y1) == 7
+                : sscanf(rest, "%d %d %lf %lf", &universe, &channel, &x0, &y0) == 4;
+            if (!ok) {
+                set_err(err, err_size, strip
+                        ? "line %d: expected 'strip <universe> <channel> <count> <x0> <y0> <x1> <y1>'"
+                        : "line %d: expected 'point <universe> <channel> <x> <y>'", lineno);
+                goto fail;
+            }
+            if (universe < 0 || universe > 63999 || channel < 1 || channel + 2 > FF_DMX_SLOTS || count < 1) {
+                set_err(err, err_size, "line %d: universe, channel or count out of range", lineno);
+                goto fail;
+            }
+            int slot = channel - 1;
+            for (int j = 0; j < count; ++j) {
+                if (slot + 3 > FF_DMX_SLOTS) {
+                    ++universe;
+                    slot = 0;
+                }
+                double t = count > 1 ? (double)j / (count - 1) : 0.0;
+                MapPoint p = { x0 + (x1 - x0) * t, y0 + (y1 - y0) * t, space_w, space_h,
+                               universe, slot, { order[0], order[1], order[2] } };
+                if (add_point(m, &p) < 0) goto fail;
+                slot += 3;
+            }
+        } else {
+            set_err(err, err_size, "line %d: unknown directive '%s'", lineno, word);
+            goto fail;
+        }
+    }
+    if (m->npoints == 0) {
+        set_err(err, err_size, "no points mapped");
+        goto fail;
+    }
+    if (finish(m) < 0) {
+        set_err(err, err_size, "out of memory");
+        goto fail;
+    }
+    return m;
+
+fail:
+    ff_pixmap_free(m);
+    return NULL;
+}
+
+FFPixelMap* ff_pixmap_load(const char* path, char* err, size_t err_size) {
+    FILE* f = path ? fopen(path, "rb") : NULL;
+    if (!f) {
+        set_err(err, err_size, "cannot open %s", path ? path : "(null)");
+        return NULL;
+    }
+    char* text = NULL;
+    long size = -1;
+    if (fseek(f, 0, SEEK_END) == 0) size = ftell(f);
+    if (size >= 0 && fseek(f, 0, SEEK_SET) == 0) {
+        text = malloc((size_t)size + 1);
+        if (text && fread(text, 1, (size_t)size, f) == (size_t)size) {
+            text[size] = '\0';
+        } else {
+            free(text);
+            text = NULL;
+        }
+    }
+    fclose(f);
+    if (!text) {
+        set_err(err, err_size, "cannot read %s", path);
+        return NULL;
+    }
+    FFPixelMap* m = ff_pixmap_parse(text, err, err_size);
+    free(text);
+    return m;
+}
+
+void ff_pixmap_free(FFPixelMap* m) {
+    if (!m) return;
+    free(m->pts);
+    free(m->univ);
+    free(m->univ_len);
+    free(m->dmx);
+    free(m->xs);
+    free(m->ys);
+    free(m->offs);
+    free(m->rgb);
+    free(m);
+}
+
+int ff_pixmap_point_count(const FFPixelMap* m) {
+    return m ? m->npoints : 0;
+}
+
+int ff_pixmap_universe_count(const FFPixelMap* m) {
+    return m ? m->nuniv : 0;
+}
+
+const uint8_t* ff_pixmap_universe(const FFPixelMap* m, int i, int* universe, int* length) {
+    if (!m || i < 0 || i >= m->nuniv) return NULL;
+    if (universe) *universe = m->univ[i];
+    if (length) *length = m->univ_len[i];
+    return m->dmx + (size_t)i * FF_DMX_SLOTS;
+}
+
+static int32_t clamp_coord(double v, int limit) {
+    if (!(v >= 0)) return 0;   // also catches NaN
+    return v >= limit - 1 ? limit - 1 : (int32_t)v;
+}
+
+static void bind(FFPixelMap* m, int width, int height) {
+    for (int i = 0; i < m->npoints; ++i) {
+        const MapPoint* p = &m->pts[i];
+        double x = p->space_w > 0 ? p->x * width / p->space_w : p->x;
+        double y = p->space_h > 0 ? p->y * height / p->space_h : p->y;
+        m->xs[i] = clamp_coord(floor(x), width);
+        m->ys[i] = clamp_coord(floor(y), height);
+    }
+    m->bound_w = width;
+    m->bound_h = height;
+}
+
+int ff_pixmap_sample(FFPixelMap* m, const FFSourceImage* src) {
+    if (!m || !src || src->width <= 0 || src->height <= 0) return -1;
+    int64_t t0 = ff_now_ns();
+    if (src->width != m->bound_w || src->height != m->bound_h) bind(m, src->width, src->height);
+
+    ff_convert_points(src, m->xs, m->ys, m->npoints, m->rgb);
+    int n = m->npoints * 3;
+    for (int i = 0; i < n; ++i) m->dmx[m->offs[i]] = m->rgb[i];
+
+    m->stats.frames++;
+    m->stats.points += (uint64_t)m->npoints;
+    m->stats.sample_ns += (uint64_t)(ff_now_ns() - t0);
+    return 0;
+}
+
+void ff_pixmap_stats(const FFPixelMap* m, FFPixelMapStats* out) {
+    if (!m || !out) return;
+    *out = m->stats;
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include "ffconvert.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Pixel mapping for LED tape and DMX fixtures: a fixture map lists which frame
+// pixels feed which DMX channels. Each frame only the mapped points are sampled
+// from the decoded planes (ff_convert_points) and written into per-universe DMX
+// buffers, ready for ffdmx.h to send. No full-frame BGRA conversion happens.
+//
+// Mapping files are text, one directive per line, '#' starts a comment:
+//   size  <width> <height>        coordinate space of the points that follow
+//                                 (default: the frame's own pixels)
+//   order rgb|rbg|grb|gbr|brg|bgr channel order of the fixtures that follow (default rgb)
+//   point <universe> <channel> <x> <y>
+//   strip <universe> <channel> <count> <x0> <y0> <x1> <y1>
+// Channels are 1-based DMX slots and every pixel takes three. A strip spaces
+// its pixels evenly from (x0, y0) to (x1, y1) and continues at channel 1 of the
+// next universe when a pixel would not fit (170 pixels per universe).
+typedef struct FFPixelMap FFPixelMap;
+
+#define FF_DMX_SLOTS 512
+
+// Parses a mapping. On failure returns NULL and, if `err` is given, writes a
+// message naming the offending line.
+FFPixelMap* ff_pixmap_parse(const char* text, char* err, size_t err_size);
+FFPixelMap* ff_pixmap_load(const char* path, char* err, size_t err_size);
+void        ff_pixmap_free(FFPixelMap* m);
+
+int         ff_pixmap_point_count(const FFPixelMap* m);
+int         ff_pixmap_universe_count(const FFPixelMap* m);
+
+// The i-th universe in ascending universe order: its number, its DMX slots and
+// the number of slots in use (highest mapped channel, rounded up to even).
+const uint8_t* ff_pixmap_universe(const FFPixelMap* m, int i, int* universe, int* length);
+
+// Samples every mapped point of `src` into the DMX buffers. Point coordinates
+// are scaled from the map's size to the picture (recomputed when the picture
+// size changes) and clamped to it. Returns 0, or -1 on bad arguments.
+int         ff_pixmap_sample(FFPixelMap* m, const FFSourceImage* src);
+
+typedef struct FFPixelMapStats {
+    uint64_t frames;      // ff_pixmap_sample calls
+    uint64_t points;      // points sampled over all frames
+    uint64_t sample_ns;   // time spent sampling and filling DMX buffers
+} FFPixelMapStats;
+
+void        ff_pixmap_stats(const FFPixelMap* m, FFPixelMapStats* out);
+
+#ifdef __cplusplus
+}
+#endif
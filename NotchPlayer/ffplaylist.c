@@ -0,0 +1,353 @@
+#include "ffplaylist.h"
+#include "ffutil.h"
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define JUMP_NONE (-1)
+#define JUMP_END  (-2)
+
+struct FFPlaylist {
+    FFPlaylistConfig cfg;
+    pthread_mutex_t lock;
+    pthread_cond_t  cv;            // list, target, staged clip or retired clip changed
+    pthread_t       thread;
+    int             stopping;
+
+    char**          items;
+    int             nitems, cap;
+
+    int             cur_item;      // clip playing, -1 before the first
+    int             jump;          // item to play next, or JUMP_*
+    atomic_int      switch_req;    // skip/jump waiting for the playing thread
+    int             has_clip;
+    FFPlaylistClip  clip;
+
+    // Pre-roll: stage_item is being opened (stage_ready = 0) or has been
+    // (stage_ready = 1; staged is NULL if it could not be).
+    int             stage_item;
+    int             stage_ready;
+    FFPreroll*      staged;
+    FFPrerollQueue  retired;       // finished clips for the pre-roll thread to close
+
+    // Playing thread only.
+    FFPreroll*      cur;
+    int64_t         next_index;
+    double          last_pts, last_dt;
+    double          pts0;          // clip pts of the clip's first frame; NaN before it
+    int64_t         switch_t0;     // when the pending switch started, 0 if none
+    int             switch_cold;
+
+    FFPlaylistStats stats;
+    uint64_t        gaps;          // samples in switch_ns_avg
+};
+
+// The clip to play after the current one, or -1. Called with the lock held.
+static int target(const FFPlaylist* pl) {
+    if (pl->jump >= 0) return pl->jump;
+    if (pl->jump == JUMP_END) return -1;
+    if (pl->cur_item + 1 < pl->nitems) return pl->cur_item + 1;
+    return pl->cfg.loop && pl->nitems > 0 ? 0 : -1;
+}
+
+static void* preroll_main(void* arg) {
+    FFPlaylist* pl = arg;
+    pthread_mutex_lock(&pl->lock);
+    for (;;) {
+        int want = -1;
+        while (!pl->stopping && !pl->retired.count) {
+            want = pl->cfg.cold ? -1 : target(pl);
+            if (want >= 0 && want != pl->stage_item) break;
+            ff_cond_wait_ns(&pl->cv, &pl->lock, -1);
+        }
+        if (pl->stopping) break;
+        if (pl->retired.count) {
+            FFPreroll* r = ff_preroll_queue_pop(&pl->retired);
+            pthread_mutex_unlock(&pl->lock);
+            ff_preroll_close(r);
+            pthread_mutex_lock(&pl->lock);
+            continue;
+        }
+
+        // Replaces whatever was staged: the target moved (a jump, or an
+        // append after the last clip while looping).
+        FFPreroll* old = pl->staged;
+        const char* path = pl->items[want];   // strings live until destroy
+        pl->staged      = NULL;
+        pl->stage_item  = want;
+        pl->stage_ready = 0;
+        pthread_mutex_unlock(&pl->lock);
+        ff_preroll_close(old);
+        FFPreroll* pr = ff_preroll_open(path, &pl->cfg.preroll);
+        pthread_mutex_lock(&pl->lock);
+
+        pl->staged      = pr;
+        pl->stage_ready = 1;
+        if (pr) pl->stats.preroll_ns_last = ff_preroll_open_ns(pr);
+        pthread_cond_broadcast(&pl->cv);
+    }
+    pthread_mutex_unlock(&pl->lock);
+    return NULL;
+}
+
+FFPlaylist* ff_playlist_create(const FFPlaylistConfig* cfg) {
+    FFPlaylist* pl = calloc(1, sizeof(*pl));
+    if (!pl) return NULL;
+    if (cfg) pl->cfg = *cfg;
+    pl->cur_item   = -1;
+    pl->jump       = JUMP_NONE;
+    pl->stage_item = -1;
+    pl->pts0       = NAN;
+    atomic_init(&pl->switch_req, 0);
+    pthread_mutex_init(&pl->lock, NULL);
+    ff_cond_init(&pl->cv);
+    if (pthread_create(&pl->thread, NULL, preroll_main, pl) != 0) {
+        pthread_mutex_destroy(&pl->lock);
+        pthread_cond_destroy(&pl->cv);
+        free(pl);
+        return NULL;
+    }
+    return pl;
+}
+
+void ff_playlist_destroy(FFPlaylist* pl) {
+    if (!pl) return;
+    pthread_mutex_lock(&pl->lock);
+    pl->stopping = 1;
+    pthread_cond_broadcast(&pl->cv);
+    pthread_mutex_unlock(&pl->lock);
+    pthread_join(pl->thread, NULL);
+
+    ff_preroll_close(pl->cur);
+    ff_preroll_close(pl->staged);
+    ff_preroll_queue_clear(&pl->retired);
+    for (int i = 0; i < pl->nitems; ++i) free(pl->items[i]);
+    free(pl->items);
+    pthread_mutex_destroy(&pl->lock);
+    pthread_cond_destroy(&pl->cv);
+    free(pl);
+}
+
+int ff_playlist_append(FFPlaylist* pl, const char* path) {
+    if (!pl || !path) return -1;
+    char* copy = strdup(path);
+    if (!copy) return -1;
+    pthread_mutex_lock(&pl->lock);
+    if (pl->nitems == pl->cap) {
+        int ncap = pl->cap ? pl->cap * 2 : 16;
+        char** ni = realloc(pl->items, (size_t)ncap * sizeof(*ni));
+        if (!ni) {
+            pthread_mutex_unlock(&pl->lock);
+            free(copy);
+            return -1;
+        }
+        pl->items = ni;
+        pl->cap   = ncap;
+    }
+    int item = pl->nitems++;
+    pl->items[item] = copy;
+    pthread_cond_broadcast(&pl->cv);   // may be the clip to pre-roll next
+    pthread_mutex_unlock(&pl->lock);
+    return item;
+}
+
+int ff_playlist_count(FFPlaylist* pl) {
+    if (!pl) return 0;
+    pthread_mutex_lock(&pl->lock);
+    int n = pl->nitems;
+    pthread_mutex_unlock(&pl->lock);
+    return n;
+}
+
+// Hands a finished clip to the pre-roll thread to close. Clips retired while
+// it is busy opening queue up, so closing never blocks the playing thread.
+static void retire(FFPlaylist* pl, FFPreroll* pr) {
+    if (!pr) return;
+    pthread_mutex_lock(&pl->lock);
+    int r = ff_preroll_queue_push(&pl->retired, pr);
+    if (r == 0) pthread_cond_broadcast(&pl->cv);
+    pthread_mutex_unlock(&pl->lock);
+    if (r < 0) ff_preroll_close(pr);   // out of memory: close it here after all
+}
+
+// Takes the next clip: the pre-rolled one, waiting for it if its pre-roll is
+// still running, or opened here in cold mode. Returns 1 with *out (NULL if it
+// could not be opened), 0 at the end of the playlist, -1 if stopping.
+static int take(FFPlaylist* pl, FFPreroll** out) {
+    *out = NULL;
+    pthread_mutex_lock(&pl->lock);
+    int item, waited = 0;
+    for (;;) {
+        if (pl->stopping) {
+            pthread_mutex_unlock(&pl->lock);
+            return -1;
+        }
+        item = target(pl);
+        if (item < 0 || pl->cfg.cold || (pl->stage_item == item && pl->stage_ready)) break;
+        waited = 1;
+        ff_cond_wait_ns(&pl->cv, &pl->lock, -1);
+    }
+    if (item < 0) {
+        if (pl->jump == JUMP_END) {
+            pl->jump = JUMP_NONE;
+            atomic_store(&pl->switch_req, 0);
+        }
+        pthread_mutex_unlock(&pl->lock);
+        return 0;
+    }
+    pl->cur_item = item;
+    pl->jump     = JUMP_NONE;
+    atomic_store(&pl->switch_req, 0);
+    const char* path = pl->items[item];
+    if (!pl->cfg.cold) {
+        *out = pl->staged;
+        pl->staged     = NULL;
+        pl->stage_item = -1;
+        pthread_cond_broadcast(&pl->cv);   // pre-roll the one after
+    }
+    pthread_mutex_unlock(&pl->lock);
+
+    if (pl->cfg.cold) {
+        FFPrerollConfig c = pl->cfg.preroll;
+        c.frames = -1;
+        *out = ff_preroll_open(path, &c);
+    }
+    pl->switch_cold = pl->cfg.cold || waited;
+    return 1;
+}
+
+static void record_switch(FFPlaylist* pl, int64_t now) {
+    int64_t dt = now - pl->switch_t0;
+    pl->switch_t0 = 0;
+    pthread_mutex_lock(&pl->lock);
+    pl->stats.switches++;
+    if (pl->switch_cold) pl->stats.cold++;
+    else pl->stats.prerolled++;
+    pl->stats.switch_ns_last = dt;
+    if (dt > pl->stats.switch_ns_max) pl->stats.switch_ns_max = dt;
+    pl->gaps++;
+    pl->stats.switch_ns_avg += (dt - pl->stats.switch_ns_avg) / (double)pl->gaps;
+    pthread_mutex_unlock(&pl->lock);
+}
+
+int ff_playlist_next(FFPlaylist* pl, FFFrameRef** out, FFPlaylistPos* pos) {
+    if (out) *out = NULL;
+    if (!pl || !out) return -1;
+    int failures = 0;
+    for (;;) {
+        if (pl->cur && !atomic_load(&pl->switch_req)) {
+            FFFrameRef* f = NULL;
+            int r = ff_preroll_next(pl->cur, &f);
+            if (r < 0) return r;
+            if (r == 1) {
+                // Retime onto the playlist: the clip's own pts, shifted so its
+                // first frame lands one frame after the previous clip's last.
+                double fp = ff_frame_pts(f);
+                if (isnan(pl->pts0)) pl->pts0 = fp;
+                double pts = !isnan(fp) && !isnan(pl->pts0) ? pl->clip.start + (fp - pl->pts0)
+                           : pl->clip.start + (pl->next_index - pl->clip.first_index) * pl->last_dt;
+                if (pl->next_index > pl->clip.first_index && pts > pl->last_pts) pl->last_dt = pts - pl->last_pts;
+                pl->last_pts = pts;
+                if (pos) *pos = (FFPlaylistPos){ pl->clip.item, pts, pl->next_index };
+                pl->next_index++;
+                if (pl->switch_t0) record_switch(pl, ff_now_ns());
+                *out = f;
+                return 1;
+            }
+            // r == 0: the clip is finished.
+        }
+        if (!pl->switch_t0 && pl->next_index > 0) pl->switch_t0 = ff_now_ns();
+
+        FFPreroll* next = NULL;
+        int r = take(pl, &next);
+        if (r < 0) return -1;
+        if (r == 0) {
+            // End of the playlist. The timeline and cur_item stay, so clips
+            // appended later follow on.
+            retire(pl, pl->cur);
+            pl->cur = NULL;
+            pl->switch_t0 = 0;
+            return 0;
+        }
+        if (!next) {
+            pthread_mutex_lock(&pl->lock);
+            pl->stats.failed++;
+            int n = pl->nitems;
+            pthread_mutex_unlock(&pl->lock);
+            if (++failures >= n) {
+                pl->switch_t0 = 0;
+                return -1;
+            }
+            continue;
+        }
+
+        retire(pl, pl->cur);
+        pl->cur = next;
+        const FFClipInfo* info = ff_preroll_info(next);
+        if (pl->next_index == 0) {
+            pl->last_pts = 0;
+            pl->last_dt  = info->fps > 0 ? 1.0 / info->fps : 0;
+        }
+        pthread_mutex_lock(&pl->lock);
+        pl->clip.item        = pl->cur_item;
+        pl->clip.info        = *info;
+        pl->clip.start       = pl->next_index == 0 ? 0 : pl->last_pts + pl->last_dt;
+        pl->clip.first_index = pl->next_index;
+        pl->has_clip = 1;
+        pthread_mutex_unlock(&pl->lock);
+        if (info->fps > 0) pl->last_dt = 1.0 / info->fps;
+        pl->pts0 = NAN;
+    }
+}
+
+int ff_playlist_skip(FFPlaylist* pl) {
+    if (!pl) return -1;
+    pthread_mutex_lock(&pl->lock);
+    int next = pl->cur_item + 1;
+    pl->jump = next < pl->nitems ? next : pl->cfg.loop && pl->nitems > 0 ? 0 : JUMP_END;
+    atomic_store(&pl->switch_req, 1);
+    pthread_cond_broadcast(&pl->cv);
+    pthread_mutex_unlock(&pl->lock);
+    return 0;
+}
+
+int ff_playlist_jump(FFPlaylist* pl, int item) {
+    if (!pl) return -1;
+    pthread_mutex_lock(&pl->lock);
+    if (item < 0 || item >= pl->nitems) {
+        pthread_mutex_unlock(&pl->lock);
+        return -1;
+    }
+    pl->jump = item;
+    atomic_store(&pl->switch_req, 1);
+    pthread_cond_broadcast(&pl->cv);
+    pthread_mutex_unlock(&pl->lock);
+    return 0;
+}
+
+int ff_playlist_current(FFPlaylist* pl, FFPlaylistClip* out) {
+    if (!pl || !out) return -1;
+    pthread_mutex_lock(&pl->lock);
+    int ok = pl->has_clip;
+    if (ok) *out = pl->clip;
+    pthread_mutex_unlock(&pl->lock);
+    return ok ? 0 : -1;
+}
+
+static int source_next(void* opaque, FFFrameRef** out) {
+    return ff_playlist_next(opaque, out, NULL);
+}
+
+FFFrameSource ff_playlist_source(FFPlaylist* pl) {
+    FFFrameSource src = { source_next, pl };
+    return src;
+}
+
+void ff_playlist_get_stats(FFPlaylist* pl, FFPlaylistStats* out) {
+    if (!pl || !out) return;
+    pthread_mutex_lock(&pl->lock);
+    *out = pl->stats;
+    pthread_mutex_unlock(&pl->lock);
+}
@@ -0,0 +1,80 @@
+#pragma once
+#include <stdint.h>
+#include "ffframe.h"
+#include "ffpreroll.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Gapless playlist. Clips play back to back on one continuous timeline: the
+// first frame of the next clip follows the last frame of the current one by
+// exactly one frame time. While a clip plays, a pre-roll thread opens, probes
+// and pre-decodes the next one (ffpreroll.h), so a switch only hands over
+// frames that are already decoded instead of stopping, reopening and waiting
+// for the first decode. Finished clips are closed on the pre-roll thread too.
+// One thread plays (ff_playlist_next); the others may append, skip and jump.
+typedef struct FFPlaylist FFPlaylist;
+
+typedef struct FFPlaylistConfig {
+    FFPrerollConfig preroll;   // how each clip is opened and prepared
+    int             loop;      // after the last clip, start over
+    // Open each clip only when it is reached, without pre-decoding: how
+    // switching used to work; for comparison.
+    int             cold;
+} FFPlaylistConfig;
+
+// Where a frame sits on the playlist timeline.
+typedef struct FFPlaylistPos {
+    int     item;              // clip it comes from
+    double  pts;               // seconds since the start of the playlist
+    int64_t index;             // frames since the start of the playlist
+} FFPlaylistPos;
+
+// The clip playing.
+typedef struct FFPlaylistClip {
+    int        item;
+    FFClipInfo info;
+    double     start;          // playlist time of its first frame
+    int64_t    first_index;    // playlist index of its first frame
+} FFPlaylistClip;
+
+typedef struct FFPlaylistStats {
+    uint64_t switches;         // clip changes, at the end of a clip or by skip/jump
+    uint64_t prerolled;        // ...that found the next clip already pre-decoded
+    uint64_t cold;             // ...that had to open it on the playing thread
+    uint64_t failed;           // clips skipped because they could not be opened
+    // Switch gap: from the frame request that found the clip finished (or the
+    // first one after a skip) to the next clip's first frame.
+    int64_t  switch_ns_last;
+    int64_t  switch_ns_max;
+    double   switch_ns_avg;
+    int64_t  preroll_ns_last;  // time the pre-roll thread spent on the last clip
+} FFPlaylistStats;
+
+FFPlaylist* ff_playlist_create(const FFPlaylistConfig* cfg);
+void        ff_playlist_destroy(FFPlaylist* pl);
+
+// Adds a clip at the end. Returns its item number, or -1.
+int         ff_playlist_append(FFPlaylist* pl, const char* path);
+int         ff_playlist_count(FFPlaylist* pl);
+
+// The next frame, one reference, with its playlist position (pos optional).
+// Frames keep their clip timing. Returns 1, 0 at the end of the playlist (more
+// frames follow if clips are appended), or <0 on error.
+int         ff_playlist_next(FFPlaylist* pl, FFFrameRef** out, FFPlaylistPos* pos);
+// The next frame comes from the following clip (0 at the end of the playlist).
+int         ff_playlist_skip(FFPlaylist* pl);
+// The next frame comes from clip `item`; pre-roll retargets to it at once.
+int         ff_playlist_jump(FFPlaylist* pl, int item);
+
+// Fills *out with the clip playing. Returns 0, or -1 before the first frame.
+int         ff_playlist_current(FFPlaylist* pl, FFPlaylistClip* out);
+// ff_playlist_next as a frame source (positions are not passed on).
+FFFrameSource ff_playlist_source(FFPlaylist* pl);
+
+void        ff_playlist_get_stats(FFPlaylist* pl, FFPlaylistStats* out);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,370 @@
+#include "ffpool.h"
+#include "ffgovernor.h"
+#include "ffmem.h"
+#include "ffutil.h"
+#include <math.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define FF_POOL_MIN_BUCKET  4096
+#define FF_POOL_NUM_BUCKETS (64 * 4)
+
+typedef struct PoolBuf {
+    struct PoolBuf* next;
+    FFFramePool*    pool;
+    FFMemBlock      blk;
+    size_t          size;     // bytes accounted (mapped size)
+    int             bucket;
+} PoolBuf;
+
+struct FFFramePool {
+    pthread_mutex_t   lock;
+    pthread_cond_t    returned;
+    FFFramePoolConfig cfg;
+
+    PoolBuf*          free_list[FF_POOL_NUM_BUCKETS];
+    int               refs;       // owners + buffers in use
+    int               owners;     // creator + sinks; no new buffers once this hits 0
+    int               closing;
+    int               nbufs;      // buffers held (in use + free)
+
+    FFFramePoolStats  st;
+    unsigned          granted_flags;   // union of FF_MEM_* obtained so far
+    FFGovClient*      gov;
+};
+
+// Size classes: four steps per power of two (1, 1.25, 1.5, 1.75 x 2^k), so a
+// request wastes at most ~20% and similar frame sizes share a bucket.
+static size_t bucket_size(size_t want, int* index) {
+    if (want < FF_POOL_MIN_BUCKET) want = FF_POOL_MIN_BUCKET;
+    int k = 63 - __builtin_clzll((unsigned long long)want);
+    size_t base = (size_t)1 << k;
+    size_t step = base / 4;
+    int q = (int)((want - base + step - 1) / step);   // 0..4
+    if (q == 4) { ++k; base <<= 1; q = 0; step = base / 4; }
+    *index = k * 4 + q;
+    return base + (size_t)q * step;
+}
+
+// What ff_mem_alloc will actually map for a bucket of `size` bytes.
+static size_t mapped_size(const FFFramePool* p, size_t size) {
+    size_t page = (p->cfg.mem_flags & FF_MEM_HUGEPAGES) ? 2u * 1024 * 1024 : 4096;
+    return (size + page - 1) / page * page;
+}
+
+static int fits(const FFFramePool* p, size_t size) {
+    if (p->cfg.capacity_bytes && p->st.allocated_bytes + size > p->cfg.capacity_bytes) return 0;
+    if (p->cfg.max_buffers && p->nbufs + 1 > p->cfg.max_buffers) return 0;
+    return 1;
+}
+
+static void free_buf_locked(FFFramePool* p, PoolBuf* b) {
+    p->st.allocated_bytes -= b->size;
+    p->nbufs--;
+    ff_mem_free(&b->blk);
+    free(b);
+}
+
+// Evicts one cached buffer from any bucket to make room. Returns 1 if it did.
+static int evict_one_locked(FFFramePool* p) {
+    for (int i = FF_POOL_NUM_BUCKETS - 1; i >= 0; --i) {
+        PoolBuf* b = p->free_list[i];
+        if (!b) continue;
+        p->free_list[i] = b->next;
+        p->st.free_buffers--;
+        free_buf_locked(p, b);
+        return 1;
+    }
+    return 0;
+}
+
+static void pool_unref_locked(FFFramePool* p) {
+    // Caller holds the lock; frees the pool (and unlocks) when the last ref goes.
+    if (--p->refs > 0) {
+        pthread_mutex_unlock(&p->lock);
+        return;
+    }
+    pthread_mutex_unlock(&p->lock);
+    pthread_cond_destroy(&p->returned);
+    pthread_mutex_destroy(&p->lock);
+    free(p);
+}
+
+static size_t gov_usage(void* opaque, size_t* wanted) {
+    FFFramePool* p = opaque;
+    pthread_mutex_lock(&p->lock);
+    size_t n = p->st.allocated_bytes;
+    pthread_mutex_unlock(&p->lock);
+    return n;
+}
+
+static size_t gov_trim(void* opaque) {
+    return ff_pool_trim(opaque);
+}
+
+FFFramePool* ff_pool_create(const FFFramePoolConfig* cfg) {
+    FFFramePool* p = calloc(1, sizeof(*p));
+    if (!p) return NULL;
+    if (cfg) {
+        p->cfg = *cfg;
+    } else {
+        p->cfg.max_buffers     = FF_POOL_DEFAULT_BUFFERS;
+        p->cfg.wait_timeout_ms = FF_POOL_DEFAULT_TIMEOUT_MS;
+    }
+    pthread_mutex_init(&p->lock, NULL);
+    ff_cond_init(&p->returned);
+    p->refs = 1;
+    p->owners = 1;
+    p->st.capacity_bytes = p->cfg.capacity_bytes;
+    FFGovClientConfig gc = { .name = "frame pool", .kind = FF_GOV_OUTPUT, .opaque = p,
+                             .usage = gov_usage, .trim = gov_trim };
+    p->gov = ff_governor_register(&gc);
+    return p;
+}
+
+static void owner_unref(FFFramePool* p) {
+    pthread_mutex_lock(&p->lock);
+    if (p->owners == 1) {
+        // Last owner: leave the governor first (its callbacks take the lock).
+        pthread_mutex_unlock(&p->lock);
+        ff_governor_unregister(p->gov);
+        pthread_mutex_lock(&p->lock);
+        p->gov = NULL;
+    }
+    if (--p->owners == 0) {
+        p->closing = 1;
+        while (evict_one_locked(p)) {}
+        pthread_cond_broadcast(&p->returned);
+    }
+    pool_unref_locked(p);
+}
+
+void ff_pool_destroy(FFFramePool* pool) {
+    if (pool) owner_unref(pool);
+}
+
+static void pool_frame_free(void* opaque) {
+    PoolBuf* b = opaque;
+    FFFramePool* p = b->pool;
+
+    pthread_mutex_lock(&p->lock);
+    p->st.in_use_bytes -= b->size;
+    p->st.in_use_buffers--;
+    if (p->closing) {
+        free_buf_locked(p, b);
+    } else {
+        b->next = p->free_list[b->bucket];
+        p->free_list[b->bucket] = b;
+        p->st.free_buffers++;
+        pthread_cond_signal(&p->returned);
+    }
+    pool_unref_locked(p);
+}
+
+static PoolBuf* alloc_buf_locked(FFFramePool* p, size_t size, int bucket) {
+    PoolBuf* b = calloc(1, sizeof(*b));
+    if (!b) return NULL;
+    if (ff_mem_alloc(&b->blk, size, p->cfg.mem_flags) < 0) {
+        free(b);
+        return NULL;
+    }
+    b->size   = b->blk.size;
+    b->bucket = bucket;
+    b->pool   = p;
+    p->nbufs++;
+    p->st.allocated_bytes += b->size;
+    p->granted_flags |= b->blk.granted;
+    return b;
+}
+
+int ff_pool_preallocate(FFFramePool* p, int width, int height, FFPixelFormat fmt, int count) {
+    int bpp = ff_pixfmt_bytes_per_pixel(fmt);
+    if (!p || width <= 0 || height <= 0 || bpp == 0) return 0;
+
+    size_t stride = ((size_t)width * bpp + 63) & ~(size_t)63;
+    int idx;
+    size_t size = mapped_size(p, bucket_size(stride * (size_t)height, &idx));
+
+    int made = 0;
+    pthread_mutex_lock(&p->lock);
+    while (made < count && !p->closing && fits(p, size)) {
+        PoolBuf* b = alloc_buf_locked(p, size, idx);
+        if (!b) break;
+        b->next = p->free_list[idx];
+        p->free_list[idx] = b;
+        p->st.free_buffers++;
+        ++made;
+    }
+    pthread_mutex_unlock(&p->lock);
+    if (made) ff_governor_notify();
+    return made;
+}
+
+unsigned ff_pool_granted_mem_flags(FFFramePool* p) {
+    if (!p) return 0;
+    pthread_mutex_lock(&p->lock);
+    unsigned g = p->granted_flags;
+    pthread_mutex_unlock(&p->lock);
+    return g;
+}
+
+FFFrameRef* ff_pool_acquire_frame(FFFramePool* p, int width, int height, FFPixelFormat fmt) {
+    int bpp = ff_pixfmt_bytes_per_pixel(fmt);
+    if (!p || width <= 0 || height <= 0 || bpp == 0) return NULL;
+
+    size_t stride = ((size_t)width * bpp + 63) & ~(size_t)63;
+    int idx;
+    size_t size = mapped_size(p, bucket_size(stride * (size_t)height, &idx));
+
+    pthread_mutex_lock(&p->lock);
+    p->st.acquires++;
+
+    if (p->closing || (p->cfg.capacity_bytes && size > p->cfg.capacity_bytes)) {
+        pthread_mutex_unlock(&p->lock);
+        return NULL;
+    }
+
+    int64_t t_start = 0;
+    int64_t timeout_ns = p->cfg.wait_timeout_ms < 0 ? -1 : (int64_t)p->cfg.wait_timeout_ms * 1000000LL;
+    PoolBuf* b = NULL;
+    int grew = 0;
+
+    for (;;) {
+        if ((b = p->free_list[idx]) != NULL) {
+            p->free_list[idx] = b->next;
+            p->st.free_buffers--;
+            p->st.reuses++;
+            break;
+        }
+        if (fits(p, size)) {
+            b = alloc_buf_locked(p, size, idx);
+            if (b) p->st.allocs++;
+            grew = b != NULL;
+            break;
+        }
+        if (evict_one_locked(p)) continue;
+
+        // Full and every buffer is in use: wait for one to come back.
+        int64_t now = ff_now_ns();
+        if (!t_start) { t_start = now; p->st.waits++; }
+        int64_t left = timeout_ns < 0 ? -1 : timeout_ns - (now - t_start);
+        if (timeout_ns >= 0 && left <= 0) break;
+        ff_cond_wait_ns(&p->returned, &p->lock, left);
+        if (p->closing) break;
+    }
+
+    if (t_start) {
+        uint64_t waited = (uint64_t)(ff_now_ns() - t_start);
+        p->st.wait_ns_total += waited;
+        if (waited > p->st.wait_ns_max) p->st.wait_ns_max = waited;
+    }
+    if (!b) {
+        if (t_start) p->st.timeouts++;
+        pthread_mutex_unlock(&p->lock);
+        return NULL;
+    }
+
+    p->refs++;
+    p->st.in_use_buffers++;
+    p->st.in_use_bytes += b->size;
+    if (p->st.in_use_bytes > p->st.high_water_bytes) p->st.high_water_bytes = p->st.in_use_bytes;
+    pthread_mutex_unlock(&p->lock);
+    if (grew) ff_governor_notify();
+
+    FFFrameDesc d;
+    memset(&d, 0, sizeof(d));
+    d.data[0]     = b->blk.ptr;
+    d.linesize[0] = (int)stride;
+    d.width       = width;
+    d.height      = height;
+    d.format      = fmt;
+    d.pts         = NAN;
+    d.index       = -1;
+    d.free        = pool_frame_free;
+    d.opaque      = b;
+
+    FFFrameRef* f = ff_frame_wrap(&d);
+    if (!f) pool_frame_free(b);
+    return f;
+}
+
+size_t ff_pool_trim(FFFramePool* p) {
+    if (!p) return 0;
+    pthread_mutex_lock(&p->lock);
+    size_t before = p->st.allocated_bytes;
+    while (evict_one_locked(p)) {}
+    size_t freed = before - p->st.allocated_bytes;
+    pthread_mutex_unlock(&p->lock);
+    return freed;
+}
+
+void ff_pool_get_stats(FFFramePool* p, FFFramePoolStats* out) {
+    if (!p || !out) return;
+    pthread_mutex_lock(&p->lock);
+    *out = p->st;
+    pthread_mutex_unlock(&p->lock);
+}
+
+// ---- Pool-backed memory sink ----
+
+static int pool_sink_acquire(FFFrameSink* s, int width, int height, FFPixelFormat fmt, FFSinkImage* img) {
+    FFFrameRef* f = ff_pool_acquire_frame(s->opaque, width, height, fmt);
+    if (!f) return -1;
+
+    memset(img, 0, sizeof(*img));
+    img->data[0]     = ff_frame_plane(f, 0);
+    img->linesize[0] = ff_frame_stride(f, 0);
+    img->width       = width;
+    img->height      = height;
+    img->format      = fmt;
+    img->priv        = f;
+    return 0;
+}
+
+static FFFrameRef* pool_sink_commit(FFFrameSink* s, FFSinkImage* img, double pts, int64_t index) {
+    FFFrameRef* f = img->priv;
+    ff_frame_set_timing(f, pts, index);
+    img->priv = NULL;
+    return f;
+}
+
+static void pool_sink_discard(FFFrameSink* s, FFSinkImage* img) {
+    ff_frame_release(img->priv);
+    img->priv = NULL;
+}
+
+static int pool_sink_stats(FFFrameSink* s, FFFramePoolStats* out) {
+    ff_pool_get_stats(s->opaque, out);
+    return 0;
+}
+
+static void pool_sink_destroy(FFFrameSink* s) {
+    owner_unref(s->opaque);
+    free(s);
+}
+
+FFFrameSink* ff_sink_pool_create(FFFramePool* pool) {
+    if (!pool) return NULL;
+    FFFrameSink* s = calloc(1, sizeof(*s));
+    if (!s) return NULL;
+
+    pthread_mutex_lock(&pool->lock);
+    pool->refs++;
+    pool->owners++;
+    pthread_mutex_unlock(&pool->lock);
+
+    s->name       = "pool";
+    s->opaque     = pool;
+    s->acquire    = pool_sink_acquire;
+    s->commit     = pool_sink_commit;
+    s->discard    = pool_sink_discard;
+    s->pool_stats = pool_sink_stats;
+    s->destroy    = pool_sink_destroy;
+    return s;
+}
+
+int ff_sink_get_pool_stats(FFFrameSink* s, FFFramePoolStats* out) {
+    if (!s || !s->pool_stats || !out) return -1;
+    return s->pool_stats(s, out);
+}
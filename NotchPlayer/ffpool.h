@@ -0,0 +1,80 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include "ffframe.h"
+#include "ffsink.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Fixed-capacity pool of output buffers. Buffers are grouped in size buckets
+// and recycled when the last FFFrameRef using one is released. The pool never
+// grows past its limits: when it is full, acquire blocks (back-pressure) until
+// a frame comes back or the wait times out.
+typedef struct FFFramePool FFFramePool;
+
+typedef struct FFFramePoolConfig {
+    size_t capacity_bytes;    // cap on memory held (in use + cached free); 0 = no byte cap
+    int    max_buffers;       // cap on buffers held; 0 = no count cap
+    int    wait_timeout_ms;   // how long acquire may block; <0 waits forever
+    unsigned mem_flags;       // FF_MEM_* allocation mode for buffers (see ffmem.h)
+} FFFramePoolConfig;
+
+typedef struct FFFramePoolStats {
+    size_t   capacity_bytes;
+    size_t   allocated_bytes;   // backing memory currently held
+    size_t   in_use_bytes;
+    size_t   high_water_bytes;  // peak of in_use_bytes
+    int      in_use_buffers;
+    int      free_buffers;
+    uint64_t acquires;
+    uint64_t reuses;            // acquires served from a free list
+    uint64_t allocs;            // acquires that needed fresh memory
+    uint64_t waits;             // acquires that had to block
+    uint64_t timeouts;          // acquires that gave up
+    uint64_t wait_ns_total;
+    uint64_t wait_ns_max;
+} FFFramePoolStats;
+
+// Default used by players: 8 buffers, no byte cap, 1 s back-pressure timeout.
+#define FF_POOL_DEFAULT_BUFFERS 8
+#define FF_POOL_DEFAULT_TIMEOUT_MS 1000
+
+FFFramePool* ff_pool_create(const FFFramePoolConfig* cfg);   // NULL cfg = defaults
+// Drops the creator's reference. Outstanding frames stay valid; memory is freed
+// when the last of them comes back.
+void         ff_pool_destroy(FFFramePool* pool);
+
+// Frame of the given size backed by pool memory, one reference. Blocks while the
+// pool is full; returns NULL on timeout or if the request can never fit.
+FFFrameRef*  ff_pool_acquire_frame(FFFramePool* pool, int width, int height, FFPixelFormat fmt);
+
+// Allocates up to `count` buffers for frames of this size now (pre-faulted and
+// locked if mem_flags ask for it) so playback never pays for fresh pages.
+// Returns how many were created.
+int          ff_pool_preallocate(FFFramePool* pool, int width, int height, FFPixelFormat fmt, int count);
+
+// Union of the FF_MEM_* modes actually obtained for this pool's buffers.
+unsigned     ff_pool_granted_mem_flags(FFFramePool* pool);
+
+// Frees every cached (not in use) buffer. Returns bytes released.
+size_t       ff_pool_trim(FFFramePool* pool);
+
+void         ff_pool_get_stats(FFFramePool* pool, FFFramePoolStats* out);
+
+// Memory sink that draws from `pool` (the sink holds its own pool reference).
+FFFrameSink* ff_sink_pool_create(FFFramePool* pool);
+
+#ifdef __APPLE__
+// CoreVideo sink backed by a CVPixelBufferPool capped at `cfg->max_buffers`
+// (allocation threshold). Waits instead of allocating past the cap.
+FFFrameSink* ff_sink_corevideo_pool_create(const FFFramePoolConfig* cfg);
+#endif
+
+// Pool statistics of a pooled sink. Returns 0, or -1 if the sink is not pooled.
+int          ff_sink_get_pool_stats(FFFrameSink* s, FFFramePoolStats* out);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,130 @@
+#include "ffpreroll.h"
+#include "ffutil.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct FFPreroll {
+    FFPlayer*    player;
+    char*        path;
+    FFClipInfo   info;
+    FFFrameRef** frames;       // pre-decoded, in order
+    int          count, taken;
+    int          done;         // the decoder has nothing after frames[]
+    int          end_rc;       // what it returned instead
+    int64_t      open_ns;
+};
+
+FFPreroll* ff_preroll_open(const char* path, const FFPrerollConfig* cfg) {
+    if (!path) return NULL;
+    FFPrerollConfig c = { 0 };
+    if (cfg) c = *cfg;
+    int want = c.frames == 0 ? FF_PREROLL_DEFAULT_FRAMES : c.frames < 0 ? 0 : c.frames;
+    int64_t t0 = ff_now_ns();
+
+    FFPreroll* pr = calloc(1, sizeof(*pr));
+    if (!pr) return NULL;
+    pr->path   = strdup(path);
+    pr->frames = calloc((size_t)(want > 0 ? want : 1), sizeof(*pr->frames));
+    if (!pr->path || !pr->frames) goto fail;
+
+    // Everything the UI used to probe with separate opens comes from this one.
+    double tb = 0, duration = NAN;
+    pr->player = ff_open_with_options(path, &c.open, &pr->info.width, &pr->info.height, &tb, &duration);
+    if (!pr->player) goto fail;
+    pr->info.fps      = ff_get_fps(pr->player);
+    pr->info.frames   = ff_get_frame_count(pr->player);
+    pr->info.duration = duration > 0 ? duration : NAN;
+    if (c.prepare && c.prepare(c.opaque, pr->player, path) != 0) goto fail;
+
+    while (pr->count < want) {
+        FFFrameRef* f = NULL;
+        int r = ff_next_frame_ref(pr->player, &f);
+        if (r != 1) {
+            pr->done   = 1;
+            pr->end_rc = r;
+            break;
+        }
+        pr->frames[pr->count++] = f;
+    }
+    if (want > 0 && pr->count == 0) goto fail;
+    pr->open_ns = ff_now_ns() - t0;
+    return pr;
+
+fail:
+    ff_preroll_close(pr);
+    return NULL;
+}
+
+void ff_preroll_close(FFPreroll* pr) {
+    if (!pr) return;
+    for (int i = pr->taken; i < pr->count; ++i) ff_frame_release(pr->frames[i]);
+    ff_close(pr->player);
+    free(pr->frames);
+    free(pr->path);
+    free(pr);
+}
+
+int ff_preroll_next(FFPreroll* pr, FFFrameRef** out) {
+    if (!pr || !out) return -1;
+    *out = NULL;
+    if (pr->taken < pr->count) {
+        *out = pr->frames[pr->taken];
+        pr->frames[pr->taken++] = NULL;
+        return 1;
+    }
+    if (pr->done) return pr->end_rc;
+    return ff_next_frame_ref(pr->player, out);
+}
+
+int ff_preroll_ready(const FFPreroll* pr) {
+    return pr ? pr->count - pr->taken : 0;
+}
+
+const FFClipInfo* ff_preroll_info(const FFPreroll* pr) {
+    return pr ? &pr->info : NULL;
+}
+
+const char* ff_preroll_path(const FFPreroll* pr) {
+    return pr ? pr->path : NULL;
+}
+
+FFPlayer* ff_preroll_player(FFPreroll* pr) {
+    return pr ? pr->player : NULL;
+}
+
+int ff_preroll_seek(FFPreroll* pr, int64_t index) {
+    if (!pr) return -1;
+    for (int i = pr->taken; i < pr->count; ++i) ff_frame_release(pr->frames[i]);
+    pr->taken = pr->count = 0;
+    pr->done  = 0;
+    return ff_seek_frame(pr->player, index);
+}
+
+int64_t ff_preroll_open_ns(const FFPreroll* pr) {
+    return pr ? pr->open_ns : 0;
+}
+
+int ff_preroll_queue_push(FFPrerollQueue* q, FFPreroll* pr) {
+    if (!q || !pr) return -1;
+    if (q->count == q->cap) {
+        int ncap = q->cap ? q->cap * 2 : 4;
+        FFPreroll** items = realloc(q->items, (size_t)ncap * sizeof(*items));
+        if (!items) return -1;
+        q->items = items;
+        q->cap   = ncap;
+    }
+    q->items[q->count++] = pr;
+    return 0;
+}
+
+FFPreroll* ff_preroll_queue_pop(FFPrerollQueue* q) {
+    return q && q->count ? q->items[--q->count] : NULL;
+}
+
+void ff_preroll_queue_clear(FFPrerollQueue* q) {
+    if (!q) return;
+    for (int i = 0; i < q->count; ++i) ff_preroll_close(q->items[i]);
+    free(q->items);
+    memset(q, 0, sizeof(*q));
+}
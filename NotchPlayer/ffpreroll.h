@@ -0,0 +1,75 @@
+#pragma once
+#include <stdint.h>
+#include "ffdecode.h"
+#include "ffframe.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// A clip made ready to play: opened, probed, configured and with its first
+// frames already decoded, so that its first frame can be shown the moment it
+// is needed. Opening is done on the caller's thread (usually a background
+// one); the frames are then served by ff_preroll_next, which carries on with
+// the decoder once the pre-decoded ones are used up. Not thread-safe: one
+// thread opens it, then one thread plays it.
+typedef struct FFPreroll FFPreroll;
+
+#define FF_PREROLL_DEFAULT_FRAMES 4
+
+typedef struct FFPrerollConfig {
+    FFOpenOptions open;
+    int           frames;          // frames decoded ahead; 0 = FF_PREROLL_DEFAULT_FRAMES, <0 = none
+    // Optional: configures the player (sink, caches, regions, loop) after it is
+    // opened and before anything is decoded. Nonzero fails the open.
+    int         (*prepare)(void* opaque, FFPlayer* p, const char* path);
+    void*         opaque;
+} FFPrerollConfig;
+
+typedef struct FFClipInfo {
+    int     width, height;
+    double  fps;                   // NaN if unknown
+    double  duration;              // seconds; NaN if unknown
+    int64_t frames;                // -1 if unknown
+} FFClipInfo;
+
+// Opens and pre-decodes `path`. Blocks for the whole job. Returns NULL if the
+// clip cannot be opened or prepared, or yields no frame.
+FFPreroll*    ff_preroll_open(const char* path, const FFPrerollConfig* cfg);
+void          ff_preroll_close(FFPreroll* pr);
+
+// The next frame, one reference: pre-decoded ones first, then from the
+// decoder. Returns like ff_next_frame_ref.
+int           ff_preroll_next(FFPreroll* pr, FFFrameRef** out);
+// Pre-decoded frames not yet taken.
+int           ff_preroll_ready(const FFPreroll* pr);
+
+const FFClipInfo* ff_preroll_info(const FFPreroll* pr);
+const char*   ff_preroll_path(const FFPreroll* pr);
+// The clip's player, for settings and stats. Seek with ff_preroll_seek, which
+// also drops the pre-decoded frames.
+FFPlayer*     ff_preroll_player(FFPreroll* pr);
+// Seeks the player and drops the pre-decoded frames. Returns like ff_seek_frame.
+int           ff_preroll_seek(FFPreroll* pr, int64_t index);
+// Time the open took: open, probe, prepare and pre-decode.
+int64_t       ff_preroll_open_ns(const FFPreroll* pr);
+
+// Finished clips waiting to be closed off the playing thread: it queues them
+// and a background thread (the one that opens clips) closes them between
+// jobs, so closing a decoder never stalls playback. Not thread-safe: guard it
+// with the owner's lock. Zero-initialized is empty.
+typedef struct FFPrerollQueue {
+    FFPreroll** items;
+    int         count, cap;
+} FFPrerollQueue;
+
+// Queues `pr`. Returns 0, or -1 out of memory (`pr` is then still the caller's).
+int           ff_preroll_queue_push(FFPrerollQueue* q, FFPreroll* pr);
+// Takes a queued clip to close, or NULL if there is none.
+FFPreroll*    ff_preroll_queue_pop(FFPrerollQueue* q);
+// Closes every queued clip and frees the queue.
+void          ff_preroll_queue_clear(FFPrerollQueue* q);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,272 @@
+#define _GNU_SOURCE
+#include "ffproxy.h"
+#include "ffconvert.h"
+#include "ffdecode.h"
+#include "ffutil.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#ifdef __APPLE__
+#include <pthread/qos.h>
+#endif
+
+#define PROXY_MAX_THREADS 64
+
+struct FFProxy {
+    FFProxyConfig   cfg;
+    char*           path;
+    FFDiskCacheKey  key;
+    int             src_w, src_h;
+    int64_t         frames;        // -1 if unknown
+    int64_t         segments;
+
+    pthread_mutex_t lock;
+    pthread_cond_t  cv;            // a worker finished or the join ended
+    pthread_t       threads[PROXY_MAX_THREADS];
+    int             nthreads;      // to join
+    int             joining;       // a stop is joining them; others wait for it
+    int             launched;      // by the last start
+    int             active;        // workers still running
+    atomic_int      stopping;
+    atomic_llong    next_segment;
+
+    int64_t         t_start, t_end;
+    atomic_ullong   built, present, errors;
+};
+
+// Workers only use cores nothing else wants.
+static void lower_priority(void) {
+#ifdef __APPLE__
+    pthread_set_qos_class_self_np(QOS_CLASS_BACKGROUND, 0);
+#elif defined(__linux__)
+    struct sched_param sp = { 0 };
+    pthread_setschedparam(pthread_self(), SCHED_IDLE, &sp);
+#endif
+}
+
+static int stop_requested(void* opaque) {
+    FFProxy* px = opaque;
+    return atomic_load(&px->stopping);
+}
+
+// Stores `f`, waiting for room in the store's write queue.
+static void store(FFProxy* px, FFFrameRef* f) {
+    while (ff_diskcache_put(px->cfg.store, &px->key, f) == 0 &&
+           !ff_diskcache_contains(px->cfg.store, &px->key, ff_frame_index(f)) &&
+           !atomic_load(&px->stopping))
+        ff_sleep_until_ns(ff_now_ns() + 1000000);
+}
+
+// Builds frames [start, end) with `p`. Returns 0, or <0 on a decode error.
+static int build_segment(FFProxy* px, FFPlayer* p, int64_t start, int64_t end) {
+    while (start < end && ff_diskcache_contains(px->cfg.store, &px->key, start)) {
+        atomic_fetch_add(&px->present, 1);
+        ++start;
+    }
+    if (start >= end) return 0;
+    int r = ff_seek_frame(p, start);
+    if (r < 0) return r;
+    for (int64_t i = start; i < end && !atomic_load(&px->stopping); ++i) {
+        FFFrameRef* f = NULL;
+        r = ff_next_region_frames(p, &f, 1);
+        if (r == -3) {          // sink full: the store's write queue still holds frames
+            --i;
+            continue;
+        }
+        if (r != 1) return r;   // 0: the clip ends early (estimated length)
+        if (ff_diskcache_contains(px->cfg.store, &px->key, ff_frame_index(f))) {
+            atomic_fetch_add(&px->present, 1);
+        } else {
+            store(px, f);
+            atomic_fetch_add(&px->built, 1);
+        }
+        ff_frame_release(f);
+    }
+    return 0;
+}
+
+static void* proxy_main(void* arg) {
+    FFProxy* px = arg;
+    if (!px->cfg.normal_priority) lower_priority();
+
+    FFPlayer* p = ff_open(px->path, NULL, NULL, NULL, NULL);
+    FFRegion whole = { 0, 0, px->src_w, px->src_h, px->key.width, px->key.height, FF_XFORM_NONE };
+    if (!p || ff_set_regions(p, &whole, 1) < 0) {
+        atomic_fetch_add(&px->errors, 1);
+    } else {
+        ff_set_interrupt(p, stop_requested, px);
+        int64_t seg = px->cfg.segment_frames;
+        for (int64_t s; !atomic_load(&px->stopping) && (s = atomic_fetch_add(&px->next_segment, 1)) < px->segments;) {
+            int64_t end = px->frames < 0 ? INT64_MAX : s * seg + seg < px->frames ? s * seg + seg : px->frames;
+            int r = build_segment(px, p, s * seg, end);
+            if (r < 0 && r != -4) atomic_fetch_add(&px->errors, 1);
+        }
+    }
+    ff_close(p);
+
+    pthread_mutex_lock(&px->lock);
+    if (--px->active == 0) px->t_end = ff_now_ns();
+    pthread_cond_broadcast(&px->cv);
+    pthread_mutex_unlock(&px->lock);
+    return NULL;
+}
+
+FFProxy* ff_proxy_create(const FFProxyConfig* cfg) {
+    if (!cfg || !cfg->path || !cfg->store || cfg->scale < 0 || cfg->threads < 0 || cfg->segment_frames < 0) return NULL;
+    FFProxy* px = calloc(1, sizeof(*px));
+    if (!px) return NULL;
+    px->cfg = *cfg;
+    if (px->cfg.scale == 0) px->cfg.scale = 4;
+    if (px->cfg.segment_frames == 0) px->cfg.segment_frames = 64;
+    if (px->cfg.threads == 0) {
+        long n = sysconf(_SC_NPROCESSORS_ONLN);
+        px->cfg.threads = n > 2 ? (int)n - 1 : 1;   // leave a core to playback
+    }
+    if (px->cfg.threads > PROXY_MAX_THREADS) px->cfg.threads = PROXY_MAX_THREADS;
+    if (!(px->path = strdup(cfg->path))) goto fail;
+
+    px->key.clip_id = cfg->clip_id;
+    if (!px->key.clip_id && ff_diskcache_clip_id(px->path, &px->key.clip_id) < 0) goto fail;
+    FFPlayer* probe = ff_open(px->path, &px->src_w, &px->src_h, NULL, NULL);
+    if (!probe) goto fail;
+    px->frames = ff_get_frame_count(probe);
+    ff_close(probe);
+    px->key.width  = px->src_w / px->cfg.scale > 0 ? px->src_w / px->cfg.scale : 1;
+    px->key.height = px->src_h / px->cfg.scale > 0 ? px->src_h / px->cfg.scale : 1;
+    px->key.format = FF_PIXFMT_BGRA;
+    // Unknown length: one worker reads to the end.
+    px->segments = px->frames < 0 ? 1 : (px->frames + px->cfg.segment_frames - 1) / px->cfg.segment_frames;
+
+    pthread_mutex_init(&px->lock, NULL);
+    ff_cond_init(&px->cv);
+    return px;
+fail:
+    free(px->path);
+    free(px);
+    return NULL;
+}
+
+void ff_proxy_destroy(FFProxy* px) {
+    if (!px) return;
+    ff_proxy_stop(px);
+    pthread_mutex_destroy(&px->lock);
+    pthread_cond_destroy(&px->cv);
+    free(px->path);
+    free(px);
+}
+
+int ff_proxy_start(FFProxy* px) {
+    if (!px) return -1;
+    pthread_mutex_lock(&px->lock);
+    int running = px->active > 0;
+    pthread_mutex_unlock(&px->lock);
+    if (running) return 0;
+    ff_proxy_stop(px);   // reap a finished build
+
+    atomic_store(&px->stopping, 0);
+    atomic_store(&px->next_segment, 0);
+    atomic_store(&px->built, 0);
+    atomic_store(&px->present, 0);
+    atomic_store(&px->errors, 0);
+    px->t_start = ff_now_ns();
+    px->t_end   = 0;
+    int n = px->segments < px->cfg.threads ? (int)px->segments : px->cfg.threads;
+    pthread_mutex_lock(&px->lock);
+    px->launched = 0;
+    for (int i = 0; i < n; ++i) {
+        px->active++;   // before the thread can finish
+        if (pthread_create(&px->threads[px->nthreads], NULL, proxy_main, px) != 0) {
+            px->active--;
+            break;
+        }
+        px->nthreads++;
+        px->launched++;
+    }
+    if (px->nthreads == 0 && n > 0) {
+        pthread_mutex_unlock(&px->lock);
+        return -1;
+    }
+    if (px->active == 0) px->t_end = ff_now_ns();
+    pthread_mutex_unlock(&px->lock);
+    return 0;
+}
+
+void ff_proxy_stop(FFProxy* px) {
+    if (!px) return;
+    atomic_store(&px->stopping, 1);
+    // One caller joins the threads; concurrent ones wait for it to finish.
+    pthread_mutex_lock(&px->lock);
+    while (px->joining) ff_cond_wait_ns(&px->cv, &px->lock, -1);
+    int n = px->nthreads;
+    px->joining = n > 0;
+    pthread_mutex_unlock(&px->lock);
+    if (n == 0) return;
+    for (int i = 0; i < n; ++i) pthread_join(px->threads[i], NULL);
+    pthread_mutex_lock(&px->lock);
+    px->nthreads = 0;
+    px->joining  = 0;
+    pthread_cond_broadcast(&px->cv);
+    pthread_mutex_unlock(&px->lock);
+}
+
+int ff_proxy_wait(FFProxy* px, int timeout_ms) {
+    if (!px) return 0;
+    int64_t deadline = ff_now_ns() + (int64_t)timeout_ms * 1000000;
+    pthread_mutex_lock(&px->lock);
+    while (px->active > 0) {
+        int64_t left = timeout_ms < 0 ? -1 : deadline - ff_now_ns();
+        if (timeout_ms >= 0 && left <= 0) break;
+        ff_cond_wait_ns(&px->cv, &px->lock, left);
+    }
+    int done = px->active == 0;
+    pthread_mutex_unlock(&px->lock);
+    if (done) ff_proxy_stop(px);   // reap the threads
+    return done;
+}
+
+const FFDiskCacheKey* ff_proxy_key(FFProxy* px) {
+    return px ? &px->key : NULL;
+}
+
+FFFrameRef* ff_proxy_get(FFProxy* px, int64_t index) {
+    return px ? ff_diskcache_get(px->cfg.store, &px->key, index) : NULL;
+}
+
+int ff_proxy_contains(FFProxy* px, int64_t index) {
+    return px ? ff_diskcache_contains(px->cfg.store, &px->key, index) : 0;
+}
+
+int ff_proxy_read_into(FFProxy* px, int64_t index, FFSinkImage* img) {
+    return px ? ff_diskcache_read_into(px->cfg.store, &px->key, index, img) : -1;
+}
+
+FFFrameRef* ff_proxy_coarse(void* px, int64_t index) {
+    return ff_proxy_get(px, index);
+}
+
+void ff_proxy_get_stats(FFProxy* px, FFProxyStats* out) {
+    if (!px || !out) return;
+    memset(out, 0, sizeof(*out));
+    pthread_mutex_lock(&px->lock);
+    out->frames_total   = px->frames;
+    out->frames_built   = atomic_load(&px->built);
+    out->frames_present = atomic_load(&px->present);
+    out->errors         = atomic_load(&px->errors);
+    out->threads        = px->launched;
+    out->running        = px->active > 0;
+    if (px->t_start) out->elapsed_ns = (px->t_end ? px->t_end : ff_now_ns()) - px->t_start;
+    pthread_mutex_unlock(&px->lock);
+    out->complete  = px->frames >= 0 && !out->running && !out->errors &&
+                     (int64_t)(out->frames_built + out->frames_present) >= px->frames;
+    out->build_fps = out->elapsed_ns > 0 ? out->frames_built / (out->elapsed_ns / 1e9) : 0;
+}
+
+int ff_proxy_choose(const FFProxyView* v, int using_proxy) {
+    if (!v || !v->proxy_ready) return 0;
+    if (v->scrubbing) return 1;
+    if (v->proxy_w >= v->view_w && v->proxy_h >= v->view_h) return 1;   // full res would be thrown away
+    return v->load > (using_proxy ? FF_PROXY_LOAD_LOW : FF_PROXY_LOAD_HIGH);
+}
@@ -0,0 +1,93 @@
+#pragma once
+#include <stdint.h>
+#include "ffdiskcache.h"
+#include "ffframe.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Low-resolution proxies of large clips, built in the background. Frames are
+// decoded and converted straight to 1/scale size (region output, ffconvert.h)
+// and stored in a disk cache (ffdiskcache.h) under the clip's identity at the
+// proxy size, so a proxy survives restarts and is found again by any player
+// of the same file. The clip is cut into segments that several worker
+// threads, each with its own decoder, take in turn; workers run at idle
+// priority so they only use cores playback leaves free. Segments already in
+// the store are skipped, so an interrupted build resumes where it stopped.
+typedef struct FFProxy FFProxy;
+
+typedef struct FFProxyConfig {
+    const char*  path;             // clip, opened with ff_open by each worker
+    uint64_t     clip_id;          // identity; 0 = ff_diskcache_clip_id(path)
+    FFDiskCache* store;            // not owned
+    int          scale;            // 0 = 4
+    int          threads;          // decoders at once; 0 = online CPUs - 1 (at least 1)
+    int          segment_frames;   // frames per work item; 0 = 64
+    int          normal_priority;  // 1 = do not lower the workers' priority
+} FFProxyConfig;
+
+typedef struct FFProxyStats {
+    int64_t  frames_total;         // -1 if the clip's length is unknown
+    uint64_t frames_built;         // converted and stored by this build
+    uint64_t frames_present;       // already in the store
+    uint64_t errors;               // segments abandoned on a decode error
+    int      threads;
+    int      running;
+    int      complete;             // every frame is in the store
+    int64_t  elapsed_ns;           // since ff_proxy_start (until done)
+    double   build_fps;            // frames_built / elapsed
+} FFProxyStats;
+
+// Probes the clip and prepares the key; does not start building. NULL on failure.
+FFProxy* ff_proxy_create(const FFProxyConfig* cfg);
+// Stops a build in progress (between frames) and frees the proxy. Stored
+// frames stay in the store.
+void     ff_proxy_destroy(FFProxy* px);
+
+// Starts (or resumes) building on background threads. Returns 0, or -1.
+int      ff_proxy_start(FFProxy* px);
+// Stops the workers and waits for them.
+void     ff_proxy_stop(FFProxy* px);
+// Waits up to timeout_ms (<0 = forever) for the build to finish. Returns 1 if
+// it has, 0 otherwise.
+int      ff_proxy_wait(FFProxy* px, int timeout_ms);
+
+// The store key of the proxy frames (clip identity and proxy size).
+const FFDiskCacheKey* ff_proxy_key(FFProxy* px);
+
+// Proxy frame `index` with one reference, or NULL if not built yet.
+FFFrameRef* ff_proxy_get(FFProxy* px, int64_t index);
+int         ff_proxy_contains(FFProxy* px, int64_t index);
+// Copies proxy frame `index` into `img` (ff_proxy_key's size, BGRA). Returns 1,
+// 0 if not built yet, or -1.
+int         ff_proxy_read_into(FFProxy* px, int64_t index, FFSinkImage* img);
+// ff_proxy_get for callback slots such as FFScrubConfig.coarse (opaque = the proxy).
+FFFrameRef* ff_proxy_coarse(void* px, int64_t index);
+
+void     ff_proxy_get_stats(FFProxy* px, FFProxyStats* out);
+
+// Proxy or full resolution for what is on screen now.
+typedef struct FFProxyView {
+    int    view_w, view_h;         // pixels the picture is drawn at
+    int    proxy_w, proxy_h;
+    int    proxy_ready;            // the proxy has the frames about to be shown
+    int    scrubbing;
+    // Full-resolution cost: decode time per frame / frame period (1 = only
+    // just keeping up). 0 if not measured.
+    double load;
+} FFProxyView;
+
+// Load above which playback switches to the proxy, and below which it goes
+// back to full resolution.
+#define FF_PROXY_LOAD_HIGH 0.9
+#define FF_PROXY_LOAD_LOW  0.6
+
+// Returns 1 to show the proxy: always while scrubbing, when the proxy already
+// has as many pixels as the view, or when full resolution cannot keep up.
+// `using_proxy` is the current choice, for hysteresis on load.
+int      ff_proxy_choose(const FFProxyView* v, int using_proxy);
+
+#ifdef __cplusplus
+}
+#endif
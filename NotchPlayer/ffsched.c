@@ -0,0 +1,324 @@
+#include "ffsched.h"
+#include "ffutil.h"
+#include <math.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define FF_SCHED_DEFAULT_MAX_DROPS 3
+
+struct FFSched {
+    FFSchedConfig   cfg;
+    int64_t         interval_ns, lead_ns, drop_ns;   // drop_ns < 0 = never
+    pthread_mutex_t lock;
+    pthread_cond_t  cv;            // media clock changed, woken or stopped
+
+    // Media time = anchor_media + (clock - anchor_clock) while playing.
+    int             playing;
+    double          anchor_media;
+    int64_t         anchor_clock;
+    atomic_uint_least64_t gen;     // bumped on every change a wait must see
+    int             stopped;
+
+    int             drop_run;      // consecutive drops
+    int             have_prev;     // last presented frame, while playing continuously
+    double          prev_pts;
+    int64_t         prev_clock;
+
+    FFSchedStats    st;
+    uint64_t        late_samples, wake_samples;
+};
+
+static int64_t host_now(void* opaque) {
+    return ff_now_ns();
+}
+
+FFClock ff_clock_host(void) {
+    FFClock c = { host_now, NULL, NULL };
+    return c;
+}
+
+static int64_t clock_now(const FFSched* s) {
+    return s->cfg.clock.now_ns(s->cfg.clock.opaque);
+}
+
+// ---- Media clock (lock held) ----
+
+static double media_at(const FFSched* s, int64_t now) {
+    return s->playing ? s->anchor_media + (now - s->anchor_clock) / 1e9 : s->anchor_media;
+}
+
+static int64_t due_locked(const FFSched* s, double pts) {
+    if (!s->playing) return INT64_MAX;
+    return s->anchor_clock + llround((pts - s->anchor_media) * 1e9);
+}
+
+// Something a wait has to re-evaluate changed.
+static void changed_locked(FFSched* s) {
+    atomic_fetch_add(&s->gen, 1);
+    s->have_prev = 0;
+    pthread_cond_broadcast(&s->cv);
+}
+
+static int decide_locked(FFSched* s, double pts, int64_t now, int64_t* wake_ns) {
+    int64_t late;
+    if (!s->playing) {
+        // Frozen clock: show what belongs at the paused position, hold the rest.
+        double t = s->anchor_media;
+        if (pts > t + s->lead_ns / 1e9) {
+            *wake_ns = INT64_MAX;
+            return FF_SCHED_HOLD;
+        }
+        late = llround((t - pts) * 1e9);
+    } else {
+        int64_t due = due_locked(s, pts);
+        if (now < due - s->lead_ns) {
+            *wake_ns = due - s->lead_ns;
+            return FF_SCHED_HOLD;
+        }
+        late = now - due;
+    }
+    if (s->drop_ns >= 0 && late > s->drop_ns && s->drop_run < s->cfg.max_drops) {
+        s->drop_run++;
+        s->st.dropped++;
+        return FF_SCHED_DROP;
+    }
+    return FF_SCHED_PRESENT;
+}
+
+// ---- API ----
+
+FFSched* ff_sched_create(const FFSchedConfig* cfg) {
+    if (!cfg || !(cfg->frame_interval > 0) || cfg->lead < 0 || cfg->max_drops < 0) return NULL;
+    FFSched* s = calloc(1, sizeof(*s));
+    if (!s) return NULL;
+    s->cfg = *cfg;
+    if (!s->cfg.clock.now_ns) s->cfg.clock = ff_clock_host();
+    if (s->cfg.lead == 0) s->cfg.lead = fmax(0.5 * cfg->frame_interval, 0.003);
+    if (s->cfg.drop_late == 0) s->cfg.drop_late = cfg->frame_interval;
+    if (s->cfg.max_drops == 0) s->cfg.max_drops = FF_SCHED_DEFAULT_MAX_DROPS;
+    if (s->cfg.spin_ns == 0) s->cfg.spin_ns = FF_SCHED_DEFAULT_SPIN_NS;
+    if (s->cfg.spin_ns < 0) s->cfg.spin_ns = 0;
+    s->interval_ns = llround(s->cfg.frame_interval * 1e9);
+    s->lead_ns     = llround(s->cfg.lead * 1e9);
+    s->drop_ns     = s->cfg.drop_late < 0 ? -1 : llround(s->cfg.drop_late * 1e9);
+    s->anchor_clock = clock_now(s);
+    atomic_init(&s->gen, 0);
+    pthread_mutex_init(&s->lock, NULL);
+    ff_cond_init(&s->cv);
+    return s;
+}
+
+void ff_sched_destroy(FFSched* s) {
+    if (!s) return;
+    pthread_mutex_destroy(&s->lock);
+    pthread_cond_destroy(&s->cv);
+    free(s);
+}
+
+void ff_sched_play(FFSched* s) {
+    if (!s) return;
+    pthread_mutex_lock(&s->lock);
+    if (!s->playing) {
+        s->anchor_clock = clock_now(s);
+        s->playing = 1;
+        changed_locked(s);
+    }
+    pthread_mutex_unlock(&s->lock);
+}
+
+void ff_sched_pause(FFSched* s) {
+    if (!s) return;
+    pthread_mutex_lock(&s->lock);
+    if (s->playing) {
+        int64_t now = clock_now(s);
+        s->anchor_media = media_at(s, now);
+        s->anchor_clock = now;
+        s->playing = 0;
+        changed_locked(s);
+    }
+    pthread_mutex_unlock(&s->lock);
+}
+
+void ff_sched_seek(FFSched* s, double t) {
+    if (!s) return;
+    pthread_mutex_lock(&s->lock);
+    s->anchor_media = t;
+    s->anchor_clock = clock_now(s);
+    changed_locked(s);
+    pthread_mutex_unlock(&s->lock);
+}
+
+double ff_sched_time(FFSched* s) {
+    if (!s) return NAN;
+    pthread_mutex_lock(&s->lock);
+    double t = media_at(s, clock_now(s));
+    pthread_mutex_unlock(&s->lock);
+    return t;
+}
+
+double ff_sched_time_at(FFSched* s, int64_t clock_ns) {
+    if (!s) return NAN;
+    pthread_mutex_lock(&s->lock);
+    double t = media_at(s, clock_ns);
+    pthread_mutex_unlock(&s->lock);
+    return t;
+}
+
+void ff_sched_slew(FFSched* s, double delta) {
+    if (!s) return;
+    pthread_mutex_lock(&s->lock);
+    s->anchor_media += delta;
+    pthread_mutex_unlock(&s->lock);
+}
+
+int ff_sched_is_playing(FFSched* s) {
+    if (!s) return 0;
+    pthread_mutex_lock(&s->lock);
+    int r = s->playing;
+    pthread_mutex_unlock(&s->lock);
+    return r;
+}
+
+double ff_sched_frame_interval(FFSched* s) {
+    return s ? s->cfg.frame_interval : NAN;
+}
+
+int64_t ff_sched_due_ns(FFSched* s, double pts) {
+    if (!s) return INT64_MAX;
+    pthread_mutex_lock(&s->lock);
+    int64_t due = due_locked(s, pts);
+    pthread_mutex_unlock(&s->lock);
+    return due;
+}
+
+int ff_sched_decide(FFSched* s, double pts, int64_t* wake_ns) {
+    if (!s) return FF_SCHED_STOPPED;
+    int64_t wake = 0;
+    pthread_mutex_lock(&s->lock);
+    int r = s->stopped ? FF_SCHED_STOPPED : decide_locked(s, pts, clock_now(s), &wake);
+    pthread_mutex_unlock(&s->lock);
+    if (wake_ns) *wake_ns = wake;
+    return r;
+}
+
+static void record_wake_locked(FFSched* s, int64_t err) {
+    s->wake_samples++;
+    if (err > s->st.wake_error_max_ns) s->st.wake_error_max_ns = err;
+    s->st.wake_error_mean_ns += (err - s->st.wake_error_mean_ns) / (double)s->wake_samples;
+}
+
+int ff_sched_wait(FFSched* s, double pts) {
+    if (!s) return FF_SCHED_STOPPED;
+    pthread_mutex_lock(&s->lock);
+    for (;;) {
+        if (s->stopped) break;
+        int64_t wake;
+        int r = decide_locked(s, pts, clock_now(s), &wake);
+        if (r != FF_SCHED_HOLD) {
+            pthread_mutex_unlock(&s->lock);
+            return r;
+        }
+        s->st.waits++;
+        uint64_t gen = atomic_load(&s->gen);
+
+        if (s->cfg.clock.sleep_until) {
+            // Simulated time passes only when asked to; nothing can interrupt it.
+            if (wake == INT64_MAX) {
+                s->st.interrupted++;
+                pthread_mutex_unlock(&s->lock);
+                return FF_SCHED_WOKEN;
+            }
+            pthread_mutex_unlock(&s->lock);
+            s->cfg.clock.sleep_until(s->cfg.clock.opaque, wake);
+            pthread_mutex_lock(&s->lock);
+            record_wake_locked(s, clock_now(s) - wake);
+            continue;
+        }
+
+        // Sleep to just short of the deadline; changes cut the sleep short.
+        while (!s->stopped && atomic_load(&s->gen) == gen) {
+            if (wake == INT64_MAX) {
+                ff_cond_wait_ns(&s->cv, &s->lock, -1);
+                continue;
+            }
+            int64_t left = wake - s->cfg.spin_ns - clock_now(s);
+            if (left <= 0) break;
+            ff_cond_wait_ns(&s->cv, &s->lock, left);
+        }
+        if (s->stopped) break;
+        if (atomic_load(&s->gen) != gen) {
+            s->st.interrupted++;
+            pthread_mutex_unlock(&s->lock);
+            return FF_SCHED_WOKEN;
+        }
+        // ...then spin the rest: timed waits overshoot by tens of microseconds.
+        pthread_mutex_unlock(&s->lock);
+        int64_t now;
+        while ((now = clock_now(s)) < wake && atomic_load(&s->gen) == gen) sched_yield();
+        pthread_mutex_lock(&s->lock);
+        if (atomic_load(&s->gen) == gen) record_wake_locked(s, now - wake);
+    }
+    s->st.interrupted++;
+    pthread_mutex_unlock(&s->lock);
+    return FF_SCHED_STOPPED;
+}
+
+void ff_sched_wake(FFSched* s) {
+    if (!s) return;
+    pthread_mutex_lock(&s->lock);
+    atomic_fetch_add(&s->gen, 1);
+    pthread_cond_broadcast(&s->cv);
+    pthread_mutex_unlock(&s->lock);
+}
+
+void ff_sched_stop(FFSched* s) {
+    if (!s) return;
+    pthread_mutex_lock(&s->lock);
+    s->stopped = 1;
+    atomic_fetch_add(&s->gen, 1);
+    pthread_cond_broadcast(&s->cv);
+    pthread_mutex_unlock(&s->lock);
+}
+
+void ff_sched_presented(FFSched* s, double pts) {
+    if (!s) return;
+    pthread_mutex_lock(&s->lock);
+    int64_t now = clock_now(s);
+    s->st.presented++;
+    s->drop_run = 0;
+    if (s->playing) {
+        int64_t late = now - due_locked(s, pts);
+        if (late > 0) s->st.late++;
+        s->late_samples++;
+        if (s->late_samples == 1 || late > s->st.late_max_ns) s->st.late_max_ns = late;
+        s->st.late_mean_ns += (late - s->st.late_mean_ns) / (double)s->late_samples;
+        // The previous frame stayed up from its hand-over until now; every
+        // frame slot after its first went by without a new frame.
+        if (s->have_prev && pts > s->prev_pts) {
+            int64_t slots = (now - s->prev_clock + s->interval_ns / 2) / s->interval_ns;
+            if (slots > 1) s->st.repeated += (uint64_t)(slots - 1);
+        }
+        s->have_prev  = 1;
+        s->prev_pts   = pts;
+        s->prev_clock = now;
+    }
+    pthread_mutex_unlock(&s->lock);
+}
+
+void ff_sched_get_stats(FFSched* s, FFSchedStats* out) {
+    if (!s || !out) return;
+    pthread_mutex_lock(&s->lock);
+    *out = s->st;
+    pthread_mutex_unlock(&s->lock);
+}
+
+void ff_sched_reset_stats(FFSched* s) {
+    if (!s) return;
+    pthread_mutex_lock(&s->lock);
+    memset(&s->st, 0, sizeof(s->st));
+    s->late_samples = s->wake_samples = 0;
+    pthread_mutex_unlock(&s->lock);
+}
@@ -0,0 +1,108 @@
+#pragma once
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Presentation scheduler: maps frame timestamps onto a clock and decides, for
+// each decoded frame, when to hand it to the display, or whether to drop it.
+// A media clock (position, playing or paused) is kept against a pluggable
+// clock source. ff_sched_wait sleeps until a frame's hand-over time, `lead`
+// before it is due, and wakes early only when the media clock changes. It
+// then spins briefly so the hand-over lands within microseconds of the
+// deadline. The scheduler has no thread of its own and no platform
+// dependencies; a display loop calls it once per frame. Thread-safe.
+typedef struct FFSched FFSched;
+
+// A time source in nanoseconds.
+typedef struct FFClock {
+    int64_t (*now_ns)(void* opaque);
+    // Optional: returns once the clock reaches deadline_ns. Set for clocks that
+    // are not wall time (e.g. simulated); such waits cannot be cut short. NULL
+    // = a real-time wait that ff_sched_wake and media-clock changes interrupt.
+    void    (*sleep_until)(void* opaque, int64_t deadline_ns);
+    void*    opaque;
+} FFClock;
+
+// The monotonic host clock (ff_now_ns).
+FFClock ff_clock_host(void);
+
+typedef struct FFSchedConfig {
+    FFClock clock;            // now_ns NULL = ff_clock_host()
+    double  frame_interval;   // seconds per frame; required
+    double  lead;             // hand-over ahead of the due time, seconds; 0 = max(half a frame, 3 ms)
+    double  drop_late;        // later than this past due, a frame is dropped; 0 = one frame, <0 = never
+    int     max_drops;        // consecutive drops before a late frame is shown anyway; 0 = 3
+    int64_t spin_ns;          // busy-wait at the end of a wait; 0 = FF_SCHED_DEFAULT_SPIN_NS, <0 = none
+} FFSchedConfig;
+
+#define FF_SCHED_DEFAULT_SPIN_NS 200000
+
+// ff_sched_decide / ff_sched_wait results
+#define FF_SCHED_STOPPED (-1)   // ff_sched_stop was called
+#define FF_SCHED_WOKEN     0    // the wait was interrupted: decide again
+#define FF_SCHED_PRESENT   1    // hand the frame over now
+#define FF_SCHED_DROP      2    // too late: skip it
+#define FF_SCHED_HOLD      3    // not yet (ff_sched_decide only)
+
+typedef struct FFSchedStats {
+    uint64_t presented;
+    uint64_t dropped;
+    uint64_t repeated;           // frame slots that passed with no new frame handed over
+    uint64_t late;               // presented after their due time
+    uint64_t waits;              // waits that slept
+    uint64_t interrupted;        // waits cut short (WOKEN)
+    // Presented frames: hand-over time minus due time (negative = early).
+    int64_t  late_max_ns;
+    double   late_mean_ns;
+    // Waits that ran to their deadline: how long after it they returned.
+    int64_t  wake_error_max_ns;
+    double   wake_error_mean_ns;
+} FFSchedStats;
+
+FFSched* ff_sched_create(const FFSchedConfig* cfg);   // NULL on bad config
+void     ff_sched_destroy(FFSched* s);
+
+// Media clock. The scheduler starts paused at 0.
+void     ff_sched_play(FFSched* s);
+void     ff_sched_pause(FFSched* s);
+// Moves the media clock to `t` seconds, playing or paused as before.
+void     ff_sched_seek(FFSched* s, double t);
+double   ff_sched_time(FFSched* s);
+// Media time at clock time `clock_ns` (now, or a timestamp taken from the
+// scheduler's clock), as the media clock runs now.
+double   ff_sched_time_at(FFSched* s, int64_t clock_ns);
+// Shifts the media clock by `delta` seconds without treating it as a
+// discontinuity: for small phase corrections. Waits in progress are not
+// interrupted; the shift applies from the next decision.
+void     ff_sched_slew(FFSched* s, double delta);
+int      ff_sched_is_playing(FFSched* s);
+double   ff_sched_frame_interval(FFSched* s);
+// Clock time at which the media clock reaches `pts`; INT64_MAX while paused.
+int64_t  ff_sched_due_ns(FFSched* s, double pts);
+
+// Decision for a frame at `pts` now. With FF_SCHED_HOLD, *wake_ns (may be NULL)
+// is when to ask again (INT64_MAX while paused). Paused, frames up to the
+// paused position (plus lead) are presented so a seek shows its frame.
+int      ff_sched_decide(FFSched* s, double pts, int64_t* wake_ns);
+// Waits until the frame at `pts` should be handed over (zero CPU while paused)
+// and returns FF_SCHED_PRESENT, FF_SCHED_DROP, FF_SCHED_WOKEN or FF_SCHED_STOPPED.
+// With a clock that has sleep_until, a wait that would last until play returns
+// FF_SCHED_WOKEN at once.
+int      ff_sched_wait(FFSched* s, double pts);
+// Interrupts waits in progress; they return FF_SCHED_WOKEN.
+void     ff_sched_wake(FFSched* s);
+// Every wait, now and later, returns FF_SCHED_STOPPED.
+void     ff_sched_stop(FFSched* s);
+
+// Records that the frame at `pts` was handed over now (after FF_SCHED_PRESENT).
+// FF_SCHED_DROP results are counted as they are returned.
+void     ff_sched_presented(FFSched* s, double pts);
+
+void     ff_sched_get_stats(FFSched* s, FFSchedStats* out);
+void     ff_sched_reset_stats(FFSched* s);
+
+#ifdef __cplusplus
+}
+#endif
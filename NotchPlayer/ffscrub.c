@@ -0,0 +1,207 @@
+#include "ffscrub.h"
+#include "ffcache.h"
+#include "ffdecode.h"
+#include "ffutil.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+
+struct FFScrub {
+    FFScrubConfig   cfg;
+    pthread_mutex_t lock;
+    pthread_cond_t  cv;            // new request, refined frame, or stopping
+    pthread_t       thread;
+    int             stopping;
+
+    // Latest request. seq counts requests; the player's interrupt callback
+    // compares it with the request the thread is decoding.
+    atomic_uint_least64_t seq;
+    uint64_t        busy_seq;      // scrub thread only
+    int64_t         want;
+    int64_t         want_ns;       // when it was made
+    int             want_shown;    // a frame has been shown for it
+    int             pending;       // it still needs a decode
+    int             refining;      // its refined frame is still to come
+    int             failed;        // its decode failed
+
+    FFFrameRef*     refined;       // for the latest request, not yet polled
+    FFFrameRef*     last_fine;     // answers a repeated request exactly
+
+    FFScrubStats    stats;
+    uint64_t        first_pixels;  // samples in first_pixel_ns_avg
+};
+
+static int scrub_interrupted(void* opaque) {
+    FFScrub* s = opaque;
+    return atomic_load(&s->seq) != s->busy_seq;
+}
+
+// Called with the lock held when the first frame for the latest request is shown.
+static void first_pixel(FFScrub* s, int64_t now) {
+    int64_t dt = now - s->want_ns;
+    s->want_shown = 1;
+    s->stats.first_pixel_ns_last = dt;
+    if (dt > s->stats.first_pixel_ns_max) s->stats.first_pixel_ns_max = dt;
+    s->first_pixels++;
+    s->stats.first_pixel_ns_avg += (dt - s->stats.first_pixel_ns_avg) / (double)s->first_pixels;
+}
+
+static void* scrub_main(void* arg) {
+    FFScrub* s = arg;
+    pthread_mutex_lock(&s->lock);
+    for (;;) {
+        while (!s->stopping && !s->pending) ff_cond_wait_ns(&s->cv, &s->lock, -1);
+        if (s->stopping) break;
+        int64_t index = s->want;
+        uint64_t seq  = atomic_load(&s->seq);
+        s->pending  = 0;
+        s->busy_seq = seq;
+        pthread_mutex_unlock(&s->lock);
+
+        FFFrameRef* f = NULL;
+        int r = ff_seek_frame(s->cfg.player, index);
+        if (r >= 0) r = ff_next_frame_ref(s->cfg.player, &f);
+        if (r == 1 && s->cfg.cache) ff_cache_put(s->cfg.cache, f);
+
+        pthread_mutex_lock(&s->lock);
+        if (r == 1 && atomic_load(&s->seq) == seq) {
+            int64_t now = ff_now_ns();
+            ff_frame_release(s->refined);
+            ff_frame_release(s->last_fine);
+            s->refined   = f;
+            s->last_fine = ff_frame_retain(f);
+            s->stats.refined++;
+            s->stats.refine_ns_last = now - s->want_ns;
+            if (s->stats.refine_ns_last > s->stats.refine_ns_max) s->stats.refine_ns_max = s->stats.refine_ns_last;
+            if (!s->want_shown) first_pixel(s, now);
+            pthread_cond_broadcast(&s->cv);
+        } else if (atomic_load(&s->seq) == seq) {
+            // The latest request cannot be refined: wake its pollers.
+            s->refining = 0;
+            s->failed   = 1;
+            s->stats.failed++;
+            ff_frame_release(f);
+            pthread_cond_broadcast(&s->cv);
+        } else {
+            if (r == 1 || r == -4) s->stats.cancelled++;
+            ff_frame_release(f);
+        }
+    }
+    pthread_mutex_unlock(&s->lock);
+    return NULL;
+}
+
+FFScrub* ff_scrub_create(const FFScrubConfig* cfg) {
+    if (!cfg || !cfg->player || cfg->coarse_distance < 0) return NULL;
+    FFScrub* s = calloc(1, sizeof(*s));
+    if (!s) return NULL;
+    s->cfg = *cfg;
+    atomic_init(&s->seq, 0);
+    pthread_mutex_init(&s->lock, NULL);
+    ff_cond_init(&s->cv);
+    if (pthread_create(&s->thread, NULL, scrub_main, s) != 0) {
+        pthread_mutex_destroy(&s->lock);
+        pthread_cond_destroy(&s->cv);
+        free(s);
+        return NULL;
+    }
+    ff_set_interrupt(s->cfg.player, scrub_interrupted, s);
+    return s;
+}
+
+void ff_scrub_destroy(FFScrub* s) {
+    if (!s) return;
+    pthread_mutex_lock(&s->lock);
+    s->stopping = 1;
+    atomic_fetch_add(&s->seq, 1);   // interrupts a decode in progress
+    pthread_cond_broadcast(&s->cv);
+    pthread_mutex_unlock(&s->lock);
+    pthread_join(s->thread, NULL);
+    ff_set_interrupt(s->cfg.player, NULL, NULL);
+
+    ff_frame_release(s->refined);
+    ff_frame_release(s->last_fine);
+    pthread_mutex_destroy(&s->lock);
+    pthread_cond_destroy(&s->cv);
+    free(s);
+}
+
+static int64_t distance(int64_t a, int64_t b) {
+    return a > b ? a - b : b - a;
+}
+
+int ff_scrub_seek(FFScrub* s, int64_t index, FFFrameRef** out) {
+    if (out) *out = NULL;
+    if (!s || index < 0) return -1;
+    int64_t t0 = ff_now_ns();
+
+    // Best frame available without decoding.
+    int kind = FF_SCRUB_NONE;
+    FFFrameRef* f = NULL;
+    pthread_mutex_lock(&s->lock);
+    if (s->last_fine && ff_frame_index(s->last_fine) == index) {
+        f = ff_frame_retain(s->last_fine);
+        kind = FF_SCRUB_EXACT;
+    }
+    pthread_mutex_unlock(&s->lock);
+    if (!f && s->cfg.cache && (f = ff_cache_get_nearest(s->cfg.cache, index)))
+        kind = ff_frame_index(f) == index ? FF_SCRUB_EXACT : FF_SCRUB_NEAR;
+    if (s->cfg.coarse && (!f || (kind == FF_SCRUB_NEAR && distance(ff_frame_index(f), index) > s->cfg.coarse_distance))) {
+        FFFrameRef* c = s->cfg.coarse(s->cfg.coarse_opaque, index);
+        if (c) {
+            ff_frame_release(f);
+            f = c;
+            kind = FF_SCRUB_COARSE;
+        }
+    }
+
+    pthread_mutex_lock(&s->lock);
+    s->stats.requests++;
+    if (s->pending) s->stats.superseded++;
+    atomic_fetch_add(&s->seq, 1);   // a decode for an older request stops
+    s->want    = index;
+    s->want_ns = t0;
+    s->pending = kind != FF_SCRUB_EXACT;
+    s->refining = s->pending;
+    s->failed  = 0;
+    s->want_shown = 0;
+    ff_frame_release(s->refined);
+    s->refined = NULL;
+    if (f) {
+        first_pixel(s, ff_now_ns());
+        if (kind == FF_SCRUB_EXACT) s->stats.exact++;
+        else if (kind == FF_SCRUB_NEAR) s->stats.near++;
+        else s->stats.coarse++;
+    }
+    if (s->pending) pthread_cond_broadcast(&s->cv);
+    pthread_mutex_unlock(&s->lock);
+
+    if (out) *out = f;
+    else ff_frame_release(f);
+    return kind;
+}
+
+int ff_scrub_poll(FFScrub* s, FFFrameRef** out, int timeout_ms) {
+    if (!s || !out) return 0;
+    *out = NULL;
+    int64_t deadline = ff_now_ns() + (int64_t)timeout_ms * 1000000;
+    pthread_mutex_lock(&s->lock);
+    while (!s->refined && s->refining && timeout_ms != 0) {
+        int64_t left = timeout_ms < 0 ? -1 : deadline - ff_now_ns();
+        if (timeout_ms > 0 && left <= 0) break;
+        ff_cond_wait_ns(&s->cv, &s->lock, left);
+    }
+    *out = s->refined;
+    s->refined = NULL;
+    int r = *out ? 1 : s->failed ? -1 : 0;
+    if (*out) s->refining = 0;
+    pthread_mutex_unlock(&s->lock);
+    return r;
+}
+
+void ff_scrub_get_stats(FFScrub* s, FFScrubStats* out) {
+    if (!s || !out) return;
+    pthread_mutex_lock(&s->lock);
+    *out = s->stats;
+    pthread_mutex_unlock(&s->lock);
+}
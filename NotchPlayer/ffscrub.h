@@ -0,0 +1,80 @@
+#pragma once
+#include <stdint.h>
+#include "ffframe.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct FFPlayer FFPlayer;
+typedef struct FFFrameCache FFFrameCache;
+
+// Coarse-to-fine scrubbing. Each scrub request is answered at once, on the
+// caller's thread, with the best frame that needs no decoding: the exact frame
+// or the nearest one from the frame cache, else a coarse frame (e.g. a proxy).
+// Meanwhile a scrub thread decodes the full-resolution frame. Only the latest
+// request is ever worked on: a newer one replaces any request still waiting
+// and interrupts a decode in progress (ff_set_interrupt), so dragging over a
+// long clip never builds a backlog. The player belongs to the scrub thread
+// until ff_scrub_destroy.
+typedef struct FFScrub FFScrub;
+
+typedef struct FFScrubConfig {
+    FFPlayer*     player;   // full-resolution decoder
+    // Optional: the nearest cached frame answers a request at once; refined
+    // frames are added. Usually ff_get_frame_cache(player).
+    FFFrameCache* cache;
+    // Optional coarse tier, tried when the cache has nothing closer than
+    // coarse_distance frames: a quickly available frame for `index` at any
+    // resolution with one reference, or NULL.
+    FFFrameRef* (*coarse)(void* opaque, int64_t index);
+    void*         coarse_opaque;
+    int           coarse_distance;   // 0 = prefer the coarse tier to any inexact cached frame
+} FFScrubConfig;
+
+// What ff_scrub_seek returned at once.
+#define FF_SCRUB_NONE   0   // nothing yet; wait for the refined frame
+#define FF_SCRUB_EXACT  1   // the requested frame itself: nothing to refine
+#define FF_SCRUB_NEAR   2   // a nearby cached frame
+#define FF_SCRUB_COARSE 3   // a coarse frame for the requested position
+
+typedef struct FFScrubStats {
+    uint64_t requests;
+    uint64_t exact;              // answered by the cached frame itself
+    uint64_t near;               // answered at once by a nearby cached frame
+    uint64_t coarse;             // answered at once by the coarse tier
+    uint64_t refined;            // full-resolution frames delivered
+    uint64_t superseded;         // replaced before their decode started
+    uint64_t cancelled;          // decodes interrupted (or finished too late) for a newer request
+    uint64_t failed;             // decodes that failed for the latest request
+    // Scrub to first pixel: request to the first frame shown for it, from
+    // whichever tier answered first; requests replaced before any frame are not counted.
+    int64_t  first_pixel_ns_last;
+    int64_t  first_pixel_ns_max;
+    double   first_pixel_ns_avg;
+    // Request to its full-resolution frame.
+    int64_t  refine_ns_last;
+    int64_t  refine_ns_max;
+} FFScrubStats;
+
+FFScrub* ff_scrub_create(const FFScrubConfig* cfg);
+// Interrupts any decode, stops the scrub thread and hands the player back
+// (its position is undefined until the next ff_seek_frame).
+void     ff_scrub_destroy(FFScrub* s);
+
+// Scrubs to frame `index`. *out (optional) receives the frame to show now with
+// one reference, or NULL. Returns FF_SCRUB_*, or -1 on error.
+int      ff_scrub_seek(FFScrub* s, int64_t index, FFFrameRef** out);
+
+// Full-resolution frame for the latest request, waiting up to timeout_ms (0 =
+// poll, <0 = forever). Returns 1 with *out (one reference) the first time it is
+// ready, -1 if its decode failed, 0 otherwise. Returns at once when nothing is
+// left to come: no request yet, an FF_SCRUB_EXACT answer, or a frame already
+// polled.
+int      ff_scrub_poll(FFScrub* s, FFFrameRef** out, int timeout_ms);
+
+void     ff_scrub_get_stats(FFScrub* s, FFScrubStats* out);
+
+#ifdef __cplusplus
+}
+#endif
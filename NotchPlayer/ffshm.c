@@ -0,0 +1,341 @@
+#include "ffshm.h"
+#include "ffshm_layout.h"
+#include "ffutil.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
+#define FF_SHM_MAX_SLOTS 64
+
+struct FFShmRing {
+    char            name[256];
+    uint8_t*        base;
+    size_t          size;
+    FFShmHeader*    hdr;
+    FFShmSlot*      slots;
+
+    int             max_w, max_h, stride;
+    FFPixelFormat   fmt;
+
+    pthread_mutex_t lock;             // serializes local writers
+    int             refs;             // creator + sinks + locally held frames
+    int             pin_timeout_ms;
+    uint64_t        last_seq;         // last even seq handed out
+    uint8_t         writing[FF_SHM_MAX_SLOTS];
+    uint64_t        prev_seq[FF_SHM_MAX_SLOTS];
+    FFShmRingStats  st;
+};
+
+static size_t page_round(size_t v) {
+    size_t pg = (size_t)sysconf(_SC_PAGESIZE);
+    return (v + pg - 1) / pg * pg;
+}
+
+static void shm_path(char* out, size_t n, const char* name) {
+    snprintf(out, n, "%s%s", name[0] == '/' ? "" : "/", name);
+}
+
+FFShmRing* ff_shm_ring_create(const char* name, int slots, int max_width, int max_height, FFPixelFormat fmt) {
+    int bpp = ff_pixfmt_bytes_per_pixel(fmt);
+    if (!name || !name[0] || slots < 1 || slots > FF_SHM_MAX_SLOTS ||
+        max_width <= 0 || max_height <= 0 || bpp == 0) return NULL;
+
+    FFShmRing* r = calloc(1, sizeof(*r));
+    if (!r) return NULL;
+    shm_path(r->name, sizeof(r->name), name);
+
+    r->max_w  = max_width;
+    r->max_h  = max_height;
+    r->fmt    = fmt;
+    r->stride = (int)(((size_t)max_width * bpp + 63) & ~(size_t)63);
+
+    size_t slots_off  = (sizeof(FFShmHeader) + 63) & ~(size_t)63;
+    size_t data_off   = page_round(slots_off + sizeof(FFShmSlot) * (size_t)slots);
+    size_t slot_bytes = page_round((size_t)r->stride * (size_t)max_height);
+    r->size = data_off + slot_bytes * (size_t)slots;
+
+    shm_unlink(r->name);   // a crashed writer may have left one behind
+    int fd = shm_open(r->name, O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd < 0) { free(r); return NULL; }
+    if (ftruncate(fd, (off_t)r->size) != 0) {
+        close(fd);
+        shm_unlink(r->name);
+        free(r);
+        return NULL;
+    }
+    r->base = mmap(NULL, r->size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (r->base == MAP_FAILED) {
+        shm_unlink(r->name);
+        free(r);
+        return NULL;
+    }
+
+    r->hdr   = (FFShmHeader*)r->base;
+    r->slots = (FFShmSlot*)(r->base + slots_off);
+
+    FFShmHeader* h = r->hdr;
+    h->version         = FF_SHM_VERSION;
+    h->slot_count      = (uint32_t)slots;
+    h->slots_offset    = (uint32_t)slots_off;
+    h->data_offset     = data_off;
+    h->slot_data_bytes = slot_bytes;
+    h->total_bytes     = r->size;
+    atomic_store(&h->latest_seq, 0);
+    atomic_store(&h->latest_slot, 0);
+    atomic_store(&h->publish_count, 0);
+    atomic_store(&h->writer_alive, 1);
+    for (int i = 0; i < slots; ++i) {
+        atomic_store(&r->slots[i].seq, 0);
+        atomic_store(&r->slots[i].readers, 0);
+    }
+    // Readers check the magic last, so a half-initialized ring is never attached.
+    atomic_thread_fence(memory_order_seq_cst);
+    h->magic = FF_SHM_MAGIC;
+
+    pthread_mutex_init(&r->lock, NULL);
+    r->refs = 1;
+    r->pin_timeout_ms = 100;
+    return r;
+}
+
+static void ring_unref_locked(FFShmRing* r) {
+    if (--r->refs > 0) {
+        pthread_mutex_unlock(&r->lock);
+        return;
+    }
+    pthread_mutex_unlock(&r->lock);
+    munmap(r->base, r->size);
+    pthread_mutex_destroy(&r->lock);
+    free(r);
+}
+
+static void wake_readers(FFShmRing* r) {
+    atomic_fetch_add(&r->hdr->publish_count, 1);
+#ifdef __linux__
+    syscall(SYS_futex, (uint32_t*)&r->hdr->publish_count, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+#endif
+}
+
+void ff_shm_ring_destroy(FFShmRing* r) {
+    if (!r) return;
+    pthread_mutex_lock(&r->lock);
+    atomic_store(&r->hdr->writer_alive, 0);
+    wake_readers(r);
+    shm_unlink(r->name);
+    ring_unref_locked(r);
+}
+
+void ff_shm_ring_set_pin_timeout(FFShmRing* r, int timeout_ms) {
+    if (!r) return;
+    pthread_mutex_lock(&r->lock);
+    r->pin_timeout_ms = timeout_ms;
+    pthread_mutex_unlock(&r->lock);
+}
+
+void ff_shm_ring_get_stats(FFShmRing* r, FFShmRingStats* out) {
+    if (!r || !out) return;
+    pthread_mutex_lock(&r->lock);
+    *out = r->st;
+    pthread_mutex_unlock(&r->lock);
+}
+
+int ff_shm_ring_last_published(FFShmRing* r, uint64_t* seq) {
+    pthread_mutex_lock(&r->lock);
+    uint64_t sq = r->last_seq;
+    int slot = sq ? (int)atomic_load(&r->hdr->latest_slot) : -1;
+    pthread_mutex_unlock(&r->lock);
+    if (seq) *seq = sq;
+    return slot;
+}
+
+const char* ff_shm_ring_name(const FFShmRing* r) {
+    return r ? r->name : NULL;
+}
+
+// Claims a slot for writing: marks it odd unless a reader holds it. Caller holds r->lock.
+static int try_claim_locked(FFShmRing* r, int i) {
+    FFShmSlot* s = &r->slots[i];
+    uint64_t old = atomic_load(&s->seq);
+    if (atomic_load(&s->readers) > 0) return 0;
+    atomic_store(&s->seq, old | 1);
+    if (atomic_load(&s->readers) > 0) {
+        atomic_store(&s->seq, old);   // a reader got in first
+        return 0;
+    }
+    r->prev_seq[i] = old;
+    r->writing[i]  = 1;
+    return 1;
+}
+
+static int claim_slot_locked(FFShmRing* r) {
+    int n = (int)r->hdr->slot_count;
+    int latest = (int)atomic_load(&r->hdr->latest_slot);
+    int keep_latest = (n > 1 && r->last_seq > 0);
+    int64_t t_start = 0;
+
+    for (;;) {
+        for (int k = 1; k <= n; ++k) {
+            int i = (latest + k) % n;
+            if (r->writing[i] || (keep_latest && i == latest)) continue;
+            if (try_claim_locked(r, i)) return i;
+            r->st.pinned_skips++;
+        }
+
+        // Every candidate is pinned. Wait for readers, then take back the oldest.
+        int64_t now = ff_now_ns();
+        if (!t_start) { t_start = now; r->st.waits++; }
+        if (r->pin_timeout_ms >= 0 && now - t_start >= (int64_t)r->pin_timeout_ms * 1000000LL) {
+            int oldest = -1;
+            uint64_t oldest_seq = UINT64_MAX;
+            for (int i = 0; i < n; ++i) {
+                if (r->writing[i] || (keep_latest && i == latest)) continue;
+                uint64_t sq = atomic_load(&r->slots[i].seq);
+                if (sq < oldest_seq) { oldest_seq = sq; oldest = i; }
+            }
+            if (oldest < 0) return -1;
+            r->prev_seq[oldest] = oldest_seq;
+            atomic_store(&r->slots[oldest].seq, oldest_seq | 1);
+            r->writing[oldest] = 1;
+            r->st.reclaims++;
+            return oldest;
+        }
+        pthread_mutex_unlock(&r->lock);
+        usleep(200);
+        pthread_mutex_lock(&r->lock);
+    }
+}
+
+// ---- Sink ----
+
+typedef struct ShmHold {
+    FFShmRing* ring;
+    int        slot;
+} ShmHold;
+
+static int shm_sink_acquire(FFFrameSink* s, int width, int height, FFPixelFormat fmt, FFSinkImage* img) {
+    FFShmRing* r = s->opaque;
+    if (fmt != r->fmt || width > r->max_w || height > r->max_h) return -1;
+
+    pthread_mutex_lock(&r->lock);
+    int i = claim_slot_locked(r);
+    pthread_mutex_unlock(&r->lock);
+    if (i < 0) return -1;
+
+    memset(img, 0, sizeof(*img));
+    img->data[0]     = r->base + r->hdr->data_offset + (size_t)i * r->hdr->slot_data_bytes;
+    img->linesize[0] = r->stride;
+    img->width       = width;
+    img->height      = height;
+    img->format      = fmt;
+    img->priv        = (void*)(intptr_t)(i + 1);
+    return 0;
+}
+
+static void shm_frame_free(void* opaque) {
+    ShmHold* hold = opaque;
+    FFShmRing* r = hold->ring;
+    atomic_fetch_sub(&r->slots[hold->slot].readers, 1);
+    free(hold);
+    pthread_mutex_lock(&r->lock);
+    ring_unref_locked(r);
+}
+
+static FFFrameRef* shm_sink_commit(FFFrameSink* s, FFSinkImage* img, double pts, int64_t index) {
+    FFShmRing* r = s->opaque;
+    int i = (int)(intptr_t)img->priv - 1;
+    FFShmSlot* slot = &r->slots[i];
+    img->priv = NULL;
+
+    slot->format      = (uint32_t)img->format;
+    slot->width       = img->width;
+    slot->height      = img->height;
+    slot->stride      = img->linesize[0];
+    slot->pts         = pts;
+    slot->frame_index = index;
+    slot->publish_ns  = (uint64_t)ff_now_ns();
+
+    ShmHold* hold = malloc(sizeof(*hold));
+
+    pthread_mutex_lock(&r->lock);
+    r->last_seq += 2;
+    uint64_t seq = r->last_seq;
+    // Pin for the local frame before the slot becomes visible.
+    if (hold) atomic_fetch_add(&slot->readers, 1);
+    atomic_store(&slot->seq, seq);
+    atomic_store(&r->hdr->latest_slot, (uint32_t)i);
+    atomic_store(&r->hdr->latest_seq, seq);
+    r->writing[i] = 0;
+    r->st.published++;
+    if (hold) r->refs++;
+    pthread_mutex_unlock(&r->lock);
+
+    wake_readers(r);
+    if (!hold) return NULL;
+
+    hold->ring = r;
+    hold->slot = i;
+
+    FFFrameDesc d;
+    memset(&d, 0, sizeof(d));
+    d.data[0]     = img->data[0];
+    d.linesize[0] = img->linesize[0];
+    d.width       = img->width;
+    d.height      = img->height;
+    d.format      = img->format;
+    d.pts         = pts;
+    d.index       = index;
+    d.free        = shm_frame_free;
+    d.opaque      = hold;
+
+    FFFrameRef* f = ff_frame_wrap(&d);
+    if (!f) shm_frame_free(hold);
+    return f;
+}
+
+static void shm_sink_discard(FFFrameSink* s, FFSinkImage* img) {
+    FFShmRing* r = s->opaque;
+    int i = (int)(intptr_t)img->priv - 1;
+    img->priv = NULL;
+    if (i < 0) return;
+    pthread_mutex_lock(&r->lock);
+    atomic_store(&r->slots[i].seq, r->prev_seq[i]);
+    r->writing[i] = 0;
+    pthread_mutex_unlock(&r->lock);
+}
+
+static void shm_sink_destroy(FFFrameSink* s) {
+    FFShmRing* r = s->opaque;
+    pthread_mutex_lock(&r->lock);
+    ring_unref_locked(r);
+    free(s);
+}
+
+FFFrameSink* ff_sink_shm_create(FFShmRing* r) {
+    if (!r) return NULL;
+    FFFrameSink* s = calloc(1, sizeof(*s));
+    if (!s) return NULL;
+
+    pthread_mutex_lock(&r->lock);
+    r->refs++;
+    pthread_mutex_unlock(&r->lock);
+
+    s->name    = "shm";
+    s->opaque  = r;
+    s->acquire = shm_sink_acquire;
+    s->commit  = shm_sink_commit;
+    s->discard = shm_sink_discard;
+    s->destroy = shm_sink_destroy;
+    return s;
+}
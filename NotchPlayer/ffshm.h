@@ -0,0 +1,48 @@
+#pragma once
+#include "ffframe.h"
+#include "ffsink.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Writer side of a named shared-memory frame ring (POSIX shm). Frames are
+// converted directly into ring slots; other processes attach with the client
+// library in ffshm_client.h and read the same memory without copying.
+typedef struct FFShmRing FFShmRing;
+
+typedef struct FFShmRingStats {
+    uint64_t published;
+    uint64_t pinned_skips;   // slots skipped because a reader held them
+    uint64_t reclaims;       // pinned slots taken back after pin_timeout
+    uint64_t waits;          // acquires that found every slot pinned
+} FFShmRingStats;
+
+// Creates (replacing any stale ring of that name) a ring of `slots` slots, each
+// able to hold a max_width x max_height frame in `fmt`. `name` may omit the
+// leading '/'. Returns NULL on failure.
+FFShmRing* ff_shm_ring_create(const char* name, int slots, int max_width, int max_height, FFPixelFormat fmt);
+
+// Marks the writer gone and unlinks the name. Attached readers keep their mapping;
+// frames still referenced locally stay valid until released.
+void       ff_shm_ring_destroy(FFShmRing* ring);
+
+// How long the writer waits for a reader to unpin a slot when every slot is
+// pinned before reclaiming the oldest one. Default 100 ms.
+void       ff_shm_ring_set_pin_timeout(FFShmRing* ring, int timeout_ms);
+
+void       ff_shm_ring_get_stats(FFShmRing* ring, FFShmRingStats* out);
+
+// Slot of the most recent publish (and its seq in *seq), or -1 if none yet.
+// With a single writer thread this identifies the frame it just committed, so
+// it can be announced to a reader out of band (ff_shm_reader_pin).
+int        ff_shm_ring_last_published(FFShmRing* ring, uint64_t* seq);
+const char* ff_shm_ring_name(const FFShmRing* ring);
+
+// Sink that writes frames into the ring. Each committed frame is published to
+// readers and also returned as an FFFrameRef that pins its slot locally.
+FFFrameSink* ff_sink_shm_create(FFShmRing* ring);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,162 @@
+#include "ffshm_client.h"
+#include "ffshm_layout.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
+struct FFShmReader {
+    uint8_t*     base;
+    size_t       size;
+    FFShmHeader* hdr;
+    FFShmSlot*   slots;
+};
+
+uint64_t ff_shm_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+FFShmReader* ff_shm_reader_open(const char* name) {
+    if (!name || !name[0]) return NULL;
+    char path[256];
+    snprintf(path, sizeof(path), "%s%s", name[0] == '/' ? "" : "/", name);
+
+    int fd = shm_open(path, O_RDWR, 0);
+    if (fd < 0) return NULL;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(FFShmHeader)) {
+        close(fd);
+        return NULL;
+    }
+    uint8_t* base = mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) return NULL;
+
+    FFShmHeader* h = (FFShmHeader*)base;
+    atomic_thread_fence(memory_order_seq_cst);
+    if (h->magic != FF_SHM_MAGIC || h->version != FF_SHM_VERSION ||
+        h->total_bytes > (uint64_t)st.st_size) {
+        munmap(base, (size_t)st.st_size);
+        return NULL;
+    }
+
+    FFShmReader* r = calloc(1, sizeof(*r));
+    if (!r) {
+        munmap(base, (size_t)st.st_size);
+        return NULL;
+    }
+    r->base  = base;
+    r->size  = (size_t)st.st_size;
+    r->hdr   = h;
+    r->slots = (FFShmSlot*)(base + h->slots_offset);
+    return r;
+}
+
+void ff_shm_reader_close(FFShmReader* r) {
+    if (!r) return;
+    munmap(r->base, r->size);
+    free(r);
+}
+
+// Pins slot i if it still holds frame `seq`. Returns 1 on success, 0 otherwise.
+static int pin_slot(FFShmReader* r, uint32_t i, uint64_t seq, FFShmFrame* out) {
+    FFShmSlot* s = &r->slots[i];
+    atomic_fetch_add(&s->readers, 1);
+    if (atomic_load(&s->seq) != seq) {
+        atomic_fetch_sub(&s->readers, 1);
+        return 0;
+    }
+
+    out->data        = r->base + r->hdr->data_offset + (size_t)i * r->hdr->slot_data_bytes;
+    out->width       = s->width;
+    out->height      = s->height;
+    out->stride      = s->stride;
+    out->format      = s->format;
+    out->pts         = s->pts;
+    out->frame_index = s->frame_index;
+    out->publish_ns  = s->publish_ns;
+    out->seq         = seq;
+    out->slot        = (int)i;
+    return 1;
+}
+
+int ff_shm_reader_pin(FFShmReader* r, int slot, uint64_t seq, FFShmFrame* out) {
+    if (!r || !out || slot < 0 || (uint32_t)slot >= r->hdr->slot_count || seq == 0 || (seq & 1)) return 0;
+    return pin_slot(r, (uint32_t)slot, seq, out);
+}
+
+// Pins the newest published frame if its seq > after_seq. Returns 1 on success, 0 otherwise.
+static int try_pin_latest(FFShmReader* r, uint64_t after_seq, FFShmFrame* out) {
+    for (int attempt = 0; attempt < 8; ++attempt) {
+        uint64_t seq = atomic_load(&r->hdr->latest_seq);
+        if (seq == 0 || seq <= after_seq) return 0;
+        uint32_t i = atomic_load(&r->hdr->latest_slot);
+        if (i >= r->hdr->slot_count) return 0;
+
+        // Slot and seq may have been read across a publish; then just try again.
+        if (pin_slot(r, i, seq, out)) return 1;
+    }
+    return 0;
+}
+
+static void wait_publish(FFShmReader* r, uint32_t seen, int64_t timeout_ns) {
+#ifdef __linux__
+    struct timespec ts, *tsp = NULL;
+    if (timeout_ns >= 0) {
+        ts.tv_sec  = (time_t)(timeout_ns / 1000000000LL);
+        ts.tv_nsec = (long)(timeout_ns % 1000000000LL);
+        tsp = &ts;
+    }
+    syscall(SYS_futex, (uint32_t*)&r->hdr->publish_count, FUTEX_WAIT, seen, tsp, NULL, 0);
+#else
+    // No cross-process futex here: poll at a fine interval.
+    (void)seen;
+    int64_t step = 100000;
+    if (timeout_ns >= 0 && timeout_ns < step) step = timeout_ns;
+    struct timespec ts = { 0, (long)step };
+    nanosleep(&ts, NULL);
+#endif
+}
+
+int ff_shm_reader_acquire(FFShmReader* r, uint64_t after_seq, int timeout_ms, FFShmFrame* out) {
+    if (!r || !out) return -1;
+    uint64_t t0 = ff_shm_now_ns();
+    int64_t timeout_ns = timeout_ms < 0 ? -1 : (int64_t)timeout_ms * 1000000LL;
+
+    for (;;) {
+        // Read the wake counter first so a publish between the check and the wait is not lost.
+        uint32_t seen = atomic_load(&r->hdr->publish_count);
+        if (try_pin_latest(r, after_seq, out)) return 1;
+        if (!atomic_load(&r->hdr->writer_alive)) return -1;
+
+        int64_t left = -1;
+        if (timeout_ns >= 0) {
+            left = timeout_ns - (int64_t)(ff_shm_now_ns() - t0);
+            if (left <= 0) return 0;
+        }
+        wait_publish(r, seen, left);
+    }
+}
+
+int ff_shm_reader_release(FFShmReader* r, FFShmFrame* f) {
+    if (!r || !f || f->slot < 0 || (uint32_t)f->slot >= r->hdr->slot_count) return -1;
+    FFShmSlot* s = &r->slots[f->slot];
+    int intact = atomic_load(&s->seq) == f->seq;
+    atomic_fetch_sub(&s->readers, 1);
+    f->data = NULL;
+    f->slot = -1;
+    return intact ? 0 : -1;
+}
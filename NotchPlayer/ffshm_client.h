@@ -0,0 +1,44 @@
+#pragma once
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Reader side of a NotchPlayer shared-memory frame ring. Standalone: link only
+// ffshm_client.c. Frames are read in place from the writer's memory.
+typedef struct FFShmReader FFShmReader;
+
+typedef struct FFShmFrame {
+    const uint8_t* data;        // first pixel row, valid until ff_shm_reader_release
+    int            width, height, stride;
+    uint32_t       format;      // FFPixelFormat (0 = BGRA)
+    double         pts;
+    int64_t        frame_index;
+    uint64_t       seq;         // publish sequence, strictly increasing
+    uint64_t       publish_ns;  // writer's CLOCK_MONOTONIC at publish
+    int            slot;
+} FFShmFrame;
+
+FFShmReader* ff_shm_reader_open(const char* name);
+void         ff_shm_reader_close(FFShmReader* r);
+
+// Pins the newest frame with seq > after_seq, waiting up to timeout_ms
+// (<0 forever, 0 = don't wait). Returns 1 with *out filled, 0 on timeout,
+// -1 if the writer has gone away.
+int          ff_shm_reader_acquire(FFShmReader* r, uint64_t after_seq, int timeout_ms, FFShmFrame* out);
+
+// Pins a specific frame announced out of band (slot + seq, e.g. by the frame
+// server). Returns 1 with *out filled, 0 if that frame is no longer in the slot.
+int          ff_shm_reader_pin(FFShmReader* r, int slot, uint64_t seq, FFShmFrame* out);
+
+// Unpins. Returns 0, or -1 if the writer reclaimed the slot while it was held
+// (the pixels read may then be torn).
+int          ff_shm_reader_release(FFShmReader* r, FFShmFrame* f);
+
+// CLOCK_MONOTONIC in ns, same clock as FFShmFrame.publish_ns.
+uint64_t     ff_shm_now_ns(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,50 @@
+#pragma once
+// Memory layout of a NotchPlayer shared-memory frame ring. Shared by the writer
+// (ffshm.c) and the reader client (ffshm_client.c); C only, not a public header.
+//
+//   [FFShmHeader][FFShmSlot x slot_count] ... page aligned ... [slot 0 pixels][slot 1 pixels]...
+//
+// Slot protocol (lock-free, no cross-process mutexes):
+//  - slot.seq is even when the slot is stable (0 = never written) and odd while
+//    the writer fills it. Published frames get strictly increasing even seqs.
+//  - Readers pin a slot by incrementing slot.readers, then re-check slot.seq.
+//    The writer marks a slot odd first and then checks readers, backing off if
+//    pinned. With sequentially consistent atomics one of the two always sees
+//    the other, so a pinned slot is never overwritten while a reader holds it
+//    (unless the writer reclaims it after pin_timeout; the reader sees that as
+//    a changed seq on release).
+#include <stdatomic.h>
+#include <stdint.h>
+
+#define FF_SHM_MAGIC   0x524c504eu   // "NPLR"
+#define FF_SHM_VERSION 1
+
+typedef struct FFShmHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t slot_count;
+    uint32_t slots_offset;          // bytes from the start of the mapping to slot headers
+    uint64_t data_offset;           // bytes from the start of the mapping to slot 0 pixels
+    uint64_t slot_data_bytes;       // pixel capacity per slot (page multiple)
+    uint64_t total_bytes;           // size of the whole mapping
+
+    _Atomic uint64_t latest_seq;    // seq of the newest published frame, 0 if none
+    _Atomic uint32_t latest_slot;
+    _Atomic uint32_t publish_count; // bumped on every publish; futex word on Linux
+    _Atomic uint32_t writer_alive;  // 0 once the writer has shut down
+    uint32_t         reserved[7];
+} FFShmHeader;
+
+typedef struct FFShmSlot {
+    _Atomic uint64_t seq;
+    _Atomic uint32_t readers;
+    uint32_t format;        // FFPixelFormat
+    int32_t  width;
+    int32_t  height;
+    int32_t  stride;
+    uint32_t reserved0;
+    double   pts;           // seconds, NaN if unknown
+    int64_t  frame_index;
+    uint64_t publish_ns;    // CLOCK_MONOTONIC at publish, for latency measurement
+    uint64_t reserved[2];
+} FFShmSlot;
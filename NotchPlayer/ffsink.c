@@ -0,0 +1,72 @@
+#include "ffsink.h"
+#include "ffpool.h"
+#include <stdlib.h>
+#include <string.h>
+
+// ---- Memory sink ----
+
+static int mem_acquire(FFFrameSink* s, int width, int height, FFPixelFormat fmt, FFSinkImage* img) {
+    (void)s;
+    FFFrameRef* f = ff_frame_alloc(width, height, fmt);
+    if (!f) return -1;
+
+    memset(img, 0, sizeof(*img));
+    img->data[0]     = ff_frame_plane(f, 0);
+    img->linesize[0] = ff_frame_stride(f, 0);
+    img->width       = width;
+    img->height      = height;
+    img->format      = fmt;
+    img->priv        = f;
+    return 0;
+}
+
+static FFFrameRef* mem_commit(FFFrameSink* s, FFSinkImage* img, double pts, int64_t index) {
+    (void)s;
+    FFFrameRef* f = img->priv;
+    ff_frame_set_timing(f, pts, index);
+    img->priv = NULL;
+    return f;
+}
+
+static void mem_discard(FFFrameSink* s, FFSinkImage* img) {
+    (void)s;
+    ff_frame_release(img->priv);
+    img->priv = NULL;
+}
+
+static void mem_destroy(FFFrameSink* s) {
+    free(s);
+}
+
+FFFrameSink* ff_sink_memory_create(void) {
+    FFFrameSink* s = calloc(1, sizeof(*s));
+    if (!s) return NULL;
+    s->name    = "memory";
+    s->acquire = mem_acquire;
+    s->commit  = mem_commit;
+    s->discard = mem_discard;
+    s->destroy = mem_destroy;
+    return s;
+}
+
+// ---- Generic helpers ----
+
+FFFrameSink* ff_sink_default_create(void) {
+#ifdef __APPLE__
+    return ff_sink_corevideo_pool_create(NULL);
+#else
+    FFFramePool* pool = ff_pool_create(NULL);
+    if (!pool) return NULL;
+    FFFrameSink* s = ff_sink_pool_create(pool);
+    ff_pool_destroy(pool);   // the sink keeps its own reference
+    return s;
+#endif
+}
+
+int ff_sink_is_corevideo(const FFFrameSink* s) {
+    return s && s->name && strncmp(s->name, "corevideo", 9) == 0;
+}
+
+void ff_sink_destroy(FFFrameSink* s) {
+    if (s && s->destroy) s->destroy(s);
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include "ffframe.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// A writable destination handed out by a sink for exactly one frame.
+typedef struct FFSinkImage {
+    uint8_t*      data[4];
+    int           linesize[4];
+    int           width, height;
+    FFPixelFormat format;
+    void*         priv;       // sink-private state for this image
+} FFSinkImage;
+
+typedef struct FFFrameSink FFFrameSink;
+struct FFFramePoolStats;
+
+// Where converted frames go. The decoder asks the sink for a destination,
+// converts straight into it, then commits it as a refcounted FFFrameRef whose
+// memory belongs to the sink's backing store (heap, CVPixelBuffer, ...).
+struct FFFrameSink {
+    const char* name;
+    void*       opaque;
+
+    // Provide a width x height destination in `fmt`. Returns 0, or <0 on failure.
+    int         (*acquire)(FFFrameSink* s, int width, int height, FFPixelFormat fmt, FFSinkImage* img);
+    // Image is fully written. Returns a frame with one reference (caller owns it), or NULL.
+    FFFrameRef* (*commit)(FFFrameSink* s, FFSinkImage* img, double pts, int64_t index);
+    // Abandon an acquired image without producing output.
+    void        (*discard)(FFFrameSink* s, FFSinkImage* img);
+    // Optional: usage of the sink's buffer pool (see ffpool.h). NULL if unpooled.
+    int         (*pool_stats)(FFFrameSink* s, struct FFFramePoolStats* out);
+    // Free the sink itself. Frames it produced stay valid.
+    void        (*destroy)(FFFrameSink* s);
+};
+
+// Headless sink: frames land in 64-byte aligned heap buffers.
+FFFrameSink* ff_sink_memory_create(void);
+
+#ifdef __APPLE__
+// CoreVideo sink: frames are backed by kCVPixelFormatType_32BGRA CVPixelBuffers,
+// available through ff_frame_native() and kept read-locked while referenced.
+FFFrameSink* ff_sink_corevideo_create(void);
+#endif
+
+// Platform default: a bounded pool of FF_POOL_DEFAULT_BUFFERS buffers, backed by
+// a CVPixelBufferPool on Apple and by an FFFramePool elsewhere.
+FFFrameSink* ff_sink_default_create(void);
+
+// Returns 1 if `s` produces CVPixelBuffer-backed frames (plain or pooled).
+int  ff_sink_is_corevideo(const FFFrameSink* s);
+
+void ff_sink_destroy(FFFrameSink* s);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,327 @@
+// CoreVideo adapter for FFFrameSink. Apple only; compiles to nothing elsewhere.
+#ifdef __APPLE__
+#include "ffsink.h"
+#include "ffgovernor.h"
+#include "ffpool.h"
+#include "ffutil.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <CoreFoundation/CoreFoundation.h>
+#include <CoreVideo/CoreVideo.h>
+
+// Bytes of CoreVideo buffers held by images and frames of every sink, as one
+// governor output client registered by the first sink. Buffers idle in a
+// CVPixelBufferPool are not counted: CoreVideo ages them out on its own.
+static atomic_size_t g_cv_bytes;
+static pthread_once_t g_gov_once = PTHREAD_ONCE_INIT;
+
+static size_t gov_usage(void* opaque, size_t* wanted) {
+    (void)wanted;
+    return atomic_load((atomic_size_t*)opaque);
+}
+
+static void gov_register(void) {
+    FFGovClientConfig gc = { .name = "corevideo buffers", .kind = FF_GOV_OUTPUT,
+                             .opaque = &g_cv_bytes, .usage = gov_usage };
+    ff_governor_register(&gc);
+}
+
+static void held_add(CVPixelBufferRef pb) {
+    atomic_fetch_add(&g_cv_bytes, CVPixelBufferGetDataSize(pb));
+    ff_governor_notify();
+}
+
+static void held_sub(CVPixelBufferRef pb) {
+    atomic_fetch_sub(&g_cv_bytes, CVPixelBufferGetDataSize(pb));
+}
+
+static int cv_acquire(FFFrameSink* s, int width, int height, FFPixelFormat fmt, FFSinkImage* img) {
+    (void)s;
+    if (fmt != FF_PIXFMT_BGRA) return -1;
+
+    CVPixelBufferRef pb = NULL;
+    if (CVPixelBufferCreate(kCFAllocatorDefault,
+                            width, height,
+                            kCVPixelFormatType_32BGRA,
+                            NULL, &pb) != kCVReturnSuccess) {
+        return -1;
+    }
+    held_add(pb);
+
+    CVPixelBufferLockBaseAddress(pb, 0);
+
+    memset(img, 0, sizeof(*img));
+    img->data[0]     = (uint8_t*)CVPixelBufferGetBaseAddress(pb);
+    img->linesize[0] = (int)CVPixelBufferGetBytesPerRow(pb);
+    img->width       = width;
+    img->height      = height;
+    img->format      = fmt;
+    img->priv        = pb;
+    return 0;
+}
+
+static void cv_frame_free(void* opaque) {
+    CVPixelBufferRef pb = opaque;
+    CVPixelBufferUnlockBaseAddress(pb, kCVPixelBufferLock_ReadOnly);
+    held_sub(pb);
+    CVPixelBufferRelease(pb);
+}
+
+static FFFrameRef* cv_commit(FFFrameSink* s, FFSinkImage* img, double pts, int64_t index) {
+    (void)s;
+    CVPixelBufferRef pb = img->priv;
+    img->priv = NULL;
+
+    // Writing is done; hold a read-only lock for as long as the frame is referenced
+    // so plane pointers stay valid for every consumer.
+    CVPixelBufferUnlockBaseAddress(pb, 0);
+    CVPixelBufferLockBaseAddress(pb, kCVPixelBufferLock_ReadOnly);
+
+    FFFrameDesc d;
+    memset(&d, 0, sizeof(d));
+    d.data[0]     = (uint8_t*)CVPixelBufferGetBaseAddress(pb);
+    d.linesize[0] = (int)CVPixelBufferGetBytesPerRow(pb);
+    d.width       = img->width;
+    d.height      = img->height;
+    d.format      = img->format;
+    d.pts         = pts;
+    d.index       = index;
+    d.native      = pb;
+    d.free        = cv_frame_free;
+    d.opaque      = pb;
+
+    FFFrameRef* f = ff_frame_wrap(&d);
+    if (!f) cv_frame_free(pb);
+    return f;
+}
+
+static void cv_discard(FFFrameSink* s, FFSinkImage* img) {
+    (void)s;
+    CVPixelBufferRef pb = img->priv;
+    if (!pb) return;
+    CVPixelBufferUnlockBaseAddress(pb, 0);
+    held_sub(pb);
+    CVPixelBufferRelease(pb);
+    img->priv = NULL;
+}
+
+static void cv_destroy(FFFrameSink* s) {
+    free(s);
+}
+
+// ---- CVPixelBufferPool adapter ----
+//
+// CoreVideo owns recycling; we cap it with an allocation threshold and, when
+// the cap is hit, sleep until the pool posts kCVPixelBufferPoolFreeBufferNotification
+// (a buffer came back). A long backstop timeout covers a missed notification.
+// CoreVideo does not expose its free list, so in-use figures count every buffer
+// the pool has created: an upper bound on what is actually held downstream.
+
+typedef struct CVPoolSink {
+    FFFramePoolConfig    cfg;
+    CVPixelBufferPoolRef pool;
+    CFDictionaryRef      aux;       // allocation threshold
+    int                  w, h;
+    pthread_mutex_t      lock;      // guards st, freed
+    pthread_cond_t       freed_cv;
+    uint64_t             freed;     // free-buffer notifications seen
+    FFFramePoolStats     st;
+} CVPoolSink;
+
+#define FREE_BACKSTOP_NS (50 * 1000000LL)
+
+// Posted on the thread that returned the buffer.
+static void cvpool_buffer_freed(CFNotificationCenterRef center, void* observer, CFNotificationName name,
+                                const void* object, CFDictionaryRef info) {
+    CVPoolSink* ps = observer;
+    pthread_mutex_lock(&ps->lock);
+    ps->freed++;
+    pthread_cond_broadcast(&ps->freed_cv);
+    pthread_mutex_unlock(&ps->lock);
+}
+
+static void cvpool_release(CVPoolSink* ps) {
+    if (!ps->pool) return;
+    CFNotificationCenterRemoveObserver(CFNotificationCenterGetLocalCenter(), ps,
+                                       kCVPixelBufferPoolFreeBufferNotification, ps->pool);
+    CVPixelBufferPoolRelease(ps->pool);
+    ps->pool = NULL;
+}
+
+static const CFStringRef kNotchPoolTag = CFSTR("NotchPlayerPooled");
+
+static CFDictionaryRef make_dict(const void** keys, const void** vals, CFIndex n) {
+    return CFDictionaryCreate(kCFAllocatorDefault, keys, vals, n,
+                              &kCFTypeDictionaryKeyCallBacks, &kCFTypeDictionaryValueCallBacks);
+}
+
+static int cvpool_setup(CVPoolSink* ps, int width, int height) {
+    if (ps->pool && ps->w == width && ps->h == height) return 0;
+    // Size changed: outstanding buffers keep the old pool alive until released.
+    cvpool_release(ps);
+
+    int32_t fmt = kCVPixelFormatType_32BGRA;
+    CFNumberRef nfmt = CFNumberCreate(NULL, kCFNumberSInt32Type, &fmt);
+    CFNumberRef nw   = CFNumberCreate(NULL, kCFNumberIntType, &width);
+    CFNumberRef nh   = CFNumberCreate(NULL, kCFNumberIntType, &height);
+    CFDictionaryRef iosurf = make_dict(NULL, NULL, 0);
+
+    const void* keys[] = { kCVPixelBufferPixelFormatTypeKey, kCVPixelBufferWidthKey,
+                           kCVPixelBufferHeightKey, kCVPixelBufferIOSurfacePropertiesKey };
+    const void* vals[] = { nfmt, nw, nh, iosurf };
+    CFDictionaryRef attrs = make_dict(keys, vals, 4);
+
+    CVReturn r = CVPixelBufferPoolCreate(kCFAllocatorDefault, NULL, attrs, &ps->pool);
+
+    CFRelease(attrs);
+    CFRelease(iosurf);
+    CFRelease(nh);
+    CFRelease(nw);
+    CFRelease(nfmt);
+    if (r != kCVReturnSuccess) { ps->pool = NULL; return -1; }
+    CFNotificationCenterAddObserver(CFNotificationCenterGetLocalCenter(), ps, cvpool_buffer_freed,
+                                    kCVPixelBufferPoolFreeBufferNotification, ps->pool,
+                                    CFNotificationSuspensionBehaviorDeliverImmediately);
+
+    ps->w = width;
+    ps->h = height;
+    return 0;
+}
+
+static int cvpool_acquire(FFFrameSink* s, int width, int height, FFPixelFormat fmt, FFSinkImage* img) {
+    CVPoolSink* ps = s->opaque;
+    if (fmt != FF_PIXFMT_BGRA) return -1;
+    if (cvpool_setup(ps, width, height) < 0) return -1;
+
+    int64_t t_start = 0;
+    int64_t timeout_ns = ps->cfg.wait_timeout_ms < 0 ? -1 : (int64_t)ps->cfg.wait_timeout_ms * 1000000LL;
+    CVPixelBufferRef pb = NULL;
+    CVReturn r;
+
+    pthread_mutex_lock(&ps->lock);
+    ps->st.acquires++;
+    pthread_mutex_unlock(&ps->lock);
+
+    for (;;) {
+        pthread_mutex_lock(&ps->lock);
+        uint64_t seen = ps->freed;
+        pthread_mutex_unlock(&ps->lock);
+        r = CVPixelBufferPoolCreatePixelBufferWithAuxAttributes(kCFAllocatorDefault, ps->pool, ps->aux, &pb);
+        if (r != kCVReturnWouldExceedAllocationThreshold) break;
+
+        int64_t now = ff_now_ns();
+        if (!t_start) t_start = now;
+        int64_t left = timeout_ns < 0 ? FREE_BACKSTOP_NS : timeout_ns - (now - t_start);
+        if (left <= 0) break;
+        if (left > FREE_BACKSTOP_NS) left = FREE_BACKSTOP_NS;
+        pthread_mutex_lock(&ps->lock);
+        if (ps->freed == seen) ff_cond_wait_ns(&ps->freed_cv, &ps->lock, left);
+        pthread_mutex_unlock(&ps->lock);
+    }
+
+    pthread_mutex_lock(&ps->lock);
+    if (t_start) {
+        uint64_t waited = (uint64_t)(ff_now_ns() - t_start);
+        ps->st.waits++;
+        ps->st.wait_ns_total += waited;
+        if (waited > ps->st.wait_ns_max) ps->st.wait_ns_max = waited;
+    }
+    if (r != kCVReturnSuccess || !pb) {
+        if (r == kCVReturnWouldExceedAllocationThreshold) ps->st.timeouts++;
+        pthread_mutex_unlock(&ps->lock);
+        return -1;
+    }
+
+    // Tag buffers the first time we see them to tell fresh allocations from reuse.
+    if (CVBufferGetAttachment(pb, kNotchPoolTag, NULL)) {
+        ps->st.reuses++;
+    } else {
+        CVBufferSetAttachment(pb, kNotchPoolTag, kCFBooleanTrue, kCVAttachmentMode_ShouldNotPropagate);
+        size_t bytes = CVPixelBufferGetDataSize(pb);
+        ps->st.allocs++;
+        ps->st.in_use_buffers++;
+        ps->st.allocated_bytes += bytes;
+        ps->st.in_use_bytes    += bytes;
+        if (ps->st.in_use_bytes > ps->st.high_water_bytes) ps->st.high_water_bytes = ps->st.in_use_bytes;
+    }
+    pthread_mutex_unlock(&ps->lock);
+    held_add(pb);
+
+    CVPixelBufferLockBaseAddress(pb, 0);
+
+    memset(img, 0, sizeof(*img));
+    img->data[0]     = (uint8_t*)CVPixelBufferGetBaseAddress(pb);
+    img->linesize[0] = (int)CVPixelBufferGetBytesPerRow(pb);
+    img->width       = width;
+    img->height      = height;
+    img->format      = fmt;
+    img->priv        = pb;
+    return 0;
+}
+
+static int cvpool_stats(FFFrameSink* s, FFFramePoolStats* out) {
+    CVPoolSink* ps = s->opaque;
+    pthread_mutex_lock(&ps->lock);
+    *out = ps->st;
+    pthread_mutex_unlock(&ps->lock);
+    return 0;
+}
+
+static void cvpool_destroy(FFFrameSink* s) {
+    CVPoolSink* ps = s->opaque;
+    cvpool_release(ps);
+    if (ps->aux) CFRelease(ps->aux);
+    pthread_mutex_destroy(&ps->lock);
+    pthread_cond_destroy(&ps->freed_cv);
+    free(ps);
+    free(s);
+}
+
+FFFrameSink* ff_sink_corevideo_pool_create(const FFFramePoolConfig* cfg) {
+    FFFrameSink* s = calloc(1, sizeof(*s));
+    CVPoolSink* ps = calloc(1, sizeof(*ps));
+    if (!s || !ps) { free(s); free(ps); return NULL; }
+    pthread_once(&g_gov_once, gov_register);
+
+    if (cfg) {
+        ps->cfg = *cfg;
+    } else {
+        ps->cfg.max_buffers     = FF_POOL_DEFAULT_BUFFERS;
+        ps->cfg.wait_timeout_ms = FF_POOL_DEFAULT_TIMEOUT_MS;
+    }
+    if (ps->cfg.max_buffers > 0) {
+        int threshold = ps->cfg.max_buffers;
+        CFNumberRef n = CFNumberCreate(NULL, kCFNumberIntType, &threshold);
+        const void* keys[] = { kCVPixelBufferPoolAllocationThresholdKey };
+        const void* vals[] = { n };
+        ps->aux = make_dict(keys, vals, 1);
+        CFRelease(n);
+    }
+    pthread_mutex_init(&ps->lock, NULL);
+    ff_cond_init(&ps->freed_cv);
+    ps->st.capacity_bytes = ps->cfg.capacity_bytes;
+
+    s->name       = "corevideo-pool";
+    s->opaque     = ps;
+    s->acquire    = cvpool_acquire;
+    s->commit     = cv_commit;
+    s->discard    = cv_discard;
+    s->pool_stats = cvpool_stats;
+    s->destroy    = cvpool_destroy;
+    return s;
+}
+
+FFFrameSink* ff_sink_corevideo_create(void) {
+    FFFrameSink* s = calloc(1, sizeof(*s));
+    if (!s) return NULL;
+    pthread_once(&g_gov_once, gov_register);
+    s->name    = "corevideo";
+    s->acquire = cv_acquire;
+    s->commit  = cv_commit;
+    s->discard = cv_discard;
+    s->destroy = cv_destroy;
+    return s;
+}
+#endif
@@ -0,0 +1,461 @@
+#include "ffsync.h"
+#include "ffutil.h"
+#include <arpa/inet.h>
+#include <errno.h>
+#include <math.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// Wire format, big-endian:
+//   u32 magic, u16 version, u16 flags, u32 session, u32 seq, u32 start,
+//   i64 clock ns, f64 media time, f64 frame interval
+// `start` is drawn at random by every master start: a restarted master's
+// sequence begins again at 1, and followers must not take it for stale.
+#define SYNC_MAGIC   0x4E53594EU   // "NSYN"
+#define SYNC_VERSION 2
+#define SYNC_PLAYING 1
+#define SYNC_BYTES   44
+
+#define OFFSET_WINDOW 64           // clock-offset samples: ~1.3 s at the default rate
+#define LOCK_TIMEOUT_NS 1000000000LL
+#define PAUSED_PERIOD_NS 250000000LL
+
+typedef struct SyncPacket {
+    uint16_t flags;
+    uint32_t session, seq, start;
+    int64_t  clock_ns;
+    double   media, interval;
+} SyncPacket;
+
+static void put_u64(uint8_t* p, uint64_t v) {
+    for (int i = 7; i >= 0; --i, v >>= 8) p[i] = (uint8_t)v;
+}
+
+static uint64_t get_u64(const uint8_t* p) {
+    uint64_t v = 0;
+    for (int i = 0; i < 8; ++i) v = v << 8 | p[i];
+    return v;
+}
+
+static void put_u32(uint8_t* p, uint32_t v) {
+    for (int i = 3; i >= 0; --i, v >>= 8) p[i] = (uint8_t)v;
+}
+
+static uint32_t get_u32(const uint8_t* p) {
+    return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3];
+}
+
+static uint64_t f64_bits(double d) {
+    uint64_t u;
+    memcpy(&u, &d, sizeof(u));
+    return u;
+}
+
+static double bits_f64(uint64_t u) {
+    double d;
+    memcpy(&d, &u, sizeof(d));
+    return d;
+}
+
+static void encode(const SyncPacket* pk, uint8_t* b) {
+    put_u32(b, SYNC_MAGIC);
+    b[4] = SYNC_VERSION >> 8;
+    b[5] = SYNC_VERSION & 0xFF;
+    b[6] = (uint8_t)(pk->flags >> 8);
+    b[7] = (uint8_t)pk->flags;
+    put_u32(b + 8, pk->session);
+    put_u32(b + 12, pk->seq);
+    put_u32(b + 16, pk->start);
+    put_u64(b + 20, (uint64_t)pk->clock_ns);
+    put_u64(b + 28, f64_bits(pk->media));
+    put_u64(b + 36, f64_bits(pk->interval));
+}
+
+static int decode(const uint8_t* b, ssize_t n, SyncPacket* pk) {
+    if (n < SYNC_BYTES || get_u32(b) != SYNC_MAGIC || (b[4] << 8 | b[5]) != SYNC_VERSION) return -1;
+    pk->flags    = (uint16_t)(b[6] << 8 | b[7]);
+    pk->session  = get_u32(b + 8);
+    pk->seq      = get_u32(b + 12);
+    pk->start    = get_u32(b + 16);
+    pk->clock_ns = (int64_t)get_u64(b + 20);
+    pk->media    = bits_f64(get_u64(b + 28));
+    pk->interval = bits_f64(get_u64(b + 36));
+    return isfinite(pk->media) && pk->interval > 0 ? 0 : -1;
+}
+
+static FFClock sync_clock(const FFSyncConfig* cfg) {
+    return cfg->clock.now_ns ? cfg->clock : ff_clock_host();
+}
+
+static int resolve(const FFSyncConfig* cfg, struct sockaddr_in* group, struct in_addr* iface) {
+    memset(group, 0, sizeof(*group));
+    group->sin_family = AF_INET;
+    group->sin_port   = htons((uint16_t)(cfg->port ? cfg->port : FF_SYNC_DEFAULT_PORT));
+    if (inet_pton(AF_INET, cfg->group ? cfg->group : FF_SYNC_DEFAULT_GROUP, &group->sin_addr) != 1) return -1;
+    iface->s_addr = htonl(INADDR_ANY);
+    if (cfg->interface && inet_pton(AF_INET, cfg->interface, iface) != 1) return -1;
+    return 0;
+}
+
+static int is_multicast(const struct sockaddr_in* a) {
+    return IN_MULTICAST(ntohl(a->sin_addr.s_addr));
+}
+
+// ---- Master ----
+
+// Different for every start, even two in the same process and nanosecond;
+// never 0, which followers take for none.
+static uint32_t start_nonce(const void* salt) {
+    uint64_t x = (uint64_t)ff_now_ns() ^ (uint64_t)getpid() << 32 ^ (uintptr_t)salt;
+    x ^= x >> 33;
+    x *= 0xFF51AFD7ED558CCDULL;
+    x ^= x >> 33;
+    x *= 0xC4CEB9FE1A85EC53ULL;
+    x ^= x >> 33;
+    return (uint32_t)x | 1;
+}
+
+struct FFSyncMaster {
+    FFSyncConfig       cfg;
+    FFClock            clock;
+    FFSched*           sched;
+    int                fd;
+    struct sockaddr_in dest;
+    pthread_mutex_t    lock;
+    pthread_cond_t     cv;         // kick or stopping
+    pthread_t          thread;
+    int                stopping, kicked;
+    uint32_t           start;      // this start's nonce
+    uint32_t           seq;
+    uint64_t           sent;
+};
+
+// Returns 1 if the packet went out.
+static int master_send(FFSyncMaster* m) {
+    int64_t now = m->clock.now_ns(m->clock.opaque);
+    SyncPacket pk = {
+        .flags    = ff_sched_is_playing(m->sched) ? SYNC_PLAYING : 0,
+        .session  = m->cfg.session,
+        .seq      = ++m->seq,
+        .start    = m->start,
+        .clock_ns = now,
+        .media    = ff_sched_time_at(m->sched, now),
+        .interval = ff_sched_frame_interval(m->sched),
+    };
+    uint8_t b[SYNC_BYTES];
+    encode(&pk, b);
+    return sendto(m->fd, b, sizeof(b), 0, (const struct sockaddr*)&m->dest, sizeof(m->dest)) == (ssize_t)sizeof(b);
+}
+
+static void* master_main(void* arg) {
+    FFSyncMaster* m = arg;
+    int64_t period = (int64_t)m->cfg.interval_ms * 1000000;
+    pthread_mutex_lock(&m->lock);
+    while (!m->stopping) {
+        m->kicked = 0;
+        pthread_mutex_unlock(&m->lock);
+        int ok = master_send(m);
+        // Paused, the state changes only with a kick: a slow keep-alive will do.
+        int64_t wait = ff_sched_is_playing(m->sched) ? period : PAUSED_PERIOD_NS;
+        pthread_mutex_lock(&m->lock);
+        m->sent += ok;
+        int64_t deadline = ff_now_ns() + wait;
+        int64_t left;
+        while (!m->stopping && !m->kicked && (left = deadline - ff_now_ns()) > 0)
+            ff_cond_wait_ns(&m->cv, &m->lock, left);
+    }
+    pthread_mutex_unlock(&m->lock);
+    return NULL;
+}
+
+FFSyncMaster* ff_sync_master_create(const FFSyncConfig* cfg, FFSched* s) {
+    if (!cfg || !s) return NULL;
+    FFSyncMaster* m = calloc(1, sizeof(*m));
+    if (!m) return NULL;
+    m->cfg   = *cfg;
+    m->clock = sync_clock(cfg);
+    m->sched = s;
+    m->fd    = -1;
+    m->start = start_nonce(m);
+    if (m->cfg.interval_ms <= 0) m->cfg.interval_ms = FF_SYNC_DEFAULT_INTERVAL_MS;
+    struct in_addr iface;
+    if (resolve(cfg, &m->dest, &iface) < 0) goto fail;
+    m->cfg.group = m->cfg.interface = NULL;   // not kept
+
+    m->fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (m->fd < 0) goto fail;
+    int one = 1;
+    setsockopt(m->fd, SOL_SOCKET, SO_BROADCAST, &one, sizeof(one));
+    if (is_multicast(&m->dest)) {
+        unsigned char loop = 1, ttl = 1;
+        setsockopt(m->fd, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop));   // followers on this host
+        setsockopt(m->fd, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl));
+        if (iface.s_addr != htonl(INADDR_ANY) &&
+            setsockopt(m->fd, IPPROTO_IP, IP_MULTICAST_IF, &iface, sizeof(iface)) < 0)
+            goto fail;
+    }
+
+    pthread_mutex_init(&m->lock, NULL);
+    ff_cond_init(&m->cv);
+    if (pthread_create(&m->thread, NULL, master_main, m) != 0) {
+        pthread_mutex_destroy(&m->lock);
+        pthread_cond_destroy(&m->cv);
+        goto fail;
+    }
+    return m;
+
+fail:
+    if (m->fd >= 0) close(m->fd);
+    free(m);
+    return NULL;
+}
+
+void ff_sync_master_destroy(FFSyncMaster* m) {
+    if (!m) return;
+    pthread_mutex_lock(&m->lock);
+    m->stopping = 1;
+    pthread_cond_broadcast(&m->cv);
+    pthread_mutex_unlock(&m->lock);
+    pthread_join(m->thread, NULL);
+    close(m->fd);
+    pthread_mutex_destroy(&m->lock);
+    pthread_cond_destroy(&m->cv);
+    free(m);
+}
+
+void ff_sync_master_kick(FFSyncMaster* m) {
+    if (!m) return;
+    pthread_mutex_lock(&m->lock);
+    m->kicked = 1;
+    pthread_cond_broadcast(&m->cv);
+    pthread_mutex_unlock(&m->lock);
+}
+
+uint64_t ff_sync_master_sent(FFSyncMaster* m) {
+    if (!m) return 0;
+    pthread_mutex_lock(&m->lock);
+    uint64_t n = m->sent;
+    pthread_mutex_unlock(&m->lock);
+    return n;
+}
+
+// ---- Follower ----
+
+struct FFSyncFollower {
+    FFSyncConfig    cfg;
+    FFClock         clock;
+    FFSched*        sched;
+    int             fd;
+    int             wake[2];       // pipe: wakes the receiving thread to stop
+    pthread_t       thread;
+    pthread_mutex_t lock;
+
+    // Receiving thread only.
+    int64_t         samples[OFFSET_WINDOW];   // local receive minus master send time
+    int             nsamples, next_sample;
+    int             have_seq;
+    uint32_t        last_seq;
+    uint32_t        start, prev_start;   // master start nonces: current, the one before
+    uint64_t        abs_samples;   // in offset_ns_avg
+
+    // Under the lock.
+    int             have_master;
+    SyncPacket      master;        // latest packet
+    int64_t         clock_offset;
+    int64_t         last_rx;
+    FFSyncStats     stats;
+};
+
+// Master media time at local clock time `now`. Lock held.
+static double master_at(const FFSyncFollower* f, int64_t now) {
+    if (!(f->master.flags & SYNC_PLAYING)) return f->master.media;
+    return f->master.media + (now - (f->master.clock_ns + f->clock_offset)) / 1e9;
+}
+
+static void follower_packet(FFSyncFollower* f, const SyncPacket* pk, int64_t rx) {
+    // The smallest receive-minus-send in the window is the clock offset plus
+    // the quickest one-way delay; queueing delays only ever add to it.
+    f->samples[f->next_sample] = rx - pk->clock_ns;
+    f->next_sample = (f->next_sample + 1) % OFFSET_WINDOW;
+    if (f->nsamples < OFFSET_WINDOW) f->nsamples++;
+    int64_t offset = f->samples[0];
+    for (int i = 1; i < f->nsamples; ++i)
+        if (f->samples[i] < offset) offset = f->samples[i];
+
+    pthread_mutex_lock(&f->lock);
+    f->have_master  = 1;
+    f->master       = *pk;
+    f->clock_offset = offset;
+    f->last_rx      = rx;
+    f->stats.packets++;
+    f->stats.clock_offset_ns = offset;
+    f->stats.master_playing  = (pk->flags & SYNC_PLAYING) != 0;
+    int64_t now   = f->clock.now_ns(f->clock.opaque);
+    double target = master_at(f, now);
+    pthread_mutex_unlock(&f->lock);
+
+    FFSched* s = f->sched;
+    int playing = (pk->flags & SYNC_PLAYING) != 0;
+    if (!playing && ff_sched_is_playing(s)) ff_sched_pause(s);
+    if (playing && !ff_sched_is_playing(s)) {
+        ff_sched_seek(s, target);
+        ff_sched_play(s);
+    }
+    double err = ff_sched_time_at(s, now) - target;
+    int jumped = fabs(err) > f->cfg.threshold * pk->interval;
+    if (jumped || (!playing && err != 0)) {
+        // Paused, any difference can show another frame: match exactly.
+        ff_sched_seek(s, target);
+    } else if (playing) {
+        double c = -err * f->cfg.gain;
+        if (c > f->cfg.max_slew) c = f->cfg.max_slew;
+        if (c < -f->cfg.max_slew) c = -f->cfg.max_slew;
+        ff_sched_slew(s, c);
+    }
+
+    pthread_mutex_lock(&f->lock);
+    int64_t e = llround(err * 1e9);
+    f->stats.offset_ns_last = e;
+    f->stats.offset_frames  = err / pk->interval;
+    if (jumped) {
+        if (err > 0) f->stats.holds++;
+        else f->stats.skips++;
+        f->stats.offset_ns_max = 0;
+        f->stats.offset_ns_avg = 0;
+        f->abs_samples = 0;
+    } else {
+        int64_t a = e < 0 ? -e : e;
+        if (playing) f->stats.slews++;
+        if (a > f->stats.offset_ns_max) f->stats.offset_ns_max = a;
+        f->abs_samples++;
+        f->stats.offset_ns_avg += (a - f->stats.offset_ns_avg) / (double)f->abs_samples;
+    }
+    pthread_mutex_unlock(&f->lock);
+    if (jumped && f->cfg.jumped) f->cfg.jumped(f->cfg.opaque, target);
+}
+
+static void* follower_main(void* arg) {
+    FFSyncFollower* f = arg;
+    struct pollfd pfd[2] = { { f->fd, POLLIN, 0 }, { f->wake[0], POLLIN, 0 } };
+    uint8_t b[256];
+    for (;;) {
+        if (poll(pfd, 2, -1) < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        if (pfd[1].revents) break;
+        if (!(pfd[0].revents & POLLIN)) continue;
+        ssize_t n = recv(f->fd, b, sizeof(b), 0);
+        int64_t rx = f->clock.now_ns(f->clock.opaque);
+        SyncPacket pk;
+        if (n < 0 || decode(b, n, &pk) < 0) continue;
+        // Serial-number order, so the sequence may wrap. A new start nonce is
+        // a restarted master, perhaps on another host: its sequence and clock
+        // start over. Late packets of the master before it stay stale.
+        int restart = f->have_seq && pk.start != f->start;
+        if (pk.session != f->cfg.session || (f->have_seq && pk.start == f->prev_start) ||
+            (!restart && f->have_seq && (int32_t)(pk.seq - f->last_seq) <= 0)) {
+            pthread_mutex_lock(&f->lock);
+            f->stats.stale++;
+            pthread_mutex_unlock(&f->lock);
+            continue;
+        }
+        if (restart) {
+            f->prev_start  = f->start;
+            f->nsamples    = 0;
+            f->next_sample = 0;
+            pthread_mutex_lock(&f->lock);
+            f->stats.restarts++;
+            pthread_mutex_unlock(&f->lock);
+        }
+        f->have_seq = 1;
+        f->start    = pk.start;
+        f->last_seq = pk.seq;
+        follower_packet(f, &pk, rx);
+    }
+    return NULL;
+}
+
+FFSyncFollower* ff_sync_follower_create(const FFSyncConfig* cfg, FFSched* s) {
+    if (!cfg || !s || cfg->threshold < 0 || cfg->gain < 0 || cfg->gain > 1 || cfg->max_slew < 0) return NULL;
+    FFSyncFollower* f = calloc(1, sizeof(*f));
+    if (!f) return NULL;
+    f->cfg   = *cfg;
+    f->clock = sync_clock(cfg);
+    f->sched = s;
+    f->fd    = -1;
+    f->wake[0] = f->wake[1] = -1;
+    if (f->cfg.threshold == 0) f->cfg.threshold = 1;
+    if (f->cfg.gain == 0) f->cfg.gain = 0.2;
+    if (f->cfg.max_slew == 0) f->cfg.max_slew = 0.0005;
+
+    struct sockaddr_in group;
+    struct in_addr iface;
+    if (resolve(cfg, &group, &iface) < 0) goto fail;
+    f->cfg.group = f->cfg.interface = NULL;   // not kept
+
+    f->fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (f->fd < 0 || pipe(f->wake) < 0) goto fail;
+    int one = 1;
+    setsockopt(f->fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+#ifdef SO_REUSEPORT
+    setsockopt(f->fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one));   // several followers per host
+#endif
+    struct sockaddr_in bind_addr = group;
+    if (!is_multicast(&group)) bind_addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    if (bind(f->fd, (const struct sockaddr*)&bind_addr, sizeof(bind_addr)) < 0) goto fail;
+    if (is_multicast(&group)) {
+        struct ip_mreq mreq = { group.sin_addr, iface };
+        if (setsockopt(f->fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) < 0) goto fail;
+    }
+
+    pthread_mutex_init(&f->lock, NULL);
+    if (pthread_create(&f->thread, NULL, follower_main, f) != 0) {
+        pthread_mutex_destroy(&f->lock);
+        goto fail;
+    }
+    return f;
+
+fail:
+    if (f->fd >= 0) close(f->fd);
+    if (f->wake[0] >= 0) close(f->wake[0]);
+    if (f->wake[1] >= 0) close(f->wake[1]);
+    free(f);
+    return NULL;
+}
+
+void ff_sync_follower_destroy(FFSyncFollower* f) {
+    if (!f) return;
+    char c = 0;
+    while (write(f->wake[1], &c, 1) < 0 && errno == EINTR) {}
+    pthread_join(f->thread, NULL);
+    close(f->fd);
+    close(f->wake[0]);
+    close(f->wake[1]);
+    pthread_mutex_destroy(&f->lock);
+    free(f);
+}
+
+void ff_sync_follower_get_stats(FFSyncFollower* f, FFSyncStats* out) {
+    if (!f || !out) return;
+    int64_t now = f->clock.now_ns(f->clock.opaque);
+    pthread_mutex_lock(&f->lock);
+    *out = f->stats;
+    out->locked = f->have_master && now - f->last_rx < LOCK_TIMEOUT_NS;
+    pthread_mutex_unlock(&f->lock);
+}
+
+double ff_sync_follower_offset(FFSyncFollower* f) {
+    if (!f) return NAN;
+    int64_t now = f->clock.now_ns(f->clock.opaque);
+    pthread_mutex_lock(&f->lock);
+    double off = NAN;
+    if (f->have_master) off = (ff_sched_time_at(f->sched, now) - master_at(f, now)) / f->master.interval;
+    pthread_mutex_unlock(&f->lock);
+    return off;
+}
@@ -0,0 +1,87 @@
+#pragma once
+#include <stdint.h>
+#include "ffsched.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Playback sync between instances (processes or machines) over UDP. A master
+// broadcasts its media clock: position, play state and frame interval, with
+// the clock time it was sampled at. Each follower locks its own scheduler
+// (ffsched.h) to it. The follower estimates the offset between the master's
+// clock and its own from the fastest packets of the last second or so, which
+// also follows drift between the two clocks. From that it works out where the
+// master's timeline is now.
+//
+// Within `threshold` frames the follower nudges its media clock toward the
+// master by a fraction of the error per packet (ff_sched_slew). Playback
+// speed never changes. Beyond that, it jumps to the master's position: behind,
+// it skips frames (the scheduler drops the late ones); ahead, it holds the
+// current frame until the master catches up.
+//
+// Packets go to an IPv4 multicast group by default; a unicast or broadcast
+// address works too. Several followers on one host share the port.
+typedef struct FFSyncMaster FFSyncMaster;
+typedef struct FFSyncFollower FFSyncFollower;
+
+#define FF_SYNC_DEFAULT_GROUP       "239.255.42.99"
+#define FF_SYNC_DEFAULT_PORT        47474
+#define FF_SYNC_DEFAULT_INTERVAL_MS 20
+
+typedef struct FFSyncConfig {
+    const char* group;         // destination / group address; NULL = FF_SYNC_DEFAULT_GROUP
+    int         port;          // 0 = FF_SYNC_DEFAULT_PORT
+    const char* interface;     // IPv4 address of the interface to use; NULL = the default one
+    uint32_t    session;       // followers ignore packets of other sessions
+    FFClock     clock;         // the scheduler's clock; now_ns NULL = ff_clock_host()
+    // Master
+    int         interval_ms;   // send period; 0 = FF_SYNC_DEFAULT_INTERVAL_MS
+    // Follower
+    double      threshold;     // frames off before a skip/hold; 0 = 1
+    double      gain;          // share of the error corrected per packet; 0 = 0.2
+    double      max_slew;      // largest correction per packet, seconds; 0 = 0.5 ms
+    // Optional: called on the receiving thread after a skip/hold moved the
+    // media clock to `t`, e.g. to seek the decoder when the jump is long.
+    void      (*jumped)(void* opaque, double t);
+    void*       opaque;
+} FFSyncConfig;
+
+// Sends the state of `s` every interval while it plays, and four times a
+// second while paused, until destroyed. NULL if the socket cannot be set up.
+FFSyncMaster* ff_sync_master_create(const FFSyncConfig* cfg, FFSched* s);
+void          ff_sync_master_destroy(FFSyncMaster* m);
+// Sends at once: call after a seek, play or pause.
+void          ff_sync_master_kick(FFSyncMaster* m);
+uint64_t      ff_sync_master_sent(FFSyncMaster* m);
+
+typedef struct FFSyncStats {
+    uint64_t packets;          // accepted
+    uint64_t stale;            // out of order or from another session
+    uint64_t restarts;         // the master started again (its sequence starts over)
+    uint64_t slews;            // small corrections
+    uint64_t skips;            // jumps forward: the follower was behind
+    uint64_t holds;            // jumps back: the follower was ahead
+    int      locked;           // a packet arrived within the last second
+    int      master_playing;
+    // Follower minus master media time when each packet arrived, before
+    // correcting (positive = ahead). The max and mean are of absolute values
+    // over packets since the last skip/hold.
+    int64_t  offset_ns_last;
+    int64_t  offset_ns_max;
+    double   offset_ns_avg;
+    double   offset_frames;    // offset_ns_last in frames
+    int64_t  clock_offset_ns;  // estimated master-to-follower clock offset (includes one-way delay)
+} FFSyncStats;
+
+// Locks `s` to the master. NULL if the socket cannot be set up.
+FFSyncFollower* ff_sync_follower_create(const FFSyncConfig* cfg, FFSched* s);
+void            ff_sync_follower_destroy(FFSyncFollower* f);
+void            ff_sync_follower_get_stats(FFSyncFollower* f, FFSyncStats* out);
+// Current offset from the master in frames (positive = ahead), or NaN before
+// the first packet.
+double          ff_sync_follower_offset(FFSyncFollower* f);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,235 @@
+#include "fftransition.h"
+#include "ffconvert.h"
+#include "ffpool.h"
+#include "ffsink.h"
+#include "ffutil.h"
+#include <math.h>
+#include <stdlib.h>
+
+// One clip's side of a mixed frame.
+typedef struct Side {
+    FFPlayer*     p;
+    FFSourceImage src;
+    int64_t       index;
+    double        pts;
+    int           r;        // ff_next_source result
+    int           have;     // src decoded, not yet delivered
+} Side;
+
+struct FFTransition {
+    FFTransitionConfig cfg;
+    FFWorkers*         workers;
+    int                own_workers;
+    FFFrameSink*       sink;       // mixed frames
+    uint8_t*           scratch;    // ff_convert_blend row buffers, kept between frames
+    size_t             scratch_bytes;
+
+    FFPlayer*          live;       // outgoing while mixing
+    FFPlayer*          next;       // incoming; NULL outside a crossfade
+    int                frames;     // crossfade length
+    int                done;       // mixed frames so far
+    FFTransitionCurve  curve;
+    Side               side[2];    // outgoing, incoming
+
+    FFTransitionStats  stats;
+};
+
+double ff_transition_curve(FFTransitionCurve c, double x) {
+    x = x < 0 ? 0 : x > 1 ? 1 : x;
+    switch (c) {
+    case FF_CURVE_SMOOTH:   return x * x * (3 - 2 * x);
+    case FF_CURVE_EASE_IN:  return x * x;
+    case FF_CURVE_EASE_OUT: return 1 - (1 - x) * (1 - x);
+    default:                return x;
+    }
+}
+
+FFTransition* ff_transition_create(const FFTransitionConfig* cfg) {
+    FFTransition* t = calloc(1, sizeof(*t));
+    if (!t) return NULL;
+    if (cfg) t->cfg = *cfg;
+    t->workers = t->cfg.workers;
+    if (!t->workers) {
+        t->workers = ff_workers_create(0);
+        t->own_workers = 1;
+        if (!t->workers) goto fail;
+    }
+    FFFramePoolConfig pc = { .max_buffers = t->cfg.buffers > 0 ? t->cfg.buffers : FF_POOL_DEFAULT_BUFFERS,
+                             .wait_timeout_ms = FF_POOL_DEFAULT_TIMEOUT_MS,
+                             .mem_flags = t->cfg.mem_flags };
+    FFFramePool* pool = ff_pool_create(&pc);
+    t->sink = pool ? ff_sink_pool_create(pool) : NULL;
+    ff_pool_destroy(pool);
+    if (!t->sink) goto fail;
+    return t;
+
+fail:
+    ff_transition_destroy(t);
+    return NULL;
+}
+
+void ff_transition_destroy(FFTransition* t) {
+    if (!t) return;
+    ff_sink_destroy(t->sink);
+    free(t->scratch);
+    if (t->own_workers) ff_workers_destroy(t->workers);
+    free(t);
+}
+
+static void retire(FFTransition* t, FFPlayer* p) {
+    if (p && t->cfg.retired) t->cfg.retired(t->cfg.opaque, p);
+}
+
+// Ends a crossfade with `keep` live and the other clip retired.
+static void finish(FFTransition* t, FFPlayer* keep) {
+    FFPlayer* drop = keep == t->live ? t->next : t->live;
+    t->live = keep;
+    t->next = NULL;
+    t->side[0].have = t->side[1].have = 0;
+    retire(t, drop);
+}
+
+int ff_transition_cut(FFTransition* t, FFPlayer* p) {
+    if (!t || !p) return -1;
+    if (t->next) finish(t, t->live);
+    FFPlayer* old = t->live;
+    t->live = p;
+    if (old && old != p) {
+        t->stats.cuts++;
+        retire(t, old);
+    }
+    return 0;
+}
+
+int ff_transition_crossfade(FFTransition* t, FFPlayer* p, int frames, FFTransitionCurve curve) {
+    if (!t || !p) return -1;
+    if (t->next) finish(t, t->next);
+    if (!t->live) return -1;
+    if (frames <= 0 || p == t->live) return ff_transition_cut(t, p);
+    t->next   = p;
+    t->frames = frames;
+    t->done   = 0;
+    t->curve  = curve;
+    t->stats.crossfades++;
+    return 0;
+}
+
+int ff_transition_active(const FFTransition* t) {
+    return t && t->next;
+}
+
+FFPlayer* ff_transition_live(const FFTransition* t) {
+    return t ? t->live : NULL;
+}
+
+void ff_transition_get_stats(FFTransition* t, FFTransitionStats* out) {
+    if (!t || !out) return;
+    *out = t->stats;
+}
+
+// Decodes side i unless it still holds a picture from a frame that failed.
+static void decode_task(void* ctx, int i) {
+    Side* s = &((Side*)ctx)[i];
+    if (s->have) return;
+    s->r = ff_next_source(s->p, &s->src, &s->index, &s->pts);
+    s->have = s->r == 1;
+}
+
+// Scratch for a dst_w x dst_h mix, grown as needed. Returns 0 or -1.
+static int ensure_scratch(FFTransition* t, int dst_w, int dst_h) {
+    size_t n = ff_convert_blend_frame_scratch(t->workers, dst_w, dst_h);
+    if (n <= t->scratch_bytes) return 0;
+    uint8_t* p = realloc(t->scratch, n);
+    if (!p) return -1;
+    t->scratch = p;
+    t->scratch_bytes = n;
+    return 0;
+}
+
+static void record(int64_t* last, int64_t* max, double* avg, int64_t v, uint64_t n) {
+    *last = v;
+    if (v > *max) *max = v;
+    *avg += (v - *avg) / (double)n;
+}
+
+// One mixed frame. Both clips decode concurrently on the pool; if one has
+// ended, the other carries on alone from this frame. Errors (a failed decode,
+// an interrupt, no output buffer) go back to the caller with both clips kept;
+// a picture already decoded waits for the next call.
+static int next_mixed(FFTransition* t, FFFrameRef** out, FFTransitionPos* pos) {
+    Side* a = &t->side[0];
+    Side* b = &t->side[1];
+    int64_t t0 = ff_now_ns();
+    if (!a->have || !b->have) {
+        a->p = t->live;
+        b->p = t->next;
+        ff_workers_run(t->workers, 2, decode_task, t->side);
+        if (a->r < 0) return a->r;
+        if (b->r < 0) return b->r;
+    }
+    int64_t t1 = ff_now_ns();
+
+    double mix = ff_transition_curve(t->curve, (t->done + 1) / (double)(t->frames + 1));
+    FFBlend blend = { (int)lrint(mix * 256), t->cfg.alpha_aware };
+    const Side* shape = a;    // output size
+    const Side* timing = b;   // output timing
+    if (a->r == 0 && b->r == 0) {
+        t->stats.cut_short++;
+        finish(t, t->next);
+        return 0;
+    } else if (a->r == 0) {
+        blend.mix = 256;
+        mix = 1;
+        shape = b;
+        a = b;
+    } else if (b->r == 0) {
+        blend.mix = 0;
+        mix = 0;
+        timing = a;
+        b = a;
+    }
+
+    int w = shape->src.width, h = shape->src.height;
+    if (ensure_scratch(t, w, h) < 0) return -1;
+    FFSinkImage img;
+    if (t->sink->acquire(t->sink, w, h, FF_PIXFMT_BGRA, &img) < 0) return -3;
+    ff_convert_blend(t->workers, &a->src, &b->src, &blend, &img, t->scratch);
+    FFFrameRef* f = t->sink->commit(t->sink, &img, timing->pts, timing->index);
+    if (!f) return -3;
+    int64_t t2 = ff_now_ns();
+    t->side[0].have = t->side[1].have = 0;
+
+    uint64_t n = ++t->stats.mixed;
+    record(&t->stats.decode_ns_last, &t->stats.decode_ns_max, &t->stats.decode_ns_avg, t1 - t0, n);
+    record(&t->stats.blend_ns_last, &t->stats.blend_ns_max, &t->stats.blend_ns_avg, t2 - t1, n);
+    if (t2 - t0 > t->stats.frame_ns_max) t->stats.frame_ns_max = t2 - t0;
+
+    if (pos) {
+        pos->player = timing->p;
+        pos->index  = timing->index;
+        pos->mix    = mix;
+    }
+    *out = f;
+    if (t->side[0].r == 0 || t->side[1].r == 0) {
+        t->stats.cut_short++;
+        finish(t, timing->p);
+    } else if (++t->done >= t->frames) {
+        finish(t, t->next);
+    }
+    return 1;
+}
+
+int ff_transition_next(FFTransition* t, FFFrameRef** out, FFTransitionPos* pos) {
+    if (!t || !out) return -1;
+    *out = NULL;
+    if (!t->live) return -1;
+    if (t->next) return next_mixed(t, out, pos);
+
+    int r = ff_next_frame_ref(t->live, out);
+    if (r == 1 && pos) {
+        pos->player = t->live;
+        pos->index  = ff_frame_index(*out);
+        pos->mix    = 0;
+    }
+    return r;
+}
@@ -0,0 +1,94 @@
+#pragma once
+#include <stdint.h>
+#include "ffdecode.h"
+#include "ffframe.h"
+#include "ffworkers.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Transitions between clips: cuts, and crossfades during which both clips
+// play at once and are mixed. Outside a crossfade the live clip's frames are
+// passed through untouched. During one, every output frame takes two steps on
+// one FFWorkers pool: both players decode their next frame concurrently (a
+// task each, ff_next_source), then the two pictures are converted and mixed
+// in a single pass split in row bands (ff_convert_blend). The mix is read
+// straight from the decoders' planes whenever ffconvert can read their
+// format, so a crossfade costs one write of the output frame and no
+// intermediate BGRA copies. Players are not owned. Not thread-safe: one
+// output thread drives it.
+typedef struct FFTransition FFTransition;
+
+// Shape of the mix over the transition: x (0..1, share of the transition
+// elapsed) to the incoming clip's weight.
+typedef enum FFTransitionCurve {
+    FF_CURVE_LINEAR = 0,
+    FF_CURVE_SMOOTH,       // smoothstep: eases in and out
+    FF_CURVE_EASE_IN,      // x^2: the incoming clip comes up late
+    FF_CURVE_EASE_OUT,     // 1 - (1 - x)^2: and early
+} FFTransitionCurve;
+
+double ff_transition_curve(FFTransitionCurve c, double x);
+
+typedef struct FFTransitionConfig {
+    FFWorkers* workers;       // shared pool, not owned; NULL = one of its own, a thread per CPU
+    int        alpha_aware;   // see FFBlend
+    int        buffers;       // mixed frames in flight; 0 = FF_POOL_DEFAULT_BUFFERS
+    unsigned   mem_flags;     // FF_MEM_* for the mixed frames' buffers
+    // Optional: called on the output thread once a clip is no longer used
+    // (the outgoing one after a cut or crossfade, or an incoming one that
+    // ended before its crossfade did) so the caller can close it.
+    void     (*retired)(void* opaque, FFPlayer* p);
+    void*      opaque;
+} FFTransitionConfig;
+
+typedef struct FFTransitionPos {
+    FFPlayer* player;   // the clip the frame comes from; mixing, the incoming one
+    int64_t   index;    // that clip's frame number
+    double    mix;      // the incoming clip's weight, 0..1; 0 outside a crossfade
+} FFTransitionPos;
+
+typedef struct FFTransitionStats {
+    uint64_t cuts;
+    uint64_t crossfades;       // started
+    uint64_t mixed;            // frames mixed
+    uint64_t cut_short;        // crossfades ended early because a clip ran out
+    // Mixed frames: both clips decoding (concurrently), then the mix, then the
+    // two together.
+    int64_t  decode_ns_last, decode_ns_max;
+    double   decode_ns_avg;
+    int64_t  blend_ns_last, blend_ns_max;
+    double   blend_ns_avg;
+    int64_t  frame_ns_max;
+} FFTransitionStats;
+
+FFTransition* ff_transition_create(const FFTransitionConfig* cfg);
+// Players still in use are not closed (nor retired).
+void          ff_transition_destroy(FFTransition* t);
+
+// Makes `p` live from its next frame. A crossfade in progress ends at once;
+// every other clip is retired. Returns 0 or -1.
+int           ff_transition_cut(FFTransition* t, FFPlayer* p);
+// Crossfades from the live clip to `p` (positioned by the caller) over
+// `frames` output frames, the mix following `curve`; after them `p` plays
+// alone. frames <= 0 is a cut. A crossfade in progress ends at once first.
+// If either clip ends during the crossfade, the other carries on alone.
+// Returns 0, or -1 if nothing is live.
+int           ff_transition_crossfade(FFTransition* t, FFPlayer* p, int frames, FFTransitionCurve curve);
+
+// The next output frame, one reference: the live clip's, or both clips'
+// mixed. Mixed frames are sized like the outgoing clip and carry the incoming
+// clip's timing. *pos may be NULL. Returns like ff_next_frame_ref; 0 once the
+// live clip ends, or -1 if nothing is live. While mixing, an error of either
+// clip (e.g. -4 interrupted) is returned with the crossfade left as it was,
+// and a picture the other clip already decoded is used by the next call.
+int           ff_transition_next(FFTransition* t, FFFrameRef** out, FFTransitionPos* pos);
+
+int           ff_transition_active(const FFTransition* t);   // a crossfade is in progress
+FFPlayer*     ff_transition_live(const FFTransition* t);     // outgoing clip while mixing
+void          ff_transition_get_stats(FFTransition* t, FFTransitionStats* out);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,60 @@
+#pragma once
+// Small internal helpers shared by the core's .c files. Not part of the public API.
+#include <errno.h>
+#include <stdint.h>
+#include <time.h>
+#include <pthread.h>
+
+// Monotonic nanoseconds.
+static inline int64_t ff_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// Initializes a condition variable for ff_cond_wait_ns. Its timed waits run
+// on the monotonic clock, so a wall-clock change cannot stretch or cut them.
+static inline int ff_cond_init(pthread_cond_t* cv) {
+#ifdef __APPLE__
+    return pthread_cond_init(cv, NULL);   // no setclock; waits are relative there
+#else
+    pthread_condattr_t attr;
+    int r = pthread_condattr_init(&attr);
+    if (r) return r;
+    r = pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    if (!r) r = pthread_cond_init(cv, &attr);
+    pthread_condattr_destroy(&attr);
+    return r;
+#endif
+}
+
+// Waits on `cv` (from ff_cond_init) for at most `timeout_ns` (<0 waits
+// forever). Returns 0 when signalled, non-zero on timeout.
+static inline int ff_cond_wait_ns(pthread_cond_t* cv, pthread_mutex_t* mu, int64_t timeout_ns) {
+    if (timeout_ns < 0) return pthread_cond_wait(cv, mu);
+#ifdef __APPLE__
+    struct timespec rel = { (time_t)(timeout_ns / 1000000000LL), (long)(timeout_ns % 1000000000LL) };
+    return pthread_cond_timedwait_relative_np(cv, mu, &rel);
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    int64_t ns = ts.tv_nsec + timeout_ns;
+    ts.tv_sec  += (time_t)(ns / 1000000000LL);
+    ts.tv_nsec  = (long)(ns % 1000000000LL);
+    return pthread_cond_timedwait(cv, mu, &ts);
+#endif
+}
+
+// Sleeps until ff_now_ns() >= deadline_ns (absolute, monotonic).
+static inline void ff_sleep_until_ns(int64_t deadline_ns) {
+#ifdef __linux__
+    struct timespec ts = { (time_t)(deadline_ns / 1000000000LL), (long)(deadline_ns % 1000000000LL) };
+    if (deadline_ns <= 0) return;
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) {}
+#else
+    for (int64_t left; (left = deadline_ns - ff_now_ns()) > 0;) {
+        struct timespec ts = { (time_t)(left / 1000000000LL), (long)(left % 1000000000LL) };
+        nanosleep(&ts, NULL);
+    }
+#endif
+}
@@ -0,0 +1,136 @@
+#include "ffworkers.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#define FF_WORKERS_MAX 256
+
+struct FFWorkers {
+    pthread_mutex_t run_lock;   // one job at a time
+    pthread_mutex_t lock;
+    pthread_cond_t  start;      // new job or shutdown
+    pthread_cond_t  done;       // last task of the job finished
+
+    int             nthreads;
+    pthread_t       threads[FF_WORKERS_MAX];
+    int             quit;
+
+    // Current job
+    uint64_t        generation;
+    void          (*fn)(void* ctx, int task);
+    void*           ctx;
+    int             count;
+    atomic_int      next;       // next task to claim
+    int             finished;   // tasks completed (under lock)
+    int             active;     // threads inside the job
+};
+
+// Claims and runs tasks until none are left. Returns how many this thread ran.
+static int run_tasks(FFWorkers* w, void (*fn)(void*, int), void* ctx, int count) {
+    int n = 0;
+    for (;;) {
+        int i = atomic_fetch_add(&w->next, 1);
+        if (i >= count) break;
+        fn(ctx, i);
+        ++n;
+    }
+    return n;
+}
+
+static void* worker_main(void* arg) {
+    FFWorkers* w = arg;
+    uint64_t seen = 0;
+    pthread_mutex_lock(&w->lock);
+    for (;;) {
+        while (!w->quit && w->generation == seen) pthread_cond_wait(&w->start, &w->lock);
+        if (w->quit) break;
+        seen = w->generation;
+        void (*fn)(void*, int) = w->fn;
+        void* ctx = w->ctx;
+        int count = w->count;
+        w->active++;
+        pthread_mutex_unlock(&w->lock);
+
+        int n = run_tasks(w, fn, ctx, count);
+
+        pthread_mutex_lock(&w->lock);
+        w->finished += n;
+        w->active--;
+        if (w->finished == w->count && w->active == 0) pthread_cond_broadcast(&w->done);
+    }
+    pthread_mutex_unlock(&w->lock);
+    return NULL;
+}
+
+FFWorkers* ff_workers_create(int threads) {
+    if (threads <= 0) {
+        long n = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = n > 0 ? (int)n : 1;
+    }
+    if (threads > FF_WORKERS_MAX) threads = FF_WORKERS_MAX;
+
+    FFWorkers* w = calloc(1, sizeof(*w));
+    if (!w) return NULL;
+    pthread_mutex_init(&w->run_lock, NULL);
+    pthread_mutex_init(&w->lock, NULL);
+    pthread_cond_init(&w->start, NULL);
+    pthread_cond_init(&w->done, NULL);
+
+    // The caller is one of the `threads`.
+    for (int i = 0; i < threads - 1; ++i) {
+        if (pthread_create(&w->threads[i], NULL, worker_main, w) != 0) break;
+        w->nthreads++;
+    }
+    return w;
+}
+
+void ff_workers_destroy(FFWorkers* w) {
+    if (!w) return;
+    pthread_mutex_lock(&w->lock);
+    w->quit = 1;
+    pthread_cond_broadcast(&w->start);
+    pthread_mutex_unlock(&w->lock);
+    for (int i = 0; i < w->nthreads; ++i) pthread_join(w->threads[i], NULL);
+    pthread_mutex_destroy(&w->run_lock);
+    pthread_mutex_destroy(&w->lock);
+    pthread_cond_destroy(&w->start);
+    pthread_cond_destroy(&w->done);
+    free(w);
+}
+
+int ff_workers_count(const FFWorkers* w) {
+    return w ? w->nthreads + 1 : 1;
+}
+
+void ff_workers_run(FFWorkers* w, int count, void (*fn)(void* ctx, int task), void* ctx) {
+    if (count <= 0 || !fn) return;
+    if (!w || w->nthreads == 0 || count == 1) {
+        for (int i = 0; i < count; ++i) fn(ctx, i);
+        return;
+    }
+
+    pthread_mutex_lock(&w->run_lock);
+    pthread_mutex_lock(&w->lock);
+    // A thread that woke too late for the previous job may still be leaving it.
+    while (w->active > 0) pthread_cond_wait(&w->done, &w->lock);
+    w->fn = fn;
+    w->ctx = ctx;
+    w->count = count;
+    w->finished = 0;
+    atomic_store(&w->next, 0);
+    w->generation++;
+    w->active++;   // the caller
+    pthread_cond_broadcast(&w->start);
+    pthread_mutex_unlock(&w->lock);
+
+    int n = run_tasks(w, fn, ctx, count);
+
+    pthread_mutex_lock(&w->lock);
+    w->finished += n;
+    w->active--;
+    while (w->finished < w->count || w->active > 0) pthread_cond_wait(&w->done, &w->lock);
+    pthread_mutex_unlock(&w->lock);
+    pthread_mutex_unlock(&w->run_lock);
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Small fork-join thread pool for data-parallel stages (pixel conversion,
+// blending, gathers). ff_workers_run splits a job into `count` tasks and runs
+// them on the pool's threads and the calling thread, returning when all are done.
+typedef struct FFWorkers FFWorkers;
+
+// `threads` = total parallelism including the caller; 0 = online CPUs.
+FFWorkers* ff_workers_create(int threads);
+void       ff_workers_destroy(FFWorkers* w);
+
+// Total parallelism (pool threads + the caller). 1 for a NULL pool.
+int        ff_workers_count(const FFWorkers* w);
+
+// Calls fn(ctx, i) once for every i in [0, count). Runs inline when w is NULL.
+// Jobs from different threads are serialized.
+void       ff_workers_run(FFWorkers* w, int count, void (*fn)(void* ctx, int task), void* ctx);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,314 @@
+#pragma once
+// Header-only C++17/20 layer over the decoder's C API (ffdecode.h, ffframe.h).
+// Handles are move-only and release what they own, frames expose their planes
+// as spans over the pooled memory they reference, and fallible calls return
+// notch::Expected instead of integer codes. Everything is inline and a Frame is
+// exactly one FFFrameRef pointer, so the layer costs nothing over the C calls.
+//
+//     auto player = notch::Player::open(path);
+//     if (!player) return player.error().code;
+//     while (auto frame = player->next_frame()) {
+//         if (!*frame) break;                        // end of stream
+//         for (int y = 0; y < frame->height(); ++y) use(frame->plane(0).row(y));
+//     }
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <utility>
+#if __cplusplus >= 202002L && __has_include(<span>)
+#include <span>
+#endif
+
+#include "ffconvert.h"
+#include "ffdecode.h"
+#include "ffframe.h"
+#include "ffsink.h"
+
+namespace notch {
+
+// ---- span ----
+
+#if defined(__cpp_lib_span)
+template <class T> using span = std::span<T>;
+#else
+// The part of std::span the wrapper uses, for C++17 builds.
+template <class T> class span {
+public:
+    using element_type = T;
+    using value_type   = std::remove_cv_t<T>;
+    using size_type    = std::size_t;
+    using iterator     = T*;
+
+    constexpr span() noexcept = default;
+    constexpr span(T* data, size_type size) noexcept : data_(data), size_(size) {}
+    template <std::size_t N> constexpr span(T (&a)[N]) noexcept : data_(a), size_(N) {}
+
+    constexpr T*        data() const noexcept { return data_; }
+    constexpr size_type size() const noexcept { return size_; }
+    constexpr size_type size_bytes() const noexcept { return size_ * sizeof(T); }
+    constexpr bool      empty() const noexcept { return size_ == 0; }
+    constexpr T&        operator[](size_type i) const noexcept { return data_[i]; }
+    constexpr iterator  begin() const noexcept { return data_; }
+    constexpr iterator  end() const noexcept { return data_ + size_; }
+    constexpr span      subspan(size_type offset, size_type count) const noexcept {
+        return span(data_ + offset, count);
+    }
+
+private:
+    T*        data_ = nullptr;
+    size_type size_ = 0;
+};
+#endif
+
+// ---- Errors ----
+
+// A C API error code (always < 0).
+struct Error {
+    int code;
+
+    // The output pool stayed full (-3): nothing was lost, retry later.
+    constexpr bool would_block() const noexcept { return code == -3; }
+};
+
+// std::expected-style result (std::expected itself needs C++23): holds a T or
+// an Error. Accessing the wrong alternative is undefined, as with std::expected's
+// operator*; there are no exceptions.
+template <class T> class [[nodiscard]] Expected {
+public:
+    Expected(T&& v) noexcept(std::is_nothrow_move_constructible_v<T>) : ok_(true) {
+        new (&value_) T(std::move(v));
+    }
+    Expected(Error e) noexcept : ok_(false) { new (&error_) Error(e); }
+
+    Expected(Expected&& o) noexcept(std::is_nothrow_move_constructible_v<T>) : ok_(o.ok_) {
+        if (ok_) new (&value_) T(std::move(o.value_));
+        else     new (&error_) Error(o.error_);
+    }
+    Expected& operator=(Expected&& o) noexcept(std::is_nothrow_move_constructible_v<T>) {
+        if (this != &o) {
+            this->~Expected();
+            new (this) Expected(std::move(o));
+        }
+        return *this;
+    }
+    Expected(const Expected&)            = delete;
+    Expected& operator=(const Expected&) = delete;
+    ~Expected() {
+        if (ok_) value_.~T();
+    }
+
+    bool     has_value() const noexcept { return ok_; }
+    explicit operator bool() const noexcept { return ok_; }
+
+    T&       value() & noexcept { return value_; }
+    const T& value() const& noexcept { return value_; }
+    T&&      value() && noexcept { return std::move(value_); }
+    T&       operator*() & noexcept { return value_; }
+    const T& operator*() const& noexcept { return value_; }
+    T&&      operator*() && noexcept { return std::move(value_); }
+    T*       operator->() noexcept { return &value_; }
+    const T* operator->() const noexcept { return &value_; }
+
+    Error    error() const noexcept { return error_; }
+
+    template <class U> T value_or(U&& fallback) && {
+        return ok_ ? std::move(value_) : T(std::forward<U>(fallback));
+    }
+
+private:
+    union {
+        T     value_;
+        Error error_;
+    };
+    bool ok_;
+};
+
+template <> class [[nodiscard]] Expected<void> {
+public:
+    Expected() noexcept : error_{ 0 } {}
+    Expected(Error e) noexcept : error_(e) {}
+
+    bool     has_value() const noexcept { return error_.code == 0; }
+    explicit operator bool() const noexcept { return error_.code == 0; }
+    Error    error() const noexcept { return error_; }
+
+private:
+    Error error_;
+};
+
+// ---- Frames ----
+
+// One plane of a frame: `height` rows of `row_bytes` bytes, `stride` apart.
+struct PlaneView {
+    const std::uint8_t* data;
+    int                 stride;
+    int                 row_bytes;
+    int                 height;
+
+    span<const std::uint8_t> row(int y) const noexcept {
+        return span<const std::uint8_t>(data + static_cast<std::ptrdiff_t>(y) * stride,
+                                        static_cast<std::size_t>(row_bytes));
+    }
+    // Every byte from the first row to the end of the last, padding included.
+    span<const std::uint8_t> bytes() const noexcept {
+        std::size_t n = height > 0
+            ? static_cast<std::size_t>(stride) * static_cast<std::size_t>(height - 1) + static_cast<std::size_t>(row_bytes)
+            : 0;
+        return span<const std::uint8_t>(data, n);
+    }
+};
+
+// Move-only owner of one reference to a converted frame. The pixels stay in
+// the sink's pool and go back to it when the last Frame referencing them dies.
+// An empty Frame (false) marks the end of a stream.
+class Frame {
+public:
+    Frame() noexcept = default;
+    // Takes over one reference the caller owns.
+    static Frame adopt(FFFrameRef* f) noexcept { return Frame(f); }
+
+    Frame(Frame&& o) noexcept : f_(std::exchange(o.f_, nullptr)) {}
+    Frame& operator=(Frame&& o) noexcept {
+        if (this != &o) {
+            FFFrameRef* old = std::exchange(f_, std::exchange(o.f_, nullptr));
+            if (old) ff_frame_release(old);
+        }
+        return *this;
+    }
+    Frame(const Frame&)            = delete;
+    Frame& operator=(const Frame&) = delete;
+    ~Frame() {
+        if (f_) ff_frame_release(f_);   // inline test: moved-from frames cost no call
+    }
+
+    // Another owner of the same pixels (a retain, never a copy).
+    Frame share() const noexcept { return Frame(f_ ? ff_frame_retain(f_) : nullptr); }
+    // Gives up ownership: the caller now owns the reference.
+    FFFrameRef* release() noexcept { return std::exchange(f_, nullptr); }
+    FFFrameRef* get() const noexcept { return f_; }
+    explicit operator bool() const noexcept { return f_ != nullptr; }
+
+    int           width() const noexcept { return ff_frame_width(f_); }
+    int           height() const noexcept { return ff_frame_height(f_); }
+    FFPixelFormat format() const noexcept { return ff_frame_format(f_); }
+    double        pts() const noexcept { return ff_frame_pts(f_); }
+    std::int64_t  index() const noexcept { return ff_frame_index(f_); }
+    void*         native() const noexcept { return ff_frame_native(f_); }
+    int           refcount() const noexcept { return ff_frame_refcount(f_); }
+
+    PlaneView plane(int p) const noexcept {
+        return PlaneView{ ff_frame_plane(f_, p), ff_frame_stride(f_, p),
+                          width() * ff_pixfmt_bytes_per_pixel(format()), height() };
+    }
+    // Writable view; only while this is the frame's sole reference.
+    span<std::uint8_t> mutable_row(int p, int y) const noexcept {
+        return span<std::uint8_t>(ff_frame_plane(f_, p) + static_cast<std::ptrdiff_t>(y) * ff_frame_stride(f_, p),
+                                  static_cast<std::size_t>(width() * ff_pixfmt_bytes_per_pixel(format())));
+    }
+
+private:
+    explicit Frame(FFFrameRef* f) noexcept : f_(f) {}
+    FFFrameRef* f_ = nullptr;
+};
+
+static_assert(sizeof(Frame) == sizeof(FFFrameRef*), "Frame must stay a bare pointer");
+
+// ---- Player ----
+
+struct ClipInfo {
+    int    width      = 0;
+    int    height     = 0;
+    double time_base  = 0;
+    double duration_s = 0;
+};
+
+// Move-only owner of an FFPlayer.
+class Player {
+public:
+    Player() noexcept = default;
+
+    static Expected<Player> open(const char* path, const FFOpenOptions* opts = nullptr) noexcept {
+        ClipInfo info;
+        FFPlayer* p = ff_open_with_options(path, opts, &info.width, &info.height,
+                                           &info.time_base, &info.duration_s);
+        if (!p) return Error{ -1 };
+        return Player(p, info);
+    }
+    // Takes over a player opened through the C API.
+    static Player adopt(FFPlayer* p, const ClipInfo& info) noexcept { return Player(p, info); }
+
+    Player(Player&& o) noexcept : p_(std::exchange(o.p_, nullptr)), info_(o.info_) {}
+    Player& operator=(Player&& o) noexcept {
+        if (this != &o) {
+            FFPlayer* old = std::exchange(p_, std::exchange(o.p_, nullptr));
+            if (old) ff_close(old);
+            info_ = o.info_;
+        }
+        return *this;
+    }
+    Player(const Player&)            = delete;
+    Player& operator=(const Player&) = delete;
+    ~Player() {
+        if (p_) ff_close(p_);
+    }
+
+    FFPlayer*       get() const noexcept { return p_; }
+    FFPlayer*       release() noexcept { return std::exchange(p_, nullptr); }
+    explicit        operator bool() const noexcept { return p_ != nullptr; }
+    const ClipInfo& info() const noexcept { return info_; }
+
+    // Next frame; an empty Frame at the end of the stream. Error::would_block()
+    // means the pool is full and the decoded frame is kept for the next call.
+    Expected<Frame> next_frame() noexcept {
+        FFFrameRef* f = nullptr;
+        int r = ff_next_frame_ref(p_, &f);
+        if (r < 0) return Error{ r };
+        return Frame::adopt(f);
+    }
+
+    // One frame per region (see ff_set_regions) into `out`, which must hold at
+    // least region_count() frames. Previous contents of `out` are released.
+    Expected<bool> next_region_frames(span<Frame> out) noexcept {
+        constexpr int kStack = 64;
+        FFFrameRef* refs[kStack];
+        int n = ff_get_region_count(p_);
+        if (n <= 0 || n > kStack || out.size() < static_cast<std::size_t>(n)) return Error{ -1 };
+        int r = ff_next_region_frames(p_, refs, kStack);
+        if (r < 0) return Error{ r };
+        if (r == 0) return false;
+        for (int i = 0; i < n; ++i) out[static_cast<std::size_t>(i)] = Frame::adopt(refs[i]);
+        return true;
+    }
+
+    Expected<void> set_regions(span<const FFRegion> regions) noexcept {
+        int r = ff_set_regions(p_, regions.data(), static_cast<int>(regions.size()));
+        return r < 0 ? Expected<void>(Error{ r }) : Expected<void>();
+    }
+    int region_count() const noexcept { return ff_get_region_count(p_); }
+
+    // The player takes ownership of `sink`; nullptr restores the default.
+    Expected<void> set_sink(FFFrameSink* sink) noexcept {
+        int r = ff_set_sink(p_, sink);
+        return r < 0 ? Expected<void>(Error{ r }) : Expected<void>();
+    }
+    FFFrameSink* sink() const noexcept { return ff_get_sink(p_); }
+
+    Expected<void> seek(std::int64_t index) noexcept {
+        int r = ff_seek_frame(p_, index);
+        return r < 0 ? Expected<void>(Error{ r }) : Expected<void>();
+    }
+    std::int64_t next_index() const noexcept { return ff_next_frame_index(p_); }
+    double       fps() const noexcept { return ff_get_fps(p_); }
+    std::int64_t frame_count() const noexcept { return ff_get_frame_count(p_); }
+
+    // For pipeline stages built on FFFrameSource (fffanout.h, ...).
+    FFFrameSource source() const noexcept { return ff_player_source(p_); }
+
+private:
+    Player(FFPlayer* p, const ClipInfo& info) noexcept : p_(p), info_(info) {}
+    FFPlayer* p_ = nullptr;
+    ClipInfo  info_;
+};
+
+} // namespace notch
@@ -0,0 +1,528 @@
+#include "synthetic_decoder.h"
+#include "ffcache.h"
+#include "ffconvert.h"
+#include "ffdecode.h"
+#include "ffdiskcache.h"
+#include "ffframe.h"
+#include "ffloop.h"
+#include "ffpackcache.h"
+#include "ffpool.h"
+#include "ffproxy.h"
+#include "ffsink.h"
+#include "ffutil.h"
+#include <math.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SYNTH_FPS 60.0
+#define SYNTH_PACK_QUEUE 4   // FF_PACK_QUEUE in ffdecode.c
+
+static atomic_uint_least64_t g_decoded, g_seeks;
+static atomic_int g_fail_region_reads;
+
+struct FFPlayer {
+    int          width, height;
+    int64_t      frames, gop;
+    int64_t      next_index;    // next frame to return
+    int64_t      pos;           // next frame the decoder produces
+    int64_t      skip_until;    // frames below this are decoded but not returned
+    // Cache hits moved next_index on without the decoder, which stayed at dec_pos
+    int          dec_behind;
+    int64_t      dec_pos;
+    int64_t      cost_ns;       // simulated decode time per frame
+    int        (*interrupt)(void* opaque);
+    void*        interrupt_opaque;
+    FFFrameSink* sink;
+    FFRegion*    regions;       // ff_set_regions, resolved
+    int          nregions;
+    uint8_t*     scratch;       // full frame the regions are cut from
+
+    // Looping, as ffdecode.c does it
+    FFLoop*      loop;
+    int          loop_buffers;
+    int          loop_range;
+    // Streamed loop region: its "packets" are in memory, so seeks inside it
+    // do not count as file seeks.
+    int          region;
+    int64_t      region_in, region_out;
+
+    FFFrameCache* cache;        // ff_set_frame_cache
+    FFPackCache*  pack;         // ff_set_pack_cache
+    FFDiskCache*  disk;         // ff_set_disk_cache, not owned
+    FFDiskCacheKey disk_key;
+    uint64_t     clip_id;       // stands in for the file identity: a hash of the path
+    FFProxy*     proxy;         // ff_set_proxy, not owned
+    int          use_proxy;
+};
+
+// Spends the simulated decode time of one frame.
+static void decode_one(FFPlayer* p) {
+    if (p->cost_ns > 0) ff_sleep_until_ns(ff_now_ns() + p->cost_ns);
+    atomic_fetch_add(&g_decoded, 1);
+}
+
+uint64_t synthetic_decode_count(void) { return atomic_load(&g_decoded); }
+uint64_t synthetic_seek_count(void)   { return atomic_load(&g_seeks); }
+void     synthetic_fail_region_reads(int n) { atomic_store(&g_fail_region_reads, n); }
+
+FFPlayer* ff_open_with_options(const char* path, const FFOpenOptions* opts,
+                               int* width, int* height, double* time_base, double* duration_s) {
+    int w = 0, h = 0;
+    long long frames = 0, gop = 0, cost_us = 0;
+    if (!path || sscanf(path, "synthetic:%d:%d:%lld:%lld:%lld", &w, &h, &frames, &gop, &cost_us) < 4) return NULL;
+    if (w <= 0 || h <= 0 || frames <= 0 || gop <= 0 || cost_us < 0) return NULL;
+
+    FFPlayer* p = calloc(1, sizeof(*p));
+    if (!p) return NULL;
+    p->width  = w;
+    p->height = h;
+    p->frames = frames;
+    p->gop    = gop;
+    p->cost_ns = cost_us * 1000;
+    // FNV-1a of the path: the same path is the same clip, as a file would be
+    p->clip_id = 14695981039346656037ULL;
+    for (const char* c = path; *c; ++c) p->clip_id = (p->clip_id ^ (uint8_t)*c) * 1099511628211ULL;
+    p->sink   = ff_sink_default_create();
+    if (!p->sink) {
+        free(p);
+        return NULL;
+    }
+    if (width) *width = w;
+    if (height) *height = h;
+    if (time_base) *time_base = 1.0 / SYNTH_FPS;
+    if (duration_s) *duration_s = frames / SYNTH_FPS;
+    return p;
+}
+
+FFPlayer* ff_open(const char* path, int* width, int* height, double* time_base, double* duration_s) {
+    return ff_open_with_options(path, NULL, width, height, time_base, duration_s);
+}
+
+void ff_close(FFPlayer* p) {
+    if (!p) return;
+    ff_loop_destroy(p->loop);
+    ff_cache_destroy(p->cache);
+    ff_packcache_destroy(p->pack);
+    ff_sink_destroy(p->sink);
+    free(p->regions);
+    free(p->scratch);
+    free(p);
+}
+
+int ff_set_sink(FFPlayer* p, FFFrameSink* sink) {
+    if (!p) return -1;
+    if (!sink) sink = ff_sink_default_create();
+    if (!sink) return -1;
+    ff_sink_destroy(p->sink);
+    p->sink = sink;
+    return 0;
+}
+
+FFFrameSink* ff_get_sink(FFPlayer* p) {
+    return p ? p->sink : NULL;
+}
+
+static void fill(const FFPlayer* p, int64_t index, uint8_t* data, int stride) {
+    for (int y = 0; y < p->height; ++y) {
+        uint8_t* row = data + (size_t)y * stride;
+        for (int x = 0; x < p->width; ++x) {
+            for (int ch = 0; ch < 4; ++ch) row[x * 4 + ch] = synthetic_pixel(index, x, y, ch);
+        }
+    }
+}
+
+static int seek_decoder(FFPlayer* p, int64_t index);
+
+// As in ffdecode.c: a decoder left close behind decodes forward, else seeks.
+static int resync_decoder(FFPlayer* p) {
+    p->dec_behind = 0;
+    int64_t gap = p->next_index - p->dec_pos;
+    if (gap == 0) return 0;
+    if (gap < 0 || gap > 32) return seek_decoder(p, p->next_index);
+    p->skip_until = p->next_index;
+    return 0;
+}
+
+static void leave_decoder(FFPlayer* p) {
+    if (p->dec_behind) return;
+    p->dec_behind = 1;
+    p->dec_pos    = p->next_index;
+}
+
+// Skips to the seek target. Returns 1 if a frame is next, else like ff_next_frame_ref.
+static int advance(FFPlayer* p) {
+    if (p->dec_behind) {
+        int r = resync_decoder(p);
+        if (r < 0) return r;
+    }
+    while (p->pos < p->skip_until && p->pos < p->frames) {
+        if (p->interrupt && p->interrupt(p->interrupt_opaque)) return -4;
+        decode_one(p);
+        p->pos++;
+    }
+    if (p->pos >= p->frames) return 0;
+    if (p->interrupt && p->interrupt(p->interrupt_opaque)) return -4;
+    return 1;
+}
+
+// Reads frame next_index from the disk cache, leaving the decoder behind.
+// Returns like next_frame_ref; 0 means it was not on disk.
+static int next_disk_frame(FFPlayer* p, FFFrameRef** out) {
+    FFSinkImage img;
+    if (p->sink->acquire(p->sink, p->width, p->height, FF_PIXFMT_BGRA, &img) < 0) return -3;
+    int r = ff_diskcache_read_into(p->disk, &p->disk_key, p->next_index, &img);
+    if (r != 1) {
+        p->sink->discard(p->sink, &img);
+        return r;
+    }
+    *out = p->sink->commit(p->sink, &img, p->next_index / SYNTH_FPS, p->next_index);
+    if (!*out) return -3;
+    leave_decoder(p);
+    if (p->cache) ff_cache_put(p->cache, *out);
+    p->next_index++;
+    return 1;
+}
+
+// Reads frame next_index from the proxy at proxy size, kept out of the
+// full-size caches. Returns like next_disk_frame.
+static int next_proxy_frame(FFPlayer* p, FFFrameRef** out) {
+    const FFDiskCacheKey* key = ff_proxy_key(p->proxy);
+    FFSinkImage img;
+    if (p->sink->acquire(p->sink, key->width, key->height, FF_PIXFMT_BGRA, &img) < 0) return -3;
+    int r = ff_proxy_read_into(p->proxy, p->next_index, &img);
+    if (r != 1) {
+        p->sink->discard(p->sink, &img);
+        return r;
+    }
+    *out = p->sink->commit(p->sink, &img, p->next_index / SYNTH_FPS, p->next_index);
+    if (!*out) return -3;
+    leave_decoder(p);
+    p->next_index++;
+    return 1;
+}
+
+static int next_frame_ref(FFPlayer* p, FFFrameRef** out) {
+    *out = NULL;
+    if (p->use_proxy && ff_proxy_contains(p->proxy, p->next_index)) {
+        int r = next_proxy_frame(p, out);
+        if (r != 0) return r;
+    }
+    if (p->cache) {
+        ff_cache_set_playhead(p->cache, p->next_index);
+        FFFrameRef* f = ff_cache_get(p->cache, p->next_index);
+        if (f) {
+            leave_decoder(p);
+            *out = f;
+            p->next_index++;
+            return 1;
+        }
+    }
+    if (p->pack) {
+        ff_packcache_set_playhead(p->pack, p->next_index);
+        FFFrameRef* f = ff_packcache_get(p->pack, p->next_index);
+        if (f) {
+            leave_decoder(p);
+            *out = f;
+            p->next_index++;
+            return 1;
+        }
+    }
+    if (p->disk && ff_diskcache_contains(p->disk, &p->disk_key, p->next_index)) {
+        int r = next_disk_frame(p, out);
+        if (r != 0) return r;   // 0: lost to eviction, decode it instead
+    }
+    int r = advance(p);
+    if (r != 1) return r;
+
+    FFSinkImage img;
+    if (p->sink->acquire(p->sink, p->width, p->height, FF_PIXFMT_BGRA, &img) < 0) return -3;
+    decode_one(p);
+    int64_t index = p->pos;
+    fill(p, index, img.data[0], img.linesize[0]);
+    FFFrameRef* f = p->sink->commit(p->sink, &img, index / SYNTH_FPS, index);
+    if (!f) return -1;
+    if (p->cache) ff_cache_put(p->cache, f);
+    if (p->pack) ff_packcache_put(p->pack, f);
+    if (p->disk) ff_diskcache_put(p->disk, &p->disk_key, f);
+    p->pos++;
+    p->next_index = p->pos;
+    *out = f;
+    return 1;
+}
+
+int ff_next_frame_ref(FFPlayer* p, FFFrameRef** out) {
+    if (!p || !out) return -1;
+    return p->loop ? ff_loop_next(p->loop, out) : next_frame_ref(p, out);
+}
+
+static int source_next(void* opaque, FFFrameRef** out) {
+    return ff_next_frame_ref(opaque, out);
+}
+
+FFFrameSource ff_player_source(FFPlayer* p) {
+    FFFrameSource src = { source_next, p };
+    return src;
+}
+
+static int seek_decoder(FFPlayer* p, int64_t index) {
+    if (index < 0 || index >= p->frames) return -1;
+    if (!(p->region && index >= p->region_in && index <= p->region_out)) atomic_fetch_add(&g_seeks, 1);
+    p->pos        = index / p->gop * p->gop;
+    p->skip_until = index;
+    p->next_index = index;
+    p->dec_behind = 0;
+    return 0;
+}
+
+static int seek_frame(FFPlayer* p, int64_t index) {
+    if ((p->cache && ff_cache_contains(p->cache, index)) ||
+        (p->pack && ff_packcache_contains(p->pack, index)) ||
+        (p->disk && ff_diskcache_contains(p->disk, &p->disk_key, index)) ||
+        (p->use_proxy && ff_proxy_contains(p->proxy, index))) {
+        // Served from a cache; the decoder catches up only on a miss.
+        leave_decoder(p);
+        p->next_index = index;
+        return 0;
+    }
+    return seek_decoder(p, index);
+}
+
+int ff_seek_frame(FFPlayer* p, int64_t index) {
+    if (!p || index < 0 || index >= p->frames) return -1;
+    ff_loop_reset(p->loop);   // abandon a wrap in progress
+    return seek_frame(p, index);
+}
+
+// ---- Caches, as ffdecode.c consults them; the sink is left as it is ----
+
+int ff_set_frame_cache(FFPlayer* p, size_t budget_bytes, int pin_before, int pin_after) {
+    if (!p) return -1;
+    FFFrameCache* cache = NULL;
+    if (budget_bytes) {
+        FFFrameCacheConfig cc = { budget_bytes, pin_before, pin_after };
+        if (!(cache = ff_cache_create(&cc))) return -1;
+    }
+    if (p->dec_behind) resync_decoder(p);
+    ff_cache_destroy(p->cache);
+    p->cache = cache;
+    return 0;
+}
+
+FFFrameCache* ff_get_frame_cache(FFPlayer* p) {
+    return p ? p->cache : NULL;
+}
+
+int ff_set_pack_cache(FFPlayer* p, size_t budget_bytes, int readahead) {
+    if (!p) return -1;
+    FFPackCache* pack = NULL;
+    if (budget_bytes > 0) {
+        FFFramePoolConfig cfg = { .max_buffers = (readahead > 0 ? readahead : 4) + FF_POOL_DEFAULT_BUFFERS,
+                                  .wait_timeout_ms = FF_POOL_DEFAULT_TIMEOUT_MS };
+        FFFramePool* pool = ff_pool_create(&cfg);
+        FFFrameSink* sink = pool ? ff_sink_pool_create(pool) : NULL;
+        ff_pool_destroy(pool);
+        if (!sink) return -1;
+        FFPackCacheConfig pcfg = { .budget_bytes = budget_bytes, .readahead = readahead,
+                                   .queue_depth = SYNTH_PACK_QUEUE, .sink = sink };
+        if (!(pack = ff_packcache_create(&pcfg))) return -1;
+    }
+    if (p->dec_behind) resync_decoder(p);
+    ff_packcache_destroy(p->pack);
+    p->pack = pack;
+    return 0;
+}
+
+FFPackCache* ff_get_pack_cache(FFPlayer* p) {
+    return p ? p->pack : NULL;
+}
+
+int ff_set_disk_cache(FFPlayer* p, FFDiskCache* dc) {
+    if (!p) return -1;
+    if (dc) {
+        FFDiskCacheKey key = { .clip_id = p->clip_id, .width = p->width, .height = p->height,
+                               .format = FF_PIXFMT_BGRA };
+        p->disk_key = key;
+    }
+    if (p->disk && !dc && p->dec_behind) resync_decoder(p);
+    p->disk = dc;
+    return 0;
+}
+
+int ff_set_proxy(FFPlayer* p, FFProxy* px, int use) {
+    if (!p) return -1;
+    if (p->use_proxy && !(px && use) && p->dec_behind) resync_decoder(p);
+    p->proxy     = px;
+    p->use_proxy = px && use;
+    return 0;
+}
+
+// ---- Looping ----
+
+static int loop_source_next(void* opaque, FFFrameRef** out) {
+    return next_frame_ref(opaque, out);
+}
+
+static int loop_restart(void* opaque, int64_t index) {
+    return seek_frame(opaque, index);
+}
+
+// Stands in for reading the region's packets: the read leaves the demuxer
+// inside the region, and fails when synthetic_fail_region_reads says so.
+// On failure the previous region stays.
+static int region_collect(FFPlayer* p, int64_t in, int64_t out) {
+    p->pos        = in / p->gop * p->gop;
+    p->skip_until = p->pos;
+    if (atomic_load(&g_fail_region_reads) > 0) {
+        atomic_fetch_sub(&g_fail_region_reads, 1);
+        return -1;
+    }
+    p->region     = 1;
+    p->region_in  = in;
+    p->region_out = out;
+    return 0;
+}
+
+int ff_set_loop(FFPlayer* p, int enabled, int head_frames) {
+    if (!p) return -1;
+    int buffers = enabled ? (head_frames > 0 ? head_frames : FF_LOOP_HEAD_DEFAULT) : 0;
+    if (enabled ? p->loop && !p->loop_range && p->loop_buffers == buffers : !p->loop) return 0;
+    FFLoop* loop = NULL;
+    if (enabled) {
+        FFLoopConfig cfg = { .source = { loop_source_next, p }, .restart = loop_restart,
+                             .restart_opaque = p, .head_frames = head_frames };
+        loop = ff_loop_create(&cfg);
+        if (!loop) return -1;
+    }
+    ff_loop_destroy(p->loop);
+    p->loop         = loop;
+    p->loop_range   = 0;
+    p->region       = 0;
+    p->loop_buffers = buffers;
+    return 0;
+}
+
+int ff_set_loop_range(FFPlayer* p, int64_t in, int64_t out, size_t budget_bytes) {
+    if (!p || in < 0 || out < in || out >= p->frames) return -1;
+    int64_t n = out - in + 1;
+    size_t frame_bytes = (size_t)p->width * 4 * (size_t)p->height;
+    int resident = (size_t)n <= budget_bytes / frame_bytes;
+
+    // As in ffdecode.c: build the new loop and region first, and keep the old
+    // ones and the position if that fails.
+    if (p->loop) ff_loop_reset(p->loop);
+    int64_t resume = ff_next_frame_index(p);
+    FFLoopConfig cfg = { .source = { loop_source_next, p }, .restart = loop_restart,
+                         .restart_opaque = p, .head_frames = resident ? (int)n : 0,
+                         .first = in, .count = n };
+    FFLoop* loop = ff_loop_create(&cfg);
+    if (!loop) return -1;
+    int r = resident ? 0 : region_collect(p, in, out);
+    if (r < 0) {
+        ff_loop_destroy(loop);
+        seek_decoder(p, resume);
+        return r;
+    }
+
+    ff_loop_destroy(p->loop);
+    p->loop = loop;
+    p->loop_buffers = resident ? (int)n : FF_LOOP_HEAD_DEFAULT;
+    p->loop_range = 1;
+    if (resident) p->region = 0;
+    r = resident ? seek_frame(p, in) : seek_decoder(p, in);
+    if (r < 0) return r;
+    return resident ? FF_LOOP_RESIDENT_FRAMES : FF_LOOP_RESIDENT_PACKETS;
+}
+
+int ff_get_loop_stats(FFPlayer* p, FFLoopStats* out) {
+    if (!p || !p->loop || !out) return -1;
+    ff_loop_get_stats(p->loop, out);
+    return 0;
+}
+
+int ff_set_regions(FFPlayer* p, const FFRegion* regions, int count) {
+    if (!p || count < 0 || (count > 0 && !regions)) return -1;
+    FFRegion* resolved = count ? calloc((size_t)count, sizeof(*resolved)) : NULL;
+    if (count && !resolved) return -1;
+    for (int i = 0; i < count; ++i) {
+        if (ff_region_resolve(&regions[i], p->width, p->height, &resolved[i]) < 0) {
+            free(resolved);
+            return -1;
+        }
+    }
+    free(p->regions);
+    p->regions  = resolved;
+    p->nregions = count;
+    return 0;
+}
+
+int ff_get_region_count(FFPlayer* p) {
+    return p ? p->nregions : 0;
+}
+
+int ff_next_region_frames(FFPlayer* p, FFFrameRef** out, int max_out) {
+    if (!p || !out || p->nregions == 0 || max_out < p->nregions) return -1;
+    for (int i = 0; i < p->nregions; ++i) out[i] = NULL;
+    int r = advance(p);
+    if (r != 1) return r;
+    if (!p->scratch && !(p->scratch = malloc((size_t)p->width * 4 * p->height))) return -1;
+
+    FFSinkImage img[p->nregions];
+    int n = 0;
+    for (; n < p->nregions; ++n) {
+        if (p->sink->acquire(p->sink, p->regions[n].dst_w, p->regions[n].dst_h, FF_PIXFMT_BGRA, &img[n]) < 0) break;
+    }
+    if (n < p->nregions) {
+        while (n-- > 0) p->sink->discard(p->sink, &img[n]);
+        return -3;
+    }
+    decode_one(p);
+    int64_t index = p->pos;
+    fill(p, index, p->scratch, p->width * 4);
+    FFSourceImage src = { .layout = FF_SRC_BGRA, .data = { p->scratch }, .linesize = { p->width * 4 },
+                          .width = p->width, .height = p->height };
+    ff_convert_regions(NULL, &src, p->regions, p->nregions, img);
+    for (int i = 0; i < p->nregions; ++i) {
+        out[i] = p->sink->commit(p->sink, &img[i], index / SYNTH_FPS, index);
+        if (!out[i]) {
+            for (int j = 0; j < i; ++j) ff_frame_release(out[j]);
+            return -1;
+        }
+    }
+    p->pos++;
+    p->next_index = p->pos;
+    return 1;
+}
+
+int ff_next_source(FFPlayer* p, FFSourceImage* src, int64_t* index, double* pts_s) {
+    if (!p || !src) return -1;
+    int r = advance(p);
+    if (r != 1) return r;
+    if (!p->scratch && !(p->scratch = malloc((size_t)p->width * 4 * p->height))) return -1;
+    decode_one(p);
+    fill(p, p->pos, p->scratch, p->width * 4);
+    FFSourceImage s = { .layout = FF_SRC_BGRA, .data = { p->scratch }, .linesize = { p->width * 4 },
+                        .width = p->width, .height = p->height };
+    *src = s;
+    if (index) *index = p->pos;
+    if (pts_s) *pts_s = p->pos / SYNTH_FPS;
+    p->pos++;
+    p->next_index = p->pos;
+    return 1;
+}
+
+int ff_set_interrupt(FFPlayer* p, int (*cb)(void* opaque), void* opaque) {
+    if (!p) return -1;
+    p->interrupt        = cb;
+    p->interrupt_opaque = opaque;
+    return 0;
+}
+
+int64_t ff_next_frame_index(FFPlayer* p) {
+    if (!p) return -1;
+    return p->next_index;
+}
+
+double  ff_get_fps(FFPlayer* p)         { return p ? SYNTH_FPS : NAN; }
+int64_t ff_get_frame_count(FFPlayer* p) { return p ? p->frames : -1; }
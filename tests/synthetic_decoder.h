@@ -0,0 +1,25 @@
+#pragma once
+// Test double for the ffdecode.h player API, so code built on the decoder can be
+// tested without FFmpeg or media files. Paths look like
+//   "synthetic:WIDTH:HEIGHT:FRAMES:GOP[:COST_US]"
+// and decode to BGRA frames at 60 fps whose pixels encode the frame index (see
+// synthetic_pixel). Seeks land on the preceding multiple of GOP and decode forward,
+// each frame (returned or skipped) taking COST_US microseconds (default 0).
+// Looping (ff_set_loop, ff_set_loop_range) is wired up as in ffdecode.c; a
+// streamed loop region counts as held in memory, so seeks inside it are not
+// file seeks. The proxy and the frame, pack and disk caches are consulted as
+// in ffdecode.c; the disk cache keys a clip by a hash of its path, so players
+// opened with the same path share entries.
+#include <stdint.h>
+
+// Expected byte at (x, y) of frame `index`.
+static inline uint8_t synthetic_pixel(int64_t index, int x, int y, int channel) {
+    return (uint8_t)(index * 7 + x * 3 + y * 5 + channel);
+}
+
+// Frames produced by every synthetic player so far (including ones skipped after a seek).
+uint64_t synthetic_decode_count(void);
+// Seeks performed by every synthetic player so far.
+uint64_t synthetic_seek_count(void);
+// The next `n` loop-region reads (ff_set_loop_range past its frame budget) fail.
+void     synthetic_fail_region_reads(int n);
@@ -0,0 +1,243 @@
+#include "ffcache.h"
+#include "ffdecode.h"
+#include "ffframe.h"
+#include "ffpool.h"
+#include "synthetic_decoder.h"
+#include "test_util.h"
+#include <pthread.h>
+#include <string.h>
+
+static FFFrameRef* frame_at(int64_t index, int width) {
+    FFFrameRef* f = ff_frame_alloc(width, 4, FF_PIXFMT_BGRA);
+    CHECK(f);
+    ff_frame_set_timing(f, index / 60.0, index);
+    return f;
+}
+
+// Caches frame `index` and drops the caller's reference.
+static int put(FFFrameCache* c, int64_t index, int width) {
+    FFFrameRef* f = frame_at(index, width);
+    int r = ff_cache_put(c, f);
+    ff_frame_release(f);
+    return r;
+}
+
+static void test_hit_miss_and_lru(void) {
+    FFFrameRef* probe = frame_at(0, 16);
+    size_t fb = ff_frame_bytes(probe);
+    CHECK_EQ(fb, 64 * 4);   // 16 px * 4 bytes, 64-byte rows
+    ff_frame_release(probe);
+
+    FFFrameCacheConfig cfg = { .budget_bytes = 3 * fb };
+    FFFrameCache* c = ff_cache_create(&cfg);
+    CHECK(c);
+    CHECK(!ff_cache_get(c, 0));
+    for (int i = 0; i < 3; ++i) CHECK_EQ(put(c, i, 16), 1);
+
+    FFFrameRef* f = ff_cache_get(c, 0);   // 0 becomes most recent: 1 is now the oldest
+    CHECK(f);
+    CHECK_EQ(ff_frame_index(f), 0);
+    CHECK_EQ(ff_frame_refcount(f), 2);    // the cache's and ours
+    ff_frame_release(f);
+
+    CHECK_EQ(put(c, 3, 16), 1);
+    CHECK(!ff_cache_contains(c, 1));
+    CHECK(ff_cache_contains(c, 0) && ff_cache_contains(c, 2) && ff_cache_contains(c, 3));
+    CHECK_EQ(put(c, 3, 16), 1);           // already present: no new entry
+
+    FFFrameCacheStats st;
+    ff_cache_get_stats(c, &st);
+    CHECK_EQ(st.hits, 1);
+    CHECK_EQ(st.misses, 1);
+    CHECK_EQ(st.insertions, 4);
+    CHECK_EQ(st.evictions, 1);
+    CHECK_EQ(st.entries, 3);
+    CHECK_EQ(st.bytes, 3 * fb);
+    CHECK_EQ(st.high_water_bytes, 3 * fb);
+    CHECK_EQ(st.budget_bytes, 3 * fb);
+
+    // Nearest: exact, tie (earlier wins), beyond either end; stats untouched.
+    int64_t want[][2] = { { 2, 2 }, { 1, 0 }, { -5, 0 }, { 10, 3 } };
+    for (int i = 0; i < 4; ++i) {
+        f = ff_cache_get_nearest(c, want[i][0]);
+        CHECK(f);
+        CHECK_EQ(ff_frame_index(f), want[i][1]);
+        ff_frame_release(f);
+    }
+    ff_cache_get_stats(c, &st);
+    CHECK_EQ(st.hits, 1);
+    CHECK_EQ(st.misses, 1);
+
+    CHECK_EQ(put(c, 9, 64), 0);           // bigger than the whole budget
+    ff_cache_get_stats(c, &st);
+    CHECK_EQ(st.rejected, 1);
+    CHECK(ff_cache_contains(c, 0));       // nothing was evicted for it
+
+    ff_cache_destroy(c);
+}
+
+static void test_pinning(void) {
+    size_t fb = 64 * 4;
+    FFFrameCacheConfig cfg = { .budget_bytes = 4 * fb, .pin_before = 1, .pin_after = 2 };
+    FFFrameCache* c = ff_cache_create(&cfg);
+    ff_cache_set_playhead(c, 10);         // pins 9..12
+    for (int i = 9; i <= 12; ++i) CHECK_EQ(put(c, i, 16), 1);
+    FFFrameCacheStats st;
+    ff_cache_get_stats(c, &st);
+    CHECK_EQ(st.pinned, 4);
+
+    // Full of pinned frames: unpinned ones are refused, pinned ones still go in.
+    CHECK_EQ(put(c, 20, 16), 0);
+    ff_cache_set_playhead(c, 11);         // pins 10..13; 9 is now evictable
+    CHECK_EQ(put(c, 13, 16), 1);
+    CHECK(!ff_cache_contains(c, 9));
+    ff_cache_get_stats(c, &st);
+    CHECK_EQ(st.pinned, 4);
+    CHECK_EQ(st.entries, 4);
+
+    ff_cache_set_budget(c, 2 * fb);       // pinned frames stay even over budget
+    CHECK_EQ(ff_cache_shrink(c, 0), 0);
+    ff_cache_get_stats(c, &st);
+    CHECK_EQ(st.entries, 4);
+
+    // Moving the playhead away releases them down to the budget.
+    ff_cache_set_playhead(c, 100);
+    ff_cache_get_stats(c, &st);
+    CHECK_EQ(st.pinned, 0);
+    CHECK_EQ(st.bytes, 2 * fb);
+    CHECK(ff_cache_contains(c, 12) && ff_cache_contains(c, 13));   // most recent survive
+
+    CHECK_EQ(ff_cache_shrink(c, fb), fb);
+    ff_cache_clear(c);
+    ff_cache_get_stats(c, &st);
+    CHECK_EQ(st.entries, 0);
+    CHECK_EQ(st.bytes, 0);
+    ff_cache_destroy(c);
+}
+
+// Many entries (forces the index table to grow) and scrubbing back and forth
+// over a range that fits: after the first pass everything is a hit.
+static void test_scrub_range(void) {
+    FFFrameCacheConfig cfg = { .budget_bytes = 2000 * 64 * 4 };
+    FFFrameCache* c = ff_cache_create(&cfg);
+    for (int pass = 0; pass < 4; ++pass) {
+        for (int k = 0; k < 1500; ++k) {
+            int64_t i = pass % 2 ? 1499 - k : k;
+            FFFrameRef* f = ff_cache_get(c, i);
+            if (!f) {
+                CHECK_EQ(pass, 0);
+                CHECK_EQ(put(c, i, 16), 1);
+                continue;
+            }
+            CHECK_EQ(ff_frame_index(f), i);
+            ff_frame_release(f);
+        }
+    }
+    FFFrameCacheStats st;
+    ff_cache_get_stats(c, &st);
+    CHECK_EQ(st.misses, 1500);
+    CHECK_EQ(st.hits, 3 * 1500);
+    CHECK_EQ(st.evictions, 0);
+    ff_cache_destroy(c);
+}
+
+typedef struct Shared {
+    FFFrameCache* c;
+    int           seed;
+} Shared;
+
+static void* hammer(void* arg) {
+    Shared* s = arg;
+    unsigned x = (unsigned)s->seed * 2654435761u + 1;
+    for (int i = 0; i < 20000; ++i) {
+        x = x * 1103515245u + 12345u;
+        int64_t index = (x >> 8) % 300;
+        FFFrameRef* f = ff_cache_get(s->c, index);
+        if (f) {
+            CHECK_EQ(ff_frame_index(f), index);
+            ff_frame_release(f);
+        } else {
+            put(s->c, index, 16);
+        }
+        if (i % 1000 == 0) ff_cache_set_playhead(s->c, index);
+    }
+    return NULL;
+}
+
+static void test_concurrent(void) {
+    FFFrameCacheConfig cfg = { .budget_bytes = 100 * 64 * 4, .pin_before = 2, .pin_after = 2 };
+    FFFrameCache* c = ff_cache_create(&cfg);
+    pthread_t t[4];
+    Shared s[4];
+    for (int i = 0; i < 4; ++i) {
+        s[i].c = c;
+        s[i].seed = i;
+        CHECK_EQ(pthread_create(&t[i], NULL, hammer, &s[i]), 0);
+    }
+    for (int i = 0; i < 4; ++i) pthread_join(t[i], NULL);
+    FFFrameCacheStats st;
+    ff_cache_get_stats(c, &st);
+    CHECK_EQ(st.hits + st.misses, 80000);
+    CHECK(st.bytes <= 105 * 64 * 4);   // budget plus at most the pin window
+    ff_cache_destroy(c);
+}
+
+// Through a player: cached frames replace decodes, a seek to a cached frame
+// leaves the decoder where it is, and it picks up again at the first miss
+// without seeking.
+static void test_player(void) {
+    FFPlayer* p = ff_open("synthetic:16:8:300:30", NULL, NULL, NULL, NULL);
+    CHECK(p);
+    FFFramePoolConfig pc = { .max_buffers = 64, .wait_timeout_ms = 1000 };
+    FFFramePool* pool = ff_pool_create(&pc);
+    CHECK(pool);
+    CHECK_EQ(ff_set_sink(p, ff_sink_pool_create(pool)), 0);
+    ff_pool_destroy(pool);
+    CHECK(!ff_get_frame_cache(p));
+    CHECK_EQ(ff_set_frame_cache(p, 40 * 64 * 8, 0, 0), 0);   // 40 frames of 64-byte rows
+    FFFrameCache* c = ff_get_frame_cache(p);
+    CHECK(c);
+
+    FFFrameRef* f;
+    for (int i = 0; i < 20; ++i) {
+        CHECK_EQ(ff_next_frame_ref(p, &f), 1);
+        ff_frame_release(f);
+    }
+    uint64_t decoded = synthetic_decode_count(), seeks = synthetic_seek_count();
+    CHECK_EQ(ff_seek_frame(p, 5), 0);
+    for (int i = 5; i < 20; ++i) {
+        CHECK_EQ(ff_next_frame_ref(p, &f), 1);
+        CHECK_EQ(ff_frame_index(f), i);
+        CHECK_EQ(ff_frame_plane(f, 0)[1], synthetic_pixel(i, 0, 0, 1));
+        ff_frame_release(f);
+    }
+    CHECK_EQ(synthetic_decode_count(), decoded);
+    CHECK_EQ(synthetic_seek_count(), seeks);
+    FFFrameCacheStats st;
+    ff_cache_get_stats(c, &st);
+    CHECK_EQ(st.hits, 15);
+
+    CHECK_EQ(ff_next_frame_ref(p, &f), 1);   // miss: the decoder is right there
+    CHECK_EQ(ff_frame_index(f), 20);
+    ff_frame_release(f);
+    CHECK_EQ(synthetic_decode_count() - decoded, 1);
+    CHECK_EQ(synthetic_seek_count(), seeks);
+
+    CHECK_EQ(ff_set_frame_cache(p, 0, 0, 0), 0);
+    CHECK(!ff_get_frame_cache(p));
+    CHECK_EQ(ff_seek_frame(p, 5), 0);
+    CHECK_EQ(synthetic_seek_count() - seeks, 1);
+    ff_close(p);
+}
+
+int main(void) {
+    ff_frame_debug_enable(1);
+    test_hit_miss_and_lru();
+    test_pinning();
+    test_scrub_range();
+    test_concurrent();
+    test_player();
+    CHECK_EQ(ff_frame_debug_live_count(), 0);
+    printf("test_cache: ok\n");
+    return 0;
+}
@@ -0,0 +1,317 @@
+#include "ffconvert.h"
+#include "ffworkers.h"
+#include "test_util.h"
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+static int near(int a, int b, int tol) {
+    return abs(a - b) <= tol;
+}
+
+// ---- Workers ----
+
+typedef struct Hits {
+    atomic_int count[1000];
+} Hits;
+
+static void hit(void* ctx, int i) {
+    atomic_fetch_add(&((Hits*)ctx)->count[i], 1);
+}
+
+static void test_workers_run_each_task_once(void) {
+    FFWorkers* w = ff_workers_create(4);
+    CHECK(w);
+    CHECK_EQ(ff_workers_count(w), 4);
+    Hits* h = calloc(1, sizeof(*h));
+    for (int round = 0; round < 50; ++round) {
+        int n = 1 + round * 19 % 1000;
+        memset(h, 0, sizeof(*h));
+        ff_workers_run(w, n, hit, h);
+        for (int i = 0; i < 1000; ++i) CHECK_EQ(atomic_load(&h->count[i]), i < n ? 1 : 0);
+    }
+    ff_workers_run(NULL, 3, hit, h);   // inline without a pool
+    free(h);
+    ff_workers_destroy(w);
+}
+
+// ---- Colour ----
+
+static void yuv8_pixel(int bits, int full, FFColorMatrix m, int y, int u, int v, int a, uint8_t out[4]) {
+    uint16_t Y = (uint16_t)y, U = (uint16_t)u, V = (uint16_t)v, A = (uint16_t)a;
+    uint8_t y8 = (uint8_t)y, u8 = (uint8_t)u, v8 = (uint8_t)v, a8 = (uint8_t)a;
+    FFSourceImage s;
+    memset(&s, 0, sizeof(s));
+    s.layout = FF_SRC_YUV;
+    s.bits = bits;
+    s.full_range = full;
+    s.matrix = m;
+    s.width = s.height = 1;
+    if (bits == 8) {
+        s.data[0] = &y8; s.data[1] = &u8; s.data[2] = &v8; s.data[3] = a >= 0 ? &a8 : NULL;
+    } else {
+        s.data[0] = (uint8_t*)&Y; s.data[1] = (uint8_t*)&U; s.data[2] = (uint8_t*)&V;
+        s.data[3] = a >= 0 ? (uint8_t*)&A : NULL;
+    }
+    for (int i = 0; i < 4; ++i) s.linesize[i] = 2;
+    FFRegion r;
+    FFRegion in = { 0, 0, 1, 1, 0, 0, FF_XFORM_NONE };
+    CHECK_EQ(ff_region_resolve(&in, 1, 1, &r), 0);
+    ff_convert_region_rows(&s, &r, out, 4, 0, 1);
+}
+
+static void test_colour(void) {
+    uint8_t px[4];
+    yuv8_pixel(8, 0, FF_MATRIX_BT709, 16, 128, 128, -1, px);       // limited black
+    CHECK(px[0] == 0 && px[1] == 0 && px[2] == 0 && px[3] == 255);
+    yuv8_pixel(8, 0, FF_MATRIX_BT709, 235, 128, 128, -1, px);      // limited white
+    CHECK(px[0] == 255 && px[1] == 255 && px[2] == 255);
+    yuv8_pixel(8, 1, FF_MATRIX_BT709, 128, 128, 128, 77, px);      // full-range grey
+    CHECK(px[0] == 128 && px[1] == 128 && px[2] == 128 && px[3] == 77);
+    yuv8_pixel(8, 0, FF_MATRIX_BT709, 63, 102, 240, -1, px);       // BT.709 red
+    CHECK(near(px[2], 255, 2) && near(px[1], 0, 2) && near(px[0], 0, 2));
+    yuv8_pixel(8, 0, FF_MATRIX_BT601, 81, 90, 240, -1, px);        // BT.601 red
+    CHECK(near(px[2], 255, 2) && near(px[1], 0, 2) && near(px[0], 0, 2));
+    // 12-bit limited (NotchLC decodes to yuva444p12): same colours, alpha scaled down.
+    yuv8_pixel(12, 0, FF_MATRIX_BT709, 63 << 4, 102 << 4, 240 << 4, 4095, px);
+    CHECK(near(px[2], 255, 2) && near(px[1], 0, 2) && near(px[0], 0, 2) && px[3] == 255);
+    yuv8_pixel(12, 0, FF_MATRIX_BT709, 235 << 4, 2048, 2048, 2048, px);
+    CHECK(px[0] == 255 && px[3] == 128);
+}
+
+// ---- Geometry ----
+
+// Packed source whose pixel (x, y) is (x, y, 0x5a, 255).
+static FFSourceImage coord_image(int w, int h, uint8_t** mem) {
+    *mem = malloc((size_t)w * h * 4);
+    for (int y = 0; y < h; ++y)
+        for (int x = 0; x < w; ++x) {
+            uint8_t* p = *mem + ((size_t)y * w + x) * 4;
+            p[0] = (uint8_t)x; p[1] = (uint8_t)y; p[2] = 0x5a; p[3] = 255;
+        }
+    FFSourceImage s;
+    memset(&s, 0, sizeof(s));
+    s.layout = FF_SRC_BGRA;
+    s.data[0] = *mem;
+    s.linesize[0] = w * 4;
+    s.width = w;
+    s.height = h;
+    return s;
+}
+
+// Source coordinates the output pixel (ox, oy) of region r came from.
+static void sample(const FFSourceImage* s, const FFRegion* in, int ox, int oy, int* sx, int* sy) {
+    FFRegion r;
+    CHECK_EQ(ff_region_resolve(in, s->width, s->height, &r), 0);
+    uint8_t* out = malloc((size_t)r.dst_w * r.dst_h * 4);
+    ff_convert_region_rows(s, &r, out, r.dst_w * 4, 0, r.dst_h);
+    const uint8_t* p = out + ((size_t)oy * r.dst_w + ox) * 4;
+    *sx = p[0];
+    *sy = p[1];
+    CHECK_EQ(p[2], 0x5a);
+    free(out);
+}
+
+static void test_transforms(void) {
+    uint8_t* mem;
+    FFSourceImage s = coord_image(64, 48, &mem);
+    FFRegion r = { 10, 20, 8, 4, 0, 0, FF_XFORM_NONE };   // 8 wide, 4 tall at (10, 20)
+    int x, y;
+
+    sample(&s, &r, 0, 0, &x, &y);  CHECK(x == 10 && y == 20);
+    sample(&s, &r, 7, 3, &x, &y);  CHECK(x == 17 && y == 23);
+
+    r.transform = FF_XFORM_ROT90;   // 4 x 8 output; top-left shows the bottom-left source pixel
+    FFRegion rr;
+    ff_region_resolve(&r, 64, 48, &rr);
+    CHECK(rr.dst_w == 4 && rr.dst_h == 8);
+    sample(&s, &r, 0, 0, &x, &y);  CHECK(x == 10 && y == 23);
+    sample(&s, &r, 3, 0, &x, &y);  CHECK(x == 10 && y == 20);
+    sample(&s, &r, 0, 7, &x, &y);  CHECK(x == 17 && y == 23);
+
+    r.transform = FF_XFORM_ROT180;
+    sample(&s, &r, 0, 0, &x, &y);  CHECK(x == 17 && y == 23);
+
+    r.transform = FF_XFORM_ROT270;  // top-left shows the top-right source pixel
+    sample(&s, &r, 0, 0, &x, &y);  CHECK(x == 17 && y == 20);
+    sample(&s, &r, 3, 7, &x, &y);  CHECK(x == 10 && y == 23);
+
+    r.transform = FF_XFORM_FLIP_H;
+    sample(&s, &r, 0, 1, &x, &y);  CHECK(x == 17 && y == 21);
+    r.transform = FF_XFORM_FLIP_V;
+    sample(&s, &r, 0, 0, &x, &y);  CHECK(x == 10 && y == 23);
+
+    // Downscale by 2 samples every other pixel.
+    FFRegion half = { 0, 0, 16, 16, 8, 8, FF_XFORM_NONE };
+    sample(&s, &half, 3, 5, &x, &y);  CHECK(x == 6 && y == 10);
+    // Upscale by 2 repeats pixels.
+    FFRegion twice = { 4, 4, 4, 4, 8, 8, FF_XFORM_NONE };
+    sample(&s, &twice, 5, 3, &x, &y); CHECK(x == 6 && y == 5);
+
+    FFRegion bad = { 60, 0, 8, 8, 0, 0, FF_XFORM_NONE };
+    CHECK(ff_region_resolve(&bad, 64, 48, &rr) < 0);
+    free(mem);
+}
+
+// ---- Blending ----
+
+static FFSourceImage bgra_image(uint8_t* px, int w, int h) {
+    FFSourceImage s;
+    memset(&s, 0, sizeof(s));
+    s.layout = FF_SRC_BGRA;
+    s.data[0] = px;
+    s.linesize[0] = w * 4;
+    s.width = w;
+    s.height = h;
+    return s;
+}
+
+static void blend_into(const FFSourceImage* a, const FFSourceImage* b, int mix, int alpha_aware,
+                       uint8_t* out, int w, int h) {
+    FFBlend bl = { mix, alpha_aware };
+    FFSinkImage d;
+    memset(&d, 0, sizeof(d));
+    d.data[0] = out;
+    d.linesize[0] = w * 4;
+    d.width = w;
+    d.height = h;
+    CHECK_EQ(ff_convert_blend(NULL, a, b, &bl, &d, NULL), 0);
+}
+
+static void test_blend(void) {
+    enum { W = 8, H = 4 };
+    uint8_t pa[W * H * 4], pb[W * H * 4], out[W * H * 4];
+    for (int i = 0; i < W * H * 4; ++i) {
+        pa[i] = (uint8_t)(i * 3);
+        pb[i] = (uint8_t)(255 - i);
+    }
+    FFSourceImage a = bgra_image(pa, W, H), b = bgra_image(pb, W, H);
+
+    blend_into(&a, &b, 0, 0, out, W, H);
+    CHECK(memcmp(out, pa, sizeof(out)) == 0);
+    blend_into(&a, &b, 256, 0, out, W, H);
+    CHECK(memcmp(out, pb, sizeof(out)) == 0);
+    blend_into(&a, &b, 64, 0, out, W, H);
+    for (int i = 0; i < W * H * 4; ++i) CHECK(near(out[i], (pa[i] * 3 + pb[i]) / 4, 1));
+
+    // Alpha-aware: a transparent pixel lends no colour, only its alpha.
+    for (int i = 0; i < W * H; ++i) {
+        uint8_t ca[4] = { 200, 100, 0, 0 }, cb[4] = { 10, 20, 30, 255 };
+        memcpy(pa + i * 4, ca, 4);
+        memcpy(pb + i * 4, cb, 4);
+    }
+    blend_into(&a, &b, 128, 1, out, W, H);
+    CHECK(out[0] == 10 && out[1] == 20 && out[2] == 30 && out[3] == 128);
+    blend_into(&a, &b, 128, 0, out, W, H);
+    CHECK(out[0] == 105 && out[1] == 60 && out[2] == 15 && out[3] == 128);
+    // Opaque on both sides: the same as the plain mix.
+    for (int i = 0; i < W * H; ++i) pa[i * 4 + 3] = 255;
+    uint8_t plain[W * H * 4];
+    blend_into(&a, &b, 77, 0, plain, W, H);
+    blend_into(&a, &b, 77, 1, out, W, H);
+    CHECK(memcmp(out, plain, sizeof(out)) == 0);
+
+    // A YUV source is converted on the fly exactly as the region path does,
+    // and sources of another size are point-sampled to the output.
+    enum { YW = 2 * W, YH = 2 * H };
+    uint8_t yp[YW * YH], up[YW * YH / 4], vp[YW * YH / 4];
+    for (int i = 0; i < YW * YH; ++i) yp[i] = (uint8_t)(16 + i * 5 % 219);
+    for (int i = 0; i < YW * YH / 4; ++i) {
+        up[i] = (uint8_t)(40 + i * 11 % 170);
+        vp[i] = (uint8_t)(200 - i * 7 % 150);
+    }
+    FFSourceImage y;
+    memset(&y, 0, sizeof(y));
+    y.layout = FF_SRC_YUV;
+    y.bits = 8;
+    y.width = YW;
+    y.height = YH;
+    y.log2_chroma_w = y.log2_chroma_h = 1;
+    y.data[0] = yp; y.data[1] = up; y.data[2] = vp;
+    y.linesize[0] = YW; y.linesize[1] = y.linesize[2] = YW / 2;
+    FFRegion full;
+    FFRegion in = { 0, 0, YW, YH, W, H, FF_XFORM_NONE };
+    CHECK_EQ(ff_region_resolve(&in, YW, YH, &full), 0);
+    uint8_t ref[W * H * 4];
+    ff_convert_region_rows(&y, &full, ref, W * 4, 0, H);
+    blend_into(&y, &b, 0, 1, out, W, H);
+    for (int i = 0; i < W * H * 4; ++i) CHECK(near(out[i], ref[i], 1));
+    uint8_t out2[W * H * 4];
+    blend_into(&b, &y, 256, 0, out2, W, H);
+    CHECK(memcmp(out, out2, sizeof(out)) == 0);
+}
+
+// ---- Many regions across threads, compared with a single-threaded reference ----
+
+static void test_parallel_regions_match(void) {
+    const int W = 3840, H = 2160, NR = 24;
+    size_t ysz = (size_t)W * H;
+    uint16_t* planes = malloc(ysz * 2 * 4);
+    for (size_t i = 0; i < ysz; ++i) {
+        planes[i]           = (uint16_t)(256 + (i * 7) % 3500);
+        planes[ysz + i]     = (uint16_t)(256 + (i * 13) % 3500);
+        planes[2 * ysz + i] = (uint16_t)(256 + (i * 5) % 3500);
+        planes[3 * ysz + i] = (uint16_t)(i % 4096);
+    }
+    FFSourceImage s;
+    memset(&s, 0, sizeof(s));
+    s.layout = FF_SRC_YUV;
+    s.bits = 12;
+    s.width = W;
+    s.height = H;
+    for (int c = 0; c < 4; ++c) {
+        s.data[c] = (const uint8_t*)(planes + c * ysz);
+        s.linesize[c] = W * 2;
+    }
+
+    // A 6x4 grid of tiles, every other one rotated, some scaled.
+    FFRegion regions[24];
+    FFSinkImage a[24], b[24];
+    for (int i = 0; i < NR; ++i) {
+        FFRegion in = { (i % 6) * 640, (i / 6) * 540, 640, 540, 0, 0, (FFRegionTransform)(i % 6) };
+        if (i % 5 == 0) { in.dst_w = 320; in.dst_h = 270; }
+        CHECK_EQ(ff_region_resolve(&in, W, H, &regions[i]), 0);
+        memset(&a[i], 0, sizeof(a[i]));
+        memset(&b[i], 0, sizeof(b[i]));
+        a[i].linesize[0] = b[i].linesize[0] = regions[i].dst_w * 4;
+        a[i].data[0] = malloc((size_t)a[i].linesize[0] * regions[i].dst_h);
+        b[i].data[0] = malloc((size_t)b[i].linesize[0] * regions[i].dst_h);
+    }
+
+    double t0 = now_ms();
+    ff_convert_regions(NULL, &s, regions, NR, a);
+    double single = now_ms() - t0;
+
+    FFWorkers* w = ff_workers_create(0);
+    ff_convert_regions(w, &s, regions, NR, b);   // warm up the threads
+    t0 = now_ms();
+    ff_convert_regions(w, &s, regions, NR, b);
+    double multi = now_ms() - t0;
+
+    for (int i = 0; i < NR; ++i) {
+        CHECK(memcmp(a[i].data[0], b[i].data[0], (size_t)a[i].linesize[0] * regions[i].dst_h) == 0);
+        free(a[i].data[0]);
+        free(b[i].data[0]);
+    }
+    printf("convert: %d regions of a %dx%d yuva444p12 frame: 1 thread %.1f ms, %d threads %.1f ms\n",
+           NR, W, H, single, ff_workers_count(w), multi);
+    ff_workers_destroy(w);
+    free(planes);
+}
+
+int main(void) {
+    test_workers_run_each_task_once();
+    test_colour();
+    test_transforms();
+    test_blend();
+    test_parallel_regions_match();
+    printf("test_convert: ok\n");
+    return 0;
+}
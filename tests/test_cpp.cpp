@@ -0,0 +1,193 @@
+// C++ wrapper (notchplayer.hpp): ownership, errors, plane views, and
+// microbenchmarks against the same work done through the C API. Built as C++20
+// (std::span) and C++17 (the wrapper's own span).
+#include "notchplayer.hpp"
+#include "synthetic_decoder.h"
+#include "test_util.h"
+#include <cstring>
+#include <ctime>
+#include <type_traits>
+
+static_assert(!std::is_copy_constructible_v<notch::Frame>, "Frame is move-only");
+static_assert(!std::is_copy_assignable_v<notch::Frame>, "Frame is move-only");
+static_assert(std::is_nothrow_move_constructible_v<notch::Frame>, "");
+static_assert(!std::is_copy_constructible_v<notch::Player>, "Player is move-only");
+static_assert(std::is_nothrow_move_constructible_v<notch::Player>, "");
+static_assert(sizeof(notch::Frame) == sizeof(void*), "");
+
+static double now_ns() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void test_open_error() {
+    auto p = notch::Player::open("not-a-clip");
+    CHECK(!p);
+    CHECK(!p.has_value());
+    CHECK_EQ(p.error().code, -1);
+    CHECK(!p.error().would_block());
+}
+
+static void test_frames_and_planes() {
+    ff_frame_debug_enable(1);
+    {
+        auto opened = notch::Player::open("synthetic:24:8:6:3");
+        CHECK(opened);
+        notch::Player player = std::move(*opened);
+        CHECK(player);
+        CHECK(!*opened);   // moved-from handle is empty
+        CHECK_EQ(player.info().width, 24);
+        CHECK_EQ(player.info().height, 8);
+        CHECK_EQ(player.frame_count(), 6);
+
+        notch::Frame kept;
+        for (int i = 0; i < 6; ++i) {
+            auto f = player.next_frame();
+            CHECK(f);
+            CHECK(*f);
+            CHECK_EQ(f->index(), i);
+            notch::PlaneView pv = f->plane(0);
+            CHECK_EQ(pv.row_bytes, 24 * 4);
+            CHECK_EQ(pv.bytes().size(), (size_t)pv.stride * 7 + 24 * 4);
+            for (int y = 0; y < f->height(); ++y) {
+                notch::span<const uint8_t> row = pv.row(y);
+                CHECK_EQ(row.size(), 24 * 4);
+                for (size_t b = 0; b < row.size(); ++b)
+                    CHECK_EQ(row[b], synthetic_pixel(i, (int)b / 4, y, (int)b % 4));
+            }
+            if (i == 2) {
+                kept = f->share();
+                CHECK_EQ(kept.refcount(), 2);
+            }
+        }
+        auto end = player.next_frame();
+        CHECK(end);
+        CHECK(!*end);   // end of stream
+        CHECK_EQ(kept.index(), 2);
+        CHECK_EQ(kept.refcount(), 1);
+
+        // Ownership can be handed back to C and taken again.
+        FFFrameRef* raw = kept.release();
+        CHECK(!kept);
+        notch::Frame again = notch::Frame::adopt(raw);
+        CHECK_EQ(again.index(), 2);
+
+        CHECK(player.seek(4));
+        CHECK_EQ(player.next_index(), 4);
+        CHECK_EQ(player.next_frame()->index(), 4);
+        CHECK(!player.seek(99));
+        CHECK_EQ(player.seek(99).error().code, -1);
+
+        notch::Player other;
+        other = std::move(player);   // the moved-to player keeps the stream position
+        CHECK_EQ(other.next_frame()->index(), 5);
+    }
+    CHECK_EQ(ff_frame_debug_live_count(), 0);
+    ff_frame_debug_enable(0);
+}
+
+// ---- Microbenchmarks ----
+
+// Runs the C and C++ versions alternately (so neither benefits from going
+// second) and keeps the best time per operation of each. The C++ side must
+// stay within 1.5x of C plus a few ns (CHECK_BENCH: NOTCH_BENCH=1 only).
+template <class C, class Cpp> static void compare(int ops, C&& run_c, Cpp&& run_cpp, double* c, double* cpp) {
+    *c = *cpp = 1e30;
+    for (int rep = 0; rep < 9; ++rep) {
+        double t0 = now_ns();
+        run_c();
+        double t1 = now_ns();
+        run_cpp();
+        double t2 = now_ns();
+        if ((t1 - t0) / ops < *c) *c = (t1 - t0) / ops;
+        if ((t2 - t1) / ops < *cpp) *cpp = (t2 - t1) / ops;
+    }
+}
+
+static volatile int64_t g_sink;
+
+static void bench_decode_loop() {
+    const int n = 20000;
+    const char* clip = "synthetic:1:1:20000:1";   // 1x1 frames: the loop is all call overhead
+    FFPlayer* cp = ff_open(clip, NULL, NULL, NULL, NULL);
+    auto player = notch::Player::open(clip);
+    CHECK(cp && player);
+    double c, cpp;
+    compare(n, [&] {
+        CHECK_EQ(ff_seek_frame(cp, 0), 0);
+        FFFrameRef* f = NULL;
+        int64_t sum = 0;
+        while (ff_next_frame_ref(cp, &f) == 1) {
+            sum += ff_frame_index(f);
+            ff_frame_release(f);
+        }
+        g_sink = sum;
+    }, [&] {
+        CHECK(player->seek(0));
+        int64_t sum = 0;
+        for (;;) {
+            auto f = player->next_frame();
+            if (!f || !*f) break;
+            sum += f->index();
+        }
+        g_sink = sum;
+    }, &c, &cpp);
+    printf("cpp: next_frame loop  C %.1f ns/frame, C++ %.1f ns/frame\n", c, cpp);
+    CHECK_BENCH(cpp < c * 1.5 + 20);
+    ff_close(cp);
+}
+
+static void bench_plane_scan() {
+    FFFrameRef* raw = ff_frame_alloc(1920, 1080, FF_PIXFMT_BGRA);
+    CHECK(raw);
+    for (int y = 0; y < 1080; ++y) memset(ff_frame_plane(raw, 0) + (size_t)y * ff_frame_stride(raw, 0), y, 1920 * 4);
+    notch::Frame frame = notch::Frame::adopt(ff_frame_retain(raw));
+    const int bytes = 1920 * 1080 * 4;
+
+    double c, cpp;
+    compare(bytes, [&] {
+        uint32_t sum = 0;
+        const uint8_t* base = ff_frame_plane(raw, 0);
+        int stride = ff_frame_stride(raw, 0), row = ff_frame_width(raw) * 4, h = ff_frame_height(raw);
+        for (int y = 0; y < h; ++y) {
+            const uint8_t* r = base + (size_t)y * stride;
+            for (int x = 0; x < row; ++x) sum += r[x];
+        }
+        g_sink = sum;
+    }, [&] {
+        uint32_t sum = 0;
+        notch::PlaneView pv = frame.plane(0);
+        for (int y = 0; y < pv.height; ++y)
+            for (uint8_t b : pv.row(y)) sum += b;
+        g_sink = sum;
+    }, &c, &cpp);
+    printf("cpp: plane scan       C %.3f ns/byte, C++ %.3f ns/byte\n", c, cpp);
+    CHECK_BENCH(cpp < c * 1.5 + 0.05);
+    ff_frame_release(raw);
+}
+
+static void bench_share() {
+    const int n = 1000000;
+    FFFrameRef* raw = ff_frame_alloc(4, 4, FF_PIXFMT_BGRA);
+    notch::Frame frame = notch::Frame::adopt(ff_frame_retain(raw));
+    double c, cpp;
+    compare(n, [&] {
+        for (int i = 0; i < n; ++i) ff_frame_release(ff_frame_retain(raw));
+    }, [&] {
+        for (int i = 0; i < n; ++i) notch::Frame s = frame.share();
+    }, &c, &cpp);
+    printf("cpp: retain/release   C %.1f ns, C++ %.1f ns\n", c, cpp);
+    CHECK_BENCH(cpp < c * 1.5 + 5);
+    ff_frame_release(raw);
+}
+
+int main() {
+    test_open_error();
+    test_frames_and_planes();
+    bench_decode_loop();
+    bench_plane_scan();
+    bench_share();
+    printf("test_cpp (C++%ld): ok\n", __cplusplus / 100 % 100);
+    return 0;
+}
@@ -0,0 +1,226 @@
+#include "ffcue.h"
+#include "ffutil.h"
+#include "synthetic_decoder.h"
+#include "test_util.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <string.h>
+
+// Synthetic clips at 60 fps; each frame takes 3 ms to decode.
+enum { W = 32, H = 18, COST_US = 3000 };
+
+#define FRAME_NS 16666667LL
+
+static FFCueStack* make(const FFCueConfig* cfg, const int* lengths, int n) {
+    FFCueStack* cs = ff_cue_create(cfg);
+    CHECK(cs);
+    for (int i = 0; i < n; ++i) {
+        char path[64];
+        snprintf(path, sizeof(path), "synthetic:%d:%d:%d:10:%d", W, H, lengths[i], COST_US);
+        CHECK_EQ(ff_cue_add(cs, path), i);
+    }
+    CHECK_EQ(ff_cue_count(cs), n);
+    return cs;
+}
+
+static int check_frame(const FFFrameRef* f, int64_t clip_index) {
+    const uint8_t* px = ff_frame_plane(f, 0);
+    return ff_frame_index(f) == clip_index && px[0] == synthetic_pixel(clip_index, 0, 0, 0);
+}
+
+static void expect_frame(FFCueStack* cs, int cue, int64_t index, int held) {
+    FFFrameRef* f;
+    FFCuePos pos;
+    CHECK_EQ(ff_cue_next(cs, &f, &pos), 1);
+    CHECK_EQ(pos.cue, cue);
+    CHECK_EQ(pos.held, held);
+    CHECK(check_frame(f, index));
+    ff_frame_release(f);
+}
+
+// Arming runs ahead of the standby cue; GO swaps on the next frame; a cue
+// that ends holds its last frame until the next GO.
+static void test_go(void) {
+    const int len[] = { 5, 40, 40, 40 };
+    FFCueConfig cfg = { .armed = 2 };
+    FFCueStack* cs = make(&cfg, len, 4);
+    FFFrameRef* f;
+    CHECK_EQ(ff_cue_next(cs, &f, NULL), 0);   // nothing live yet
+    CHECK(!f);
+    CHECK_EQ(ff_cue_live(cs), -1);
+    CHECK_EQ(ff_cue_standby(cs), 0);
+    CHECK(ff_cue_wait_armed(cs, 2000));
+    CHECK(ff_cue_is_armed(cs, 0) && ff_cue_is_armed(cs, 1));
+    CHECK(!ff_cue_is_armed(cs, 2));
+
+    CHECK_EQ(ff_cue_go(cs), 0);
+    // GO starts arming cue 2; let it finish so the count below is cue 0's.
+    CHECK(ff_cue_wait_armed(cs, 2000));
+    uint64_t decoded = synthetic_decode_count();
+    for (int i = 0; i < 5; ++i) expect_frame(cs, 0, i, 0);
+    CHECK_EQ(synthetic_decode_count() - decoded, 1);   // four of them were armed
+    expect_frame(cs, 0, 4, 1);
+    expect_frame(cs, 0, 4, 1);
+    CHECK_EQ(ff_cue_live(cs), 0);
+    CHECK_EQ(ff_cue_standby(cs), 1);
+    CHECK(ff_cue_wait_armed(cs, 2000));
+    CHECK(ff_cue_is_armed(cs, 2));
+
+    CHECK_EQ(ff_cue_go(cs), 1);
+    expect_frame(cs, 1, 0, 0);
+    expect_frame(cs, 1, 1, 0);
+    CHECK_EQ(ff_cue_live(cs), 1);
+
+    // Out of order: back to cue 0, which is armed again first.
+    CHECK_EQ(ff_cue_go_to(cs, 7), -1);
+    CHECK_EQ(ff_cue_go_to(cs, 0), 0);
+    CHECK(ff_cue_wait_armed(cs, 2000));
+    expect_frame(cs, 0, 0, 0);
+    CHECK_EQ(ff_cue_standby(cs), 1);
+    CHECK(ff_cue_wait_armed(cs, 2000));
+    CHECK(!ff_cue_is_armed(cs, 3));   // out of the armed window again
+
+    FFCueStats st;
+    ff_cue_get_stats(cs, &st);
+    CHECK_EQ(st.gos, 3);
+    CHECK_EQ(st.armed, 2);
+    CHECK_EQ(st.unarmed, 1);
+    CHECK(st.arm_ns_last >= 4 * COST_US * 1000LL);
+    ff_cue_destroy(cs);
+}
+
+// Looping cues start over; cues that cannot be armed drop their GO and the
+// live cue plays on.
+static void test_loop_and_failure(void) {
+    FFCueConfig cfg = { .loop = 1 };
+    const int len[] = { 3 };
+    FFCueStack* cs = make(&cfg, len, 1);
+    CHECK_EQ(ff_cue_add(cs, "synthetic:broken"), 1);
+    CHECK(ff_cue_wait_armed(cs, 2000));
+    CHECK_EQ(ff_cue_go(cs), 0);
+    for (int i = 0; i < 7; ++i) expect_frame(cs, 0, i % 3, 0);
+    CHECK(ff_cue_wait_armed(cs, 2000));
+    CHECK_EQ(ff_cue_go(cs), 1);
+    CHECK(ff_cue_wait_armed(cs, 2000));   // tried again on GO, and failed again
+    expect_frame(cs, 0, 1, 0);
+    CHECK_EQ(ff_cue_go(cs), -1);   // nothing after it
+    FFCueStats st;
+    ff_cue_get_stats(cs, &st);
+    CHECK_EQ(st.failed, 1);
+    CHECK_EQ(st.gos, 1);
+    CHECK_EQ(ff_cue_live(cs), 0);
+    ff_cue_destroy(cs);
+}
+
+// Fails the first `*fails` prepares, as a clip still being copied in would.
+static int flaky_prepare(void* opaque, FFPlayer* p, const char* path) {
+    atomic_int* fails = opaque;
+    return atomic_fetch_sub(fails, 1) > 0 ? -1 : 0;
+}
+
+// A cue that failed to arm is armed again when it is fired.
+static void test_retry_failed(void) {
+    atomic_int fails;
+    atomic_init(&fails, 2);
+    FFCueConfig cfg = { .preroll = { .prepare = flaky_prepare, .opaque = &fails }, .armed = 1 };
+    const int len[] = { 10 };
+    FFCueStack* cs = make(&cfg, len, 1);
+    CHECK(ff_cue_wait_armed(cs, 2000));
+    CHECK(!ff_cue_is_armed(cs, 0));   // first try failed
+    CHECK_EQ(ff_cue_go(cs), 0);
+    CHECK(ff_cue_wait_armed(cs, 2000));
+    FFFrameRef* f;
+    CHECK_EQ(ff_cue_next(cs, &f, NULL), 0);   // second try failed: GO dropped
+    CHECK_EQ(ff_cue_go_to(cs, 0), 0);
+    CHECK(ff_cue_wait_armed(cs, 2000));
+    expect_frame(cs, 0, 0, 0);
+    FFCueStats st;
+    ff_cue_get_stats(cs, &st);
+    CHECK_EQ(st.failed, 1);
+    CHECK_EQ(st.gos, 1);
+    CHECK_EQ(ff_cue_live(cs), 0);
+    ff_cue_destroy(cs);
+}
+
+// A live output at 60 Hz and a trigger thread firing GO at arbitrary points
+// within the frame, as a show controller would.
+typedef struct Show {
+    FFCueStack* cs;
+    atomic_int  stop;
+    int         cues;
+    int         wrong;         // first frame after a swap that was not frame 0
+} Show;
+
+static void* output_main(void* arg) {
+    Show* s = arg;
+    int64_t next = ff_now_ns();
+    int live = -1;
+    while (!atomic_load(&s->stop)) {
+        FFFrameRef* f;
+        FFCuePos pos;
+        if (ff_cue_next(s->cs, &f, &pos) == 1) {
+            if (pos.cue != live && !check_frame(f, 0)) s->wrong++;
+            live = pos.cue;
+            ff_frame_release(f);
+        }
+        next += FRAME_NS;
+        ff_sleep_until_ns(next);
+    }
+    return NULL;
+}
+
+static void run_show(int armed, FFCueStats* st) {
+    const int len[] = { 600, 600, 600, 600, 600, 600, 600 };
+    FFCueConfig cfg = { .armed = armed };
+    Show s = { .cs = make(&cfg, len, 7), .cues = 7 };
+    atomic_init(&s.stop, 0);
+    CHECK(ff_cue_wait_armed(s.cs, 2000));
+    pthread_t out;
+    CHECK_EQ(pthread_create(&out, NULL, output_main, &s), 0);
+    // Trigger source: GO at uneven offsets against the output's frames.
+    for (int i = 0; i < s.cues; ++i) {
+        ff_sleep_until_ns(ff_now_ns() + 5 * FRAME_NS + (i * 7 % 11) * FRAME_NS / 11);
+        CHECK_EQ(ff_cue_go(s.cs), i);
+        if (armed > 0) {
+            ff_sleep_until_ns(ff_now_ns() + 2 * FRAME_NS);
+            CHECK(ff_cue_wait_armed(s.cs, 2000));
+        }
+    }
+    ff_sleep_until_ns(ff_now_ns() + 4 * FRAME_NS);
+    atomic_store(&s.stop, 1);
+    pthread_join(out, NULL);
+    CHECK_EQ(s.wrong, 0);
+    CHECK_EQ(ff_cue_live(s.cs), 6);
+    ff_cue_get_stats(s.cs, st);
+    ff_cue_destroy(s.cs);
+}
+
+static void test_trigger_latency(void) {
+    FFCueStats armed, cold;
+    run_show(2, &armed);
+    run_show(-1, &cold);
+    printf("cue trigger to first frame: armed avg %.2f ms max %.2f ms (swap max %.3f ms), "
+           "unarmed avg %.2f ms max %.2f ms\n", armed.trigger_ns_avg / 1e6, armed.trigger_ns_max / 1e6,
+           armed.swap_ns_max / 1e6, cold.trigger_ns_avg / 1e6, cold.trigger_ns_max / 1e6);
+    CHECK_EQ(armed.gos, 7);
+    CHECK_EQ(armed.armed, 7);
+    CHECK_EQ(cold.gos, 7);
+    CHECK_EQ(cold.unarmed, 7);
+    // Armed: out on the next output frame, the swap itself well under a
+    // frame. Only an idle machine keeps to that (CHECK_BENCH).
+    CHECK_BENCH(armed.trigger_ns_max < FRAME_NS + 8000000);
+    CHECK_BENCH(armed.swap_ns_max < 2000000);
+    // Unarmed: open and first decodes come first.
+    CHECK(cold.trigger_ns_avg > armed.trigger_ns_avg);
+}
+
+int main(void) {
+    ff_frame_debug_enable(1);
+    test_go();
+    test_loop_and_failure();
+    test_retry_failed();
+    test_trigger_latency();
+    CHECK_EQ(ff_frame_debug_live_count(), 0);
+    printf("test_cue: ok\n");
+    return 0;
+}
@@ -0,0 +1,344 @@
+#define _GNU_SOURCE
+#include "ffdecode.h"
+#include "ffdiskcache.h"
+#include "fflz4.h"
+#include "ffutil.h"
+#include "synthetic_decoder.h"
+#include "test_util.h"
+#include <ftw.h>
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// ---- LZ4 block codec ----
+
+static void roundtrip(const uint8_t* src, size_t n) {
+    size_t cap = ff_lz4_bound(n);
+    uint8_t* comp = malloc(cap);
+    uint8_t* back = malloc(n + 1);
+    CHECK(comp && back);
+    size_t c = ff_lz4_compress(src, n, comp, cap);
+    CHECK(c > 0 || n == 0);
+    CHECK(c <= cap);
+    CHECK_EQ(ff_lz4_decompress(comp, c, back, n), (long)n);
+    CHECK(memcmp(src, back, n) == 0);
+    if (n > 0) CHECK_EQ(ff_lz4_decompress(comp, c, back, n - 1), -1);   // output too small
+    free(comp);
+    free(back);
+}
+
+static void test_lz4(void) {
+    enum { N = 1 << 20 };
+    uint8_t* buf = malloc(N);
+    CHECK(buf);
+
+    uint32_t seed = 12345;
+    for (int i = 0; i < N; ++i) buf[i] = (uint8_t)((seed = seed * 1103515245u + 12345u) >> 24);
+    roundtrip(buf, N);            // incompressible
+    roundtrip(buf, 1);
+    roundtrip(buf, 13);
+    roundtrip(buf, 0);
+
+    memset(buf, 0, N);
+    roundtrip(buf, N);            // long overlapping matches
+
+    for (int i = 0; i < N; ++i) buf[i] = (uint8_t)(i % 251);
+    roundtrip(buf, N);            // long-distance repeats
+
+    // BGRA gradient with constant alpha: typical of decoded frames.
+    for (int i = 0; i < N / 4; ++i) {
+        buf[i * 4 + 0] = (uint8_t)(i / 64);
+        buf[i * 4 + 1] = (uint8_t)(i / 64);
+        buf[i * 4 + 2] = (uint8_t)(i / 1024);
+        buf[i * 4 + 3] = 255;
+    }
+    uint8_t* comp = malloc(ff_lz4_bound(N));
+    size_t c = ff_lz4_compress(buf, N, comp, ff_lz4_bound(N));
+    CHECK(c > 0 && c < N / 4);
+    roundtrip(buf, N);
+
+    // Malformed input must fail, not overrun.
+    uint8_t out[64];
+    CHECK_EQ(ff_lz4_decompress(comp, c / 2, buf, N), -1);
+    const uint8_t bad_offset[] = { 0x04, 'a', 0x10, 0x00, 0x00 };   // match before the start
+    CHECK_EQ(ff_lz4_decompress(bad_offset, sizeof(bad_offset), out, sizeof(out)), -1);
+    CHECK_EQ(ff_lz4_compress(buf, N, comp, 16), 0);                  // does not fit
+    free(comp);
+    free(buf);
+}
+
+// ---- Disk cache ----
+
+static int rm_entry(const char* path, const struct stat* st, int flag, struct FTW* ftw) {
+    return remove(path);
+}
+
+static void rm_rf(const char* dir) {
+    nftw(dir, rm_entry, 16, FTW_DEPTH | FTW_PHYS);
+}
+
+static FFFrameRef* synthetic_frame(int64_t index, int w, int h) {
+    FFFrameRef* f = ff_frame_alloc(w, h, FF_PIXFMT_BGRA);
+    CHECK(f);
+    for (int y = 0; y < h; ++y) {
+        uint8_t* row = ff_frame_plane(f, 0) + (size_t)y * ff_frame_stride(f, 0);
+        for (int x = 0; x < w * 4; ++x) row[x] = synthetic_pixel(index, x / 4, y, x % 4);
+    }
+    ff_frame_set_timing(f, index / 60.0, index);
+    return f;
+}
+
+static void check_frame(FFFrameRef* f, int64_t index, int w, int h) {
+    CHECK(f);
+    CHECK_EQ(ff_frame_width(f), w);
+    CHECK_EQ(ff_frame_height(f), h);
+    CHECK_EQ(ff_frame_index(f), index);
+    for (int y = 0; y < h; ++y) {
+        const uint8_t* row = ff_frame_plane(f, 0) + (size_t)y * ff_frame_stride(f, 0);
+        for (int x = 0; x < w * 4; ++x) CHECK_EQ(row[x], synthetic_pixel(index, x / 4, y, x % 4));
+    }
+}
+
+static void fill(FFDiskCache* dc, const FFDiskCacheKey* key, int64_t first, int count) {
+    for (int64_t i = first; i < first + count; ++i) {
+        FFFrameRef* f = synthetic_frame(i, key->width, key->height);
+        while (ff_diskcache_put(dc, key, f) == 0 && !ff_diskcache_contains(dc, key, i))
+            ff_diskcache_flush(dc);   // queue full: let the writer catch up
+        ff_frame_release(f);
+    }
+    ff_diskcache_flush(dc);
+}
+
+static void test_store_and_reopen(const char* root, FFDiskCodec codec) {
+    rm_rf(root);
+    // 30-pixel rows (120 bytes) are not a multiple of the 64-byte frame stride.
+    FFDiskCacheKey key = { .clip_id = 0x1234, .width = 30, .height = 7, .format = FF_PIXFMT_BGRA };
+    FFDiskCacheConfig cfg = { .root = root, .codec = codec, .frames_per_chunk = 4, .queue_depth = 3 };
+    FFDiskCache* dc = ff_diskcache_open(&cfg);
+    CHECK(dc);
+    CHECK(!ff_diskcache_get(dc, &key, 0));
+    fill(dc, &key, 0, 10);
+    for (int64_t i = 0; i < 10; ++i) CHECK(ff_diskcache_contains(dc, &key, i));
+    CHECK(!ff_diskcache_contains(dc, &key, 10));
+
+    FFFrameRef* f = synthetic_frame(3, key.width, key.height);
+    CHECK_EQ(ff_diskcache_put(dc, &key, f), 0);   // already stored
+    ff_frame_release(f);
+    FFDiskCacheKey other = key;
+    other.width = 31;
+    CHECK(!ff_diskcache_contains(dc, &other, 3)); // other sizes are separate entries
+
+    FFDiskCacheStats st;
+    ff_diskcache_get_stats(dc, &st);
+    CHECK_EQ(st.writes, 10);
+    CHECK_EQ(st.raw_bytes_written, 10 * 30 * 4 * 7);
+    if (codec == FF_DISK_LZ4) CHECK(st.stored_bytes_written < st.raw_bytes_written);
+    else CHECK_EQ(st.stored_bytes_written, st.raw_bytes_written);
+    CHECK(st.bytes_on_disk > st.stored_bytes_written);
+    ff_diskcache_close(dc);
+
+    // A new session finds everything the last one wrote.
+    dc = ff_diskcache_open(&cfg);
+    CHECK(dc);
+    FFFrameRef* kept = NULL;
+    for (int64_t i = 9; i >= 0; --i) {
+        f = ff_diskcache_get(dc, &key, i);
+        check_frame(f, i, key.width, key.height);
+        if (i == 5) kept = f;
+        else ff_frame_release(f);
+
+        FFFrameRef* dst = ff_frame_alloc(key.width, key.height, key.format);
+        FFSinkImage img = { .data = { ff_frame_plane(dst, 0) }, .linesize = { ff_frame_stride(dst, 0) },
+                            .width = key.width, .height = key.height, .format = key.format };
+        CHECK_EQ(ff_diskcache_read_into(dc, &key, i, &img), 1);
+        ff_frame_set_timing(dst, NAN, i);
+        check_frame(dst, i, key.width, key.height);
+        ff_frame_release(dst);
+    }
+    ff_diskcache_get_stats(dc, &st);
+    CHECK_EQ(st.hits, 20);
+    CHECK_EQ(st.writes, 0);
+    ff_diskcache_close(dc);
+    check_frame(kept, 5, key.width, key.height);  // outlives the cache
+    ff_frame_release(kept);
+}
+
+static uint64_t dir_bytes;
+static int add_size(const char* path, const struct stat* st, int flag, struct FTW* ftw) {
+    if (flag == FTW_F) dir_bytes += (uint64_t)st->st_size;
+    return 0;
+}
+
+static void test_quota(const char* root) {
+    rm_rf(root);
+    FFDiskCacheKey key = { .clip_id = 77, .width = 64, .height = 16, .format = FF_PIXFMT_BGRA };
+    size_t frame = 64 * 4 * 16;
+    // Room for about three 4-frame chunks of raw frames (one page of slot table each).
+    FFDiskCacheConfig cfg = { .root = root, .codec = FF_DISK_RAW, .frames_per_chunk = 4,
+                              .quota_bytes = 3 * (4096 + 4 * 4096) };
+    CHECK(frame <= 4096);
+    FFDiskCache* dc = ff_diskcache_open(&cfg);
+    CHECK(dc);
+    fill(dc, &key, 0, 4);     // chunk 0
+    fill(dc, &key, 4, 4);     // chunk 1
+    FFFrameRef* f = ff_diskcache_get(dc, &key, 0);   // chunk 0 is now the most recent
+    ff_frame_release(f);
+    fill(dc, &key, 8, 8);     // chunks 2 and 3: chunk 1 must go first, then 0
+
+    FFDiskCacheStats st;
+    ff_diskcache_get_stats(dc, &st);
+    CHECK(st.evicted_chunks >= 1);
+    CHECK(st.bytes_on_disk <= cfg.quota_bytes);
+    CHECK(!ff_diskcache_contains(dc, &key, 4));
+    CHECK(ff_diskcache_contains(dc, &key, 15));
+    if (st.evicted_chunks == 1) CHECK(ff_diskcache_contains(dc, &key, 0));
+    dir_bytes = 0;
+    nftw(root, add_size, 16, FTW_PHYS);
+    CHECK_EQ(dir_bytes, st.bytes_on_disk);
+    ff_diskcache_close(dc);
+
+    // A smaller quota is enforced as soon as the cache is reopened.
+    cfg.quota_bytes = 4096 + 4 * 4096;
+    dc = ff_diskcache_open(&cfg);
+    ff_diskcache_get_stats(dc, &st);
+    CHECK(st.bytes_on_disk <= cfg.quota_bytes);
+    ff_diskcache_close(dc);
+}
+
+static void test_clip_identity(const char* root) {
+    char path[512];
+    snprintf(path, sizeof(path), "%s-clip.bin", root);
+    FILE* fp = fopen(path, "wb");
+    CHECK(fp);
+    fputs("first", fp);
+    fclose(fp);
+    uint64_t a, b, c;
+    CHECK_EQ(ff_diskcache_clip_id(path, &a), 0);
+    CHECK_EQ(ff_diskcache_clip_id(path, &b), 0);
+    CHECK(a == b);
+    fp = fopen(path, "ab");
+    fputs(" edited", fp);      // new size (and mtime): a different clip
+    fclose(fp);
+    CHECK_EQ(ff_diskcache_clip_id(path, &c), 0);
+    CHECK(c != a);
+    unlink(path);
+    CHECK_EQ(ff_diskcache_clip_id(path, &c), -1);
+}
+
+// Through a player: a second session over the same clip is served from disk
+// instead of the decoder, seeks included.
+static void test_player(const char* root) {
+    rm_rf(root);
+    enum { N = 30 };
+    const char* path = "synthetic:32:18:30:10";
+    FFDiskCacheConfig cfg = { .root = root, .codec = FF_DISK_LZ4, .queue_depth = N };
+    FFDiskCache* dc = ff_diskcache_open(&cfg);
+    FFPlayer* p = ff_open(path, NULL, NULL, NULL, NULL);
+    CHECK(dc && p);
+    CHECK_EQ(ff_set_disk_cache(p, dc), 0);
+    FFFrameRef* f;
+    for (int64_t i = 0; i < N; ++i) {
+        CHECK_EQ(ff_next_frame_ref(p, &f), 1);
+        check_frame(f, i, 32, 18);
+        ff_frame_release(f);
+    }
+    ff_diskcache_flush(dc);
+    ff_close(p);
+
+    p = ff_open(path, NULL, NULL, NULL, NULL);
+    FFPlayer* other = ff_open("synthetic:32:18:30:10:0", NULL, NULL, NULL, NULL);
+    CHECK(p && other);
+    CHECK_EQ(ff_set_disk_cache(p, dc), 0);
+    CHECK_EQ(ff_set_disk_cache(other, dc), 0);
+    uint64_t decoded = synthetic_decode_count(), seeks = synthetic_seek_count();
+    for (int64_t i = 0; i < 10; ++i) {
+        CHECK_EQ(ff_next_frame_ref(p, &f), 1);
+        check_frame(f, i, 32, 18);
+        ff_frame_release(f);
+    }
+    CHECK_EQ(ff_seek_frame(p, 25), 0);
+    CHECK_EQ(ff_next_frame_ref(p, &f), 1);
+    check_frame(f, 25, 32, 18);
+    ff_frame_release(f);
+    CHECK_EQ(synthetic_decode_count(), decoded);
+    CHECK_EQ(synthetic_seek_count(), seeks);
+    FFDiskCacheStats st;
+    ff_diskcache_get_stats(dc, &st);
+    CHECK_EQ(st.hits, 11);
+
+    // Another path is another clip; detached, the decoder catches up.
+    CHECK_EQ(ff_next_frame_ref(other, &f), 1);
+    check_frame(f, 0, 32, 18);
+    ff_frame_release(f);
+    CHECK_EQ(synthetic_decode_count(), decoded + 1);
+    CHECK_EQ(ff_set_disk_cache(p, NULL), 0);
+    CHECK_EQ(ff_next_frame_ref(p, &f), 1);
+    check_frame(f, 26, 32, 18);
+    ff_frame_release(f);
+    CHECK_EQ(synthetic_decode_count(), decoded + 1 + 27);   // close behind: decodes forward
+    CHECK_EQ(synthetic_seek_count(), seeks);
+    ff_close(other);
+    ff_close(p);
+    ff_diskcache_close(dc);
+}
+
+// Cold pass (decode + store) against a warm pass served from disk. The
+// synthetic decoder is cheaper than any real codec, so this only reports the
+// read path's cost; tools/ffdiskcache_bench measures real clips.
+static void bench_cold_warm(const char* root) {
+    const int w = 1280, h = 720, n = 60;
+    for (int codec = FF_DISK_RAW; codec <= FF_DISK_LZ4; ++codec) {
+        rm_rf(root);
+        FFDiskCacheConfig cfg = { .root = root, .codec = (FFDiskCodec)codec };
+        FFDiskCache* dc = ff_diskcache_open(&cfg);
+        FFPlayer* p = ff_open("synthetic:1280:720:60:12", NULL, NULL, NULL, NULL);
+        CHECK(dc && p);
+        FFDiskCacheKey key = { .clip_id = 42, .width = w, .height = h, .format = FF_PIXFMT_BGRA };
+
+        int64_t t0 = ff_now_ns();
+        FFFrameRef* f;
+        while (ff_next_frame_ref(p, &f) == 1) {
+            while (ff_diskcache_put(dc, &key, f) == 0 && !ff_diskcache_contains(dc, &key, ff_frame_index(f)))
+                ff_diskcache_flush(dc);
+            ff_frame_release(f);
+        }
+        ff_diskcache_flush(dc);
+        double cold = (ff_now_ns() - t0) / 1e6;
+
+        t0 = ff_now_ns();
+        for (int64_t i = 0; i < n; ++i) {
+            f = ff_diskcache_get(dc, &key, i);
+            CHECK(f);
+            CHECK_EQ(ff_frame_plane(f, 0)[5 * 4 + 1], synthetic_pixel(i, 5, 0, 1));
+            ff_frame_release(f);
+        }
+        double warm = (ff_now_ns() - t0) / 1e6;
+
+        FFDiskCacheStats st;
+        ff_diskcache_get_stats(dc, &st);
+        printf("diskcache %s: cold %.1f ms (%.2f ms/frame), warm %.1f ms (%.2f ms/frame), stored %.0f%% of raw\n",
+               codec == FF_DISK_RAW ? "raw" : "lz4", cold, cold / n, warm, warm / n,
+               100.0 * st.stored_bytes_written / st.raw_bytes_written);
+        ff_close(p);
+        ff_diskcache_close(dc);
+    }
+}
+
+int main(void) {
+    char root[] = "/tmp/notch-diskcache-XXXXXX";
+    CHECK(mkdtemp(root));
+    ff_frame_debug_enable(1);
+    test_lz4();
+    test_store_and_reopen(root, FF_DISK_RAW);
+    test_store_and_reopen(root, FF_DISK_LZ4);
+    test_quota(root);
+    test_clip_identity(root);
+    test_player(root);
+    bench_cold_warm(root);
+    CHECK_EQ(ff_frame_debug_live_count(), 0);
+    rm_rf(root);
+    printf("test_diskcache: ok\n");
+    return 0;
+}
@@ -0,0 +1,204 @@
+#include "fffanout.h"
+#include "ffpool.h"
+#include "test_util.h"
+#include <stdatomic.h>
+#include <string.h>
+#include <time.h>
+
+static FFFrameRef* make_frame(int64_t index) {
+    FFFrameRef* f = ff_frame_alloc(16, 16, FF_PIXFMT_BGRA);
+    ff_frame_set_timing(f, index / 60.0, index);
+    return f;
+}
+
+static void test_pull_queues_and_policies(void) {
+    FFFanout* fo = ff_fanout_create();
+    FFFanoutOutputConfig c = { 0 };
+    c.name = "fast";
+    c.queue_depth = 4;
+    FFFanoutOutput* fast = ff_fanout_add_output(fo, &c);
+    c.name = "stuck";
+    c.queue_depth = 2;
+    c.policy = FF_DROP_OLDEST;
+    FFFanoutOutput* stuck = ff_fanout_add_output(fo, &c);
+    c.name = "newest";
+    c.policy = FF_DROP_NEWEST;
+    FFFanoutOutput* newest = ff_fanout_add_output(fo, &c);
+    CHECK(fast && stuck && newest);
+    CHECK(strcmp(ff_fanout_output_name(stuck), "stuck") == 0);
+
+    for (int i = 0; i < 10; ++i) {
+        FFFrameRef* f = make_frame(i);
+        ff_fanout_push(fo, f);
+        FFFrameRef* got = NULL;
+        CHECK_EQ(ff_fanout_pop(fast, 0, &got), 1);
+        CHECK(got == f);   // shared reference, not a copy
+        CHECK_EQ(ff_frame_index(got), i);
+        ff_frame_release(got);
+        ff_frame_release(f);
+    }
+
+    FFFrameRef* got = NULL;
+    CHECK_EQ(ff_fanout_pop(fast, 0, &got), 0);
+    CHECK_EQ(ff_fanout_pop(stuck, 0, &got), 1);    // the newest two survive
+    CHECK_EQ(ff_frame_index(got), 8);
+    ff_frame_release(got);
+    CHECK_EQ(ff_fanout_pop(newest, 0, &got), 1);   // the first two survive
+    CHECK_EQ(ff_frame_index(got), 0);
+    ff_frame_release(got);
+
+    FFFanoutOutputStats st;
+    ff_fanout_output_stats(stuck, &st);
+    CHECK_EQ(st.pushed, 10);
+    CHECK_EQ(st.dropped, 8);
+    CHECK_EQ(st.queued, 1);
+    CHECK_EQ(st.high_water, 2);
+    ff_fanout_output_stats(fast, &st);
+    CHECK_EQ(st.delivered, 10);
+    CHECK_EQ(st.dropped, 0);
+
+    ff_fanout_end(fo);
+    CHECK_EQ(ff_fanout_pop(stuck, 0, &got), 1);    // drains before reporting the end
+    ff_frame_release(got);
+    CHECK_EQ(ff_fanout_pop(stuck, 0, &got), -1);
+    CHECK_EQ(ff_fanout_pop(fast, -1, &got), -1);
+
+    ff_fanout_destroy(fo);   // releases what "newest" still holds
+}
+
+// Source drawing from a small pool, like a player with its output pool.
+typedef struct PoolSource {
+    FFFramePool* pool;
+    int64_t      next, count;
+    int          exhausted;
+} PoolSource;
+
+static int pool_source_next(void* opaque, FFFrameRef** out) {
+    PoolSource* s = opaque;
+    if (s->next == s->count) return 0;
+    FFFrameRef* f = ff_pool_acquire_frame(s->pool, 64, 64, FF_PIXFMT_BGRA);
+    if (!f) {
+        s->exhausted++;
+        return -3;
+    }
+    ff_frame_set_timing(f, s->next / 60.0, s->next);
+    s->next++;
+    *out = f;
+    return 1;
+}
+
+typedef struct Counter {
+    atomic_int n;
+    int64_t    last;
+    int        in_order;
+    int        sleep_us;
+} Counter;
+
+static void count_frame(void* opaque, FFFrameRef* f) {
+    Counter* c = opaque;
+    if (ff_frame_index(f) <= c->last) c->in_order = 0;
+    c->last = ff_frame_index(f);
+    if (c->sleep_us) {
+        struct timespec ts = { 0, c->sleep_us * 1000L };
+        nanosleep(&ts, NULL);
+    }
+    atomic_fetch_add(&c->n, 1);
+}
+
+static void test_pump_slow_output_never_stalls(void) {
+    FFFramePoolConfig pc = { 0 };
+    pc.max_buffers = 8;
+    pc.wait_timeout_ms = 0;   // report exhaustion at once so the pump has to shed
+    PoolSource src = { ff_pool_create(&pc), 0, 300, 0 };
+
+    FFFanout* fo = ff_fanout_create();
+    Counter preview = { 0, -1, 1, 0 };
+    Counter recorder = { 0, -1, 1, 500 };
+
+    FFFanoutOutputConfig c = { 0 };
+    c.name = "preview";
+    c.deliver = count_frame;
+    c.opaque = &preview;
+    CHECK(ff_fanout_add_output(fo, &c));
+
+    c.name = "recorder";
+    c.policy = FF_DROP_BLOCK;
+    c.block_timeout_ms = -1;
+    c.opaque = &recorder;
+    FFFanoutOutput* rec = ff_fanout_add_output(fo, &c);
+
+    // Pull-mode output whose consumer never shows up: it must not stall the
+    // pipeline even though its queued frames pin pool buffers.
+    memset(&c, 0, sizeof(c));
+    c.name = "led";
+    c.queue_depth = 3;
+    c.policy = FF_DROP_NEWEST;
+    FFFanoutOutput* led = ff_fanout_add_output(fo, &c);
+
+    FFFrameSource fs = { pool_source_next, &src };
+    CHECK_EQ(ff_fanout_start(fo, fs), 0);
+    CHECK(ff_fanout_start(fo, fs) < 0);   // one pump at a time
+    CHECK_EQ(ff_fanout_wait(fo), 0);
+
+    // Delivery threads drain what is still queued.
+    for (int i = 0; i < 5000 && atomic_load(&recorder.n) < 300; ++i) {
+        struct timespec ts = { 0, 1000000L };
+        nanosleep(&ts, NULL);
+    }
+    CHECK_EQ(atomic_load(&recorder.n), 300);
+
+    FFFanoutOutputStats rs, ls;
+    ff_fanout_output_stats(rec, &rs);
+    CHECK_EQ(rs.dropped, 0);
+    ff_fanout_output_stats(led, &ls);
+    CHECK_EQ(ls.pushed, 300);
+    CHECK(ls.dropped > 0);
+    CHECK(src.exhausted > 0);
+    printf("fanout: preview=%d recorder=%d (blocked %.1f ms) led dropped=%llu, pool exhausted %d times\n",
+           atomic_load(&preview.n), atomic_load(&recorder.n), rs.block_ns / 1e6,
+           (unsigned long long)ls.dropped, src.exhausted);
+
+    ff_fanout_destroy(fo);
+    CHECK(recorder.in_order);
+    CHECK(preview.in_order);
+    CHECK(atomic_load(&preview.n) > 0);
+
+    FFFramePoolStats ps;
+    ff_pool_get_stats(src.pool, &ps);
+    CHECK_EQ(ps.in_use_buffers, 0);
+    ff_pool_destroy(src.pool);
+}
+
+static void test_stop_unblocks_pump(void) {
+    PoolSource src = { NULL, 0, 1000000, 0 };
+    FFFramePoolConfig pc = { 0 };
+    pc.max_buffers = 64;
+    src.pool = ff_pool_create(&pc);
+
+    FFFanout* fo = ff_fanout_create();
+    FFFanoutOutputConfig c = { 0 };
+    c.name = "blocked";
+    c.queue_depth = 2;
+    c.policy = FF_DROP_BLOCK;
+    c.block_timeout_ms = -1;
+    ff_fanout_add_output(fo, &c);
+
+    FFFrameSource fs = { pool_source_next, &src };
+    CHECK_EQ(ff_fanout_start(fo, fs), 0);
+    struct timespec ts = { 0, 20 * 1000000L };
+    nanosleep(&ts, NULL);
+    CHECK_EQ(ff_fanout_stop(fo), 0);   // would hang if the blocked push ignored stop
+    CHECK(src.next < 10);
+    ff_fanout_destroy(fo);
+    ff_pool_destroy(src.pool);
+}
+
+int main(void) {
+    ff_frame_debug_enable(1);
+    test_pull_queues_and_policies();
+    test_pump_slow_output_never_stalls();
+    test_stop_unblocks_pump();
+    CHECK_EQ(ff_frame_debug_live_count(), 0);
+    printf("test_fanout: ok\n");
+    return 0;
+}
@@ -0,0 +1,141 @@
+#include "ffframe.h"
+#include "test_util.h"
+#include <math.h>
+#include <pthread.h>
+#include <signal.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+static int g_freed;
+
+static void count_free(void* opaque) {
+    g_freed++;
+    free(opaque);
+}
+
+static FFFrameRef* wrap_test_frame(void) {
+    FFFrameDesc d;
+    memset(&d, 0, sizeof(d));
+    d.data[0]     = calloc(1, 64 * 4);
+    d.linesize[0] = 64;
+    d.width       = 16;
+    d.height      = 4;
+    d.format      = FF_PIXFMT_BGRA;
+    d.pts         = 0.25;
+    d.index       = 6;
+    d.free        = count_free;
+    d.opaque      = d.data[0];
+    return ff_frame_wrap(&d);
+}
+
+static void test_wrap_and_accessors(void) {
+    g_freed = 0;
+    FFFrameRef* f = wrap_test_frame();
+    CHECK(f);
+    CHECK_EQ(ff_frame_refcount(f), 1);
+    CHECK_EQ(ff_frame_width(f), 16);
+    CHECK_EQ(ff_frame_height(f), 4);
+    CHECK_EQ(ff_frame_stride(f, 0), 64);
+    CHECK(ff_frame_plane(f, 1) == NULL);
+    CHECK(ff_frame_plane(f, 7) == NULL);
+    CHECK(ff_frame_pts(f) == 0.25);
+    CHECK_EQ(ff_frame_index(f), 6);
+    CHECK(ff_frame_native(f) == NULL);
+
+    ff_frame_set_timing(f, 1.0, 30);
+    CHECK(ff_frame_pts(f) == 1.0);
+    CHECK_EQ(ff_frame_index(f), 30);
+
+    ff_frame_release(f);
+    CHECK_EQ(g_freed, 1);
+    ff_frame_release(NULL);
+}
+
+// Several consumers share the same pixels; memory goes back only after the last release.
+static void test_shared_without_copy(void) {
+    g_freed = 0;
+    FFFrameRef* f = wrap_test_frame();
+    uint8_t* px = ff_frame_plane(f, 0);
+
+    FFFrameRef* a = ff_frame_retain(f);
+    FFFrameRef* b = ff_frame_retain(f);
+    CHECK(a == f && b == f);
+    CHECK(ff_frame_plane(a, 0) == px);
+    CHECK_EQ(ff_frame_refcount(f), 3);
+
+    ff_frame_release(f);
+    ff_frame_release(a);
+    CHECK_EQ(g_freed, 0);
+    ff_frame_release(b);
+    CHECK_EQ(g_freed, 1);
+}
+
+static void* hammer(void* arg) {
+    FFFrameRef* f = arg;
+    for (int i = 0; i < 100000; ++i) ff_frame_release(ff_frame_retain(f));
+    return NULL;
+}
+
+static void test_concurrent_retain_release(void) {
+    g_freed = 0;
+    FFFrameRef* f = wrap_test_frame();
+    pthread_t th[4];
+    for (int i = 0; i < 4; ++i) pthread_create(&th[i], NULL, hammer, f);
+    for (int i = 0; i < 4; ++i) pthread_join(th[i], NULL);
+    CHECK_EQ(ff_frame_refcount(f), 1);
+    ff_frame_release(f);
+    CHECK_EQ(g_freed, 1);
+}
+
+static void test_leak_detection(void) {
+    ff_frame_debug_enable(1);
+    long base = ff_frame_debug_live_count();
+
+    FFFrameRef* a = ff_frame_alloc(8, 8, FF_PIXFMT_BGRA);
+    FFFrameRef* b = ff_frame_alloc(8, 8, FF_PIXFMT_BGRA);
+    CHECK(a && b);
+    CHECK(isnan(ff_frame_pts(a)));
+    CHECK_EQ(ff_frame_debug_live_count(), base + 2);
+
+    ff_frame_retain(a);
+    ff_frame_release(a);
+    ff_frame_release(b);
+    CHECK_EQ(ff_frame_debug_live_count(), base + 1);
+    CHECK_EQ(ff_frame_debug_report(NULL), base + 1);
+
+    ff_frame_release(a);
+    CHECK_EQ(ff_frame_debug_live_count(), base);
+    ff_frame_debug_enable(0);
+}
+
+// In debug mode a release past zero aborts, and reads only the quarantined
+// ref: the payload was freed once, the ref itself is still valid memory.
+static void test_over_release(void) {
+    pid_t pid = fork();
+    CHECK(pid >= 0);
+    if (pid == 0) {
+        ff_frame_debug_enable(1);
+        g_freed = 0;
+        FFFrameRef* f = wrap_test_frame();
+        for (int i = 0; i < 100; ++i) ff_frame_release(ff_frame_alloc(8, 8, FF_PIXFMT_BGRA));
+        ff_frame_release(f);
+        if (g_freed != 1) _exit(2);
+        freopen("/dev/null", "w", stderr);
+        ff_frame_release(f);
+        _exit(0);   // not reached
+    }
+    int status = 0;
+    CHECK_EQ(waitpid(pid, &status, 0), pid);
+    CHECK(WIFSIGNALED(status) && WTERMSIG(status) == SIGABRT);
+}
+
+int main(void) {
+    test_wrap_and_accessors();
+    test_shared_without_copy();
+    test_concurrent_retain_release();
+    test_leak_detection();
+    test_over_release();
+    printf("test_frame: ok\n");
+    return 0;
+}
@@ -0,0 +1,150 @@
+#include "ffserver.h"
+#include "ffserver_client.h"
+#include "ffserver_proto.h"
+#include "ffframe.h"
+#include "synthetic_decoder.h"
+#include "test_util.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#define CLIP "synthetic:48:32:120:10"
+
+static char g_sock[108];
+
+static void check_frame(const FFShmFrame* f, int64_t index) {
+    CHECK_EQ(f->frame_index, index);
+    CHECK_EQ(f->width, 48);
+    CHECK_EQ(f->height, 32);
+    static const int pts[][2] = { { 0, 0 }, { 47, 0 }, { 13, 17 }, { 47, 31 } };
+    for (int i = 0; i < 4; ++i) {
+        int x = pts[i][0], y = pts[i][1];
+        for (int ch = 0; ch < 4; ++ch) {
+            CHECK_EQ(f->data[(size_t)y * f->stride + x * 4 + ch], synthetic_pixel(index, x, y, ch));
+        }
+    }
+}
+
+static void test_batch_and_cache(void) {
+    FFSrvClient* c = ffsrv_connect(g_sock);
+    CHECK(c);
+    CHECK_EQ(ffsrv_max_batch(c), 4);
+
+    int64_t idx[3] = { 2, 0, 1 };
+    FFShmFrame fr[3];
+    int st[3];
+    CHECK_EQ(ffsrv_get_frames(c, CLIP, idx, 3, fr, st), 3);
+    for (int i = 0; i < 3; ++i) {
+        CHECK_EQ(st[i], FFSRV_OK);
+        check_frame(&fr[i], idx[i]);
+    }
+    ffsrv_release_frames(c, fr, st, 3);
+
+    // Served from the per-clip cache: nothing new is decoded.
+    uint64_t decoded = synthetic_decode_count();
+    int64_t again = 1;
+    CHECK_EQ(ffsrv_get_frames(c, CLIP, &again, 1, fr, st), 1);
+    check_frame(&fr[0], 1);
+    ffsrv_release_frames(c, fr, st, 1);
+    CHECK_EQ(synthetic_decode_count(), decoded);
+
+    // Far away: seeks to the preceding keyframe and decodes forward from there.
+    uint64_t seeks = synthetic_seek_count();
+    int64_t far[2] = { 95, 3 };
+    CHECK_EQ(ffsrv_get_frames(c, CLIP, far, 2, fr, st), 2);
+    check_frame(&fr[0], 95);
+    check_frame(&fr[1], 3);
+    ffsrv_release_frames(c, fr, st, 2);
+    CHECK(synthetic_seek_count() > seeks);
+
+    ffsrv_disconnect(c);
+}
+
+static void test_errors(void) {
+    FFSrvClient* c = ffsrv_connect(g_sock);
+    CHECK(c);
+    FFShmFrame fr[5];
+    int st[5];
+
+    int64_t out_of_range[2] = { 7, 500 };
+    CHECK_EQ(ffsrv_get_frames(c, CLIP, out_of_range, 2, fr, st), 1);
+    CHECK_EQ(st[0], FFSRV_OK);
+    CHECK_EQ(st[1], FFSRV_ERR_RANGE);
+    ffsrv_release_frames(c, fr, st, 2);
+
+    int64_t zero = 0;
+    CHECK_EQ(ffsrv_get_frames(c, "synthetic:bogus", &zero, 1, fr, st), 0);
+    CHECK_EQ(st[0], FFSRV_ERR_OPEN);
+    CHECK_EQ(ffsrv_get_frames(c, "synthetic:128:128:10:1", &zero, 1, fr, st), 0);
+    CHECK_EQ(st[0], FFSRV_ERR_TOO_BIG);
+
+    int64_t batch[5] = { 0, 1, 2, 3, 4 };
+    CHECK_EQ(ffsrv_get_frames(c, CLIP, batch, 5, fr, st), 0);
+    for (int i = 0; i < 5; ++i) CHECK_EQ(st[i], FFSRV_ERR_BATCH);
+
+    // The connection is still usable afterwards.
+    CHECK_EQ(ffsrv_get_frames(c, CLIP, batch, 4, fr, st), 4);
+    for (int i = 0; i < 4; ++i) check_frame(&fr[i], i);
+    ffsrv_release_frames(c, fr, st, 4);
+    ffsrv_disconnect(c);
+}
+
+static void* client_thread(void* arg) {
+    unsigned seed = (unsigned)(uintptr_t)arg;
+    FFSrvClient* c = ffsrv_connect(g_sock);
+    CHECK(c);
+    for (int r = 0; r < 40; ++r) {
+        int64_t idx[3];
+        for (int i = 0; i < 3; ++i) idx[i] = rand_r(&seed) % 120;
+        FFShmFrame fr[3];
+        int st[3];
+        CHECK_EQ(ffsrv_get_frames(c, CLIP, idx, 3, fr, st), 3);
+        for (int i = 0; i < 3; ++i) check_frame(&fr[i], idx[i]);
+        ffsrv_release_frames(c, fr, st, 3);
+    }
+    ffsrv_disconnect(c);
+    return NULL;
+}
+
+static void test_concurrent_clients(void) {
+    pthread_t th[4];
+    for (int i = 0; i < 4; ++i) pthread_create(&th[i], NULL, client_thread, (void*)(uintptr_t)(i + 1));
+    for (int i = 0; i < 4; ++i) pthread_join(th[i], NULL);
+}
+
+int main(void) {
+    ff_frame_debug_enable(1);
+    snprintf(g_sock, sizeof(g_sock), "/tmp/notch-test-srv-%d.sock", (int)getpid());
+
+    FFSrvConfig cfg = { 0 };
+    cfg.socket_path       = g_sock;
+    cfg.workers           = 2;
+    cfg.decoders_per_clip = 2;
+    cfg.cache_frames      = 16;
+    cfg.max_width         = 64;
+    cfg.max_height        = 64;
+    cfg.slots             = 5;
+    FFServer* srv = ffsrv_start(&cfg);
+    CHECK(srv);
+
+    test_batch_and_cache();
+    test_errors();
+    test_concurrent_clients();
+
+    FFSrvStats st;
+    ffsrv_get_stats(srv, &st);
+    CHECK(st.cache_hits > 0);
+    CHECK_EQ(st.clips_open, 2);   // CLIP and the oversized one
+    CHECK(st.frames >= 3 + 1 + 2 + 1 + 4 + 4 * 40 * 3);
+    printf("frameserver: requests=%llu frames=%llu hits=%llu misses=%llu decoded=%llu seeks=%llu\n",
+           (unsigned long long)st.requests, (unsigned long long)st.frames,
+           (unsigned long long)st.cache_hits, (unsigned long long)st.cache_misses,
+           (unsigned long long)st.decoded, (unsigned long long)st.seeks);
+
+    ffsrv_stop(srv);
+    CHECK_EQ(ff_frame_debug_live_count(), 0);
+    CHECK(access(g_sock, F_OK) != 0);
+    printf("test_frameserver: ok\n");
+    return 0;
+}
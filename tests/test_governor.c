@@ -0,0 +1,213 @@
+#include "ffcache.h"
+#include "ffgovernor.h"
+#include "ffpackcache.h"
+#include "ffpool.h"
+#include "ffutil.h"
+#include "test_util.h"
+#include <stdint.h>
+#include <string.h>
+
+// A client whose usage the test sets; a cap cuts it immediately.
+typedef struct Fake {
+    size_t used, wanted, cap;
+    int    caps;   // set_cap calls
+} Fake;
+
+static size_t fake_usage(void* opaque, size_t* wanted) {
+    Fake* f = opaque;
+    if (f->wanted) *wanted = f->wanted;
+    return f->used;
+}
+
+static void fake_set_cap(void* opaque, size_t cap) {
+    Fake* f = opaque;
+    f->cap = cap;
+    f->caps++;
+    if (f->used > cap) f->used = cap;
+}
+
+static void test_priorities(void) {
+    Fake a = { .used = 100 };
+    Fake b = { .used = 300, .wanted = 400, .cap = SIZE_MAX };
+    Fake c = { .used = 300, .wanted = 300, .cap = SIZE_MAX };
+    FFGovClientConfig ca = { .name = "planes", .kind = FF_GOV_DECODER, .opaque = &a, .usage = fake_usage };
+    FFGovClientConfig cb = { .name = "big cache", .kind = FF_GOV_CACHE, .priority = 10, .opaque = &b,
+                             .usage = fake_usage, .set_cap = fake_set_cap };
+    FFGovClientConfig cc = { .name = "small cache", .kind = FF_GOV_CACHE, .priority = 20, .opaque = &c,
+                             .usage = fake_usage, .set_cap = fake_set_cap };
+    FFGovClient* ga = ff_governor_register(&ca);
+    FFGovClient* gc = ff_governor_register(&cc);
+    FFGovClient* gb = ff_governor_register(&cb);
+    CHECK(ga && gb && gc);
+
+    FFGovUsage u;
+    ff_governor_get_usage(&u);
+    CHECK_EQ(u.clients, 3);
+    CHECK_EQ(u.total_bytes, 700);
+    CHECK_EQ(u.class_bytes[FF_GOV_DECODER], 100);
+    CHECK_EQ(u.class_bytes[FF_GOV_CACHE], 600);
+    CHECK_EQ(u.limit_bytes, 0);
+    ff_governor_notify();   // no limit: nothing is capped
+    CHECK_EQ(b.caps + c.caps, 0);
+
+    // The lowest priority gives up memory first, only as much as needed.
+    ff_governor_set_limit(500);
+    CHECK_EQ(b.cap, 100);
+    CHECK_EQ(c.caps, 0);
+    ff_governor_get_usage(&u);
+    CHECK_EQ(u.total_bytes, 500);
+    CHECK_EQ(u.enforcements, 1);
+
+    // Growth elsewhere squeezes the next client once the first is empty.
+    a.used = 250;
+    ff_governor_notify();
+    CHECK_EQ(b.cap, 0);
+    CHECK_EQ(c.cap, 250);
+    ff_governor_get_usage(&u);
+    CHECK_EQ(u.total_bytes, 500);
+    CHECK_EQ(u.caps_lowered, 3);
+    CHECK_EQ(u.over_limit, 0);
+
+    // Memory frees up: the most important client is restored first and, at
+    // its full size, uncapped; the rest of the room goes to the next.
+    a.used = 100;
+    ff_governor_notify();
+    CHECK_EQ(c.cap, SIZE_MAX);
+    CHECK_EQ(b.cap, 100);
+
+    // Nothing left to take: counted as over the limit.
+    a.used = 1000;
+    ff_governor_notify();
+    ff_governor_get_usage(&u);
+    CHECK_EQ(u.over_limit, 1);
+    CHECK_EQ(b.used + c.used, 0);
+
+    FFGovClientInfo info[4];
+    CHECK_EQ(ff_governor_list(info, 4), 3);
+    CHECK(!strcmp(info[0].name, "planes"));
+    CHECK_EQ(info[0].cap_bytes, SIZE_MAX);
+    CHECK(!strcmp(info[2].name, "big cache"));
+    CHECK_EQ(info[2].priority, 10);
+    CHECK_EQ(info[2].wanted_bytes, 400);
+    CHECK_EQ(info[2].cap_bytes, 0);
+
+    ff_governor_set_limit(0);   // lifts every cap
+    CHECK_EQ(b.cap, SIZE_MAX);
+    CHECK_EQ(c.cap, SIZE_MAX);
+    ff_governor_unregister(ga);
+    ff_governor_unregister(gb);
+    ff_governor_unregister(gc);
+    ff_governor_get_usage(&u);
+    CHECK_EQ(u.clients, 0);
+}
+
+enum { W = 256, H = 64, FRAME_BYTES = W * H * 4 };   // one pool page multiple
+
+// Cached frames live in pool buffers: capping the cache and trimming the pool
+// brings the real memory down, and the cache stays within the cap.
+static void test_pool_and_cache(void) {
+    FFFramePoolConfig pc = { .max_buffers = 64, .wait_timeout_ms = 100 };
+    FFFramePool* pool = ff_pool_create(&pc);
+    FFFrameCacheConfig cc = { .budget_bytes = 32 * FRAME_BYTES };
+    FFFrameCache* cache = ff_cache_create(&cc);
+    CHECK(pool && cache);
+    for (int i = 0; i < 20; ++i) {
+        FFFrameRef* f = ff_pool_acquire_frame(pool, W, H, FF_PIXFMT_BGRA);
+        CHECK(f);
+        ff_frame_set_timing(f, i / 60.0, i);
+        CHECK_EQ(ff_cache_put(cache, f), 1);
+        ff_frame_release(f);
+    }
+    FFGovUsage u;
+    ff_governor_get_usage(&u);
+    CHECK_EQ(u.class_bytes[FF_GOV_OUTPUT], 20 * FRAME_BYTES);
+    CHECK_EQ(u.class_bytes[FF_GOV_CACHE], 20 * FRAME_BYTES);
+    CHECK_EQ(u.total_bytes, 20 * FRAME_BYTES);   // cached frames are not counted twice
+
+    ff_governor_set_limit(8 * FRAME_BYTES);
+    FFFrameCacheStats cs;
+    ff_cache_get_stats(cache, &cs);
+    CHECK_EQ(cs.bytes, 8 * FRAME_BYTES);
+    CHECK_EQ(cs.cap_bytes, 8 * FRAME_BYTES);
+    FFFramePoolStats ps;
+    ff_pool_get_stats(pool, &ps);
+    CHECK_EQ(ps.allocated_bytes, 8 * FRAME_BYTES);
+    CHECK(ff_cache_contains(cache, 19));   // oldest went first
+    CHECK(!ff_cache_contains(cache, 11));
+
+    // Playing on: the cache keeps to its cap, the pool stays at the limit.
+    for (int i = 20; i < 40; ++i) {
+        FFFrameRef* f = ff_pool_acquire_frame(pool, W, H, FF_PIXFMT_BGRA);
+        CHECK(f);
+        ff_frame_set_timing(f, i / 60.0, i);
+        ff_cache_put(cache, f);
+        ff_frame_release(f);
+    }
+    ff_governor_get_usage(&u);
+    CHECK(u.total_bytes <= 9 * FRAME_BYTES);   // the frame being decoded
+    ff_cache_get_stats(cache, &cs);
+    CHECK(cs.bytes <= 8 * FRAME_BYTES);
+    CHECK(ff_cache_contains(cache, 39));
+    printf("governor: limit %zu, total %zu (output %zu, cache %zu), %llu enforcements, %llu bytes trimmed\n",
+           u.limit_bytes, u.total_bytes, u.class_bytes[FF_GOV_OUTPUT], u.class_bytes[FF_GOV_CACHE],
+           (unsigned long long)u.enforcements, (unsigned long long)u.trimmed_bytes);
+
+    ff_governor_set_limit(0);
+    ff_cache_get_stats(cache, &cs);
+    CHECK_EQ(cs.cap_bytes, SIZE_MAX);
+    ff_cache_destroy(cache);
+    ff_pool_destroy(pool);
+    ff_governor_get_usage(&u);
+    CHECK_EQ(u.clients, 0);
+}
+
+// Compressed frames are dropped before readahead depth is cut.
+static void test_pack_cache(void) {
+    FFPackCacheConfig cfg = { .readahead = 4, .threads = 1 };
+    FFPackCache* pc = ff_packcache_create(&cfg);
+    CHECK(pc);
+    for (int i = 0; i < 8; ++i) {
+        FFFrameRef* f = ff_frame_alloc(W, H, FF_PIXFMT_BGRA);
+        CHECK(f);
+        memset(ff_frame_plane(f, 0), i, (size_t)ff_frame_stride(f, 0) * H);
+        ff_frame_set_timing(f, i / 60.0, i);
+        while (ff_packcache_put(pc, f) == 0 && !ff_packcache_contains(pc, i)) ff_packcache_flush(pc);
+        ff_frame_release(f);
+    }
+    ff_packcache_flush(pc);
+    ff_packcache_set_playhead(pc, 0);
+    FFPackCacheStats st;
+    for (int i = 0; i < 2000; ++i) {
+        ff_packcache_get_stats(pc, &st);
+        if (st.ready == 4) break;
+        ff_sleep_until_ns(ff_now_ns() + 1000000);
+    }
+    CHECK_EQ(st.ready, 4);
+    CHECK_EQ(st.entries, 8);
+
+    ff_governor_set_limit(2 * FRAME_BYTES + 4096);
+    ff_packcache_get_stats(pc, &st);
+    CHECK_EQ(st.entries, 0);
+    CHECK_EQ(st.cap_bytes, 0);
+    CHECK_EQ(st.readahead, 2);
+    CHECK_EQ(st.ready, 2);
+    FFGovUsage u;
+    ff_governor_get_usage(&u);
+    CHECK(u.total_bytes <= u.limit_bytes);
+    CHECK_EQ(u.class_bytes[FF_GOV_PREFETCH], 2 * FRAME_BYTES);
+
+    ff_governor_set_limit(0);
+    ff_packcache_get_stats(pc, &st);
+    CHECK_EQ(st.readahead, 4);
+    ff_packcache_destroy(pc);
+}
+
+int main(void) {
+    ff_frame_debug_enable(1);
+    test_priorities();
+    test_pool_and_cache();
+    test_pack_cache();
+    CHECK_EQ(ff_frame_debug_live_count(), 0);
+    printf("test_governor: ok\n");
+    return 0;
+}
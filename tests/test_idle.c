@@ -0,0 +1,213 @@
+#include "ffdecode.h"
+#include "ffloop.h"
+#include "ffpool.h"
+#include "ffsched.h"
+#include "ffutil.h"
+#include "ffworkers.h"
+#include "synthetic_decoder.h"
+#include "test_util.h"
+#include <dirent.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+
+// A headless playback engine as the app runs it: a looping player, a playback
+// thread that decodes one frame ahead and waits on the scheduler, and a worker
+// pool. While paused none of its threads may wake up.
+
+enum { W = 64, H = 36, FRAMES = 120, GOP = 30 };
+
+typedef struct Engine {
+    FFPlayer*  p;
+    FFLoop*    lp;
+    FFSched*   s;
+    FFWorkers* workers;
+    pthread_t  thread;
+    atomic_llong last_index;   // last frame handed over
+    atomic_int   held;         // a decoded frame is waiting for its time
+    atomic_llong wrap_error_ns;   // due-time gap across the last wrap minus the clip's; INT64_MIN = none yet
+} Engine;
+
+static int restart_player(void* opaque, int64_t index) {
+    return ff_seek_frame(opaque, index);
+}
+
+static void* playback_main(void* arg) {
+    Engine* e = arg;
+    FFFrameRef* f = NULL;
+    double last_pts = -1;
+    int64_t prev_index = -1, prev_due = 0;
+    double interval = ff_sched_frame_interval(e->s);
+    for (;;) {
+        if (!f) {
+            if (ff_loop_next(e->lp, &f) != 1) break;
+            double pts = ff_frame_pts(f);
+            // Wrapped: move the clock back by one pass, so frame 0 is due one
+            // interval after the last frame as if the clip went on.
+            if (pts < last_pts) ff_sched_slew(e->s, pts - (last_pts + interval));
+            last_pts = pts;
+            atomic_store(&e->held, 1);
+        }
+        int r = ff_sched_wait(e->s, ff_frame_pts(f));
+        if (r == FF_SCHED_STOPPED) break;
+        if (r == FF_SCHED_WOKEN) continue;
+        if (r == FF_SCHED_PRESENT) {
+            ff_sched_presented(e->s, ff_frame_pts(f));
+            int64_t index = ff_frame_index(f), due = ff_sched_due_ns(e->s, ff_frame_pts(f));
+            if (prev_index >= 0 && index < prev_index) {
+                int64_t expect = llround((FRAMES - prev_index + index) * interval * 1e9);
+                atomic_store(&e->wrap_error_ns, due - prev_due - expect);
+            }
+            prev_index = index;
+            prev_due = due;
+            atomic_store(&e->last_index, index);
+        }
+        atomic_store(&e->held, 0);
+        ff_frame_release(f);
+        f = NULL;
+    }
+    ff_frame_release(f);
+    return NULL;
+}
+
+static void engine_start(Engine* e) {
+    char path[64];
+    snprintf(path, sizeof(path), "synthetic:%d:%d:%d:%d", W, H, FRAMES, GOP);
+    e->p = ff_open(path, NULL, NULL, NULL, NULL);
+    CHECK(e->p);
+    FFFramePoolConfig pc = { .max_buffers = 16, .wait_timeout_ms = 1000 };
+    FFFramePool* pool = ff_pool_create(&pc);
+    CHECK(pool);
+    CHECK_EQ(ff_set_sink(e->p, ff_sink_pool_create(pool)), 0);
+    ff_pool_destroy(pool);
+    FFLoopConfig lc = { ff_player_source(e->p), restart_player, e->p, 8 };
+    e->lp = ff_loop_create(&lc);
+    FFSchedConfig sc = { .frame_interval = 1.0 / 60 };
+    e->s = ff_sched_create(&sc);
+    e->workers = ff_workers_create(4);
+    CHECK(e->lp && e->s && e->workers);
+    atomic_init(&e->last_index, -1);
+    atomic_init(&e->held, 0);
+    atomic_init(&e->wrap_error_ns, INT64_MIN);
+    CHECK_EQ(pthread_create(&e->thread, NULL, playback_main, e), 0);
+}
+
+static void engine_stop(Engine* e) {
+    ff_sched_stop(e->s);
+    pthread_join(e->thread, NULL);
+    ff_workers_destroy(e->workers);
+    ff_loop_destroy(e->lp);
+    ff_sched_destroy(e->s);
+    ff_close(e->p);
+}
+
+#ifdef __linux__
+// Context switches (voluntary + involuntary) of every thread but the caller:
+// each one is a wakeup, or a thread that never went to sleep.
+static long long other_threads_switches(void) {
+    long self = syscall(SYS_gettid);
+    long long total = 0;
+    DIR* d = opendir("/proc/self/task");
+    CHECK(d);
+    struct dirent* de;
+    while ((de = readdir(d))) {
+        if (de->d_name[0] == '.' || atol(de->d_name) == self) continue;
+        char path[64], line[128];
+        snprintf(path, sizeof(path), "/proc/self/task/%s/status", de->d_name);
+        FILE* fp = fopen(path, "r");
+        if (!fp) continue;   // exited meanwhile
+        while (fgets(line, sizeof(line), fp)) {
+            long long n;
+            if (sscanf(line, "voluntary_ctxt_switches: %lld", &n) == 1 ||
+                sscanf(line, "nonvoluntary_ctxt_switches: %lld", &n) == 1)
+                total += n;
+        }
+        fclose(fp);
+    }
+    closedir(d);
+    return total;
+}
+
+static double wakeups_per_second(int64_t window_ns) {
+    long long before = other_threads_switches();
+    ff_sleep_until_ns(ff_now_ns() + window_ns);
+    return (other_threads_switches() - before) * 1e9 / window_ns;
+}
+#endif
+
+static void test_paused_is_idle(void) {
+    Engine e;
+    engine_start(&e);
+    ff_sched_play(e.s);
+    ff_sleep_until_ns(ff_now_ns() + 300 * 1000000LL);   // warm up and wrap once or twice
+    CHECK(atomic_load(&e.last_index) >= 0);
+
+    ff_sched_pause(e.s);
+    for (int i = 0; i < 1000 && !atomic_load(&e.held); ++i) ff_sleep_until_ns(ff_now_ns() + 1000000);
+    ff_sleep_until_ns(ff_now_ns() + 20 * 1000000LL);   // settle
+    CHECK(atomic_load(&e.held));
+    uint64_t decoded = synthetic_decode_count();
+    int64_t shown = atomic_load(&e.last_index);
+
+#ifdef __linux__
+    ff_sched_play(e.s);
+    double playing = wakeups_per_second(500 * 1000000LL);
+    ff_sched_pause(e.s);
+    ff_sleep_until_ns(ff_now_ns() + 20 * 1000000LL);
+    decoded = synthetic_decode_count();
+    shown = atomic_load(&e.last_index);
+    double paused = wakeups_per_second(1000 * 1000000LL);
+    printf("idle: %.0f wakeups/s playing, %.1f wakeups/s paused\n", playing, paused);
+    CHECK(playing >= 30);
+    CHECK(paused <= 2);
+#endif
+    // Nothing was decoded or shown while paused...
+    CHECK_EQ(synthetic_decode_count(), decoded);
+    CHECK_EQ(atomic_load(&e.last_index), shown);
+
+    // ...and resuming shows the frame already decoded, at once.
+    int64_t t0 = ff_now_ns();
+    ff_sched_play(e.s);
+    while (atomic_load(&e.last_index) == shown && ff_now_ns() - t0 < 1000 * 1000000LL)
+        ff_sleep_until_ns(ff_now_ns() + 100000);
+    int64_t next = atomic_load(&e.last_index);
+    CHECK_EQ(next, (shown + 1) % FRAMES);
+    CHECK(ff_now_ns() - t0 < 100 * 1000000LL);
+
+    FFSchedStats st;
+    ff_sched_get_stats(e.s, &st);
+    CHECK(st.interrupted >= 2);
+    engine_stop(&e);
+}
+
+// Across the wrap, frames keep the clip's cadence: frame 0 is due one
+// interval after the last frame, not as soon as it is decoded.
+static void test_wrap_cadence(void) {
+    Engine e;
+    engine_start(&e);
+    ff_sched_play(e.s);
+    ff_sched_seek(e.s, (FRAMES - 20) / 60.0);   // catch up by dropping, then wrap
+    int64_t t0 = ff_now_ns();
+    while (atomic_load(&e.wrap_error_ns) == INT64_MIN && ff_now_ns() - t0 < 3000 * 1000000LL)
+        ff_sleep_until_ns(ff_now_ns() + 1000000);
+    int64_t err = atomic_load(&e.wrap_error_ns);
+    CHECK(err != INT64_MIN);
+    CHECK(llabs(err) < 1000);
+    engine_stop(&e);
+}
+
+int main(void) {
+    ff_frame_debug_enable(1);
+    test_paused_is_idle();
+    test_wrap_cadence();
+    CHECK_EQ(ff_frame_debug_live_count(), 0);
+    printf("test_idle: ok\n");
+    return 0;
+}
@@ -0,0 +1,340 @@
+#include "ffdecode.h"
+#include "ffloop.h"
+#include "ffpool.h"
+#include "ffutil.h"
+#include "synthetic_decoder.h"
+#include "test_util.h"
+#include <stdlib.h>
+#include <time.h>
+
+// Synthetic player with room for the head, the prefetch and the consumer's frame.
+static FFPlayer* open_clip(int frames, int gop) {
+    char path[64];
+    snprintf(path, sizeof(path), "synthetic:16:8:%d:%d", frames, gop);
+    FFPlayer* p = ff_open(path, NULL, NULL, NULL, NULL);
+    CHECK(p);
+    FFFramePoolConfig pc = { .max_buffers = 64, .wait_timeout_ms = 1000 };
+    FFFramePool* pool = ff_pool_create(&pc);
+    CHECK(pool);
+    CHECK_EQ(ff_set_sink(p, ff_sink_pool_create(pool)), 0);
+    ff_pool_destroy(pool);
+    return p;
+}
+
+static int restart_player(void* opaque, int64_t index) {
+    return ff_seek_frame(opaque, index);
+}
+
+static void check_frame(FFFrameRef* f, int64_t index) {
+    CHECK(f);
+    CHECK_EQ(ff_frame_index(f), index);
+    CHECK(ff_frame_pts(f) == index / 60.0);
+    const uint8_t* px = ff_frame_plane(f, 0) + 3 * ff_frame_stride(f, 0) + 5 * 4;
+    for (int ch = 0; ch < 4; ++ch) CHECK_EQ(px[ch], synthetic_pixel(index, 5, 3, ch));
+}
+
+static void test_wraps(void) {
+    enum { N = 20, K = 6 };
+    FFPlayer* p = open_clip(N, 7);
+    FFLoopConfig cfg = { ff_player_source(p), restart_player, p, K };
+    FFLoop* lp = ff_loop_create(&cfg);
+    CHECK(lp);
+
+    for (int i = 0; i < 3 * N; ++i) {
+        FFFrameRef* f;
+        CHECK_EQ(ff_loop_next(lp, &f), 1);
+        check_frame(f, i % N);
+        ff_frame_release(f);
+    }
+    FFLoopStats st;
+    ff_loop_get_stats(lp, &st);
+    CHECK_EQ(st.wraps, 2);
+    CHECK_EQ(st.head_frames, K);
+    CHECK(st.restart_ns_last > 0);
+
+    // Abandon a wrap part-way through the head and seek somewhere else.
+    FFFrameRef* f;
+    for (int i = 0; i < 2; ++i) {
+        CHECK_EQ(ff_loop_next(lp, &f), 1);   // frames 0, 1 from the head
+        check_frame(f, i);
+        ff_frame_release(f);
+    }
+    ff_loop_reset(lp);
+    CHECK_EQ(ff_seek_frame(p, 12), 0);
+    for (int i = 12; i < N + 3; ++i) {
+        CHECK_EQ(ff_loop_next(lp, &f), 1);
+        check_frame(f, i % N);
+        ff_frame_release(f);
+    }
+
+    ff_loop_destroy(lp);
+    ff_close(p);
+}
+
+// A clip shorter than the head is played entirely from memory after the first pass.
+static void test_short_clip(void) {
+    enum { N = 3 };
+    FFPlayer* p = open_clip(N, 1);
+    FFLoopConfig cfg = { ff_player_source(p), restart_player, p, 8 };
+    FFLoop* lp = ff_loop_create(&cfg);
+    CHECK(lp);
+    uint64_t decoded = synthetic_decode_count();
+    uint64_t seeks = synthetic_seek_count();
+    for (int i = 0; i < 5 * N; ++i) {
+        FFFrameRef* f;
+        CHECK_EQ(ff_loop_next(lp, &f), 1);
+        check_frame(f, i % N);
+        ff_frame_release(f);
+    }
+    CHECK_EQ(synthetic_decode_count() - decoded, N);
+    CHECK_EQ(synthetic_seek_count(), seeks);
+    FFLoopStats st;
+    ff_loop_get_stats(lp, &st);
+    CHECK_EQ(st.wraps, 4);
+    CHECK_EQ(st.head_frames, N);
+    ff_loop_destroy(lp);
+    ff_close(p);
+}
+
+static double cpu_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+// In/out points: a region that fits the head is decoded once, then plays from
+// memory with no reads, seeks or decoding.
+static void test_resident_region(void) {
+    enum { IN = 50, N = 30, PASSES = 50 };
+    FFPlayer* p = open_clip(200, 10);
+    FFLoopConfig cfg = { ff_player_source(p), restart_player, p, N, IN, N };
+    FFLoop* lp = ff_loop_create(&cfg);
+    CHECK(lp);
+    CHECK_EQ(ff_seek_frame(p, IN), 0);
+
+    FFFrameRef* f;
+    for (int i = 0; i < N; ++i) {
+        CHECK_EQ(ff_loop_next(lp, &f), 1);
+        check_frame(f, IN + i);
+        ff_frame_release(f);
+    }
+    uint64_t decoded = synthetic_decode_count();
+    uint64_t seeks = synthetic_seek_count();
+    double cpu0 = cpu_ms();
+    for (int i = 0; i < N * PASSES; ++i) {
+        CHECK_EQ(ff_loop_next(lp, &f), 1);
+        check_frame(f, IN + i % N);
+        ff_frame_release(f);
+    }
+    double us_per_frame = (cpu_ms() - cpu0) * 1e3 / (N * PASSES);
+    CHECK_EQ(synthetic_decode_count() - decoded, 1);   // frame IN + N ends the first pass
+    CHECK_EQ(synthetic_seek_count(), seeks);
+    FFLoopStats st;
+    ff_loop_get_stats(lp, &st);
+    CHECK(st.resident);
+    CHECK_EQ(st.wraps, PASSES);
+    CHECK_EQ(st.head_frames, N);
+    printf("resident region of %d frames: %.2f us CPU per frame (incl. pixel checks)\n", N, us_per_frame);
+    CHECK(us_per_frame < 100);   // loose: shared CI machines
+    ff_loop_destroy(lp);
+    ff_close(p);
+}
+
+// A region longer than the head keeps restarting the source at IN + K.
+static void test_streamed_region(void) {
+    enum { IN = 35, N = 40, K = 4 };
+    FFPlayer* p = open_clip(200, 16);
+    FFLoopConfig cfg = { ff_player_source(p), restart_player, p, K, IN, N };
+    FFLoop* lp = ff_loop_create(&cfg);
+    CHECK(lp);
+    CHECK_EQ(ff_seek_frame(p, IN + 10), 0);   // starting inside the region
+    for (int i = 10; i < 4 * N; ++i) {
+        FFFrameRef* f;
+        CHECK_EQ(ff_loop_next(lp, &f), 1);
+        check_frame(f, IN + i % N);
+        ff_frame_release(f);
+    }
+    FFLoopStats st;
+    ff_loop_get_stats(lp, &st);
+    CHECK(!st.resident);
+    CHECK_EQ(st.wraps, 3);
+    CHECK_EQ(st.head_frames, K);
+    ff_loop_destroy(lp);
+    ff_close(p);
+}
+
+// ---- Through the player ----
+
+static void play_range(FFPlayer* p, int64_t in, int n, int from, int count) {
+    for (int i = from; i < from + count; ++i) {
+        FFFrameRef* f;
+        CHECK_EQ(ff_next_frame_ref(p, &f), 1);
+        check_frame(f, in + i % n);
+        ff_frame_release(f);
+    }
+}
+
+// ff_set_loop_range keeps a region that fits the budget decoded, and holds a
+// longer one's packets instead.
+static void test_player_range(void) {
+    enum { IN = 50, N = 30, FRAME_BYTES = 16 * 4 * 8 };
+    FFPlayer* p = open_clip(200, 10);
+    CHECK_EQ(ff_get_loop_stats(p, &(FFLoopStats){ 0 }), -1);
+    CHECK_EQ(ff_set_loop_range(p, IN, IN + N - 1, N * FRAME_BYTES), FF_LOOP_RESIDENT_FRAMES);
+    play_range(p, IN, N, 0, N);
+    uint64_t decoded = synthetic_decode_count();
+    play_range(p, IN, N, 0, 3 * N);
+    CHECK_EQ(synthetic_decode_count() - decoded, 1);   // frame IN + N ends the first pass
+    FFLoopStats st;
+    CHECK_EQ(ff_get_loop_stats(p, &st), 0);
+    CHECK(st.resident);
+    CHECK_EQ(st.wraps, 3);
+
+    // Streamed: restarts stay inside the held region and never seek the file.
+    CHECK_EQ(ff_set_loop_range(p, IN, IN + N - 1, 4 * FRAME_BYTES), FF_LOOP_RESIDENT_PACKETS);
+    uint64_t seeks = synthetic_seek_count();
+    play_range(p, IN, N, 0, 3 * N);
+    CHECK_EQ(synthetic_seek_count(), seeks);
+    CHECK_EQ(ff_get_loop_stats(p, &st), 0);
+    CHECK(!st.resident);
+    CHECK_EQ(st.wraps, 2);
+
+    CHECK_EQ(ff_set_loop(p, 0, 0), 0);
+    CHECK_EQ(ff_get_loop_stats(p, &st), -1);
+    ff_close(p);
+}
+
+// A region that cannot be read leaves the loop, its region and the position
+// as they were.
+static void test_player_range_failure(void) {
+    enum { IN = 35, N = 40, FRAME_BYTES = 16 * 4 * 8 };
+    FFPlayer* p = open_clip(200, 16);
+    CHECK_EQ(ff_set_loop_range(p, IN, IN + N - 1, 4 * FRAME_BYTES), FF_LOOP_RESIDENT_PACKETS);
+    play_range(p, IN, N, 0, N + 10);
+    synthetic_fail_region_reads(1);
+    CHECK(ff_set_loop_range(p, 120, 180, 4 * FRAME_BYTES) < 0);
+    uint64_t seeks = synthetic_seek_count();
+    play_range(p, IN, N, 10, 2 * N);   // on from where it was, wrapping as before
+    CHECK_EQ(synthetic_seek_count(), seeks);
+    FFLoopStats st;
+    CHECK_EQ(ff_get_loop_stats(p, &st), 0);
+    CHECK_EQ(st.wraps, 3);
+
+    // A plain loop survives a failed range too.
+    CHECK_EQ(ff_set_loop(p, 1, 4), 0);
+    CHECK_EQ(ff_seek_frame(p, 195), 0);
+    synthetic_fail_region_reads(1);
+    CHECK(ff_set_loop_range(p, 120, 180, 4 * FRAME_BYTES) < 0);
+    play_range(p, 0, 200, 195, 10);   // 195..199, then 0..4
+    CHECK_EQ(ff_get_loop_stats(p, &st), 0);
+    CHECK_EQ(st.wraps, 1);
+    ff_close(p);
+}
+
+// ---- Pacing across the wrap ----
+
+// Decoder with real costs: every frame takes DECODE_MS, and the first frame
+// after a reposition also pays REFILL_MS (demuxer seek, pipeline refill).
+enum { DECODE_MS = 2, REFILL_MS = 40, PERIOD_MS = 10 };
+
+typedef struct SlowClip {
+    FFPlayer* player;
+    int       refill;
+} SlowClip;
+
+static int slow_next(void* opaque, FFFrameRef** out) {
+    SlowClip* c = opaque;
+    int64_t ms = DECODE_MS + (c->refill ? REFILL_MS : 0);
+    c->refill = 0;
+    ff_sleep_until_ns(ff_now_ns() + ms * 1000000);
+    return ff_next_frame_ref(c->player, out);
+}
+
+static int slow_restart(void* opaque, int64_t index) {
+    SlowClip* c = opaque;
+    c->refill = 1;
+    return ff_seek_frame(c->player, index);
+}
+
+typedef struct Pacing {
+    double steady_ms;   // worst lateness away from the wrap
+    double wrap_ms;     // worst lateness in the frames around the wrap
+} Pacing;
+
+// Plays `passes` times through the clip on a fixed PERIOD_MS schedule (a
+// display link), recording how late each frame was against its deadline.
+static Pacing play(FFFrameSource src, int frames, int passes) {
+    Pacing r = { 0, 0 };
+    int64_t period = (int64_t)PERIOD_MS * 1000000;
+    int64_t deadline = ff_now_ns() + period;
+    for (int i = 0; i < frames * passes; ++i) {
+        FFFrameRef* f;
+        CHECK_EQ(src.next(src.opaque, &f), 1);
+        CHECK_EQ(ff_frame_index(f), i % frames);
+        ff_frame_release(f);
+        int64_t now = ff_now_ns();
+        double late = now > deadline ? (now - deadline) / 1e6 : 0;
+        if (now > deadline) deadline = now;   // a late frame pushes the schedule back
+        ff_sleep_until_ns(deadline);
+        deadline += period;
+
+        if (i < frames) continue;   // first pass: nothing to compare with yet
+        int pos = i % frames;
+        int near_wrap = pos < 12 || pos >= frames - 2;
+        double* worst = near_wrap ? &r.wrap_ms : &r.steady_ms;
+        if (late > *worst) *worst = late;
+    }
+    return r;
+}
+
+// Plain looping: seek to 0 at the end of the clip and wait for the frame.
+static int sync_loop_next(void* opaque, FFFrameRef** out) {
+    SlowClip* c = opaque;
+    int r = slow_next(c, out);
+    if (r != 0) return r;
+    if (slow_restart(c, 0) < 0) return -1;
+    return slow_next(c, out);
+}
+
+static void test_wrap_pacing(void) {
+    enum { N = 40, K = 8 };
+    SlowClip clip = { open_clip(N, 10), 0 };
+
+    FFFrameSource plain = { sync_loop_next, &clip };
+    Pacing base = play(plain, N, 3);
+
+    CHECK_EQ(ff_seek_frame(clip.player, 0), 0);
+    FFLoopConfig cfg = { { slow_next, &clip }, slow_restart, &clip, K };
+    FFLoop* lp = ff_loop_create(&cfg);
+    CHECK(lp);
+    Pacing head = play(ff_loop_source(lp), N, 3);
+    FFLoopStats st;
+    ff_loop_get_stats(lp, &st);
+    ff_loop_destroy(lp);
+    ff_close(clip.player);
+
+    printf("loop wrap at %d ms/frame: seek-to-0 late %.1f ms at the wrap (%.1f steady), "
+           "head of %d late %.1f ms (%.1f steady), restart %.1f ms, %llu stalls\n",
+           PERIOD_MS, base.wrap_ms, base.steady_ms, K, head.wrap_ms, head.steady_ms,
+           st.restart_ns_max / 1e6, (unsigned long long)st.stalls);
+    CHECK_EQ(st.wraps, 2);
+    CHECK(base.wrap_ms >= REFILL_MS / 2);   // the test does see a restart stall
+    // With the head, frames around the wrap keep the steady-state schedule.
+    // The margin only absorbs scheduler noise on a busy machine.
+    CHECK(head.wrap_ms <= head.steady_ms + PERIOD_MS / 2);
+    CHECK_EQ(st.stalls, 0);
+}
+
+int main(void) {
+    ff_frame_debug_enable(1);
+    test_wraps();
+    test_short_clip();
+    test_resident_region();
+    test_streamed_region();
+    test_player_range();
+    test_player_range_failure();
+    test_wrap_pacing();
+    CHECK_EQ(ff_frame_debug_live_count(), 0);
+    printf("test_loop: ok\n");
+    return 0;
+}
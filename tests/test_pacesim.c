@@ -0,0 +1,177 @@
+#include "ffpacesim.h"
+#include "test_util.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static FFPaceSimConfig base(double decode_us, int depth) {
+    FFPaceSimConfig c = { .fps = 60, .frames = 600, .queue_depth = depth };
+    c.cost[FF_PACE_READ].mean_us    = 500;
+    c.cost[FF_PACE_DECODE].mean_us  = decode_us;
+    c.cost[FF_PACE_CONVERT].mean_us = 1000;
+    return c;
+}
+
+static void print_result(const char* label, const FFPaceSimResult* r) {
+    printf("pacesim %-18s shown %4llu dropped %3llu late %3llu repeated %3llu stalls %3llu "
+           "interval %.2f+-%.2f ms p99 %.2f max %.2f\n", label,
+           (unsigned long long)r->shown, (unsigned long long)r->sched.dropped,
+           (unsigned long long)r->sched.late, (unsigned long long)r->repeated,
+           (unsigned long long)r->stalls, r->interval_mean_ms, r->interval_stddev_ms,
+           r->interval_p99_ms, r->interval_max_ms);
+}
+
+// Cheap frames: every one is shown on its own vsync.
+static void test_steady(void) {
+    FFPaceSimConfig c = base(3000, 0);
+    FFPaceSimResult r;
+    CHECK_EQ(ff_pacesim_run(&c, &r), 0);
+    print_result("steady", &r);
+    CHECK_EQ(r.shown, 600);
+    CHECK_EQ(r.sched.dropped, 0);
+    CHECK_EQ(r.sched.late, 0);
+    CHECK_EQ(r.repeated, 0);
+    CHECK_EQ(r.superseded, 0);
+    CHECK_EQ(r.interval_hist[1], 599);
+    CHECK(fabs(r.interval_mean_ms - 1000.0 / 60) < 1e-3);
+    CHECK(r.interval_stddev_ms < 1e-3);
+    CHECK(fabs(r.cost_mean_us[FF_PACE_DECODE] - 3000) < 1e-9);
+    CHECK(fabs(r.sim_seconds - (599 / 60.0 + 0.0045)) < 0.02);
+}
+
+// Frames cost more than a frame time. Dropping does not skip their decode, so
+// it only throws away frames that were paid for: never dropping shows more.
+static void test_overloaded(void) {
+    FFPaceSimConfig c = base(20000, 0);
+    FFPaceSimResult drop, keep;
+    CHECK_EQ(ff_pacesim_run(&c, &drop), 0);
+    print_result("overloaded", &drop);
+    CHECK(drop.sched.dropped > 0);
+    CHECK(drop.repeated > 0);
+    CHECK_EQ(drop.shown + drop.superseded + drop.sched.dropped, 600);
+    CHECK(drop.interval_mean_ms > 1.2 * 1000.0 / 60);
+
+    c.drop_late = -1;
+    CHECK_EQ(ff_pacesim_run(&c, &keep), 0);
+    print_result("overloaded no drops", &keep);
+    CHECK_EQ(keep.sched.dropped, 0);
+    CHECK(keep.shown > 2 * drop.shown);
+    CHECK(keep.interval_max_ms < drop.interval_max_ms);
+}
+
+// A 40 ms hitch every second: inline decoding stalls on every one, four
+// frames decoded ahead absorb them completely.
+static void test_bursts_and_policies(void) {
+    FFPaceSimConfig c = base(0, 0);
+    c.cost[FF_PACE_DECODE] = (FFPaceCost){ .kind = FF_PACE_BURSTY, .mean_us = 3000,
+                                           .burst_us = 40000, .burst_every = 60, .burst_len = 1 };
+    FFPaceSimResult r;
+    CHECK_EQ(ff_pacesim_run(&c, &r), 0);
+    print_result("bursty inline", &r);
+    CHECK(r.stalls >= 9);
+    CHECK(r.sched.late + r.sched.dropped >= 9);
+
+    c.queue_depth = 4;
+    CHECK_EQ(ff_pacesim_run(&c, &r), 0);
+    print_result("bursty ahead 4", &r);
+    CHECK_EQ(r.sched.dropped, 0);
+    CHECK_EQ(r.sched.late, 0);
+    CHECK_EQ(r.stalls, 0);
+    CHECK_EQ(r.repeated, 0);
+
+    // Longer hitches. Dropping throws away frames that were already decoded
+    // and so leaves a longer gap than showing them late.
+    c.queue_depth = 0;
+    c.cost[FF_PACE_DECODE].burst_us = 70000;
+    FFPaceSimResult keep;
+    CHECK_EQ(ff_pacesim_run(&c, &r), 0);
+    print_result("hitch drop", &r);
+    CHECK(r.sched.dropped >= 10);
+    c.drop_late = -1;
+    CHECK_EQ(ff_pacesim_run(&c, &keep), 0);
+    print_result("hitch no drops", &keep);
+    CHECK_EQ(keep.sched.dropped, 0);
+    CHECK_EQ(keep.shown + keep.superseded, 600);
+    CHECK(keep.sched.late > r.sched.late);
+    CHECK(keep.interval_max_ms < r.interval_max_ms);
+}
+
+// Jitter comes from the seed: the same config gives the same run.
+static void test_deterministic(void) {
+    FFPaceSimConfig c = base(12000, 0);
+    c.cost[FF_PACE_DECODE].jitter_us = 9000;
+    c.seed = 42;
+    FFPaceSimResult a, b;
+    CHECK_EQ(ff_pacesim_run(&c, &a), 0);
+    CHECK_EQ(ff_pacesim_run(&c, &b), 0);
+    CHECK(!memcmp(&a, &b, sizeof(a)));
+    print_result("jitter seed 42", &a);
+    c.seed = 43;
+    CHECK_EQ(ff_pacesim_run(&c, &b), 0);
+    CHECK(memcmp(&a, &b, sizeof(a)) != 0);
+}
+
+// 24 fps on a 60 Hz display: a 3:2 cadence, which is not counted as repeats.
+static void test_pulldown(void) {
+    FFPaceSimConfig c = base(3000, 0);
+    c.fps = 24;
+    c.display_hz = 60;
+    c.frames = 240;
+    FFPaceSimResult r;
+    CHECK_EQ(ff_pacesim_run(&c, &r), 0);
+    CHECK_EQ(r.shown, 240);
+    CHECK_EQ(r.interval_hist[2] + r.interval_hist[3], 239);
+    CHECK(r.interval_hist[2] >= 119 && r.interval_hist[3] >= 119);
+    CHECK_EQ(r.repeated, 0);
+    CHECK_EQ(r.stalls, 0);
+}
+
+static void test_trace(void) {
+    char path[] = "/tmp/test_pacesim_XXXXXX";
+    int fd = mkstemp(path);
+    CHECK(fd >= 0);
+    FILE* f = fdopen(fd, "w");
+    // Decode times of a clip with a slow frame every tenth.
+    fprintf(f, "# decode us\n");
+    for (int i = 0; i < 10; ++i) fprintf(f, "%d\n", i == 9 ? 45000 : 4000);
+    fclose(f);
+    int n;
+    double* trace = ff_pacesim_load_trace(path, &n);
+    unlink(path);
+    CHECK(trace);
+    CHECK_EQ(n, 10);
+    CHECK(trace[9] == 45000);
+    int none;
+    CHECK(!ff_pacesim_load_trace("/nonexistent/trace.txt", &none));
+    CHECK_EQ(none, 0);
+
+    FFPaceSimConfig c = base(0, 0);
+    c.cost[FF_PACE_DECODE] = (FFPaceCost){ .kind = FF_PACE_TRACE, .trace_us = trace, .trace_len = n };
+    FFPaceSimResult r;
+    CHECK_EQ(ff_pacesim_run(&c, &r), 0);
+    print_result("trace", &r);
+    CHECK(fabs(r.cost_mean_us[FF_PACE_DECODE] - (9 * 4000 + 45000) / 10.0) < 1e-9);
+    CHECK(r.stalls >= 50);
+    c.queue_depth = 3;
+    CHECK_EQ(ff_pacesim_run(&c, &r), 0);
+    print_result("trace ahead 3", &r);
+    CHECK_EQ(r.stalls, 0);
+    free(trace);
+
+    c.cost[FF_PACE_DECODE].trace_us = NULL;
+    CHECK_EQ(ff_pacesim_run(&c, &r), -1);
+    FFPaceSimConfig bad = { .fps = 0, .frames = 10 };
+    CHECK_EQ(ff_pacesim_run(&bad, &r), -1);
+}
+
+int main(void) {
+    test_steady();
+    test_overloaded();
+    test_bursts_and_policies();
+    test_deterministic();
+    test_pulldown();
+    test_trace();
+    printf("test_pacesim: ok\n");
+    return 0;
+}
@@ -0,0 +1,252 @@
+#include "ffdecode.h"
+#include "ffpackcache.h"
+#include "ffutil.h"
+#include "synthetic_decoder.h"
+#include "test_util.h"
+#include <string.h>
+
+// Motion-graphics style content: flat colour blocks, a moving bar and a
+// transparent border, with a noisy picture-in-picture inset (1/16 of the frame)
+// standing in for camera footage.
+static FFFrameRef* graphics_frame(int64_t index, int w, int h) {
+    FFFrameRef* f = ff_frame_alloc(w, h, FF_PIXFMT_BGRA);
+    CHECK(f);
+    uint32_t seed = (uint32_t)index + 1;
+    for (int y = 0; y < h; ++y) {
+        uint8_t* row = ff_frame_plane(f, 0) + (size_t)y * ff_frame_stride(f, 0);
+        for (int x = 0; x < w; ++x) {
+            uint8_t* px = row + x * 4;
+            int border = x < w / 10 || x >= w - w / 10;
+            int bar = (x + index * 8) % w < w / 8;
+            px[0] = (uint8_t)(bar ? 255 : (x / 64) * 16);
+            px[1] = (uint8_t)((y / 64) * 16);
+            px[2] = (uint8_t)(index & 0xff);
+            px[3] = border ? 0 : 255;
+            if (x >= w / 4 && x < w / 2 && y >= h / 4 && y < h / 2) {
+                seed = seed * 1103515245u + 12345u;
+                memcpy(px, &seed, 3);
+            }
+        }
+    }
+    ff_frame_set_timing(f, index / 60.0, index);
+    return f;
+}
+
+static void check_same(FFFrameRef* a, FFFrameRef* b) {
+    CHECK(a && b);
+    CHECK_EQ(ff_frame_width(a), ff_frame_width(b));
+    CHECK_EQ(ff_frame_height(a), ff_frame_height(b));
+    CHECK_EQ(ff_frame_index(a), ff_frame_index(b));
+    CHECK(ff_frame_pts(a) == ff_frame_pts(b));
+    size_t row = (size_t)ff_frame_width(a) * 4;
+    for (int y = 0; y < ff_frame_height(a); ++y)
+        CHECK(memcmp(ff_frame_plane(a, 0) + (size_t)y * ff_frame_stride(a, 0),
+                     ff_frame_plane(b, 0) + (size_t)y * ff_frame_stride(b, 0), row) == 0);
+}
+
+static void put_all(FFPackCache* pc, FFFrameRef** frames, int n) {
+    for (int i = 0; i < n; ++i) {
+        while (ff_packcache_put(pc, frames[i]) == 0 && !ff_packcache_contains(pc, ff_frame_index(frames[i])))
+            ff_packcache_flush(pc);   // queue full: let the compressor catch up
+    }
+    ff_packcache_flush(pc);
+}
+
+// Waits (bounded) until `n` frames are decompressed ahead.
+static void wait_ready(FFPackCache* pc, int n) {
+    FFPackCacheStats st;
+    for (int i = 0; i < 2000; ++i) {
+        ff_packcache_get_stats(pc, &st);
+        if (st.ready >= n) return;
+        ff_sleep_until_ns(ff_now_ns() + 1000000);
+    }
+    CHECK(st.ready >= n);
+}
+
+static void test_roundtrip_and_readahead(void) {
+    enum { N = 24 };
+    // 333 px rows (1332 bytes) do not match the 64-byte aligned stride; also
+    // covers incompressible bands (noise) stored raw.
+    FFFrameRef* frames[N];
+    for (int i = 0; i < N; ++i) {
+        frames[i] = graphics_frame(i, 333, 200);
+        if (i == 5) {
+            uint32_t seed = 99;
+            for (int y = 0; y < 200; ++y)
+                for (int x = 0; x < 333 * 4; ++x)
+                    ff_frame_plane(frames[i], 0)[(size_t)y * ff_frame_stride(frames[i], 0) + x] =
+                        (uint8_t)((seed = seed * 1103515245u + 12345u) >> 24);
+        }
+    }
+    FFPackCacheConfig cfg = { .readahead = 3, .threads = 3 };
+    FFPackCache* pc = ff_packcache_create(&cfg);
+    CHECK(pc);
+    CHECK(!ff_packcache_get(pc, 0));
+    put_all(pc, frames, N);
+    CHECK_EQ(ff_packcache_put(pc, frames[3]), 0);   // already held
+
+    FFPackCacheStats st;
+    ff_packcache_get_stats(pc, &st);
+    CHECK_EQ(st.packed, N);
+    CHECK_EQ(st.entries, N);
+    CHECK_EQ(st.raw_bytes, (size_t)N * 333 * 4 * 200);
+    CHECK(st.bytes < st.raw_bytes);
+    CHECK_EQ(st.misses, 1);
+
+    // On demand (no playhead yet)
+    FFFrameRef* f = ff_packcache_get(pc, 5);
+    check_same(f, frames[5]);
+    ff_frame_release(f);
+    ff_packcache_get_stats(pc, &st);
+    CHECK_EQ(st.sync_hits, 1);
+
+    // Ahead of the playhead: frames are waiting before they are asked for.
+    ff_packcache_set_playhead(pc, 10);
+    wait_ready(pc, 3);
+    for (int i = 10; i < 13; ++i) {
+        f = ff_packcache_get(pc, i);
+        check_same(f, frames[i]);
+        ff_frame_release(f);
+    }
+    ff_packcache_get_stats(pc, &st);
+    CHECK_EQ(st.ready_hits, 3);
+
+    // Moving the playhead drops ready frames behind it.
+    ff_packcache_set_playhead(pc, 20);
+    wait_ready(pc, 3);
+    ff_packcache_set_playhead(pc, 2);
+    ff_packcache_get_stats(pc, &st);
+    CHECK(st.ready <= 3);
+    for (int i = 2; i < N; ++i) {
+        ff_packcache_set_playhead(pc, i);
+        f = ff_packcache_get(pc, i);
+        check_same(f, frames[i]);
+        ff_frame_release(f);
+    }
+    ff_packcache_get_stats(pc, &st);
+    CHECK_EQ(st.ready_hits + st.sync_hits, 1 + 3 + (N - 2));
+    CHECK(st.decompressed >= st.ready_hits + st.sync_hits);
+
+    ff_packcache_destroy(pc);
+    for (int i = 0; i < N; ++i) ff_frame_release(frames[i]);
+}
+
+static void test_budget(void) {
+    enum { N = 12 };
+    FFFrameRef* frames[N];
+    for (int i = 0; i < N; ++i) frames[i] = graphics_frame(i, 256, 256);
+    FFPackCache* pc = ff_packcache_create(NULL);
+    put_all(pc, frames, 1);
+    FFPackCacheStats st;
+    ff_packcache_get_stats(pc, &st);
+    size_t one = st.bytes;
+    ff_packcache_destroy(pc);
+
+    FFPackCacheConfig cfg = { .budget_bytes = one * 4 + one / 2 };
+    pc = ff_packcache_create(&cfg);
+    put_all(pc, frames, 4);
+    ff_frame_release(ff_packcache_get(pc, 0));   // 0 becomes most recent
+    put_all(pc, frames + 4, 1);
+    CHECK(ff_packcache_contains(pc, 0));
+    CHECK(!ff_packcache_contains(pc, 1));        // least recently used went first
+    put_all(pc, frames + 5, N - 5);
+    ff_packcache_get_stats(pc, &st);
+    CHECK(st.bytes <= cfg.budget_bytes);
+    CHECK(st.evictions >= N - 4);
+    CHECK(ff_packcache_contains(pc, N - 1));
+
+    ff_packcache_set_budget(pc, one);
+    ff_packcache_get_stats(pc, &st);
+    CHECK(st.entries <= 1);
+    ff_packcache_clear(pc);
+    ff_packcache_get_stats(pc, &st);
+    CHECK_EQ(st.entries, 0);
+    CHECK_EQ(st.bytes, 0);
+    ff_packcache_destroy(pc);
+    for (int i = 0; i < N; ++i) ff_frame_release(frames[i]);
+}
+
+// Frames per budget against FFFrameCache's raw frames, and decompression rate
+// against playback rate.
+static void bench_ratio_and_rate(void) {
+    enum { N = 30 };
+    const int w = 1920, h = 1080;
+    FFFrameRef* frames[N];
+    for (int i = 0; i < N; ++i) frames[i] = graphics_frame(i, w, h);
+    FFPackCacheConfig cfg = { .readahead = 4 };
+    FFPackCache* pc = ff_packcache_create(&cfg);
+    CHECK(pc);
+    put_all(pc, frames, N);
+
+    int64_t t0 = ff_now_ns();
+    for (int i = 0; i < N; ++i) {
+        FFFrameRef* f = ff_packcache_get(pc, i);   // no playhead: every get decompresses
+        CHECK(f);
+        ff_frame_release(f);
+    }
+    double ms = (ff_now_ns() - t0) / 1e6 / N;
+
+    FFPackCacheStats st;
+    ff_packcache_get_stats(pc, &st);
+    double ratio = (double)st.raw_bytes / st.bytes;
+    double cmp_mb_s = st.compressed_raw_bytes / (st.compress_ns / 1e9) / 1e6;
+    printf("packcache 1080p graphics: %.1fx smaller, compress %.0f MB/s, decompress %.0f MB/s = %.0f fps (%.2f ms/frame)\n",
+           ratio, cmp_mb_s, st.decompress_mb_s, st.decompress_fps, ms);
+    CHECK(ratio >= 5);
+    CHECK(st.decompress_fps >= 30);   // loose: shared CI machines
+    ff_packcache_destroy(pc);
+    for (int i = 0; i < N; ++i) ff_frame_release(frames[i]);
+}
+
+// Through a player: frames it decoded come back from the pack cache after a
+// seek, with no decode and no file seek.
+static void test_player(void) {
+    enum { N = 20, W = 48, H = 16 };
+    FFPlayer* p = ff_open("synthetic:48:16:40:10", NULL, NULL, NULL, NULL);
+    CHECK(p);
+    CHECK_EQ(ff_set_pack_cache(p, 1 << 20, 3), 0);
+    FFPackCache* pc = ff_get_pack_cache(p);
+    CHECK(pc);
+    FFFrameRef* f;
+    for (int i = 0; i < N; ++i) {
+        CHECK_EQ(ff_next_frame_ref(p, &f), 1);
+        ff_frame_release(f);
+        ff_packcache_flush(pc);   // a full queue would drop frames
+    }
+    uint64_t decoded = synthetic_decode_count(), seeks = synthetic_seek_count();
+    CHECK_EQ(ff_seek_frame(p, 0), 0);
+    for (int i = 0; i < N; ++i) {
+        CHECK_EQ(ff_next_frame_ref(p, &f), 1);
+        CHECK_EQ(ff_frame_index(f), i);
+        CHECK_EQ(ff_frame_width(f), W);
+        for (int x = 0; x < W * 4; ++x) CHECK_EQ(ff_frame_plane(f, 0)[x], synthetic_pixel(i, x / 4, 0, x % 4));
+        ff_frame_release(f);
+    }
+    CHECK_EQ(synthetic_decode_count(), decoded);
+    CHECK_EQ(synthetic_seek_count(), seeks);
+    FFPackCacheStats st;
+    ff_packcache_get_stats(pc, &st);
+    CHECK_EQ(st.ready_hits + st.sync_hits, N);
+
+    // Past the cached frames the decoder picks up where it was left, at N.
+    CHECK_EQ(ff_next_frame_ref(p, &f), 1);
+    CHECK_EQ(ff_frame_index(f), N);
+    ff_frame_release(f);
+    CHECK_EQ(synthetic_decode_count(), decoded + 1);
+    CHECK_EQ(synthetic_seek_count(), seeks);
+
+    CHECK_EQ(ff_set_pack_cache(p, 0, 0), 0);
+    CHECK(!ff_get_pack_cache(p));
+    ff_close(p);
+}
+
+int main(void) {
+    ff_frame_debug_enable(1);
+    test_roundtrip_and_readahead();
+    test_budget();
+    test_player();
+    bench_ratio_and_rate();
+    CHECK_EQ(ff_frame_debug_live_count(), 0);
+    printf("test_packcache: ok\n");
+    return 0;
+}
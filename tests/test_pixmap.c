@@ -0,0 +1,340 @@
+#include "ffconvert.h"
+#include "ffdmx.h"
+#include "ffpixmap.h"
+#include "test_util.h"
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+// 8-bit 4:2:0 full-range test picture with distinct values per position.
+typedef struct Yuv420 {
+    int      w, h;
+    uint8_t* y;
+    uint8_t* u;
+    uint8_t* v;
+} Yuv420;
+
+static Yuv420 make_yuv420(int w, int h) {
+    Yuv420 p = { w, h, malloc((size_t)w * h), malloc((size_t)w * h / 4), malloc((size_t)w * h / 4) };
+    CHECK(p.y && p.u && p.v);
+    for (int y = 0; y < h; ++y)
+        for (int x = 0; x < w; ++x) p.y[y * w + x] = (uint8_t)(x * 3 + y * 7);
+    for (int y = 0; y < h / 2; ++y)
+        for (int x = 0; x < w / 2; ++x) {
+            p.u[y * (w / 2) + x] = (uint8_t)(64 + x * 5);
+            p.v[y * (w / 2) + x] = (uint8_t)(200 - y * 3);
+        }
+    return p;
+}
+
+static void free_yuv420(Yuv420* p) {
+    free(p->y);
+    free(p->u);
+    free(p->v);
+}
+
+static FFSourceImage source_of(const Yuv420* p) {
+    FFSourceImage s;
+    memset(&s, 0, sizeof(s));
+    s.layout = FF_SRC_YUV;
+    s.data[0] = p->y; s.data[1] = p->u; s.data[2] = p->v;
+    s.linesize[0] = p->w; s.linesize[1] = s.linesize[2] = p->w / 2;
+    s.width = p->w; s.height = p->h;
+    s.bits = 8;
+    s.log2_chroma_w = s.log2_chroma_h = 1;
+    s.matrix = FF_MATRIX_BT709;
+    s.full_range = 1;
+    return s;
+}
+
+// Reference colour of (x, y) from the region converter, as R, G, B.
+static void reference_rgb(const FFSourceImage* s, int x, int y, uint8_t rgb[3]) {
+    FFRegion in = { x, y, 1, 1, 0, 0, FF_XFORM_NONE }, r;
+    CHECK_EQ(ff_region_resolve(&in, s->width, s->height, &r), 0);
+    uint8_t bgra[4];
+    ff_convert_region_rows(s, &r, bgra, 4, 0, 1);
+    rgb[0] = bgra[2]; rgb[1] = bgra[1]; rgb[2] = bgra[0];
+}
+
+// ---- Parsing ----
+
+static void test_parse(void) {
+    char err[128];
+    FFPixelMap* m = ff_pixmap_parse(
+        "# tape run\n"
+        "strip 1 1 200 0 0 199 0\n"
+        "order grb\n"
+        "point 7 511 5 5   # would overflow the universe\n", err, sizeof(err));
+    CHECK(!m);
+    CHECK(strstr(err, "line 4"));
+
+    CHECK(!ff_pixmap_parse("pointy 1 1 0 0\n", err, sizeof(err)));
+    CHECK(strstr(err, "line 1") && strstr(err, "pointy"));
+    CHECK(!ff_pixmap_parse("order rgg\npoint 1 1 0 0\n", err, sizeof(err)));
+    CHECK(!ff_pixmap_parse("# nothing\n", err, sizeof(err)));
+
+    m = ff_pixmap_parse(
+        "strip 1 1 200 0 0 199 0\n"      // 170 pixels in universe 1, 30 spill into 2
+        "order grb\n"
+        "point 9 10 5 5\n", err, sizeof(err));
+    CHECK(m);
+    CHECK_EQ(ff_pixmap_point_count(m), 201);
+    CHECK_EQ(ff_pixmap_universe_count(m), 3);
+    int u, len;
+    ff_pixmap_universe(m, 0, &u, &len);
+    CHECK_EQ(u, 1); CHECK_EQ(len, 510);
+    ff_pixmap_universe(m, 1, &u, &len);
+    CHECK_EQ(u, 2); CHECK_EQ(len, 90);
+    ff_pixmap_universe(m, 2, &u, &len);
+    CHECK_EQ(u, 9); CHECK_EQ(len, 12);   // channels 10..12, rounded up to even
+    CHECK(!ff_pixmap_universe(m, 3, NULL, NULL));
+    ff_pixmap_free(m);
+}
+
+// ---- Sampling ----
+
+static void test_sample_matches_converter(void) {
+    Yuv420 pic = make_yuv420(64, 32);
+    FFSourceImage src = source_of(&pic);
+    FFPixelMap* m = ff_pixmap_parse(
+        "strip 3 1 64 0 17 63 17\n"
+        "order bgr\n"
+        "point 4 1 13 9\n"
+        "size 32 16\n"                   // half-resolution coordinates from here on
+        "order rgb\n"
+        "point 4 4 10 5\n"
+        "point 4 7 100 -3\n", NULL, 0);  // clamped to the picture
+    CHECK(m);
+    CHECK_EQ(ff_pixmap_sample(m, &src), 0);
+
+    int u, len;
+    const uint8_t* dmx = ff_pixmap_universe(m, 0, &u, &len);
+    CHECK_EQ(u, 3);
+    uint8_t ref[3];
+    for (int x = 0; x < 64; ++x) {
+        reference_rgb(&src, x, 17, ref);
+        CHECK(memcmp(dmx + x * 3, ref, 3) == 0);
+    }
+    dmx = ff_pixmap_universe(m, 1, &u, &len);
+    CHECK_EQ(u, 4);
+    reference_rgb(&src, 13, 9, ref);
+    CHECK(dmx[0] == ref[2] && dmx[1] == ref[1] && dmx[2] == ref[0]);
+    reference_rgb(&src, 20, 10, ref);
+    CHECK(memcmp(dmx + 3, ref, 3) == 0);
+    reference_rgb(&src, 63, 0, ref);
+    CHECK(memcmp(dmx + 6, ref, 3) == 0);
+
+    FFPixelMapStats st;
+    ff_pixmap_stats(m, &st);
+    CHECK_EQ(st.frames, 1);
+    CHECK_EQ(st.points, 67);
+    ff_pixmap_free(m);
+    free_yuv420(&pic);
+}
+
+// ---- UDP ----
+
+static int open_receiver(int* port) {
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    CHECK(fd >= 0);
+    struct sockaddr_in a;
+    memset(&a, 0, sizeof(a));
+    a.sin_family = AF_INET;
+    a.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    CHECK_EQ(bind(fd, (struct sockaddr*)&a, sizeof(a)), 0);
+    socklen_t al = sizeof(a);
+    CHECK_EQ(getsockname(fd, (struct sockaddr*)&a, &al), 0);
+    *port = ntohs(a.sin_port);
+    int rcvbuf = 4 << 20;
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+    struct timeval tv = { 2, 0 };
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    return fd;
+}
+
+static int be16(const uint8_t* p) {
+    return p[0] << 8 | p[1];
+}
+
+static FFPixelMap* grey_map(Yuv420* pic) {
+    FFPixelMap* m = ff_pixmap_parse("strip 1 1 340 0 0 63 31\n", NULL, 0);   // universes 1 and 2
+    CHECK(m);
+    FFSourceImage src = source_of(pic);
+    CHECK_EQ(ff_pixmap_sample(m, &src), 0);
+    return m;
+}
+
+static void test_artnet_loopback(void) {
+    Yuv420 pic = make_yuv420(64, 32);
+    FFPixelMap* m = grey_map(&pic);
+    int port;
+    int fd = open_receiver(&port);
+    FFDmxSenderConfig cfg = { .protocol = FF_DMX_ARTNET, .host = "127.0.0.1", .port = port, .artsync = 1 };
+    FFDmxSender* s = ff_dmx_sender_create(&cfg);
+    CHECK(s);
+
+    for (int frame = 0; frame < 2; ++frame) {
+        CHECK_EQ(ff_dmx_send_frame(s, m, 0), 3);
+        for (int i = 0; i < 2; ++i) {
+            uint8_t pkt[1024];
+            ssize_t n = recv(fd, pkt, sizeof(pkt), 0);
+            int u, len;
+            const uint8_t* dmx = ff_pixmap_universe(m, i, &u, &len);
+            CHECK_EQ(n, 18 + len);
+            CHECK(memcmp(pkt, "Art-Net\0", 8) == 0);
+            CHECK(pkt[8] == 0x00 && pkt[9] == 0x50 && pkt[11] == 14);
+            CHECK_EQ(pkt[12], frame + 1);                  // per-universe sequence
+            CHECK_EQ(pkt[14] | pkt[15] << 8, u);
+            CHECK_EQ(be16(pkt + 16), len);
+            CHECK(memcmp(pkt + 18, dmx, (size_t)len) == 0);
+        }
+        uint8_t sync[64];
+        CHECK_EQ(recv(fd, sync, sizeof(sync), 0), 14);
+        CHECK(sync[8] == 0x00 && sync[9] == 0x52);
+    }
+    FFDmxSendStats st;
+    ff_dmx_sender_stats(s, &st);
+    CHECK_EQ(st.frames, 2);
+    CHECK_EQ(st.packets, 6);
+    CHECK_EQ(st.errors, 0);
+
+    ff_dmx_sender_destroy(s);
+    close(fd);
+    ff_pixmap_free(m);
+    free_yuv420(&pic);
+}
+
+static void test_sacn_loopback(void) {
+    Yuv420 pic = make_yuv420(64, 32);
+    FFPixelMap* m = grey_map(&pic);
+    int port;
+    int fd = open_receiver(&port);
+    FFDmxSenderConfig cfg = { .protocol = FF_DMX_SACN, .host = "127.0.0.1", .port = port,
+                              .source_name = "test", .priority = 150 };
+    FFDmxSender* s = ff_dmx_sender_create(&cfg);
+    CHECK(s);
+    CHECK_EQ(ff_dmx_send_frame(s, m, 0), 2);
+
+    uint8_t cid[16];
+    for (int i = 0; i < 2; ++i) {
+        uint8_t pkt[1024];
+        ssize_t n = recv(fd, pkt, sizeof(pkt), 0);
+        int u, len;
+        const uint8_t* dmx = ff_pixmap_universe(m, i, &u, &len);
+        CHECK_EQ(n, 126 + len);
+        CHECK_EQ(be16(pkt), 0x0010);
+        CHECK(memcmp(pkt + 4, "ASC-E1.17\0\0\0", 12) == 0);
+        CHECK_EQ(be16(pkt + 16), 0x7000 | (int)(n - 16));
+        CHECK_EQ(be16(pkt + 38), 0x7000 | (int)(n - 38));
+        CHECK_EQ(be16(pkt + 115), 0x7000 | (int)(n - 115));
+        CHECK(strcmp((const char*)pkt + 44, "test") == 0);
+        CHECK_EQ(pkt[108], 150);
+        CHECK_EQ(be16(pkt + 113), u);
+        CHECK_EQ(be16(pkt + 123), len + 1);
+        CHECK_EQ(pkt[125], 0);
+        CHECK(memcmp(pkt + 126, dmx, (size_t)len) == 0);
+        if (i == 0) memcpy(cid, pkt + 22, 16);
+        else CHECK(memcmp(cid, pkt + 22, 16) == 0);   // one source, one CID
+    }
+    ff_dmx_sender_destroy(s);
+
+    // sACN has no universe 0
+    FFPixelMap* bad = ff_pixmap_parse("point 0 1 0 0\n", NULL, 0);
+    s = ff_dmx_sender_create(&cfg);
+    CHECK(bad && s);
+    CHECK(ff_dmx_send_frame(s, bad, 0) < 0);
+    ff_dmx_sender_destroy(s);
+    ff_pixmap_free(bad);
+
+    close(fd);
+    ff_pixmap_free(m);
+    free_yuv420(&pic);
+}
+
+// Frame-synchronous bursts at 100 Hz: every frame is sent, at or after its
+// deadline, with intervals averaging the period.
+static void test_paced_send(void) {
+    Yuv420 pic = make_yuv420(64, 32);
+    FFPixelMap* m = grey_map(&pic);
+    int port;
+    int fd = open_receiver(&port);
+    FFDmxSenderConfig cfg = { .protocol = FF_DMX_ARTNET, .host = "127.0.0.1", .port = port };
+    FFDmxSender* s = ff_dmx_sender_create(&cfg);
+    CHECK(s);
+
+    const int frames = 40;
+    const int64_t period = 10000000;
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    int64_t start = (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec + period;
+    for (int i = 0; i < frames; ++i) CHECK_EQ(ff_dmx_send_frame(s, m, start + i * period), 2);
+    int got = 0;
+    uint8_t pkt[1024];
+    while (got < frames * 2 && recv(fd, pkt, sizeof(pkt), 0) > 0) ++got;
+    CHECK_EQ(got, frames * 2);
+
+    FFDmxSendStats st;
+    ff_dmx_sender_stats(s, &st);
+    CHECK_EQ(st.frames, frames);
+    CHECK(st.late_max_ns >= 0);
+    CHECK(st.interval_mean_ns > period * 0.8 && st.interval_mean_ns < period * 1.2);
+    printf("pixmap: paced send interval mean %.3f ms, min %.3f, max %.3f, jitter %.1f us, late max %.1f us\n",
+           st.interval_mean_ns / 1e6, st.interval_min_ns / 1e6, st.interval_max_ns / 1e6,
+           st.jitter_ns / 1e3, st.late_max_ns / 1e3);
+
+    ff_dmx_sender_reset_stats(s);
+    ff_dmx_sender_stats(s, &st);
+    CHECK_EQ(st.frames, 0);
+    ff_dmx_sender_destroy(s);
+    close(fd);
+    ff_pixmap_free(m);
+    free_yuv420(&pic);
+}
+
+// Throughput: 100 strips of 170 pixels over a UHD frame.
+static void test_throughput(void) {
+    Yuv420 pic = make_yuv420(3840, 2160);
+    FFSourceImage src = source_of(&pic);
+    size_t cap = 100 * 64;
+    char* text = malloc(cap);
+    size_t off = 0;
+    for (int i = 0; i < 100; ++i)
+        off += (size_t)snprintf(text + off, cap - off, "strip %d 1 170 0 %d 3839 %d\n", i + 1, i * 21, i * 21 + 10);
+    FFPixelMap* m = ff_pixmap_parse(text, NULL, 0);
+    free(text);
+    CHECK(m);
+    CHECK_EQ(ff_pixmap_point_count(m), 17000);
+
+    const int iters = 200;
+    double t0 = now_ms();
+    for (int i = 0; i < iters; ++i) CHECK_EQ(ff_pixmap_sample(m, &src), 0);
+    double el = now_ms() - t0;
+    FFPixelMapStats st;
+    ff_pixmap_stats(m, &st);
+    CHECK_EQ(st.points, 17000ull * iters);
+    printf("pixmap: %d points/frame, %.1f us/frame, %.1f Mpoints/s\n",
+           ff_pixmap_point_count(m), el * 1e3 / iters, st.points / (el * 1e3));
+    ff_pixmap_free(m);
+    free_yuv420(&pic);
+}
+
+int main(void) {
+    test_parse();
+    test_sample_matches_converter();
+    test_artnet_loopback();
+    test_sacn_loopback();
+    test_paced_send();
+    test_throughput();
+    printf("test_pixmap: ok\n");
+    return 0;
+}
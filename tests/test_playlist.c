@@ -0,0 +1,254 @@
+#include "ffplaylist.h"
+#include "ffutil.h"
+#include "synthetic_decoder.h"
+#include "test_util.h"
+#include <math.h>
+#include <stdatomic.h>
+#include <string.h>
+
+// Synthetic clips at 60 fps whose frames take 3 ms each to decode, so a cold
+// switch costs at least one decode.
+enum { W = 32, H = 18, COST_US = 3000 };
+
+static void clip_path(char* buf, size_t n, int frames) {
+    snprintf(buf, n, "synthetic:%d:%d:%d:10:%d", W, H, frames, COST_US);
+}
+
+static FFPlaylist* make(const FFPlaylistConfig* cfg, const int* lengths, int n) {
+    FFPlaylist* pl = ff_playlist_create(cfg);
+    CHECK(pl);
+    for (int i = 0; i < n; ++i) {
+        char path[64];
+        clip_path(path, sizeof(path), lengths[i]);
+        CHECK_EQ(ff_playlist_append(pl, path), i);
+    }
+    CHECK_EQ(ff_playlist_count(pl), n);
+    return pl;
+}
+
+static int check_frame(const FFFrameRef* f, int64_t clip_index) {
+    const uint8_t* px = ff_frame_plane(f, 0);
+    int stride = ff_frame_stride(f, 0);
+    return ff_frame_index(f) == clip_index && px[0] == synthetic_pixel(clip_index, 0, 0, 0)
+        && px[(H - 1) * stride + (W - 1) * 4 + 2] == synthetic_pixel(clip_index, W - 1, H - 1, 2);
+}
+
+// Plays at the clip rate, as a presenting thread would, so pre-roll has the
+// time a real clip gives it.
+static int next_paced(FFPlaylist* pl, FFFrameRef** f, FFPlaylistPos* pos) {
+    ff_sleep_until_ns(ff_now_ns() + 4000000);
+    return ff_playlist_next(pl, f, pos);
+}
+
+static atomic_int g_prepared;
+
+static int prepare(void* opaque, FFPlayer* p, const char* path) {
+    CHECK(opaque == &g_prepared);
+    CHECK(p && !strncmp(path, "synthetic:", 10));
+    atomic_fetch_add(&g_prepared, 1);
+    return 0;
+}
+
+// Three clips play as one: indices and pts run on without a gap or a repeat,
+// and every frame is the clip's own.
+static void test_continuous(void) {
+    const int len[] = { 30, 20, 25 };
+    FFPlaylistConfig cfg = { .preroll = { .prepare = prepare, .opaque = &g_prepared } };
+    FFPlaylist* pl = make(&cfg, len, 3);
+    FFPlaylistClip clip;
+    CHECK_EQ(ff_playlist_current(pl, &clip), -1);
+
+    int64_t expect = 0;
+    for (int item = 0; item < 3; ++item) {
+        for (int i = 0; i < len[item]; ++i, ++expect) {
+            FFFrameRef* f;
+            FFPlaylistPos pos;
+            CHECK_EQ(next_paced(pl, &f, &pos), 1);
+            CHECK_EQ(pos.item, item);
+            CHECK_EQ(pos.index, expect);
+            CHECK(fabs(pos.pts - expect / 60.0) < 1e-9);
+            CHECK(check_frame(f, i));
+            ff_frame_release(f);
+            if (i == 0) {
+                CHECK_EQ(ff_playlist_current(pl, &clip), 0);
+                CHECK_EQ(clip.item, item);
+                CHECK_EQ(clip.first_index, expect);
+                CHECK(fabs(clip.start - expect / 60.0) < 1e-9);
+                CHECK_EQ(clip.info.width, W);
+                CHECK_EQ(clip.info.frames, len[item]);
+                CHECK(fabs(clip.info.fps - 60) < 1e-9);
+            }
+        }
+    }
+    FFFrameRef* f;
+    CHECK_EQ(ff_playlist_next(pl, &f, NULL), 0);
+    CHECK(!f);
+    CHECK_EQ(ff_playlist_next(pl, &f, NULL), 0);
+
+    FFPlaylistStats st;
+    ff_playlist_get_stats(pl, &st);
+    CHECK_EQ(st.switches, 2);
+    CHECK_EQ(st.prerolled, 2);
+    CHECK_EQ(st.cold, 0);
+    CHECK_EQ(st.failed, 0);
+    CHECK(st.preroll_ns_last >= 4 * COST_US * 1000LL);   // four frames decoded ahead
+    CHECK_EQ(atomic_load(&g_prepared), 3);
+    ff_playlist_destroy(pl);
+}
+
+// The switch gap with and without pre-roll. Cold, the playing thread opens
+// the clip and waits for its first decode; pre-rolled, the frame is there.
+static double switch_gap_ms(int cold, FFPlaylistStats* st) {
+    const int len[] = { 20, 20, 20, 20, 20 };
+    FFPlaylistConfig cfg = { .cold = cold };
+    FFPlaylist* pl = make(&cfg, len, 5);
+    FFFrameRef* f;
+    int n = 0;
+    while (next_paced(pl, &f, NULL) == 1) {
+        ff_frame_release(f);
+        ++n;
+    }
+    CHECK_EQ(n, 100);
+    ff_playlist_get_stats(pl, st);
+    CHECK_EQ(st->switches, 4);
+    ff_playlist_destroy(pl);
+    return st->switch_ns_avg / 1e6;
+}
+
+static void test_switch_gap(void) {
+    FFPlaylistStats cold, warm;
+    double cold_ms = switch_gap_ms(1, &cold);
+    double warm_ms = switch_gap_ms(0, &warm);
+    printf("playlist switch gap: cold %.3f ms (max %.3f), pre-rolled %.3f ms (max %.3f)\n",
+           cold_ms, cold.switch_ns_max / 1e6, warm_ms, warm.switch_ns_max / 1e6);
+    CHECK_EQ(cold.cold, 4);
+    CHECK_EQ(warm.prerolled, 4);
+    CHECK(cold_ms >= COST_US / 1e3);
+    CHECK(warm_ms * 3 < cold_ms);
+}
+
+// Looping wraps to the first clip on the same timeline; skip cuts to the next
+// clip at the next frame; jump to any clip.
+static void test_loop_skip_jump(void) {
+    const int len[] = { 12, 8 };
+    FFPlaylistConfig cfg = { .loop = 1 };
+    FFPlaylist* pl = make(&cfg, len, 2);
+    FFFrameRef* f;
+    FFPlaylistPos pos;
+    int64_t expect = 0;
+    // Twice round, unbroken.
+    for (int lap = 0; lap < 2; ++lap) {
+        for (int item = 0; item < 2; ++item) {
+            for (int i = 0; i < len[item]; ++i, ++expect) {
+                CHECK_EQ(next_paced(pl, &f, &pos), 1);
+                CHECK_EQ(pos.item, item);
+                CHECK_EQ(pos.index, expect);
+                CHECK(fabs(pos.pts - expect / 60.0) < 1e-9);
+                CHECK(check_frame(f, i));
+                ff_frame_release(f);
+            }
+        }
+    }
+
+    // Cut from the middle of clip 0 to clip 1: the next frame is its first,
+    // one frame after the last one shown.
+    for (int i = 0; i < 3; ++i, ++expect) {
+        CHECK_EQ(next_paced(pl, &f, &pos), 1);
+        ff_frame_release(f);
+    }
+    CHECK_EQ(ff_playlist_skip(pl), 0);
+    CHECK_EQ(next_paced(pl, &f, &pos), 1);
+    CHECK_EQ(pos.item, 1);
+    CHECK_EQ(pos.index, expect);
+    CHECK(fabs(pos.pts - expect / 60.0) < 1e-9);
+    CHECK(check_frame(f, 0));
+    ff_frame_release(f);
+    ++expect;
+
+    // Jump back to clip 1 itself: it restarts.
+    CHECK_EQ(ff_playlist_jump(pl, 2), -1);
+    CHECK_EQ(ff_playlist_jump(pl, 1), 0);
+    CHECK_EQ(ff_playlist_next(pl, &f, &pos), 1);
+    CHECK_EQ(pos.item, 1);
+    CHECK_EQ(pos.index, expect);
+    CHECK(check_frame(f, 0));
+    ff_frame_release(f);
+
+    FFPlaylistStats st;
+    ff_playlist_get_stats(pl, &st);
+    CHECK_EQ(st.switches, 6);
+    ff_playlist_destroy(pl);
+}
+
+// The end of the list is not final: appended clips carry on the timeline.
+// Clips that cannot be opened are skipped.
+static void test_append_and_failures(void) {
+    const int len[] = { 6 };
+    FFPlaylistConfig cfg = { 0 };
+    FFPlaylist* pl = make(&cfg, len, 1);
+    FFFrameRef* f;
+    FFPlaylistPos pos;
+    for (int i = 0; i < 6; ++i) {
+        CHECK_EQ(ff_playlist_next(pl, &f, &pos), 1);
+        ff_frame_release(f);
+    }
+    CHECK_EQ(ff_playlist_next(pl, &f, &pos), 0);
+
+    char path[64];
+    CHECK_EQ(ff_playlist_append(pl, "synthetic:broken"), 1);
+    clip_path(path, sizeof(path), 5);
+    CHECK_EQ(ff_playlist_append(pl, path), 2);
+    for (int i = 0; i < 5; ++i) {
+        CHECK_EQ(ff_playlist_next(pl, &f, &pos), 1);
+        CHECK_EQ(pos.item, 2);
+        CHECK_EQ(pos.index, 6 + i);
+        CHECK(fabs(pos.pts - (6 + i) / 60.0) < 1e-9);
+        CHECK(check_frame(f, i));
+        ff_frame_release(f);
+    }
+    CHECK_EQ(ff_playlist_next(pl, &f, &pos), 0);
+
+    // Skipping past the last clip ends the list at once.
+    clip_path(path, sizeof(path), 50);
+    CHECK_EQ(ff_playlist_append(pl, path), 3);
+    CHECK_EQ(ff_playlist_next(pl, &f, &pos), 1);
+    ff_frame_release(f);
+    CHECK_EQ(ff_playlist_skip(pl), 0);
+    CHECK_EQ(ff_playlist_next(pl, &f, &pos), 0);
+
+    FFPlaylistStats st;
+    ff_playlist_get_stats(pl, &st);
+    CHECK_EQ(st.failed, 1);
+
+    // Nothing in the list can be opened.
+    FFPlaylist* bad = ff_playlist_create(NULL);
+    CHECK_EQ(ff_playlist_next(bad, &f, NULL), 0);
+    ff_playlist_append(bad, "synthetic:broken");
+    ff_playlist_append(bad, "nope");
+    CHECK(ff_playlist_next(bad, &f, NULL) < 0);
+    ff_playlist_destroy(bad);
+
+    // Frames straight from the source interface.
+    FFFrameSource src = ff_playlist_source(pl);
+    clip_path(path, sizeof(path), 3);
+    ff_playlist_append(pl, path);
+    int n = 0;
+    while (src.next(src.opaque, &f) == 1) {
+        CHECK(check_frame(f, n));
+        ff_frame_release(f);
+        ++n;
+    }
+    CHECK_EQ(n, 3);
+    ff_playlist_destroy(pl);
+}
+
+int main(void) {
+    ff_frame_debug_enable(1);
+    test_continuous();
+    test_switch_gap();
+    test_loop_skip_jump();
+    test_append_and_failures();
+    CHECK_EQ(ff_frame_debug_live_count(), 0);
+    printf("test_playlist: ok\n");
+    return 0;
+}
@@ -0,0 +1,139 @@
+#include "ffpool.h"
+#include "test_util.h"
+#include <pthread.h>
+#include <unistd.h>
+
+static void test_recycles_instead_of_allocating(void) {
+    FFFramePoolConfig cfg = { .max_buffers = 4, .wait_timeout_ms = 0 };
+    FFFramePool* pool = ff_pool_create(&cfg);
+
+    for (int i = 0; i < 100; ++i) {
+        FFFrameRef* f = ff_pool_acquire_frame(pool, 640, 360, FF_PIXFMT_BGRA);
+        CHECK(f);
+        ff_frame_release(f);
+    }
+
+    FFFramePoolStats st;
+    ff_pool_get_stats(pool, &st);
+    CHECK_EQ(st.acquires, 100);
+    CHECK_EQ(st.allocs, 1);
+    CHECK_EQ(st.reuses, 99);
+    CHECK_EQ(st.in_use_buffers, 0);
+    CHECK_EQ(st.free_buffers, 1);
+    CHECK(st.high_water_bytes >= (size_t)640 * 4 * 360);
+    ff_pool_destroy(pool);
+}
+
+static void test_size_buckets(void) {
+    FFFramePool* pool = ff_pool_create(&(FFFramePoolConfig){ .wait_timeout_ms = 0 });
+
+    // Slightly different sizes land in the same bucket and share memory.
+    FFFrameRef* a = ff_pool_acquire_frame(pool, 1000, 100, FF_PIXFMT_BGRA);
+    ff_frame_release(a);
+    FFFrameRef* b = ff_pool_acquire_frame(pool, 1010, 100, FF_PIXFMT_BGRA);
+    FFFramePoolStats st;
+    ff_pool_get_stats(pool, &st);
+    CHECK_EQ(st.allocs, 1);
+    ff_frame_release(b);
+
+    // A much larger frame needs its own bucket.
+    FFFrameRef* c = ff_pool_acquire_frame(pool, 4000, 100, FF_PIXFMT_BGRA);
+    ff_pool_get_stats(pool, &st);
+    CHECK_EQ(st.allocs, 2);
+    ff_frame_release(c);
+
+    CHECK(ff_pool_trim(pool) > 0);
+    ff_pool_get_stats(pool, &st);
+    CHECK_EQ(st.allocated_bytes, 0);
+    ff_pool_destroy(pool);
+}
+
+static void test_byte_capacity(void) {
+    FFFramePoolConfig cfg = { .capacity_bytes = 3 * 1024 * 1024, .wait_timeout_ms = 0 };
+    FFFramePool* pool = ff_pool_create(&cfg);
+
+    // 1 MiB frames: three fit, the fourth is refused rather than grown into.
+    FFFrameRef* f[4];
+    for (int i = 0; i < 3; ++i) CHECK((f[i] = ff_pool_acquire_frame(pool, 256, 1024, FF_PIXFMT_BGRA)));
+    CHECK(ff_pool_acquire_frame(pool, 256, 1024, FF_PIXFMT_BGRA) == NULL);
+
+    // Larger than the whole pool: fails immediately.
+    CHECK(ff_pool_acquire_frame(pool, 4096, 4096, FF_PIXFMT_BGRA) == NULL);
+
+    FFFramePoolStats st;
+    ff_pool_get_stats(pool, &st);
+    CHECK(st.allocated_bytes <= cfg.capacity_bytes);
+    CHECK_EQ(st.in_use_buffers, 3);
+    CHECK_EQ(st.timeouts, 1);
+
+    // Releasing a small free buffer lets a different bucket reuse the space.
+    ff_frame_release(f[0]);
+    f[3] = ff_pool_acquire_frame(pool, 200, 1024, FF_PIXFMT_BGRA);
+    CHECK(f[3]);
+    for (int i = 1; i < 4; ++i) ff_frame_release(f[i]);
+    ff_pool_destroy(pool);
+}
+
+typedef struct { FFFrameRef* f; int delay_ms; } Returner;
+
+static void* return_later(void* arg) {
+    Returner* r = arg;
+    usleep(r->delay_ms * 1000);
+    ff_frame_release(r->f);
+    return NULL;
+}
+
+static void test_back_pressure_waits(void) {
+    FFFramePoolConfig cfg = { .max_buffers = 2, .wait_timeout_ms = 2000 };
+    FFFramePool* pool = ff_pool_create(&cfg);
+    FFFrameRef* a = ff_pool_acquire_frame(pool, 64, 64, FF_PIXFMT_BGRA);
+    FFFrameRef* b = ff_pool_acquire_frame(pool, 64, 64, FF_PIXFMT_BGRA);
+
+    Returner r = { a, 30 };
+    pthread_t th;
+    pthread_create(&th, NULL, return_later, &r);
+
+    FFFrameRef* c = ff_pool_acquire_frame(pool, 64, 64, FF_PIXFMT_BGRA);
+    CHECK(c);
+    pthread_join(th, NULL);
+
+    FFFramePoolStats st;
+    ff_pool_get_stats(pool, &st);
+    CHECK_EQ(st.waits, 1);
+    CHECK_EQ(st.allocs, 2);
+    CHECK(st.wait_ns_max >= 10 * 1000000ULL);
+    CHECK(st.wait_ns_total >= st.wait_ns_max);
+
+    ff_frame_release(b);
+    ff_frame_release(c);
+    ff_pool_destroy(pool);
+}
+
+static void test_frames_outlive_pool_and_sink(void) {
+    FFFramePool* pool = ff_pool_create(NULL);
+    FFFrameSink* sink = ff_sink_pool_create(pool);
+    ff_pool_destroy(pool);
+
+    FFSinkImage img;
+    CHECK_EQ(sink->acquire(sink, 32, 32, FF_PIXFMT_BGRA, &img), 0);
+    FFFrameRef* f = sink->commit(sink, &img, 0.5, 15);
+    CHECK_EQ(ff_frame_index(f), 15);
+
+    FFFramePoolStats st;
+    CHECK_EQ(ff_sink_get_pool_stats(sink, &st), 0);
+    CHECK_EQ(st.in_use_buffers, 1);
+
+    ff_sink_destroy(sink);
+    ff_frame_release(f);   // last reference frees the pool
+    CHECK(ff_sink_get_pool_stats(NULL, &st) < 0);
+}
+
+int main(void) {
+    test_recycles_instead_of_allocating();
+    test_size_buckets();
+    test_byte_capacity();
+    test_back_pressure_waits();
+    test_frames_outlive_pool_and_sink();
+    printf("test_pool: ok\n");
+    return 0;
+}
@@ -0,0 +1,256 @@
+#define _GNU_SOURCE
+#include "ffdecode.h"
+#include "ffdiskcache.h"
+#include "ffproxy.h"
+#include "ffutil.h"
+#include "synthetic_decoder.h"
+#include "test_util.h"
+#include <ftw.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+
+enum { W = 128, H = 72, FRAMES = 240, GOP = 30, COST_US = 2000 };
+
+static int rm_entry(const char* path, const struct stat* st, int flag, struct FTW* ftw) {
+    return remove(path);
+}
+
+static void clip_path(char* path, size_t n, int cost_us) {
+    snprintf(path, n, "synthetic:%d:%d:%d:%d:%d", W, H, FRAMES, GOP, cost_us);
+}
+
+// Proxy pixel (x, y) is full-resolution pixel (4x, 4y).
+static void check_proxy_frame(FFFrameRef* f, int64_t index) {
+    CHECK(f);
+    CHECK_EQ(ff_frame_index(f), index);
+    CHECK_EQ(ff_frame_width(f), W / 4);
+    CHECK_EQ(ff_frame_height(f), H / 4);
+    for (int y = 0; y < H / 4; y += 5) {
+        const uint8_t* row = ff_frame_plane(f, 0) + (size_t)y * ff_frame_stride(f, 0);
+        for (int x = 0; x < W / 4; x += 3) {
+            for (int ch = 0; ch < 4; ++ch) CHECK_EQ(row[x * 4 + ch], synthetic_pixel(index, 4 * x, 4 * y, ch));
+        }
+    }
+}
+
+static void test_build_and_resume(FFDiskCache* dc) {
+    char path[64];
+    clip_path(path, sizeof(path), 0);
+    FFProxyConfig cfg = { .path = path, .clip_id = 1, .store = dc, .threads = 3, .segment_frames = GOP };
+    FFProxy* px = ff_proxy_create(&cfg);
+    CHECK(px);
+    const FFDiskCacheKey* key = ff_proxy_key(px);
+    CHECK_EQ(key->clip_id, 1);
+    CHECK_EQ(key->width, W / 4);
+    CHECK_EQ(key->height, H / 4);
+    CHECK(!ff_proxy_contains(px, 0));
+    CHECK(!ff_proxy_coarse(px, 0));
+
+    CHECK_EQ(ff_proxy_start(px), 0);
+    CHECK_EQ(ff_proxy_wait(px, 10000), 1);
+    ff_diskcache_flush(dc);
+    FFProxyStats st;
+    ff_proxy_get_stats(px, &st);
+    CHECK_EQ(st.frames_total, FRAMES);
+    CHECK_EQ(st.frames_built, FRAMES);
+    CHECK_EQ(st.errors, 0);
+    CHECK_EQ(st.threads, 3);
+    CHECK(!st.running);
+    CHECK(st.complete);
+    for (int64_t i = 0; i < FRAMES; ++i) {
+        FFFrameRef* f = ff_proxy_get(px, i);
+        check_proxy_frame(f, i);
+        ff_frame_release(f);
+    }
+    FFFrameRef* f = ff_proxy_coarse(px, 77);
+    check_proxy_frame(f, 77);
+    ff_frame_release(f);
+    ff_proxy_destroy(px);
+
+    // Another proxy of the same clip finds every frame in the store.
+    uint64_t decoded = synthetic_decode_count();
+    px = ff_proxy_create(&cfg);
+    CHECK(px);
+    CHECK_EQ(ff_proxy_start(px), 0);
+    CHECK_EQ(ff_proxy_wait(px, 10000), 1);
+    ff_proxy_get_stats(px, &st);
+    CHECK_EQ(st.frames_built, 0);
+    CHECK_EQ(st.frames_present, FRAMES);
+    CHECK(st.complete);
+    CHECK_EQ(synthetic_decode_count(), decoded);
+    ff_proxy_destroy(px);
+}
+
+// Through a player: with the proxy in use, built frames play at proxy size
+// without decoding; switched off, the decoder catches up at full size.
+static void test_player(FFDiskCache* dc) {
+    char path[64];
+    clip_path(path, sizeof(path), 0);
+    FFProxyConfig cfg = { .path = path, .clip_id = 1, .store = dc, .threads = 3, .segment_frames = GOP };
+    FFProxy* px = ff_proxy_create(&cfg);
+    CHECK(px);
+    CHECK_EQ(ff_proxy_start(px), 0);   // built by test_build_and_resume
+    CHECK_EQ(ff_proxy_wait(px, 10000), 1);
+    FFPlayer* p = ff_open(path, NULL, NULL, NULL, NULL);
+    CHECK(p);
+    CHECK_EQ(ff_set_proxy(p, px, 1), 0);
+
+    uint64_t decoded = synthetic_decode_count(), seeks = synthetic_seek_count();
+    FFFrameRef* f;
+    for (int64_t i = 0; i < 5; ++i) {
+        CHECK_EQ(ff_next_frame_ref(p, &f), 1);
+        check_proxy_frame(f, i);
+        ff_frame_release(f);
+    }
+    CHECK_EQ(ff_seek_frame(p, 150), 0);
+    CHECK_EQ(ff_next_frame_ref(p, &f), 1);
+    check_proxy_frame(f, 150);
+    ff_frame_release(f);
+    CHECK_EQ(synthetic_decode_count(), decoded);
+    CHECK_EQ(synthetic_seek_count(), seeks);
+
+    CHECK_EQ(ff_set_proxy(p, px, 0), 0);
+    CHECK_EQ(ff_next_frame_ref(p, &f), 1);
+    CHECK_EQ(ff_frame_index(f), 151);
+    CHECK_EQ(ff_frame_width(f), W);
+    CHECK_EQ(ff_frame_plane(f, 0)[4 * 4 + 2], synthetic_pixel(151, 4, 0, 2));
+    ff_frame_release(f);
+    CHECK_EQ(synthetic_seek_count(), seeks + 1);   // far from where the decoder was left
+    ff_close(p);
+    ff_proxy_destroy(px);
+}
+
+static void test_stop(FFDiskCache* dc) {
+    char path[64];
+    clip_path(path, sizeof(path), COST_US);
+    FFProxyConfig cfg = { .path = path, .clip_id = 2, .store = dc, .threads = 2, .segment_frames = GOP };
+    FFProxy* px = ff_proxy_create(&cfg);
+    CHECK(px);
+    CHECK_EQ(ff_proxy_start(px), 0);
+    CHECK_EQ(ff_proxy_wait(px, 50), 0);
+    int64_t t0 = ff_now_ns();
+    ff_proxy_stop(px);   // between frames, not at the end of a segment
+    CHECK((ff_now_ns() - t0) / 1000000 < 100);
+    ff_diskcache_flush(dc);
+    FFProxyStats st;
+    ff_proxy_get_stats(px, &st);
+    CHECK(!st.running);
+    CHECK(!st.complete);
+    CHECK(st.frames_built < FRAMES);
+    uint64_t first = st.frames_built;
+
+    // Resuming only builds what is missing.
+    CHECK_EQ(ff_proxy_start(px), 0);
+    CHECK_EQ(ff_proxy_wait(px, 10000), 1);
+    ff_proxy_get_stats(px, &st);
+    CHECK(st.complete);
+    CHECK(st.frames_present >= first);
+    CHECK_EQ(st.frames_built + st.frames_present, FRAMES);
+    ff_proxy_destroy(px);
+}
+
+// Build time with `threads` decoders, each frame costing COST_US of decode wait.
+static void* wait_main(void* arg) {
+    return (void*)(intptr_t)ff_proxy_wait(arg, -1);
+}
+
+static void* stop_main(void* arg) {
+    ff_proxy_stop(arg);
+    return NULL;
+}
+
+// Waits and stops from several threads at once: the workers are joined once,
+// and every caller returns after they have been.
+static void test_concurrent_wait(FFDiskCache* dc) {
+    enum { WAITERS = 4 };
+    char path[64];
+    clip_path(path, sizeof(path), 200);
+    FFProxyConfig cfg = { .path = path, .clip_id = 4, .store = dc, .threads = 2, .segment_frames = GOP };
+    FFProxy* px = ff_proxy_create(&cfg);
+    CHECK(px);
+    for (int round = 0; round < 2; ++round) {
+        CHECK_EQ(ff_proxy_start(px), 0);
+        pthread_t t[WAITERS + 1];
+        for (int i = 0; i < WAITERS; ++i) CHECK_EQ(pthread_create(&t[i], NULL, wait_main, px), 0);
+        // The second round stops part-way through instead of building it all.
+        if (round == 1) CHECK_EQ(pthread_create(&t[WAITERS], NULL, stop_main, px), 0);
+        for (int i = 0; i < WAITERS + round; ++i) {
+            void* r;
+            CHECK_EQ(pthread_join(t[i], &r), 0);
+            if (i < WAITERS) CHECK_EQ((intptr_t)r, 1);
+        }
+        FFProxyStats st;
+        ff_proxy_get_stats(px, &st);
+        CHECK(!st.running);
+    }
+    ff_proxy_destroy(px);
+}
+
+static double build_fps(FFDiskCache* dc, uint64_t clip_id, int threads) {
+    char path[64];
+    clip_path(path, sizeof(path), COST_US);
+    FFProxyConfig cfg = { .path = path, .clip_id = clip_id, .store = dc, .threads = threads,
+                          .segment_frames = GOP, .normal_priority = 1 };
+    FFProxy* px = ff_proxy_create(&cfg);
+    CHECK(px);
+    CHECK_EQ(ff_proxy_start(px), 0);
+    CHECK_EQ(ff_proxy_wait(px, 20000), 1);
+    FFProxyStats st;
+    ff_proxy_get_stats(px, &st);
+    CHECK(st.complete);
+    CHECK_EQ(st.frames_built, FRAMES);
+    ff_proxy_destroy(px);
+    return st.build_fps;
+}
+
+static void test_scaling(FFDiskCache* dc) {
+    double one = build_fps(dc, 10, 1);
+    double four = build_fps(dc, 11, 4);
+    printf("proxy build of %d frames at %d us/frame: 1 thread %.0f fps, 4 threads %.0f fps (%.2fx)\n",
+           FRAMES, COST_US, one, four, four / one);
+    CHECK(four > 2 * one);
+}
+
+static void test_choose(void) {
+    FFProxyView v = { .view_w = 1920, .view_h = 1080, .proxy_w = 1920, .proxy_h = 1080, .proxy_ready = 1 };
+    CHECK_EQ(ff_proxy_choose(&v, 0), 1);   // 8K clip in an HD window
+    v.view_w = 3840;
+    v.view_h = 2160;
+    CHECK_EQ(ff_proxy_choose(&v, 0), 0);   // full screen, decoder keeping up
+    v.scrubbing = 1;
+    CHECK_EQ(ff_proxy_choose(&v, 0), 1);
+    v.scrubbing = 0;
+    v.load = 1.2;
+    CHECK_EQ(ff_proxy_choose(&v, 0), 1);
+    v.load = 0.8;                          // between the thresholds: keep the current choice
+    CHECK_EQ(ff_proxy_choose(&v, 1), 1);
+    CHECK_EQ(ff_proxy_choose(&v, 0), 0);
+    v.load = 0.5;
+    CHECK_EQ(ff_proxy_choose(&v, 1), 0);
+    v.load = 2;
+    v.proxy_ready = 0;
+    CHECK_EQ(ff_proxy_choose(&v, 1), 0);
+    CHECK_EQ(ff_proxy_choose(NULL, 1), 0);
+}
+
+int main(void) {
+    char root[] = "/tmp/notch-proxy-XXXXXX";
+    CHECK(mkdtemp(root));
+    ff_frame_debug_enable(1);
+    FFDiskCacheConfig dcfg = { .root = root, .queue_depth = 16 };
+    FFDiskCache* dc = ff_diskcache_open(&dcfg);
+    CHECK(dc);
+    test_build_and_resume(dc);
+    test_player(dc);
+    test_stop(dc);
+    test_concurrent_wait(dc);
+    test_scaling(dc);
+    test_choose();
+    ff_diskcache_close(dc);
+    nftw(root, rm_entry, 16, FTW_DEPTH | FTW_PHYS);
+    CHECK_EQ(ff_frame_debug_live_count(), 0);
+    printf("test_proxy: ok\n");
+    return 0;
+}
@@ -0,0 +1,182 @@
+#include "ffsched.h"
+#include "ffutil.h"
+#include "test_util.h"
+#include <math.h>
+#include <pthread.h>
+
+// Simulated clock: time moves only when a wait asks it to, or the test does.
+typedef struct VClock {
+    int64_t now;
+} VClock;
+
+static int64_t vclock_now(void* opaque) {
+    return ((VClock*)opaque)->now;
+}
+
+static void vclock_sleep_until(void* opaque, int64_t deadline_ns) {
+    VClock* c = opaque;
+    if (deadline_ns > c->now) c->now = deadline_ns;
+}
+
+enum { MS = 1000000 };
+
+// 100 fps content: 10 ms frames, 5 ms lead, dropped past 10 ms late.
+static void test_decisions(void) {
+    VClock vc = { .now = 1000 * MS };
+    FFSchedConfig cfg = { .clock = { vclock_now, vclock_sleep_until, &vc }, .frame_interval = 0.01 };
+    FFSched* s = ff_sched_create(&cfg);
+    CHECK(s);
+    FFSchedConfig bad = { .frame_interval = 0 };
+    CHECK(!ff_sched_create(&bad));
+
+    // Paused at 0: the first frame shows, the next waits for play.
+    int64_t wake;
+    CHECK_EQ(ff_sched_decide(s, 0.0, &wake), FF_SCHED_PRESENT);
+    CHECK_EQ(ff_sched_decide(s, 0.01, &wake), FF_SCHED_HOLD);
+    CHECK_EQ(wake, INT64_MAX);
+    CHECK_EQ(ff_sched_wait(s, 0.01), FF_SCHED_WOKEN);
+    CHECK_EQ(ff_sched_due_ns(s, 0.01), INT64_MAX);
+
+    ff_sched_play(s);
+    CHECK(ff_sched_is_playing(s));
+    CHECK_EQ(ff_sched_due_ns(s, 0.01), 1010 * MS);
+    CHECK_EQ(ff_sched_decide(s, 0.01, &wake), FF_SCHED_HOLD);
+    CHECK_EQ(wake, 1005 * MS);
+    CHECK_EQ(ff_sched_wait(s, 0.01), FF_SCHED_PRESENT);
+    CHECK_EQ(vc.now, 1005 * MS);   // handed over one lead ahead
+    ff_sched_presented(s, 0.01);
+    CHECK_EQ(ff_sched_wait(s, 0.02), FF_SCHED_PRESENT);
+    CHECK_EQ(vc.now, 1015 * MS);
+    ff_sched_presented(s, 0.02);
+
+    FFSchedStats st;
+    ff_sched_get_stats(s, &st);
+    CHECK_EQ(st.presented, 2);
+    CHECK_EQ(st.late, 0);
+    CHECK_EQ(st.late_max_ns, -5 * MS);
+    CHECK_EQ(st.repeated, 0);
+    CHECK_EQ(st.waits, 3);
+    CHECK_EQ(st.wake_error_max_ns, 0);
+
+    // A 40 ms stall: frames more than a frame late are dropped, the one in
+    // time shows late, and the stalled frame stayed up for three extra slots.
+    vc.now += 40 * MS;
+    CHECK_EQ(ff_sched_wait(s, 0.03), FF_SCHED_DROP);
+    CHECK_EQ(ff_sched_wait(s, 0.04), FF_SCHED_DROP);
+    CHECK_EQ(ff_sched_wait(s, 0.05), FF_SCHED_PRESENT);
+    ff_sched_presented(s, 0.05);
+    ff_sched_get_stats(s, &st);
+    CHECK_EQ(st.dropped, 2);
+    CHECK_EQ(st.late, 1);
+    CHECK_EQ(st.late_max_ns, 5 * MS);
+    CHECK_EQ(st.repeated, 3);
+
+    // However far behind, a frame still shows after max_drops in a row.
+    vc.now += 100 * MS;
+    CHECK_EQ(ff_sched_decide(s, 0.06, NULL), FF_SCHED_DROP);
+    CHECK_EQ(ff_sched_decide(s, 0.07, NULL), FF_SCHED_DROP);
+    CHECK_EQ(ff_sched_decide(s, 0.08, NULL), FF_SCHED_DROP);
+    CHECK_EQ(ff_sched_decide(s, 0.09, NULL), FF_SCHED_PRESENT);
+    ff_sched_presented(s, 0.09);
+    CHECK_EQ(ff_sched_decide(s, 0.10, NULL), FF_SCHED_DROP);   // presenting reset the run
+
+    // Paused: the clock freezes; a seek drops what precedes the target.
+    ff_sched_pause(s);
+    CHECK(fabs(ff_sched_time(s) - 0.155) < 1e-9);
+    vc.now += 1000 * MS;
+    CHECK(fabs(ff_sched_time(s) - 0.155) < 1e-9);
+    CHECK_EQ(ff_sched_decide(s, 0.17, NULL), FF_SCHED_HOLD);
+    ff_sched_seek(s, 2.0);
+    CHECK_EQ(ff_sched_decide(s, 1.5, NULL), FF_SCHED_DROP);
+    CHECK_EQ(ff_sched_decide(s, 2.0, NULL), FF_SCHED_PRESENT);
+    ff_sched_presented(s, 2.0);
+    ff_sched_play(s);
+    vc.now += 500 * MS;
+    CHECK(fabs(ff_sched_time(s) - 2.5) < 1e-9);
+
+    ff_sched_stop(s);
+    CHECK_EQ(ff_sched_wait(s, 3.0), FF_SCHED_STOPPED);
+    CHECK_EQ(ff_sched_decide(s, 3.0, NULL), FF_SCHED_STOPPED);
+    ff_sched_reset_stats(s);
+    ff_sched_get_stats(s, &st);
+    CHECK_EQ(st.presented + st.dropped + st.waits, 0);
+    ff_sched_destroy(s);
+}
+
+// Real clock: waits end at the hand-over time, not a poll tick after it.
+static void test_precise_waits(void) {
+    FFSchedConfig cfg = { .frame_interval = 1.0 / 60 };
+    FFSched* s = ff_sched_create(&cfg);
+    CHECK(s);
+    ff_sched_play(s);
+    enum { N = 30 };
+    int64_t worst = 0;
+    for (int i = 0; i < N; ++i) {
+        double pts = 0.05 + i / 60.0;
+        int r = ff_sched_wait(s, pts);
+        int64_t now = ff_now_ns();
+        CHECK(r == FF_SCHED_PRESENT || r == FF_SCHED_DROP);
+        if (r != FF_SCHED_PRESENT) continue;
+        int64_t err = now - (ff_sched_due_ns(s, pts) - llround(cfg.frame_interval / 2 * 1e9));
+        if (err > worst) worst = err;
+        ff_sched_presented(s, pts);
+    }
+    FFSchedStats st;
+    ff_sched_get_stats(s, &st);
+    CHECK_EQ(st.presented + st.dropped, N);
+    CHECK(st.waits >= N / 2);
+    printf("sched: %llu presented, %llu dropped, wake error mean %.1f us max %.1f us, late mean %.2f ms\n",
+           (unsigned long long)st.presented, (unsigned long long)st.dropped,
+           st.wake_error_mean_ns / 1e3, st.wake_error_max_ns / 1e3, st.late_mean_ns / 1e6);
+    CHECK(worst < 20 * MS);   // loose: shared CI machines
+    ff_sched_destroy(s);
+}
+
+typedef struct Waiter {
+    FFSched* s;
+    double   pts;
+    int      result;
+} Waiter;
+
+static void* wait_thread(void* arg) {
+    Waiter* w = arg;
+    w->result = ff_sched_wait(w->s, w->pts);
+    return NULL;
+}
+
+// Waits sleep until something changes, however far away the deadline is.
+static void test_interrupts(void) {
+    FFSchedConfig cfg = { .frame_interval = 1.0 / 60 };
+    FFSched* s = ff_sched_create(&cfg);
+    CHECK(s);
+    Waiter w = { s, 1.0, 99 };   // paused: held until play
+    pthread_t th;
+    int64_t t0 = ff_now_ns();
+    CHECK_EQ(pthread_create(&th, NULL, wait_thread, &w), 0);
+    ff_sleep_until_ns(ff_now_ns() + 20 * MS);
+    ff_sched_play(s);
+    pthread_join(th, NULL);
+    CHECK_EQ(w.result, FF_SCHED_WOKEN);
+
+    w.pts = 100.0;   // playing, due in 100 s
+    w.result = 99;
+    CHECK_EQ(pthread_create(&th, NULL, wait_thread, &w), 0);
+    ff_sleep_until_ns(ff_now_ns() + 20 * MS);
+    ff_sched_stop(s);
+    pthread_join(th, NULL);
+    CHECK_EQ(w.result, FF_SCHED_STOPPED);
+    CHECK(ff_now_ns() - t0 < 2000 * MS);
+
+    FFSchedStats st;
+    ff_sched_get_stats(s, &st);
+    CHECK_EQ(st.interrupted, 2);
+    ff_sched_destroy(s);
+}
+
+int main(void) {
+    test_decisions();
+    test_precise_waits();
+    test_interrupts();
+    printf("test_sched: ok\n");
+    return 0;
+}
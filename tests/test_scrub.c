@@ -0,0 +1,247 @@
+#include "ffcache.h"
+#include "ffdecode.h"
+#include "ffpool.h"
+#include "ffscrub.h"
+#include "ffutil.h"
+#include "synthetic_decoder.h"
+#include "test_util.h"
+
+enum { W = 64, H = 36, FRAMES = 600, GOP = 30, COST_US = 2000 };
+
+static FFPlayer* open_clip(void) {
+    char path[64];
+    snprintf(path, sizeof(path), "synthetic:%d:%d:%d:%d:%d", W, H, FRAMES, GOP, COST_US);
+    FFPlayer* p = ff_open(path, NULL, NULL, NULL, NULL);
+    CHECK(p);
+    FFFramePoolConfig pc = { .max_buffers = 64, .wait_timeout_ms = 1000 };
+    FFFramePool* pool = ff_pool_create(&pc);
+    CHECK(pool);
+    CHECK_EQ(ff_set_sink(p, ff_sink_pool_create(pool)), 0);
+    ff_pool_destroy(pool);
+    return p;
+}
+
+static FFFrameCache* small_cache(void) {
+    FFFrameRef* probe = ff_frame_alloc(W, H, FF_PIXFMT_BGRA);
+    FFFrameCacheConfig cc = { .budget_bytes = 32 * ff_frame_bytes(probe) };
+    ff_frame_release(probe);
+    FFFrameCache* c = ff_cache_create(&cc);
+    CHECK(c);
+    return c;
+}
+
+static void check_full(FFFrameRef* f, int64_t index) {
+    CHECK(f);
+    CHECK_EQ(ff_frame_index(f), index);
+    CHECK_EQ(ff_frame_width(f), W);
+    const uint8_t* px = ff_frame_plane(f, 0) + 7 * ff_frame_stride(f, 0) + 9 * 4;
+    for (int ch = 0; ch < 4; ++ch) CHECK_EQ(px[ch], synthetic_pixel(index, 9, 7, ch));
+}
+
+// Proxy stand-in: a quarter-size frame for any position.
+static FFFrameRef* quarter_frame(void* opaque, int64_t index) {
+    int* calls = opaque;
+    ++*calls;
+    FFFrameRef* f = ff_frame_alloc(W / 4, H / 4, FF_PIXFMT_BGRA);
+    if (f) ff_frame_set_timing(f, index / 60.0, index);
+    return f;
+}
+
+static void test_tiers(void) {
+    FFPlayer* p = open_clip();
+    FFFrameCache* cache = small_cache();
+    int coarse_calls = 0;
+    FFScrubConfig cfg = { .player = p, .cache = cache };
+    FFScrub* s = ff_scrub_create(&cfg);
+    CHECK(s);
+
+    FFFrameRef* f;
+    CHECK_EQ(ff_scrub_seek(s, 100, &f), FF_SCRUB_NONE);   // nothing to show yet
+    CHECK(!f);
+    CHECK_EQ(ff_scrub_poll(s, &f, 2000), 1);
+    check_full(f, 100);
+    ff_frame_release(f);
+    CHECK_EQ(ff_scrub_poll(s, &f, 0), 0);                 // delivered once
+
+    uint64_t decoded = synthetic_decode_count();
+    CHECK_EQ(ff_scrub_seek(s, 100, &f), FF_SCRUB_EXACT);  // no decode needed
+    check_full(f, 100);
+    ff_frame_release(f);
+    CHECK_EQ(ff_scrub_poll(s, &f, 50), 0);
+    CHECK_EQ(synthetic_decode_count(), decoded);
+
+    CHECK_EQ(ff_scrub_seek(s, 103, &f), FF_SCRUB_NEAR);   // frame 100 from the cache
+    check_full(f, 100);
+    ff_frame_release(f);
+    CHECK_EQ(ff_scrub_poll(s, &f, 2000), 1);
+    check_full(f, 103);
+    ff_frame_release(f);
+    ff_scrub_destroy(s);
+
+    // With a coarse tier: near cached frames only within coarse_distance.
+    cfg.coarse = quarter_frame;
+    cfg.coarse_opaque = &coarse_calls;
+    cfg.coarse_distance = 5;
+    s = ff_scrub_create(&cfg);
+    CHECK(s);
+    CHECK_EQ(ff_scrub_seek(s, 106, &f), FF_SCRUB_NEAR);
+    check_full(f, 103);
+    ff_frame_release(f);
+    CHECK_EQ(ff_scrub_seek(s, 300, &f), FF_SCRUB_COARSE);
+    CHECK_EQ(ff_frame_index(f), 300);
+    CHECK_EQ(ff_frame_width(f), W / 4);
+    ff_frame_release(f);
+    CHECK_EQ(coarse_calls, 1);
+    CHECK_EQ(ff_scrub_poll(s, &f, 2000), 1);
+    check_full(f, 300);
+    ff_frame_release(f);
+
+    FFScrubStats st;
+    ff_scrub_get_stats(s, &st);
+    CHECK_EQ(st.requests, 2);
+    CHECK_EQ(st.near, 1);
+    CHECK_EQ(st.coarse, 1);
+    CHECK(st.refined >= 1);
+    ff_scrub_destroy(s);
+    ff_cache_destroy(cache);
+    ff_close(p);
+}
+
+// With the player's own frame cache: frames played are scrubbed to without a
+// decode, and scrubbed frames are played from the cache.
+static void test_player_cache(void) {
+    FFPlayer* p = open_clip();
+    FFFrameRef* probe = ff_frame_alloc(W, H, FF_PIXFMT_BGRA);
+    CHECK_EQ(ff_set_frame_cache(p, 32 * ff_frame_bytes(probe), 0, 0), 0);
+    ff_frame_release(probe);
+    FFFrameRef* f;
+    CHECK_EQ(ff_seek_frame(p, 200), 0);
+    for (int i = 0; i < 5; ++i) {
+        CHECK_EQ(ff_next_frame_ref(p, &f), 1);
+        ff_frame_release(f);
+    }
+
+    FFScrubConfig cfg = { .player = p, .cache = ff_get_frame_cache(p) };
+    FFScrub* s = ff_scrub_create(&cfg);
+    CHECK(s);
+    uint64_t decoded = synthetic_decode_count();
+    CHECK_EQ(ff_scrub_seek(s, 202, &f), FF_SCRUB_EXACT);   // played, so cached
+    check_full(f, 202);
+    ff_frame_release(f);
+    CHECK_EQ(synthetic_decode_count(), decoded);
+    CHECK_EQ(ff_scrub_seek(s, 400, &f), FF_SCRUB_NEAR);
+    ff_frame_release(f);
+    CHECK_EQ(ff_scrub_poll(s, &f, 2000), 1);
+    check_full(f, 400);
+    ff_frame_release(f);
+    ff_scrub_destroy(s);
+
+    // Playback from the scrubbed frame: a cache hit, no decode or seek.
+    decoded = synthetic_decode_count();
+    uint64_t seeks = synthetic_seek_count();
+    CHECK_EQ(ff_seek_frame(p, 400), 0);
+    CHECK_EQ(ff_next_frame_ref(p, &f), 1);
+    check_full(f, 400);
+    ff_frame_release(f);
+    CHECK_EQ(synthetic_decode_count(), decoded);
+    CHECK_EQ(synthetic_seek_count(), seeks);
+    ff_close(p);
+}
+
+// A blocking poll returns when nothing more is coming for the latest request.
+static void test_poll_ends(void) {
+    FFPlayer* p = open_clip();
+    FFFrameCache* cache = small_cache();
+    FFScrubConfig cfg = { .player = p, .cache = cache };
+    FFScrub* s = ff_scrub_create(&cfg);
+    CHECK(s);
+
+    FFFrameRef* f;
+    CHECK_EQ(ff_scrub_poll(s, &f, -1), 0);                // no request yet
+    CHECK_EQ(ff_scrub_seek(s, 40, NULL), FF_SCRUB_NONE);
+    CHECK_EQ(ff_scrub_poll(s, &f, -1), 1);
+    ff_frame_release(f);
+    CHECK_EQ(ff_scrub_poll(s, &f, -1), 0);                // already delivered
+    CHECK_EQ(ff_scrub_seek(s, 40, NULL), FF_SCRUB_EXACT);
+    CHECK_EQ(ff_scrub_poll(s, &f, -1), 0);                // nothing to refine
+    CHECK(!f);
+
+    // Past the end: the decode fails and the poll reports it.
+    CHECK_EQ(ff_scrub_seek(s, FRAMES + 10, &f), FF_SCRUB_NEAR);
+    ff_frame_release(f);
+    CHECK_EQ(ff_scrub_poll(s, &f, -1), -1);
+    CHECK(!f);
+    FFScrubStats st;
+    ff_scrub_get_stats(s, &st);
+    CHECK_EQ(st.failed, 1);
+
+    // The next request refines as usual.
+    CHECK_EQ(ff_scrub_seek(s, 70, NULL), FF_SCRUB_NEAR);
+    CHECK_EQ(ff_scrub_poll(s, &f, -1), 1);
+    check_full(f, 70);
+    ff_frame_release(f);
+    ff_scrub_destroy(s);
+    ff_cache_destroy(cache);
+    ff_close(p);
+}
+
+// A fast drag: requests arrive far faster than full-resolution frames can be
+// decoded. Each one is answered at once from the coarse tier, stale decodes are
+// dropped, and the settled position is refined without working off a backlog.
+static void test_drag(void) {
+    enum { STEPS = 80, STEP_MS = 3 };
+    FFPlayer* p = open_clip();
+    int coarse_calls = 0;
+    FFScrubConfig cfg = { .player = p, .coarse = quarter_frame, .coarse_opaque = &coarse_calls };
+    FFScrub* s = ff_scrub_create(&cfg);
+    CHECK(s);
+
+    uint64_t decoded = synthetic_decode_count();
+    uint64_t backlog_frames = 0;   // what decoding every request would cost
+    int64_t target = 0;
+    for (int i = 0; i < STEPS; ++i) {
+        target = 17 + i * 7;
+        backlog_frames += target % GOP + 1;
+        FFFrameRef* f;
+        CHECK_EQ(ff_scrub_seek(s, target, &f), FF_SCRUB_COARSE);
+        ff_frame_release(f);
+        ff_sleep_until_ns(ff_now_ns() + STEP_MS * 1000000);
+    }
+    int64_t settled = ff_now_ns();
+    FFFrameRef* f;
+    CHECK_EQ(ff_scrub_poll(s, &f, 2000), 1);
+    int64_t settle_ms = (ff_now_ns() - settled) / 1000000;
+    check_full(f, target);
+    ff_frame_release(f);
+
+    FFScrubStats st;
+    ff_scrub_get_stats(s, &st);
+    uint64_t spent = synthetic_decode_count() - decoded;
+    printf("scrub drag of %d requests every %d ms: first pixel avg %.3f ms max %.3f ms; "
+           "%llu refined, %llu cancelled, %llu superseded; decoded %llu frames (%llu without cancelling); "
+           "settled frame after %lld ms\n",
+           STEPS, STEP_MS, st.first_pixel_ns_avg / 1e6, st.first_pixel_ns_max / 1e6,
+           (unsigned long long)st.refined, (unsigned long long)st.cancelled,
+           (unsigned long long)st.superseded, (unsigned long long)spent,
+           (unsigned long long)backlog_frames, (long long)settle_ms);
+    CHECK_EQ(st.requests, STEPS);
+    CHECK_EQ(st.coarse, STEPS);
+    CHECK(st.cancelled + st.superseded > 0);
+    CHECK(spent < backlog_frames / 2);
+    // One seek costs at most GOP frames of decoding: no queue to work through.
+    CHECK(settle_ms < GOP * COST_US / 1000 + 200);   // margin: loaded CI machines
+    CHECK(st.first_pixel_ns_max < 20 * 1000000);
+    ff_scrub_destroy(s);
+    ff_close(p);
+}
+
+int main(void) {
+    ff_frame_debug_enable(1);
+    test_tiers();
+    test_player_cache();
+    test_poll_ends();
+    test_drag();
+    CHECK_EQ(ff_frame_debug_live_count(), 0);
+    printf("test_scrub: ok\n");
+    return 0;
+}
@@ -0,0 +1,63 @@
+#include "ffsink.h"
+#include "test_util.h"
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+static void test_memory_sink_roundtrip(void) {
+    FFFrameSink* s = ff_sink_memory_create();
+    CHECK(s);
+    CHECK(!ff_sink_is_corevideo(s));
+
+    FFSinkImage img;
+    CHECK_EQ(s->acquire(s, 33, 7, FF_PIXFMT_BGRA, &img), 0);
+    CHECK(img.data[0]);
+    CHECK(img.linesize[0] >= 33 * 4);
+    CHECK_EQ(img.linesize[0] % 64, 0);
+    CHECK_EQ((uintptr_t)img.data[0] % 64, 0);
+
+    for (int y = 0; y < img.height; ++y)
+        memset(img.data[0] + (size_t)y * img.linesize[0], y, (size_t)img.width * 4);
+
+    FFFrameRef* f = s->commit(s, &img, 1.5, 12);
+    CHECK(f);
+    CHECK_EQ(ff_frame_width(f), 33);
+    CHECK_EQ(ff_frame_height(f), 7);
+    CHECK(ff_frame_pts(f) == 1.5);
+    CHECK_EQ(ff_frame_index(f), 12);
+    CHECK_EQ(ff_frame_plane(f, 0)[6 * ff_frame_stride(f, 0) + 10], 6);
+
+    // Frames outlive the sink that produced them.
+    ff_sink_destroy(s);
+    ff_frame_release(f);
+}
+
+static void test_memory_sink_discard(void) {
+    FFFrameSink* s = ff_sink_memory_create();
+    FFSinkImage img;
+    CHECK_EQ(s->acquire(s, 16, 16, FF_PIXFMT_BGRA, &img), 0);
+    s->discard(s, &img);
+    CHECK(img.priv == NULL);
+    CHECK(s->acquire(s, 0, 16, FF_PIXFMT_BGRA, &img) < 0);
+    ff_sink_destroy(s);
+}
+
+static void test_default_sink(void) {
+    FFFrameSink* s = ff_sink_default_create();
+    CHECK(s);
+#ifdef __APPLE__
+    CHECK(ff_sink_is_corevideo(s));
+#else
+    CHECK(strcmp(s->name, "pool") == 0);
+    CHECK(s->pool_stats != NULL);
+#endif
+    ff_sink_destroy(s);
+}
+
+int main(void) {
+    test_memory_sink_roundtrip();
+    test_memory_sink_discard();
+    test_default_sink();
+    printf("test_sink: ok\n");
+    return 0;
+}
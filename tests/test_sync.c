@@ -0,0 +1,223 @@
+#include "ffsched.h"
+#include "ffsync.h"
+#include "ffutil.h"
+#include "test_util.h"
+#include <math.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// Master and followers on loopback multicast. Each run picks its own port and
+// session so parallel runs do not hear each other.
+
+enum { FOLLOWERS = 3, SAMPLES = 20 };
+
+#define FPS 60.0
+
+static int g_port;
+static uint32_t g_session;
+
+static FFSyncConfig sync_config(uint32_t session) {
+    FFSyncConfig c = { .port = g_port, .interface = "127.0.0.1", .session = session };
+    return c;
+}
+
+static FFSched* make_sched(FFClock clock) {
+    FFSchedConfig c = { .clock = clock, .frame_interval = 1 / FPS };
+    FFSched* s = ff_sched_create(&c);
+    CHECK(s);
+    return s;
+}
+
+// A follower machine's clock: its own epoch, and a rate off by `ppm`.
+typedef struct DriftClock {
+    double  ppm;
+    int64_t epoch;
+} DriftClock;
+
+static int64_t drift_now(void* opaque) {
+    const DriftClock* d = opaque;
+    return (int64_t)(ff_now_ns() * (1 + d->ppm * 1e-6)) + d->epoch;
+}
+
+static void sleep_ms(int ms) {
+    ff_sleep_until_ns(ff_now_ns() + ms * 1000000LL);
+}
+
+// A follower ignores other sessions; one of its own locks it on.
+static void test_sessions(void) {
+    FFSched* ms = make_sched(ff_clock_host());
+    FFSched* fs = make_sched(ff_clock_host());
+    FFSyncConfig fc = sync_config(g_session);
+    FFSyncFollower* f = ff_sync_follower_create(&fc, fs);
+    CHECK(f);
+    CHECK(isnan(ff_sync_follower_offset(f)));
+    FFSyncConfig other = sync_config(g_session + 1);
+    FFSyncMaster* m = ff_sync_master_create(&other, ms);
+    CHECK(m);
+    ff_sched_seek(ms, 5);
+    ff_sched_play(ms);
+    ff_sync_master_kick(m);
+    sleep_ms(150);
+    FFSyncStats st;
+    ff_sync_follower_get_stats(f, &st);
+    CHECK(ff_sync_master_sent(m) > 2);
+    CHECK_EQ(st.packets, 0);
+    CHECK(st.stale > 0);
+    CHECK(!st.locked);
+    CHECK(!ff_sched_is_playing(fs));
+    ff_sync_master_destroy(m);
+
+    FFSyncConfig mc = sync_config(g_session);
+    m = ff_sync_master_create(&mc, ms);
+    CHECK(m);
+    sleep_ms(150);
+    ff_sync_follower_get_stats(f, &st);
+    CHECK(st.packets > 2);
+    CHECK(st.locked && st.master_playing);
+    CHECK(ff_sched_is_playing(fs));
+    CHECK(fabs(ff_sync_follower_offset(f)) < 0.25);
+
+    // Master pauses: so does the follower, on exactly the same position.
+    ff_sched_pause(ms);
+    ff_sync_master_kick(m);
+    sleep_ms(50);
+    CHECK(!ff_sched_is_playing(fs));
+    CHECK(ff_sched_time(fs) == ff_sched_time(ms));
+    ff_sync_master_destroy(m);
+
+    // Restarted master: its sequence starts over and is followed at once.
+    ff_sync_follower_get_stats(f, &st);
+    uint64_t packets = st.packets, stale = st.stale;
+    ff_sched_play(ms);
+    m = ff_sync_master_create(&mc, ms);
+    CHECK(m);
+    sleep_ms(100);
+    ff_sync_follower_get_stats(f, &st);
+    CHECK_EQ(st.restarts, 1);
+    CHECK_EQ(st.stale, stale);
+    CHECK(st.packets > packets + 2);
+    CHECK(ff_sched_is_playing(fs));
+    ff_sync_master_destroy(m);
+    ff_sync_follower_destroy(f);
+
+    FFSyncConfig bad = sync_config(g_session);
+    bad.group = "not an address";
+    CHECK(!ff_sync_follower_create(&bad, fs));
+    CHECK(!ff_sync_master_create(&bad, ms));
+    ff_sched_destroy(ms);
+    ff_sched_destroy(fs);
+}
+
+typedef struct Report {
+    int64_t     host_ns[SAMPLES];   // when each sample was taken
+    double      media[SAMPLES];     // follower media time then
+    FFSyncStats st;
+    int         jumps;              // jumped callbacks
+} Report;
+
+static void on_jump(void* opaque, double t) {
+    ((Report*)opaque)->jumps++;
+}
+
+// Follower process: a machine with its own drifting clock that starts
+// paused at 0 and follows whatever the master does for `run_ms`, then samples
+// its media clock.
+static void follower_process(int id, int fd, int run_ms) {
+    DriftClock dc = { .ppm = (id - 1) * 250.0, .epoch = (int64_t)(id + 1) * 7777777777LL };
+    FFClock clock = { drift_now, NULL, &dc };
+    FFSched* s = make_sched(clock);
+    Report r = { 0 };
+    FFSyncConfig c = sync_config(g_session);
+    c.clock  = clock;
+    c.jumped = on_jump;
+    c.opaque = &r;
+    FFSyncFollower* f = ff_sync_follower_create(&c, s);
+    if (!f) _exit(2);
+    sleep_ms(run_ms);
+    for (int i = 0; i < SAMPLES; ++i) {
+        sleep_ms(23);
+        r.host_ns[i] = ff_now_ns();
+        r.media[i]   = ff_sched_time_at(s, drift_now(&dc));
+    }
+    ff_sync_follower_get_stats(f, &r.st);
+    ff_sync_follower_destroy(f);
+    ff_sched_destroy(s);
+    ssize_t wr = write(fd, &r, sizeof(r));
+    _exit(wr == (ssize_t)sizeof(r) ? 0 : 3);
+}
+
+// Master and three follower processes. The master jumps forward (followers
+// skip) and back (followers hold); meanwhile their clocks drift by up to
+// 250 ppm. At the end every follower must show the master's frame.
+static void test_processes(void) {
+    int fds[2];
+    CHECK(pipe(fds) == 0);
+    pid_t pids[FOLLOWERS];
+    for (int i = 0; i < FOLLOWERS; ++i) {
+        pids[i] = fork();
+        CHECK(pids[i] >= 0);
+        if (pids[i] == 0) {
+            close(fds[0]);
+            follower_process(i, fds[1], 1600);
+        }
+    }
+    close(fds[1]);
+
+    sleep_ms(100);   // followers joined
+    FFSched* ms = make_sched(ff_clock_host());
+    FFSyncConfig mc = sync_config(g_session);
+    FFSyncMaster* m = ff_sync_master_create(&mc, ms);
+    CHECK(m);
+    ff_sched_seek(ms, 10);
+    ff_sched_play(ms);
+    ff_sync_master_kick(m);
+    sleep_ms(500);
+    ff_sched_seek(ms, 40);   // followers behind: skip
+    ff_sync_master_kick(m);
+    sleep_ms(400);
+    ff_sched_seek(ms, 39);   // ahead: hold
+    ff_sync_master_kick(m);
+
+    double worst_ms = 0;
+    int worst_frames = 0;
+    for (int i = 0; i < FOLLOWERS; ++i) {
+        Report r;
+        CHECK(read(fds[0], &r, sizeof(r)) == (ssize_t)sizeof(r));
+        for (int k = 0; k < SAMPLES; ++k) {
+            double master = ff_sched_time_at(ms, r.host_ns[k]);
+            double off = r.media[k] - master;
+            int frames = (int)(floor(r.media[k] * FPS + 1e-6) - floor(master * FPS + 1e-6));
+            if (fabs(off) * 1e3 > worst_ms) worst_ms = fabs(off) * 1e3;
+            if (abs(frames) > worst_frames) worst_frames = abs(frames);
+        }
+        printf("sync follower: packets %llu skips %llu holds %llu slews %llu  offset avg %.3f ms max %.3f ms\n",
+               (unsigned long long)r.st.packets, (unsigned long long)r.st.skips, (unsigned long long)r.st.holds,
+               (unsigned long long)r.st.slews, r.st.offset_ns_avg / 1e6, r.st.offset_ns_max / 1e6);
+        CHECK(r.st.locked && r.st.master_playing);
+        CHECK(r.st.skips >= 1);
+        CHECK(r.st.holds >= 1);
+        CHECK_EQ(r.jumps, r.st.skips + r.st.holds);
+        CHECK(r.st.slews > 10);
+        CHECK(r.st.offset_ns_max < 4000000);
+    }
+    for (int i = 0; i < FOLLOWERS; ++i) {
+        int status = 0;
+        waitpid(pids[i], &status, 0);
+        CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    }
+    close(fds[0]);
+    printf("sync inter-instance offset: max %.3f ms, %d frame(s)\n", worst_ms, worst_frames);
+    CHECK(worst_ms < 0.25 * 1000 / FPS);
+    CHECK(worst_frames <= 1);   // only ever across a frame boundary
+    ff_sync_master_destroy(m);
+    ff_sched_destroy(ms);
+}
+
+int main(void) {
+    g_port    = 30000 + getpid() % 20000;
+    g_session = (uint32_t)getpid();
+    test_sessions();
+    test_processes();
+    printf("test_sync: ok\n");
+    return 0;
+}
@@ -0,0 +1,331 @@
+#include "ffconvert.h"
+#include "fftransition.h"
+#include "ffutil.h"
+#include "synthetic_decoder.h"
+#include "test_util.h"
+#include <math.h>
+#include <string.h>
+
+enum { W = 48, H = 27 };
+
+#define FRAME_NS 16666667LL
+
+static FFPlayer* open_clip(int frames, int cost_us) {
+    char path[64];
+    snprintf(path, sizeof(path), "synthetic:%d:%d:%d:10:%d", W, H, frames, cost_us);
+    FFPlayer* p = ff_open(path, NULL, NULL, NULL, NULL);
+    CHECK(p);
+    return p;
+}
+
+typedef struct Retired {
+    FFPlayer* p[8];
+    int       n;
+} Retired;
+
+static void on_retired(void* opaque, FFPlayer* p) {
+    Retired* r = opaque;
+    CHECK(r->n < 8);
+    r->p[r->n++] = p;
+}
+
+// Every pixel of f is frame ia of one clip mixed with frame ib of the other.
+static int mixed_ok(const FFFrameRef* f, int64_t ia, int64_t ib, int mix) {
+    const uint8_t* px = ff_frame_plane(f, 0);
+    int stride = ff_frame_stride(f, 0);
+    for (int y = 0; y < H; ++y)
+        for (int x = 0; x < W; ++x)
+            for (int c = 0; c < 4; ++c) {
+                int a = synthetic_pixel(ia, x, y, c), b = synthetic_pixel(ib, x, y, c);
+                if (px[y * stride + x * 4 + c] != (a * (256 - mix) + b * mix + 128) >> 8) return 0;
+            }
+    return 1;
+}
+
+static void expect(FFTransition* t, FFPlayer* p, int64_t index, double mix) {
+    FFFrameRef* f;
+    FFTransitionPos pos;
+    CHECK_EQ(ff_transition_next(t, &f, &pos), 1);
+    CHECK(pos.player == p);
+    CHECK_EQ(pos.index, index);
+    CHECK_EQ(ff_frame_index(f), index);
+    CHECK(fabs(pos.mix - mix) < 1e-9);
+    ff_frame_release(f);
+}
+
+static void test_curves(void) {
+    for (int c = FF_CURVE_LINEAR; c <= FF_CURVE_EASE_OUT; ++c) {
+        CHECK(ff_transition_curve(c, 0) == 0);
+        CHECK(ff_transition_curve(c, 1) == 1);
+        CHECK(ff_transition_curve(c, 2) == 1);
+        double prev = 0;
+        for (int i = 1; i <= 20; ++i) {
+            double v = ff_transition_curve(c, i / 20.0);
+            CHECK(v >= prev);
+            prev = v;
+        }
+    }
+    CHECK(ff_transition_curve(FF_CURVE_SMOOTH, 0.5) == 0.5);
+    CHECK(ff_transition_curve(FF_CURVE_EASE_IN, 0.5) == 0.25);
+    CHECK(ff_transition_curve(FF_CURVE_EASE_OUT, 0.5) == 0.75);
+}
+
+// Pass-through, a crossfade on the curve, then the incoming clip alone; cuts.
+static void test_crossfade_and_cut(void) {
+    FFWorkers* w = ff_workers_create(3);
+    Retired ret = { 0 };
+    FFTransitionConfig cfg = { .workers = w, .retired = on_retired, .opaque = &ret };
+    FFTransition* t = ff_transition_create(&cfg);
+    CHECK(t);
+    FFPlayer* a = open_clip(100, 0);
+    FFPlayer* b = open_clip(100, 0);
+    FFPlayer* c = open_clip(100, 0);
+    FFFrameRef* f;
+    CHECK_EQ(ff_transition_next(t, &f, NULL), -1);   // nothing live
+    CHECK_EQ(ff_transition_crossfade(t, b, 4, FF_CURVE_LINEAR), -1);
+
+    CHECK_EQ(ff_transition_cut(t, a), 0);
+    expect(t, a, 0, 0);
+    expect(t, a, 1, 0);
+    CHECK_EQ(ff_seek_frame(b, 50), 0);
+    CHECK_EQ(ff_transition_crossfade(t, b, 3, FF_CURVE_SMOOTH), 0);
+    CHECK(ff_transition_active(t));
+    for (int i = 0; i < 3; ++i) {
+        double mix = ff_transition_curve(FF_CURVE_SMOOTH, (i + 1) / 4.0);
+        FFTransitionPos pos;
+        CHECK_EQ(ff_transition_next(t, &f, &pos), 1);
+        CHECK(pos.player == b && pos.index == 50 + i && pos.mix == mix);
+        CHECK_EQ(ff_frame_index(f), 50 + i);
+        CHECK(mixed_ok(f, 2 + i, 50 + i, (int)lrint(mix * 256)));
+        ff_frame_release(f);
+    }
+    CHECK(!ff_transition_active(t));
+    CHECK(ff_transition_live(t) == b);
+    CHECK(ret.n == 1 && ret.p[0] == a);
+    expect(t, b, 53, 0);
+
+    // A cut in the middle of a crossfade drops the incoming clip too.
+    CHECK_EQ(ff_transition_crossfade(t, a, 10, FF_CURVE_LINEAR), 0);
+    expect(t, a, 5, 1 / 11.0);
+    CHECK_EQ(ff_transition_cut(t, c), 0);
+    CHECK(ret.n == 3 && ret.p[1] == a && ret.p[2] == b);
+    expect(t, c, 0, 0);
+
+    FFTransitionStats st;
+    ff_transition_get_stats(t, &st);
+    CHECK_EQ(st.crossfades, 2);
+    CHECK_EQ(st.mixed, 4);
+    CHECK_EQ(st.cuts, 1);
+    CHECK_EQ(st.cut_short, 0);
+    ff_transition_destroy(t);
+    ff_close(a);
+    ff_close(b);
+    ff_close(c);
+    ff_workers_destroy(w);
+}
+
+// A clip that runs out during a crossfade leaves the other one playing.
+static void test_clip_ends(void) {
+    Retired ret = { 0 };
+    FFTransitionConfig cfg = { .retired = on_retired, .opaque = &ret };
+    FFTransition* t = ff_transition_create(&cfg);
+    CHECK(t);
+    FFPlayer* a = open_clip(3, 0);
+    FFPlayer* b = open_clip(100, 0);
+    CHECK_EQ(ff_transition_cut(t, a), 0);
+    expect(t, a, 0, 0);
+    CHECK_EQ(ff_transition_crossfade(t, b, 8, FF_CURVE_LINEAR), 0);
+    expect(t, b, 0, 1 / 9.0);
+    expect(t, b, 1, 2 / 9.0);
+    expect(t, b, 2, 1);   // a has ended
+    CHECK(!ff_transition_active(t));
+    CHECK(ret.n == 1 && ret.p[0] == a);
+    expect(t, b, 3, 0);
+
+    FFPlayer* c = open_clip(2, 0);
+    CHECK_EQ(ff_transition_crossfade(t, c, 8, FF_CURVE_LINEAR), 0);
+    expect(t, c, 0, 1 / 9.0);
+    expect(t, c, 1, 2 / 9.0);
+    expect(t, b, 6, 0);   // c has ended
+    CHECK(ret.n == 2 && ret.p[1] == c);
+    CHECK(ff_transition_live(t) == b);
+
+    FFTransitionStats st;
+    ff_transition_get_stats(t, &st);
+    CHECK_EQ(st.cut_short, 2);
+    ff_transition_destroy(t);
+    ff_close(a);
+    ff_close(b);
+    ff_close(c);
+}
+
+static int g_interrupt;
+
+static int interrupt_cb(void* opaque) {
+    (void)opaque;
+    return g_interrupt;
+}
+
+// A failed or interrupted decode is returned, not taken for the end of a
+// clip: both clips stay, and the one that did decode loses no frame.
+static void test_decode_error(void) {
+    Retired ret = { 0 };
+    FFTransitionConfig cfg = { .retired = on_retired, .opaque = &ret };
+    FFTransition* t = ff_transition_create(&cfg);
+    CHECK(t);
+    FFPlayer* a = open_clip(100, 0);
+    FFPlayer* b = open_clip(100, 0);
+    CHECK_EQ(ff_transition_cut(t, a), 0);
+    expect(t, a, 0, 0);
+    CHECK_EQ(ff_transition_crossfade(t, b, 4, FF_CURVE_LINEAR), 0);
+    expect(t, b, 0, 1 / 5.0);
+
+    ff_set_interrupt(b, interrupt_cb, NULL);
+    g_interrupt = 1;
+    FFFrameRef* f;
+    CHECK_EQ(ff_transition_next(t, &f, NULL), -4);
+    CHECK(!f);
+    CHECK_EQ(ff_transition_next(t, &f, NULL), -4);
+    CHECK(ff_transition_active(t));
+    CHECK_EQ(ret.n, 0);
+
+    g_interrupt = 0;
+    FFTransitionPos pos;
+    CHECK_EQ(ff_transition_next(t, &f, &pos), 1);
+    CHECK(pos.player == b && pos.index == 1);
+    CHECK(mixed_ok(f, 2, 1, (int)lrint(2 / 5.0 * 256)));   // a's frame 2 waited
+    ff_frame_release(f);
+    expect(t, b, 2, 3 / 5.0);
+
+    FFTransitionStats st;
+    ff_transition_get_stats(t, &st);
+    CHECK_EQ(st.cut_short, 0);
+    CHECK_EQ(st.mixed, 3);
+    ff_transition_destroy(t);
+    ff_close(a);
+    ff_close(b);
+}
+
+// Both clips decode at once: a mixed frame costs one decode, not two.
+static void test_concurrent_decode(void) {
+    enum { COST_US = 8000, FRAMES = 12 };
+    FFWorkers* w = ff_workers_create(2);
+    FFTransitionConfig cfg = { .workers = w };
+    FFTransition* t = ff_transition_create(&cfg);
+    FFPlayer* a = open_clip(100, COST_US);
+    FFPlayer* b = open_clip(100, COST_US);
+    CHECK_EQ(ff_transition_cut(t, a), 0);
+    CHECK_EQ(ff_transition_crossfade(t, b, FRAMES, FF_CURVE_LINEAR), 0);
+    for (int i = 0; i < FRAMES; ++i) {
+        FFFrameRef* f;
+        CHECK_EQ(ff_transition_next(t, &f, NULL), 1);
+        ff_frame_release(f);
+    }
+    FFTransitionStats st;
+    ff_transition_get_stats(t, &st);
+    printf("transition: two clips at %d ms a frame decode in %.2f ms avg (max %.2f ms)\n",
+           COST_US / 1000, st.decode_ns_avg / 1e6, st.decode_ns_max / 1e6);
+    CHECK_EQ(st.mixed, FRAMES);
+    CHECK(st.decode_ns_avg >= COST_US * 1000.0);
+    CHECK(st.decode_ns_avg < COST_US * 1000.0 * 2);   // one after the other takes at least 2x
+    CHECK_BENCH(st.decode_ns_avg < COST_US * 1000.0 * 1.5);
+    ff_transition_destroy(t);
+    ff_close(a);
+    ff_close(b);
+    ff_workers_destroy(w);
+}
+
+static int64_t time_blend(FFWorkers* w, const FFSourceImage* a, const FFSourceImage* b, int mix,
+                          int alpha_aware, const FFSinkImage* dst) {
+    FFBlend blend = { mix, alpha_aware };
+    int64_t t0 = ff_now_ns();
+    CHECK_EQ(ff_convert_blend(w, a, b, &blend, dst, NULL), 0);
+    return ff_now_ns() - t0;
+}
+
+static FFSinkImage sink_image_of(FFFrameRef* f) {
+    FFSinkImage d = { .data = { ff_frame_plane(f, 0) }, .linesize = { ff_frame_stride(f, 0) },
+                      .width = ff_frame_width(f), .height = ff_frame_height(f), .format = FF_PIXFMT_BGRA };
+    return d;
+}
+
+// Mixing two 4K yuva444p12 pictures (what NotchLC decodes to) in one pass,
+// against converting both to BGRA frames first and mixing those. Prints the
+// cost per frame and how many threads 60 fps takes at that rate. With
+// NOTCH_BENCH=1 the fused mix must fit one 60 fps frame on this machine's
+// threads and must not lose to converting first.
+static void test_4k_blend_rate(void) {
+    enum { BW = 3840, BH = 2160, ROUNDS = 6 };
+    size_t n = (size_t)BW * BH;
+    uint16_t* planes = malloc(n * 2 * 8);
+    CHECK(planes);
+    FFSourceImage src[2];
+    memset(src, 0, sizeof(src));
+    for (int s = 0; s < 2; ++s) {
+        uint16_t* p = planes + (size_t)s * 4 * n;
+        for (size_t i = 0; i < n; ++i) {
+            p[i]         = (uint16_t)(256 + (i * (7 + s)) % 3500);
+            p[n + i]     = (uint16_t)(256 + (i * 13) % 3500);
+            p[2 * n + i] = (uint16_t)(256 + (i * 5) % 3500);
+            p[3 * n + i] = (uint16_t)(s ? 4095 : i % 4096);
+        }
+        src[s].layout = FF_SRC_YUV;
+        src[s].bits = 12;
+        src[s].width = BW;
+        src[s].height = BH;
+        for (int c = 0; c < 4; ++c) {
+            src[s].data[c] = (const uint8_t*)(p + c * n);
+            src[s].linesize[c] = BW * 2;
+        }
+    }
+    FFFrameRef* out = ff_frame_alloc(BW, BH, FF_PIXFMT_BGRA);
+    FFFrameRef* conv[2] = { ff_frame_alloc(BW, BH, FF_PIXFMT_BGRA), ff_frame_alloc(BW, BH, FF_PIXFMT_BGRA) };
+    FFSinkImage dst = sink_image_of(out);
+    FFSinkImage cdst[2] = { sink_image_of(conv[0]), sink_image_of(conv[1]) };
+    FFSourceImage csrc[2];
+    memset(csrc, 0, sizeof(csrc));
+    for (int s = 0; s < 2; ++s) {
+        csrc[s].layout = FF_SRC_BGRA;
+        csrc[s].data[0] = cdst[s].data[0];
+        csrc[s].linesize[0] = cdst[s].linesize[0];
+        csrc[s].width = BW;
+        csrc[s].height = BH;
+    }
+
+    FFWorkers* w = ff_workers_create(0);
+    time_blend(w, &src[0], &src[1], 128, 1, &dst);   // warm up
+    int64_t fused = INT64_MAX, separate = INT64_MAX;
+    for (int i = 0; i < ROUNDS; ++i) {
+        int mix = 256 * (i + 1) / (ROUNDS + 1);
+        int64_t f = time_blend(w, &src[0], &src[1], mix, 1, &dst);
+        int64_t s = time_blend(w, &src[0], &src[0], 0, 0, &cdst[0]) +
+                    time_blend(w, &src[1], &src[1], 0, 0, &cdst[1]) +
+                    time_blend(w, &csrc[0], &csrc[1], mix, 1, &dst);
+        if (f < fused) fused = f;
+        if (s < separate) separate = s;
+    }
+    int threads = ff_workers_count(w);
+    printf("transition: 4K yuva444p12 mix on %d thread(s): %.2f ms fused, %.2f ms converting first; "
+           "60 fps needs %d thread(s) at this rate\n", threads, fused / 1e6, separate / 1e6,
+           (int)ceil(fused * threads / (double)FRAME_NS));
+    CHECK_BENCH(fused < FRAME_NS);
+    CHECK_BENCH(fused < separate * 5 / 4);
+    ff_workers_destroy(w);
+    ff_frame_release(out);
+    ff_frame_release(conv[0]);
+    ff_frame_release(conv[1]);
+    free(planes);
+}
+
+int main(void) {
+    ff_frame_debug_enable(1);
+    test_curves();
+    test_crossfade_and_cut();
+    test_clip_ends();
+    test_decode_error();
+    test_concurrent_decode();
+    test_4k_blend_rate();
+    CHECK_EQ(ff_frame_debug_live_count(), 0);
+    printf("test_transition: ok\n");
+    return 0;
+}
@@ -0,0 +1,31 @@
+#pragma once
+#include <stdio.h>
+#include <stdlib.h>
+
+// Minimal check macros for the headless core tests. A failed CHECK prints the
+// location and exits non-zero so ctest reports it.
+#define CHECK(cond) do { \
+    if (!(cond)) { \
+        fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #cond); \
+        exit(1); \
+    } \
+} while (0)
+
+#define CHECK_EQ(a, b) do { \
+    long long _a = (long long)(a), _b = (long long)(b); \
+    if (_a != _b) { \
+        fprintf(stderr, "%s:%d: CHECK_EQ failed: %s == %s (%lld vs %lld)\n", \
+                __FILE__, __LINE__, #a, #b, _a, _b); \
+        exit(1); \
+    } \
+} while (0)
+
+// Wall-clock bounds (throughput, overhead ratios) only hold on an otherwise
+// idle machine, so they are checked only when NOTCH_BENCH=1; the numbers are
+// printed either way.
+static inline int bench_checks(void) {
+    const char* e = getenv("NOTCH_BENCH");
+    return e && e[0] == '1';
+}
+
+#define CHECK_BENCH(cond) do { if (bench_checks()) CHECK(cond); } while (0)
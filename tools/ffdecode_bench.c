@@ -0,0 +1,349 @@
+// Headless decode benchmark: decodes a clip through the default pooled sink and
+// reports throughput, pool usage and page faults per frame. With --disk-cache
+// the clip is played twice through a persistent cache at DIR: a cold pass that
+// decodes and fills it, then a warm pass served from disk. --scrub N instead
+// drags a scrubber (ffscrub.h) across the clip with N requests at 60 Hz and
+// reports scrub-to-first-pixel and refine times. --mem-limit MB runs under the
+// memory governor (ffgovernor.h) and prints its breakdown at the end.
+// --cost-trace FILE writes each frame's read+decode+convert time in
+// microseconds, one per line, for replay in the pacing simulator (ffpace).
+// --playlist plays the clips back to back in real time (ffplaylist.h), once
+// opening each clip when it is reached and once pre-rolled, and reports the
+// switch gaps of both. --cues fires the clips as cues (ffcue.h) from a local
+// trigger thread every 2 s while output runs at 60 Hz, armed and unarmed, and
+// reports trigger-to-first-frame latency. --crossfade N plays the first clip
+// for a second, then dissolves into the second over N frames (fftransition.h)
+// as fast as it can, and reports decode and mix times against the frame budget.
+// Usage: ffdecode_bench [--hugepages] [--prefault] [--mlock] [--numa]
+//                       [--disk-cache DIR [--lz4]] [--scrub N] [--mem-limit MB]
+//                       [--cost-trace FILE] <clip.mov> [max_frames]
+//        ffdecode_bench [--hugepages] [--prefault] [--mlock] [--numa]
+//                       --playlist|--cues <clip.mov>...
+//        ffdecode_bench [--hugepages] [--prefault] [--mlock] [--numa]
+//                       --crossfade N <from.mov> <to.mov>
+#include "ffcue.h"
+#include "ffdecode.h"
+#include "ffdiskcache.h"
+#include "ffframe.h"
+#include "ffgovernor.h"
+#include "ffmem.h"
+#include "ffplaylist.h"
+#include "ffpool.h"
+#include "ffscrub.h"
+#include "ffsink.h"
+#include "fftransition.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static double now_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Plays up to max_frames frames; returns the last ff_next_frame_ref result.
+// With `trace`, writes each frame's time in microseconds.
+static int run_pass(FFPlayer* p, long max_frames, FILE* trace, long* frames, double* el) {
+    *frames = 0;
+    double t0 = now_s();
+    int rc = 1;
+    while (max_frames <= 0 || *frames < max_frames) {
+        FFFrameRef* f = NULL;
+        double tf = trace ? now_s() : 0;
+        rc = ff_next_frame_ref(p, &f);
+        if (rc != 1) break;
+        if (trace) fprintf(trace, "%.1f\n", (now_s() - tf) * 1e6);
+        ff_frame_release(f);
+        ++*frames;
+    }
+    *el = now_s() - t0;
+    return rc;
+}
+
+// Timeline drag: n requests spread over the clip, one per 60 Hz UI frame,
+// then waits for the settled position in full resolution.
+static int run_scrub(FFPlayer* p, int n) {
+    int64_t count = ff_get_frame_count(p);
+    if (count <= 0) count = 1000;
+    ff_set_frame_cache(p, (size_t)256 * 1024 * 1024, 0, 0);
+    FFScrubConfig cfg = { .player = p, .cache = ff_get_frame_cache(p) };
+    FFScrub* s = ff_scrub_create(&cfg);
+    if (!s) return -1;
+    struct timespec tick = { 0, 16666667 };
+    FFFrameRef* f = NULL;
+    for (int i = 0; i < n; ++i) {
+        ff_scrub_seek(s, count * i / n, &f);
+        ff_frame_release(f);
+        nanosleep(&tick, NULL);
+        if (i + 1 < n && ff_scrub_poll(s, &f, 0) == 1) ff_frame_release(f);   // as a UI would show it
+    }
+    double t0 = now_s();
+    int ok = ff_scrub_poll(s, &f, 5000) == 1;
+    double settle = now_s() - t0;
+    ff_frame_release(f);
+
+    FFScrubStats st;
+    ff_scrub_get_stats(s, &st);
+    ff_scrub_destroy(s);
+    printf("scrub: requests=%llu exact=%llu near=%llu refined=%llu cancelled=%llu superseded=%llu\n",
+           (unsigned long long)st.requests, (unsigned long long)st.exact, (unsigned long long)st.near,
+           (unsigned long long)st.refined, (unsigned long long)st.cancelled, (unsigned long long)st.superseded);
+    printf("scrub: first_pixel avg=%.2fms max=%.2fms refine max=%.2fms settle=%.2fms\n",
+           st.first_pixel_ns_avg / 1e6, st.first_pixel_ns_max / 1e6, st.refine_ns_max / 1e6, settle * 1e3);
+    return ok ? 0 : -1;
+}
+
+// Plays the clips through a playlist at their frame rate, as the app shows them.
+static int run_playlist(char** paths, int n, const FFOpenOptions* opts, int cold) {
+    FFPlaylistConfig cfg = { .preroll = { .open = *opts }, .cold = cold };
+    FFPlaylist* pl = ff_playlist_create(&cfg);
+    if (!pl) return -1;
+    for (int i = 0; i < n; ++i) ff_playlist_append(pl, paths[i]);
+    FFFrameRef* f = NULL;
+    FFPlaylistPos pos;
+    double t0 = 0;
+    long frames = 0;
+    int rc;
+    while ((rc = ff_playlist_next(pl, &f, &pos)) == 1) {
+        ff_frame_release(f);
+        double now = now_s();
+        if (frames++ == 0) t0 = now;
+        double wait = t0 + pos.pts - now;
+        if (wait > 0) {
+            struct timespec ts = { (time_t)wait, (long)((wait - (time_t)wait) * 1e9) };
+            nanosleep(&ts, NULL);
+        }
+    }
+    FFPlaylistStats st;
+    ff_playlist_get_stats(pl, &st);
+    ff_playlist_destroy(pl);
+    printf("%s: frames=%ld time=%.3fs switches=%llu prerolled=%llu cold=%llu failed=%llu\n",
+           cold ? "cold" : "pre-rolled", frames, now_s() - t0, (unsigned long long)st.switches,
+           (unsigned long long)st.prerolled, (unsigned long long)st.cold, (unsigned long long)st.failed);
+    printf("  switch gap avg=%.3fms max=%.3fms last=%.3fms  pre-roll=%.3fms\n", st.switch_ns_avg / 1e6,
+           st.switch_ns_max / 1e6, st.switch_ns_last / 1e6, st.preroll_ns_last / 1e6);
+    return rc;
+}
+
+typedef struct CueOutput {
+    FFCueStack* cs;
+    atomic_int  stop;
+} CueOutput;
+
+static void* cue_output_main(void* arg) {
+    CueOutput* o = arg;
+    struct timespec tick = { 0, 16666667 };
+    while (!atomic_load(&o->stop)) {
+        FFFrameRef* f = NULL;
+        if (ff_cue_next(o->cs, &f, NULL) == 1) ff_frame_release(f);
+        nanosleep(&tick, NULL);
+    }
+    return NULL;
+}
+
+// Fires every clip as a cue, one every 2 s, against a 60 Hz output thread.
+static int run_cues(char** paths, int n, const FFOpenOptions* opts, int armed) {
+    FFCueConfig cfg = { .preroll = { .open = *opts }, .armed = armed };
+    CueOutput o = { .cs = ff_cue_create(&cfg) };
+    if (!o.cs) return -1;
+    atomic_init(&o.stop, 0);
+    for (int i = 0; i < n; ++i) ff_cue_add(o.cs, paths[i]);
+    ff_cue_wait_armed(o.cs, 10000);
+    pthread_t out;
+    if (pthread_create(&out, NULL, cue_output_main, &o) != 0) {
+        ff_cue_destroy(o.cs);
+        return -1;
+    }
+    struct timespec gap = { 2, 0 };
+    for (int i = 0; i < n; ++i) {
+        nanosleep(&gap, NULL);
+        ff_cue_go(o.cs);
+    }
+    nanosleep(&gap, NULL);
+    atomic_store(&o.stop, 1);
+    pthread_join(out, NULL);
+    FFCueStats st;
+    ff_cue_get_stats(o.cs, &st);
+    ff_cue_destroy(o.cs);
+    printf("%s: gos=%llu armed=%llu unarmed=%llu failed=%llu\n", armed < 0 ? "unarmed" : "armed",
+           (unsigned long long)st.gos, (unsigned long long)st.armed, (unsigned long long)st.unarmed,
+           (unsigned long long)st.failed);
+    printf("  trigger to first frame avg=%.3fms max=%.3fms  swap max=%.3fms  arm=%.3fms\n",
+           st.trigger_ns_avg / 1e6, st.trigger_ns_max / 1e6, st.swap_ns_max / 1e6, st.arm_ns_last / 1e6);
+    return st.failed ? -1 : 0;
+}
+
+// One second of the first clip, then a crossfade of `frames` frames into the
+// second, unpaced. The budget is the first clip's frame interval.
+static int run_crossfade(char** paths, const FFOpenOptions* opts, int frames) {
+    FFPlayer* p[2];
+    for (int i = 0; i < 2; ++i) {
+        p[i] = ff_open_with_options(paths[i], opts, NULL, NULL, NULL, NULL);
+        if (!p[i]) {
+            fprintf(stderr, "cannot open %s\n", paths[i]);
+            if (i) ff_close(p[0]);
+            return -1;
+        }
+    }
+    double fps = ff_get_fps(p[0]);
+    if (!(fps > 0)) fps = 60;
+    FFTransition* t = ff_transition_create(&(FFTransitionConfig){ .alpha_aware = 1, .mem_flags = opts->mem_flags });
+    int rc = t ? 0 : -1;
+    if (t) {
+        ff_transition_cut(t, p[0]);
+        for (int i = 0; i < (int)fps && rc == 0; ++i) {
+            FFFrameRef* f = NULL;
+            if (ff_transition_next(t, &f, NULL) != 1) rc = -1;
+            ff_frame_release(f);
+        }
+        ff_transition_crossfade(t, p[1], frames, FF_CURVE_SMOOTH);
+        double t0 = now_s();
+        while (rc == 0 && ff_transition_active(t)) {
+            FFFrameRef* f = NULL;
+            if (ff_transition_next(t, &f, NULL) != 1) rc = -1;
+            ff_frame_release(f);
+        }
+        double el = now_s() - t0;
+        FFTransitionStats st;
+        ff_transition_get_stats(t, &st);
+        ff_transition_destroy(t);
+        printf("crossfade: frames=%llu cut_short=%llu time=%.3fs fps=%.1f (budget %.2fms)\n",
+               (unsigned long long)st.mixed, (unsigned long long)st.cut_short, el,
+               el > 0 ? st.mixed / el : 0.0, 1e3 / fps);
+        printf("  decode avg=%.2fms max=%.2fms  mix avg=%.2fms max=%.2fms  frame max=%.2fms\n",
+               st.decode_ns_avg / 1e6, st.decode_ns_max / 1e6, st.blend_ns_avg / 1e6,
+               st.blend_ns_max / 1e6, st.frame_ns_max / 1e6);
+    }
+    ff_close(p[0]);
+    ff_close(p[1]);
+    return rc;
+}
+
+static void print_governor(void) {
+    FFGovUsage u;
+    ff_governor_get_usage(&u);
+    printf("memory: limit=%zuMB total=%zuMB enforcements=%llu over_limit=%llu trimmed=%lluMB\n",
+           u.limit_bytes >> 20, u.total_bytes >> 20, (unsigned long long)u.enforcements,
+           (unsigned long long)u.over_limit, (unsigned long long)(u.trimmed_bytes >> 20));
+    FFGovClientInfo info[32];
+    int n = ff_governor_list(info, 32);
+    for (int i = 0; i < n && i < 32; ++i) {
+        printf("  %-8s %-18s %8.1fMB%s", ff_governor_class_name(info[i].kind), info[i].name,
+               info[i].used_bytes / 1048576.0, info[i].borrowed ? " (borrowed)" : "");
+        if (info[i].cap_bytes != SIZE_MAX) printf(" cap=%.1fMB", info[i].cap_bytes / 1048576.0);
+        printf("\n");
+    }
+}
+
+int main(int argc, char** argv) {
+    FFOpenOptions opts = { 0 };
+    FFDiskCacheConfig dcfg = { 0 };
+    int scrub = 0, playlist = 0, cues = 0, crossfade = 0;
+    long mem_limit_mb = 0;
+    const char* trace_path = NULL;
+    int ai = 1;
+    for (; ai < argc && strncmp(argv[ai], "--", 2) == 0; ++ai) {
+        if      (!strcmp(argv[ai], "--hugepages")) opts.mem_flags |= FF_MEM_HUGEPAGES;
+        else if (!strcmp(argv[ai], "--prefault"))  opts.mem_flags |= FF_MEM_PREFAULT;
+        else if (!strcmp(argv[ai], "--mlock"))     opts.mem_flags |= FF_MEM_LOCK;
+        else if (!strcmp(argv[ai], "--numa"))      opts.mem_flags |= FF_MEM_NUMA_LOCAL;
+        else if (!strcmp(argv[ai], "--lz4"))       dcfg.codec = FF_DISK_LZ4;
+        else if (!strcmp(argv[ai], "--playlist"))  playlist = 1;
+        else if (!strcmp(argv[ai], "--cues"))      cues = 1;
+        else if (!strcmp(argv[ai], "--disk-cache") && ai + 1 < argc) dcfg.root = argv[++ai];
+        else if (!strcmp(argv[ai], "--scrub") && ai + 1 < argc) scrub = atoi(argv[++ai]);
+        else if (!strcmp(argv[ai], "--crossfade") && ai + 1 < argc) crossfade = atoi(argv[++ai]);
+        else if (!strcmp(argv[ai], "--mem-limit") && ai + 1 < argc) mem_limit_mb = atol(argv[++ai]);
+        else if (!strcmp(argv[ai], "--cost-trace") && ai + 1 < argc) trace_path = argv[++ai];
+    }
+    if (ai >= argc || (crossfade > 0 && argc - ai < 2)) {
+        fprintf(stderr, "usage: %s [--hugepages] [--prefault] [--mlock] [--numa] [--disk-cache DIR [--lz4]] [--scrub N] [--mem-limit MB] [--cost-trace FILE] <clip> [max_frames]\n"
+                        "       %s [--hugepages] [--prefault] [--mlock] [--numa] --playlist|--cues <clip>...\n"
+                        "       %s [--hugepages] [--prefault] [--mlock] [--numa] --crossfade N <from> <to>\n",
+                argv[0], argv[0], argv[0]);
+        return 2;
+    }
+    if (playlist) {
+        int cold = run_playlist(argv + ai, argc - ai, &opts, 1);
+        int warm = run_playlist(argv + ai, argc - ai, &opts, 0);
+        return cold < 0 || warm < 0 ? 1 : 0;
+    }
+    if (crossfade > 0) return run_crossfade(argv + ai, &opts, crossfade) < 0 ? 1 : 0;
+    if (cues) {
+        int warm = run_cues(argv + ai, argc - ai, &opts, 0);
+        int cold = run_cues(argv + ai, argc - ai, &opts, -1);
+        return cold < 0 || warm < 0 ? 1 : 0;
+    }
+    const char* path = argv[ai];
+    if (mem_limit_mb > 0) ff_governor_set_limit((size_t)mem_limit_mb << 20);
+    long max_frames = ai + 1 < argc ? strtol(argv[ai + 1], NULL, 10) : 0;
+
+    int w = 0, h = 0;
+    double tb = 0, dur = 0;
+    FFPlayer* p = ff_open_with_options(path, &opts, &w, &h, &tb, &dur);
+    if (!p) {
+        fprintf(stderr, "ff_open failed: %s\n", path);
+        return 1;
+    }
+
+    if (scrub > 0) {
+        int r = run_scrub(p, scrub);
+        ff_close(p);
+        return r < 0 ? 1 : 0;
+    }
+
+    FFDiskCache* dc = NULL;
+    if (dcfg.root) {
+        dcfg.queue_depth = 64;
+        dc = ff_diskcache_open(&dcfg);
+        if (!dc || ff_set_disk_cache(p, dc) < 0) {
+            fprintf(stderr, "cannot use disk cache at %s\n", dcfg.root);
+            return 1;
+        }
+    }
+
+    FILE* trace = NULL;
+    if (trace_path && !(trace = fopen(trace_path, "w"))) {
+        fprintf(stderr, "cannot write %s\n", trace_path);
+        return 1;
+    }
+    if (trace) fprintf(trace, "# %s: per-frame read+decode+convert, us\n", path);
+
+    long frames = 0;
+    double el = 0;
+    int rc = run_pass(p, max_frames, trace, &frames, &el);
+    if (dc && rc >= 0) {
+        ff_diskcache_flush(dc);
+        FFDiskCacheStats ds;
+        ff_diskcache_get_stats(dc, &ds);
+        printf("cold: frames=%ld time=%.3fs fps=%.1f stored=%llu dropped=%llu ratio=%.2f\n", frames, el,
+               el > 0 ? frames / el : 0.0, (unsigned long long)ds.writes, (unsigned long long)ds.write_drops,
+               ds.raw_bytes_written ? (double)ds.stored_bytes_written / ds.raw_bytes_written : 0.0);
+        if (ff_seek_frame(p, 0) == 0) rc = run_pass(p, max_frames, NULL, &frames, &el);
+        printf("warm: ");
+    }
+
+    FFFramePoolStats st;
+    int have_stats = ff_get_pool_stats(p, &st) == 0;
+    FFFaultStats fs;
+    ff_get_fault_stats(p, &fs);
+    if (mem_limit_mb > 0) print_governor();
+    ff_close(p);
+    ff_diskcache_close(dc);
+    if (trace) fclose(trace);
+
+    if (rc < 0) fprintf(stderr, "ff_next_frame_ref error: %d\n", rc);
+    printf("%dx%d frames=%ld time=%.3fs fps=%.1f\n", w, h, frames, el, el > 0 ? frames / el : 0.0);
+    if (have_stats) {
+        printf("pool: allocs=%llu reuses=%llu high_water=%zu bytes waits=%llu wait_max=%.3fms\n",
+               (unsigned long long)st.allocs, (unsigned long long)st.reuses, st.high_water_bytes,
+               (unsigned long long)st.waits, st.wait_ns_max / 1e6);
+    }
+    printf("faults: mem_flags=0x%x per_frame_avg=%.1f max=%llu\n", opts.mem_flags,
+           fs.frames ? (double)fs.faults_total / fs.frames : 0.0, (unsigned long long)fs.faults_max);
+    return rc < 0 ? 1 : 0;
+}
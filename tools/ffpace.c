@@ -0,0 +1,140 @@
+// Pacing simulator front end (ffpacesim.h): plays a simulated clip through the
+// presentation scheduler and prints dropped, late and repeated frames and the
+// display-interval histogram. Needs no media or display; the same arguments
+// always print the same numbers. Several --depth/--drop-late values run one
+// simulation each, for comparing policies side by side.
+//
+// Cost specs (microseconds per frame):
+//   const:MEAN[:JITTER]                  constant, +- uniform jitter
+//   burst:MEAN:BURST:EVERY[:LEN[:JITTER]] BURST for LEN frames every EVERY frames
+//   trace:FILE[:JITTER]                  replayed, e.g. from ffdecode_bench --cost-trace
+// Usage: ffpace [--fps N] [--hz N] [--frames N] [--seed N] [--present US]
+//               [--read SPEC] [--decode SPEC] [--convert SPEC]
+//               [--lead MS] [--max-drops N] [--depth N,...] [--drop-late MS,...]
+#include "ffpacesim.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_RUNS 8
+
+// Parses a cost spec. Returns 0, or -1 if it is malformed.
+static int parse_cost(const char* spec, FFPaceCost* c, double** trace) {
+    memset(c, 0, sizeof(*c));
+    if (!strncmp(spec, "const:", 6)) {
+        c->kind = FF_PACE_CONSTANT;
+        return sscanf(spec + 6, "%lf:%lf", &c->mean_us, &c->jitter_us) >= 1 ? 0 : -1;
+    }
+    if (!strncmp(spec, "burst:", 6)) {
+        c->kind = FF_PACE_BURSTY;
+        c->burst_len = 1;
+        return sscanf(spec + 6, "%lf:%lf:%d:%d:%lf", &c->mean_us, &c->burst_us, &c->burst_every,
+                      &c->burst_len, &c->jitter_us) >= 3 ? 0 : -1;
+    }
+    if (!strncmp(spec, "trace:", 6)) {
+        char path[512];
+        snprintf(path, sizeof(path), "%s", spec + 6);
+        char* colon = strrchr(path, ':');
+        if (colon) {
+            *colon = 0;
+            c->jitter_us = atof(colon + 1);
+        }
+        c->kind = FF_PACE_TRACE;
+        *trace = ff_pacesim_load_trace(path, &c->trace_len);
+        c->trace_us = *trace;
+        if (!*trace) fprintf(stderr, "cannot read trace %s\n", path);
+        return *trace ? 0 : -1;
+    }
+    return -1;
+}
+
+// "a,b,c" into up to MAX_RUNS values. Returns the count.
+static int parse_list(const char* s, double* out) {
+    int n = 0;
+    while (n < MAX_RUNS && *s) {
+        char* end;
+        out[n++] = strtod(s, &end);
+        if (*end != ',') break;
+        s = end + 1;
+    }
+    return n;
+}
+
+static void print_result(const FFPaceSimConfig* c, const FFPaceSimResult* r) {
+    printf("depth=%d drop_late=", c->queue_depth);
+    if (c->drop_late < 0)       printf("never");
+    else if (c->drop_late == 0) printf("1 frame");
+    else                        printf("%.1fms", c->drop_late * 1e3);
+    printf("\n  shown=%llu dropped=%llu superseded=%llu late=%llu repeated=%llu stalls=%llu\n",
+           (unsigned long long)r->shown, (unsigned long long)r->sched.dropped,
+           (unsigned long long)r->superseded, (unsigned long long)r->sched.late,
+           (unsigned long long)r->repeated, (unsigned long long)r->stalls);
+    printf("  lateness mean=%.2fms max=%.2fms  interval mean=%.2fms stddev=%.2fms p99=%.2fms max=%.2fms\n",
+           r->sched.late_mean_ns / 1e6, r->sched.late_max_ns / 1e6, r->interval_mean_ms,
+           r->interval_stddev_ms, r->interval_p99_ms, r->interval_max_ms);
+    printf("  intervals (vsyncs):");
+    for (int k = 1; k < FF_PACE_HIST_BUCKETS; ++k)
+        printf(" %d%s=%llu", k, k == FF_PACE_HIST_BUCKETS - 1 ? "+" : "", (unsigned long long)r->interval_hist[k]);
+    printf("\n");
+}
+
+int main(int argc, char** argv) {
+    FFPaceSimConfig cfg = { .fps = 60, .frames = 3600 };
+    cfg.cost[FF_PACE_DECODE].mean_us = 8000;
+    double depths[MAX_RUNS] = { 0 }, drops[MAX_RUNS] = { 0 };
+    int ndepths = 1, ndrops = 1;
+    double* traces[FF_PACE_STAGES] = { 0 };
+    int bad = 0;
+
+    for (int ai = 1; ai < argc; ++ai) {
+        const char* a = argv[ai];
+        const char* v = ai + 1 < argc ? argv[ai + 1] : NULL;
+        int stage = !strcmp(a, "--read") ? FF_PACE_READ : !strcmp(a, "--decode") ? FF_PACE_DECODE
+                  : !strcmp(a, "--convert") ? FF_PACE_CONVERT : -1;
+        if (!v) { bad = 1; break; }
+        ++ai;
+        if (stage >= 0)                       bad |= parse_cost(v, &cfg.cost[stage], &traces[stage]) < 0;
+        else if (!strcmp(a, "--fps"))         cfg.fps = atof(v);
+        else if (!strcmp(a, "--hz"))          cfg.display_hz = atof(v);
+        else if (!strcmp(a, "--frames"))      cfg.frames = atoi(v);
+        else if (!strcmp(a, "--seed"))        cfg.seed = strtoull(v, NULL, 10);
+        else if (!strcmp(a, "--present"))     cfg.present_us = atof(v);
+        else if (!strcmp(a, "--lead"))        cfg.lead = atof(v) / 1e3;
+        else if (!strcmp(a, "--max-drops"))   cfg.max_drops = atoi(v);
+        else if (!strcmp(a, "--depth"))       ndepths = parse_list(v, depths);
+        else if (!strcmp(a, "--drop-late"))   ndrops = parse_list(v, drops);
+        else bad = 1;
+        if (bad) break;
+    }
+    if (bad) {
+        fprintf(stderr, "usage: %s [--fps N] [--hz N] [--frames N] [--seed N] [--present US]\n"
+                        "       [--read SPEC] [--decode SPEC] [--convert SPEC]\n"
+                        "       [--lead MS] [--max-drops N] [--depth N,...] [--drop-late MS,...]\n"
+                        "SPEC: const:MEAN[:JITTER] | burst:MEAN:BURST:EVERY[:LEN[:JITTER]] | trace:FILE[:JITTER]\n"
+                        "drop-late: 0 = one frame, negative = never drop\n", argv[0]);
+        return 2;
+    }
+
+    printf("%d frames at %.3f fps on %.3f Hz\n", cfg.frames, cfg.fps,
+           cfg.display_hz > 0 ? cfg.display_hz : cfg.fps);
+    int rc = 0;
+    for (int i = 0; i < ndepths && !rc; ++i) {
+        for (int j = 0; j < ndrops && !rc; ++j) {
+            FFPaceSimConfig c = cfg;
+            c.queue_depth = (int)depths[i];
+            c.drop_late   = drops[j] < 0 ? -1 : drops[j] / 1e3;
+            FFPaceSimResult r;
+            if (ff_pacesim_run(&c, &r) < 0) {
+                fprintf(stderr, "bad configuration\n");
+                rc = 1;
+                break;
+            }
+            if (i == 0 && j == 0)
+                printf("mean cost read=%.0fus decode=%.0fus convert=%.0fus\n", r.cost_mean_us[FF_PACE_READ],
+                       r.cost_mean_us[FF_PACE_DECODE], r.cost_mean_us[FF_PACE_CONVERT]);
+            print_result(&c, &r);
+        }
+    }
+    for (int k = 0; k < FF_PACE_STAGES; ++k) free(traces[k]);
+    return rc;
+}
@@ -0,0 +1,686 @@
+#include "ffserver.h"
+#include "ffserver_proto.h"
+#include "ffcache.h"
+#include "ffdecode.h"
+#include "ffframe.h"
+#include "ffpool.h"
+#include "ffshm.h"
+#include "ffsink.h"
+#include "ffutil.h"
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#define SRV_MAX_DECODERS   8
+#define SRV_MAX_SLOTS      64
+// A decoder up to this many frames behind the target decodes forward instead of seeking.
+#define SRV_FORWARD_WINDOW 16
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+typedef struct SrvDecoder {
+    FFPlayer* p;          // NULL while being opened
+    int       used;       // slot taken: p is open or being opened
+    int       busy;
+    uint64_t  last_used;
+} SrvDecoder;
+
+typedef struct SrvClip {
+    char*           path;
+    pthread_mutex_t lock;
+    pthread_cond_t  idle;        // a decoder became idle
+    int             probed;      // first decoder opened, fields below valid
+    int             width, height;
+    int64_t         frame_count; // -1 if unknown
+    FFFramePool*    pool;        // shared by this clip's decoders and cache
+
+    // Slots stay where they are while in use (threads hold pointers to them);
+    // a freed one is only marked unused.
+    SrvDecoder      dec[SRV_MAX_DECODERS];
+    int             ndec;        // slots [0, ndec) have been used
+    int             nused;       // slots in use
+    int             max_dec;     // lowered if extra handles fail to open
+    uint64_t        tick;
+
+    FFFrameCache*   cache;       // NULL when caching is off
+    struct SrvClip* next;
+} SrvClip;
+
+typedef struct SrvConn {
+    FFServer*       srv;
+    int             fd;
+    uint64_t        id;
+    pthread_t       thread;
+    atomic_int      done;
+    FFShmRing*      ring;
+    FFFrameSink*    sink;
+    FFFrameRef*     held[SRV_MAX_SLOTS];   // ring slots pinned for the last batch
+    int             nheld;
+    struct SrvConn* next;
+} SrvConn;
+
+struct FFServer {
+    FFSrvConfig     cfg;
+    char            socket_path[sizeof(((struct sockaddr_un*)0)->sun_path)];
+    int             listen_fd;
+    int             wake[2];           // self-pipe that stops the accept loop
+    pthread_t       accept_thread;
+    atomic_int      stopping;
+
+    pthread_mutex_t lock;              // clips, conns, worker permits
+    pthread_cond_t  permit_cv;
+    int             permits;
+    SrvClip*        clips;
+    SrvConn*        conns;
+    uint64_t        next_conn_id;
+
+    atomic_uint_least64_t connections, requests, frames, errors;
+    atomic_uint_least64_t cache_hits, cache_misses, decoded, seeks;
+};
+
+// ---- Socket I/O ----
+
+static int read_full(int fd, void* buf, size_t n) {
+    uint8_t* p = buf;
+    while (n > 0) {
+        ssize_t r = read(fd, p, n);
+        if (r < 0 && errno == EINTR) continue;
+        if (r <= 0) return -1;
+        p += r;
+        n -= (size_t)r;
+    }
+    return 0;
+}
+
+static int write_full(int fd, const void* buf, size_t n) {
+    const uint8_t* p = buf;
+    while (n > 0) {
+        ssize_t r = send(fd, p, n, MSG_NOSIGNAL);
+        if (r < 0 && errno == EINTR) continue;
+        if (r <= 0) return -1;
+        p += r;
+        n -= (size_t)r;
+    }
+    return 0;
+}
+
+// ---- Clips and decoder handles ----
+
+static SrvClip* clip_get(FFServer* srv, const char* path) {
+    pthread_mutex_lock(&srv->lock);
+    SrvClip* c = srv->clips;
+    while (c && strcmp(c->path, path) != 0) c = c->next;
+    if (!c) {
+        c = calloc(1, sizeof(*c));
+        if (c) {
+            c->path  = strdup(path);
+            c->cache = srv->cfg.cache_frames > 0 ? ff_cache_create(NULL) : NULL;   // sized at probe
+            if (!c->path || (srv->cfg.cache_frames > 0 && !c->cache)) {
+                free(c->path);
+                ff_cache_destroy(c->cache);
+                free(c);
+                c = NULL;
+            } else {
+                pthread_mutex_init(&c->lock, NULL);
+                ff_cond_init(&c->idle);
+                c->frame_count = -1;
+                c->max_dec     = srv->cfg.decoders_per_clip;
+                c->next = srv->clips;
+                srv->clips = c;
+            }
+        }
+    }
+    pthread_mutex_unlock(&srv->lock);
+    return c;
+}
+
+static void clip_free(SrvClip* c) {
+    ff_cache_destroy(c->cache);
+    for (int i = 0; i < c->ndec; ++i) ff_close(c->dec[i].p);
+    ff_pool_destroy(c->pool);
+    pthread_mutex_destroy(&c->lock);
+    pthread_cond_destroy(&c->idle);
+    free(c->path);
+    free(c);
+}
+
+// Opens one more decoder handle wired to the clip's pool. Called without the clip lock.
+static FFPlayer* clip_open_decoder(FFServer* srv, SrvClip* c, int* w, int* h) {
+    double tb = 0, dur = 0;
+    FFPlayer* p = ff_open(c->path, w, h, &tb, &dur);
+    if (!p) return NULL;
+
+    // The pool is created with the first handle, whose size decides it.
+    pthread_mutex_lock(&c->lock);
+    if (!c->pool) {
+        FFFramePoolConfig pc = { 0 };
+        pc.max_buffers = (srv->cfg.cache_frames > 0 ? srv->cfg.cache_frames : 0)
+                       + 2 * srv->cfg.decoders_per_clip + srv->cfg.workers + 4;
+        pc.wait_timeout_ms = FF_POOL_DEFAULT_TIMEOUT_MS;
+        c->pool = ff_pool_create(&pc);
+        // cache_frames frames' worth of bytes (rows are 64-byte aligned)
+        size_t frame_bytes = (((size_t)*w * 4 + 63) & ~(size_t)63) * (size_t)*h;
+        if (c->cache) ff_cache_set_budget(c->cache, frame_bytes * (size_t)srv->cfg.cache_frames);
+    }
+    FFFramePool* pool = c->pool;
+    pthread_mutex_unlock(&c->lock);
+
+    FFFrameSink* sink = pool ? ff_sink_pool_create(pool) : NULL;
+    if (!sink || ff_set_sink(p, sink) < 0) {
+        ff_sink_destroy(sink);
+        ff_close(p);
+        return NULL;
+    }
+    return p;
+}
+
+// Probes the clip with its first decoder handle. Returns 0, or -1 if it cannot be opened.
+static int clip_probe(FFServer* srv, SrvClip* c) {
+    pthread_mutex_lock(&c->lock);
+    while (!c->probed && c->nused > 0) ff_cond_wait_ns(&c->idle, &c->lock, -1);   // another probe in flight
+    if (c->probed) {
+        pthread_mutex_unlock(&c->lock);
+        return 0;
+    }
+    c->dec[0].p = NULL;
+    c->dec[0].used = 1;
+    c->dec[0].busy = 1;
+    c->ndec  = 1;
+    c->nused = 1;
+    pthread_mutex_unlock(&c->lock);
+
+    int w = 0, h = 0;
+    FFPlayer* p = clip_open_decoder(srv, c, &w, &h);
+
+    pthread_mutex_lock(&c->lock);
+    if (p) {
+        c->dec[0].p    = p;
+        c->dec[0].busy = 0;
+        c->width       = w;
+        c->height      = h;
+        c->frame_count = ff_get_frame_count(p);
+        c->probed      = 1;
+    } else {
+        c->dec[0].used = 0;   // let a later request retry
+        c->dec[0].busy = 0;
+        c->ndec  = 0;
+        c->nused = 0;
+    }
+    pthread_cond_broadcast(&c->idle);
+    pthread_mutex_unlock(&c->lock);
+    return p ? 0 : -1;
+}
+
+// Picks a decoder for `index`: an idle one just behind it (decode forward),
+// else a fresh handle while under the per-clip limit, else the least recently
+// used idle one (seek). Blocks while every handle is busy.
+static SrvDecoder* decoder_acquire(FFServer* srv, SrvClip* c, int64_t index) {
+    pthread_mutex_lock(&c->lock);
+    for (;;) {
+        SrvDecoder* near = NULL;
+        SrvDecoder* lru  = NULL;
+        int64_t best = INT64_MAX;
+        for (int i = 0; i < c->ndec; ++i) {
+            SrvDecoder* d = &c->dec[i];
+            if (!d->p || d->busy) continue;
+            int64_t next = ff_next_frame_index(d->p);
+            if (next <= index && index - next <= SRV_FORWARD_WINDOW && index - next < best) {
+                best = index - next;
+                near = d;
+            }
+            if (!lru || d->last_used < lru->last_used) lru = d;
+        }
+
+        SrvDecoder* d = near;
+        if (!d && c->nused < c->max_dec) {
+            int i = 0;
+            while (c->dec[i].used) ++i;   // nused < max_dec <= SRV_MAX_DECODERS
+            d = &c->dec[i];
+            d->p    = NULL;
+            d->used = 1;
+            d->busy = 1;
+            c->nused++;
+            if (i >= c->ndec) c->ndec = i + 1;
+            pthread_mutex_unlock(&c->lock);
+
+            int w = 0, h = 0;
+            FFPlayer* p = clip_open_decoder(srv, c, &w, &h);
+
+            pthread_mutex_lock(&c->lock);
+            if (p && w == c->width && h == c->height) {
+                d->p = p;
+                d->last_used = ++c->tick;
+                pthread_mutex_unlock(&c->lock);
+                return d;
+            }
+            // Could not add a handle: give the slot back and make do with what exists.
+            ff_close(p);
+            d->used = 0;
+            d->busy = 0;
+            c->nused--;
+            c->max_dec = c->nused > 0 ? c->nused : 1;
+            pthread_cond_broadcast(&c->idle);
+            continue;
+        }
+        if (!d) d = lru;
+        if (d) {
+            d->busy = 1;
+            d->last_used = ++c->tick;
+            pthread_mutex_unlock(&c->lock);
+            return d;
+        }
+        ff_cond_wait_ns(&c->idle, &c->lock, -1);
+    }
+}
+
+static void decoder_release(SrvClip* c, SrvDecoder* d) {
+    pthread_mutex_lock(&c->lock);
+    d->busy = 0;
+    pthread_cond_broadcast(&c->idle);
+    pthread_mutex_unlock(&c->lock);
+}
+
+// Frame `index` of the clip with one reference: from the cache, else decoded.
+// Returns FFSRV_OK or an FFSRV_ERR_* code.
+static int clip_get_frame(FFServer* srv, SrvClip* c, int64_t index, FFFrameRef** out) {
+    *out = NULL;
+    if (index < 0 || (c->frame_count >= 0 && index >= c->frame_count)) return FFSRV_ERR_RANGE;
+
+    FFFrameRef* f = ff_cache_get(c->cache, index);
+    if (f) {
+        atomic_fetch_add(&srv->cache_hits, 1);
+        *out = f;
+        return FFSRV_OK;
+    }
+    atomic_fetch_add(&srv->cache_misses, 1);
+
+    SrvDecoder* d = decoder_acquire(srv, c, index);
+    int status = FFSRV_OK;
+    int64_t next = ff_next_frame_index(d->p);
+    if (next > index || index - next > SRV_FORWARD_WINDOW) {
+        atomic_fetch_add(&srv->seeks, 1);
+        if (ff_seek_frame(d->p, index) < 0) status = FFSRV_ERR_DECODE;
+    }
+
+    int shrunk = 0;
+    while (status == FFSRV_OK) {
+        FFFrameRef* got = NULL;
+        int rc = ff_next_frame_ref(d->p, &got);
+        if (rc == -3 && !shrunk) {
+            // Output buffers are all held; most of them are cached frames.
+            FFFrameCacheStats cs = { 0 };
+            ff_cache_get_stats(c->cache, &cs);
+            ff_cache_shrink(c->cache, cs.bytes / 2);
+            shrunk = 1;
+            continue;
+        }
+        if (rc != 1) {
+            status = rc == 0 ? FFSRV_ERR_RANGE : rc == -3 ? FFSRV_ERR_BUSY : FFSRV_ERR_DECODE;
+            break;
+        }
+        atomic_fetch_add(&srv->decoded, 1);
+
+        int64_t fi = ff_frame_index(got);
+        if (c->cache) ff_cache_put(c->cache, got);
+        if (fi == index) {
+            *out = got;
+            break;
+        }
+        ff_frame_release(got);
+        if (fi > index) status = FFSRV_ERR_DECODE;   // the stream has no such frame
+    }
+    decoder_release(c, d);
+    return status;
+}
+
+// ---- Connections ----
+
+static void conn_release_held(SrvConn* cn) {
+    for (int i = 0; i < cn->nheld; ++i) ff_frame_release(cn->held[i]);
+    cn->nheld = 0;
+}
+
+static void worker_acquire(FFServer* srv) {
+    pthread_mutex_lock(&srv->lock);
+    while (srv->permits == 0) ff_cond_wait_ns(&srv->permit_cv, &srv->lock, -1);
+    srv->permits--;
+    pthread_mutex_unlock(&srv->lock);
+}
+
+static void worker_release(FFServer* srv) {
+    pthread_mutex_lock(&srv->lock);
+    srv->permits++;
+    pthread_cond_signal(&srv->permit_cv);
+    pthread_mutex_unlock(&srv->lock);
+}
+
+// Copies `f` into a fresh ring slot and keeps that slot pinned for the client.
+static int conn_publish(SrvConn* cn, FFFrameRef* f, FFSrvResponse* resp) {
+    int w = ff_frame_width(f), h = ff_frame_height(f);
+    if (w > cn->srv->cfg.max_width || h > cn->srv->cfg.max_height) return FFSRV_ERR_TOO_BIG;
+
+    FFSinkImage img;
+    if (cn->sink->acquire(cn->sink, w, h, ff_frame_format(f), &img) < 0) return FFSRV_ERR_BUSY;
+    const uint8_t* src = ff_frame_plane(f, 0);
+    int sstride = ff_frame_stride(f, 0);
+    size_t row = (size_t)w * ff_pixfmt_bytes_per_pixel(ff_frame_format(f));
+    for (int y = 0; y < h; ++y) memcpy(img.data[0] + (size_t)y * img.linesize[0], src + (size_t)y * sstride, row);
+
+    FFFrameRef* out = cn->sink->commit(cn->sink, &img, ff_frame_pts(f), ff_frame_index(f));
+    if (!out) return FFSRV_ERR_BUSY;
+
+    resp->slot = ff_shm_ring_last_published(cn->ring, &resp->seq);
+    cn->held[cn->nheld++] = out;
+    return FFSRV_OK;
+}
+
+// Serves one batch; frames go out in index order so each decoder moves forward.
+static int conn_serve_batch(SrvConn* cn, const char* path, const int64_t* indices, int count) {
+    FFServer* srv = cn->srv;
+    int order[SRV_MAX_SLOTS];
+    for (int i = 0; i < count; ++i) {
+        int j = i;
+        while (j > 0 && indices[order[j - 1]] > indices[i]) {
+            order[j] = order[j - 1];
+            --j;
+        }
+        order[j] = i;
+    }
+
+    SrvClip* c = clip_get(srv, path);
+    int open_status = !c ? FFSRV_ERR_OPEN : clip_probe(srv, c) < 0 ? FFSRV_ERR_OPEN : FFSRV_OK;
+
+    worker_acquire(srv);
+    int rc = 0;
+    for (int k = 0; k < count && rc == 0; ++k) {
+        int pos = order[k];
+        FFSrvResponse resp;
+        memset(&resp, 0, sizeof(resp));
+        resp.position    = pos;
+        resp.frame_index = indices[pos];
+        resp.slot        = -1;
+
+        resp.status = open_status;
+        if (resp.status == FFSRV_OK) {
+            FFFrameRef* f = NULL;
+            resp.status = clip_get_frame(srv, c, indices[pos], &f);
+            if (resp.status == FFSRV_OK) resp.status = conn_publish(cn, f, &resp);
+            ff_frame_release(f);
+        }
+        atomic_fetch_add(resp.status == FFSRV_OK ? &srv->frames : &srv->errors, 1);
+        rc = write_full(cn->fd, &resp, sizeof(resp));
+    }
+    worker_release(srv);
+    return rc;
+}
+
+static void* conn_main(void* arg) {
+    SrvConn* cn = arg;
+    FFServer* srv = cn->srv;
+    char* path = malloc(FFSRV_MAX_PATH + 1);
+    int64_t indices[SRV_MAX_SLOTS];
+
+    FFSrvHello hello;
+    memset(&hello, 0, sizeof(hello));
+    hello.magic      = FFSRV_MAGIC;
+    hello.version    = FFSRV_VERSION;
+    hello.slots      = srv->cfg.slots;
+    hello.max_width  = srv->cfg.max_width;
+    hello.max_height = srv->cfg.max_height;
+    hello.format     = FF_PIXFMT_BGRA;
+    snprintf(hello.ring_name, sizeof(hello.ring_name), "%s", ff_shm_ring_name(cn->ring));
+    if (!path || write_full(cn->fd, &hello, sizeof(hello)) < 0) goto done;
+
+    for (;;) {
+        FFSrvRequest req;
+        if (read_full(cn->fd, &req, sizeof(req)) < 0) break;
+        if (req.magic != FFSRV_MAGIC || req.path_len == 0 || req.path_len > FFSRV_MAX_PATH) break;
+        if (read_full(cn->fd, path, req.path_len) < 0) break;
+        path[req.path_len] = 0;
+        atomic_fetch_add(&srv->requests, 1);
+
+        // The client has had the previous batch; its slots may be reused now.
+        conn_release_held(cn);
+
+        if (req.count > (uint32_t)(srv->cfg.slots - 1)) {
+            // Drain the indices and refuse the whole batch.
+            int ok = 1;
+            for (uint32_t i = 0; i < req.count && ok; ++i) {
+                int64_t skip;
+                ok = read_full(cn->fd, &skip, sizeof(skip)) == 0;
+            }
+            for (uint32_t i = 0; i < req.count && ok; ++i) {
+                FFSrvResponse resp;
+                memset(&resp, 0, sizeof(resp));
+                resp.status   = FFSRV_ERR_BATCH;
+                resp.position = (int32_t)i;
+                resp.slot     = -1;
+                ok = write_full(cn->fd, &resp, sizeof(resp)) == 0;
+            }
+            atomic_fetch_add(&srv->errors, req.count);
+            if (!ok) break;
+            continue;
+        }
+        if (req.count > 0 && read_full(cn->fd, indices, req.count * sizeof(int64_t)) < 0) break;
+        if (conn_serve_batch(cn, path, indices, (int)req.count) < 0) break;
+    }
+
+done:
+    free(path);
+    conn_release_held(cn);
+    ff_sink_destroy(cn->sink);
+    ff_shm_ring_destroy(cn->ring);
+    cn->sink = NULL;
+    cn->ring = NULL;
+    pthread_mutex_lock(&srv->lock);   // ffsrv_stop may be shutting this fd down
+    close(cn->fd);
+    cn->fd = -1;
+    pthread_mutex_unlock(&srv->lock);
+    atomic_store(&cn->done, 1);
+    return NULL;
+}
+
+// Joins connections whose thread has finished (all of them if `all`). Threads
+// are joined outside the server lock: a connection may still need it to finish.
+static void reap_conns(FFServer* srv, int all) {
+    SrvConn* dead = NULL;
+    pthread_mutex_lock(&srv->lock);
+    SrvConn** pp = &srv->conns;
+    while (*pp) {
+        SrvConn* cn = *pp;
+        if (all || atomic_load(&cn->done)) {
+            *pp = cn->next;
+            cn->next = dead;
+            dead = cn;
+        } else {
+            pp = &cn->next;
+        }
+    }
+    pthread_mutex_unlock(&srv->lock);
+
+    while (dead) {
+        SrvConn* next = dead->next;
+        pthread_join(dead->thread, NULL);
+        free(dead);
+        dead = next;
+    }
+}
+
+static int conn_start(FFServer* srv, int fd) {
+    SrvConn* cn = calloc(1, sizeof(*cn));
+    if (!cn) return -1;
+    cn->srv = srv;
+    cn->fd  = fd;
+
+    pthread_mutex_lock(&srv->lock);
+    cn->id = ++srv->next_conn_id;
+    pthread_mutex_unlock(&srv->lock);
+
+    char name[64];
+    snprintf(name, sizeof(name), "notch-srv-%d-%llu", (int)getpid(), (unsigned long long)cn->id);
+    cn->ring = ff_shm_ring_create(name, srv->cfg.slots, srv->cfg.max_width, srv->cfg.max_height, FF_PIXFMT_BGRA);
+    cn->sink = cn->ring ? ff_sink_shm_create(cn->ring) : NULL;
+    if (!cn->sink) goto fail;
+
+    pthread_mutex_lock(&srv->lock);
+    if (pthread_create(&cn->thread, NULL, conn_main, cn) != 0) {
+        pthread_mutex_unlock(&srv->lock);
+        goto fail;
+    }
+    cn->next = srv->conns;
+    srv->conns = cn;
+    pthread_mutex_unlock(&srv->lock);
+    atomic_fetch_add(&srv->connections, 1);
+    return 0;
+
+fail:
+    ff_sink_destroy(cn->sink);
+    ff_shm_ring_destroy(cn->ring);
+    free(cn);
+    return -1;
+}
+
+static void* accept_main(void* arg) {
+    FFServer* srv = arg;
+    struct pollfd pfd[2] = {
+        { .fd = srv->listen_fd, .events = POLLIN },
+        { .fd = srv->wake[0],   .events = POLLIN },
+    };
+    while (!atomic_load(&srv->stopping)) {
+        if (poll(pfd, 2, -1) < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        if (pfd[1].revents) break;
+        if (!(pfd[0].revents & POLLIN)) continue;
+
+        int fd = accept(srv->listen_fd, NULL, NULL);
+        if (fd < 0) continue;
+#ifdef SO_NOSIGPIPE
+        int one = 1;
+        setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one));
+#endif
+        reap_conns(srv, 0);
+        if (conn_start(srv, fd) < 0) close(fd);
+    }
+    return NULL;
+}
+
+// ---- Server ----
+
+FFServer* ffsrv_start(const FFSrvConfig* cfg) {
+    if (!cfg || !cfg->socket_path) return NULL;
+    FFServer* srv = calloc(1, sizeof(*srv));
+    if (!srv) return NULL;
+    srv->listen_fd = -1;
+    srv->wake[0] = srv->wake[1] = -1;
+    pthread_mutex_init(&srv->lock, NULL);
+    ff_cond_init(&srv->permit_cv);
+
+    srv->cfg = *cfg;
+    if (srv->cfg.workers <= 0) {
+        long n = sysconf(_SC_NPROCESSORS_ONLN);
+        srv->cfg.workers = n > 0 ? (int)n : 1;
+    }
+    if (srv->cfg.decoders_per_clip <= 0) srv->cfg.decoders_per_clip = 2;
+    if (srv->cfg.decoders_per_clip > SRV_MAX_DECODERS) srv->cfg.decoders_per_clip = SRV_MAX_DECODERS;
+    if (srv->cfg.cache_frames == 0) srv->cfg.cache_frames = 32;
+    if (srv->cfg.max_width <= 0 || srv->cfg.max_height <= 0) {
+        srv->cfg.max_width  = 3840;
+        srv->cfg.max_height = 2160;
+    }
+    if (srv->cfg.slots <= 1) srv->cfg.slots = 8;
+    if (srv->cfg.slots > SRV_MAX_SLOTS) srv->cfg.slots = SRV_MAX_SLOTS;
+    srv->permits = srv->cfg.workers;
+
+    if (strlen(cfg->socket_path) >= sizeof(srv->socket_path)) goto fail;
+    snprintf(srv->socket_path, sizeof(srv->socket_path), "%s", cfg->socket_path);
+    srv->cfg.socket_path = srv->socket_path;
+
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    memcpy(addr.sun_path, srv->socket_path, strlen(srv->socket_path));
+
+    srv->listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (srv->listen_fd < 0) goto fail;
+    unlink(srv->socket_path);
+    if (bind(srv->listen_fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) goto fail;
+    if (listen(srv->listen_fd, 64) < 0) goto fail;
+    if (pipe(srv->wake) < 0) goto fail;
+    if (pthread_create(&srv->accept_thread, NULL, accept_main, srv) != 0) goto fail;
+    return srv;
+
+fail:
+    if (srv->listen_fd >= 0) {
+        close(srv->listen_fd);
+        unlink(srv->socket_path);
+    }
+    if (srv->wake[0] >= 0) close(srv->wake[0]);
+    if (srv->wake[1] >= 0) close(srv->wake[1]);
+    pthread_mutex_destroy(&srv->lock);
+    pthread_cond_destroy(&srv->permit_cv);
+    free(srv);
+    return NULL;
+}
+
+void ffsrv_stop(FFServer* srv) {
+    if (!srv) return;
+    atomic_store(&srv->stopping, 1);
+    char b = 1;
+    ssize_t wr = write(srv->wake[1], &b, 1);
+    (void)wr;
+    pthread_join(srv->accept_thread, NULL);
+    close(srv->listen_fd);
+    unlink(srv->socket_path);
+
+    // Unblock every connection thread, then join them.
+    pthread_mutex_lock(&srv->lock);
+    for (SrvConn* cn = srv->conns; cn; cn = cn->next) {
+        if (cn->fd >= 0) shutdown(cn->fd, SHUT_RDWR);
+    }
+    pthread_mutex_unlock(&srv->lock);
+    reap_conns(srv, 1);
+
+    pthread_mutex_lock(&srv->lock);
+    SrvClip* c = srv->clips;
+    srv->clips = NULL;
+    pthread_mutex_unlock(&srv->lock);
+
+    while (c) {
+        SrvClip* next = c->next;
+        clip_free(c);
+        c = next;
+    }
+    close(srv->wake[0]);
+    close(srv->wake[1]);
+    pthread_mutex_destroy(&srv->lock);
+    pthread_cond_destroy(&srv->permit_cv);
+    free(srv);
+}
+
+void ffsrv_get_stats(FFServer* srv, FFSrvStats* out) {
+    memset(out, 0, sizeof(*out));
+    out->connections  = atomic_load(&srv->connections);
+    out->requests     = atomic_load(&srv->requests);
+    out->frames       = atomic_load(&srv->frames);
+    out->errors       = atomic_load(&srv->errors);
+    out->cache_hits   = atomic_load(&srv->cache_hits);
+    out->cache_misses = atomic_load(&srv->cache_misses);
+    out->decoded      = atomic_load(&srv->decoded);
+    out->seeks        = atomic_load(&srv->seeks);
+
+    pthread_mutex_lock(&srv->lock);
+    for (SrvClip* c = srv->clips; c; c = c->next) out->clips_open += c->probed;
+    for (SrvConn* cn = srv->conns; cn; cn = cn->next) out->clients += !atomic_load(&cn->done);
+    pthread_mutex_unlock(&srv->lock);
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Frame server: answers "frame N of clip X" over a Unix socket (protocol in
+// ffserver_proto.h). Clips are opened on first use with a few decoder handles
+// each so nearby requests decode forward instead of seeking, recently decoded
+// frames are cached per clip, and batches from different connections run in
+// parallel on up to `workers` cores.
+typedef struct FFServer FFServer;
+
+typedef struct FFSrvConfig {
+    const char* socket_path;
+    int workers;              // concurrent batches; 0 = online CPUs
+    int decoders_per_clip;    // decoder handles per clip; 0 = 2
+    int cache_frames;         // decoded frames kept per clip; 0 = 32, <0 disables
+    int max_width;            // per-connection ring slot size; 0 = 3840x2160
+    int max_height;
+    int slots;                // per-connection ring slots; 0 = 8
+} FFSrvConfig;
+
+typedef struct FFSrvStats {
+    uint64_t connections;
+    uint64_t requests;
+    uint64_t frames;          // frames delivered
+    uint64_t errors;          // frames answered with an error
+    uint64_t cache_hits;
+    uint64_t cache_misses;
+    uint64_t decoded;         // frames pulled from decoders (includes skipped-to frames)
+    uint64_t seeks;
+    int      clips_open;
+    int      clients;
+} FFSrvStats;
+
+// Binds the socket (replacing a stale one) and starts accepting. NULL on failure.
+FFServer* ffsrv_start(const FFSrvConfig* cfg);
+// Closes every connection, joins all threads, closes clips and unlinks the socket.
+void      ffsrv_stop(FFServer* srv);
+void      ffsrv_get_stats(FFServer* srv, FFSrvStats* out);
+
+#ifdef __cplusplus
+}
+#endif
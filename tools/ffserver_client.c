@@ -0,0 +1,133 @@
+#include "ffserver_client.h"
+#include "ffserver_proto.h"
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+struct FFSrvClient {
+    int          fd;
+    FFSrvHello   hello;
+    FFShmReader* reader;
+};
+
+static int read_full(int fd, void* buf, size_t n) {
+    uint8_t* p = buf;
+    while (n > 0) {
+        ssize_t r = read(fd, p, n);
+        if (r < 0 && errno == EINTR) continue;
+        if (r <= 0) return -1;
+        p += r;
+        n -= (size_t)r;
+    }
+    return 0;
+}
+
+static int write_full(int fd, const void* buf, size_t n) {
+    const uint8_t* p = buf;
+    while (n > 0) {
+        ssize_t r = send(fd, p, n, MSG_NOSIGNAL);
+        if (r < 0 && errno == EINTR) continue;
+        if (r <= 0) return -1;
+        p += r;
+        n -= (size_t)r;
+    }
+    return 0;
+}
+
+FFSrvClient* ffsrv_connect(const char* socket_path) {
+    struct sockaddr_un addr;
+    if (!socket_path || strlen(socket_path) >= sizeof(addr.sun_path)) return NULL;
+    FFSrvClient* c = calloc(1, sizeof(*c));
+    if (!c) return NULL;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    memcpy(addr.sun_path, socket_path, strlen(socket_path));
+
+    c->fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (c->fd < 0) goto fail;
+#ifdef SO_NOSIGPIPE
+    int one = 1;
+    setsockopt(c->fd, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one));
+#endif
+    if (connect(c->fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) goto fail;
+    if (read_full(c->fd, &c->hello, sizeof(c->hello)) < 0) goto fail;
+    if (c->hello.magic != FFSRV_MAGIC || c->hello.version != FFSRV_VERSION) goto fail;
+    c->hello.ring_name[sizeof(c->hello.ring_name) - 1] = 0;
+
+    c->reader = ff_shm_reader_open(c->hello.ring_name);
+    if (!c->reader) goto fail;
+    return c;
+
+fail:
+    if (c->fd >= 0) close(c->fd);
+    free(c);
+    return NULL;
+}
+
+void ffsrv_disconnect(FFSrvClient* c) {
+    if (!c) return;
+    close(c->fd);
+    ff_shm_reader_close(c->reader);
+    free(c);
+}
+
+int ffsrv_max_batch(const FFSrvClient* c) {
+    return c ? c->hello.slots - 1 : 0;
+}
+
+int ffsrv_get_frames(FFSrvClient* c, const char* clip, const int64_t* indices, int count,
+                     FFShmFrame* frames, int* status) {
+    if (!c || !clip || count < 0 || (count > 0 && (!indices || !frames || !status))) return -1;
+    size_t plen = strlen(clip);
+    if (plen == 0 || plen > FFSRV_MAX_PATH) return -1;
+
+    FFSrvRequest req = { FFSRV_MAGIC, (uint32_t)plen, (uint32_t)count, 0 };
+    if (write_full(c->fd, &req, sizeof(req)) < 0) return -1;
+    if (write_full(c->fd, clip, plen) < 0) return -1;
+    if (count > 0 && write_full(c->fd, indices, (size_t)count * sizeof(int64_t)) < 0) return -1;
+
+    for (int i = 0; i < count; ++i) {
+        status[i] = FFSRV_ERR_DECODE;
+        frames[i].slot = -1;
+    }
+
+    int delivered = 0;
+    for (int i = 0; i < count; ++i) {
+        FFSrvResponse resp;
+        if (read_full(c->fd, &resp, sizeof(resp)) < 0) {
+            ffsrv_release_frames(c, frames, status, count);
+            return -1;
+        }
+        if (resp.position < 0 || resp.position >= count) continue;
+        int pos = resp.position;
+        status[pos] = resp.status;
+        if (resp.status != FFSRV_OK) continue;
+        // The server keeps the slot pinned until our next request, so this only
+        // fails if the server went away.
+        if (ff_shm_reader_pin(c->reader, resp.slot, resp.seq, &frames[pos]) == 1) {
+            ++delivered;
+        } else {
+            status[pos] = FFSRV_ERR_BUSY;
+            frames[pos].slot = -1;
+        }
+    }
+    return delivered;
+}
+
+void ffsrv_release_frames(FFSrvClient* c, FFShmFrame* frames, const int* status, int count) {
+    if (!c || !frames) return;
+    for (int i = 0; i < count; ++i) {
+        if (status && status[i] != FFSRV_OK) continue;
+        if (frames[i].slot < 0) continue;
+        ff_shm_reader_release(c->reader, &frames[i]);
+        frames[i].slot = -1;
+    }
+}
@@ -0,0 +1,32 @@
+#pragma once
+#include <stdint.h>
+#include "ffshm_client.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Client side of the frame server. Frames come back pinned in the connection's
+// shared-memory ring; release them (ideally before the next request) so the
+// server can reuse their slots.
+typedef struct FFSrvClient FFSrvClient;
+
+FFSrvClient* ffsrv_connect(const char* socket_path);
+void         ffsrv_disconnect(FFSrvClient* c);
+
+// Largest batch one request may carry (ring slots - 1).
+int          ffsrv_max_batch(const FFSrvClient* c);
+
+// Requests `count` frames of `clip`. frames[i] / status[i] receive the result
+// for indices[i]: status FFSRV_OK with the frame pinned, or an FFSRV_ERR_* code.
+// Returns the number of frames delivered, or -1 if the connection failed.
+int          ffsrv_get_frames(FFSrvClient* c, const char* clip, const int64_t* indices, int count,
+                              FFShmFrame* frames, int* status);
+
+// Unpins frames returned by ffsrv_get_frames (entries with status != FFSRV_OK
+// are skipped when `status` is given).
+void         ffsrv_release_frames(FFSrvClient* c, FFShmFrame* frames, const int* status, int count);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,152 @@
+// Load generator for ffserverd: N client threads issue batched frame requests
+// and the tool reports requests/s, frames/s and request latency percentiles.
+// Usage: ffserver_load [--threads N] [--batch N] [--seconds S] [--random] [--frames N] <socket> <clip>
+#include "ffserver_client.h"
+#include "ffserver_proto.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+typedef struct LoadThread {
+    pthread_t th;
+    int       id;
+    uint64_t* lat_ns;      // one entry per request
+    size_t    nlat, cap;
+    uint64_t  frames, errors;
+    int       failed;
+} LoadThread;
+
+static const char* g_sock;
+static const char* g_clip;
+static int         g_batch = 1;
+static int         g_random;
+static int64_t     g_frames = 1000;   // index range for requests
+static double      g_seconds = 5.0;
+static atomic_int  g_stop;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static void* load_main(void* arg) {
+    LoadThread* t = arg;
+    FFSrvClient* c = ffsrv_connect(g_sock);
+    if (!c) {
+        t->failed = 1;
+        return NULL;
+    }
+    int batch = g_batch < ffsrv_max_batch(c) ? g_batch : ffsrv_max_batch(c);
+    int64_t* idx = calloc((size_t)batch, sizeof(*idx));
+    FFShmFrame* fr = calloc((size_t)batch, sizeof(*fr));
+    int* st = calloc((size_t)batch, sizeof(*st));
+    unsigned seed = (unsigned)t->id * 7919u + 1;
+    // Sequential threads start at different offsets so they don't all share one playhead.
+    int64_t pos = g_frames * t->id / 8 % g_frames;
+
+    while (!atomic_load(&g_stop)) {
+        for (int i = 0; i < batch; ++i) {
+            idx[i] = g_random ? (int64_t)(rand_r(&seed) % (unsigned)g_frames) : pos;
+            pos = (pos + 1) % g_frames;
+        }
+        uint64_t t0 = now_ns();
+        int got = ffsrv_get_frames(c, g_clip, idx, batch, fr, st);
+        uint64_t dt = now_ns() - t0;
+        if (got < 0) {
+            t->failed = 1;
+            break;
+        }
+        ffsrv_release_frames(c, fr, st, batch);
+        t->frames += (uint64_t)got;
+        t->errors += (uint64_t)(batch - got);
+
+        if (t->nlat == t->cap) {
+            size_t cap = t->cap ? t->cap * 2 : 4096;
+            uint64_t* n = realloc(t->lat_ns, cap * sizeof(*n));
+            if (!n) break;
+            t->lat_ns = n;
+            t->cap = cap;
+        }
+        t->lat_ns[t->nlat++] = dt;
+    }
+    free(idx);
+    free(fr);
+    free(st);
+    ffsrv_disconnect(c);
+    return NULL;
+}
+
+static int cmp_u64(const void* a, const void* b) {
+    uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+    return x < y ? -1 : x > y;
+}
+
+int main(int argc, char** argv) {
+    int threads = 4;
+    int ai = 1;
+    for (; ai < argc && strncmp(argv[ai], "--", 2) == 0; ++ai) {
+        if (!strcmp(argv[ai], "--random")) {
+            g_random = 1;
+            continue;
+        }
+        if (ai + 1 >= argc) break;
+        const char* v = argv[++ai];
+        if      (!strcmp(argv[ai - 1], "--threads")) threads = atoi(v);
+        else if (!strcmp(argv[ai - 1], "--batch"))   g_batch = atoi(v);
+        else if (!strcmp(argv[ai - 1], "--seconds")) g_seconds = atof(v);
+        else if (!strcmp(argv[ai - 1], "--frames"))  g_frames = atoll(v);
+    }
+    if (ai + 2 > argc || threads <= 0 || g_batch <= 0 || g_frames <= 0) {
+        fprintf(stderr, "usage: %s [--threads N] [--batch N] [--seconds S] [--random] [--frames N] <socket> <clip>\n", argv[0]);
+        return 2;
+    }
+    g_sock = argv[ai];
+    g_clip = argv[ai + 1];
+
+    LoadThread* t = calloc((size_t)threads, sizeof(*t));
+    uint64_t t0 = now_ns();
+    for (int i = 0; i < threads; ++i) {
+        t[i].id = i;
+        pthread_create(&t[i].th, NULL, load_main, &t[i]);
+    }
+    struct timespec nap = { (time_t)g_seconds, (long)((g_seconds - (time_t)g_seconds) * 1e9) };
+    nanosleep(&nap, NULL);
+    atomic_store(&g_stop, 1);
+
+    size_t nlat = 0;
+    uint64_t frames = 0, errors = 0;
+    int failed = 0;
+    for (int i = 0; i < threads; ++i) {
+        pthread_join(t[i].th, NULL);
+        nlat += t[i].nlat;
+        frames += t[i].frames;
+        errors += t[i].errors;
+        failed += t[i].failed;
+    }
+    double el = (now_ns() - t0) / 1e9;
+
+    uint64_t* all = malloc((nlat ? nlat : 1) * sizeof(*all));
+    size_t k = 0;
+    for (int i = 0; i < threads; ++i) {
+        memcpy(all + k, t[i].lat_ns, t[i].nlat * sizeof(*all));
+        k += t[i].nlat;
+        free(t[i].lat_ns);
+    }
+    qsort(all, nlat, sizeof(*all), cmp_u64);
+    double p50 = nlat ? all[nlat / 2] / 1e3 : 0;
+    double p99 = nlat ? all[(nlat * 99) / 100] / 1e3 : 0;
+    double mx  = nlat ? all[nlat - 1] / 1e3 : 0;
+
+    printf("threads=%d batch=%d pattern=%s time=%.2fs\n", threads, g_batch, g_random ? "random" : "sequential", el);
+    printf("requests=%zu req/s=%.1f frames/s=%.1f errors=%llu\n", nlat, nlat / el, frames / el,
+           (unsigned long long)errors);
+    printf("latency: p50=%.1fus p99=%.1fus max=%.1fus\n", p50, p99, mx);
+    free(all);
+    free(t);
+    if (failed) fprintf(stderr, "%d client thread(s) lost the connection\n", failed);
+    return failed ? 1 : 0;
+}
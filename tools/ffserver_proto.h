@@ -0,0 +1,53 @@
+#pragma once
+#include <stdint.h>
+
+// Wire format of the frame server's Unix socket (host byte order: both ends
+// are always on the same machine). Pixels never travel over the socket; each
+// connection gets its own shared-memory ring (ffshm.h) and responses only say
+// which slot holds which frame.
+//
+//   server -> client  FFSrvHello once, after accept
+//   client -> server  FFSrvRequest, then path_len bytes of clip path, then
+//                     count int64 frame indices
+//   server -> client  count FFSrvResponse, one per index, in completion order
+
+#define FFSRV_MAGIC   0x5652534eu   // "NSRV"
+#define FFSRV_VERSION 1
+#define FFSRV_MAX_PATH 4096
+
+typedef struct FFSrvHello {
+    uint32_t magic;
+    uint32_t version;
+    int32_t  slots;          // ring slots; a batch may hold at most slots - 1 frames
+    int32_t  max_width;
+    int32_t  max_height;
+    int32_t  format;         // FFPixelFormat of the ring
+    char     ring_name[96];
+} FFSrvHello;
+
+typedef struct FFSrvRequest {
+    uint32_t magic;
+    uint32_t path_len;
+    uint32_t count;
+    uint32_t reserved;
+} FFSrvRequest;
+
+// Error codes carried in FFSrvResponse.status.
+enum {
+    FFSRV_OK           = 0,
+    FFSRV_ERR_OPEN     = -1,   // clip could not be opened
+    FFSRV_ERR_RANGE    = -2,   // index outside the clip
+    FFSRV_ERR_DECODE   = -3,   // decode or seek failed
+    FFSRV_ERR_TOO_BIG  = -4,   // frame larger than the ring's slots
+    FFSRV_ERR_BATCH    = -5,   // batch larger than slots - 1
+    FFSRV_ERR_BUSY     = -6,   // output buffers stayed exhausted
+};
+
+typedef struct FFSrvResponse {
+    int32_t  status;
+    int32_t  position;       // position of this frame in the request's index list
+    int64_t  frame_index;
+    int32_t  slot;           // ring slot holding the frame (status == FFSRV_OK)
+    int32_t  reserved;
+    uint64_t seq;            // slot sequence to pin (ff_shm_reader_pin)
+} FFSrvResponse;
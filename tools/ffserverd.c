@@ -0,0 +1,66 @@
+// Frame server daemon: serves "frame N of clip X" requests on a Unix socket,
+// returning frames through per-connection shared-memory rings (see ffserver.h).
+// Usage: ffserverd [--workers N] [--decoders N] [--cache N] [--max WxH] [--slots N] <socket>
+#include "ffserver.h"
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void usage(const char* argv0) {
+    fprintf(stderr, "usage: %s [--workers N] [--decoders N] [--cache N] [--max WxH] [--slots N] <socket>\n", argv0);
+}
+
+int main(int argc, char** argv) {
+    FFSrvConfig cfg = { 0 };
+    int ai = 1;
+    for (; ai < argc && strncmp(argv[ai], "--", 2) == 0; ++ai) {
+        if (ai + 1 >= argc) {
+            usage(argv[0]);
+            return 2;
+        }
+        const char* v = argv[++ai];
+        if      (!strcmp(argv[ai - 1], "--workers"))  cfg.workers = atoi(v);
+        else if (!strcmp(argv[ai - 1], "--decoders")) cfg.decoders_per_clip = atoi(v);
+        else if (!strcmp(argv[ai - 1], "--cache"))    cfg.cache_frames = atoi(v);
+        else if (!strcmp(argv[ai - 1], "--slots"))    cfg.slots = atoi(v);
+        else if (!strcmp(argv[ai - 1], "--max"))      sscanf(v, "%dx%d", &cfg.max_width, &cfg.max_height);
+        else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (ai >= argc) {
+        usage(argv[0]);
+        return 2;
+    }
+    cfg.socket_path = argv[ai];
+
+    // Handle SIGINT/SIGTERM synchronously; every server thread inherits the mask.
+    sigset_t sigs;
+    sigemptyset(&sigs);
+    sigaddset(&sigs, SIGINT);
+    sigaddset(&sigs, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &sigs, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    FFServer* srv = ffsrv_start(&cfg);
+    if (!srv) {
+        fprintf(stderr, "ffserverd: cannot listen on %s\n", cfg.socket_path);
+        return 1;
+    }
+    fprintf(stderr, "ffserverd: listening on %s\n", cfg.socket_path);
+
+    int sig = 0;
+    sigwait(&sigs, &sig);
+
+    FFSrvStats st;
+    ffsrv_get_stats(srv, &st);
+    ffsrv_stop(srv);
+    printf("connections=%llu requests=%llu frames=%llu errors=%llu cache_hits=%llu cache_misses=%llu decoded=%llu seeks=%llu\n",
+           (unsigned long long)st.connections, (unsigned long long)st.requests,
+           (unsigned long long)st.frames, (unsigned long long)st.errors,
+           (unsigned long long)st.cache_hits, (unsigned long long)st.cache_misses,
+           (unsigned long long)st.decoded, (unsigned long long)st.seeks);
+    return 0;
+}